@@ -15,6 +15,9 @@
 #include <signal.h>
 #include <arpa/inet.h>
 #include <set>
+#include <deque>
+#include <vector>
+#include <pthread.h>
 #include <blackadder.hpp>
 
 #include "tm_igraph.hpp"
@@ -35,6 +38,90 @@ string resp_prefix_id = "FFFFFFFFFFFFFFFD";
 string resp_bin_id = hex_to_chararray(resp_id);
 string resp_bin_prefix_id = hex_to_chararray(resp_prefix_id);
 
+/*our proposal the control channel for topology updates*/
+string ctrl_id = "FFFFFFFFFFFFFFFC";
+string ctrl_prefix_id = string();
+string ctrl_bin_id = hex_to_chararray(ctrl_id);
+string ctrl_bin_prefix_id = hex_to_chararray(ctrl_prefix_id);
+
+/*our proposal notifications with the same payload are published once per group of subscribers, to this node label under the notification scope.
+ *every LocalProxy accepts it along with its own (see GlobalConf::groupNotificationIID) and notifies only its own subscribers*/
+string group_notification_node = string(PURSUIT_ID_LEN, (char) 255);
+
+/*our proposal the bound (percentage of set bits) up to which the FIDs to subscribers are merged into one group FID, 0 notifies one subscriber at a time (see MULTICAST_FILL in the LocalProxy)*/
+unsigned int notification_fill = 50;
+
+/*our proposal the FID and the subscribers of a group notification*/
+struct NotificationGroup {
+    Bitvector FID;
+    vector<string> subscribers;
+    NotificationGroup(const Bitvector &fid) : FID(fid) {}
+};
+
+/*our proposal the number of set bits of an FID*/
+unsigned int fidWeight(const Bitvector &FID) {
+    unsigned int weight = 0;
+    for (int i = 0; i < FID.size(); i++) {
+        if (FID[i]) {
+            weight++;
+        }
+    }
+    return weight;
+}
+
+/*our proposal groups the subscribers by the FIDs the TM computes to them: first fit, a subscriber joins the first group whose merged FID stays under notification_fill*/
+void groupSubscribers(set<string> &subscribers, vector<NotificationGroup> &groups) {
+    for (set<string>::iterator iter = subscribers.begin(); iter != subscribers.end(); iter++) {
+        string subnodeid = *iter;
+        Bitvector *FID_to_subscriber = tm_igraph.calculateFID(tm_igraph.nodeID, subnodeid);
+        size_t i;
+        for (i = 0; notification_fill > 0 && i < groups.size(); i++) {
+            Bitvector merged = groups[i].FID | *FID_to_subscriber;
+            if (fidWeight(merged) * 100 <= notification_fill * (unsigned int) merged.size()) {
+                groups[i].FID = merged;
+                groups[i].subscribers.push_back(subnodeid);
+                break;
+            }
+        }
+        if (notification_fill == 0 || i == groups.size()) {
+            groups.push_back(NotificationGroup(*FID_to_subscriber));
+            groups.back().subscribers.push_back(subnodeid);
+        }
+        delete FID_to_subscriber;
+    }
+}
+
+/*our proposal publishes the same notification once per group (a group of one keeps the label of its node)*/
+void publishNotification(set<string> &subscribers, char *response, int response_size) {
+    vector<NotificationGroup> groups;
+    groupSubscribers(subscribers, groups);
+    for (size_t i = 0; i < groups.size(); i++) {
+        string response_id = resp_bin_prefix_id + ((groups[i].subscribers.size() == 1) ? groups[i].subscribers[0] : group_notification_node);
+        ba->publish_data(response_id, IMPLICIT_RENDEZVOUS, groups[i].FID._data, FID_LEN, response, response_size);
+    }
+}
+
+/*our proposal a request copied out of the event that carried it, waiting for a worker*/
+struct TMRequest {
+    char *data;
+    int data_len;
+};
+
+/*our proposal a request worker: requests are handed to it through its own queue so that the requests of one information item are handled in order*/
+struct TMWorker {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    deque<TMRequest> queue;
+};
+
+/*our proposal empty: every request is handled by the event listener itself*/
+vector<TMWorker *> workers;
+
+/*our proposal the last rendezvous request of each information item (keyed by request type and identifiers), replayed when a topology update changes the paths of its publishers.
+ *only the event listener touches it*/
+map<string, string> rendezvous_requests;
+
 void handleRequest(char *request, int request_len) {
     unsigned char request_type;
     unsigned char no_publishers;
@@ -209,19 +296,17 @@ void handleRequest(char *request, int request_len) {
         for (int i = 0; i < (int) no_subscribers; i++) {
             nodeID = string(request + sizeof (request_type) + sizeof (strategy) + sizeof (no_subscribers) + idx,\
                             PURSUIT_ID_LEN);
-            Bitvector *FID_to_subscriber = tm_igraph.calculateFID(tm_igraph.nodeID, nodeID);
-            int response_size = request_len - sizeof(strategy) - sizeof (no_subscribers) - no_subscribers * PURSUIT_ID_LEN + FID_LEN;
-            int ids_index = sizeof (request_type) + sizeof (strategy) + sizeof (no_subscribers) + no_subscribers * PURSUIT_ID_LEN;
-            char *response = (char *) malloc(response_size);
-            string response_id = resp_bin_prefix_id + nodeID;
-            memcpy(response, &request_type, sizeof (request_type));
-            memcpy(response + sizeof (request_type), request + ids_index, request_len - ids_index);
-            //cout << "PUBLISHING NOTIFICATION ABOUT NEW OR DELETED SCOPE to node " << nodeID << " using FID " << FID_to_subscriber->to_string() << endl;
-            ba->publish_data(response_id, IMPLICIT_RENDEZVOUS, FID_to_subscriber->_data, FID_LEN, response, response_size);
             idx += PURSUIT_ID_LEN;
-            delete FID_to_subscriber;
-            free(response);
+            subscribers.insert(nodeID);
         }
+        /*the notification is the same for all subscribers: it is built once*/
+        int response_size = request_len - sizeof(strategy) - sizeof (no_subscribers) - no_subscribers * PURSUIT_ID_LEN + FID_LEN;
+        int ids_index = sizeof (request_type) + sizeof (strategy) + sizeof (no_subscribers) + no_subscribers * PURSUIT_ID_LEN;
+        char *response = (char *) malloc(response_size);
+        memcpy(response, &request_type, sizeof (request_type));
+        memcpy(response + sizeof (request_type), request + ids_index, request_len - ids_index);
+        publishNotification(subscribers, response, response_size);
+        free(response);
     }else if((request_type == INFO_PUBLISHED))
     {//for flooding
         Bitvector iLIDs(FID_LEN*8) ;
@@ -231,8 +316,14 @@ void handleRequest(char *request, int request_len) {
                             PURSUIT_ID_LEN);
             cout << nodeID << " ";
             idx += PURSUIT_ID_LEN;
+            /*find, not operator[]: the workers only hold the read lock, and an unknown publisher has no iLID to add*/
+            map<string, Bitvector *>::iterator ilid_it = tm_igraph.nodeID_iLID.find(nodeID);
+            if ((ilid_it == tm_igraph.nodeID_iLID.end()) || ((*ilid_it).second == NULL)) {
+                cout << "TM: unknown publisher " << nodeID << " skipped" << endl;
+                continue;
+            }
             publishers.insert(nodeID);
-            iLIDs |= *(tm_igraph.nodeID_iLID[nodeID]) ;
+            iLIDs |= *(*ilid_it).second ;
         }
         memcpy(&no_subscribers, request + sizeof (request_type) + sizeof (strategy) + sizeof (no_publishers) + idx, sizeof (no_subscribers));
         for (int i = 0; i < (int) no_subscribers; i++) {
@@ -242,29 +333,263 @@ void handleRequest(char *request, int request_len) {
             idx += PURSUIT_ID_LEN;
             subscribers.insert(nodeID);
         }
-        for (set<string>::iterator iter = subscribers.begin() ; iter != subscribers.end() ; iter++)
-        {//notify every subscriber
-            string subnodeid = *iter ;
-            Bitvector *FID_to_subscriber = tm_igraph.calculateFID(tm_igraph.nodeID, subnodeid);
-
-            int response_size = request_len-sizeof(strategy)-sizeof(no_publishers)-no_publishers*PURSUIT_ID_LEN-\
-            sizeof(no_subscribers)-no_subscribers * PURSUIT_ID_LEN+ FID_LEN;
-            int ids_index = sizeof (request_type) + sizeof (strategy) +sizeof (no_publishers) + no_publishers * PURSUIT_ID_LEN+\
-            sizeof (no_subscribers) + no_subscribers * PURSUIT_ID_LEN;
-            char *response = (char *) malloc(response_size);
-            string response_id = resp_bin_prefix_id + subnodeid;
-            memcpy(response, &request_type, sizeof (request_type));
-            memcpy(response + sizeof (request_type), request + ids_index, request_len - ids_index);
-            memcpy(response + sizeof (request_type)+request_len - ids_index, iLIDs._data, FID_LEN) ;//internal LID
-
-            //cout << "PUBLISHING NOTIFICATION ABOUT NEW OR DELETED SCOPE to node " << nodeID << " using FID " << FID_to_subscriber->to_string() << endl;
-            ba->publish_data(response_id, IMPLICIT_RENDEZVOUS, FID_to_subscriber->_data, FID_LEN, response, response_size);
-            delete FID_to_subscriber;
-            free(response);
+        //notify every subscriber: the notification is the same for all of them
+        int response_size = request_len-sizeof(strategy)-sizeof(no_publishers)-no_publishers*PURSUIT_ID_LEN-\
+        sizeof(no_subscribers)-no_subscribers * PURSUIT_ID_LEN+ FID_LEN;
+        int ids_index = sizeof (request_type) + sizeof (strategy) +sizeof (no_publishers) + no_publishers * PURSUIT_ID_LEN+\
+        sizeof (no_subscribers) + no_subscribers * PURSUIT_ID_LEN;
+        char *response = (char *) malloc(response_size);
+        memcpy(response, &request_type, sizeof (request_type));
+        memcpy(response + sizeof (request_type), request + ids_index, request_len - ids_index);
+        memcpy(response + sizeof (request_type)+request_len - ids_index, iLIDs._data, FID_LEN) ;//internal LID
+        publishNotification(subscribers, response, response_size);
+        free(response);
+    }
+}
+
+/*our proposal returns the offset of the information identifiers that end every request (everything before them is node labels)*/
+int requestIDsOffset(char *request, int request_len) {
+    unsigned char request_type;
+    unsigned char no_publishers = 0;
+    unsigned char no_subscribers = 0;
+    int offset = sizeof (request_type) + sizeof (unsigned char) /*strategy*/;
+    memcpy(&request_type, request, sizeof (request_type));
+    if ((request_type == SCOPE_MATCH_PUB_SUB) || (request_type == MATCH_PUB_SUBS) || (request_type == INFO_PUBLISHED)) {
+        memcpy(&no_publishers, request + offset, sizeof (no_publishers));
+        offset += sizeof (no_publishers) + no_publishers * PURSUIT_ID_LEN;
+    }
+    if (offset + (int) sizeof (no_subscribers) > request_len) {
+        return request_len;
+    }
+    memcpy(&no_subscribers, request + offset, sizeof (no_subscribers));
+    offset += sizeof (no_subscribers) + no_subscribers * PURSUIT_ID_LEN;
+    return (offset > request_len) ? request_len : offset;
+}
+
+/*our proposal the worker of a request: requests about the same identifiers always go to the same worker (and therefore are answered in the order they were sent)*/
+TMWorker *requestWorker(char *request, int request_len) {
+    unsigned int hash = 2166136261U;
+    for (int i = requestIDsOffset(request, request_len); i < request_len; i++) {
+        hash = (hash ^ (unsigned char) request[i]) * 16777619U;
+    }
+    return workers[hash % workers.size()];
+}
+
+/*our proposal keeps the latest rendezvous request of an item: the one without publishers or subscribers ends it*/
+void recordRendezvousRequest(char *request, int request_len) {
+    unsigned char no_publishers;
+    unsigned char no_subscribers;
+    int offset = requestIDsOffset(request, request_len);
+    string key = string(request, sizeof (unsigned char)) + string(request + offset, request_len - offset);
+    memcpy(&no_publishers, request + sizeof (unsigned char) + sizeof (unsigned char) /*strategy*/, sizeof (no_publishers));
+    memcpy(&no_subscribers, request + sizeof (unsigned char) + sizeof (unsigned char) + sizeof (no_publishers) + no_publishers * PURSUIT_ID_LEN, sizeof (no_subscribers));
+    if ((no_publishers == 0) || (no_subscribers == 0)) {
+        rendezvous_requests.erase(key);
+    } else {
+        rendezvous_requests[key] = string(request, request_len);
+    }
+}
+
+void dispatchRequest(char *request, int request_len);
+
+/*our proposal answers again the recorded rendezvous requests with a publisher whose paths changed (all of them if sources is NULL), so that only the affected publishers get new FIDs.
+ *requests that name a node that no longer exists are forgotten*/
+void replayRendezvousRequests(set<int> *sources) {
+    map<string, string>::iterator req_it = rendezvous_requests.begin();
+    while (req_it != rendezvous_requests.end()) {
+        const char *request = (*req_it).second.c_str();
+        unsigned char no_publishers;
+        unsigned char no_subscribers;
+        bool affected = (sources == NULL);
+        bool known = true;
+        int offset = sizeof (unsigned char) + sizeof (unsigned char) /*strategy*/;
+        memcpy(&no_publishers, request + offset, sizeof (no_publishers));
+        offset += sizeof (no_publishers);
+        for (int i = 0; i < (int) no_publishers; i++, offset += PURSUIT_ID_LEN) {
+            map<string, int>::iterator node_it = tm_igraph.reverse_node_index.find(string(request + offset, PURSUIT_ID_LEN));
+            if (node_it == tm_igraph.reverse_node_index.end()) {
+                known = false;
+            } else if ((sources != NULL) && (sources->find((*node_it).second) != sources->end())) {
+                affected = true;
+            }
         }
+        memcpy(&no_subscribers, request + offset, sizeof (no_subscribers));
+        offset += sizeof (no_subscribers);
+        for (int i = 0; i < (int) no_subscribers; i++, offset += PURSUIT_ID_LEN) {
+            if (tm_igraph.reverse_node_index.find(string(request + offset, PURSUIT_ID_LEN)) == tm_igraph.reverse_node_index.end()) {
+                known = false;
+            }
+        }
+        if (!known) {
+            rendezvous_requests.erase(req_it++);
+            continue;
+        }
+        if (affected) {
+            /*dispatchRequest records it again, which does not invalidate the iterator*/
+            string copy = (*req_it).second;
+            dispatchRequest((char *) copy.data(), copy.length());
+        }
+        req_it++;
     }
 }
 
+/*our proposal applies a topology update published to the control identifier and republishes the rendezvous results it changed*/
+void handleTopologyUpdate(char *update, int update_len) {
+    unsigned char update_type;
+    set<int> affected;
+    bool all = false;
+    int ret = -1;
+    memcpy(&update_type, update, sizeof (update_type));
+    pthread_rwlock_wrlock(&tm_igraph.topology_lock);
+    if ((update_type == TOPOLOGY_LINK_ADD) && (update_len >= (int) sizeof (update_type) + 2 * PURSUIT_ID_LEN + FID_LEN)) {
+        string source = string(update + sizeof (update_type), PURSUIT_ID_LEN);
+        string destination = string(update + sizeof (update_type) + PURSUIT_ID_LEN, PURSUIT_ID_LEN);
+        Bitvector lid(FID_LEN * 8);
+        memcpy(lid._data, update + sizeof (update_type) + 2 * PURSUIT_ID_LEN, FID_LEN);
+        ret = tm_igraph.addLink(source, destination, lid, affected);
+        cout << "TM: link " << source << "->" << destination << " added" << endl;
+    } else if ((update_type == TOPOLOGY_LINK_REMOVE) && (update_len >= (int) sizeof (update_type) + 2 * PURSUIT_ID_LEN)) {
+        string source = string(update + sizeof (update_type), PURSUIT_ID_LEN);
+        string destination = string(update + sizeof (update_type) + PURSUIT_ID_LEN, PURSUIT_ID_LEN);
+        ret = tm_igraph.removeLink(source, destination, affected);
+        cout << "TM: link " << source << "->" << destination << " removed" << endl;
+    } else if ((update_type == TOPOLOGY_NODE_ADD) && (update_len >= (int) sizeof (update_type) + PURSUIT_ID_LEN + FID_LEN)) {
+        string node = string(update + sizeof (update_type), PURSUIT_ID_LEN);
+        Bitvector ilid(FID_LEN * 8);
+        memcpy(ilid._data, update + sizeof (update_type) + PURSUIT_ID_LEN, FID_LEN);
+        ret = tm_igraph.addNode(node, ilid);
+        all = true;
+        cout << "TM: node " << node << " added" << endl;
+    } else if ((update_type == TOPOLOGY_NODE_REMOVE) && (update_len >= (int) sizeof (update_type) + PURSUIT_ID_LEN)) {
+        string node = string(update + sizeof (update_type), PURSUIT_ID_LEN);
+        ret = tm_igraph.removeNode(node);
+        all = true;
+        cout << "TM: node " << node << " removed" << endl;
+    }
+    if (ret < 0) {
+        pthread_rwlock_unlock(&tm_igraph.topology_lock);
+        cout << "TM: could not apply topology update " << (int) update_type << endl;
+        return;
+    }
+    if (!all) {
+        /*node updates recompute everything (and drop the whole cache)*/
+        pthread_mutex_lock(&tm_igraph.fid_cache_mutex);
+        tm_igraph.invalidateFIDCache(affected);
+        pthread_mutex_unlock(&tm_igraph.fid_cache_mutex);
+    }
+    cout << "TM: " << (all ? tm_igraph.number_of_nodes : (int) affected.size()) << " sources have new paths" << endl;
+    pthread_rwlock_unlock(&tm_igraph.topology_lock);
+    replayRendezvousRequests(all ? NULL : &affected);
+}
+
+/*our proposal applies the load report of a Forwarder (TOPOLOGY_LINK_LOAD) and republishes the rendezvous results whose paths it moved*/
+void handleLinkLoad(char *update, int update_len) {
+    unsigned int interval;
+    unsigned short no_links;
+    set<int> affected;
+    vector<pair<Bitvector, unsigned long long> > loads;
+    int offset = sizeof (unsigned char) + PURSUIT_ID_LEN;
+    if (update_len < offset + (int) (sizeof (interval) + sizeof (no_links))) {
+        cout << "TM: truncated load report" << endl;
+        return;
+    }
+    string node = string(update + sizeof (unsigned char), PURSUIT_ID_LEN);
+    memcpy(&interval, update + offset, sizeof (interval));
+    offset += sizeof (interval);
+    memcpy(&no_links, update + offset, sizeof (no_links));
+    offset += sizeof (no_links);
+    if (update_len < offset + (int) no_links * (FID_LEN + (int) sizeof (unsigned long long))) {
+        cout << "TM: truncated load report" << endl;
+        return;
+    }
+    for (int i = 0; i < (int) no_links; i++) {
+        Bitvector lid(FID_LEN * 8);
+        unsigned long long bytes;
+        memcpy(lid._data, update + offset, FID_LEN);
+        memcpy(&bytes, update + offset + FID_LEN, sizeof (bytes));
+        offset += FID_LEN + sizeof (bytes);
+        loads.push_back(pair<Bitvector, unsigned long long>(lid, bytes));
+    }
+    pthread_rwlock_wrlock(&tm_igraph.topology_lock);
+    int changed = tm_igraph.updateLinkLoad(node, interval, loads, affected);
+    if (changed <= 0) {
+        pthread_rwlock_unlock(&tm_igraph.topology_lock);
+        return;
+    }
+    pthread_mutex_lock(&tm_igraph.fid_cache_mutex);
+    tm_igraph.invalidateFIDCache(affected);
+    pthread_mutex_unlock(&tm_igraph.fid_cache_mutex);
+    cout << "TM: the load of " << changed << " links of " << node << " changed, " << affected.size() << " sources have new paths" << endl;
+    pthread_rwlock_unlock(&tm_igraph.topology_lock);
+    replayRendezvousRequests(&affected);
+}
+
+/*our proposal unpacks batches of requests and either handles each request here or queues it to its worker*/
+void dispatchRequest(char *request, int request_len) {
+    unsigned char request_type;
+    memcpy(&request_type, request, sizeof (request_type));
+    if (request_type == BATCHED_REQUESTS) {
+        /*a LocalRV coalesced many requests in a single publication: dispatch them one by one*/
+        unsigned short no_requests;
+        unsigned short length;
+        int offset = sizeof (request_type) + sizeof (unsigned char) /*strategy*/ + sizeof (no_requests);
+        memcpy(&no_requests, request + sizeof (request_type) + sizeof (unsigned char), sizeof (no_requests));
+        for (int i = 0; i < (int) no_requests; i++) {
+            if (offset + (int) sizeof (length) > request_len) {
+                cout << "TM: truncated batch of requests" << endl;
+                break;
+            }
+            memcpy(&length, request + offset, sizeof (length));
+            offset += sizeof (length);
+            if (offset + (int) length > request_len) {
+                cout << "TM: truncated batch of requests" << endl;
+                break;
+            }
+            dispatchRequest(request + offset, length);
+            offset += length;
+        }
+        return;
+    }
+    if ((request_type == MATCH_PUB_SUBS) || (request_type == SCOPE_MATCH_PUB_SUB)) {
+        recordRendezvousRequest(request, request_len);
+    }
+    if (workers.empty()) {
+        pthread_rwlock_rdlock(&tm_igraph.topology_lock);
+        handleRequest(request, request_len);
+        pthread_rwlock_unlock(&tm_igraph.topology_lock);
+        return;
+    }
+    /*the event data is freed with the event, so the worker gets a copy*/
+    TMRequest req;
+    req.data = (char *) malloc(request_len);
+    req.data_len = request_len;
+    memcpy(req.data, request, request_len);
+    TMWorker *worker = requestWorker(request, request_len);
+    pthread_mutex_lock(&worker->mutex);
+    worker->queue.push_back(req);
+    pthread_cond_signal(&worker->cond);
+    pthread_mutex_unlock(&worker->mutex);
+}
+
+/*our proposal the loop of a request worker. Workers only read the topology (the FID cache has its own lock) and publish their responses as soon as they are ready*/
+void *worker_loop(void *arg) {
+    TMWorker *worker = (TMWorker *) arg;
+    while (true) {
+        pthread_mutex_lock(&worker->mutex);
+        while (worker->queue.empty()) {
+            pthread_cond_wait(&worker->cond, &worker->mutex);
+        }
+        TMRequest req = worker->queue.front();
+        worker->queue.pop_front();
+        pthread_mutex_unlock(&worker->mutex);
+        pthread_rwlock_rdlock(&tm_igraph.topology_lock);
+        handleRequest(req.data, req.data_len);
+        pthread_rwlock_unlock(&tm_igraph.topology_lock);
+        free(req.data);
+    }
+    return NULL;
+}
+
 void *event_listener_loop(void *arg) {
     Blackadder *ba = (Blackadder *) arg;
     while (true) {
@@ -272,7 +597,14 @@ void *event_listener_loop(void *arg) {
         ba->getEvent(ev);
         if (ev.type == PUBLISHED_DATA) {
             //cout << "TM: received a request...processing now" << endl;
-            handleRequest((char *) ev.data, ev.data_len);
+            unsigned char type = *((unsigned char *) ev.data);
+            if ((type >= TOPOLOGY_LINK_ADD) && (type <= TOPOLOGY_NODE_REMOVE)) {
+                handleTopologyUpdate((char *) ev.data, ev.data_len);
+            } else if (type == TOPOLOGY_LINK_LOAD) {
+                handleLinkLoad((char *) ev.data, ev.data_len);
+            } else {
+                dispatchRequest((char *) ev.data, ev.data_len);
+            }
         } else {
             cout << "TM: I am not expecting any other notification...FATAL" << endl;
         }
@@ -291,11 +623,20 @@ void sigfun(int sig) {
 int main(int argc, char* argv[]) {
     (void) signal(SIGINT, sigfun);
     cout << "TM: starting - process ID: " << getpid() << endl;
-    if (argc != 2) {
+    if (argc < 2 || argc > 4) {
         cout << "TM: the topology file is missing" << endl;
+        cout << "usage: tm topology_file [number_of_workers [notification_fill]]" << endl;
         exit(0);
     }
-    /*read the graphML file that describes the topology*/
+    if (argc == 4) {
+        notification_fill = atoi(argv[3]);
+        if (notification_fill > 100) {
+            cout << "TM: notification_fill is a percentage (0 notifies every subscriber on its own)" << endl;
+            exit(0);
+        }
+    }
+    cout << "TM: notifications merged up to " << notification_fill << "% of set FID bits" << endl;
+    /*read the graphML file (or our proposal the binary .tmb file) that describes the topology*/
     if (tm_igraph.readTopology(argv[1]) < 0) {
         cout << "TM: couldn't read topology file...aborting" << endl;
         exit(0);
@@ -307,8 +648,21 @@ int main(int argc, char* argv[]) {
     } else {
         ba = Blackadder::Instance(true);
     }
+    /*our proposal with workers, requests are handled in parallel (the event listener only dispatches them)*/
+    if (argc >= 3) {
+        int no_workers = atoi(argv[2]);
+        for (int i = 0; i < no_workers; i++) {
+            TMWorker *worker = new TMWorker();
+            pthread_mutex_init(&worker->mutex, NULL);
+            pthread_cond_init(&worker->cond, NULL);
+            workers.push_back(worker);
+            pthread_create(&worker->thread, NULL, worker_loop, (void *) worker);
+        }
+        cout << "TM: " << workers.size() << " request workers" << endl;
+    }
     pthread_create(&event_listener, NULL, event_listener_loop, (void *) ba);
     ba->subscribe_scope(req_bin_id, req_bin_prefix_id, IMPLICIT_RENDEZVOUS, NULL, 0);
+    ba->subscribe_scope(ctrl_bin_id, ctrl_bin_prefix_id, IMPLICIT_RENDEZVOUS, NULL, 0);
 
     pthread_join(event_listener, NULL);
     cout << "TM: disconnecting" << endl;
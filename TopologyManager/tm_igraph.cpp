@@ -14,32 +14,70 @@
 
 #include "tm_igraph.hpp"
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 TMIgraph::TMIgraph() {
     igraph_i_set_attribute_table(&igraph_cattribute_table);
     igraph_empty(&graph, 0, true);
+    number_of_nodes = 0;
+    number_of_connections = 0;
+    fid_len = FID_LEN;
+    lid_tables = 1;
+    load_weight = 0;
+    link_capacity = LINK_CAPACITY_DEFAULT;
+    load_hysteresis = LOAD_HYSTERESIS_DEFAULT;
+    fid_cache_hits = 0;
+    fid_cache_misses = 0;
+    pthread_mutex_init(&fid_cache_mutex, NULL);
+    pthread_rwlock_init(&topology_lock, NULL);
 }
 
 TMIgraph::~TMIgraph() {
-    map<string, Bitvector *>::iterator nodeID_iLID_iter;
+    map<int, Bitvector *>::iterator vertex_iLID_iter;
     map<int, Bitvector *>::iterator edge_LID_iter;
-    for (nodeID_iLID_iter = nodeID_iLID.begin(); nodeID_iLID_iter != nodeID_iLID.end(); nodeID_iLID_iter++) {
-        delete (*nodeID_iLID_iter).second;
+    for (vertex_iLID_iter = vertex_iLID.begin(); vertex_iLID_iter != vertex_iLID.end(); vertex_iLID_iter++) {
+        delete (*vertex_iLID_iter).second;
     }
     for (edge_LID_iter = edge_LID.begin(); edge_LID_iter != edge_LID.end(); edge_LID_iter++) {
         delete (*edge_LID_iter).second;
     }
+    invalidateFIDCache();
+    pthread_mutex_destroy(&fid_cache_mutex);
+    pthread_rwlock_destroy(&topology_lock);
     igraph_i_attribute_destroy(&graph);
     igraph_destroy(&graph);
 }
 
 int TMIgraph::readTopology(char *file_name) {
     int ret;
-    Bitvector *lid;
-    Bitvector *ilid;
     ifstream infile;
     string str;
     size_t found, first, second;
     FILE *instream;
+    uint32_t magic = 0;
+    /*our proposal a compact binary topology (see tm_topology.hpp) is recognised by its first word*/
+    instream = fopen(file_name, "r");
+    if (instream == NULL) {
+        cout << "TM: cannot open " << file_name << endl;
+        return -1;
+    }
+    if (fread(&magic, sizeof (magic), 1, instream) != 1) {
+        magic = 0;
+    }
+    fclose(instream);
+    if (magic == TM_TOPOLOGY_MAGIC) {
+        return readBinaryTopology(file_name);
+    }
+    if (magic == __builtin_bswap32(TM_TOPOLOGY_MAGIC)) {
+        /*written on a host of the other byte order: the deployment tool always writes the graphML file next to it*/
+        string graphml = file_name;
+        graphml = graphml.substr(0, graphml.rfind('.')) + ".graphml";
+        cout << "TM: " << file_name << " was written with the other byte order, reading " << graphml << endl;
+        return readTopology((char *) graphml.c_str());
+    }
     infile.open(file_name, ifstream::in);
     /*first the Global graph attributes - c igraph does not do it!!*/
     while (infile.good()) {
@@ -63,8 +101,41 @@ int TMIgraph::readTopology(char *file_name) {
             second = str.find("<", first);
             mode = str.substr(first + 1, second - first - 1);
         }
+        found = str.find("<data key=\"LID_TABLES\">");
+        if (found != string::npos) {
+            first = str.find(">");
+            second = str.find("<", first);
+            sscanf(str.substr(first + 1, second - first - 1).c_str(), "%d", &lid_tables);
+        }
+        found = str.find("<data key=\"TM_FID_MODE\">");
+        if (found != string::npos) {
+            first = str.find(">");
+            second = str.find("<", first);
+            fid_mode = str.substr(first + 1, second - first - 1);
+        }
+        found = str.find("<data key=\"TM_LOAD_WEIGHT\">");
+        if (found != string::npos) {
+            first = str.find(">");
+            second = str.find("<", first);
+            sscanf(str.substr(first + 1, second - first - 1).c_str(), "%lf", &load_weight);
+        }
+        found = str.find("<data key=\"TM_LINK_CAPACITY\">");
+        if (found != string::npos) {
+            first = str.find(">");
+            second = str.find("<", first);
+            sscanf(str.substr(first + 1, second - first - 1).c_str(), "%lf", &link_capacity);
+        }
+        found = str.find("<data key=\"TM_LOAD_HYSTERESIS\">");
+        if (found != string::npos) {
+            first = str.find(">");
+            second = str.find("<", first);
+            sscanf(str.substr(first + 1, second - first - 1).c_str(), "%lf", &load_hysteresis);
+        }
     }
     infile.close();
+    if (checkSettings() < 0) {
+        return -1;
+    }
     instream = fopen(file_name, "r");
     ret = igraph_read_graph_graphml(&graph, instream, 0);
     fclose(instream);
@@ -73,6 +144,168 @@ int TMIgraph::readTopology(char *file_name) {
     }
     cout << "TM: " << igraph_vcount(&graph) << " nodes" << endl;
     cout << "TM: " << igraph_ecount(&graph) << " edges" << endl;
+    rebuildIndexes();
+    precomputePaths();
+    return ret;
+}
+
+int TMIgraph::checkSettings() {
+    if (fid_mode.empty()) {
+        fid_mode = "shortest_path";
+    }
+    cout << "TM: FID mode " << fid_mode << endl;
+    if ((load_weight < 0) || (link_capacity <= 0) || (load_hysteresis < 0)) {
+        cout << "TM: TM_LOAD_WEIGHT and TM_LOAD_HYSTERESIS must not be negative and TM_LINK_CAPACITY must be positive" << endl;
+        return -1;
+    }
+    if (load_weight > 0) {
+        cout << "TM: load aware paths (TM_LOAD_WEIGHT " << load_weight << ", TM_LINK_CAPACITY " << link_capacity << " bytes/s, TM_LOAD_HYSTERESIS " << load_hysteresis << ")" << endl;
+    }
+    if ((lid_tables < 1) || ((lid_tables & (lid_tables - 1)) != 0)) {
+        cout << "TM: LID_TABLES must be a power of 2" << endl;
+        return -1;
+    }
+    cout << "TM: " << lid_tables << " LID tables" << endl;
+    /*our proposal the LIDs in the file must fit in the FIDs this TM was built for*/
+    if (fid_len != FID_LEN) {
+        cout << "TM: the topology has " << fid_len << " byte LIPSIN identifiers but the TM was built with FID_LEN " << FID_LEN << endl;
+        return -1;
+    }
+    return 0;
+}
+
+int TMIgraph::readBinaryTopology(char *file_name) {
+    struct stat st;
+    TMTopologyHeader h;
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0) {
+        cout << "TM: cannot open " << file_name << endl;
+        return -1;
+    }
+    if ((fstat(fd, &st) < 0) || ((size_t) st.st_size < sizeof (TMTopologyHeader))) {
+        cout << "TM: " << file_name << " is truncated" << endl;
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        cout << "TM: cannot map " << file_name << endl;
+        return -1;
+    }
+    memcpy(&h, map, sizeof (h));
+    if ((h.version != TM_TOPOLOGY_VERSION) || (h.words != (FID_LEN * 8 + 31) / 32) || (h.lid_tables < 1) ||\
+            ((uint64_t) st.st_size != tm_topology_size(h))) {
+        cout << "TM: " << file_name << " is not a version " << TM_TOPOLOGY_VERSION << " topology for FID_LEN " << FID_LEN << endl;
+        munmap(map, st.st_size);
+        return -1;
+    }
+    const uint32_t *labels = (const uint32_t *) ((const char *) map + sizeof (TMTopologyHeader));
+    const uint32_t *out = labels + h.nodes + 1;
+    const uint32_t *destinations = out + h.nodes + 1;
+    const uint32_t *ilids = destinations + h.edges;
+    const uint32_t *lids = ilids + (uint64_t) h.nodes * h.words;
+    const char *strings = (const char *) (lids + (uint64_t) h.edges * h.lid_tables * h.words);
+    /*everything the indexes point at must be in the file*/
+    bool valid = (labels[h.nodes] <= h.strings_len) && (out[h.nodes] == h.edges) && ((uint64_t) h.tm_offset + h.tm_len <= h.strings_len) &&\
+            ((uint64_t) h.tm_mode_offset + h.tm_mode_len <= h.strings_len) && ((uint64_t) h.fid_mode_offset + h.fid_mode_len <= h.strings_len);
+    for (uint32_t i = 0; valid && (i < h.nodes); i++) {
+        valid = (labels[i] <= labels[i + 1]) && (out[i] <= out[i + 1]);
+    }
+    for (uint32_t e = 0; valid && (e < h.edges); e++) {
+        valid = destinations[e] < h.nodes;
+    }
+    if (!valid) {
+        cout << "TM: " << file_name << " is corrupted" << endl;
+        munmap(map, st.st_size);
+        return -1;
+    }
+    fid_len = h.fid_len;
+    lid_tables = h.lid_tables;
+    nodeID = string(strings + h.tm_offset, h.tm_len);
+    mode = string(strings + h.tm_mode_offset, h.tm_mode_len);
+    fid_mode = string(strings + h.fid_mode_offset, h.fid_mode_len);
+    load_weight = h.load_weight;
+    link_capacity = h.link_capacity;
+    load_hysteresis = h.load_hysteresis;
+    if (checkSettings() < 0) {
+        munmap(map, st.st_size);
+        return -1;
+    }
+    /*the edge ids of igraph follow the order of the edge list, which is the order of the file*/
+    igraph_vector_t edges;
+    igraph_vector_init(&edges, 2 * h.edges);
+    for (uint32_t i = 0; i < h.nodes; i++) {
+        for (uint32_t e = out[i]; e < out[i + 1]; e++) {
+            VECTOR(edges)[2 * e] = i;
+            VECTOR(edges)[2 * e + 1] = destinations[e];
+        }
+    }
+    igraph_destroy(&graph);
+    int ret = igraph_create(&graph, &edges, h.nodes, true);
+    igraph_vector_destroy(&edges);
+    if (ret != 0) {
+        munmap(map, st.st_size);
+        return -1;
+    }
+    /*the indexes are filled from the packed words as they are - the string attributes are only kept for rebuildIndexes after topology updates*/
+    reverse_node_index.clear();
+    nodeID_iLID.clear();
+    vertex_iLID.clear();
+    reverse_edge_index.clear();
+    edge_LID.clear();
+    edge_table_LIDs.clear();
+    edge_weight.assign(h.edges, 1);
+    for (uint32_t i = 0; i < h.nodes; i++) {
+        string nID(strings + labels[i], labels[i + 1] - labels[i]);
+        Bitvector *ilid = new Bitvector(FID_LEN * 8);
+        memcpy(ilid->data_words(), ilids + (uint64_t) i * h.words, h.words * sizeof (uint32_t));
+        reverse_node_index.insert(pair<string, int>(nID, i));
+        nodeID_iLID.insert(pair<string, Bitvector *>(nID, ilid));
+        vertex_iLID.insert(pair<int, Bitvector *>(i, ilid));
+        igraph_cattribute_VAS_set(&graph, "NODEID", i, nID.c_str());
+        igraph_cattribute_VAS_set(&graph, "iLID", i, ilid->to_string().c_str());
+    }
+    for (uint32_t e = 0; e < h.edges; e++) {
+        vector<Bitvector> &table_LIDs = edge_table_LIDs[e];
+        string LIDs;
+        for (uint32_t t = 0; t < h.lid_tables; t++) {
+            table_LIDs.push_back(Bitvector(FID_LEN * 8));
+            memcpy(table_LIDs[t].data_words(), lids + ((uint64_t) e * h.lid_tables + t) * h.words, h.words * sizeof (uint32_t));
+            LIDs += (t == 0) ? table_LIDs[t].to_string() : ":" + table_LIDs[t].to_string();
+        }
+        Bitvector *lid = new Bitvector(table_LIDs[0]);
+        reverse_edge_index.insert(pair<string, int>(lid->to_string(), e));
+        edge_LID.insert(pair<int, Bitvector *>(e, lid));
+        igraph_cattribute_EAS_set(&graph, "LID", e, LIDs.c_str());
+    }
+    munmap(map, st.st_size);
+    number_of_nodes = h.nodes;
+    number_of_connections = h.edges;
+    cout << "TM: " << number_of_nodes << " nodes" << endl;
+    cout << "TM: " << number_of_connections << " edges" << endl;
+    precomputePaths();
+    return 0;
+}
+
+void TMIgraph::rebuildIndexes() {
+    Bitvector *lid;
+    Bitvector *ilid;
+    map<int, Bitvector *>::iterator vertex_iLID_iter;
+    map<int, Bitvector *>::iterator edge_LID_iter;
+    for (vertex_iLID_iter = vertex_iLID.begin(); vertex_iLID_iter != vertex_iLID.end(); vertex_iLID_iter++) {
+        delete (*vertex_iLID_iter).second;
+    }
+    for (edge_LID_iter = edge_LID.begin(); edge_LID_iter != edge_LID.end(); edge_LID_iter++) {
+        delete (*edge_LID_iter).second;
+    }
+    reverse_node_index.clear();
+    nodeID_iLID.clear();
+    vertex_iLID.clear();
+    reverse_edge_index.clear();
+    edge_LID.clear();
+    edge_table_LIDs.clear();
+    edge_weight.assign(igraph_ecount(&graph), 1);
     for (int i = 0; i < igraph_vcount(&graph); i++) {
         string nID = string(igraph_cattribute_VAS(&graph, "NODEID", i));
         string iLID = string(igraph_cattribute_VAS(&graph, "iLID", i));
@@ -84,68 +317,370 @@ int TMIgraph::readTopology(char *file_name) {
         //cout << "node " << i << " has ILID " << ilid->to_string() << endl;
     }
     for (int i = 0; i < igraph_ecount(&graph); i++) {
-        string LID = string(igraph_cattribute_EAS(&graph, "LID", i));
+        /*our proposal the attribute has the LIDs of all tables separated by ':'*/
+        string LIDs = string(igraph_cattribute_EAS(&graph, "LID", i));
+        string LID = LIDs.substr(0, LIDs.find(':'));
         reverse_edge_index.insert(pair<string, int>(LID, i));
         lid = new Bitvector(LID);
         edge_LID.insert(pair<int, Bitvector *>(i, lid));
+        map<string, double>::iterator weight_it = link_weight.find(LID);
+        if (weight_it != link_weight.end()) {
+            edge_weight[i] = (*weight_it).second;
+        }
+        vector<Bitvector> &table_LIDs = edge_table_LIDs[i];
+        size_t start = 0;
+        for (int t = 0; t < lid_tables; t++) {
+            if (start == string::npos) {
+                /*a link without a LID in this table (e.g. added by a topology update) uses the one of table 0*/
+                table_LIDs.push_back(*lid);
+                continue;
+            }
+            size_t end = LIDs.find(':', start);
+            string table_LID = LIDs.substr(start, (end == string::npos) ? string::npos : end - start);
+            table_LIDs.push_back(Bitvector(table_LID));
+            start = (end == string::npos) ? string::npos : end + 1;
+        }
         //cout << "edge " << i << " has LID  " << lid->to_string() << endl;
     }
-    return ret;
+    number_of_nodes = igraph_vcount(&graph);
+    number_of_connections = igraph_ecount(&graph);
 }
 
-Bitvector *TMIgraph::calculateFID(string &source, string &destination) {
-    int vertex_id;
-    Bitvector *result = new Bitvector(FID_LEN * 8);
+void TMIgraph::precomputePaths() {
+    set<int> sources;
+    int n = igraph_vcount(&graph);
+    invalidateFIDCache();
+    path_fid.assign(lid_tables * n * n, Bitvector(FID_LEN * 8));
+    path_hops.assign(n * n, 0);
+    path_cost.assign(n * n, 0);
+    path_pred.assign(n * n, -1);
+    for (int from = 0; from < n; from++) {
+        sources.insert(from);
+    }
+    updatePaths(sources);
+    cout << "TM: precomputed " << n * n << " paths" << endl;
+}
+
+void TMIgraph::updatePaths(set<int> &sources) {
     igraph_vs_t vs;
     igraph_vector_ptr_t res;
-    igraph_vector_t to_vector;
     igraph_vector_t *temp_v;
+    igraph_vector_t weights;
     igraph_integer_t eid;
-
-    /*find the vertex id in the reverse index*/
-    int from = (*reverse_node_index.find(source)).second;
-    igraph_vector_init(&to_vector, 1);
-    VECTOR(to_vector)[0] = (*reverse_node_index.find(destination)).second;
-    /*initialize the sequence*/
-    igraph_vs_vector(&vs, &to_vector);
-    /*initialize the vector that contains pointers*/
-    igraph_vector_ptr_init(&res, 1);
-    temp_v = (igraph_vector_t *) VECTOR(res)[0];
-    temp_v = (igraph_vector_t *) malloc(sizeof (igraph_vector_t));
-    VECTOR(res)[0] = temp_v;
-    igraph_vector_init(temp_v, 1);
-    /*run the shortest path algorithm from "from"*/
-    igraph_get_shortest_paths(&graph, &res, from, vs, IGRAPH_OUT);
-    /*check the shortest path to each destination*/
-    temp_v = (igraph_vector_t *) VECTOR(res)[0];
-    //click_chatter("Shortest path from %s to %s", igraph_cattribute_VAS(&graph, "NODEID", from), igraph_cattribute_VAS(&graph, "NODEID", VECTOR(*temp_v)[igraph_vector_size(temp_v) - 1]));
-    /*now let's "or" the FIDs for each link in the shortest path*/
-    for (int j = 0; j < igraph_vector_size(temp_v) - 1; j++) {
-        igraph_get_eid(&graph, &eid, VECTOR(*temp_v)[j], VECTOR(*temp_v)[j + 1], true);
-        //click_chatter("node %s -> node %s", igraph_cattribute_VAS(&graph, "NODEID", VECTOR(*temp_v)[j]), igraph_cattribute_VAS(&graph, "NODEID", VECTOR(*temp_v)[j + 1]));
-        //click_chatter("link: %s", igraph_cattribute_EAS(&graph, "LID", eid));
-        string LID(igraph_cattribute_EAS(&graph, "LID", eid), FID_LEN * 8);
-        for (int k = 0; k < FID_LEN * 8; k++) {
-            if (LID[k] == '1') {
-                (*result)[ FID_LEN * 8 - k - 1].operator |=(true);
+    set<int>::iterator sources_it;
+    int n = number_of_nodes;
+    igraph_vs_all(&vs);
+    /*our proposal the link weights, if the paths are load aware*/
+    igraph_vector_init(&weights, edge_weight.size());
+    for (int i = 0; i < (int) edge_weight.size(); i++) {
+        VECTOR(weights)[i] = edge_weight[i];
+    }
+    igraph_vector_ptr_init(&res, n);
+    for (int i = 0; i < n; i++) {
+        temp_v = (igraph_vector_t *) malloc(sizeof (igraph_vector_t));
+        igraph_vector_init(temp_v, 1);
+        VECTOR(res)[i] = temp_v;
+    }
+    for (sources_it = sources.begin(); sources_it != sources.end(); sources_it++) {
+        int from = *sources_it;
+        /*one shortest path tree per source*/
+        if (load_weight > 0) {
+            igraph_get_shortest_paths_dijkstra(&graph, &res, from, vs, &weights, IGRAPH_OUT);
+        } else {
+            igraph_get_shortest_paths(&graph, &res, from, vs, IGRAPH_OUT);
+        }
+        for (int to = 0; to < n; to++) {
+            for (int t = 0; t < lid_tables; t++) {
+                path_fid[pathIndex(t, from, to)].clear();
+            }
+            path_pred[from * n + to] = -1;
+            path_cost[from * n + to] = (from == to) ? 0 : HUGE_VAL;
+            temp_v = (igraph_vector_t *) VECTOR(res)[to];
+            /*"or" the LIDs of each link in the shortest path (in every table)*/
+            for (int j = 0; j < igraph_vector_size(temp_v) - 1; j++) {
+                igraph_get_eid(&graph, &eid, VECTOR(*temp_v)[j], VECTOR(*temp_v)[j + 1], true);
+                path_cost[from * n + to] = (j == 0) ? edge_weight[eid] : path_cost[from * n + to] + edge_weight[eid];
+                vector<Bitvector> &table_LIDs = edge_table_LIDs[eid];
+                for (int t = 0; t < lid_tables; t++) {
+                    path_fid[pathIndex(t, from, to)] |= table_LIDs[t];
+                }
+            }
+            /*and the internal link ID of the destination*/
+            for (int t = 0; t < lid_tables; t++) {
+                path_fid[pathIndex(t, from, to)] |= *(*vertex_iLID.find(to)).second;
+            }
+            path_hops[from * n + to] = igraph_vector_size(temp_v) - 1;
+            if (igraph_vector_size(temp_v) > 1) {
+                path_pred[from * n + to] = VECTOR(*temp_v)[igraph_vector_size(temp_v) - 2];
             }
         }
-        //click_chatter("FID of the shortest path: %s", result.to_string().c_str());
     }
-    /*now for all destinations "or" the internal linkID*/
-    vertex_id = (*reverse_node_index.find(destination)).second;
-    string iLID(igraph_cattribute_VAS(&graph, "iLID", vertex_id));
-    //click_chatter("internal link for node %s: %s", igraph_cattribute_VAS(&graph, "NODEID", vertex_id), iLID.c_str());
-    for (int k = 0; k < FID_LEN * 8; k++) {
-        if (iLID[k] == '1') {
-            (*result)[ FID_LEN * 8 - k - 1].operator |=(true);
-        }
+    for (int i = 0; i < n; i++) {
+        igraph_vector_destroy((igraph_vector_t *) VECTOR(res)[i]);
     }
-    igraph_vector_destroy((igraph_vector_t *) VECTOR(res)[0]);
-    igraph_vector_destroy(&to_vector);
     igraph_vector_ptr_destroy_all(&res);
+    igraph_vector_destroy(&weights);
     igraph_vs_destroy(&vs);
-    return result;
+}
+
+int TMIgraph::addLink(string &source, string &destination, Bitvector &lid, set<int> &affected) {
+    map<string, int>::iterator src_it = reverse_node_index.find(source);
+    map<string, int>::iterator dst_it = reverse_node_index.find(destination);
+    int n = number_of_nodes;
+    if ((src_it == reverse_node_index.end()) || (dst_it == reverse_node_index.end())) {
+        return -1;
+    }
+    int u = (*src_it).second;
+    int v = (*dst_it).second;
+    igraph_add_edge(&graph, u, v);
+    igraph_cattribute_EAS_set(&graph, "LID", igraph_ecount(&graph) - 1, lid.to_string().c_str());
+    rebuildIndexes();
+    /*only the sources that now reach the destination at a lower cost (in fewer hops) through the new link change their tree*/
+    for (int s = 0; s < n; s++) {
+        if (path_cost[s * n + u] + edge_weight[igraph_ecount(&graph) - 1] < path_cost[s * n + v]) {
+            affected.insert(s);
+        }
+    }
+    updatePaths(affected);
+    return 0;
+}
+
+int TMIgraph::removeLink(string &source, string &destination, set<int> &affected) {
+    map<string, int>::iterator src_it = reverse_node_index.find(source);
+    map<string, int>::iterator dst_it = reverse_node_index.find(destination);
+    igraph_integer_t eid;
+    int n = number_of_nodes;
+    if ((src_it == reverse_node_index.end()) || (dst_it == reverse_node_index.end())) {
+        return -1;
+    }
+    int u = (*src_it).second;
+    int v = (*dst_it).second;
+    if (igraph_get_eid(&graph, &eid, u, v, true) != 0) {
+        return -1;
+    }
+    /*the link is in the shortest path tree of a source iff it is the last hop towards its destination*/
+    for (int s = 0; s < n; s++) {
+        if (path_pred[s * n + v] == u) {
+            affected.insert(s);
+        }
+    }
+    /*a link added later may get the same LID*/
+    link_rate.erase((*edge_LID[eid]).to_string());
+    link_weight.erase((*edge_LID[eid]).to_string());
+    igraph_delete_edges(&graph, igraph_ess_1(eid));
+    /*edge ids are renumbered*/
+    rebuildIndexes();
+    updatePaths(affected);
+    return 0;
+}
+
+int TMIgraph::addNode(string &label, Bitvector &ilid) {
+    if (reverse_node_index.find(label) != reverse_node_index.end()) {
+        return -1;
+    }
+    igraph_add_vertices(&graph, 1, 0);
+    igraph_cattribute_VAS_set(&graph, "NODEID", igraph_vcount(&graph) - 1, label.c_str());
+    igraph_cattribute_VAS_set(&graph, "iLID", igraph_vcount(&graph) - 1, ilid.to_string().c_str());
+    rebuildIndexes();
+    /*the path tables are indexed by the number of nodes*/
+    precomputePaths();
+    return 0;
+}
+
+int TMIgraph::removeNode(string &label) {
+    map<string, int>::iterator node_it = reverse_node_index.find(label);
+    if (node_it == reverse_node_index.end()) {
+        return -1;
+    }
+    /*vertex (and edge) ids are renumbered*/
+    igraph_delete_vertices(&graph, igraph_vss_1((*node_it).second));
+    rebuildIndexes();
+    precomputePaths();
+    return 0;
+}
+
+int TMIgraph::updateLinkLoad(string &node, unsigned int interval, vector<pair<Bitvector, unsigned long long> > &loads, set<int> &affected) {
+    map<string, int>::iterator node_it = reverse_node_index.find(node);
+    int n = number_of_nodes;
+    int changed = 0;
+    if (node_it == reverse_node_index.end()) {
+        return -1;
+    }
+    if ((load_weight <= 0) || (interval == 0)) {
+        return 0;
+    }
+    for (int i = 0; i < (int) loads.size(); i++) {
+        string LID = loads[i].first.to_string();
+        map<string, int>::iterator edge_it = reverse_edge_index.find(LID);
+        igraph_integer_t u, v;
+        if (edge_it == reverse_edge_index.end()) {
+            continue;
+        }
+        int eid = (*edge_it).second;
+        igraph_edge(&graph, eid, &u, &v);
+        if (u != (*node_it).second) {
+            /*not a link of this node (LIDs are not necessarily unique)*/
+            continue;
+        }
+        double rate = loads[i].second * 1000.0 / interval;
+        map<string, double>::iterator rate_it = link_rate.find(LID);
+        if (rate_it == link_rate.end()) {
+            link_rate[LID] = rate;
+        } else {
+            (*rate_it).second = LINK_LOAD_EWMA * rate + (1 - LINK_LOAD_EWMA) * (*rate_it).second;
+            rate = (*rate_it).second;
+        }
+        double weight = 1 + load_weight * ((rate < link_capacity) ? rate / link_capacity : 1);
+        if (fabs(weight - edge_weight[eid]) <= load_hysteresis) {
+            continue;
+        }
+        /*a heavier link changes the trees that use it, a lighter one those that now reach its end at a lower cost through it*/
+        for (int s = 0; s < n; s++) {
+            if (weight > edge_weight[eid]) {
+                if (path_pred[s * n + v] == u) {
+                    affected.insert(s);
+                }
+            } else if (path_cost[s * n + u] + weight < path_cost[s * n + v]) {
+                affected.insert(s);
+            }
+        }
+        edge_weight[eid] = weight;
+        link_weight[LID] = weight;
+        changed++;
+    }
+    if (!affected.empty()) {
+        updatePaths(affected);
+    }
+    return changed;
+}
+
+void TMIgraph::steinerFID(int publisher, set<int> &subscribers, Bitvector &resultFID, int table) {
+    set<int> tree;
+    set<int> remaining = subscribers;
+    set<int>::iterator tree_it;
+    set<int>::iterator remaining_it;
+    int n = number_of_nodes;
+    tree.insert(publisher);
+    while (!remaining.empty()) {
+        /*find the subscriber that is closest to any vertex of the tree (the fewest hops, or the lowest cost with load aware paths)*/
+        double minimumCost = HUGE_VAL;
+        int bestFrom = -1;
+        int bestTo = -1;
+        for (remaining_it = remaining.begin(); remaining_it != remaining.end(); remaining_it++) {
+            for (tree_it = tree.begin(); tree_it != tree.end(); tree_it++) {
+                if (path_cost[(*tree_it) * n + (*remaining_it)] < minimumCost) {
+                    minimumCost = path_cost[(*tree_it) * n + (*remaining_it)];
+                    bestFrom = *tree_it;
+                    bestTo = *remaining_it;
+                }
+            }
+        }
+        if (bestFrom < 0) {
+            /*the rest are unreachable - they get the iLID only, as with shortest paths*/
+            for (remaining_it = remaining.begin(); remaining_it != remaining.end(); remaining_it++) {
+                resultFID = resultFID | *(*vertex_iLID.find(*remaining_it)).second;
+            }
+            break;
+        }
+        /*attach it: the path FID has the links and the iLID of the subscriber, and all vertices of the path join the tree*/
+        resultFID = resultFID | path_fid[pathIndex(table, bestFrom, bestTo)];
+        for (int v = bestTo; v != bestFrom && v >= 0; v = path_pred[bestFrom * n + v]) {
+            tree.insert(v);
+        }
+        remaining.erase(bestTo);
+    }
+}
+
+int TMIgraph::lidTableBits() {
+    int bits = 0;
+    while ((1 << bits) < lid_tables) {
+        bits++;
+    }
+    return bits;
+}
+
+void TMIgraph::encodeLIDTable(Bitvector &fid, int table) {
+    int bits = lidTableBits();
+    for (int b = 0; b < bits; b++) {
+        fid[fid.size() - bits + b] = (((table >> b) & 1) != 0);
+    }
+}
+
+double TMIgraph::fillFactor(Bitvector &fid) {
+    int set_bits = 0;
+    for (int i = 0; i < fid.size(); i++) {
+        if (fid[i]) {
+            set_bits++;
+        }
+    }
+    return (fid.size() == 0) ? 0 : (double) set_bits / fid.size();
+}
+
+void TMIgraph::invalidateFIDCache(set<int> &sources) {
+    map<string, FIDCacheEntry>::iterator cache_it;
+    map<string, Bitvector *>::iterator result_it;
+    map<string, map<string, Bitvector *> >::iterator opresult_it;
+    if (sources.empty()) {
+        return;
+    }
+    if (fid_mode.compare("steiner") == 0) {
+        /*a tree also uses the paths of the vertices it goes through*/
+        invalidateFIDCache();
+        return;
+    }
+    cache_it = fid_cache.begin();
+    while (cache_it != fid_cache.end()) {
+        /*the key starts with the publisher labels*/
+        bool affected = false;
+        size_t end = (*cache_it).first.find('|');
+        for (size_t i = 0; i + PURSUIT_ID_LEN <= end; i += PURSUIT_ID_LEN) {
+            map<string, int>::iterator node_it = reverse_node_index.find((*cache_it).first.substr(i, PURSUIT_ID_LEN));
+            if ((node_it == reverse_node_index.end()) || (sources.find((*node_it).second) != sources.end())) {
+                affected = true;
+                break;
+            }
+        }
+        if (!affected) {
+            cache_it++;
+            continue;
+        }
+        for (result_it = (*cache_it).second.result.begin(); result_it != (*cache_it).second.result.end(); result_it++) {
+            delete (*result_it).second;
+        }
+        for (opresult_it = (*cache_it).second.opresult.begin(); opresult_it != (*cache_it).second.opresult.end(); opresult_it++) {
+            for (result_it = (*opresult_it).second.begin(); result_it != (*opresult_it).second.end(); result_it++) {
+                delete (*result_it).second;
+            }
+        }
+        fid_cache.erase(cache_it++);
+    }
+}
+
+void TMIgraph::invalidateFIDCache() {
+    map<string, FIDCacheEntry>::iterator cache_it;
+    map<string, Bitvector *>::iterator result_it;
+    map<string, map<string, Bitvector *> >::iterator opresult_it;
+    for (cache_it = fid_cache.begin(); cache_it != fid_cache.end(); cache_it++) {
+        for (result_it = (*cache_it).second.result.begin(); result_it != (*cache_it).second.result.end(); result_it++) {
+            delete (*result_it).second;
+        }
+        for (opresult_it = (*cache_it).second.opresult.begin(); opresult_it != (*cache_it).second.opresult.end(); opresult_it++) {
+            for (result_it = (*opresult_it).second.begin(); result_it != (*opresult_it).second.end(); result_it++) {
+                delete (*result_it).second;
+            }
+        }
+    }
+    fid_cache.clear();
+}
+
+Bitvector *TMIgraph::calculateFID(string &source, string &destination) {
+    map<string, int>::iterator from_it = reverse_node_index.find(source);
+    map<string, int>::iterator to_it = reverse_node_index.find(destination);
+    if ((from_it == reverse_node_index.end()) || (to_it == reverse_node_index.end())) {
+        /*an unknown node: there is no path to it*/
+        return new Bitvector(FID_LEN * 8);
+    }
+    return new Bitvector(path_fid[(*from_it).second * number_of_nodes + (*to_it).second]);
 }
 
 void TMIgraph::calculateFID(set<string> &publishers, set<string> &subscribers,\
@@ -190,6 +725,36 @@ void TMIgraph::calculateFID(set<string> &publishers, set<string> &subscribers,\
     Bitvector resultFID(FID_LEN*8) ;
     Bitvector bestFID(FID_LEN * 8);
     unsigned int numberOfHops = 0;
+    map<string, FIDCacheEntry>::iterator cache_it;
+    map<string, Bitvector *>::iterator result_it;
+    map<string, map<string, Bitvector *> >::iterator opresult_it;
+    /*the subscribers (vertex ids) served by each publisher*/
+    map<string, set<int> > assigned;
+    /*the sets are ordered, so the concatenated labels identify the request*/
+    string key;
+    for(publishers_it = publishers.begin() ; publishers_it != publishers.end() ; publishers_it++)
+        key += *publishers_it;
+    key += '|';
+    for(subscribers_it = subscribers.begin() ; subscribers_it != subscribers.end() ; subscribers_it++)
+        key += *subscribers_it;
+    pthread_mutex_lock(&fid_cache_mutex);
+    cache_it = fid_cache.find(key);
+    if (cache_it != fid_cache.end()) {
+        /*the caller owns (and deletes) the returned FIDs: hand out copies*/
+        fid_cache_hits++;
+        for (result_it = (*cache_it).second.result.begin(); result_it != (*cache_it).second.result.end(); result_it++) {
+            result[(*result_it).first] = ((*result_it).second == NULL) ? NULL : new Bitvector(*(*result_it).second);
+        }
+        for (opresult_it = (*cache_it).second.opresult.begin(); opresult_it != (*cache_it).second.opresult.end(); opresult_it++) {
+            for (map<string, Bitvector *>::iterator it = (*opresult_it).second.begin(); it != (*opresult_it).second.end(); it++) {
+                opresult[(*opresult_it).first][(*it).first] = ((*it).second == NULL) ? NULL : new Bitvector(*(*it).second);
+            }
+        }
+        pthread_mutex_unlock(&fid_cache_mutex);
+        return;
+    }
+    fid_cache_misses++;
+    pthread_mutex_unlock(&fid_cache_mutex);
 
     //first add all publishers to the hashtable with NULL FID
     for(publishers_it = publishers.begin() ; publishers_it != publishers.end() ; publishers_it++)
@@ -205,6 +770,7 @@ void TMIgraph::calculateFID(set<string> &publishers, set<string> &subscribers,\
     {
         /*for all subscribers calculate the number of hops from all publishers (not very optimized...don't you think?)*/
         unsigned int minimumNumberOfHops = UINT_MAX;
+        bestPublisher.clear();
         for(publishers_it = publishers.begin() ; publishers_it != publishers.end() ; publishers_it++)
         {
             resultFID.clear();
@@ -220,6 +786,10 @@ void TMIgraph::calculateFID(set<string> &publishers, set<string> &subscribers,\
                 bestFID = resultFID;
             }
         }
+        if (bestPublisher.empty()) {
+            /*the subscriber is unknown (or no publisher is): no publisher serves it*/
+            continue;
+        }
         if ((*result.find(bestPublisher)).second == NULL) {
             //add the publisher to the result
             //cout << "FID1: " << bestFID.to_string() << endl;
@@ -230,50 +800,75 @@ void TMIgraph::calculateFID(set<string> &publishers, set<string> &subscribers,\
             /*or the result FID*/
             *existingFID = *existingFID | bestFID;
         }
+        assigned[bestPublisher].insert((*reverse_node_index.find(*subscribers_it)).second);
+    }
+    if ((fid_mode.compare("steiner") == 0) || (lid_tables > 1)) {
+        /*our proposal rebuild the FID of each publisher over the subscribers it serves: as a tree in steiner mode and in the LID table that gives the lowest fill*/
+        for (map<string, set<int> >::iterator assigned_it = assigned.begin(); assigned_it != assigned.end(); assigned_it++) {
+            int publisher = (*reverse_node_index.find((*assigned_it).first)).second;
+            Bitvector bestTableFID(FID_LEN * 8);
+            double bestFill = 2;
+            int bestTable = 0;
+            for (int t = 0; t < lid_tables; t++) {
+                Bitvector tableFID(FID_LEN * 8);
+                if (fid_mode.compare("steiner") == 0) {
+                    steinerFID(publisher, (*assigned_it).second, tableFID, t);
+                } else {
+                    for (set<int>::iterator sub_it = (*assigned_it).second.begin(); sub_it != (*assigned_it).second.end(); sub_it++) {
+                        tableFID |= path_fid[pathIndex(t, publisher, *sub_it)];
+                    }
+                }
+                if (fillFactor(tableFID) < bestFill) {
+                    bestFill = fillFactor(tableFID);
+                    bestTableFID = tableFID;
+                    bestTable = t;
+                }
+            }
+            encodeLIDTable(bestTableFID, bestTable);
+            cout << "TM: publisher " << (*assigned_it).first << " shortest paths fill factor " << fillFactor(*result[(*assigned_it).first])\
+                 << ", " << fid_mode << " fill factor " << bestFill << " (LID table " << bestTable << ")" << endl;
+            *result[(*assigned_it).first] = bestTableFID;
+        }
+    }
+    for (result_it = result.begin(); result_it != result.end(); result_it++) {
+        if (((*result_it).second != NULL) && (fillFactor(*(*result_it).second) > FID_FILL_WARN)) {
+            cout << "TM: the FID of publisher " << (*result_it).first << " has fill factor " << fillFactor(*(*result_it).second)\
+                 << " - expect false positives" << endl;
+        }
+    }
+    /*memoize a copy of the result*/
+    pthread_mutex_lock(&fid_cache_mutex);
+    if (fid_cache.size() >= FID_CACHE_MAX) {
+        invalidateFIDCache();
+    }
+    /*another worker may have computed the same request meanwhile*/
+    if (fid_cache.find(key) == fid_cache.end()) {
+        FIDCacheEntry &entry = fid_cache[key];
+        for (result_it = result.begin(); result_it != result.end(); result_it++) {
+            entry.result[(*result_it).first] = ((*result_it).second == NULL) ? NULL : new Bitvector(*(*result_it).second);
+        }
+        for (opresult_it = opresult.begin(); opresult_it != opresult.end(); opresult_it++) {
+            for (map<string, Bitvector *>::iterator it = (*opresult_it).second.begin(); it != (*opresult_it).second.end(); it++) {
+                entry.opresult[(*opresult_it).first][(*it).first] = ((*it).second == NULL) ? NULL : new Bitvector(*(*it).second);
+            }
+        }
     }
+    pthread_mutex_unlock(&fid_cache_mutex);
 }
 
 void TMIgraph::calculateFID(string &source, string &destination, Bitvector &resultFID, unsigned int &numberOfHops) {
-    int vertex_id;
-    igraph_vs_t vs;
-    igraph_vector_ptr_t res;
-    igraph_vector_t to_vector;
-    igraph_vector_t *temp_v;
-    igraph_integer_t eid;
-
-    /*find the vertex id in the reverse index*/
-    int from = (*reverse_node_index.find(source)).second;
-    igraph_vector_init(&to_vector, 1);
-    VECTOR(to_vector)[0] = (*reverse_node_index.find(destination)).second;
-    /*initialize the sequence*/
-    igraph_vs_vector(&vs, &to_vector);
-    /*initialize the vector that contains pointers*/
-    igraph_vector_ptr_init(&res, 1);
-    temp_v = (igraph_vector_t *) VECTOR(res)[0];
-    temp_v = (igraph_vector_t *) malloc(sizeof (igraph_vector_t));
-    VECTOR(res)[0] = temp_v;
-    igraph_vector_init(temp_v, 1);
-    /*run the shortest path algorithm from "from"*/
-    igraph_get_shortest_paths(&graph, &res, from, vs, IGRAPH_OUT);
-    /*check the shortest path to each destination*/
-    temp_v = (igraph_vector_t *) VECTOR(res)[0];
-
-    /*now let's "or" the FIDs for each link in the shortest path*/
-    for (int j = 0; j < igraph_vector_size(temp_v) - 1; j++) {
-        igraph_get_eid(&graph, &eid, VECTOR(*temp_v)[j], VECTOR(*temp_v)[j + 1], true);
-        Bitvector *lid = (*edge_LID.find(eid)).second;
-        (resultFID) = (resultFID) | (*lid);
-    }
-    numberOfHops = igraph_vector_size(temp_v)-1;
-
-    /*now for the destination "or" the internal linkID*/
-    Bitvector *ilid = (*nodeID_iLID.find(destination)).second;
-    (resultFID) = (resultFID) | (*ilid);
-    //cout << "FID of the shortest path: " << resultFID.to_string() << endl;
-    igraph_vector_destroy((igraph_vector_t *) VECTOR(res)[0]);
-    igraph_vector_destroy(&to_vector);
-    igraph_vector_ptr_destroy_all(&res);
-    igraph_vs_destroy(&vs);
+    /*the path (and the iLID of the destination) is looked up in the shortest path trees computed at topology load*/
+    map<string, int>::iterator from_it = reverse_node_index.find(source);
+    map<string, int>::iterator to_it = reverse_node_index.find(destination);
+    if ((from_it == reverse_node_index.end()) || (to_it == reverse_node_index.end())) {
+        /*an unknown node is never the closest one*/
+        numberOfHops = UINT_MAX;
+        return;
+    }
+    int from = (*from_it).second;
+    int to = (*to_it).second;
+    resultFID = resultFID | path_fid[from * number_of_nodes + to];
+    numberOfHops = path_hops[from * number_of_nodes + to];
 }
 
 void TMIgraph::calculateFID(string &source, set<string> &dest, Bitvector &result, string &bestnode) {
@@ -20,17 +20,42 @@
 #include <string>
 #include <igraph/igraph.h>
 #include <climits>
+#include <cmath>
 #include <stdlib.h>
 #include <iostream>
 #include <fstream>
 #include <utility>
+#include <vector>
+#include <pthread.h>
 
+#include "blackadder_defs.h"
 #include "bitvector.hpp"
+#include "tm_topology.hpp"
 
 using namespace std;
 
 #define _OUR_PROPOSAL 1
 
+/*our proposal above this fraction of set bits a multicast FID is reported as prone to false positives*/
+#define FID_FILL_WARN 0.5
+
+/*our proposal the maximum number of (publishers, subscribers) -> FID results kept by the TM (the cache is emptied when it is full)*/
+#define FID_CACHE_MAX 4096
+
+/*our proposal the weight of a new load report in the moving average of the rate of a link*/
+#define LINK_LOAD_EWMA 0.5
+
+/*our proposal the defaults of the graph attributes TM_LINK_CAPACITY (bytes per second) and TM_LOAD_HYSTERESIS*/
+#define LINK_CAPACITY_DEFAULT 125000000.0
+#define LOAD_HYSTERESIS_DEFAULT 0.25
+
+/**@brief (Topology Manager) our proposal a memoized result of the rendezvous calculateFID: the FID of each publisher (may be NULL) and of each publisher-subscriber pair. All pointers are owned by the entry.
+ */
+struct FIDCacheEntry {
+    map<string, Bitvector *> result;
+    map<string, map<string, Bitvector *> > opresult;
+};
+
 /**@brief (Topology Manager) This is a representation of the network topology (using the iGraph library) for the Topology Manager.
  */
 class TMIgraph {
@@ -50,6 +75,97 @@ public:
      * @return <0 if there was a problem reading the file
      */
     int readTopology(char *name);
+    /**@brief our proposal reads a compact binary topology (topology.tmb, see tm_topology.hpp), which readTopology recognises by its first word.
+     *
+     * The file is mapped and the graph, its attributes and the label, iLID and LID indexes are built straight from the CSR adjacency and the packed identifiers,
+     * without parsing any XML or '0'/'1' strings.
+     *
+     * @param name the file name
+     * @return <0 if the file is not a valid binary topology for this TM
+     */
+    int readBinaryTopology(char *name);
+    /**@brief our proposal checks the graph attributes read by readTopology or readBinaryTopology (and defaults TM_FID_MODE).
+     *
+     * @return <0 if they cannot be used
+     */
+    int checkSettings();
+    /**@brief our proposal computes the shortest-path tree of every source once (at topology load) and keeps, for each (source, destination), the FID of the path (link LIDs ORed with the iLID of the destination) and its number of hops.
+     *
+     * All other calculateFID methods then only look these up, instead of running igraph_get_shortest_paths per request.
+     */
+    void precomputePaths();
+    /**@brief our proposal (re)builds the label, iLID and LID indexes from the vertex and edge attributes of the graph - igraph renumbers ids when vertices or edges are deleted.
+     */
+    void rebuildIndexes();
+    /**@brief our proposal recomputes the shortest-path tree (path_fid, path_hops, path_pred) of the given sources only.
+     */
+    void updatePaths(set<int> &sources);
+    /**@brief our proposal adds the (directed) link source->destination with the given LID and recomputes the trees of the sources it shortens.
+     *
+     * @param affected the igraph vertex ids of the sources whose paths changed are added here.
+     * @return <0 if a node is unknown
+     */
+    int addLink(string &source, string &destination, Bitvector &lid, set<int> &affected);
+    /**@brief our proposal removes the (directed) link source->destination and recomputes the trees of the sources that used it.
+     *
+     * @param affected the igraph vertex ids of the sources whose paths changed are added here.
+     * @return <0 if there is no such link
+     */
+    int removeLink(string &source, string &destination, set<int> &affected);
+    /**@brief our proposal adds an (unconnected) node. All paths are recomputed, since the path tables are sized by the number of nodes.
+     *
+     * @return <0 if the node exists
+     */
+    int addNode(string &label, Bitvector &ilid);
+    /**@brief our proposal removes a node and its links. All paths are recomputed, since igraph renumbers the remaining vertices.
+     *
+     * @return <0 if the node is unknown
+     */
+    int removeNode(string &label);
+    /**@brief our proposal applies a load report of node: the bytes it sent over each of its links (by LID) in the last interval milliseconds.
+     *
+     * The rate of every link is a moving average (LINK_LOAD_EWMA) and its weight is 1 + load_weight * utilization, the utilization being the rate over link_capacity (at most 1).
+     * A weight is only changed, and the trees that it changes recomputed, when it moved by more than load_hysteresis since it was last changed, so that paths do not flap between links of similar load.
+     *
+     * @param affected the igraph vertex ids of the sources whose paths changed are added here.
+     * @return the number of links whose weight changed, or <0 if the node is unknown
+     */
+    int updateLinkLoad(string &node, unsigned int interval, vector<pair<Bitvector, unsigned long long> > &loads, set<int> &affected);
+    /**@brief our proposal builds the FID of an approximate Steiner tree rooted at publisher that reaches all subscribers.
+     *
+     * Takahashi-Matsuyama: starting from the publisher, the subscriber closest to the tree is repeatedly attached through its shortest path from the nearest tree vertex,
+     * and every vertex of that path joins the tree. Used for the publisher FIDs of the rendezvous when fid_mode is "steiner".
+     *
+     * @param publisher the igraph vertex id of the root.
+     * @param subscribers the igraph vertex ids the tree must reach.
+     * @param resultFID the tree links and the iLIDs of the subscribers are ORed here.
+     * @param table the LID table of the links.
+     */
+    void steinerFID(int publisher, set<int> &subscribers, Bitvector &resultFID, int table = 0);
+    /**@brief our proposal the number of top FID bits that carry the LID table index (log2(lid_tables)).
+     */
+    int lidTableBits();
+    /**@brief our proposal writes the LID table index in the top bits of fid, so that Forwarders match it against that table.
+     */
+    void encodeLIDTable(Bitvector &fid, int table);
+    /**@brief our proposal the index in path_fid of the path from vertex from to vertex to in LID table table.
+     */
+    inline int pathIndex(int table, int from, int to) {
+        return (table * number_of_nodes + from) * number_of_nodes + to;
+    }
+    /**@brief our proposal the fraction of bits of a FID that are set (the false positive exposure of the FID).
+     */
+    double fillFactor(Bitvector &fid);
+    /**@brief our proposal drops all memoized rendezvous results - it must be called whenever the topology changes.
+     *
+     * The caller must hold fid_cache_mutex when request workers are running.
+     */
+    void invalidateFIDCache();
+    /**@brief our proposal drops the memoized rendezvous results that depend on the paths of the given sources (igraph vertex ids).
+     *
+     * The same locking rule as invalidateFIDCache() applies.
+     */
+    void invalidateFIDCache(set<int> &sources);
     /**@brief it calculates a LIPSIN identifier from source to destination using the shortest path.
      *
      * @param source the node label of the source node.
@@ -110,6 +226,56 @@ public:
     /**@brief mode in which this Blackadder node runs - the TM must create the appropriate netlink socket.
      */
     string mode;
+    /**@brief our proposal the FID of the shortest path from vertex i to vertex j in each LID table (at pathIndex(table, i, j); table 0 is at i * number_of_nodes + j), see precomputePaths().
+     */
+    vector<Bitvector> path_fid;
+    /**@brief our proposal the number of LID tables (graph attribute LID_TABLES): every link has one LID per table and the rendezvous picks, per publisher, the table that gives the sparsest FID.
+     */
+    int lid_tables;
+    /**@brief our proposal the LIDs of each igraph edge id in every LID table (edge_LID is the one of table 0).
+     */
+    map<int, vector<Bitvector> > edge_table_LIDs;
+    /**@brief our proposal the number of hops of the shortest path from vertex i to vertex j (at i * number_of_nodes + j).
+     */
+    vector<unsigned int> path_hops;
+    /**@brief our proposal the sum of the link weights of the path from vertex i to vertex j (at i * number_of_nodes + j), HUGE_VAL if there is none - the number of hops if the paths are not load aware.
+     */
+    vector<double> path_cost;
+    /**@brief our proposal how much a fully utilized link costs on top of its hop (graph attribute TM_LOAD_WEIGHT, 0 - the default - ignores the load reports and uses the fewest hops).
+     */
+    double load_weight;
+    /**@brief our proposal the rate (bytes per second) at which a link is fully utilized (graph attribute TM_LINK_CAPACITY).
+     */
+    double link_capacity;
+    /**@brief our proposal the change of weight below which a link keeps its weight (graph attribute TM_LOAD_HYSTERESIS).
+     */
+    double load_hysteresis;
+    /**@brief our proposal the moving average rate and the weight of the links, by their LID in table 0 (which, unlike the igraph edge id, does not change when the topology does).
+     */
+    map<string, double> link_rate;
+    map<string, double> link_weight;
+    /**@brief our proposal the weight of each igraph edge id, from link_weight (1 for a link without reports).
+     */
+    vector<double> edge_weight;
+    /**@brief our proposal the vertex preceding j on the shortest path from vertex i to vertex j (at i * number_of_nodes + j), -1 if there is none.
+     */
+    vector<int> path_pred;
+    /**@brief our proposal how the publisher FIDs of the rendezvous are built (graph attribute TM_FID_MODE): "shortest_path" ORs the shortest path to each subscriber, "steiner" uses steinerFID().
+     */
+    string fid_mode;
+    /**@brief our proposal the memoized rendezvous results, keyed by the concatenated labels of the publishers and the subscribers.
+     */
+    map<string, FIDCacheEntry> fid_cache;
+    /**@brief our proposal the number of rendezvous served from fid_cache and computed, respectively.
+     */
+    unsigned long fid_cache_hits;
+    unsigned long fid_cache_misses;
+    /**@brief our proposal fid_cache is the only state the request workers of the TM write. Everything else only changes under topology_lock.
+     */
+    pthread_mutex_t fid_cache_mutex;
+    /**@brief our proposal held for reading while a request is handled and for writing while the topology is updated.
+     */
+    pthread_rwlock_t topology_lock;
 };
 
 #endif
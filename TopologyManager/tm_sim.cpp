@@ -0,0 +1,458 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/*our proposal an offline simulator of the overhead of flooding, TTL-limited flooding and rendezvous on the topology of the TM.
+ *It replays a trace of publications and subscriptions (see usage()) and prints, per mode, the messages and bytes sent, the answers and
+ *the distance (in hops) from the subscriber to the node that answered it (the publisher or an on-path cache).
+ *The trace is split in shards by information item, which are simulated in parallel: items never share state, except the caches,
+ *whose capacity is then split evenly among the shards*/
+
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <sstream>
+#include <list>
+#include <deque>
+
+#include "tm_igraph.hpp"
+
+using namespace std;
+
+/*our proposal the bytes of a control message (a subscription, an advertisement or a rendezvous message), also the header of a data message*/
+#define SIM_CONTROL_BYTES 64
+
+enum {SIM_FLOOD, SIM_TTL, SIM_RV, SIM_MODES};
+
+const char *mode_names[SIM_MODES] = {"flood", "ttl", "rv"};
+
+/*our proposal one line of the trace*/
+struct SimEvent {
+    bool publish;
+    int node;
+    string item;
+    unsigned int bytes;
+};
+
+/*our proposal what a mode cost over (a shard of) the trace*/
+struct SimStats {
+    unsigned long requests;
+    unsigned long messages;
+    unsigned long long control_bytes;
+    unsigned long long data_bytes;
+    /*answers after the first one (flooding reaches every holder of the item)*/
+    unsigned long duplicate_answers;
+    /*requests whose closest answer came from a cache*/
+    unsigned long cache_hits;
+    /*requests nobody answered*/
+    unsigned long unresolved;
+    /*TTL-limited floods that found nothing and went to the rendezvous*/
+    unsigned long fallbacks;
+    /*the bytes sent over each igraph edge id*/
+    vector<unsigned long long> link_bytes;
+    /*hops from the subscriber to its closest answer -> requests*/
+    map<unsigned int, unsigned long> hit_distance;
+
+    SimStats() : requests(0), messages(0), control_bytes(0), data_bytes(0), duplicate_answers(0), cache_hits(0), unresolved(0), fallbacks(0) {
+    }
+
+    void merge(SimStats &other) {
+        requests += other.requests;
+        messages += other.messages;
+        control_bytes += other.control_bytes;
+        data_bytes += other.data_bytes;
+        duplicate_answers += other.duplicate_answers;
+        cache_hits += other.cache_hits;
+        unresolved += other.unresolved;
+        fallbacks += other.fallbacks;
+        if (link_bytes.size() < other.link_bytes.size()) {
+            link_bytes.resize(other.link_bytes.size(), 0);
+        }
+        for (size_t i = 0; i < other.link_bytes.size(); i++) {
+            link_bytes[i] += other.link_bytes[i];
+        }
+        for (map<unsigned int, unsigned long>::iterator it = other.hit_distance.begin(); it != other.hit_distance.end(); it++) {
+            hit_distance[(*it).first] += (*it).second;
+        }
+    }
+};
+
+/*our proposal the LRU cache of information items of a node (capacity in items, <0 is unlimited)*/
+struct SimCache {
+    list<string> lru;
+    map<string, list<string>::iterator> items;
+
+    bool contains(const string &item) {
+        return items.find(item) != items.end();
+    }
+
+    void touch(const string &item, long capacity) {
+        map<string, list<string>::iterator>::iterator it = items.find(item);
+        if (it != items.end()) {
+            lru.erase((*it).second);
+        } else if (capacity == 0) {
+            return;
+        } else if ((capacity > 0) && ((long) items.size() >= capacity)) {
+            items.erase(lru.back());
+            lru.pop_back();
+        }
+        lru.push_front(item);
+        items[item] = lru.begin();
+    }
+};
+
+/*our proposal a shard of the trace and, once simulated, its results*/
+struct SimShard {
+    pthread_t thread;
+    vector<SimEvent> events;
+    SimStats stats[SIM_MODES];
+};
+
+TMIgraph tm_igraph;
+/*the igraph edge id of every (source, destination) vertex pair*/
+map<pair<int, int>, int> edge_ids;
+vector<string> vertex_labels;
+bool modes[SIM_MODES] = {true, true, true};
+unsigned int ttl = 2;
+long cache_capacity = -1;
+unsigned int control_bytes = SIM_CONTROL_BYTES;
+int rv_node = -1;
+int tm_node = -1;
+int no_shards = 1;
+
+/*accounts bytes over the link from -> to, returns false if there is none*/
+static bool sendOverLink(SimStats &stats, int from, int to, unsigned long long bytes, bool control) {
+    map<pair<int, int>, int>::iterator it = edge_ids.find(make_pair(from, to));
+    if (it == edge_ids.end()) {
+        return false;
+    }
+    stats.messages++;
+    if (control) {
+        stats.control_bytes += bytes;
+    } else {
+        stats.data_bytes += bytes;
+    }
+    stats.link_bytes[(*it).second] += bytes;
+    return true;
+}
+
+/*accounts bytes over every link of the shortest path from -> to, returns false if to is unreachable*/
+static bool sendOverPath(SimStats &stats, int from, int to, unsigned long long bytes, bool control) {
+    int n = tm_igraph.number_of_nodes;
+    int current = to;
+    if (from == to) {
+        return true;
+    }
+    if (tm_igraph.path_pred[from * n + to] < 0) {
+        return false;
+    }
+    while (current != from) {
+        int pred = tm_igraph.path_pred[from * n + current];
+        sendOverLink(stats, pred, current, bytes, control);
+        current = pred;
+    }
+    return true;
+}
+
+/*the rendezvous of a subscription: subscriber -> RV -> TM -> the publisher closest to the subscriber, which sends the data along the shortest path*/
+static void rendezvous(SimStats &stats, const SimEvent &ev, set<int> &publishers, unsigned int bytes) {
+    int n = tm_igraph.number_of_nodes;
+    int best = -1;
+    sendOverPath(stats, ev.node, rv_node, control_bytes, true);
+    for (set<int>::iterator it = publishers.begin(); it != publishers.end(); it++) {
+        if ((tm_igraph.path_pred[*it * n + ev.node] >= 0 || *it == ev.node) &&
+                (best < 0 || tm_igraph.path_hops[*it * n + ev.node] < tm_igraph.path_hops[best * n + ev.node])) {
+            best = *it;
+        }
+    }
+    if (best < 0) {
+        stats.unresolved++;
+        return;
+    }
+    sendOverPath(stats, rv_node, tm_node, control_bytes, true);
+    sendOverPath(stats, tm_node, best, control_bytes, true);
+    sendOverPath(stats, best, ev.node, control_bytes + bytes, false);
+    stats.hit_distance[tm_igraph.path_hops[best * n + ev.node]]++;
+}
+
+/*a flooded subscription: every node forwards it once, to all its links but the one it came from, unless it holds the item (it answers instead)
+ *or it is max_depth hops away. Every holder reached answers along the reverse path of the flood and the nodes on that path cache the item.
+ *Returns false if nobody answered*/
+static bool flood(SimStats &stats, const SimEvent &ev, set<int> &publishers, vector<SimCache> &caches, long capacity, unsigned int bytes, unsigned int max_depth) {
+    int n = tm_igraph.number_of_nodes;
+    vector<int> parent(n, -2);
+    vector<unsigned int> depth(n, 0);
+    deque<int> queue;
+    vector<int> holders;
+    parent[ev.node] = -1;
+    queue.push_back(ev.node);
+    while (!queue.empty()) {
+        int u = queue.front();
+        queue.pop_front();
+        if (publishers.find(u) != publishers.end() || caches[u].contains(ev.item)) {
+            holders.push_back(u);
+            continue;
+        }
+        if (depth[u] >= max_depth) {
+            continue;
+        }
+        for (map<pair<int, int>, int>::iterator it = edge_ids.lower_bound(make_pair(u, 0)); it != edge_ids.end() && (*it).first.first == u; it++) {
+            int v = (*it).first.second;
+            if (v == parent[u]) {
+                continue;
+            }
+            sendOverLink(stats, u, v, control_bytes, true);
+            if (parent[v] == -2) {
+                parent[v] = u;
+                depth[v] = depth[u] + 1;
+                queue.push_back(v);
+            }
+        }
+    }
+    if (holders.empty()) {
+        return false;
+    }
+    /*holders are in the order the flood reached them, so the first one is the closest*/
+    stats.hit_distance[depth[holders[0]]]++;
+    if (publishers.find(holders[0]) == publishers.end()) {
+        stats.cache_hits++;
+    }
+    stats.duplicate_answers += holders.size() - 1;
+    for (size_t i = 0; i < holders.size(); i++) {
+        int v = holders[i];
+        if (publishers.find(v) == publishers.end()) {
+            caches[v].touch(ev.item, capacity);
+        }
+        while (parent[v] >= 0) {
+            sendOverLink(stats, v, parent[v], control_bytes + bytes, false);
+            v = parent[v];
+            caches[v].touch(ev.item, capacity);
+        }
+    }
+    return true;
+}
+
+static void simulate(SimShard *shard, int mode, long capacity) {
+    SimStats &stats = shard->stats[mode];
+    map<string, set<int> > publishers;
+    map<string, unsigned int> item_bytes;
+    vector<SimCache> caches(tm_igraph.number_of_nodes);
+    stats.link_bytes.assign(igraph_ecount(&tm_igraph.graph), 0);
+    for (size_t i = 0; i < shard->events.size(); i++) {
+        SimEvent &ev = shard->events[i];
+        if (ev.publish) {
+            publishers[ev.item].insert(ev.node);
+            item_bytes[ev.item] = ev.bytes;
+            if (mode == SIM_RV) {
+                /*the advertisement*/
+                sendOverPath(stats, ev.node, rv_node, control_bytes, true);
+            }
+            continue;
+        }
+        stats.requests++;
+        set<int> &item_publishers = publishers[ev.item];
+        unsigned int bytes = item_bytes[ev.item];
+        switch (mode) {
+            case SIM_FLOOD:
+                if (!flood(stats, ev, item_publishers, caches, capacity, bytes, UINT_MAX)) {
+                    stats.unresolved++;
+                }
+                break;
+            case SIM_TTL:
+                if (!flood(stats, ev, item_publishers, caches, capacity, bytes, ttl)) {
+                    stats.fallbacks++;
+                    rendezvous(stats, ev, item_publishers, bytes);
+                }
+                break;
+            case SIM_RV:
+                rendezvous(stats, ev, item_publishers, bytes);
+                break;
+        }
+    }
+}
+
+static void *shard_loop(void *arg) {
+    SimShard *shard = (SimShard *) arg;
+    long capacity = cache_capacity;
+    if (capacity > 0) {
+        capacity = (capacity + no_shards - 1) / no_shards;
+    }
+    for (int m = 0; m < SIM_MODES; m++) {
+        if (modes[m]) {
+            simulate(shard, m, capacity);
+        }
+    }
+    return NULL;
+}
+
+static void usage(const char *name) {
+    cout << "usage: " << name << " [-m modes] [-t ttl] [-C capacity] [-j shards] [-r rv_node] [-c bytes] [-l link_file] topology_file trace_file" << endl;
+    cout << "  -m modes      comma separated, of flood, ttl and rv (default all)" << endl;
+    cout << "  -t ttl        hops of a TTL-limited flood before it falls back to the rendezvous (default 2)" << endl;
+    cout << "  -C capacity   items cached per node, 0 for none, -1 for unlimited (default -1)" << endl;
+    cout << "  -j shards     trace shards simulated in parallel (default 1)" << endl;
+    cout << "  -r rv_node    NODEID of the rendezvous node (default the TM)" << endl;
+    cout << "  -c bytes      bytes of a control message and of the header of a data message (default " << SIM_CONTROL_BYTES << ")" << endl;
+    cout << "  -l link_file  write the bytes of every link and mode to link_file" << endl;
+    cout << "trace lines: \"publish NODEID item bytes\" or \"subscribe NODEID item\" (# starts a comment)" << endl;
+    exit(1);
+}
+
+/*FNV-1a, so that every event of an item goes to the same shard*/
+static unsigned int itemHash(const string &item) {
+    unsigned int h = 2166136261U;
+    for (size_t i = 0; i < item.length(); i++) {
+        h ^= (unsigned char) item[i];
+        h *= 16777619U;
+    }
+    return h;
+}
+
+int main(int argc, char* argv[]) {
+    string rv_label;
+    char *link_file = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:t:C:j:r:c:l:")) != -1) {
+        switch (opt) {
+            case 'm':
+            {
+                string list = optarg;
+                for (int m = 0; m < SIM_MODES; m++) {
+                    modes[m] = (("," + list + ",").find(string(",") + mode_names[m] + ",") != string::npos);
+                }
+                break;
+            }
+            case 't':
+                ttl = atoi(optarg);
+                break;
+            case 'C':
+                cache_capacity = atol(optarg);
+                break;
+            case 'j':
+                no_shards = atoi(optarg);
+                break;
+            case 'r':
+                rv_label = optarg;
+                break;
+            case 'c':
+                control_bytes = atoi(optarg);
+                break;
+            case 'l':
+                link_file = optarg;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (argc - optind != 2 || no_shards < 1) {
+        usage(argv[0]);
+    }
+    if (tm_igraph.readTopology(argv[optind]) < 0) {
+        cout << "TM sim: couldn't read topology file...aborting" << endl;
+        return -1;
+    }
+    vertex_labels.resize(tm_igraph.number_of_nodes);
+    for (map<string, int>::iterator it = tm_igraph.reverse_node_index.begin(); it != tm_igraph.reverse_node_index.end(); it++) {
+        vertex_labels[(*it).second] = (*it).first;
+    }
+    for (int e = 0; e < igraph_ecount(&tm_igraph.graph); e++) {
+        igraph_integer_t from, to;
+        igraph_edge(&tm_igraph.graph, e, &from, &to);
+        edge_ids[make_pair((int) from, (int) to)] = e;
+    }
+    if (rv_label.empty()) {
+        rv_label = tm_igraph.nodeID;
+    }
+    if (tm_igraph.reverse_node_index.find(rv_label) == tm_igraph.reverse_node_index.end() ||
+            tm_igraph.reverse_node_index.find(tm_igraph.nodeID) == tm_igraph.reverse_node_index.end()) {
+        cout << "TM sim: unknown RV or TM node" << endl;
+        return -1;
+    }
+    rv_node = tm_igraph.reverse_node_index[rv_label];
+    tm_node = tm_igraph.reverse_node_index[tm_igraph.nodeID];
+    /*read and shard the trace*/
+    vector<SimShard *> shards;
+    for (int i = 0; i < no_shards; i++) {
+        shards.push_back(new SimShard());
+    }
+    ifstream trace(argv[optind + 1]);
+    string line;
+    unsigned long line_no = 0;
+    if (!trace.good()) {
+        cout << "TM sim: couldn't read trace file...aborting" << endl;
+        return -1;
+    }
+    while (getline(trace, line)) {
+        istringstream words(line);
+        string type, node;
+        SimEvent ev;
+        line_no++;
+        if (!(words >> type) || type[0] == '#') {
+            continue;
+        }
+        ev.bytes = 0;
+        ev.publish = (type == "publish");
+        if ((!ev.publish && type != "subscribe") || !(words >> node >> ev.item) || (ev.publish && !(words >> ev.bytes)) ||
+                tm_igraph.reverse_node_index.find(node) == tm_igraph.reverse_node_index.end()) {
+            cout << "TM sim: ignoring line " << line_no << " of the trace: " << line << endl;
+            continue;
+        }
+        ev.node = tm_igraph.reverse_node_index[node];
+        shards[itemHash(ev.item) % no_shards]->events.push_back(ev);
+    }
+    for (int i = 0; i < no_shards; i++) {
+        pthread_create(&shards[i]->thread, NULL, shard_loop, (void *) shards[i]);
+    }
+    SimStats totals[SIM_MODES];
+    for (int i = 0; i < no_shards; i++) {
+        pthread_join(shards[i]->thread, NULL);
+        for (int m = 0; m < SIM_MODES; m++) {
+            totals[m].merge(shards[i]->stats[m]);
+        }
+        delete shards[i];
+    }
+    ofstream links;
+    if (link_file != NULL) {
+        links.open(link_file);
+    }
+    for (int m = 0; m < SIM_MODES; m++) {
+        if (!modes[m]) {
+            continue;
+        }
+        SimStats &stats = totals[m];
+        unsigned long long max_link = 0;
+        unsigned long answered = 0;
+        double hops = 0;
+        ostringstream distances;
+        for (size_t e = 0; e < stats.link_bytes.size(); e++) {
+            max_link = max(max_link, stats.link_bytes[e]);
+            if (links.is_open() && stats.link_bytes[e] > 0) {
+                igraph_integer_t from, to;
+                igraph_edge(&tm_igraph.graph, e, &from, &to);
+                links << mode_names[m] << " " << vertex_labels[from] << " " << vertex_labels[to] << " " << stats.link_bytes[e] << endl;
+            }
+        }
+        for (map<unsigned int, unsigned long>::iterator it = stats.hit_distance.begin(); it != stats.hit_distance.end(); it++) {
+            answered += (*it).second;
+            hops += (double) (*it).first * (*it).second;
+            distances << (it == stats.hit_distance.begin() ? "" : ",") << (*it).first << ":" << (*it).second;
+        }
+        cout << "mode=" << mode_names[m] << " requests=" << stats.requests << " messages=" << stats.messages
+                << " control_bytes=" << stats.control_bytes << " data_bytes=" << stats.data_bytes
+                << " duplicate_answers=" << stats.duplicate_answers << " cache_hits=" << stats.cache_hits
+                << " unresolved=" << stats.unresolved << " fallbacks=" << stats.fallbacks
+                << " mean_hops=" << (answered > 0 ? hops / answered : 0) << " max_link_bytes=" << max_link
+                << " hops=" << (answered > 0 ? distances.str() : "-") << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#ifndef TM_TOPOLOGY_HH
+#define TM_TOPOLOGY_HH
+
+#include <stdint.h>
+#include <string>
+
+/*our proposal the compact binary topology of the TM (topology.tmb), written by the deployment tool next to topology.graphml.
+ *
+ * The file is mapped by the TM as it is, so every field is in the byte order of the host that wrote it (TM_TOPOLOGY_MAGIC tells).
+ * It is, in this order:
+ * a TMTopologyHeader,
+ * nodes + 1 offsets (uint32_t) of the node labels in the string table (the label of node i ends where the one of node i + 1 starts),
+ * nodes + 1 offsets (uint32_t) of the first out-edge of each node (CSR: the out-edges of node i are edges offsets[i] to offsets[i + 1] - 1),
+ * edges destination nodes (uint32_t),
+ * nodes iLIDs and then edges * lid_tables LIDs (all LIDs of edge 0, then of edge 1...), each one words 32 bit words,
+ * the string table (the node labels, then TM, TM_MODE and TM_FID_MODE, see the header).
+ * A LID or iLID is packed as the words of a Bitvector: bit b is bit b % 32 of word b / 32, and the character i of the string form is bit fid_len * 8 - 1 - i.
+ */
+#define TM_TOPOLOGY_MAGIC 0x54504d42 /*0x424d5054 in a file written with the other byte order*/
+#define TM_TOPOLOGY_VERSION 1
+
+struct TMTopologyHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t fid_len;
+    /*the 32 bit words of a LID or iLID*/
+    uint32_t words;
+    uint32_t lid_tables;
+    uint32_t nodes;
+    uint32_t edges;
+    /*the offset and length of TM, TM_MODE and TM_FID_MODE in the string table*/
+    uint32_t tm_offset;
+    uint32_t tm_len;
+    uint32_t tm_mode_offset;
+    uint32_t tm_mode_len;
+    uint32_t fid_mode_offset;
+    uint32_t fid_mode_len;
+    uint32_t strings_len;
+    /*TM_LOAD_WEIGHT (0 without load aware paths), TM_LINK_CAPACITY and TM_LOAD_HYSTERESIS*/
+    double load_weight;
+    double link_capacity;
+    double load_hysteresis;
+};
+
+/**@brief our proposal the size of a topology.tmb file with the given header (the file must have exactly this size).
+ */
+inline uint64_t tm_topology_size(const TMTopologyHeader &h) {
+    return sizeof (TMTopologyHeader) + 2 * ((uint64_t) h.nodes + 1) * sizeof (uint32_t) + (uint64_t) h.edges * sizeof (uint32_t) +\
+            ((uint64_t) h.nodes + (uint64_t) h.edges * h.lid_tables) * h.words * sizeof (uint32_t) + h.strings_len;
+}
+
+/**@brief our proposal packs the string form of a LID or iLID (bits characters '0' or '1') into words 32 bit words.
+ */
+inline void tm_pack_bits(const std::string &bits, uint32_t *packed, uint32_t words) {
+    for (uint32_t w = 0; w < words; w++) {
+        packed[w] = 0;
+    }
+    for (std::string::size_type i = 0; i < bits.length(); i++) {
+        if (bits[i] == '1') {
+            std::string::size_type b = bits.length() - 1 - i;
+            if (b < words * 32) {
+                packed[b >> 5] |= 1U << (b & 31);
+            }
+        }
+    }
+}
+
+#endif
@@ -32,6 +32,7 @@ int main(int argc, char **argv) {
     bool experiment_deploy = false;
     bool transfer_binaries = false;
     bool monitor_tool_stub = false;
+    bool collect_telemetry = false;
 
     /**parse command line block based on TCLAP (template lib)
      */
@@ -41,6 +42,7 @@ int main(int argc, char **argv) {
         TCLAP::ValueArg<std::string> experimentfileArg("d", "experimentfile", "Experiment description deployment file that contains information to remotely deploy applications and locally collect their STDOUT", false, "None", "string");
         TCLAP::SwitchArg autoSwitch("a", "auto", " Enable graph autogeneration - a autogenerated.cfg and edgevertices.cfg files are emitted at WRITE_CONF folder. The former contains the graph to repeat the experiment and the later the leaf nodes", cmd, false);
         TCLAP::ValueArg<std::string> tgzfileArg("t", "tgzfile", "tar gzipped file that gets transferred and extracted at USER home folders on all experiment targets", false, "None", "string");
+        TCLAP::SwitchArg telemetrySwitch("l", "telemetry", " Do not deploy: collect the latency telemetry (TELEMETRY) of the running nodes and write telemetry_report.txt at WRITE_CONF", cmd, false);
         TCLAP::SwitchArg MonToolStubSwitch("m", "montoolstub", " Enable Java monitor tool stub in the Click configuration files. This injects counters in click configs	that are inspected at runtime via port 55555. It will be ommited for kernel versions", cmd, false);
 
         cmd.add(configfileArg);
@@ -71,6 +73,7 @@ int main(int argc, char **argv) {
         /**Get monitor tool stub flag
          */
         monitor_tool_stub = MonToolStubSwitch.getValue();
+        collect_telemetry = telemetrySwitch.getValue();
 
 
     } catch (TCLAP::ArgException &e)
@@ -140,6 +143,14 @@ int main(int argc, char **argv) {
         cout << "Something went wrong" << endl;
         return EXIT_FAILURE;
     }
+    /**our proposal only the node labels, running modes and testbed IPs are needed to read the telemetry of a running deployment.
+     */
+    if (collect_telemetry) {
+        dm.openSSHMasters();
+        ret = dm.collectTelemetry();
+        dm.closeSSHMasters();
+        return (ret == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
     /**create a graph representation of the network domain. if autogenerated is true, the an igraph instance will be now created using the Barabasi-Albert model 
      */
     GraphRepresentation graph = GraphRepresentation(&dm, autogenerate);
@@ -156,9 +167,16 @@ int main(int argc, char **argv) {
     /**Calculate the default forwarding identifiers from each node to the domain's Topology Manager.
      */
     graph.calculateTMFIDs();
+    /**our proposal open one ssh connection per node, reused by all the following steps (SSH_MULTIPLEX).
+     */
+    dm.openSSHMasters();
     /**discover the MAC addresses (when needed) for each connection in the network domain.
      */
-    dm.discoverMacAddresses();
+    if (dm.discoverMacAddresses() > 0) {
+        cerr << "Some MAC addresses are unknown...aborting" << endl;
+        dm.closeSSHMasters();
+        return EXIT_FAILURE;
+    }
     /**write all Click/Blackadder Configuration files.
      */
     dm.writeClickFiles(monitor_tool_stub);
@@ -176,15 +194,35 @@ int main(int argc, char **argv) {
     /**set some graph attributes for the topology manager
      */
     igraph_cattribute_GAN_set(&graph.igraph, "FID_LEN", dm.fid_len);
-    igraph_cattribute_GAS_set(&graph.igraph, "TM", dm.TM_node->label.c_str());
-    cout << "TM is " << dm.TM_node->label << endl;
-    igraph_cattribute_GAS_set(&graph.igraph, "TM_MODE", dm.TM_node->running_mode.c_str());
-    FILE * outstream_graphml = fopen(string(dm.write_conf + "topology.graphml").c_str(), "w");
-    igraph_write_graph_graphml(&graph.igraph, outstream_graphml);
-    fclose(outstream_graphml);
-    /** Copy the .graphml file to the Topology Manager node.
+    igraph_cattribute_GAS_set(&graph.igraph, "TM_FID_MODE", dm.tm_fid_mode.c_str());
+    igraph_cattribute_GAN_set(&graph.igraph, "LID_TABLES", dm.lid_tables);
+    if (dm.load_report > 0) {
+        /*our proposal load aware paths, only if the Forwarders report the load*/
+        igraph_cattribute_GAN_set(&graph.igraph, "TM_LOAD_WEIGHT", dm.tm_load_weight);
+        igraph_cattribute_GAN_set(&graph.igraph, "TM_LINK_CAPACITY", dm.tm_link_capacity);
+        igraph_cattribute_GAN_set(&graph.igraph, "TM_LOAD_HYSTERESIS", dm.tm_load_hysteresis);
+    }
+    /**our proposal every TM replica gets the same graph: only the TM node (a replica computes the FIDs from itself) and its mode differ
+     */
+    for (int i = 0; i < dm.TM_nodes.size(); i++) {
+        NetworkNode *tm = dm.TM_nodes[i];
+        igraph_cattribute_GAS_set(&graph.igraph, "TM", tm->label.c_str());
+        cout << "TM is " << tm->label << endl;
+        igraph_cattribute_GAS_set(&graph.igraph, "TM_MODE", tm->running_mode.c_str());
+        string graphml = (dm.TM_nodes.size() > 1) ? tm->label + "_topology.graphml" : "topology.graphml";
+        FILE * outstream_graphml = fopen(string(dm.write_conf + graphml).c_str(), "w");
+        igraph_write_graph_graphml(&graph.igraph, outstream_graphml);
+        fclose(outstream_graphml);
+        /*our proposal and the compact binary topology that the TM maps at startup (the TM falls back to the .graphml file if it cannot use it)*/
+        string tmb = (dm.TM_nodes.size() > 1) ? tm->label + "_topology.tmb" : "topology.tmb";
+        if (graph.writeBinaryTopology(dm.write_conf + tmb, tm) < 0) {
+            return EXIT_FAILURE;
+        }
+    }
+    /** Copy the .graphml and .tmb files to the Topology Manager node.
      */
     dm.scpTMConfiguration("topology.graphml");
+    dm.scpTMConfiguration("topology.tmb");
     /**Start the Topology Manager at the right node.
      */
     cout << experimentfile;
@@ -194,4 +232,5 @@ int main(int argc, char **argv) {
         cex.DeployExperiment();
     }
     dm.startTM();
+    dm.closeSSHMasters();
 }
@@ -14,6 +14,7 @@
  */
 
 #include <vector>
+#include <stdio.h>
 
 #include "graph_representation.hpp"
 
@@ -63,7 +64,7 @@ void GraphRepresentation::buildIGraphTopology() {
             }
             /*add an edge in the graph*/
             igraph_add_edge(&igraph, source_vertex_id, destination_vertex_id);
-            igraph_cattribute_EAS_set(&igraph, "LID", igraph_ecount(&igraph) - 1, nc->LID.to_string().c_str());
+            igraph_cattribute_EAS_set(&igraph, "LID", igraph_ecount(&igraph) - 1, nc->LIDString().c_str());
         }
     }
     for (int i = 0; i < dm->network_nodes.size(); i++) {
@@ -134,6 +135,12 @@ void GraphRepresentation::calculateRVFIDs() {
     for (int i = 0; i < dm->network_nodes.size(); i++) {
         NetworkNode *nn = dm->network_nodes[i];
         nn->FID_to_RV = calculateFID(nn->label, RVLabel);
+        nn->FID_to_RV_shards.clear();
+        if (dm->RV_nodes.size() > 1) {
+            for (int j = 0; j < dm->RV_nodes.size(); j++) {
+                nn->FID_to_RV_shards.push_back(calculateFID(nn->label, dm->RV_nodes[j]->label));
+            }
+        }
     }
 }
 
@@ -142,7 +149,101 @@ void GraphRepresentation::calculateTMFIDs() {
     for (int i = 0; i < dm->network_nodes.size(); i++) {
         NetworkNode *nn = dm->network_nodes[i];
         nn->FID_to_TM = calculateFID(nn->label, TMLabel);
+        nn->FID_to_TM_replicas.clear();
+        if (dm->TM_nodes.size() > 1) {
+            for (int j = 0; j < dm->TM_nodes.size(); j++) {
+                nn->FID_to_TM_replicas.push_back(calculateFID(nn->label, dm->TM_nodes[j]->label));
+            }
+        }
+    }
+}
+
+int GraphRepresentation::writeBinaryTopology(const string &file_name, NetworkNode *tm) {
+    TMTopologyHeader h;
+    int n = igraph_vcount(&igraph);
+    int m = igraph_ecount(&igraph);
+    vector<uint32_t> labels(n + 1, 0);
+    vector<uint32_t> out(n + 1, 0);
+    vector<uint32_t> destinations(m);
+    vector<int> order(m);
+    string strings;
+    igraph_integer_t from, to;
+    memset(&h, 0, sizeof (h));
+    h.magic = TM_TOPOLOGY_MAGIC;
+    h.version = TM_TOPOLOGY_VERSION;
+    h.fid_len = dm->fid_len;
+    h.words = (dm->fid_len * 8 + 31) / 32;
+    h.lid_tables = dm->lid_tables;
+    h.nodes = n;
+    h.edges = m;
+    /*the same graph attributes as the .graphML file (see deploy.cpp): without load reports the paths are not load aware*/
+    h.load_weight = (dm->load_report > 0) ? dm->tm_load_weight : 0;
+    h.link_capacity = dm->tm_link_capacity;
+    h.load_hysteresis = dm->tm_load_hysteresis;
+    vector<uint32_t> ilids((size_t) n * h.words);
+    vector<uint32_t> lids((size_t) m * h.lid_tables * h.words);
+    for (int i = 0; i < n; i++) {
+        labels[i] = strings.length();
+        strings += igraph_cattribute_VAS(&igraph, "NODEID", i);
+        tm_pack_bits(igraph_cattribute_VAS(&igraph, "iLID", i), &ilids[(size_t) i * h.words], h.words);
+    }
+    labels[n] = strings.length();
+    h.tm_offset = strings.length();
+    h.tm_len = tm->label.length();
+    strings += tm->label;
+    h.tm_mode_offset = strings.length();
+    h.tm_mode_len = tm->running_mode.length();
+    strings += tm->running_mode;
+    h.fid_mode_offset = strings.length();
+    h.fid_mode_len = dm->tm_fid_mode.length();
+    strings += dm->tm_fid_mode;
+    h.strings_len = strings.length();
+    /*CSR: the edges are ordered by their source (a counting sort keeps the igraph order among the edges of a node)*/
+    for (int e = 0; e < m; e++) {
+        igraph_edge(&igraph, e, &from, &to);
+        out[from + 1]++;
+    }
+    for (int i = 0; i < n; i++) {
+        out[i + 1] += out[i];
+    }
+    vector<uint32_t> next(out.begin(), out.end() - 1);
+    for (int e = 0; e < m; e++) {
+        igraph_edge(&igraph, e, &from, &to);
+        order[next[from]] = e;
+        destinations[next[from]++] = to;
+    }
+    for (int k = 0; k < m; k++) {
+        /*the attribute has the LIDs of all tables separated by ':' - a missing one is the LID of table 0, as for the TM*/
+        string LIDs = igraph_cattribute_EAS(&igraph, "LID", order[k]);
+        size_t start = 0;
+        for (uint32_t t = 0; t < h.lid_tables; t++) {
+            uint32_t *packed = &lids[((size_t) k * h.lid_tables + t) * h.words];
+            if (start == string::npos) {
+                memcpy(packed, &lids[(size_t) k * h.lid_tables * h.words], h.words * sizeof (uint32_t));
+                continue;
+            }
+            size_t end = LIDs.find(':', start);
+            tm_pack_bits(LIDs.substr(start, (end == string::npos) ? string::npos : end - start), packed, h.words);
+            start = (end == string::npos) ? string::npos : end + 1;
+        }
+    }
+    FILE *outstream = fopen(file_name.c_str(), "w");
+    if (outstream == NULL) {
+        cerr << "cannot write " << file_name << endl;
+        return -1;
+    }
+    bool written = (fwrite(&h, sizeof (h), 1, outstream) == 1);
+    written = written && (fwrite(&labels[0], sizeof (uint32_t), n + 1, outstream) == (size_t) n + 1);
+    written = written && (fwrite(&out[0], sizeof (uint32_t), n + 1, outstream) == (size_t) n + 1);
+    written = written && ((m == 0) || (fwrite(&destinations[0], sizeof (uint32_t), m, outstream) == (size_t) m));
+    written = written && (ilids.empty() || (fwrite(&ilids[0], sizeof (uint32_t), ilids.size(), outstream) == ilids.size()));
+    written = written && (lids.empty() || (fwrite(&lids[0], sizeof (uint32_t), lids.size(), outstream) == lids.size()));
+    written = written && (strings.empty() || (fwrite(strings.data(), 1, strings.length(), outstream) == strings.length()));
+    if ((fclose(outstream) != 0) || !written) {
+        cerr << "cannot write " << file_name << endl;
+        return -1;
     }
+    return 0;
 }
 
 //AutoGenerated Graph support starts here
@@ -207,7 +308,9 @@ void GraphRepresentation::ChooseTheBestTMRVNode(void) {
     nn->isRV = true;
     nn->isTM = true;
     dm->RV_node = nn;
+    dm->RV_nodes.push_back(nn);
     dm->TM_node = nn;
+    dm->TM_nodes.push_back(nn);
     cout << "Autogenerated Info: chose as the RV and TM: " << cur_vid + 1 << " with total hops " << cur_total << endl;
 
 }
@@ -19,6 +19,7 @@
 #include <igraph/igraph.h>
 #include <sstream>
 #include "network.hpp"
+#include "../TopologyManager/tm_topology.hpp"
 
 using namespace std;
 
@@ -55,6 +56,13 @@ public:
     /**@brief calculates and assigns the default LIPSIN identifier from each node to the domain's TM.
      */
     void calculateTMFIDs();
+    /**@brief our proposal writes the graph as a compact binary topology (see TopologyManager/tm_topology.hpp) for the given TM node, with the same graph attributes as its .graphML file.
+     *
+     * @param file_name the full path of the file.
+     * @param tm the TM node (replica) the file is for.
+     * @return <0 if the file could not be written
+     */
+    int writeBinaryTopology(const string &file_name, NetworkNode *tm);
     /**@brief Builds internal structures representation from an igraph instance
      *
      * It uses the igraph representation that is built from barabasi-albert algorithm and builds internal structures.
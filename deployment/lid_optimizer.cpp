@@ -0,0 +1,444 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <pthread.h>
+#include <time.h>
+
+#include "lid_optimizer.hpp"
+
+/*our proposal the candidates of one worker: every step-th candidate from first*/
+struct CandidateJob {
+    LIDOptimizer *optimizer;
+    const vector<Bitvector> *LIDs;
+    int e;
+    const vector<Bitvector> *candidates;
+    vector<double> *deltas;
+    int first;
+    int step;
+};
+
+static void *candidate_worker(void *arg) {
+    CandidateJob *job = (CandidateJob *) arg;
+    for (int i = job->first; i < (int) job->candidates->size(); i += job->step) {
+        (*job->deltas)[i] = job->optimizer->delta(*job->LIDs, job->e, (*job->candidates)[i]);
+    }
+    return NULL;
+}
+
+/*our proposal true if all bits of lid are set in fid*/
+static bool contained(const Bitvector &lid, const Bitvector &fid) {
+    const Bitvector::data_word_type *l = lid.data_words();
+    const Bitvector::data_word_type *f = fid.data_words();
+    for (int i = 0; i <= lid.max_word(); i++) {
+        if ((l[i] & ~f[i]) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int ones(const Bitvector &b) {
+    int count = 0;
+    const Bitvector::data_word_type *w = b.data_words();
+    for (int i = 0; i <= b.max_word(); i++) {
+        count += __builtin_popcount(w[i]);
+    }
+    return count;
+}
+
+LIDOptimizer::LIDOptimizer(Domain *_dm) {
+    dm = _dm;
+    /*the top bits carry the LID table index*/
+    usable_bits = dm->fid_len * 8 - dm->lidTableBits();
+    k = 0;
+}
+
+void LIDOptimizer::addDelivery(int src, int dst, double weight, vector<int> &parent_link) {
+    if (src == dst || (parent_link[dst] < 0)) {
+        /*unreachable*/
+        return;
+    }
+    Delivery d;
+    d.weight = weight;
+    d.elements.push_back(dst);
+    d.path.push_back(dst);
+    for (int v = dst; v != src;) {
+        int l = parent_link[v];
+        d.elements.push_back(nodes.size() + l);
+        v = link_src[l];
+        d.path.push_back(v);
+    }
+    reverse(d.path.begin(), d.path.end());
+    sort(d.elements.begin(), d.elements.end());
+    deliveries.push_back(d);
+}
+
+void LIDOptimizer::buildDeliveries() {
+    nodes = dm->network_nodes;
+    for (int i = 0; i < (int) nodes.size(); i++) {
+        node_index[nodes[i]->label] = i;
+    }
+    out_links.assign(nodes.size(), vector<int>());
+    vector<int> link_dst;
+    for (int i = 0; i < (int) nodes.size(); i++) {
+        for (int j = 0; j < (int) nodes[i]->connections.size(); j++) {
+            NetworkConnection *nc = nodes[i]->connections[j];
+            map<string, int>::iterator it = node_index.find(nc->dst_label);
+            out_links[i].push_back(links.size());
+            links.push_back(nc);
+            link_src.push_back(i);
+            link_dst.push_back((it == node_index.end()) ? -1 : it->second);
+        }
+    }
+    /*the destinations (and weights) of every source*/
+    map<int, vector<pair<int, double> > > demands;
+    if (dm->traffic.empty()) {
+        int n = nodes.size();
+        bool all_pairs = ((double) n * (n - 1) <= LID_MAX_DELIVERIES);
+        int per_source = (n > 0) ? max(1, LID_MAX_DELIVERIES / n) : 0;
+        for (int s = 0; s < n; s++) {
+            if (all_pairs) {
+                for (int d = 0; d < n; d++) {
+                    demands[s].push_back(make_pair(d, 1.0));
+                }
+            } else {
+                for (int i = 0; i < per_source; i++) {
+                    demands[s].push_back(make_pair(rand() % n, 1.0));
+                }
+            }
+        }
+    } else {
+        for (int i = 0; i < (int) dm->traffic.size(); i++) {
+            TrafficDemand &td = dm->traffic[i];
+            if ((node_index.find(td.src) == node_index.end()) || (node_index.find(td.dst) == node_index.end())) {
+                cerr << "TRAFFIC: unknown node " << td.src << " or " << td.dst << "...ignored" << endl;
+                continue;
+            }
+            demands[node_index[td.src]].push_back(make_pair(node_index[td.dst], td.weight));
+        }
+    }
+    /*one breadth first search per source*/
+    for (map<int, vector<pair<int, double> > >::iterator it = demands.begin(); it != demands.end(); it++) {
+        int src = it->first;
+        vector<int> parent_link(nodes.size(), -1);
+        vector<bool> visited(nodes.size(), false);
+        vector<int> queue;
+        queue.push_back(src);
+        visited[src] = true;
+        for (int q = 0; q < (int) queue.size(); q++) {
+            int v = queue[q];
+            for (int j = 0; j < (int) out_links[v].size(); j++) {
+                int l = out_links[v][j];
+                int w = link_dst[l];
+                if ((w >= 0) && !visited[w]) {
+                    visited[w] = true;
+                    parent_link[w] = l;
+                    queue.push_back(w);
+                }
+            }
+        }
+        for (int i = 0; i < (int) it->second.size(); i++) {
+            addDelivery(src, it->second[i].first, it->second[i].second, parent_link);
+        }
+    }
+    /*which deliveries every element matters to*/
+    affected.assign(elements(), vector<int>());
+    for (int di = 0; di < (int) deliveries.size(); di++) {
+        Delivery &d = deliveries[di];
+        for (int i = 0; i < (int) d.elements.size(); i++) {
+            affected[d.elements[i]].push_back(di);
+        }
+        for (int i = 0; i < (int) d.path.size(); i++) {
+            int v = d.path[i];
+            if ((i > 0) && (i + 1 < (int) d.path.size())) {
+                affected[v].push_back(di);
+            }
+            for (int j = 0; j < (int) out_links[v].size(); j++) {
+                affected[nodes.size() + out_links[v][j]].push_back(di);
+            }
+        }
+    }
+    for (int e = 0; e < elements(); e++) {
+        sort(affected[e].begin(), affected[e].end());
+        affected[e].erase(unique(affected[e].begin(), affected[e].end()), affected[e].end());
+    }
+}
+
+Bitvector LIDOptimizer::fid(const vector<Bitvector> &LIDs, const Delivery &d, int e, const Bitvector *cand) {
+    Bitvector FID(dm->fid_len * 8);
+    for (int i = 0; i < (int) d.elements.size(); i++) {
+        int el = d.elements[i];
+        FID |= ((el == e) && cand) ? *cand : LIDs[el];
+    }
+    return FID;
+}
+
+double LIDOptimizer::falsePositives(const vector<Bitvector> &LIDs, const Delivery &d, int e, const Bitvector *cand, vector<double> *hits, vector<double> *tests) {
+    Bitvector FID = fid(LIDs, d, e, cand);
+    double fp = 0;
+    for (int i = 0; i < (int) d.path.size(); i++) {
+        int v = d.path[i];
+        /*the links of the node, and its iLID on the way (the destination's is in the FID)*/
+        int first = ((i > 0) && (i + 1 < (int) d.path.size())) ? -1 : 0;
+        for (int j = first; j < (int) out_links[v].size(); j++) {
+            int el = (j < 0) ? v : nodes.size() + out_links[v][j];
+            if (binary_search(d.elements.begin(), d.elements.end(), el)) {
+                continue;
+            }
+            const Bitvector &LID = ((el == e) && cand) ? *cand : LIDs[el];
+            bool match = contained(LID, FID);
+            if (match) {
+                fp++;
+            }
+            if (tests) {
+                (*tests)[el] += d.weight;
+                if (match) {
+                    (*hits)[el] += d.weight;
+                }
+            }
+        }
+    }
+    return fp * d.weight;
+}
+
+double LIDOptimizer::delta(const vector<Bitvector> &LIDs, int e, const Bitvector &cand) {
+    double change = 0;
+    for (int i = 0; i < (int) affected[e].size(); i++) {
+        int di = affected[e][i];
+        change += falsePositives(LIDs, deliveries[di], e, &cand, NULL, NULL) - current[di];
+    }
+    return change;
+}
+
+Bitvector LIDOptimizer::randomLID(vector<Bitvector> &LIDs, vector<vector<Bitvector> > &tables) {
+    for (int attempt = 1;; attempt++) {
+        if (attempt % 1000 == 0 && k < usable_bits) {
+            k++;
+            cout << "LIDOptimizer: not enough distinct LIDs of " << k - 1 << " bits, using " << k << endl;
+        }
+        Bitvector LID(dm->fid_len * 8);
+        for (int set = 0; set < k;) {
+            int bit_position = rand() % usable_bits;
+            if (!LID[bit_position]) {
+                LID[bit_position] = true;
+                set++;
+            }
+        }
+        bool duplicate = false;
+        for (int i = 0; i < (int) LIDs.size() && !duplicate; i++) {
+            duplicate = (LIDs[i] == LID);
+        }
+        for (int t = 0; t < (int) tables.size() && !duplicate; t++) {
+            for (int i = 0; i < (int) tables[t].size() && !duplicate; i++) {
+                duplicate = (tables[t][i] == LID);
+            }
+        }
+        if (!duplicate) {
+            return LID;
+        }
+    }
+}
+
+void LIDOptimizer::optimizeTable(vector<Bitvector> &LIDs, vector<vector<Bitvector> > &tables) {
+    LIDs.assign(elements(), Bitvector());
+    for (int e = 0; e < elements(); e++) {
+        LIDs[e] = randomLID(LIDs, tables);
+    }
+    int workers = max(1, dm->lid_workers);
+    int candidates_per_iteration = workers * LID_CANDIDATES_PER_WORKER;
+    current.assign(deliveries.size(), 0);
+    vector<double> hits(elements(), 0);
+    vector<double> tests(elements(), 0);
+    double total = 0;
+    double start = 0;
+    for (int it = 0; it < dm->lid_iterations; it++) {
+        if (it % 32 == 0) {
+            /*the blame of every element is refreshed now and then*/
+            hits.assign(elements(), 0);
+            tests.assign(elements(), 0);
+            total = 0;
+            for (int di = 0; di < (int) deliveries.size(); di++) {
+                current[di] = falsePositives(LIDs, deliveries[di], -1, NULL, &hits, &tests);
+                total += current[di];
+            }
+            if (it == 0) {
+                start = total;
+            }
+        }
+        if (total <= 0) {
+            break;
+        }
+        /*mostly an element that matches FIDs it should not, otherwise any element (which may fill FIDs)*/
+        int e = rand() % elements();
+        double total_hits = 0;
+        for (int i = 0; i < elements(); i++) {
+            total_hits += hits[i];
+        }
+        if ((total_hits > 0) && (rand() % 4 != 0)) {
+            double pick = total_hits * rand() / ((double) RAND_MAX + 1);
+            for (e = 0; e < elements() - 1 && pick >= hits[e]; e++) {
+                pick -= hits[e];
+            }
+        }
+        vector<Bitvector> candidates;
+        for (int i = 0; i < candidates_per_iteration; i++) {
+            candidates.push_back(randomLID(LIDs, tables));
+        }
+        vector<double> deltas(candidates.size(), 0);
+        if (workers == 1) {
+            for (int i = 0; i < (int) candidates.size(); i++) {
+                deltas[i] = delta(LIDs, e, candidates[i]);
+            }
+        } else {
+            vector<pthread_t> threads(workers);
+            vector<CandidateJob> jobs(workers);
+            for (int w = 0; w < workers; w++) {
+                CandidateJob job = {this, &LIDs, e, &candidates, &deltas, w, workers};
+                jobs[w] = job;
+                pthread_create(&threads[w], NULL, candidate_worker, &jobs[w]);
+            }
+            for (int w = 0; w < workers; w++) {
+                pthread_join(threads[w], NULL);
+            }
+        }
+        int best = min_element(deltas.begin(), deltas.end()) - deltas.begin();
+        if (deltas[best] < 0) {
+            LIDs[e] = candidates[best];
+            for (int i = 0; i < (int) affected[e].size(); i++) {
+                int di = affected[e][i];
+                current[di] = falsePositives(LIDs, deliveries[di], -1, NULL, NULL, NULL);
+            }
+            total += deltas[best];
+            hits[e] = 0;
+        }
+    }
+    cout << "LIDOptimizer: table " << tables.size() << ": weighed false positives " << start << " -> " << max(total, 0.0) << endl;
+}
+
+void LIDOptimizer::assign() {
+    srand(time(NULL));
+    buildDeliveries();
+    double elements_per_delivery = 0;
+    double weights = 0;
+    for (int di = 0; di < (int) deliveries.size(); di++) {
+        elements_per_delivery += deliveries[di].weight * deliveries[di].elements.size();
+        weights += deliveries[di].weight;
+    }
+    elements_per_delivery = (weights > 0) ? elements_per_delivery / weights : 1;
+    if (dm->lid_bits > 0) {
+        k = min(dm->lid_bits, usable_bits);
+    } else {
+        /*the number of bits that minimises the false positive rate of a Bloom filter of that many elements*/
+        k = max(1, min(usable_bits / 2, (int) (usable_bits * log(2.0) / elements_per_delivery + 0.5)));
+    }
+    cout << "LIDOptimizer: " << deliveries.size() << " deliveries of " << elements_per_delivery << " LIDs on average, " << k << " bits per LID, "\
+         << dm->lid_workers << " workers" << endl;
+    vector<vector<Bitvector> > tables;
+    for (int t = 0; t < dm->lid_tables; t++) {
+        vector<Bitvector> LIDs;
+        optimizeTable(LIDs, tables);
+        tables.push_back(LIDs);
+    }
+    for (int i = 0; i < (int) nodes.size(); i++) {
+        nodes[i]->iLid = tables[0][i];
+    }
+    for (int l = 0; l < (int) links.size(); l++) {
+        links[l]->LID = tables[0][nodes.size() + l];
+        links[l]->tableLIDs.clear();
+        for (int t = 1; t < dm->lid_tables; t++) {
+            links[l]->tableLIDs.push_back(tables[t][nodes.size() + l]);
+        }
+    }
+}
+
+double LIDOptimizer::report() {
+    if (nodes.empty()) {
+        buildDeliveries();
+    }
+    vector<vector<Bitvector> > tables(dm->lid_tables, vector<Bitvector>(elements()));
+    for (int i = 0; i < (int) nodes.size(); i++) {
+        tables[0][i] = nodes[i]->iLid;
+    }
+    for (int l = 0; l < (int) links.size(); l++) {
+        tables[0][nodes.size() + l] = links[l]->LID;
+        for (int t = 1; t < dm->lid_tables; t++) {
+            tables[t][nodes.size() + l] = links[l]->tableLIDs[t - 1];
+        }
+    }
+    for (int t = 1; t < dm->lid_tables; t++) {
+        /*the iLIDs are the same in all tables*/
+        for (int i = 0; i < (int) nodes.size(); i++) {
+            tables[t][i] = nodes[i]->iLid;
+        }
+    }
+    vector<double> hits(elements(), 0);
+    vector<double> tests(elements(), 0);
+    double false_positives = 0, weights = 0, fill = 0, max_fill = 0;
+    for (int di = 0; di < (int) deliveries.size(); di++) {
+        Delivery &d = deliveries[di];
+        /*the TM uses the table with the least full FID*/
+        int best = 0, best_ones = usable_bits + 1;
+        for (int t = 0; t < dm->lid_tables; t++) {
+            int n = ones(fid(tables[t], d, -1, NULL));
+            if (n < best_ones) {
+                best = t;
+                best_ones = n;
+            }
+        }
+        false_positives += falsePositives(tables[best], d, -1, NULL, &hits, &tests);
+        weights += d.weight;
+        fill += d.weight * best_ones / usable_bits;
+        max_fill = max(max_fill, (double) best_ones / usable_bits);
+    }
+    if (weights <= 0) {
+        cout << "LIDOptimizer: no deliveries to report on" << endl;
+        return 0;
+    }
+    fill /= weights;
+    ofstream report_file((dm->write_conf + "lid_report.txt").c_str());
+    report_file << "# predicted false positive rates: " << deliveries.size() << " deliveries, LIPSIN_ID_LENGTH " << dm->fid_len << ", LID_TABLES " << dm->lid_tables << endl;
+    report_file << "# mean FID fill " << fill << ", max FID fill " << max_fill << ", false positives per delivery " << false_positives / weights << endl;
+    report_file << "# element bits tests fpr" << endl;
+    double worst = 0;
+    string worst_link;
+    for (int e = 0; e < elements(); e++) {
+        double fpr = (tests[e] > 0) ? hits[e] / tests[e] : 0;
+        string name;
+        if (e < (int) nodes.size()) {
+            name = "ilid " + nodes[e]->label;
+        } else {
+            NetworkConnection *nc = links[e - nodes.size()];
+            name = "link " + nc->src_label + "->" + nc->dst_label;
+        }
+        report_file << name << " " << ones(tables[0][e]) << " " << tests[e] << " " << fpr << endl;
+        if (fpr > worst) {
+            worst = fpr;
+            worst_link = name;
+        }
+    }
+    report_file.close();
+    cout << "LID report (" << dm->write_conf << "lid_report.txt): mean FID fill " << fill << ", max " << max_fill << ", false positives per delivery "\
+         << false_positives / weights;
+    if (worst > 0) {
+        cout << ", worst " << worst_link << " (" << worst << ")";
+    }
+    cout << endl;
+    if (false_positives / weights > LID_FIT_THRESHOLD) {
+        cout << "WARNING: more than " << LID_FIT_THRESHOLD << " false positives per delivery, the topology does not fit in LIPSIN_ID_LENGTH " << dm->fid_len\
+             << " (try a larger one, more LID_TABLES or LID_MODE optimized)" << endl;
+    }
+    return false_positives / weights;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#ifndef LID_OPTIMIZER_HPP
+#define	LID_OPTIMIZER_HPP
+
+#include <map>
+
+#include "network.hpp"
+
+/*our proposal without a TRAFFIC matrix the LIDs are optimized for the deliveries between all pairs of nodes, at most this many of them (a random sample beyond)*/
+#define LID_MAX_DELIVERIES 100000
+
+/*our proposal a topology fits in LIPSIN_ID_LENGTH if its deliveries are expected to have fewer false positives than this (each)*/
+#define LID_FIT_THRESHOLD 0.01
+
+/*our proposal the candidate LIDs every worker tries per iteration of the search*/
+#define LID_CANDIDATES_PER_WORKER 4
+
+/**@brief (Deployment Application) our proposal chooses the LIDs of a Domain (LID_MODE = "optimized") so that the expected number of false positives of its deliveries is small.
+ *
+ * A delivery is the shortest path from a node to another, weighed by how often it is used (see TrafficDemand): its FID is the OR of the LIDs of the links of the path and of the iLID of the destination.
+ * Every node of the path tests the LIDs of its other links (and its iLID) against it, a false positive is a test that matches.
+ * Starting from random LIDs of k bits each, a local search replaces, one at a time, LIDs that cause false positives or fill the FIDs with the best of several random candidates,
+ * which are evaluated in parallel (LID_WORKERS threads), and keeps the replacement if the expected number of false positives goes down.
+ * Every LID table is optimized on its own. Cascading false positives (a copy that goes on past a wrong link) are not counted.
+ */
+class LIDOptimizer {
+public:
+    LIDOptimizer(Domain *_dm);
+    /**@brief optimizes the LIDs of all tables and assigns them to the nodes (iLid) and connections (LID and tableLIDs).
+     */
+    void assign();
+    /**@brief writes the predicted false positive rate of every link and iLID with the LIDs the nodes and connections have to lid_report.txt in WRITE_CONF, and a summary to stdout.
+     *
+     * Every delivery uses the LID table in which its FID is the least full, as the TM does.
+     * @return the expected number of false positives per delivery.
+     */
+    double report();
+    /**@brief the change of the weighed false positives if the LID of element e of table LIDs were cand.
+     */
+    double delta(const vector<Bitvector> &LIDs, int e, const Bitvector &cand);
+private:
+    /**@brief a delivery: the elements (iLIDs are elements 0..n-1, links n..) whose LIDs make its FID, sorted, the nodes of the path and the weight.
+     */
+    struct Delivery {
+        vector<int> elements;
+        vector<int> path;
+        double weight;
+    };
+    Domain *dm;
+    vector<NetworkNode *> nodes;
+    map<string, int> node_index;
+    vector<NetworkConnection *> links;
+    vector<int> link_src;
+    vector<vector<int> > out_links;
+    vector<Delivery> deliveries;
+    /**@brief for every element the deliveries whose FID it is in or which test it
+     */
+    vector<vector<int> > affected;
+    /**@brief the weighed false positives of every delivery with the LIDs of the table being optimized
+     */
+    vector<double> current;
+    int usable_bits;
+    int k;
+    int elements() {
+        return nodes.size() + links.size();
+    }
+    void buildDeliveries();
+    void addDelivery(int src, int dst, double weight, vector<int> &parent_link);
+    Bitvector randomLID(vector<Bitvector> &LIDs, vector<vector<Bitvector> > &tables);
+    Bitvector fid(const vector<Bitvector> &LIDs, const Delivery &d, int e, const Bitvector *cand);
+    /**@brief the (weighed) false positives of d with the LIDs of LIDs (the one of element e replaced with cand, if not NULL).
+     * If hits and tests are not NULL the matches and tests of every element are added to them.
+     */
+    double falsePositives(const vector<Bitvector> &LIDs, const Delivery &d, int e, const Bitvector *cand, vector<double> *hits, vector<double> *tests);
+    void optimizeTable(vector<Bitvector> &LIDs, vector<vector<Bitvector> > &tables);
+};
+
+#endif	/* LID_OPTIMIZER_HPP */
@@ -14,14 +14,185 @@
  */
 
 #include <map>
+#include <set>
+#include <sstream>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
 
 #include "network.hpp"
+#include "lid_optimizer.hpp"
 
 Domain::Domain() {
     TM_node = NULL;
     RV_node = NULL;
     number_of_nodes = 0;
     number_of_connections = 0;
+    deploy_jobs = DEFAULT_DEPLOY_JOBS;
+    ssh_multiplex = true;
+    profile = "default";
+    queue_size = DEFAULT_QUEUE_SIZE;
+    burst = 0;
+    egress = "fifo";
+    control_weight = DEFAULT_CONTROL_WEIGHT;
+    lid_mode = "random";
+    lid_bits = 0;
+    lid_iterations = 2000;
+    lid_workers = 4;
+    lid_report = false;
+    load_report = 0;
+    telemetry = false;
+    telemetry_sample = 100;
+    tm_load_weight = 1;
+    tm_link_capacity = 125000000;
+    tm_load_hysteresis = 0.25;
+}
+
+/*our proposal the jobs of Domain::runJobs(), taken by the workers in order*/
+struct JobQueue {
+    vector<DeployJob *> *jobs;
+    size_t next;
+    pthread_mutex_t mutex;
+};
+
+/*runs a command and returns its exit status (-1 if it could not run), its stdout and stderr are appended to output*/
+static int runCommand(const string &command, string &output) {
+    char buffer[1024];
+    size_t n;
+    FILE *fp_command = popen((command + " 2>&1").c_str(), "r");
+    if (fp_command == NULL) {
+        return -1;
+    }
+    while ((n = fread(buffer, 1, sizeof (buffer), fp_command)) > 0) {
+        output.append(buffer, n);
+    }
+    int status = pclose(fp_command);
+    if (status == -1 || !WIFEXITED(status)) {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
+
+static void *job_worker(void *arg) {
+    JobQueue *queue = (JobQueue *) arg;
+    while (true) {
+        pthread_mutex_lock(&queue->mutex);
+        if (queue->next == queue->jobs->size()) {
+            pthread_mutex_unlock(&queue->mutex);
+            return NULL;
+        }
+        DeployJob *job = (*queue->jobs)[queue->next++];
+        pthread_mutex_unlock(&queue->mutex);
+        for (int i = 0; i < job->commands.size(); i++) {
+            int status = runCommand(job->commands[i].first, job->output);
+            if (status != 0 && job->commands[i].second) {
+                job->status = status;
+                job->failed = job->commands[i].first;
+                break;
+            }
+        }
+    }
+}
+
+int Domain::runJobs(vector<DeployJob *> &jobs) {
+    JobQueue queue;
+    vector<pthread_t> workers;
+    int failures = 0;
+    time_t start = time(NULL);
+    if (jobs.empty()) {
+        return 0;
+    }
+    queue.jobs = &jobs;
+    queue.next = 0;
+    pthread_mutex_init(&queue.mutex, NULL);
+    for (int i = 0; i < jobs.size(); i++) {
+        for (int j = 0; j < jobs[i]->commands.size(); j++) {
+            cout << jobs[i]->commands[j].first << endl;
+        }
+    }
+    workers.resize(min((size_t) max(deploy_jobs, 1), jobs.size()));
+    for (int i = 0; i < workers.size(); i++) {
+        pthread_create(&workers[i], NULL, job_worker, (void *) &queue);
+    }
+    for (int i = 0; i < workers.size(); i++) {
+        pthread_join(workers[i], NULL);
+    }
+    pthread_mutex_destroy(&queue.mutex);
+    for (int i = 0; i < jobs.size(); i++) {
+        DeployJob *job = jobs[i];
+        if (job->status != 0) {
+            failures++;
+            cerr << "node " << job->node << ": " << job->step << " failed (exit status " << job->status << "): " << job->failed << endl;
+            if (!job->output.empty()) {
+                cerr << job->output;
+                if (job->output[job->output.length() - 1] != '\n') {
+                    cerr << endl;
+                }
+            }
+        }
+    }
+    cout << jobs[0]->step << ": " << jobs.size() - failures << " of " << jobs.size() << " nodes succeeded in " << time(NULL) - start << " seconds" << endl;
+    return failures;
+}
+
+string Domain::sshCommand(string testbed_ip) {
+    if (ssh_multiplex) {
+        return "ssh " SSH_MUX_OPTIONS " " + user + "@" + testbed_ip;
+    }
+    return "ssh " + user + "@" + testbed_ip;
+}
+
+string Domain::scpCommand() {
+    if (ssh_multiplex) {
+        return "scp " SSH_MUX_OPTIONS " ";
+    }
+    return "scp ";
+}
+
+void Domain::openSSHMasters() {
+    vector<DeployJob *> jobs;
+    set<string> ips;
+    if (!ssh_multiplex) {
+        return;
+    }
+    for (int i = 0; i < network_nodes.size(); i++) {
+        NetworkNode *nn = network_nodes[i];
+        if (!ips.insert(nn->testbed_ip).second) {
+            continue;
+        }
+        ostringstream command;
+        /*the master goes to the background (-f) and must not keep the output pipe of the job open*/
+        command << "ssh -f -N -o ControlMaster=yes -o ControlPersist=" << SSH_MUX_PERSIST << " -o ControlPath=/tmp/blackadder-deploy-%r@%h:%p "
+                << user << "@" << nn->testbed_ip << " < /dev/null > /dev/null 2>&1";
+        DeployJob *job = new DeployJob(nn->label, "opening the ssh connections");
+        job->add(command.str(), false);
+        jobs.push_back(job);
+    }
+    runJobs(jobs);
+    for (int i = 0; i < jobs.size(); i++) {
+        delete jobs[i];
+    }
+}
+
+void Domain::closeSSHMasters() {
+    set<string> ips;
+    string output;
+    if (!ssh_multiplex) {
+        return;
+    }
+    for (int i = 0; i < network_nodes.size(); i++) {
+        NetworkNode *nn = network_nodes[i];
+        if (ips.insert(nn->testbed_ip).second) {
+            runCommand(sshCommand(nn->testbed_ip) + " -O exit", output);
+        }
+    }
 }
 
 void Domain::printDomainData() {
@@ -50,7 +221,7 @@ void Domain::printDomainData() {
             cout << "*****dst_ip " << nc->dst_ip << endl;
             cout << "*****src_mac " << nc->src_mac << endl;
             cout << "*****dst_mac " << nc->dst_mac << endl;
-            cout << "*****LID " << nc->LID.to_string() << endl;
+            cout << "*****LID " << nc->LIDString() << endl;
         }
     }
 }
@@ -75,15 +246,33 @@ NetworkNode *Domain::findNode(string label) {
     return NULL;
 }
 
+int Domain::lidTableBits() {
+    int bits = 0;
+    while ((1 << bits) < lid_tables) {
+        bits++;
+    }
+    return bits;
+}
+
+string NetworkConnection::LIDString() {
+    string res = LID.to_string();
+    for (int i = 0; i < tableLIDs.size(); i++) {
+        res += ":" + tableLIDs[i].to_string();
+    }
+    return res;
+}
+
 void Domain::calculateLID(vector<Bitvector> &LIDs, int index) {
     int bit_position;
-    int number_of_bits = (index / (fid_len * 8)) + 1;
+    /*our proposal the top bits carry the LID table index*/
+    int usable_bits = fid_len * 8 - lidTableBits();
+    int number_of_bits = (index / usable_bits) + 1;
     Bitvector LID;
     do {
         LID = Bitvector(fid_len * 8);
         for (int i = 0; i < number_of_bits; i++) {
             /*assign a bit in a random position*/
-            bit_position = rand() % (fid_len * 8);
+            bit_position = rand() % usable_bits;
             LID[bit_position] = true;
         }
     } while (exists(LIDs, LID));
@@ -91,10 +280,16 @@ void Domain::calculateLID(vector<Bitvector> &LIDs, int index) {
 }
 
 void Domain::assignLIDs() {
+    if (lid_mode.compare("optimized") == 0) {
+        LIDOptimizer optimizer(this);
+        optimizer.assign();
+        optimizer.report();
+        return;
+    }
     int LIDCounter = 0;
     srand(time(NULL));
     /*first calculated how many LIDs should I calculate*/
-    int totalLIDs = number_of_nodes/*the iLIDs*/ + number_of_connections;
+    int totalLIDs = number_of_nodes/*the iLIDs*/ + number_of_connections * lid_tables;
     vector<Bitvector> LIDs(totalLIDs);
     for (int i = 0; i < totalLIDs; i++) {
         calculateLID(LIDs, i);
@@ -110,8 +305,17 @@ void Domain::assignLIDs() {
             NetworkConnection *nc = nn->connections[j];
             nc->LID = LIDs[LIDCounter];
             LIDCounter++;
+            nc->tableLIDs.clear();
+            for (int t = 1; t < lid_tables; t++) {
+                nc->tableLIDs.push_back(LIDs[LIDCounter]);
+                LIDCounter++;
+            }
         }
     }
+    if (lid_report) {
+        LIDOptimizer optimizer(this);
+        optimizer.report();
+    }
 }
 
 string Domain::getTestbedIPFromLabel(string label) {
@@ -129,84 +333,73 @@ string Domain::getTestbedIPFromLabel(string label) {
 
 /* For __APPLE__,   the label should be "ether" and the offset 19
  * For __FreeBSD__, the label should be "ether" and the offset 18. */
-void Domain::discoverMacAddresses() {
+int Domain::discoverMacAddresses() {
     map<string, string> mac_addresses;
-    string testbed_ip;
-    string line;
-    string mac_addr;
-    FILE *fp_command;
-    char response[1035];
-    string command;
+    map<string, DeployJob *> pending;
+    vector<DeployJob *> jobs;
+    int failures = 0;
+    if (overlay_mode.compare("mac") != 0) {
+        //cout << "no need to discover mac addresses - it's a connection over raw IP sockets" << endl;
+        return 0;
+    }
+    /*our proposal first the interfaces to learn (once each), then one ssh per interface, all run in parallel*/
     for (int i = 0; i < network_nodes.size(); i++) {
         NetworkNode *nn = network_nodes[i];
         for (int j = 0; j < nn->connections.size(); j++) {
             NetworkConnection *nc = nn->connections[j];
-            if (overlay_mode.compare("mac") == 0) {
-                if (mac_addresses.find(nc->src_label + nc->src_if) == mac_addresses.end()) {
-                    /*get source mac address*/
-                    if (nc->src_mac.length() == 0) {
-                        testbed_ip = getTestbedIPFromLabel(nc->src_label);
-                        if (sudo) {
-                            command = "ssh " + user + "@" + testbed_ip + " sudo ifconfig " + nc->src_if + " | grep "HWADDR_LABEL;
-                        } else {
-                            command = "ssh " + user + "@" + testbed_ip + " ifconfig " + nc->src_if + " | grep "HWADDR_LABEL;
-                        }
-                        cout << command << endl;
-                        fp_command = popen(command.c_str(), "r");
-                        if (fp_command == NULL) {
-                            printf("Failed to run command\n");
-                        }
-                        /* Read the output a line at a time - output it. */
-                        fgets(response, sizeof (response) - 1, fp_command);
-                        line = string(response);
-                        mac_addr = line.substr(line.length() - HWADDR_OFFSET, 17);
-                        cout << mac_addr << endl;
-                        nc->src_mac = mac_addr;
-                        /* close */
-                        pclose(fp_command);
-                    } else {
-                        cout << "I already know the source mac address for this connection...it was hardcoded in the configuration file" << endl;
-                    }
-                    mac_addresses[nc->src_label + nc->src_if] = nc->src_mac;
-                } else {
-                    nc->src_mac = mac_addresses[nc->src_label + nc->src_if];
-                    //cout << "I learned this mac address: " << nc->src_label << ":" << nc->src_if << " - " << mac_addresses[nc->src_label + nc->src_if] << endl;
+            for (int end = 0; end < 2; end++) {
+                string &label = (end == 0) ? nc->src_label : nc->dst_label;
+                string &iface = (end == 0) ? nc->src_if : nc->dst_if;
+                string &mac = (end == 0) ? nc->src_mac : nc->dst_mac;
+                string key = label + iface;
+                if (mac_addresses.find(key) != mac_addresses.end() || pending.find(key) != pending.end()) {
+                    continue;
                 }
-                if (mac_addresses.find(nc->dst_label + nc->dst_if) == mac_addresses.end()) {
-                    /*get destination mac address*/
-                    if (nc->dst_mac.length() == 0) {
-                        testbed_ip = getTestbedIPFromLabel(nc->dst_label);
-                        if (sudo) {
-                            command = "ssh " + user + "@" + testbed_ip + " sudo ifconfig " + nc->dst_if + " | grep "HWADDR_LABEL;
-                        } else {
-                            command = "ssh " + user + "@" + testbed_ip + " ifconfig " + nc->dst_if + " | grep "HWADDR_LABEL;
-                        }
-                        cout << command << endl;
-                        fp_command = popen(command.c_str(), "r");
-                        if (fp_command == NULL) {
-                            printf("Failed to run command\n");
-                        }
-                        /* Read the output a line at a time - output it. */
-                        fgets(response, sizeof (response) - 1, fp_command);
-                        line = string(response);
-                        mac_addr = line.substr(line.length() - HWADDR_OFFSET, 17);
-                        cout << mac_addr << endl;
-                        nc->dst_mac = mac_addr;
-                        /* close */
-                        pclose(fp_command);
-                    } else {
-                        cout << "I already know the destination mac address for this connection...it was hardcoded in the configuration file" << endl;
-                    }
-                    mac_addresses[nc->dst_label + nc->dst_if] = nc->dst_mac;
+                if (mac.length() > 0) {
+                    cout << "I already know the mac address of " << label << ":" << iface << "...it was hardcoded in the configuration file" << endl;
+                    mac_addresses[key] = mac;
+                    continue;
+                }
+                DeployJob *job = new DeployJob(label, "discovering the mac addresses");
+                if (sudo) {
+                    job->add(sshCommand(getTestbedIPFromLabel(label)) + " sudo ifconfig " + iface + " | grep " HWADDR_LABEL);
                 } else {
-                    nc->dst_mac = mac_addresses[nc->dst_label + nc->dst_if];
-                    //cout << "I learned this mac address: " << nc->dst_label << ":" << nc->dst_if << " - " << mac_addresses[nc->src_label + nc->src_if] << endl;
+                    job->add(sshCommand(getTestbedIPFromLabel(label)) + " ifconfig " + iface + " | grep " HWADDR_LABEL);
                 }
-            } else {
-                //cout << "no need to discover mac addresses - it's a connection over raw IP sockets" << endl;
+                pending[key] = job;
+                jobs.push_back(job);
             }
         }
     }
+    runJobs(jobs);
+    for (map<string, DeployJob *>::iterator it = pending.begin(); it != pending.end(); it++) {
+        DeployJob *job = (*it).second;
+        /*the line of ifconfig (ssh may print warnings before it)*/
+        istringstream output(job->output);
+        string line;
+        while (getline(output, line)) {
+            if (line.find(HWADDR_LABEL) != string::npos && line.length() >= HWADDR_OFFSET - 1) {
+                /*getline dropped the newline the offset counts*/
+                mac_addresses[(*it).first] = line.substr(line.length() + 1 - HWADDR_OFFSET, 17);
+                cout << job->node << ": " << mac_addresses[(*it).first] << endl;
+                break;
+            }
+        }
+        if (mac_addresses.find((*it).first) == mac_addresses.end()) {
+            cerr << "node " << job->node << ": could not learn a mac address (" << job->commands[0].first << ")" << endl;
+            failures++;
+        }
+        delete job;
+    }
+    for (int i = 0; i < network_nodes.size(); i++) {
+        NetworkNode *nn = network_nodes[i];
+        for (int j = 0; j < nn->connections.size(); j++) {
+            NetworkConnection *nc = nn->connections[j];
+            nc->src_mac = mac_addresses[nc->src_label + nc->src_if];
+            nc->dst_mac = mac_addresses[nc->dst_label + nc->dst_if];
+        }
+    }
+    return failures;
 }
 
 int findOffset(vector<string> &unique, string &str) {
@@ -218,6 +411,58 @@ int findOffset(vector<string> &unique, string &str) {
     return -1;
 }
 
+string Domain::deviceElements(NetworkNode *nn, int j, string &iface) {
+    ostringstream elements;
+    int burst = nn->burstSize();
+    bool user = (nn->running_mode.compare("user") == 0);
+    if (nn->profile.compare("performance") != 0) {
+        if (user) {
+            elements << "fromdev" << j << "::FromDevice(" << iface << ");" << endl << "todev" << j << "::ToDevice(" << iface << ");" << endl;
+        } else {
+            elements << "fromdev" << j << "::FromDevice(" << iface << ", BURST " << burst << ");" << endl << "todev" << j << "::ToDevice(" << iface << ", BURST " << burst << ");" << endl;
+        }
+    } else if (nn->device.compare("netmap") == 0) {
+        elements << "fromdev" << j << "::FromNetmapDevice(" << iface << ", BURST " << burst << ");" << endl << "todev" << j << "::ToNetmapDevice(" << iface << ", BURST " << burst << ");" << endl;
+    } else if (nn->device.compare("dpdk") == 0) {
+        /*the interface is the DPDK port*/
+        elements << "fromdev" << j << "::FromDPDKDevice(" << iface << ", BURST " << burst << ");" << endl << "todev" << j << "::ToDPDKDevice(" << iface << ", BURST " << burst << ");" << endl;
+    } else if (!user) {
+        /*polling, the default of the performance profile in kernel space*/
+        elements << "fromdev" << j << "::PollDevice(" << iface << ", BURST " << burst << ");" << endl << "todev" << j << "::ToDevice(" << iface << ", BURST " << burst << ");" << endl;
+    } else {
+        /*the packets of the node only, and in bursts*/
+        elements << "fromdev" << j << "::FromDevice(" << iface << ", SNIFFER false, BURST " << burst << ");" << endl << "todev" << j << "::ToDevice(" << iface << ", BURST " << burst << ");" << endl;
+    }
+    return elements.str();
+}
+
+string Domain::egressElements(NetworkNode *nn, string j) {
+    ostringstream elements;
+    elements << "tsf" << j << "::ThreadSafeQueue(" << nn->queue_size << ");" << endl;
+    if (nn->egress.compare("fifo") == 0) {
+        return elements.str();
+    }
+    /*the Forwarder paints control messages 0 and data 1 (LINK_TRAFFIC_* in src/linkheader.hh)*/
+    elements << "egress" << j << "::PaintSwitch;" << endl << "ctlq" << j << "::ThreadSafeQueue(" << nn->queue_size << ");" << endl;
+    if (nn->egress.compare("priority") == 0) {
+        elements << "sched" << j << "::PrioSched;" << endl;
+    } else {
+        elements << "sched" << j << "::StrideSched(" << nn->control_weight << ", 1);" << endl;
+    }
+    elements << "egress" << j << "[0]->ctlq" << j << "->[0]sched" << j << ";" << endl << "egress" << j << "[1]->tsf" << j << "->[1]sched" << j << ";" << endl;
+    return elements.str();
+}
+
+string Domain::egressPath(NetworkNode *nn, string j, int port, string next) {
+    ostringstream path;
+    if (nn->egress.compare("fifo") == 0) {
+        path << "fw[" << port << "]->tsf" << j << "->" << next;
+    } else {
+        path << "fw[" << port << "]->egress" << j << ";" << endl << "sched" << j << "->" << next;
+    }
+    return path.str();
+}
+
 void Domain::writeClickFiles(bool montoolstub) {
     ofstream click_conf;
     for (int i = 0; i < network_nodes.size(); i++) {
@@ -225,8 +470,9 @@ void Domain::writeClickFiles(bool montoolstub) {
         vector<string> unique_srcips;
         NetworkNode *nn = network_nodes[i];
         click_conf.open((write_conf + nn->label + ".conf").c_str());
-        if (montoolstub && (nn->running_mode.compare("user") == 0)) {
-            click_conf << "require(blackadder_flooding); \n\nControlSocket(\"TCP\",55555);\n\n " << endl << endl;
+        if ((montoolstub || telemetry) && (nn->running_mode.compare("user") == 0)) {
+            /*our proposal the telemetry collector reads the handlers through it too*/
+            click_conf << "require(blackadder_flooding); \n\nControlSocket(\"TCP\"," << CONTROL_SOCKET_PORT << ");\n\n " << endl << endl;
         } else {
             click_conf << "require(blackadder_flooding);" << endl << endl;
         }
@@ -234,6 +480,23 @@ void Domain::writeClickFiles(bool montoolstub) {
         click_conf << "globalconf::GlobalConf(MODE " << overlay_mode << ", NODEID " << nn->label << "," << endl;
         click_conf << "DEFAULTRV " << nn->FID_to_RV.to_string() << "," << endl;
         click_conf << "TMFID     " << nn->FID_to_TM.to_string() << "," << endl;
+        if (nn->FID_to_RV_shards.size() > 0) {
+            click_conf << "RVSHARDS \"";
+            for (int j = 0; j < nn->FID_to_RV_shards.size(); j++) {
+                click_conf << ((j > 0) ? " " : "") << RV_nodes[j]->label << ":" << nn->FID_to_RV_shards[j].to_string();
+            }
+            click_conf << "\"," << endl;
+        }
+        if (nn->FID_to_TM_replicas.size() > 0) {
+            click_conf << "TMREPLICAS \"";
+            for (int j = 0; j < nn->FID_to_TM_replicas.size(); j++) {
+                click_conf << ((j > 0) ? " " : "") << TM_nodes[j]->label << ":" << nn->FID_to_TM_replicas[j].to_string();
+            }
+            click_conf << "\"," << endl;
+        }
+        if (telemetry) {
+            click_conf << "TELEMETRY true, TELEMETRY_SAMPLE " << telemetry_sample << "," << endl;
+        }
         click_conf << "iLID      " << nn->iLid.to_string() << ");" << endl << endl;
 
         click_conf << "localRV::LocalRV(globalconf," << nn->connections.size() /*number of neighbours*/ << "," << endl;
@@ -248,6 +511,13 @@ void Domain::writeClickFiles(bool montoolstub) {
         }
         click_conf << "netlink::Netlink();" << endl << "tonetlink::ToNetlink(netlink);" << endl << "fromnetlink::FromNetlink(netlink);" << endl << endl;
         click_conf << "proxy::LocalProxy(globalconf);" << endl << endl;
+        /*our proposal the keywords of the Forwarder follow its links*/
+        ostringstream fw_keywords;
+        if (load_report > 0) {
+            fw_keywords << ", LOAD_REPORT " << load_report;
+        }
+        fw_keywords << ");";
+        string fw_end = fw_keywords.str();
         click_conf << "fw::Forwarder(globalconf," << nn->connections.size() << "," << endl;
         for (int j = 0; j < nn->connections.size(); j++) {
             NetworkConnection *nc = nn->connections[j];
@@ -256,15 +526,15 @@ void Domain::writeClickFiles(bool montoolstub) {
                 if ((offset = findOffset(unique_ifaces, nc->src_if)) == -1) {
                     unique_ifaces.push_back(nc->src_if);
                     if (j == nn->connections.size() - 1) {
-                        click_conf << unique_ifaces.size() << "," << nc->src_mac << "," << nc->dst_mac << "," << nc->LID.to_string() << ");" << endl << endl;
+                        click_conf << unique_ifaces.size() << "," << nc->src_mac << "," << nc->dst_mac << "," << nc->LIDString() << fw_end << endl << endl;
                     } else {
-                        click_conf << unique_ifaces.size() << "," << nc->src_mac << "," << nc->dst_mac << "," << nc->LID.to_string() << "," << endl;
+                        click_conf << unique_ifaces.size() << "," << nc->src_mac << "," << nc->dst_mac << "," << nc->LIDString() << "," << endl;
                     }
                 } else {
                     if (j == nn->connections.size() - 1) {
-                        click_conf << offset + 1 << "," << nc->src_mac << "," << nc->dst_mac << "," << nc->LID.to_string() << ");" << endl << endl;
+                        click_conf << offset + 1 << "," << nc->src_mac << "," << nc->dst_mac << "," << nc->LIDString() << fw_end << endl << endl;
                     } else {
-                        click_conf << offset + 1 << "," << nc->src_mac << "," << nc->dst_mac << "," << nc->LID.to_string() << "," << endl;
+                        click_conf << offset + 1 << "," << nc->src_mac << "," << nc->dst_mac << "," << nc->LIDString() << "," << endl;
                     }
                 }
             } else {
@@ -273,27 +543,25 @@ void Domain::writeClickFiles(bool montoolstub) {
                     //cout << "PUSHING BACK " << nc->src_ip << endl;
                     //cout << unique_srcips.size() << endl;
                     if (j == nn->connections.size() - 1) {
-                        click_conf << unique_srcips.size() << "," << nc->src_ip << "," << nc->dst_ip << "," << nc->LID.to_string() << ");" << endl << endl;
+                        click_conf << unique_srcips.size() << "," << nc->src_ip << "," << nc->dst_ip << "," << nc->LIDString() << fw_end << endl << endl;
                     } else {
-                        click_conf << unique_srcips.size() << "," << nc->src_ip << "," << nc->dst_ip << "," << nc->LID.to_string() << "," << endl;
+                        click_conf << unique_srcips.size() << "," << nc->src_ip << "," << nc->dst_ip << "," << nc->LIDString() << "," << endl;
                     }
                 } else {
                     if (j == nn->connections.size() - 1) {
-                        click_conf << offset + 1 << "," << nc->src_ip << "," << nc->dst_ip << "," << nc->LID.to_string() << ");" << endl << endl;
+                        click_conf << offset + 1 << "," << nc->src_ip << "," << nc->dst_ip << "," << nc->LIDString() << fw_end << endl << endl;
                     } else {
-                        click_conf << offset + 1 << "," << nc->src_ip << "," << nc->dst_ip << "," << nc->LID.to_string() << "," << endl;
+                        click_conf << offset + 1 << "," << nc->src_ip << "," << nc->dst_ip << "," << nc->LIDString() << "," << endl;
                     }
                 }
             }
         }
         if (overlay_mode.compare("mac") == 0) {
             for (int j = 0; j < unique_ifaces.size(); j++) {
-                click_conf << "tsf" << j << "::ThreadSafeQueue(1000);" << endl;
-                if (nn->running_mode.compare("user") == 0) {
-                    click_conf << "fromdev" << j << "::FromDevice(" << unique_ifaces[j] << ");" << endl << "todev" << j << "::ToDevice(" << unique_ifaces[j] << ");" << endl;
-                } else {
-                    click_conf << "fromdev" << j << "::FromDevice(" << unique_ifaces[j] << ", BURST 8);" << endl << "todev" << j << "::ToDevice(" << unique_ifaces[j] << ", BURST 8);" << endl;
-                }
+                ostringstream tag;
+                tag << j;
+                click_conf << egressElements(nn, tag.str());
+                click_conf << deviceElements(nn, j, unique_ifaces[j]);
             }
             /*Necessary Click Elements*/
             if (nn->running_mode.compare("user") == 0) {
@@ -305,46 +573,94 @@ void Domain::writeClickFiles(bool montoolstub) {
             }
         } else {
             /*raw sockets here*/
-            click_conf << "tsf" << "::ThreadSafeQueue(1000);" << endl;
+            click_conf << egressElements(nn, "");
             if (nn->running_mode.compare("user") == 0) {
-                click_conf << "rawsocket" << "::RawSocket(UDP, 55000)" << endl;
-                click_conf << "classifier::IPClassifier(dst udp port 55000 and src udp port 55000)" << endl;
+                click_conf << "rawsocket" << "::RawSocket(UDP, 55000);" << endl;
+                /*our proposal the message class is the UDP source port (see src/linkheader.hh), in the order of the ethertypes of the mac Classifier*/
+                click_conf << "classifier::IPClassifier(dst udp port 55000 and src udp port 55000, dst udp port 55000 and src udp port 55002, "
+                        << "dst udp port 55000 and src udp port 55001, dst udp port 55000 and src udp port 55003, dst udp port 55000 and src udp port 55004);" << endl;
             } else {
                 cerr << "Something is wrong...I should not build click config using raw sockets for node " << nn->label << "that will run in kernel space" << endl;
             }
         }
         /*Our proposal create a Cacheunit*/
-        if (overlay_mode.compare("mac") == 0)
-        {
-            click_conf<<"cacheunit"<<"::CacheUnit(globalconf);"<<endl ;
-        }
-        else
-        {
-            cerr<<"Right now only work under mac"<<endl ;
+        click_conf<<"cacheunit"<<"::CacheUnit(globalconf);"<<endl ;
+
+        /*with multiple threads the forwarding of publications (fw input 1) runs on every thread:
+         *the classified publications are spread by FID over one queue per worker thread (so that the packets of a FID stay in order)
+         *all other elements (and the local deliveries from the workers) stay on thread 0*/
+        bool multi_threaded = (nn->threads > 1) && (overlay_mode.compare("mac") == 0) && (nn->running_mode.compare("user") == 0);
+        if (multi_threaded) {
+            /*our proposal the performance profile moves bursts through the queues too*/
+            ostringstream unqueue;
+            unqueue << "Unqueue(";
+            if (nn->profile.compare("performance") == 0) {
+                unqueue << "BURST " << nn->burstSize();
+            }
+            unqueue << ");";
+            click_conf << "rxswitch::HashSwitch(14, " << fid_len << ");" << endl;
+            for (int t = 1; t < nn->threads; t++) {
+                click_conf << "rxq" << t << "::ThreadSafeQueue(" << nn->queue_size << ");" << endl << "rxuq" << t << "::" << unqueue.str() << endl;
+            }
+            click_conf << "localq::ThreadSafeQueue(" << nn->queue_size << ");" << endl << "localuq::" << unqueue.str() << endl;
         }
 
         /*Now link all the elements appropriately*/
-        click_conf << endl << endl << "proxy[0]->tonetlink;" << endl << "fromnetlink->[0]proxy;" << endl << "localRV[0]->[1]proxy[1]->[0]localRV;" << endl << "proxy[2]-> [0]fw[0] -> [2]proxy;" << endl;
+        click_conf << endl << endl << "proxy[0]->tonetlink;" << endl << "fromnetlink->[0]proxy;" << endl << "localRV[0]->[1]proxy[1]->[0]localRV;" << endl;
+        if (multi_threaded) {
+            click_conf << "proxy[2]-> [0]fw[0] -> localq -> localuq -> [2]proxy;" << endl;
+        } else {
+            click_conf << "proxy[2]-> [0]fw[0] -> [2]proxy;" << endl;
+        }
 
         if (overlay_mode.compare("mac") == 0) {
             for (int j = 0; j < unique_ifaces.size(); j++) {
+                ostringstream rx, tag, todev;
+                tag << j;
+                todev << "todev" << j;
+                if (multi_threaded && j == 0) {
+                    rx << "rxswitch";
+                } else {
+                    rx << "[" << (j + 1) << "]fw";
+                }
                 if (montoolstub && j == 0 && (nn->running_mode.compare("user") == 0)) {
-                    click_conf << "fw[" << (j + 1) << "]->tsf" << j << "->outc::Counter()->todev" << j << ";" << endl;
-                    click_conf << "fromdev[" << j << "]->classifier[0]->inc::Counter()  -> [" << (j + 1) << "]fw;" << endl;
+                    click_conf << egressPath(nn, tag.str(), j + 1, "outc::Counter()->" + todev.str()) << ";" << endl;
+                    click_conf << "fromdev[" << j << "]->classifier[0]->inc::Counter()  -> " << rx.str() << ";" << endl;
                 } else {
-                    click_conf << "fw[" << (j + 1) << "]->tsf" << j << "->todev" << j << ";" << endl;
-                    click_conf << "fromdev" << j << "->classifier[0]->[" << (j + 1) << "]fw;" << endl;
+                    click_conf << egressPath(nn, tag.str(), j + 1, todev.str()) << ";" << endl;
+                    click_conf << "fromdev" << j << "->classifier[0]->" << rx.str() << ";" << endl;
                 }
             }
+            if (multi_threaded) {
+                for (int t = 1; t < nn->threads; t++) {
+                    click_conf << "rxswitch[" << (t - 1) << "]->rxq" << t << "->rxuq" << t << "->[1]fw;" << endl;
+                }
+                /*pin the workers - everything else runs on thread 0*/
+                click_conf << "StaticThreadSched(fromdev0 0, todev0 0, localuq 0";
+                for (int t = 1; t < nn->threads; t++) {
+                    click_conf << ", rxuq" << t << " " << t;
+                }
+                for (int s = 0; s < nn->sched.size(); s++) {
+                    click_conf << ", " << nn->sched[s];
+                }
+                click_conf << ");" << endl;
+            } else if (nn->sched.size() > 0) {
+                /*our proposal only the pinning of the configuration file*/
+                click_conf << "StaticThreadSched(";
+                for (int s = 0; s < nn->sched.size(); s++) {
+                    click_conf << ((s > 0) ? ", " : "") << nn->sched[s];
+                }
+                click_conf << ");" << endl;
+            }
             if (nn->running_mode.compare("kernel") == 0) {
                 click_conf << "classifier[1]->tohost;" << endl;
             }
         } else {
             /*raw sockets here*/
             if (montoolstub) {
-                click_conf << "fw[1] -> tsf -> outc::Counter() -> rawsocket -> classifier -> inc::Counter()  -> [1]fw" << endl;
+                click_conf << egressPath(nn, "", 1, "outc::Counter() -> rawsocket -> classifier -> inc::Counter()  -> [1]fw") << ";" << endl;
             } else {
-                click_conf << "fw[1] ->  tsf -> rawsocket -> classifier -> [1]fw" << endl;
+                click_conf << egressPath(nn, "", 1, "rawsocket -> classifier -> [1]fw") << ";" << endl;
             }
         }
 
@@ -381,124 +697,296 @@ void Domain::writeClickFiles(bool montoolstub) {
 }
 
 void Domain::scpTMConfiguration(string TM_conf) {
-    FILE *scp_command;
-    string command;
-    command = "scp " + write_conf + TM_conf + " " + user + "@" + TM_node->testbed_ip + ":" + write_conf;
-    cout << command << endl;
-    scp_command = popen(command.c_str(), "r");
-    /* close */
-    pclose(scp_command);
+    vector<DeployJob *> jobs;
+    for (int i = 0; i < TM_nodes.size(); i++) {
+        NetworkNode *nn = TM_nodes[i];
+        DeployJob *job = new DeployJob(nn->label, "copying the TM configuration");
+        /*every replica has its own copy (see deploy.cpp), it is written as TM_conf on the node*/
+        string local_conf = (TM_nodes.size() > 1) ? nn->label + "_" + TM_conf : TM_conf;
+        job->add(scpCommand() + write_conf + local_conf + " " + user + "@" + nn->testbed_ip + ":" + write_conf + TM_conf);
+        jobs.push_back(job);
+    }
+    runJobs(jobs);
+    for (int i = 0; i < jobs.size(); i++) {
+        delete jobs[i];
+    }
 }
 
 void Domain::scpClickFiles() {
-    FILE *scp_command;
-    string command;
+    vector<DeployJob *> jobs;
     for (int i = 0; i < network_nodes.size(); i++) {
         NetworkNode *nn = network_nodes[i];
-        command = "scp " + write_conf + nn->label + ".conf" + " " + user + "@" + nn->testbed_ip + ":" + write_conf;
-        cout << command << endl;
-        scp_command = popen(command.c_str(), "r");
-        if (scp_command == NULL) {
-            cerr << "Failed to scp click file to node " << nn->label << endl;
-        }
-        /* close */
-        pclose(scp_command);
+        DeployJob *job = new DeployJob(nn->label, "copying the Click configurations");
+        job->add(scpCommand() + write_conf + nn->label + ".conf" + " " + user + "@" + nn->testbed_ip + ":" + write_conf);
+        jobs.push_back(job);
+    }
+    runJobs(jobs);
+    for (int i = 0; i < jobs.size(); i++) {
+        delete jobs[i];
     }
 }
 
 void Domain::startClick() {
-    FILE *ssh_command;
-    string command;
+    vector<DeployJob *> jobs;
+    string sudo_str = sudo ? "sudo " : "";
     for (int i = 0; i < network_nodes.size(); i++) {
         NetworkNode *nn = network_nodes[i];
-        /*kill click first both from kernel and user space*/
-        if (sudo) {
-            command = "ssh " + user + "@" + nn->testbed_ip + " \"sudo pkill click\"";
+        string ssh = sshCommand(nn->testbed_ip);
+        DeployJob *job = new DeployJob(nn->label, "starting Click");
+        /*kill click first both from kernel and user space - there may be none to kill*/
+        job->add(ssh + " \"" + sudo_str + "pkill click\"", false);
+        job->add(ssh + " \"" + sudo_str + click_home + "sbin/click-uninstall\"", false);
+        /*now start click*/
+        if (nn->running_mode.compare("user") == 0) {
+            string threads_arg;
+            if (nn->threads > 1) {
+                ostringstream threads_str;
+                threads_str << "--threads=" << nn->threads << " ";
+                /*our proposal pin each Click thread to its own core*/
+                if (nn->profile.compare("performance") == 0) {
+                    threads_str << "--affinity ";
+                }
+                threads_arg = threads_str.str();
+            }
+            if (nn->click_args.length() > 0) {
+                threads_arg += nn->click_args + " ";
+            }
+            job->add(ssh + " \"" + sudo_str + click_home + "bin/click " + threads_arg + write_conf + nn->label + ".conf > /tmp/flooding.log 2>&1 &\"");
         } else {
-            command = "ssh " + user + "@" + nn->testbed_ip + " \"pkill click\"";
+            job->add(ssh + " \"" + sudo_str + click_home + "sbin/click-install " + write_conf + nn->label + ".conf > /dev/null 2>&1 &\"");
+        }
+        jobs.push_back(job);
+    }
+    runJobs(jobs);
+    for (int i = 0; i < jobs.size(); i++) {
+        delete jobs[i];
+    }
+}
+
+void Domain::startTM() {
+    vector<DeployJob *> jobs;
+    for (int i = 0; i < TM_nodes.size(); i++) {
+        string ssh = sshCommand(TM_nodes[i]->testbed_ip);
+        DeployJob *job = new DeployJob(TM_nodes[i]->label, "starting the Topology Manager");
+        /*kill the topology manager first*/
+        job->add(ssh + " \"pkill -9 tm\"", false);
+        /*now start the TM*/
+        job->add(ssh + " \"/home/" + "/flooding/TopologyManager/tm " + write_conf + "topology.tmb > /tmp/tm.log 2>&1 &\"");
+        jobs.push_back(job);
+    }
+    runJobs(jobs);
+    for (int i = 0; i < jobs.size(); i++) {
+        delete jobs[i];
+    }
+}
+
+/*our proposal reads a handler through the ControlSocket of a user space node: the greeting, then "READ handler" answered by a status line, "DATA n" and n bytes*/
+static bool readControlSocket(const string &ip, const string &handler, string &data, string &error) {
+    struct sockaddr_in addr;
+    struct timeval timeout = {5, 0};
+    memset(&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(CONTROL_SOCKET_PORT);
+    if (inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) != 1) {
+        error = "bad testbed_ip " + ip;
+        return false;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        error = strerror(errno);
+        return false;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof (timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof (timeout));
+    if (connect(fd, (struct sockaddr *) &addr, sizeof (addr)) < 0) {
+        error = string("cannot connect to the ControlSocket: ") + strerror(errno);
+        close(fd);
+        return false;
+    }
+    string command = "READ " + handler + "\r\nQUIT\r\n";
+    if (write(fd, command.data(), command.length()) != (ssize_t) command.length()) {
+        error = "cannot write to the ControlSocket";
+        close(fd);
+        return false;
+    }
+    string reply;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof (buffer))) > 0) {
+        reply.append(buffer, n);
+    }
+    close(fd);
+    /*skip the greeting*/
+    size_t status = reply.find('\n');
+    if (status == string::npos || reply.compare(status + 1, 3, "200") != 0) {
+        error = "the ControlSocket could not read " + handler + " (is the node built with telemetry?)";
+        return false;
+    }
+    size_t length = reply.find("DATA ", status);
+    size_t start = reply.find('\n', length);
+    if (length == string::npos || start == string::npos) {
+        error = "no DATA in the reply of the ControlSocket";
+        return false;
+    }
+    size_t bytes = strtoul(reply.c_str() + length + 5, NULL, 10);
+    data = reply.substr(start + 1, bytes);
+    return true;
+}
+
+/*our proposal the label of a node in the hop traces: the FNV-1a hash of its NODEID folded to 16 bits (Telemetry::node_label of the Click elements)*/
+static unsigned int telemetryLabel(const string &label) {
+    uint32_t hash = 2166136261U;
+    for (size_t i = 0; i < label.length(); i++) {
+        hash ^= (unsigned char) label[i];
+        hash *= 16777619U;
+    }
+    return ((hash >> 16) ^ (hash & 0xFFFF)) & 0xFFFF;
+}
+
+/*our proposal the upper bound in usec of the bucket in which the latency of quantile q of the buckets lies*/
+static double telemetryQuantile(const vector<uint64_t> &buckets, uint64_t count, double q) {
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (count > 0 && seen >= q * count) {
+            return (double) (1ULL << i);
         }
-        cout << command << endl;
-        ssh_command = popen(command.c_str(), "r");
-        if (ssh_command == NULL) {
-            cerr << "Failed to stop click at node " << nn->label << endl;
+    }
+    return 0;
+}
+
+int Domain::collectTelemetry() {
+    vector<DeployJob *> jobs;
+    vector<string> histograms(network_nodes.size()), traces(network_nodes.size());
+    vector<bool> read_ok(network_nodes.size(), false);
+    string sudo_str = sudo ? "sudo " : "";
+    int failures = 0;
+    /*kernel nodes through /click - the marker separates the two handlers in the output of the job*/
+    for (int i = 0; i < network_nodes.size(); i++) {
+        NetworkNode *nn = network_nodes[i];
+        if (nn->running_mode.compare("user") == 0) {
+            string error;
+            read_ok[i] = readControlSocket(nn->testbed_ip, "globalconf.telemetry", histograms[i], error)
+                    && readControlSocket(nn->testbed_ip, "globalconf.hop_traces", traces[i], error);
+            if (!read_ok[i]) {
+                cerr << "node " << nn->label << ": reading the telemetry failed: " << error << endl;
+            }
+            continue;
         }
-        pclose(ssh_command);
-        if (sudo) {
-            command = "ssh " + user + "@" + nn->testbed_ip + " \"sudo " + click_home + "sbin/click-uninstall\" ";
-        } else {
-            command = "ssh " + user + "@" + nn->testbed_ip + " \"" + click_home + "sbin/click-uninstall \"";
+        DeployJob *job = new DeployJob(nn->label, "reading the telemetry");
+        job->add(sshCommand(nn->testbed_ip) + " \"" + sudo_str + "cat /click/globalconf/telemetry && echo '#hop_traces' && " + sudo_str + "cat /click/globalconf/hop_traces\"");
+        jobs.push_back(job);
+    }
+    runJobs(jobs);
+    for (int i = 0, k = 0; i < network_nodes.size(); i++) {
+        if (network_nodes[i]->running_mode.compare("user") == 0) {
+            continue;
         }
-        cout << command << endl;
-        ssh_command = popen(command.c_str(), "r");
-        if (ssh_command == NULL) {
-            cerr << "Failed to stop click at node " << nn->label << endl;
+        DeployJob *job = jobs[k++];
+        size_t marker = job->output.find("#hop_traces\n");
+        if (job->status == 0 && marker != string::npos) {
+            read_ok[i] = true;
+            histograms[i] = job->output.substr(0, marker);
+            traces[i] = job->output.substr(marker + 12);
         }
-        pclose(ssh_command);
-        /*now start click*/
-        if (nn->running_mode.compare("user") == 0) {
-            if (sudo) {
-                command = "ssh " + user + "@" + nn->testbed_ip + " \"sudo " + click_home + "bin/click " + write_conf + nn->label + ".conf > /tmp/flooding.log 2>&1 &\"";
-            } else {
-                command = "ssh " + user + "@" + nn->testbed_ip + " \"" + click_home + "bin/click " + write_conf + nn->label + ".conf > /tmp/flooding.log 2>&1 &\"";
+        delete job;
+    }
+    /*merge the histograms of all nodes, the stages in the order of the nodes*/
+    vector<string> stages;
+    map<string, vector<uint64_t> > merged;
+    map<unsigned int, string> labels;
+    uint64_t skewed = 0;
+    for (int i = 0; i < network_nodes.size(); i++) {
+        labels[telemetryLabel(network_nodes[i]->label)] = network_nodes[i]->label;
+        if (!read_ok[i]) {
+            failures++;
+            continue;
+        }
+        istringstream lines(histograms[i]);
+        string line;
+        while (getline(lines, line)) {
+            istringstream fields(line);
+            string stage;
+            uint64_t value;
+            fields >> stage;
+            if (stage.compare("skewed") == 0) {
+                fields >> value;
+                skewed += value;
+                continue;
             }
-            cout << command << endl;
-            ssh_command = popen(command.c_str(), "r");
-            if (ssh_command == NULL) {
-                cerr << "Failed to start click at node " << nn->label << endl;
+            if (stage.empty() || !(fields >> value)) {
+                continue;
             }
-            pclose(ssh_command);
-        } else {
-            if (sudo) {
-                command = "ssh " + user + "@" + nn->testbed_ip + " \"sudo " + click_home + "sbin/click-install " + write_conf + nn->label + ".conf > /dev/null 2>&1 &\"";
-            } else {
-                command = "ssh " + user + "@" + nn->testbed_ip + " \"" + click_home + "sbin/click-install " + write_conf + nn->label + ".conf > /dev/null 2>&1 &\"";
+            if (merged.find(stage) == merged.end()) {
+                stages.push_back(stage);
+                merged[stage] = vector<uint64_t>(TELEMETRY_BUCKETS + 1, 0);
             }
-            cout << command << endl;
-            ssh_command = popen(command.c_str(), "r");
-            if (ssh_command == NULL) {
-                cerr << "Failed to start click at node " << nn->label << endl;
+            vector<uint64_t> &counts = merged[stage];
+            counts[0] += value;
+            for (int j = 1; j <= TELEMETRY_BUCKETS && (fields >> value); j++) {
+                counts[j] += value;
             }
-            pclose(ssh_command);
         }
     }
-}
-
-void Domain::startTM() {
-    FILE *ssh_command;
-    string command;
-    /*kill the topology manager first*/
-    command = "ssh " + user + "@" + TM_node->testbed_ip + " \"pkill -9 tm\"";
-    cout << command << endl;
-    ssh_command = popen(command.c_str(), "r");
-    if (ssh_command == NULL) {
-        cerr << "Failed to stop Topology Manager at node " << TM_node->label << endl;
-    }
-    pclose(ssh_command);
-    /*now start the TM*/
-    command = "ssh " + user + "@" + TM_node->testbed_ip + " \"/home/" + "/flooding/TopologyManager/tm " + write_conf + "topology.graphml > /tmp/tm.log 2>&1 &\"";
-    cout << command << endl;
-    ssh_command = popen(command.c_str(), "r");
-    if (ssh_command == NULL) {
-        cerr << "Failed to start Topology Manager at node " << TM_node->label << endl;
-    }
-    pclose(ssh_command);
+    ofstream report_file((write_conf + "telemetry_report.txt").c_str());
+    report_file << "# per stage latencies of " << network_nodes.size() - failures << " of " << network_nodes.size() << " nodes, " << skewed << " skewed (negative) latencies" << endl;
+    report_file << "# stage count p50 p90 p99 (usec, upper bounds of the log2 buckets) and the " << TELEMETRY_BUCKETS << " buckets" << endl;
+    cout << "telemetry of " << network_nodes.size() - failures << " of " << network_nodes.size() << " nodes (" << write_conf << "telemetry_report.txt):" << endl;
+    for (int i = 0; i < stages.size(); i++) {
+        vector<uint64_t> &counts = merged[stages[i]];
+        vector<uint64_t> buckets(counts.begin() + 1, counts.end());
+        double p50 = telemetryQuantile(buckets, counts[0], 0.5), p90 = telemetryQuantile(buckets, counts[0], 0.9), p99 = telemetryQuantile(buckets, counts[0], 0.99);
+        report_file << stages[i] << " " << counts[0] << " " << p50 << " " << p90 << " " << p99;
+        for (int j = 0; j < buckets.size(); j++) {
+            report_file << " " << buckets[j];
+        }
+        report_file << endl;
+        cout << "  " << stages[i] << ": " << counts[0] << " latencies, p50 < " << p50 << " usec, p90 < " << p90 << " usec, p99 < " << p99 << " usec" << endl;
+    }
+    /*the hop traces, node:usec per hop with the node labels resolved*/
+    int trace_count = 0;
+    report_file << "# hop traces: the receiver, then node usec_since_the_previous_hop per hop (the clocks of the nodes must be synchronised)" << endl;
+    for (int i = 0; i < network_nodes.size(); i++) {
+        istringstream lines(traces[i]);
+        string line;
+        while (getline(lines, line)) {
+            istringstream hops(line);
+            string hop;
+            uint32_t previous = 0;
+            bool first = true;
+            report_file << "trace " << network_nodes[i]->label;
+            while (hops >> hop) {
+                size_t colon = hop.find(':');
+                if (colon == string::npos) {
+                    continue;
+                }
+                unsigned int node = strtoul(hop.c_str(), NULL, 10);
+                uint32_t usec = strtoul(hop.c_str() + colon + 1, NULL, 10);
+                report_file << " " << (labels.find(node) != labels.end() ? labels[node] : hop.substr(0, colon)) << " " << (first ? 0 : (int32_t) (usec - previous));
+                previous = usec;
+                first = false;
+            }
+            report_file << endl;
+            trace_count++;
+        }
+    }
+    report_file.close();
+    cout << "  " << trace_count << " hop traces" << endl;
+    return failures;
 }
 
 void Domain::scpClickBinary(string tgzfile) {
-    FILE *scp_command;
-    char response[1035];
-    string command;
+    vector<DeployJob *> jobs;
     for (int i = 0; i < network_nodes.size(); i++) {
         NetworkNode *nn = network_nodes[i];
-
-        command = "scp ./" + tgzfile + "  " + user + "@" + nn->testbed_ip + ":";
-        cout << command << endl;
-        system(command.c_str());
-
-        command = "ssh -X " + user + "@" + nn->testbed_ip + " 'tar zxvf ~/" + tgzfile + "'";
-        cout << command << endl;
-        system(command.c_str());
-
+        DeployJob *job = new DeployJob(nn->label, "installing " + tgzfile);
+        job->add(scpCommand() + "./" + tgzfile + "  " + user + "@" + nn->testbed_ip + ":");
+        job->add(sshCommand(nn->testbed_ip) + " 'tar zxf ~/" + tgzfile + "'");
+        jobs.push_back(job);
+    }
+    runJobs(jobs);
+    for (int i = 0; i < jobs.size(); i++) {
+        delete jobs[i];
     }
 }
 
@@ -524,7 +1012,23 @@ string Domain::writeConfigFile(string filename) {
         } else {
             configfile << "SUDO = false;\n";
         }
-        configfile << "OVERLAY_MODE = \"" << overlay_mode << "\";\n\n\n";
+        configfile << "OVERLAY_MODE = \"" << overlay_mode << "\";\n";
+        configfile << "DEPLOY_JOBS = " << deploy_jobs << ";\n";
+        configfile << "SSH_MULTIPLEX = " << (ssh_multiplex ? "true" : "false") << ";\n";
+        configfile << "PROFILE = \"" << profile << "\";\n";
+        if (device.length() > 0) {
+            configfile << "DEVICE = \"" << device << "\";\n";
+        }
+        configfile << "QUEUE_SIZE = " << queue_size << ";\n";
+        configfile << "BURST = " << burst << ";\n";
+        configfile << "EGRESS = \"" << egress << "\";\n";
+        configfile << "CONTROL_WEIGHT = " << control_weight << ";\n";
+        if (telemetry) {
+            configfile << "TELEMETRY = true;\n";
+            configfile << "TELEMETRY_SAMPLE = " << telemetry_sample << ";\n";
+        }
+        configfile << "LID_MODE = \"" << lid_mode << "\";\n";
+        configfile << "LID_BITS = " << lid_bits << ";\n\n\n";
         //network
         configfile << "network = {\n";
         configfile << "    nodes = (\n";
@@ -534,6 +1038,9 @@ string Domain::writeConfigFile(string filename) {
                 configfile << "     {\n";
                 configfile << "       testbed_ip = \"" << nn->testbed_ip << "\";\n";
                 configfile << "       running_mode = \"" << nn->running_mode << "\";\n";
+                if (nn->threads > 1) {
+                    configfile << "       threads = " << nn->threads << ";\n";
+                }
                 configfile << "       label = \"" << nn->label << "\";\n";
                 if ((nn->isRV == true) && (nn->isTM == true)) {
                     configfile << "       role = [\"RV\",\"TM\"];\n";
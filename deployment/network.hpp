@@ -20,14 +20,79 @@
 #include <string>
 #include <vector>
 #include <fstream>
+#include <utility>
 
 #include "bitvector.hpp"
 
 using namespace std;
 
+/*our proposal the remote steps of the deployment run for this many nodes at a time (DEPLOY_JOBS in the configuration file)*/
+#define DEFAULT_DEPLOY_JOBS 16
+
+/*our proposal the ssh (and scp) options that reuse the connection master opened by Domain::openSSHMasters() - without a master ssh connects as usual*/
+#define SSH_MUX_OPTIONS "-o ControlMaster=no -o ControlPath=/tmp/blackadder-deploy-%r@%h:%p"
+
+/*our proposal how long an idle connection master stays up, in seconds*/
+#define SSH_MUX_PERSIST 600
+
+/*our proposal the length of the Click queues of a node (QUEUE_SIZE, queue_size)*/
+#define DEFAULT_QUEUE_SIZE 1000
+
+/*our proposal the device burst of the default profile in kernel space and of the performance profile*/
+#define DEFAULT_BURST 8
+#define PERFORMANCE_BURST 32
+
+/*our proposal the TCP port of the ControlSocket of user space nodes (the monitor tool stub and the telemetry collector)*/
+#define CONTROL_SOCKET_PORT 55555
+
+/*our proposal the number of log2 usec buckets of the telemetry histograms of the nodes (TELEMETRY_BUCKETS of the Click elements)*/
+#define TELEMETRY_BUCKETS 32
+
+/*our proposal the share of control messages with weighted egress queues (control_weight tickets of the StrideSched for every data ticket)*/
+#define DEFAULT_CONTROL_WEIGHT 4
+
 class NetworkConnection;
 class NetworkNode;
 
+/**@brief (Deployment Application) our proposal an entry of the traffic matrix (TRAFFIC) the LIDs are optimized for: publications from node src to node dst, weight times as often as the others.
+ */
+class TrafficDemand {
+public:
+    string src;
+    string dst;
+    double weight;
+};
+
+/**@brief (Deployment Application) our proposal a remote step of the deployment for one node (e.g. copying its Click configuration).
+ *
+ * Its commands run one after the other. The first one that fails and must succeed ends the job.
+ */
+class DeployJob {
+public:
+    DeployJob(string _node, string _step) : node(_node), step(_step), status(0) {}
+    /**@brief appends a command. Its failure is reported (and ends the job) only if must_succeed.
+     */
+    void add(string command, bool must_succeed = true) {
+        commands.push_back(make_pair(command, must_succeed));
+    }
+    /**@brief the label of the node.
+     */
+    string node;
+    /**@brief what the job does, for the report.
+     */
+    string step;
+    vector<pair<string, bool> > commands;
+    /**@brief the output (stdout and stderr) of all commands that ran.
+     */
+    string output;
+    /**@brief 0 if the job succeeded, otherwise the exit status of the failed command (-1 if it could not run).
+     */
+    int status;
+    /**@brief the command that failed.
+     */
+    string failed;
+};
+
 /**@brief (Deployment Application) a representation of a network domain as read from the configuration file.
  * 
  * It contains all network nodes with their connections.
@@ -47,6 +112,12 @@ public:
     /**@brief a pointer to a NetworkNode that is the TopologyManager of the domain.
      */
     NetworkNode *RV_node;
+    /**@brief all RV nodes of the domain (the first one is RV_node). With more than one, the RV state is sharded by root scope.
+     */
+    vector<NetworkNode *> RV_nodes;
+    /**@brief our proposal all TM nodes of the domain (the first one is TM_node). With more than one, every node gets TMREPLICAS and the LocalRVs share the TM requests among the replicas.
+     */
+    vector<NetworkNode *> TM_nodes;
     /**@brief number of nodes in the domain.
      */
     unsigned int number_of_nodes;
@@ -74,10 +145,53 @@ public:
     /**@brief the overlay mode. mac or ip
      */
     string overlay_mode;
+    /**@brief our proposal how the Topology Manager builds multicast FIDs: shortest_path (default) or steiner
+     */
+    string tm_fid_mode;
+    /**@brief our proposal the number of LID tables d (a power of 2): every link gets d LIDs and the TM chooses, per delivery tree, the table with the lowest fill.
+     * The table index is carried in the top log2(d) bits of FIDs, which no LID uses.
+     */
+    int lid_tables;
+    /**@brief our proposal how LIDs are assigned (LID_MODE): random (default) or optimized (see LIDOptimizer), with lid_bits bits (LID_BITS, 0 chooses them from the size of the deliveries),
+     * searching for lid_iterations steps (LID_ITERATIONS) with lid_workers threads (LID_WORKERS) for the deliveries of traffic (TRAFFIC, all pairs of nodes if empty).
+     * lid_report (LID_REPORT) writes the report of the random LIDs too.
+     */
+    string lid_mode;
+    int lid_bits;
+    int lid_iterations;
+    int lid_workers;
+    bool lid_report;
+    vector<TrafficDemand> traffic;
+    /**@brief our proposal load aware paths: the period in seconds at which the Forwarders report the bytes sent over their links to the TM (LOAD_REPORT, 0 - the default - never)
+     * and the graph attributes of the TM, TM_LOAD_WEIGHT (what a fully utilized link costs on top of its hop), TM_LINK_CAPACITY (bytes per second) and TM_LOAD_HYSTERESIS (see TMIgraph::updateLinkLoad).
+     */
+    double load_report;
+    /**@brief our proposal per hop latency telemetry (TELEMETRY, default false): every node counts the latency histograms of its stages
+     * and 1 in telemetry_sample (TELEMETRY_SAMPLE, default 100, 0 for none) publications carries an in-band hop trace (see collectTelemetry).
+     */
+    bool telemetry;
+    int telemetry_sample;
+    double tm_load_weight;
+    double tm_link_capacity;
+    double tm_load_hysteresis;
+    /**@brief our proposal how many nodes are provisioned at a time (DEPLOY_JOBS, default DEFAULT_DEPLOY_JOBS).
+     */
+    int deploy_jobs;
+    /**@brief our proposal whether the ssh and scp commands share one connection per node (SSH_MULTIPLEX, default true).
+     */
+    bool ssh_multiplex;
+    /**@brief our proposal the defaults of the optional node parameters profile, device, queue_size, burst, egress and control_weight (PROFILE, DEVICE, QUEUE_SIZE, BURST, EGRESS and CONTROL_WEIGHT).
+     */
+    string profile;
+    string device;
+    int queue_size;
+    int burst;
+    string egress;
+    int control_weight;
     /**@brief It prints an ugly representation of the Domain.
      */
     void printDomainData();
-    /**@brief -
+    /**@brief assigns the LIDs of all connections and the iLIDs of all nodes, at random or optimized (LID_MODE).
      * 
      */
     void assignLIDs();
@@ -87,20 +201,58 @@ public:
      * @param index
      */
     void calculateLID(vector<Bitvector> &LIDs, int index);
+    /**@brief our proposal the number of FID bits that carry the LID table index (log2(lid_tables)).
+     */
+    int lidTableBits();
     /**@brief for each network node (and if the MAC address wasn't preassigned) it will ssh and learn the MAC address for all ethernet interfaces found in the configuration file.
+     *
+     * @return the number of interfaces whose MAC address could not be learned.
+     */
+    int discoverMacAddresses();
+    /**@brief our proposal runs the jobs, deploy_jobs at a time, and prints a report of the ones that failed.
+     *
+     * @return the number of failed jobs.
+     */
+    int runJobs(vector<DeployJob *> &jobs);
+    /**@brief our proposal the ssh command (without the remote command) for the node at testbed_ip.
+     */
+    string sshCommand(string testbed_ip);
+    /**@brief our proposal the scp command (without the files).
      */
-    void discoverMacAddresses();
+    string scpCommand();
+    /**@brief our proposal opens a connection master to every node (if ssh_multiplex), so that the following ssh and scp commands skip the connection setup.
+     */
+    void openSSHMasters();
+    /**@brief our proposal closes the connection masters.
+     */
+    void closeSSHMasters();
     /**@brief returns the testbed IP address (dotted decimal string) given a node label.
      * 
      * @param label a node label
      * @return the testbed IP address (dotted decimal string)
      */
     string getTestbedIPFromLabel(string label);
+    /**@brief our proposal the declarations of the FromDevice and ToDevice elements of interface j of a node, depending on its profile and device.
+     */
+    string deviceElements(NetworkNode *nn, int j, string &iface);
+    /**@brief our proposal the declarations of the egress queue(s) of interface j of a node (tsf<j>, the queue of the data with priority or weighted egress) and their internal connections.
+     */
+    string egressElements(NetworkNode *nn, string j);
+    /**@brief our proposal the connections from Forwarder output port to the (pull) element next, through the egress queue(s) of interface j.
+     */
+    string egressPath(NetworkNode *nn, string j, int port, string next);
     /**@brief It locally creates and stores all Click/Blackadder configuration files for all network nodes (depending on the running mode).
      *
      * @param montoolstub generate monitor tool counter stub or not
      */
     void writeClickFiles(bool montoolstub);
+    /**@brief our proposal reads the telemetry and hop_traces handlers of the GlobalConf of every node (through the ControlSocket of user space nodes, /click for kernel ones),
+     * merges the latency histograms of all nodes and writes them, with the hop traces, to telemetry_report.txt in WRITE_CONF and a summary to stdout.
+     * The hop_traces handler is drained, so every trace is reported once.
+     *
+     * @return the number of nodes that could not be read.
+     */
+    int collectTelemetry();
     /**@brief Given a node label, it returns a pointer to the respective NetworkNode.
      * 
      * @param label a node label.
@@ -110,9 +262,9 @@ public:
     /**@brief It copies the right Click/Blackadder configuration file to the right network node.
      */
     void scpClickFiles();
-    /**@brief Copies the .graphml file to the right folder of the right network node.
+    /**@brief Copies the .graphml (or our proposal the binary .tmb) file to the right folder of the right network node.
      * 
-     * @param name the .graphml file name.
+     * @param name the .graphml or .tmb file name.
      */
     void scpTMConfiguration(string name);
     /**@brief Copies the tar gz file to all  network nodes and decompresses it at target home folder.
@@ -137,15 +289,35 @@ public:
 
 class NetworkNode {
 public:
+    NetworkNode() : threads(1), profile("default"), queue_size(DEFAULT_QUEUE_SIZE), burst(0), egress("fifo"), control_weight(DEFAULT_CONTROL_WEIGHT) {}
     /***members****/
     string testbed_ip; //read from configuration file
     string label; //read from configuration file
     string running_mode; //user or kernel
+    int threads; //read from configuration file (optional, user mode only) - the number of Click threads
+    string profile; //read from configuration file (optional) - "default" or "performance" (polling devices, bursts, pinned threads)
+    string device; //read from configuration file (optional, performance profile) - "polling" (kernel), "netmap" or "dpdk" (user), empty for FromDevice
+    int queue_size; //read from configuration file (optional) - the length of all Click queues
+    int burst; //read from configuration file (optional) - the burst of the devices and Unqueues, 0 for the default of the profile
+    string egress; //read from configuration file (optional) - "fifo", "priority" or "weighted": the queueing of control and data messages towards the devices
+    int control_weight; //read from configuration file (optional, weighted egress) - the control tickets for every data ticket
+    vector<string> sched; //read from configuration file (optional) - more "element thread" entries for StaticThreadSched
+    string click_args; //read from configuration file (optional, user mode only) - more arguments of the click command (e.g. the DPDK EAL arguments)
+    /**@brief our proposal the burst of the devices and Unqueues (burst, or the default of the profile).
+     */
+    int burstSize() {
+        if (burst > 0) {
+            return burst;
+        }
+        return (profile.compare("performance") == 0) ? PERFORMANCE_BURST : DEFAULT_BURST;
+    }
     bool isRV; //read from configuration file
     bool isTM; //read from configuration file
     Bitvector iLid; //will be calculated
     Bitvector FID_to_RV; //will be calculated
+    vector<Bitvector> FID_to_RV_shards; //will be calculated, one per Domain::RV_nodes (if there are more than one)
     Bitvector FID_to_TM; //will be calculated
+    vector<Bitvector> FID_to_TM_replicas; //will be calculated, one per Domain::TM_nodes (if there are more than one)
     vector<NetworkConnection *> connections;
 };
 
@@ -164,6 +336,10 @@ public:
     string src_mac; //will be retrieved using ssh
     string dst_mac; //will be retrieved using ssh
     Bitvector LID; //will be calculated
+    vector<Bitvector> tableLIDs; //our proposal the LIDs of LID tables 1..d-1 (LID is the one of table 0) - will be calculated
+    /**@brief our proposal the LIDs of all tables separated by ':' (just LID when there is a single table), as the Forwarder and the TM read them.
+     */
+    string LIDString();
 };
 
 #endif	/* NETWORK_HPP */
@@ -48,6 +48,14 @@ int Parser::getGlobalDomainParameters() {
     try {
         dm->fid_len = cfg.lookup("LIPSIN_ID_LENGTH");
         //cout << "LIPSIN_ID_LENGTH: " << fid_len << endl;
+        /*our proposal the Forwarder matches FIDs in 64-bit words*/
+        if ((dm->fid_len <= 0) || (dm->fid_len % 8 != 0)) {
+            cerr << "LIPSIN_ID_LENGTH must be a multiple of 8 bytes" << endl;
+            return -1;
+        }
+        if (dm->fid_len != 8) {
+            cout << "LIPSIN_ID_LENGTH is " << dm->fid_len << ": Blackadder, the library and the TM must be built with FID_LEN " << dm->fid_len << endl;
+        }
     } catch (const SettingNotFoundException &nfex) {
         cerr << "mandatory option LIPSIN_ID_LENGTH is missing" << endl;
         return -1;
@@ -87,6 +95,77 @@ int Parser::getGlobalDomainParameters() {
         cerr << "mandatory option OVERLAY_MODE is missing" << endl;
         return -1;
     }
+    /*our proposal optional*/
+    if (!cfg.lookupValue("TM_FID_MODE", dm->tm_fid_mode)) {
+        dm->tm_fid_mode = "shortest_path";
+    }
+    cout << "TM_FID_MODE: " << dm->tm_fid_mode << endl;
+    if (!cfg.lookupValue("LID_TABLES", dm->lid_tables)) {
+        dm->lid_tables = 1;
+    }
+    if ((dm->lid_tables < 1) || ((dm->lid_tables & (dm->lid_tables - 1)) != 0)) {
+        cerr << "LID_TABLES must be a power of 2" << endl;
+        return -1;
+    }
+    cout << "LID_TABLES: " << dm->lid_tables << endl;
+    /*our proposal optional, the LID assignment (see LIDOptimizer)*/
+    cfg.lookupValue("LID_MODE", dm->lid_mode);
+    if ((dm->lid_mode.compare("random") != 0) && (dm->lid_mode.compare("optimized") != 0)) {
+        cerr << "LID_MODE must be random or optimized" << endl;
+        return -1;
+    }
+    cfg.lookupValue("LID_BITS", dm->lid_bits);
+    cfg.lookupValue("LID_ITERATIONS", dm->lid_iterations);
+    cfg.lookupValue("LID_WORKERS", dm->lid_workers);
+    cfg.lookupValue("LID_REPORT", dm->lid_report);
+    if ((dm->lid_bits < 0) || (dm->lid_bits > dm->fid_len * 8 / 2)) {
+        cerr << "LID_BITS must be between 0 (automatic) and half the bits of LIPSIN_ID_LENGTH" << endl;
+        return -1;
+    }
+    if (cfg.exists("TRAFFIC")) {
+        const Setting &traffic = cfg.lookup("TRAFFIC");
+        for (int i = 0; i < traffic.getLength(); i++) {
+            TrafficDemand td;
+            td.weight = 1;
+            if (!traffic[i].lookupValue("from", td.src) || !traffic[i].lookupValue("to", td.dst)) {
+                cerr << "TRAFFIC entries must have from and to labels" << endl;
+                return -1;
+            }
+            traffic[i].lookupValue("weight", td.weight);
+            dm->traffic.push_back(td);
+        }
+    }
+    cout << "LID_MODE: " << dm->lid_mode << ", LID_BITS: " << dm->lid_bits << ", TRAFFIC: " << dm->traffic.size() << " entries" << endl;
+    /*our proposal optional, load aware paths*/
+    cfg.lookupValue("LOAD_REPORT", dm->load_report);
+    cfg.lookupValue("TM_LOAD_WEIGHT", dm->tm_load_weight);
+    cfg.lookupValue("TM_LINK_CAPACITY", dm->tm_link_capacity);
+    cfg.lookupValue("TM_LOAD_HYSTERESIS", dm->tm_load_hysteresis);
+    if ((dm->load_report < 0) || (dm->tm_load_weight < 0) || (dm->tm_link_capacity <= 0) || (dm->tm_load_hysteresis < 0)) {
+        cerr << "LOAD_REPORT, TM_LOAD_WEIGHT and TM_LOAD_HYSTERESIS must not be negative and TM_LINK_CAPACITY must be positive" << endl;
+        return -1;
+    }
+    cout << "LOAD_REPORT: " << dm->load_report << ", TM_LOAD_WEIGHT: " << dm->tm_load_weight << endl;
+    /*our proposal optional, per hop latency telemetry*/
+    cfg.lookupValue("TELEMETRY", dm->telemetry);
+    cfg.lookupValue("TELEMETRY_SAMPLE", dm->telemetry_sample);
+    if (dm->telemetry_sample < 0) {
+        cerr << "TELEMETRY_SAMPLE must not be negative" << endl;
+        return -1;
+    }
+    cout << "TELEMETRY: " << dm->telemetry << ", TELEMETRY_SAMPLE: " << dm->telemetry_sample << endl;
+    /*our proposal optional, the defaults are set by the Domain*/
+    cfg.lookupValue("DEPLOY_JOBS", dm->deploy_jobs);
+    cfg.lookupValue("SSH_MULTIPLEX", dm->ssh_multiplex);
+    cout << "DEPLOY_JOBS: " << dm->deploy_jobs << ", SSH_MULTIPLEX: " << dm->ssh_multiplex << endl;
+    /*our proposal the defaults of the node parameters profile, device, queue_size, burst, egress and control_weight*/
+    cfg.lookupValue("PROFILE", dm->profile);
+    cfg.lookupValue("DEVICE", dm->device);
+    cfg.lookupValue("QUEUE_SIZE", dm->queue_size);
+    cfg.lookupValue("BURST", dm->burst);
+    cfg.lookupValue("EGRESS", dm->egress);
+    cfg.lookupValue("CONTROL_WEIGHT", dm->control_weight);
+    cout << "PROFILE: " << dm->profile << endl;
     return 0;
 }
 
@@ -159,6 +238,64 @@ int Parser::addConnection(const Setting &connection, NetworkNode *nn) {
     return 0;
 }
 
+/*our proposal the Click profile of a node (optional), for addNode and addPlanetLabNode*/
+int Parser::parseProfile(const Setting &node, NetworkNode *nn, const string &label, const string &running_mode) {
+    nn->profile = dm->profile;
+    nn->device = dm->device;
+    nn->queue_size = dm->queue_size;
+    nn->burst = dm->burst;
+    nn->egress = dm->egress;
+    nn->control_weight = dm->control_weight;
+    node.lookupValue("profile", nn->profile);
+    node.lookupValue("device", nn->device);
+    node.lookupValue("queue_size", nn->queue_size);
+    node.lookupValue("burst", nn->burst);
+    node.lookupValue("egress", nn->egress);
+    node.lookupValue("control_weight", nn->control_weight);
+    node.lookupValue("click_args", nn->click_args);
+    if ((nn->profile.compare("default") != 0) && (nn->profile.compare("performance") != 0)) {
+        cerr << "node " << label << ": profile must be default or performance" << endl;
+        return -1;
+    }
+    if ((nn->device.length() > 0) && (nn->device.compare("polling") != 0) && (nn->device.compare("netmap") != 0) && (nn->device.compare("dpdk") != 0)) {
+        cerr << "node " << label << ": device must be polling, netmap or dpdk" << endl;
+        return -1;
+    }
+    if ((nn->device.compare("polling") == 0) && (running_mode.compare("kernel") != 0)) {
+        cerr << "node " << label << ": polling devices only exist in kernel mode" << endl;
+        return -1;
+    }
+    if (((nn->device.compare("netmap") == 0) || (nn->device.compare("dpdk") == 0)) && (running_mode.compare("user") != 0)) {
+        cerr << "node " << label << ": " << nn->device << " devices only exist in user mode" << endl;
+        return -1;
+    }
+    if ((nn->device.length() > 0) && (nn->profile.compare("performance") != 0)) {
+        cout << "node " << label << ": device is only used by the performance profile" << endl;
+    }
+    if ((nn->queue_size < 1) || (nn->burst < 0)) {
+        cerr << "node " << label << ": queue_size must be positive and burst not negative" << endl;
+        return -1;
+    }
+    if ((nn->egress.compare("fifo") != 0) && (nn->egress.compare("priority") != 0) && (nn->egress.compare("weighted") != 0)) {
+        cerr << "node " << label << ": egress must be fifo, priority or weighted" << endl;
+        return -1;
+    }
+    if (nn->control_weight < 1) {
+        cerr << "node " << label << ": control_weight must be positive" << endl;
+        return -1;
+    }
+    try {
+        const Setting &sched = node["sched"];
+        for (int s = 0; s < sched.getLength(); s++) {
+            string entry = sched[s];
+            nn->sched.push_back(entry);
+        }
+    } catch (const SettingNotFoundException &nfex) {
+        /*optional*/
+    }
+    return 0;
+}
+
 int Parser::addNode(const Setting &node) {
     int ret;
     NetworkNode *nn = new NetworkNode();
@@ -195,6 +332,21 @@ int Parser::addNode(const Setting &node) {
         cerr << "running_mode conf parameter is mandatory for all nodes...missing from node " << node_label << endl;
         return -1;
     }
+    /*********************Parse the number of Click threads (optional)*****************************/
+    if (node.lookupValue("threads", nn->threads)) {
+        if (nn->threads < 1) {
+            cerr << "node " << node_label << " must have at least 1 thread" << endl;
+            return -1;
+        }
+        if ((nn->threads > 1) && (running_mode.compare("user") != 0)) {
+            cout << "node " << node_label << ": threads is only used in user mode" << endl;
+            nn->threads = 1;
+        }
+    }
+    /*********************Parse the Click profile of the node (optional)***************************/
+    if (parseProfile(node, nn, node_label, running_mode) < 0) {
+        return -1;
+    }
     /***********Parse the roles..no role or role = []; mean no special functionality****************/
     /*role = ["TM", "RV"]; for both roles*/
     int number_of_roles;
@@ -217,9 +369,10 @@ int Parser::addNode(const Setting &node) {
                         cout << "node " << node_label << " is the RV node" << endl;
                         dm->RV_node = nn;
                     } else {
-                        cerr << "multiple RV nodes are assigned - this is currently wrong" << endl;
-                        return -1;
+                        /*more RV nodes share the RV state by root scope (RVSHARDS), the first one is still the default RV*/
+                        cout << "node is an additional RV node (shard)" << endl;
                     }
+                    dm->RV_nodes.push_back(nn);
                 }
                 if (role.compare("TM") == 0) {
                     nn->isTM = true;
@@ -227,9 +380,10 @@ int Parser::addNode(const Setting &node) {
                         cout << "node " << node_label << " is the TM node" << endl;
                         dm->TM_node = nn;
                     } else {
-                        cerr << "multiple TM nodes are assigned - this is currently wrong" << endl;
-                        return -1;
+                        /*more TM nodes are replicas that share the TM requests (TMREPLICAS), the first one is still the default TM*/
+                        cout << "node " << node_label << " is an additional TM node (replica)" << endl;
                     }
+                    dm->TM_nodes.push_back(nn);
                 }
             }
         }
@@ -305,6 +459,11 @@ int Parser::addPlanetLabNode(const Setting &node) {
         cerr << "testbed_ip conf parameter is mandatory for all Planetlab nodes...missing from node " << endl;
         return -1;
     }
+    /*********************Parse the Click profile of the node (optional)***************************/
+    /*planetlab nodes run in user mode and get their label later (see GraphRepresentation::BuildInputMap)*/
+    if (parseProfile(node, nn, testbed_ip, "user") < 0) {
+        return -1;
+    }
     /***********Parse the roles..no role or role = []; mean no special functionality****************/
     /*role = ["TM", "RV"]; for both roles*/
     int number_of_roles;
@@ -327,9 +486,10 @@ int Parser::addPlanetLabNode(const Setting &node) {
                         cout << "node  is the RV node" << endl;
                         dm->RV_node = nn;
                     } else {
-                        cerr << "multiple RV nodes are assigned - this is currently wrong" << endl;
-                        return -1;
+                        /*more RV nodes share the RV state by root scope (RVSHARDS), the first one is still the default RV*/
+                        cout << "node is an additional RV node (shard)" << endl;
                     }
+                    dm->RV_nodes.push_back(nn);
                 }
                 if (role.compare("TM") == 0) {
                     nn->isTM = true;
@@ -337,9 +497,10 @@ int Parser::addPlanetLabNode(const Setting &node) {
                         cout << "node  is the TM node" << endl;
                         dm->TM_node = nn;
                     } else {
-                        cerr << "multiple TM nodes are assigned - this is currently wrong" << endl;
-                        return -1;
+                        /*more TM nodes are replicas that share the TM requests (TMREPLICAS), the first one is still the default TM*/
+                        cout << "node is an additional TM node (replica)" << endl;
                     }
+                    dm->TM_nodes.push_back(nn);
                 }
             }
         }
@@ -86,6 +86,15 @@ public:
      * @return -1 if something is wrong.
      */
     int addNode(const Setting &node);
+    /**@brief our proposal parses and checks the Click profile of a node (profile, device, queue_size, burst, egress, control_weight, click_args and sched), defaulting to those of the Domain.
+     *
+     * @param node the node configuration.
+     * @param nn the NetworkNode the profile is set in.
+     * @param label how the node is named in the error messages.
+     * @param running_mode the running mode of the node (the devices depend on it).
+     * @return -1 if something is wrong.
+     */
+    int parseProfile(const Setting &node, NetworkNode *nn, const string &label, const string &running_mode);
     /**@brief It parses and checks a connection configuration and maps the configured properties to a NetworkConnection.
      * 
      * it parses and checks:
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/*Our proposal what bench_publisher and bench_subscriber share: the header every benchmark publication starts with,
+ *the clock and a thin layer over the blocking (Blackadder) and the non-blocking (NB_Blackadder) library, so that both are measured by the same code*/
+
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <nb_blackadder.hpp>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <string>
+
+using namespace std;
+
+#define BENCH_MAGIC 0xBA5EBE7C
+#define BENCH_FIN 1 //the last publication of a run: seq is the number of publications sent before it
+#define BENCH_FIN_COPIES 3 //the FIN is sent this many times, the subscriber counts the first one
+
+/*the identifiers used unless -S and -I are given*/
+#define BENCH_SCOPE "BBBBBBBBBBBBBBBB"
+#define BENCH_ITEM "0000000000000001"
+
+/*the header every benchmark publication starts with (in host byte order: publisher and subscriber are expected to run on the same architecture)*/
+struct BenchHeader {
+    uint32_t magic;
+    uint32_t flags;
+    uint64_t seq;
+    /*CLOCK_REALTIME in nanoseconds when publish_data was called. One-way latency across nodes is only as good as their clock synchronisation*/
+    uint64_t send_ns;
+};
+
+static inline uint64_t bench_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*the Event handler of the benchmark tool: it runs in the thread calling getEvent (blocking library) or in the NB_Blackadder worker*/
+typedef void (*bench_handler)(Event &ev);
+
+/*a Blackadder or an NB_Blackadder, chosen at run time*/
+class BenchClient {
+public:
+    BenchClient(bool user_space, bool non_blocking) : ba(NULL), nb_ba(NULL) {
+        if (non_blocking) {
+            nb_ba = NB_Blackadder::Instance(user_space);
+        } else {
+            ba = Blackadder::Instance(user_space);
+        }
+    }
+    ~BenchClient() {
+        if (ba != NULL) {
+            delete ba;
+        } else {
+            delete nb_ba;
+        }
+    }
+    void publish_scope(const string &id, const string &prefix_id, unsigned char strategy) {
+        if (ba != NULL) {
+            ba->publish_scope(id, prefix_id, strategy, NULL, 0);
+        } else {
+            nb_ba->publish_scope(id, prefix_id, strategy, NULL, 0);
+        }
+    }
+    void publish_info(const string &id, const string &prefix_id, unsigned char strategy) {
+        if (ba != NULL) {
+            ba->publish_info(id, prefix_id, strategy, NULL, 0);
+        } else {
+            nb_ba->publish_info(id, prefix_id, strategy, NULL, 0);
+        }
+    }
+    void subscribe_info(const string &id, const string &prefix_id, unsigned char strategy) {
+        if (ba != NULL) {
+            ba->subscribe_info(id, prefix_id, strategy, NULL, 0);
+        } else {
+            nb_ba->subscribe_info(id, prefix_id, strategy, NULL, 0);
+        }
+    }
+    void publish_data(const string &id, unsigned char strategy, void *str_opt, unsigned int str_opt_len, void *data, unsigned int data_len) {
+        if (ba != NULL) {
+            ba->publish_data(id, strategy, str_opt, str_opt_len, data, data_len);
+        } else {
+            nb_ba->publish_data(id, strategy, str_opt, str_opt_len, data, data_len);
+        }
+    }
+    /*calls handler for every Event until the process exits*/
+    void run(bench_handler handler) {
+        if (ba != NULL) {
+            while (true) {
+                Event ev;
+                ba->getEvent(ev);
+                if (ev.type == 0) {
+                    /*getEvent failed: blackadder went away*/
+                    return;
+                }
+                handler(ev);
+            }
+        } else {
+            nb_handler = handler;
+            nb_ba->setCallback(nb_callback);
+            nb_ba->join();
+        }
+    }
+    void disconnect() {
+        if (ba != NULL) {
+            ba->disconnect();
+        } else {
+            nb_ba->disconnect();
+        }
+    }
+private:
+    static void nb_callback(Event *ev) {
+        nb_handler(*ev);
+        delete ev;
+    }
+    static bench_handler nb_handler;
+    Blackadder *ba;
+    NB_Blackadder *nb_ba;
+};
+
+bench_handler BenchClient::nb_handler = NULL;
+
+#endif /* BENCH_HPP */
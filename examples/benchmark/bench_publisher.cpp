@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/*Our proposal the publisher of the benchmark suite (see README).
+ *It publishes the scope and the item and, when a subscriber appears, sends count publications of size bytes at rate publications per second.
+ *A START_PUBLISH (rendezvous) makes it publish with DOMAIN_LOCAL, a PLEASE_PUSH_DATA (flooded subscription) with IMPLICIT_RENDEZVOUS to the FID of the request*/
+
+#include "bench.hpp"
+
+#include <signal.h>
+#include <unistd.h>
+
+BenchClient *client;
+string bin_item_id;
+unsigned int payload_size = 1024;
+unsigned int rate = 1000; /*publications per second, 0 for as fast as possible*/
+unsigned int count = 10000;
+bool once = false;
+bool streamed = false;
+char *payload;
+
+void sigfun(int sig) {
+    (void) signal(SIGINT, SIG_DFL);
+    client->disconnect();
+    delete client;
+    exit(0);
+}
+
+/*waits until deadline, sleeping when it is far away so that low rates do not burn a core*/
+static void wait_until(uint64_t deadline) {
+    uint64_t now;
+    while ((now = bench_now_ns()) < deadline) {
+        if (deadline - now > 200000) {
+            struct timespec ts;
+            ts.tv_sec = 0;
+            ts.tv_nsec = (deadline - now) - 100000;
+            nanosleep(&ts, NULL);
+        }
+    }
+}
+
+static void stream(const string &id, unsigned char strategy, void *str_opt, unsigned int str_opt_len) {
+    BenchHeader *hdr = (BenchHeader *) payload;
+    uint64_t start = bench_now_ns();
+    uint64_t seq;
+    for (seq = 0; seq < count; seq++) {
+        if (rate > 0) {
+            wait_until(start + seq * 1000000000ULL / rate);
+        }
+        hdr->magic = BENCH_MAGIC;
+        hdr->flags = 0;
+        hdr->seq = seq;
+        hdr->send_ns = bench_now_ns();
+        client->publish_data(id, strategy, str_opt, str_opt_len, payload, payload_size);
+    }
+    for (int i = 0; i < BENCH_FIN_COPIES; i++) {
+        hdr->magic = BENCH_MAGIC;
+        hdr->flags = BENCH_FIN;
+        hdr->seq = count;
+        hdr->send_ns = bench_now_ns();
+        client->publish_data(id, strategy, str_opt, str_opt_len, payload, payload_size);
+    }
+    fprintf(stderr, "sent %u publications of %u bytes in %.3f seconds\n", count, payload_size, (bench_now_ns() - start) / 1e9);
+}
+
+static void handler(Event &ev) {
+    if (ev.id != bin_item_id || (once && streamed)) {
+        return;
+    }
+    switch (ev.type) {
+        case START_PUBLISH:
+            streamed = true;
+            stream(ev.id, DOMAIN_LOCAL, NULL, 0);
+            break;
+        case PLEASE_PUSH_DATA:
+            streamed = true;
+            stream(ev.id, IMPLICIT_RENDEZVOUS, (char *) ev.to_sub_FID._data, FID_LEN);
+            break;
+    }
+    if (once && streamed) {
+        client->disconnect();
+        exit(0);
+    }
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-k] [-n] [-1] [-s size] [-r rate] [-c count] [-S scope] [-I item]\n", name);
+    fprintf(stderr, "  -k        blackadder runs in kernel space\n");
+    fprintf(stderr, "  -n        use the non-blocking library (NB_Blackadder)\n");
+    fprintf(stderr, "  -1        exit after the first run\n");
+    fprintf(stderr, "  -s size   publication size in bytes (default 1024, at least %u)\n", (unsigned int) sizeof (BenchHeader));
+    fprintf(stderr, "  -r rate   publications per second, 0 for as fast as possible (default 1000)\n");
+    fprintf(stderr, "  -c count  publications per run (default 10000)\n");
+    fprintf(stderr, "  -S scope  scope ID in hex (default %s)\n", BENCH_SCOPE);
+    fprintf(stderr, "  -I item   item ID in hex (default %s)\n", BENCH_ITEM);
+    exit(1);
+}
+
+int main(int argc, char* argv[]) {
+    bool user_space = true, non_blocking = false;
+    string scope_id = BENCH_SCOPE, item_id = BENCH_ITEM;
+    int opt;
+    while ((opt = getopt(argc, argv, "kn1s:r:c:S:I:")) != -1) {
+        switch (opt) {
+            case 'k':
+                user_space = false;
+                break;
+            case 'n':
+                non_blocking = true;
+                break;
+            case '1':
+                once = true;
+                break;
+            case 's':
+                payload_size = atoi(optarg);
+                break;
+            case 'r':
+                rate = atoi(optarg);
+                break;
+            case 'c':
+                count = atoi(optarg);
+                break;
+            case 'S':
+                scope_id = optarg;
+                break;
+            case 'I':
+                item_id = optarg;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (payload_size < sizeof (BenchHeader) || scope_id.length() != 2 * PURSUIT_ID_LEN || item_id.length() != 2 * PURSUIT_ID_LEN) {
+        usage(argv[0]);
+    }
+    payload = (char *) calloc(1, payload_size);
+    (void) signal(SIGINT, sigfun);
+    client = new BenchClient(user_space, non_blocking);
+    string bin_scope_id = hex_to_chararray(scope_id);
+    bin_item_id = bin_scope_id + hex_to_chararray(item_id);
+    client->publish_scope(bin_scope_id, string(), DOMAIN_LOCAL);
+    client->publish_info(hex_to_chararray(item_id), bin_scope_id, DOMAIN_LOCAL);
+    fprintf(stderr, "Process ID: %d, waiting for subscribers of %s%s\n", getpid(), scope_id.c_str(), item_id.c_str());
+    client->run(handler);
+    client->disconnect();
+    delete client;
+    free(payload);
+    return 0;
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/*Our proposal the subscriber of the benchmark suite (see README).
+ *It subscribes to the item, timestamps every publication of bench_publisher and, at the FIN (or after -t seconds), prints one line of key=value results:
+ *latency percentiles, loss, reordering, duplicates and goodput*/
+
+#include "bench.hpp"
+
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <algorithm>
+#include <vector>
+
+BenchClient *client;
+string bin_item_id;
+string label = "-";
+const char *library = "blocking";
+unsigned int timeout = 60;
+
+pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+vector<int64_t> latencies; /*in nanoseconds, negative if the clocks of the nodes disagree*/
+vector<bool> seen;
+uint64_t received = 0, duplicates = 0, reordered = 0, highest = 0, bytes = 0;
+uint64_t first_ns = 0, last_ns = 0;
+unsigned int payload_size = 0;
+
+void sigfun(int sig) {
+    (void) signal(SIGINT, SIG_DFL);
+    client->disconnect();
+    delete client;
+    exit(0);
+}
+
+static double percentile_us(vector<int64_t> &sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = (size_t) (p * (sorted.size() - 1) + 0.5);
+    return sorted[index] / 1000.0;
+}
+
+/*prints the results (sent is 0 when no FIN arrived) and exits. stats_mutex is held*/
+static void report(uint64_t sent) {
+    sort(latencies.begin(), latencies.end());
+    uint64_t lost = (sent > received) ? sent - received : 0;
+    double seconds = (last_ns > first_ns) ? (last_ns - first_ns) / 1e9 : 0;
+    printf("label=%s lib=%s size=%u sent=%llu received=%llu lost=%llu loss=%.6f reordered=%llu duplicates=%llu "
+            "p50_us=%.1f p99_us=%.1f p999_us=%.1f max_us=%.1f goodput_mbps=%.3f\n",
+            label.c_str(), library, payload_size, (unsigned long long) sent, (unsigned long long) received, (unsigned long long) lost,
+            (sent > 0) ? (double) lost / sent : 0.0, (unsigned long long) reordered, (unsigned long long) duplicates,
+            percentile_us(latencies, 0.5), percentile_us(latencies, 0.99), percentile_us(latencies, 0.999),
+            latencies.empty() ? 0.0 : latencies.back() / 1000.0, (seconds > 0) ? bytes * 8 / seconds / 1e6 : 0.0);
+    fflush(stdout);
+    client->disconnect();
+    exit(sent > 0 ? 0 : 2);
+}
+
+static void *watchdog(void *arg) {
+    sleep(timeout);
+    pthread_mutex_lock(&stats_mutex);
+    fprintf(stderr, "no FIN after %u seconds\n", timeout);
+    report(0);
+    return NULL;
+}
+
+static void handler(Event &ev) {
+    uint64_t now = bench_now_ns();
+    if (ev.type != PUBLISHED_DATA || ev.id != bin_item_id || ev.data_len < sizeof (BenchHeader)) {
+        return;
+    }
+    BenchHeader *hdr = (BenchHeader *) ev.data;
+    if (hdr->magic != BENCH_MAGIC) {
+        return;
+    }
+    pthread_mutex_lock(&stats_mutex);
+    if (hdr->flags & BENCH_FIN) {
+        report(hdr->seq);
+    }
+    if (hdr->seq >= seen.size()) {
+        if (hdr->seq >= (1ULL << 32)) {
+            pthread_mutex_unlock(&stats_mutex);
+            return;
+        }
+        seen.resize(hdr->seq + 1 + seen.size(), false);
+    }
+    if (seen[hdr->seq]) {
+        duplicates++;
+    } else {
+        seen[hdr->seq] = true;
+        if (received > 0 && hdr->seq < highest) {
+            reordered++;
+        }
+        highest = max(highest, hdr->seq);
+        if (received == 0) {
+            first_ns = now;
+        }
+        last_ns = now;
+        received++;
+        bytes += ev.data_len;
+        payload_size = ev.data_len;
+        latencies.push_back((int64_t) (now - hdr->send_ns));
+    }
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-k] [-n] [-c count] [-t seconds] [-l label] [-S scope] [-I item]\n", name);
+    fprintf(stderr, "  -k          blackadder runs in kernel space\n");
+    fprintf(stderr, "  -n          use the non-blocking library (NB_Blackadder)\n");
+    fprintf(stderr, "  -c count    the expected number of publications (to size the buffers)\n");
+    fprintf(stderr, "  -t seconds  give up (and report what arrived) after this long (default 60)\n");
+    fprintf(stderr, "  -l label    copied to the label= field of the results\n");
+    fprintf(stderr, "  -S scope    scope ID in hex (default %s)\n", BENCH_SCOPE);
+    fprintf(stderr, "  -I item     item ID in hex (default %s)\n", BENCH_ITEM);
+    exit(1);
+}
+
+int main(int argc, char* argv[]) {
+    bool user_space = true, non_blocking = false;
+    string scope_id = BENCH_SCOPE, item_id = BENCH_ITEM;
+    unsigned int expected = 10000;
+    pthread_t watchdog_thread;
+    int opt;
+    while ((opt = getopt(argc, argv, "knc:t:l:S:I:")) != -1) {
+        switch (opt) {
+            case 'k':
+                user_space = false;
+                break;
+            case 'n':
+                non_blocking = true;
+                library = "nb";
+                break;
+            case 'c':
+                expected = atoi(optarg);
+                break;
+            case 't':
+                timeout = atoi(optarg);
+                break;
+            case 'l':
+                label = optarg;
+                break;
+            case 'S':
+                scope_id = optarg;
+                break;
+            case 'I':
+                item_id = optarg;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (scope_id.length() != 2 * PURSUIT_ID_LEN || item_id.length() != 2 * PURSUIT_ID_LEN) {
+        usage(argv[0]);
+    }
+    latencies.reserve(expected);
+    seen.resize(expected, false);
+    (void) signal(SIGINT, sigfun);
+    client = new BenchClient(user_space, non_blocking);
+    string bin_scope_id = hex_to_chararray(scope_id);
+    bin_item_id = bin_scope_id + hex_to_chararray(item_id);
+    pthread_create(&watchdog_thread, NULL, watchdog, NULL);
+    client->subscribe_info(hex_to_chararray(item_id), bin_scope_id, DOMAIN_LOCAL);
+    fprintf(stderr, "Process ID: %d, subscribed to %s%s\n", getpid(), scope_id.c_str(), item_id.c_str());
+    client->run(handler);
+    pthread_mutex_lock(&stats_mutex);
+    report(0);
+    return 0;
+}
@@ -0,0 +1,137 @@
+#!/bin/sh
+#
+# Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+# All rights reserved.
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License version
+# 2 as published by the Free Software Foundation.
+#
+# Alternatively, this software may be distributed under the terms of
+# the BSD license.
+#
+# See LICENSE and COPYING for more details.
+#
+# Our proposal runs the BAMicroBench element (user space click) over the per-packet kernels of a node:
+# the Forwarder for every number of links and of IDs per packet, the CacheUnit for every number of cached items
+# (stores and lookups), and the bitvector and Bloom filter kernels, and appends one line of results per run (see README).
+
+click=${CLICK:-click}
+links="1 2 4 8 16"
+ids="1 4 16"
+entries="1 100 10000"
+length=1400
+packets=1000000
+kernels="forwarder cache bitvector bloom"
+results=microbench_results.txt
+
+usage() {
+    echo "usage: $0 [-c click] [-K kernels] [-L links] [-i ids] [-e entries] [-s length] [-n packets] [-o results]" >&2
+    exit 1
+}
+
+while getopts "c:K:L:i:e:s:n:o:" opt; do
+    case $opt in
+        c) click=$OPTARG ;;
+        K) kernels=$OPTARG ;;
+        L) links=$OPTARG ;;
+        i) ids=$OPTARG ;;
+        e) entries=$OPTARG ;;
+        s) length=$OPTARG ;;
+        n) packets=$OPTARG ;;
+        o) results=$OPTARG ;;
+        *) usage ;;
+    esac
+done
+
+ILID=1000000000000000000000000000000000000000000000000000000000000000
+
+# prints n random LIDs (64 bits, 5 of them set) and, last, their OR: the FID that reaches all of them
+lids() {
+    awk -v n="$1" -v seed="$$" 'BEGIN {
+        srand(seed);
+        for (b = 0; b < 64; b++) fid[b] = 0;
+        for (i = 0; i < n; i++) {
+            for (b = 0; b < 64; b++) lid[b] = 0;
+            for (k = 0; k < 5; k++) { b = int(rand() * 64); lid[b] = 1; fid[b] = 1; }
+            s = ""; for (b = 0; b < 64; b++) s = s lid[b];
+            print s;
+        }
+        s = ""; for (b = 0; b < 64; b++) s = s fid[b];
+        print s;
+    }'
+}
+
+globalconf() {
+    echo "require(blackadder_flooding);"
+    echo "globalconf::GlobalConf(MODE mac, NODEID 00000001, DEFAULTRV $ILID, iLID $ILID, TMFID $ILID);"
+}
+
+# discards the outputs first..last of element
+discard() {
+    p=$1
+    while [ "$p" -le "$2" ]; do
+        echo "$3[$p] -> Discard;"
+        p=$((p + 1))
+    done
+}
+
+# runs a configuration and appends its results, prefixed with the scenario
+run() {
+    scenario=$1
+    "$click" -e "$2" 2>&1 | grep 'kernel=' | sed "s/^[^:]*: /scenario=$scenario /" | tee -a "$results"
+}
+
+for kernel in $kernels; do
+    case $kernel in
+        forwarder)
+            for n in $links; do
+                table=$(lids "$n")
+                fid=$(echo "$table" | tail -n 1)
+                entries_conf=$(echo "$table" | head -n "$n" | awk '{printf ", 1, 00:00:00:00:00:01, 00:00:00:00:00:%02x, %s", NR + 1, $0}')
+                for i in $ids; do
+                    run "forwarder_links_$n" "$(globalconf)
+fw::Forwarder(globalconf, $n$entries_conf);
+bench::BAMicroBench(push, PACKETS $packets, FID $fid, IDS $i, LENGTH $length);
+bench -> [0]fw;
+$(discard 0 5 fw)"
+                done
+            done
+            ;;
+        cache)
+            for e in $entries; do
+                # the data of e items are stored...
+                run "cache_store_$e" "$(globalconf)
+cacheunit::CacheUnit(globalconf);
+bench::BAMicroBench(push, PACKETS $packets, FID $ILID, ID_SPACE $e, LENGTH $length, ETHER true);
+Idle -> [0]cacheunit;
+Idle -> [1]cacheunit;
+bench -> [2]cacheunit;
+$(discard 0 5 cacheunit)"
+                # ...and looked up by subinfo requests
+                run "cache_lookup_$e" "$(globalconf)
+cacheunit::CacheUnit(globalconf);
+bench::BAMicroBench(push, PACKETS $packets, FID $ILID, ID_SPACE $e, LENGTH $length, ETHER true, SUBINFO true, WARMUP true);
+Idle -> [0]cacheunit;
+bench[0] -> [1]cacheunit;
+bench[1] -> [2]cacheunit;
+$(discard 0 5 cacheunit)"
+            done
+            ;;
+        bitvector)
+            for n in $links; do
+                run "bitvector_links_$n" "require(blackadder_flooding);
+bench::BAMicroBench(bitvector, PACKETS $packets, IDS $n);"
+            done
+            ;;
+        bloom)
+            for i in $ids; do
+                run "bloom_ids_$i" "require(blackadder_flooding);
+bench::BAMicroBench(bloom, PACKETS $packets, IDS $i);"
+            done
+            ;;
+        *)
+            usage
+            ;;
+    esac
+done
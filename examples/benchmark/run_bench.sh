@@ -0,0 +1,89 @@
+#!/bin/sh
+#
+# Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+# All rights reserved.
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License version
+# 2 as published by the Free Software Foundation.
+#
+# Alternatively, this software may be distributed under the terms of
+# the BSD license.
+#
+# See LICENSE and COPYING for more details.
+#
+# Our proposal runs bench_publisher and bench_subscriber for every library, payload size and rate
+# and appends one line of results per subscriber and run to the results file (see README).
+# Nodes are reached with ssh as in deployment/deploy; "local" runs the tool on this machine.
+
+user=$USER
+pub=local
+subs=local
+dir='~/blackadder/examples/benchmark'
+sizes="64 512 1400"
+rates="1000 10000 0"
+libs="blocking nb"
+count=10000
+label=run
+kernel=
+results=bench_results.txt
+
+usage() {
+    echo "usage: $0 [-u user] [-p pubnode] [-s subnode,...] [-d dir] [-z sizes] [-r rates] [-L libs] [-c count] [-l label] [-k] [-o results]" >&2
+    exit 1
+}
+
+while getopts "u:p:s:d:z:r:L:c:l:ko:" opt; do
+    case $opt in
+        u) user=$OPTARG ;;
+        p) pub=$OPTARG ;;
+        s) subs=$(echo "$OPTARG" | tr ',' ' ') ;;
+        d) dir=$OPTARG ;;
+        z) sizes=$OPTARG ;;
+        r) rates=$OPTARG ;;
+        L) libs=$OPTARG ;;
+        c) count=$OPTARG ;;
+        l) label=$OPTARG ;;
+        k) kernel=-k ;;
+        o) results=$OPTARG ;;
+        *) usage ;;
+    esac
+done
+
+# on node, runs a command in the benchmark directory
+on() {
+    node=$1
+    shift
+    if [ "$node" = local ]; then
+        (cd "$(dirname "$0")" && "$@")
+    else
+        ssh "$user@$node" "cd $dir && $*"
+    fi
+}
+
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+for lib in $libs; do
+    nb=
+    [ "$lib" = nb ] && nb=-n
+    for size in $sizes; do
+        for rate in $rates; do
+            n=0
+            for sub in $subs; do
+                on "$sub" ./bench_subscriber $kernel $nb -c "$count" -l "$label" > "$tmp/$sub.$n" &
+                n=$((n + 1))
+            done
+            # let the subscriptions reach the rendezvous node (or flood) first
+            sleep 2
+            on "$pub" ./bench_publisher $kernel $nb -1 -s "$size" -r "$rate" -c "$count"
+            wait
+            for f in "$tmp"/*; do
+                node=${f##*/}
+                node=${node%.*}
+                sed "s/^/pub=$pub sub=$node rate=$rate /" "$f" | tee -a "$results"
+                rm -f "$f"
+            done
+        done
+    done
+done
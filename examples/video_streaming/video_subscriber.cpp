@@ -62,13 +62,16 @@ void *event_listener_loop(void *arg) {
     if (sock < 0) {
         perror("socket");
     }
+    /*all waiting video packets are received at once into the library's buffer pool*/
+    Event events[EVENT_BATCH_MAX];
     while (true) {
-        Event ev;
-        ba->getEvent(ev);
-        if (ev.type == PUBLISHED_DATA) {
-            sendto(sock, ev.data, ev.data_len, 0, (struct sockaddr *) &server, sizeof (server));
-        } else {
-            cout << "weird" << endl;
+        int n = ba->getEvents(events, EVENT_BATCH_MAX);
+        for (int i = 0; i < n; i++) {
+            if (events[i].type == PUBLISHED_DATA) {
+                sendto(sock, events[i].data, events[i].data_len, 0, (struct sockaddr *) &server, sizeof (server));
+            } else {
+                cout << "weird" << endl;
+            }
         }
     }
 }
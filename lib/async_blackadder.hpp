@@ -0,0 +1,527 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#ifndef ASYNC_BLACKADDER_HPP
+#define ASYNC_BLACKADDER_HPP
+
+#include "blackadder.hpp"
+
+#include <map>
+#include <deque>
+
+/*Our proposal the Event types a future or a stream can wait for are a bit mask over START_PUBLISH..TOPOLOGY_LINK_LOAD*/
+#define ASYNC_EVENT_BIT(type) (1U << ((type) - START_PUBLISH))
+#define ASYNC_ANY_EVENT 0xFFFFFFFFU
+
+class AsyncBlackadder;
+
+/**@relates AsyncBlackadder
+ * @brief Our proposal a type definition for the pointer to the handler of a stream or a future. The Event is only valid during the call (use the Event copy constructor to keep it).
+ */
+typedef void (*eventhandler)(Event &ev, void *context);
+
+/**@brief (User Library) Our proposal the result of a request of AsyncBlackadder: the first Event that answers it.
+ *
+ * Requests have no acknowledgement on the wire, so a future is resolved by the first Event of the types it waits for about its identifier
+ * (a START_PUBLISH for publish_info, a PUBLISHED_DATA for subscribe_info and so on, see AsyncBlackadder).
+ * A future is a handle: copies share the result, which is released with the last of them.
+ */
+class EventFuture {
+public:
+    EventFuture() : owner(NULL), slot(0) {}
+    EventFuture(const EventFuture &f);
+    EventFuture& operator=(const EventFuture &f);
+    ~EventFuture();
+    /**@brief false for a default constructed future (a request that does not wait for anything).*/
+    bool valid() const;
+    /**@brief true once the Event arrived.*/
+    bool ready() const;
+    /**@brief returns the Event, running the event loop of the owner (AsyncBlackadder::poll) until it arrives.
+     *
+     * It must not be called from a handler: the Events being dispatched would be overwritten.
+     * @param timeout_ms the longest wait for the next Event in milliseconds (-1 waits for ever).
+     * @return the Event (valid as long as the future) or NULL on a timeout, a socket error, a cancelled future or when called from a handler.
+     */
+    Event *get(int timeout_ms = -1);
+    /**@brief calls handler when the Event arrives (at once if it already arrived) - the future no longer keeps it.*/
+    void then(eventhandler handler, void *context);
+    /**@brief stops waiting: get returns NULL and the handler of then is never called.*/
+    void cancel();
+private:
+    friend class AsyncBlackadder;
+    EventFuture(AsyncBlackadder *_owner, unsigned int _slot);
+    AsyncBlackadder *owner;
+    unsigned int slot;
+};
+
+/**@brief (User Library) Our proposal an asynchronous interface to Blackadder, driven by the event loop of the application without any thread.
+ *
+ * The requests are sent with the same wire format as Blackadder. The calls that expect an answer return an EventFuture:
+ * publish_info waits for the first START_PUBLISH of the item, subscribe_info for its first PUBLISHED_DATA and subscribe_scope for the first
+ * SCOPE_PUBLISHED, INFO_PUBLISHED or PUBLISHED_DATA under the scope.
+ *
+ * Besides, every identifier can have a stream: the Events about it (and about everything under a scope) go to its handler or, without one,
+ * are queued until the application takes them with next. An Event goes to the stream of the longest prefix of its identifier that has one
+ * (one lookup per fragment), so thousands of identifiers cost no more than a map. Events of no stream go to the default handler, if any.
+ *
+ * The application polls getFd for POLLIN in its own loop and calls dispatch when it is readable, or lets poll do both.
+ * Handlers may send requests, open and close streams and create futures, but must not call EventFuture::get.
+ * The futures must not outlive the AsyncBlackadder that created them.
+ */
+class AsyncBlackadder {
+public:
+    /**@param _ba the Blackadder the requests are sent with (see Blackadder::Instance). Its Events must only be read by this object.*/
+    AsyncBlackadder(Blackadder *_ba);
+    ~AsyncBlackadder();
+
+    /**@brief Blackadder::publish_scope (nothing comes back to the publisher of a scope).*/
+    void publish_scope(const string &id, const string &prefix_id, unsigned char strategy, void *str_opt, unsigned int str_opt_len);
+    /**@brief Blackadder::publish_info.
+     * @return a future for the first START_PUBLISH of prefix_id + id.*/
+    EventFuture publish_info(const string &id, const string &prefix_id, unsigned char strategy, void *str_opt, unsigned int str_opt_len);
+    /**@brief Blackadder::subscribe_scope.
+     * @return a future for the first SCOPE_PUBLISHED, INFO_PUBLISHED or PUBLISHED_DATA under prefix_id + id.*/
+    EventFuture subscribe_scope(const string &id, const string &prefix_id, unsigned char strategy, void *str_opt, unsigned int str_opt_len);
+    /**@brief Blackadder::subscribe_info.
+     * @return a future for the first PUBLISHED_DATA of prefix_id + id.*/
+    EventFuture subscribe_info(const string &id, const string &prefix_id, unsigned char strategy, void *str_opt, unsigned int str_opt_len);
+    /**@brief Blackadder::unpublish_scope - the futures waiting for prefix_id + id are cancelled.*/
+    void unpublish_scope(const string &id, const string &prefix_id, unsigned char strategy, void *str_opt, unsigned int str_opt_len);
+    /**@brief Blackadder::unpublish_info - the futures waiting for prefix_id + id are cancelled.*/
+    void unpublish_info(const string &id, const string &prefix_id, unsigned char strategy, void *str_opt, unsigned int str_opt_len);
+    /**@brief Blackadder::unsubscribe_scope - the futures waiting for prefix_id + id are cancelled.*/
+    void unsubscribe_scope(const string &id, const string &prefix_id, unsigned char strategy, void *str_opt, unsigned int str_opt_len);
+    /**@brief Blackadder::unsubscribe_info - the futures waiting for prefix_id + id are cancelled.*/
+    void unsubscribe_info(const string &id, const string &prefix_id, unsigned char strategy, void *str_opt, unsigned int str_opt_len);
+    /**@brief Blackadder::publish_data.*/
+    void publish_data(const string &id, unsigned char strategy, void *str_opt, unsigned int str_opt_len, void *data, unsigned int data_len);
+    /**@brief a future for the next Event of one of types (ASYNC_EVENT_BIT masks) about id or under it.*/
+    EventFuture next_event(const string &id, unsigned int types = ASYNC_ANY_EVENT);
+
+    /**@brief opens (or changes) the stream of id: its Events of one of types go to handler, or are queued for next if handler is NULL.*/
+    void open_stream(const string &id, eventhandler handler, void *context, unsigned int types = ASYNC_ANY_EVENT);
+    /**@brief closes the stream of id and drops the Events queued in it.*/
+    void close_stream(const string &id);
+    /**@brief takes the oldest Event queued in the stream of id.
+     * @return the Event, which the application must delete, or NULL if none is queued.*/
+    Event *next(const string &id);
+    /**@brief the handler of the Events of no stream and no future (NULL drops them, see dropped).*/
+    void set_default_handler(eventhandler handler, void *context);
+
+    /**@brief the descriptor to watch for POLLIN (Blackadder::getFd).*/
+    int getFd();
+    /**@brief dispatches all Events that are already waiting, without blocking (call it until the descriptor is drained, e.g. with edge-triggered epoll).
+     * @return the number of Events dispatched, -1 on a socket error.*/
+    int dispatch();
+    /**@brief waits up to timeout_ms milliseconds (-1 for ever) for the descriptor and dispatches the Events.
+     * @return the number of Events dispatched (0 on a timeout), -1 on an error.*/
+    int poll(int timeout_ms);
+    /**@brief the Events that no stream, future or default handler took.*/
+    unsigned long dropped() const {
+        return dropped_events;
+    }
+private:
+    friend class EventFuture;
+    struct Stream {
+        Stream() : handler(NULL), context(NULL), types(ASYNC_ANY_EVENT) {}
+        eventhandler handler;
+        void *context;
+        unsigned int types;
+        deque<Event *> queued;
+    };
+    struct Pending {
+        Pending() : id(), types(0), refs(0), waiting(false), result(NULL), handler(NULL), context(NULL) {}
+        string id;
+        unsigned int types;
+        /*the EventFuture handles of the slot - it is free when there are none and no handler of then waits*/
+        unsigned int refs;
+        bool waiting;
+        Event *result;
+        eventhandler handler;
+        void *context;
+    };
+    /**@brief a slot waiting for the first Event of types about id.*/
+    unsigned int wait_for(const string &id, unsigned int types);
+    void unwait(unsigned int slot);
+    void release(unsigned int slot);
+    void cancel_all(const string &id);
+    /**@brief true if an Event about event_id concerns the identifier id (the same one or a prefix of it).*/
+    static bool covers(const string &id, const string &event_id) {
+        return event_id.compare(0, id.length(), id) == 0;
+    }
+    static bool accepts(unsigned int types, unsigned char type) {
+        return type >= START_PUBLISH && type < START_PUBLISH + 32 && (types & ASYNC_EVENT_BIT(type));
+    }
+    void deliver(Event &ev);
+    Blackadder *ba;
+    Event events[EVENT_BATCH_MAX];
+    bool dispatching;
+    map<string, Stream *> streams;
+    vector<Pending> pending;
+    vector<unsigned int> free_slots;
+    /*the slots waiting for an identifier*/
+    multimap<string, unsigned int> waiting;
+    eventhandler default_handler;
+    void *default_context;
+    unsigned long dropped_events;
+};
+
+inline AsyncBlackadder::AsyncBlackadder(Blackadder *_ba)
+    : ba(_ba), dispatching(false), default_handler(NULL), default_context(NULL), dropped_events(0) {
+}
+
+inline AsyncBlackadder::~AsyncBlackadder() {
+    for (map<string, Stream *>::iterator it = streams.begin(); it != streams.end(); it++) {
+        while (!it->second->queued.empty()) {
+            delete it->second->queued.front();
+            it->second->queued.pop_front();
+        }
+        delete it->second;
+    }
+    for (unsigned int i = 0; i < pending.size(); i++) {
+        delete pending[i].result;
+    }
+}
+
+inline void AsyncBlackadder::publish_scope(const string &id, const string &prefix_id, unsigned char strategy, void *str_opt, unsigned int str_opt_len) {
+    ba->publish_scope(id, prefix_id, strategy, str_opt, str_opt_len);
+}
+
+inline EventFuture AsyncBlackadder::publish_info(const string &id, const string &prefix_id, unsigned char strategy, void *str_opt, unsigned int str_opt_len) {
+    /*wait before sending: the answer may be read by a dispatch called right after*/
+    EventFuture f(this, wait_for(prefix_id + id, ASYNC_EVENT_BIT(START_PUBLISH)));
+    ba->publish_info(id, prefix_id, strategy, str_opt, str_opt_len);
+    return f;
+}
+
+inline EventFuture AsyncBlackadder::subscribe_scope(const string &id, const string &prefix_id, unsigned char strategy, void *str_opt, unsigned int str_opt_len) {
+    EventFuture f(this, wait_for(prefix_id + id, ASYNC_EVENT_BIT(SCOPE_PUBLISHED) | ASYNC_EVENT_BIT(INFO_PUBLISHED) | ASYNC_EVENT_BIT(PUBLISHED_DATA)));
+    ba->subscribe_scope(id, prefix_id, strategy, str_opt, str_opt_len);
+    return f;
+}
+
+inline EventFuture AsyncBlackadder::subscribe_info(const string &id, const string &prefix_id, unsigned char strategy, void *str_opt, unsigned int str_opt_len) {
+    EventFuture f(this, wait_for(prefix_id + id, ASYNC_EVENT_BIT(PUBLISHED_DATA)));
+    ba->subscribe_info(id, prefix_id, strategy, str_opt, str_opt_len);
+    return f;
+}
+
+inline void AsyncBlackadder::unpublish_scope(const string &id, const string &prefix_id, unsigned char strategy, void *str_opt, unsigned int str_opt_len) {
+    cancel_all(prefix_id + id);
+    ba->unpublish_scope(id, prefix_id, strategy, str_opt, str_opt_len);
+}
+
+inline void AsyncBlackadder::unpublish_info(const string &id, const string &prefix_id, unsigned char strategy, void *str_opt, unsigned int str_opt_len) {
+    cancel_all(prefix_id + id);
+    ba->unpublish_info(id, prefix_id, strategy, str_opt, str_opt_len);
+}
+
+inline void AsyncBlackadder::unsubscribe_scope(const string &id, const string &prefix_id, unsigned char strategy, void *str_opt, unsigned int str_opt_len) {
+    cancel_all(prefix_id + id);
+    ba->unsubscribe_scope(id, prefix_id, strategy, str_opt, str_opt_len);
+}
+
+inline void AsyncBlackadder::unsubscribe_info(const string &id, const string &prefix_id, unsigned char strategy, void *str_opt, unsigned int str_opt_len) {
+    cancel_all(prefix_id + id);
+    ba->unsubscribe_info(id, prefix_id, strategy, str_opt, str_opt_len);
+}
+
+inline void AsyncBlackadder::publish_data(const string &id, unsigned char strategy, void *str_opt, unsigned int str_opt_len, void *data, unsigned int data_len) {
+    ba->publish_data(id, strategy, str_opt, str_opt_len, data, data_len);
+}
+
+inline EventFuture AsyncBlackadder::next_event(const string &id, unsigned int types) {
+    return EventFuture(this, wait_for(id, types));
+}
+
+inline void AsyncBlackadder::open_stream(const string &id, eventhandler handler, void *context, unsigned int types) {
+    Stream *&s = streams[id];
+    if (s == NULL) {
+        s = new Stream();
+    }
+    s->handler = handler;
+    s->context = context;
+    s->types = types;
+}
+
+inline void AsyncBlackadder::close_stream(const string &id) {
+    map<string, Stream *>::iterator it = streams.find(id);
+    if (it == streams.end()) {
+        return;
+    }
+    while (!it->second->queued.empty()) {
+        delete it->second->queued.front();
+        it->second->queued.pop_front();
+    }
+    delete it->second;
+    streams.erase(it);
+}
+
+inline Event *AsyncBlackadder::next(const string &id) {
+    map<string, Stream *>::iterator it = streams.find(id);
+    if (it == streams.end() || it->second->queued.empty()) {
+        return NULL;
+    }
+    Event *ev = it->second->queued.front();
+    it->second->queued.pop_front();
+    return ev;
+}
+
+inline void AsyncBlackadder::set_default_handler(eventhandler handler, void *context) {
+    default_handler = handler;
+    default_context = context;
+}
+
+inline int AsyncBlackadder::getFd() {
+    return ba->getFd();
+}
+
+inline int AsyncBlackadder::dispatch() {
+    int total = 0;
+    if (dispatching) {
+        return 0;
+    }
+    dispatching = true;
+    while (true) {
+        int n = ba->tryGetEvents(events, EVENT_BATCH_MAX);
+        if (n < 0) {
+            dispatching = false;
+            return total > 0 ? total : -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            deliver(events[i]);
+        }
+        total += n;
+    }
+    dispatching = false;
+    return total;
+}
+
+inline int AsyncBlackadder::poll(int timeout_ms) {
+    /*Events may already wait in the down ring or the pool without the descriptor being readable*/
+    int n = dispatch();
+    if (n != 0) {
+        return n;
+    }
+    struct pollfd pfd;
+    pfd.fd = ba->getFd();
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int ready = ::poll(&pfd, 1, timeout_ms);
+    if (ready < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+    if (ready == 0) {
+        return 0;
+    }
+    return dispatch();
+}
+
+inline void AsyncBlackadder::deliver(Event &ev) {
+    bool taken = false;
+    /*the futures first: every one waiting for the identifier or one of its prefixes is resolved*/
+    for (string::size_type len = ev.id.length();; len -= (len >= PURSUIT_ID_LEN ? PURSUIT_ID_LEN : len)) {
+        string prefix = ev.id.substr(0, len);
+        multimap<string, unsigned int>::iterator it = waiting.lower_bound(prefix);
+        while (it != waiting.end() && it->first == prefix) {
+            unsigned int slot = it->second;
+            if (!accepts(pending[slot].types, ev.type)) {
+                it++;
+                continue;
+            }
+            waiting.erase(it++);
+            pending[slot].waiting = false;
+            taken = true;
+            if (pending[slot].handler != NULL) {
+                eventhandler handler = pending[slot].handler;
+                void *context = pending[slot].context;
+                pending[slot].handler = NULL;
+                release(slot);
+                handler(ev, context);
+                /*the handler may have changed the map*/
+                it = waiting.lower_bound(prefix);
+            } else {
+                pending[slot].result = new Event(ev);
+            }
+        }
+        if (len == 0) {
+            break;
+        }
+    }
+    /*then the stream of the longest prefix*/
+    for (string::size_type len = ev.id.length();; len -= (len >= PURSUIT_ID_LEN ? PURSUIT_ID_LEN : len)) {
+        map<string, Stream *>::iterator it = streams.find(ev.id.substr(0, len));
+        if (it != streams.end() && accepts(it->second->types, ev.type)) {
+            if (it->second->handler != NULL) {
+                it->second->handler(ev, it->second->context);
+            } else {
+                it->second->queued.push_back(new Event(ev));
+            }
+            return;
+        }
+        if (len == 0) {
+            break;
+        }
+    }
+    if (taken) {
+        return;
+    }
+    if (default_handler != NULL) {
+        default_handler(ev, default_context);
+    } else {
+        dropped_events++;
+    }
+}
+
+inline unsigned int AsyncBlackadder::wait_for(const string &id, unsigned int types) {
+    unsigned int slot;
+    if (!free_slots.empty()) {
+        slot = free_slots.back();
+        free_slots.pop_back();
+    } else {
+        slot = pending.size();
+        pending.push_back(Pending());
+    }
+    pending[slot].id = id;
+    pending[slot].types = types;
+    pending[slot].refs = 0;
+    pending[slot].waiting = true;
+    pending[slot].result = NULL;
+    pending[slot].handler = NULL;
+    pending[slot].context = NULL;
+    waiting.insert(make_pair(id, slot));
+    return slot;
+}
+
+inline void AsyncBlackadder::unwait(unsigned int slot) {
+    if (!pending[slot].waiting) {
+        return;
+    }
+    multimap<string, unsigned int>::iterator it = waiting.lower_bound(pending[slot].id);
+    while (it != waiting.end() && it->first == pending[slot].id) {
+        if (it->second == slot) {
+            waiting.erase(it);
+            break;
+        }
+        it++;
+    }
+    pending[slot].waiting = false;
+}
+
+inline void AsyncBlackadder::release(unsigned int slot) {
+    if (pending[slot].refs > 0 || pending[slot].handler != NULL) {
+        return;
+    }
+    unwait(slot);
+    delete pending[slot].result;
+    pending[slot].result = NULL;
+    pending[slot].id.clear();
+    free_slots.push_back(slot);
+}
+
+inline void AsyncBlackadder::cancel_all(const string &id) {
+    multimap<string, unsigned int>::iterator it = waiting.lower_bound(id);
+    while (it != waiting.end() && it->first == id) {
+        unsigned int slot = it->second;
+        waiting.erase(it++);
+        pending[slot].waiting = false;
+        pending[slot].handler = NULL;
+        release(slot);
+    }
+}
+
+inline EventFuture::EventFuture(AsyncBlackadder *_owner, unsigned int _slot) : owner(_owner), slot(_slot) {
+    owner->pending[slot].refs++;
+}
+
+inline EventFuture::EventFuture(const EventFuture &f) : owner(f.owner), slot(f.slot) {
+    if (owner != NULL) {
+        owner->pending[slot].refs++;
+    }
+}
+
+inline EventFuture& EventFuture::operator=(const EventFuture &f) {
+    if (f.owner != NULL) {
+        f.owner->pending[f.slot].refs++;
+    }
+    if (owner != NULL) {
+        owner->pending[slot].refs--;
+        owner->release(slot);
+    }
+    owner = f.owner;
+    slot = f.slot;
+    return *this;
+}
+
+inline EventFuture::~EventFuture() {
+    if (owner != NULL) {
+        owner->pending[slot].refs--;
+        owner->release(slot);
+    }
+}
+
+inline bool EventFuture::valid() const {
+    return owner != NULL;
+}
+
+inline bool EventFuture::ready() const {
+    return owner != NULL && owner->pending[slot].result != NULL;
+}
+
+inline Event *EventFuture::get(int timeout_ms) {
+    if (owner == NULL) {
+        return NULL;
+    }
+    if (owner->pending[slot].result == NULL && owner->dispatching) {
+        return NULL;
+    }
+    /*handlers may add slots while we wait, so pending is indexed again on every round*/
+    while (owner->pending[slot].result == NULL && owner->pending[slot].waiting) {
+        int n = owner->poll(timeout_ms);
+        if (n < 0 || (n == 0 && timeout_ms >= 0)) {
+            break;
+        }
+    }
+    return owner->pending[slot].result;
+}
+
+inline void EventFuture::then(eventhandler handler, void *context) {
+    if (owner == NULL) {
+        return;
+    }
+    Event *result = owner->pending[slot].result;
+    if (result != NULL) {
+        owner->pending[slot].result = NULL;
+        handler(*result, context);
+        delete result;
+        return;
+    }
+    if (owner->pending[slot].waiting) {
+        owner->pending[slot].handler = handler;
+        owner->pending[slot].context = context;
+    }
+}
+
+inline void EventFuture::cancel() {
+    if (owner == NULL) {
+        return;
+    }
+    owner->unwait(slot);
+    owner->pending[slot].handler = NULL;
+}
+
+#endif /* ASYNC_BLACKADDER_HPP */
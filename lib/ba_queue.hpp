@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#ifndef BA_QUEUE_HPP
+#define BA_QUEUE_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**@brief (User Library) Our proposal a bounded lock-free queue for any number of producers and consumers.
+ *
+ * Every slot carries a sequence number that tells producers and consumers whose turn it is (D. Vyukov's bounded MPMC queue),
+ * so push and pop are a compare-and-swap on the position plus a release store on the slot; nothing ever blocks.
+ * The capacity is rounded up to a power of two. T must be copyable.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    BoundedQueue(size_t _capacity) : head(0), tail(0) {
+        capacity = 2;
+        while (capacity < _capacity) {
+            capacity <<= 1;
+        }
+        mask = capacity - 1;
+        slots = new Slot[capacity];
+        for (size_t i = 0; i < capacity; i++) {
+            slots[i].sequence = i;
+        }
+    }
+    ~BoundedQueue() {
+        delete [] slots;
+    }
+    /**@brief adds value at the end of the queue.
+     * @return false if the queue is full.
+     */
+    bool push(const T &value) {
+        Slot *slot;
+        size_t pos = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+        while (true) {
+            slot = &slots[pos & mask];
+            size_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+            intptr_t diff = (intptr_t) sequence - (intptr_t) pos;
+            if (diff == 0) {
+                if (__atomic_compare_exchange_n(&tail, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+            }
+        }
+        slot->value = value;
+        __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+    /**@brief removes the first value of the queue.
+     * @return false if the queue is empty.
+     */
+    bool pop(T &value) {
+        Slot *slot;
+        size_t pos = __atomic_load_n(&head, __ATOMIC_RELAXED);
+        while (true) {
+            slot = &slots[pos & mask];
+            size_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+            intptr_t diff = (intptr_t) sequence - (intptr_t) (pos + 1);
+            if (diff == 0) {
+                if (__atomic_compare_exchange_n(&head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = __atomic_load_n(&head, __ATOMIC_RELAXED);
+            }
+        }
+        value = slot->value;
+        __atomic_store_n(&slot->sequence, pos + mask + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+    /**@brief a hint only: other threads may push or pop at the same time.
+     */
+    bool empty() const {
+        return __atomic_load_n(&head, __ATOMIC_ACQUIRE) == __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+    }
+    /**@brief a hint only, like empty().
+     */
+    size_t size() const {
+        size_t h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+        size_t t = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+        return (t > h) ? ((t - h < capacity) ? t - h : capacity) : 0;
+    }
+    size_t max_size() const {
+        return capacity;
+    }
+private:
+    BoundedQueue(const BoundedQueue &);
+    BoundedQueue &operator=(const BoundedQueue &);
+    struct Slot {
+        size_t sequence;
+        T value;
+    };
+    Slot *slots;
+    size_t capacity;
+    size_t mask;
+    /*producers and consumers work on different cache lines*/
+    char pad0[64];
+    size_t head;
+    char pad1[64];
+    size_t tail;
+    char pad2[64];
+};
+
+#endif /* BA_QUEUE_HPP */
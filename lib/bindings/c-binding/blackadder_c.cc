@@ -34,6 +34,19 @@ _BA_FUNC_DEF(unsubscribe_info)
 
 _BA_FUNC_DEF_DATA(publish_data)
 
+extern "C" unsigned int
+ba_publish_data_batch(ba_handle ba, const ba_data_item *items, unsigned int count,
+                      unsigned char strategy, void *str_opt, unsigned int str_opt_len)
+{
+    vector<PublishDataItem> _items(count);
+    for (unsigned int i = 0; i < count; i++) {
+        _items[i].id = string(items[i].id, items[i].id_len);
+        _items[i].data = items[i].data;
+        _items[i].data_len = items[i].data_len;
+    }
+    return ((Blackadder *)ba->instance)->publish_data_batch(_items, strategy, str_opt, str_opt_len);
+}
+
 extern "C" ba_handle
 ba_instance(int user_space)
 {
@@ -67,6 +80,42 @@ ba_get_event(ba_handle ba, ba_event ev)
     ((Blackadder *)ba->instance)->getEvent(*((Event *)ev));
 }
 
+extern "C" int
+ba_fd(ba_handle ba)
+{
+    return ((Blackadder *)ba->instance)->getFd();
+}
+
+extern "C" ba_event_batch
+ba_event_batch_new(void)
+{
+    return new (nothrow) _ba_event_batch;
+}
+
+extern "C" void
+ba_event_batch_delete(ba_event_batch batch)
+{
+    delete batch;
+}
+
+extern "C" int
+ba_get_events(ba_handle ba, ba_event_batch batch)
+{
+    return ((Blackadder *)ba->instance)->getEvents(batch->events, EVENT_BATCH_MAX);
+}
+
+extern "C" int
+ba_try_get_events(ba_handle ba, ba_event_batch batch)
+{
+    return ((Blackadder *)ba->instance)->tryGetEvents(batch->events, EVENT_BATCH_MAX);
+}
+
+extern "C" ba_event
+ba_event_batch_get(ba_event_batch batch, int i)
+{
+    return (ba_event)&batch->events[i];
+}
+
 extern "C" ba_event
 ba_event_new(void)
 {
@@ -86,6 +86,10 @@ typedef void *ba_event;
 struct _ba_handle {
     Blackadder *instance;
 };
+
+struct _ba_event_batch {
+    Event events[EVENT_BATCH_MAX];
+};
 #endif /* __cplusplus */
 
 /*
@@ -102,6 +106,22 @@ _BA_FUNC_DECL(unsubscribe_info);
 
 _BA_FUNC_DECL_DATA(publish_data);
 
+/*
+ * Batched publish_data(): all items share the strategy and its options.
+ * Returns the number of items that were sent.
+ */
+typedef struct {
+    const char *id;
+    unsigned int id_len;
+    void *data;
+    unsigned int data_len;
+} ba_data_item;
+
+unsigned int ba_publish_data_batch(ba_handle ba,
+                                   const ba_data_item *items, unsigned int count,
+                                   unsigned char strategy,
+                                   void *str_opt, unsigned int str_opt_len);
+
 /*
  * Other Blackadder instance functions.
  */
@@ -111,6 +131,25 @@ void ba_disconnect(ba_handle ba);
 
 void ba_get_event(ba_handle ba, ba_event ev);
 
+/*
+ * Event loop integration without a library thread (unlike nb_blackadder_c.h):
+ * watch ba_fd() for readability (poll, epoll, libuv, ...) and call
+ * ba_try_get_events(), which never blocks and returns the number of
+ * events put in the batch (0 if none is waiting, -1 on error). With
+ * edge-triggered notification call it until it returns 0.  The events
+ * from ba_event_batch_get() can be read with the accessors below, they
+ * belong to the batch and stay valid until its next fill.
+ * ba_get_events() is the same but blocks for the first event.
+ */
+typedef struct _ba_event_batch *ba_event_batch;
+
+int ba_fd(ba_handle ba);
+ba_event_batch ba_event_batch_new(void);
+void ba_event_batch_delete(ba_event_batch batch);
+int ba_get_events(ba_handle ba, ba_event_batch batch);
+int ba_try_get_events(ba_handle ba, ba_event_batch batch);
+ba_event ba_event_batch_get(ba_event_batch batch, int i);
+
 /*
  * Accessor functions for the Event class.
  */
@@ -100,3 +100,22 @@ nb_ba_join(nb_ba_handle ba)
 {
     ((NB_Blackadder *)ba)->join();
 }
+
+extern "C" int
+nb_ba_try_publish_data(nb_ba_handle ba, _BA_PARAMS_DATA)
+{
+    string _id (id, id_len);
+    return ba->instance->try_publish_data(_id, strategy, str_opt, str_opt_len, data, data_len) ? 1 : 0;
+}
+
+extern "C" unsigned int
+nb_ba_credits(nb_ba_handle ba)
+{
+    return ba->instance->credits();
+}
+
+extern "C" void
+nb_ba_set_writable_callback(nb_ba_handle ba, nb_ba_writabletype wf)
+{
+    ba->instance->setWritableCallback(wf);
+}
@@ -19,6 +19,7 @@
 struct _nb_ba_handle;
 typedef struct _nb_ba_handle *nb_ba_handle;
 typedef void (*nb_ba_callbacktype)(ba_event);
+typedef void (*nb_ba_writabletype)(unsigned int credits);
 
 /*
  * We use C macro magic to wrap the publish_*(), unpublish_*(),
@@ -81,4 +82,12 @@ void nb_ba_worker(nb_ba_handle ba, void *arg);
 void nb_ba_signal_handler(nb_ba_handle ba, int sig);
 void nb_ba_join(nb_ba_handle ba);
 
+/*
+ * Flow control: nb_ba_try_publish_data() returns 0 (and keeps the data
+ * with the caller) instead of waiting when the output queue is full.
+ */
+int nb_ba_try_publish_data(nb_ba_handle ba, _BA_PARAMS_DATA);
+unsigned int nb_ba_credits(nb_ba_handle ba);
+void nb_ba_set_writable_callback(nb_ba_handle ba, nb_ba_writabletype wf);
+
 #endif /* NB_BLACKADDER_H */
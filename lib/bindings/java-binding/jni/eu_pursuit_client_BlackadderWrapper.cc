@@ -17,9 +17,36 @@
 #include <blackadder.hpp>
 #include <string>
 #include <stdio.h>
+#include <stdlib.h>
 
 using std::string;
 
+/*
+ * our proposal the layout of the descriptors of an EventBatch (see EventBatch.java):
+ * EVENT_BATCH_MAX entries of BATCH_ENTRY_INTS ints (native byte order), then the ids
+ */
+#define BATCH_ENTRY_INTS 6
+#define BATCH_TYPE 0
+#define BATCH_SLOT 1
+#define BATCH_DATA_OFFSET 2
+#define BATCH_DATA_LENGTH 3
+#define BATCH_ID_OFFSET 4
+#define BATCH_ID_LENGTH 5
+#define BATCH_ENTRIES_SIZE (EVENT_BATCH_MAX * BATCH_ENTRY_INTS * sizeof(jint))
+
+/*
+ * our proposal the native side of an EventBatch: the Events of the last getEvents call
+ * and the receive pool buffers of the library that the Java side already has a view of
+ */
+struct JNIEventBatch {
+	JNIEventBatch() : descriptors(NULL), descriptors_size(0) {}
+	Event events[EVENT_BATCH_MAX];
+	/*bases[slot] is the buffer behind EventBatch.views[slot]*/
+	vector<void *> bases;
+	char *descriptors;
+	unsigned int descriptors_size;
+};
+
 void print_contents(char *data_ptr, int length){
 	for(int i=0; i<length; i++){
 		printf("%d ", data_ptr[i]);	
@@ -88,15 +115,14 @@ JNIEXPORT void JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1publish_1scop
 	ba->publish_scope(scope_str, scope_prefix_str, (char)strategy, str_opt, str_opt_len);
 
         /*
-         * XXX: Because the ID strings are expected to be constant,
-         *      ReleaseByteArrayElements() could be called with
-         *      JNI_ABORT instead of 0.
+         * the ID strings and the strategy options are only read, so they
+         * are released with JNI_ABORT (nothing is copied back)
          */
-	(*env).ReleaseByteArrayElements(scope, scope_ptr, (jint)0);
-	(*env).ReleaseByteArrayElements(scope_prefix, scope_prefix_ptr, (jint)0);	
+	(*env).ReleaseByteArrayElements(scope, scope_ptr, (jint)JNI_ABORT);
+	(*env).ReleaseByteArrayElements(scope_prefix, scope_prefix_ptr, (jint)JNI_ABORT);	
 	
 	if(jstr_opt != 0){	
-		(*env).ReleaseByteArrayElements(jstr_opt, (jbyte *)str_opt, (jint)0);		
+		(*env).ReleaseByteArrayElements(jstr_opt, (jbyte *)str_opt, (jint)JNI_ABORT);		
 	}
 }
 
@@ -133,11 +159,11 @@ JNIEXPORT void JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1publish_1item
 	 */
 	ba->publish_info(rid_str, sid_str, (char)strategy, str_opt, str_opt_len);
 
-	(*env).ReleaseByteArrayElements(rid, rid_ptr, (jint)0);
-	(*env).ReleaseByteArrayElements(sid, sid_ptr, (jint)0);	
+	(*env).ReleaseByteArrayElements(rid, rid_ptr, (jint)JNI_ABORT);
+	(*env).ReleaseByteArrayElements(sid, sid_ptr, (jint)JNI_ABORT);	
 	
 	if(jstr_opt != 0){	
-		(*env).ReleaseByteArrayElements(jstr_opt, (jbyte *)str_opt, (jint)0);		
+		(*env).ReleaseByteArrayElements(jstr_opt, (jbyte *)str_opt, (jint)JNI_ABORT);		
 	}
 }
 
@@ -174,11 +200,11 @@ JNIEXPORT void JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1unpublish_1sc
 	 */
 	ba->unpublish_scope(scope_str, scope_prefix_str, (char)strategy, str_opt, str_opt_len);
 
-	(*env).ReleaseByteArrayElements(scope, scope_ptr, (jint)0);
-	(*env).ReleaseByteArrayElements(scope_prefix, scope_prefix_ptr, (jint)0);	
+	(*env).ReleaseByteArrayElements(scope, scope_ptr, (jint)JNI_ABORT);
+	(*env).ReleaseByteArrayElements(scope_prefix, scope_prefix_ptr, (jint)JNI_ABORT);	
 	
 	if(jstr_opt != 0){	
-		(*env).ReleaseByteArrayElements(jstr_opt, (jbyte *)str_opt, (jint)0);		
+		(*env).ReleaseByteArrayElements(jstr_opt, (jbyte *)str_opt, (jint)JNI_ABORT);		
 	}
 }
 
@@ -217,11 +243,11 @@ JNIEXPORT void JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1unpublish_1it
 	 */
 	ba->unpublish_info(rid_str, sid_str, (char)strategy, str_opt, str_opt_len);
 
-	(*env).ReleaseByteArrayElements(rid, rid_ptr, (jint)0);
-	(*env).ReleaseByteArrayElements(sid, sid_ptr, (jint)0);	
+	(*env).ReleaseByteArrayElements(rid, rid_ptr, (jint)JNI_ABORT);
+	(*env).ReleaseByteArrayElements(sid, sid_ptr, (jint)JNI_ABORT);	
 	
 	if(jstr_opt != 0){	
-		(*env).ReleaseByteArrayElements(jstr_opt, (jbyte *)str_opt, (jint)0);		
+		(*env).ReleaseByteArrayElements(jstr_opt, (jbyte *)str_opt, (jint)JNI_ABORT);		
 	}
 }
 
@@ -258,11 +284,11 @@ JNIEXPORT void JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1subscribe_1sc
 	 */
 	ba->subscribe_scope(scope_str, scope_prefix_str, (char)strategy, str_opt, str_opt_len);
 
-	(*env).ReleaseByteArrayElements(scope, scope_ptr, (jint)0);
-	(*env).ReleaseByteArrayElements(scope_prefix, scope_prefix_ptr, (jint)0);	
+	(*env).ReleaseByteArrayElements(scope, scope_ptr, (jint)JNI_ABORT);
+	(*env).ReleaseByteArrayElements(scope_prefix, scope_prefix_ptr, (jint)JNI_ABORT);	
 	
 	if(jstr_opt != 0){	
-		(*env).ReleaseByteArrayElements(jstr_opt, (jbyte *)str_opt, (jint)0);		
+		(*env).ReleaseByteArrayElements(jstr_opt, (jbyte *)str_opt, (jint)JNI_ABORT);		
 	}
 }
 
@@ -299,11 +325,11 @@ JNIEXPORT void JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1subscribe_1it
 	 */
 	ba->subscribe_info(rid_str, sid_str, (char)strategy, str_opt, str_opt_len);
 
-	(*env).ReleaseByteArrayElements(rid, rid_ptr, (jint)0);
-	(*env).ReleaseByteArrayElements(sid, sid_ptr, (jint)0);	
+	(*env).ReleaseByteArrayElements(rid, rid_ptr, (jint)JNI_ABORT);
+	(*env).ReleaseByteArrayElements(sid, sid_ptr, (jint)JNI_ABORT);	
 	
 	if(jstr_opt != 0){	
-		(*env).ReleaseByteArrayElements(jstr_opt, (jbyte *)str_opt, (jint)0);		
+		(*env).ReleaseByteArrayElements(jstr_opt, (jbyte *)str_opt, (jint)JNI_ABORT);		
 	}
 }
 
@@ -340,11 +366,11 @@ JNIEXPORT void JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1unsubscribe_1
 	 */
 	ba->unsubscribe_scope(scope_str, scope_prefix_str, (char)strategy, str_opt, str_opt_len);
 
-	(*env).ReleaseByteArrayElements(scope, scope_ptr, (jint)0);
-	(*env).ReleaseByteArrayElements(scope_prefix, scope_prefix_ptr, (jint)0);	
+	(*env).ReleaseByteArrayElements(scope, scope_ptr, (jint)JNI_ABORT);
+	(*env).ReleaseByteArrayElements(scope_prefix, scope_prefix_ptr, (jint)JNI_ABORT);	
 	
 	if(jstr_opt != 0){	
-		(*env).ReleaseByteArrayElements(jstr_opt, (jbyte *)str_opt, (jint)0);		
+		(*env).ReleaseByteArrayElements(jstr_opt, (jbyte *)str_opt, (jint)JNI_ABORT);		
 	}
 }
 
@@ -383,11 +409,11 @@ JNIEXPORT void JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1unsubscribe_1
 	 */
 	ba->unsubscribe_info(rid_str, sid_str, (char)strategy, str_opt, str_opt_len);
 
-	(*env).ReleaseByteArrayElements(rid, rid_ptr, (jint)0);
-	(*env).ReleaseByteArrayElements(sid, sid_ptr, (jint)0);	
+	(*env).ReleaseByteArrayElements(rid, rid_ptr, (jint)JNI_ABORT);
+	(*env).ReleaseByteArrayElements(sid, sid_ptr, (jint)JNI_ABORT);	
 	
 	if(jstr_opt != 0){	
-		(*env).ReleaseByteArrayElements(jstr_opt, (jbyte *)str_opt, (jint)0);		
+		(*env).ReleaseByteArrayElements(jstr_opt, (jbyte *)str_opt, (jint)JNI_ABORT);		
 	}
 }
 
@@ -419,10 +445,10 @@ JNIEXPORT void JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1publish_1data
 	
 	ba->publish_data(name_str, (char)strategy, str_opt, str_opt_len, (char *)data_ptr, (int)length);
 	
-	(*env).ReleaseByteArrayElements(name, name_ptr, (jint)0);
+	(*env).ReleaseByteArrayElements(name, name_ptr, (jint)JNI_ABORT);
 	
         if(jstr_opt != 0){	
-		(*env).ReleaseByteArrayElements(jstr_opt, (jbyte *)str_opt, (jint)0);		
+		(*env).ReleaseByteArrayElements(jstr_opt, (jbyte *)str_opt, (jint)JNI_ABORT);		
 	}
 }
 
@@ -455,15 +481,66 @@ JNIEXPORT void JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1publish_1data
 
 	ba->publish_data(name_str, (char)strategy, str_opt, str_opt_len, (char *)data_ptr, (int)datalen);
 
-	(*env).ReleaseByteArrayElements(name, name_ptr, (jint)0);
-	(*env).ReleaseByteArrayElements(data, data_ptr, (jint)0);
+	(*env).ReleaseByteArrayElements(name, name_ptr, (jint)JNI_ABORT);
+	(*env).ReleaseByteArrayElements(data, data_ptr, (jint)JNI_ABORT);
 	
         if(jstr_opt != 0){	
-		(*env).ReleaseByteArrayElements(jstr_opt, (jbyte *)str_opt, (jint)0);		
+		(*env).ReleaseByteArrayElements(jstr_opt, (jbyte *)str_opt, (jint)JNI_ABORT);		
 	}	
 }
 
 
+/*
+ * Class:     eu_pursuit_client_BlackadderWrapper
+ * Method:    c_publish_data_batch
+ * Signature: (J[[BB[B[[B)I
+ */
+JNIEXPORT jint JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1publish_1data_1batch
+  (JNIEnv *env, jobject, jlong ba_ptr, jobjectArray ids, jbyte strategy, jbyteArray jstr_opt, jobjectArray data){
+	Blackadder *ba;
+	ba = (Blackadder *)ba_ptr;
+
+	jboolean copy = (jboolean)false;
+	int count = (*env).GetArrayLength(ids);
+	vector<PublishDataItem> items(count);
+	vector<jbyteArray> data_arrays(count);
+	vector<jbyte *> data_ptrs(count);
+
+	void *str_opt;
+	str_opt = 0;
+	unsigned int str_opt_len = 0;
+
+	if(jstr_opt != NULL && (str_opt_len = (*env).GetArrayLength(jstr_opt)) > 0) {
+		str_opt = (void *) (*env).GetByteArrayElements(jstr_opt, &copy);
+	}
+
+	/*the ids are copied, the data arrays stay pinned until the batch is sent*/
+	for(int i = 0; i < count; i++){
+		jbyteArray id = (jbyteArray)(*env).GetObjectArrayElement(ids, i);
+		jbyte *id_ptr = (*env).GetByteArrayElements(id, &copy);
+		items[i].id = string((char *)id_ptr, (*env).GetArrayLength(id));
+		(*env).ReleaseByteArrayElements(id, id_ptr, (jint)JNI_ABORT);
+		(*env).DeleteLocalRef(id);
+
+		data_arrays[i] = (jbyteArray)(*env).GetObjectArrayElement(data, i);
+		data_ptrs[i] = (*env).GetByteArrayElements(data_arrays[i], &copy);
+		items[i].data = (void *)data_ptrs[i];
+		items[i].data_len = (*env).GetArrayLength(data_arrays[i]);
+	}
+
+	unsigned int sent = ba->publish_data_batch(items, (char)strategy, str_opt, str_opt_len);
+
+	for(int i = 0; i < count; i++){
+		(*env).ReleaseByteArrayElements(data_arrays[i], data_ptrs[i], (jint)JNI_ABORT);
+		(*env).DeleteLocalRef(data_arrays[i]);
+	}
+
+	if(jstr_opt != 0){
+		(*env).ReleaseByteArrayElements(jstr_opt, (jbyte *)str_opt, (jint)JNI_ABORT);
+	}
+	return (jint)sent;
+}
+
 /*
  * Class:     eu_pursuit_client_BlackadderWrapper
  * Method:    c_nextEvent_direct
@@ -523,4 +600,166 @@ JNIEXPORT void JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1delete_1event
 	delete event;
 }
 
+/*
+ * Class:     eu_pursuit_client_BlackadderWrapper
+ * Method:    c_publish_data_range
+ * Signature: (J[BB[BLjava/nio/ByteBuffer;II)V
+ */
+JNIEXPORT void JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1publish_1data_1range
+  (JNIEnv *env, jobject, jlong ba_ptr, jbyteArray name, jbyte strategy, jbyteArray jstr_opt, jobject jbytebuffer, jint offset, jint length){
+	Blackadder *ba;
+	ba = (Blackadder *)ba_ptr;
+
+	/*
+	 * our proposal the name and the strategy options are copied into native memory
+	 * (they are short), nothing is pinned and the data is read where it is
+	 */
+	string name_str((*env).GetArrayLength(name), '\0');
+	(*env).GetByteArrayRegion(name, 0, name_str.length(), (jbyte *)&name_str[0]);
+
+	char str_opt[256];
+	unsigned int str_opt_len = 0;
+
+	if(jstr_opt != NULL && (str_opt_len = (*env).GetArrayLength(jstr_opt)) > 0) {
+		if(str_opt_len > sizeof(str_opt)){
+			printf("JNI: strategy options of %u bytes are too long\n", str_opt_len);
+			return;
+		}
+		(*env).GetByteArrayRegion(jstr_opt, 0, str_opt_len, (jbyte *)str_opt);
+	}
 
+	char *data_ptr = (char *)(*env).GetDirectBufferAddress(jbytebuffer);
+	if(data_ptr == NULL || offset < 0 || length < 0 || offset + length > (*env).GetDirectBufferCapacity(jbytebuffer)){
+		printf("JNI: publish_data needs a direct ByteBuffer holding the range\n");
+		return;
+	}
+
+	ba->publish_data(name_str, (char)strategy, str_opt_len > 0 ? (void *)str_opt : NULL, str_opt_len, data_ptr + offset, (unsigned int)length);
+}
+
+/*
+ * Class:     eu_pursuit_client_BlackadderWrapper
+ * Method:    c_alloc_buffer
+ * Signature: (I)Ljava/nio/ByteBuffer;
+ */
+JNIEXPORT jobject JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1alloc_1buffer
+  (JNIEnv *env, jobject, jint size){
+	void *memory = malloc(size);
+	if(memory == NULL){
+		return NULL;
+	}
+	return (*env).NewDirectByteBuffer(memory, (jlong)size);
+}
+
+/*
+ * Class:     eu_pursuit_client_BlackadderWrapper
+ * Method:    c_free_buffer
+ * Signature: (Ljava/nio/ByteBuffer;)V
+ */
+JNIEXPORT void JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1free_1buffer
+  (JNIEnv *env, jobject, jobject jbytebuffer){
+	free((*env).GetDirectBufferAddress(jbytebuffer));
+}
+
+/*
+ * Class:     eu_pursuit_client_BlackadderWrapper
+ * Method:    c_new_event_batch
+ * Signature: ()J
+ */
+JNIEXPORT jlong JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1new_1event_1batch
+  (JNIEnv *, jobject){
+	return (jlong)new JNIEventBatch();
+}
+
+/*
+ * Class:     eu_pursuit_client_BlackadderWrapper
+ * Method:    c_delete_event_batch
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1delete_1event_1batch
+  (JNIEnv *, jobject, jlong batch_ptr){
+	JNIEventBatch *batch = (JNIEventBatch *)batch_ptr;
+	free(batch->descriptors);
+	delete batch;
+}
+
+/*
+ * Class:     eu_pursuit_client_BlackadderWrapper
+ * Method:    c_next_events
+ * Signature: (JJLeu/pursuit/client/EventBatch;)I
+ */
+JNIEXPORT jint JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1next_1events
+  (JNIEnv *env, jobject, jlong ba_ptr, jlong batch_ptr, jobject obj_EventBatch){
+	Blackadder *ba;
+	ba = (Blackadder *)ba_ptr;
+	JNIEventBatch *batch = (JNIEventBatch *)batch_ptr;
+
+	/*
+	 * our proposal the Events are views into the receive pool of the library. Java gets one direct
+	 * ByteBuffer per pool buffer the first time the buffer is seen and then only reads the descriptors,
+	 * so that no Java object is allocated per event
+	 */
+	int count = ba->getEvents(batch->events, EVENT_BATCH_MAX);
+
+	unsigned int needed = BATCH_ENTRIES_SIZE;
+	for(int i = 0; i < count; i++){
+		needed += batch->events[i].id.length();
+	}
+	if(needed > batch->descriptors_size){
+		unsigned int size = needed > 2 * batch->descriptors_size ? needed : 2 * batch->descriptors_size;
+		char *descriptors = (char *)malloc(size);
+		if(descriptors == NULL){
+			printf("JNI: could not allocate the descriptors of an EventBatch\n");
+			return 0;
+		}
+		jobject jdescriptors = (*env).NewDirectByteBuffer(descriptors, (jlong)size);
+		jfieldID descriptorsField = (*env).GetFieldID((*env).GetObjectClass(obj_EventBatch), "descriptors", "Ljava/nio/ByteBuffer;");
+		(*env).SetObjectField(obj_EventBatch, descriptorsField, jdescriptors);
+		(*env).DeleteLocalRef(jdescriptors);
+		free(batch->descriptors);
+		batch->descriptors = descriptors;
+		batch->descriptors_size = size;
+	}
+
+	jobjectArray views = NULL;
+	unsigned int id_offset = BATCH_ENTRIES_SIZE;
+	for(int i = 0; i < count; i++){
+		Event &ev = batch->events[i];
+		jint *entry = (jint *)batch->descriptors + i * BATCH_ENTRY_INTS;
+		entry[BATCH_TYPE] = ev.type;
+		entry[BATCH_SLOT] = -1;
+		entry[BATCH_DATA_OFFSET] = 0;
+		entry[BATCH_DATA_LENGTH] = 0;
+		if(ev.data != NULL && ev.pooled){
+			unsigned int slot = 0;
+			while(slot < batch->bases.size() && batch->bases[slot] != ev.buffer){
+				slot++;
+			}
+			if(slot == batch->bases.size()){
+				if(views == NULL){
+					jfieldID viewsField = (*env).GetFieldID((*env).GetObjectClass(obj_EventBatch), "views", "[Ljava/nio/ByteBuffer;");
+					views = (jobjectArray)(*env).GetObjectField(obj_EventBatch, viewsField);
+				}
+				if(slot < (unsigned int)(*env).GetArrayLength(views)){
+					jobject view = (*env).NewDirectByteBuffer(ev.buffer, (jlong)EVENT_BUFFER_SIZE);
+					(*env).SetObjectArrayElement(views, slot, view);
+					(*env).DeleteLocalRef(view);
+					batch->bases.push_back(ev.buffer);
+				}
+			}
+			if(slot < batch->bases.size()){
+				entry[BATCH_SLOT] = slot;
+				entry[BATCH_DATA_OFFSET] = (char *)ev.data - (char *)ev.buffer;
+				entry[BATCH_DATA_LENGTH] = ev.data_len;
+			}
+		}
+		entry[BATCH_ID_OFFSET] = id_offset;
+		entry[BATCH_ID_LENGTH] = ev.id.length();
+		memcpy(batch->descriptors + id_offset, ev.id.data(), ev.id.length());
+		id_offset += ev.id.length();
+	}
+	if(views != NULL){
+		(*env).DeleteLocalRef(views);
+	}
+	return (jint)count;
+}
@@ -103,6 +103,14 @@ JNIEXPORT void JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1publish_1data
 JNIEXPORT void JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1publish_1data_1direct
   (JNIEnv *, jobject, jlong, jbyteArray, jbyte, jbyteArray, jobject, jint);
 
+/*
+ * Class:     eu_pursuit_client_BlackadderWrapper
+ * Method:    c_publish_data_batch
+ * Signature: (J[[BB[B[[B)I
+ */
+JNIEXPORT jint JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1publish_1data_1batch
+  (JNIEnv *, jobject, jlong, jobjectArray, jbyte, jbyteArray, jobjectArray);
+
 /*
  * Class:     eu_pursuit_client_BlackadderWrapper
  * Method:    c_nextEvent_direct
@@ -119,6 +127,54 @@ JNIEXPORT jlong JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1nextEvent_1d
 JNIEXPORT void JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1delete_1event
   (JNIEnv *, jobject, jlong, jlong);
 
+/*
+ * Class:     eu_pursuit_client_BlackadderWrapper
+ * Method:    c_publish_data_range
+ * Signature: (J[BB[BLjava/nio/ByteBuffer;II)V
+ */
+JNIEXPORT void JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1publish_1data_1range
+  (JNIEnv *, jobject, jlong, jbyteArray, jbyte, jbyteArray, jobject, jint, jint);
+
+/*
+ * Class:     eu_pursuit_client_BlackadderWrapper
+ * Method:    c_alloc_buffer
+ * Signature: (I)Ljava/nio/ByteBuffer;
+ */
+JNIEXPORT jobject JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1alloc_1buffer
+  (JNIEnv *, jobject, jint);
+
+/*
+ * Class:     eu_pursuit_client_BlackadderWrapper
+ * Method:    c_free_buffer
+ * Signature: (Ljava/nio/ByteBuffer;)V
+ */
+JNIEXPORT void JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1free_1buffer
+  (JNIEnv *, jobject, jobject);
+
+/*
+ * Class:     eu_pursuit_client_BlackadderWrapper
+ * Method:    c_new_event_batch
+ * Signature: ()J
+ */
+JNIEXPORT jlong JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1new_1event_1batch
+  (JNIEnv *, jobject);
+
+/*
+ * Class:     eu_pursuit_client_BlackadderWrapper
+ * Method:    c_delete_event_batch
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1delete_1event_1batch
+  (JNIEnv *, jobject, jlong);
+
+/*
+ * Class:     eu_pursuit_client_BlackadderWrapper
+ * Method:    c_next_events
+ * Signature: (JJLeu/pursuit/client/EventBatch;)I
+ */
+JNIEXPORT jint JNICALL Java_eu_pursuit_client_BlackadderWrapper_c_1next_1events
+  (JNIEnv *, jobject, jlong, jlong, jobject);
+
 #ifdef __cplusplus
 }
 #endif
@@ -95,6 +95,65 @@ public class BlackadderWrapper {
 		c_publish_data_direct(baPtr, scope, strat, strategyOptions, buffer, buffer.capacity());		
 	}
 	
+	/*
+	 * our proposal publishes ids[i] with data[i] for every i in one native call
+	 * returns the number of items sent
+	 * */
+	public int publishDataBatch(byte[][] ids, byte strat, byte[] strategyOptions, byte[][] data) {
+		if(ids.length != data.length){
+			throw new IllegalArgumentException("ids and data must have the same length");
+		}
+		return c_publish_data_batch(baPtr, ids, strat, strategyOptions, data);
+	}
+	
+	/*
+	 * our proposal publishes the length bytes at offset of a direct buffer (e.g. from a NativeBufferPool)
+	 * without pinning or copying anything on the Java heap
+	 * */
+	public void publishData(byte[] scope, byte strat, byte[] strategyOptions, ByteBuffer buffer, int offset, int length) {
+		if(!buffer.isDirect()){
+			throw new IllegalArgumentException("the buffer must be direct");
+		}
+		c_publish_data_range(baPtr, scope, strat, strategyOptions, buffer, offset, length);
+	}
+	
+	/*
+	 * our proposal a pool of direct buffers in native memory, preallocate of them are allocated right away
+	 * */
+	public NativeBufferPool newBufferPool(int bufferSize, int preallocate) {
+		return new NativeBufferPool(this, bufferSize, preallocate);
+	}
+	
+	ByteBuffer allocateBuffer(int size) {
+		return c_alloc_buffer(size);
+	}
+	
+	void freeBuffer(ByteBuffer buffer) {
+		c_free_buffer(buffer);
+	}
+	
+	public EventBatch newEventBatch() {
+		return new EventBatch(this, c_new_event_batch());
+	}
+	
+	/*
+	 * our proposal blocks until at least one event is received and fills the batch with all events
+	 * that are already waiting (at most EventBatch.MAX_EVENTS), without allocating per event
+	 * returns the number of events, 0 if the call was interrupted
+	 * */
+	public int getNextEvents(EventBatch batch) {
+		if(batch.batch_ptr == 0){
+			throw new IllegalStateException("the batch is closed");
+		}
+		int count = c_next_events(baPtr, batch.batch_ptr, batch);
+		batch.filled(count);
+		return count;
+	}
+	
+	void deleteEventBatch(EventBatch batch) {
+		c_delete_event_batch(batch.batch_ptr);
+	}
+	
 	public Event getNextEventDirect() {
 		EventInternal e = new EventInternal();
 		long event_ptr = c_nextEvent_direct(baPtr, e);		
@@ -147,8 +206,16 @@ public class BlackadderWrapper {
 	
 	private native void c_publish_data(long ba_ptr, byte[] scope, byte strat, byte[] strategyOptions, byte [] dataBuffer, int length);
 	private native void c_publish_data_direct(long ba_ptr, byte[] scope, byte strat, byte[] strategyOptions, ByteBuffer buffer, int length);
+	private native int c_publish_data_batch(long ba_ptr, byte[][] ids, byte strat, byte[] strategyOptions, byte[][] data);
 	
 	private native long c_nextEvent_direct(long baPtr, EventInternal e);
 	
 	private native void c_delete_event(long baPtr, long event_ptr);		
+	
+	private native void c_publish_data_range(long ba_ptr, byte[] scope, byte strat, byte[] strategyOptions, ByteBuffer buffer, int offset, int length);
+	private native ByteBuffer c_alloc_buffer(int size);
+	private native void c_free_buffer(ByteBuffer buffer);
+	private native long c_new_event_batch();
+	private native void c_delete_event_batch(long batch_ptr);
+	private native int c_next_events(long baPtr, long batch_ptr, EventBatch batch);
 }
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2011  Christos Tsilopoulos, Mobile Multimedia Laboratory, 
+ * Athens University of Economics and Business 
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+package eu.pursuit.client;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+/*
+ * our proposal the events of one BlackadderWrapper.getNextEvents call
+ * 
+ * The data of the events is not copied: getData returns a view into the receive
+ * pool of the native library and the ids are read from a native descriptor buffer,
+ * so that polling allocates no Java objects once every pool buffer has been seen.
+ * Everything returned stays valid only until the next getNextEvents call with this batch.
+ * A batch is used by one thread at a time and must be closed before the wrapper.
+ * */
+public class EventBatch {
+	/*EVENT_BATCH_MAX of blackadder.hpp*/
+	public static final int MAX_EVENTS = 32;
+	
+	/*the layout of a descriptor entry, see eu_pursuit_client_BlackadderWrapper.cc*/
+	private static final int ENTRY_SIZE = 24;
+	private static final int TYPE = 0;
+	private static final int SLOT = 4;
+	private static final int DATA_OFFSET = 8;
+	private static final int DATA_LENGTH = 12;
+	private static final int ID_OFFSET = 16;
+	private static final int ID_LENGTH = 20;
+	
+	private final BlackadderWrapper wrapper;
+	long batch_ptr;
+	int count = 0;
+	/*set by the native code*/
+	ByteBuffer descriptors = null;
+	ByteBuffer [] views = new ByteBuffer[MAX_EVENTS];
+	
+	EventBatch(BlackadderWrapper wrapper, long batch_ptr) {
+		this.wrapper = wrapper;
+		this.batch_ptr = batch_ptr;
+	}
+	
+	/*called after the native code has filled the batch*/
+	void filled(int count) {
+		this.count = count;
+		if(descriptors != null && descriptors.order() != ByteOrder.nativeOrder()){
+			descriptors.order(ByteOrder.nativeOrder());
+		}
+	}
+	
+	public int size() {
+		return count;
+	}
+	
+	public byte getType(int i) {
+		return (byte) descriptors.getInt(entry(i) + TYPE);
+	}
+	
+	public int getIdLength(int i) {
+		return descriptors.getInt(entry(i) + ID_LENGTH);
+	}
+	
+	/*
+	 * copies the id of event i to dst (which must hold getIdLength(i) bytes)
+	 * returns the length of the id
+	 * */
+	public int copyId(int i, byte[] dst) {
+		int offset = descriptors.getInt(entry(i) + ID_OFFSET);
+		int length = descriptors.getInt(entry(i) + ID_LENGTH);
+		for(int b = 0; b < length; b++){
+			dst[b] = descriptors.get(offset + b);
+		}
+		return length;
+	}
+	
+	public byte[] getId(int i) {
+		byte [] id = new byte[getIdLength(i)];
+		copyId(i, id);
+		return id;
+	}
+	
+	public int getDataLength(int i) {
+		return descriptors.getInt(entry(i) + DATA_LENGTH);
+	}
+	
+	/*
+	 * the data of event i, between position and limit of a direct ByteBuffer that
+	 * is reused by later batches (null for events without data)
+	 * */
+	public ByteBuffer getData(int i) {
+		int e = entry(i);
+		int slot = descriptors.getInt(e + SLOT);
+		if(slot < 0){
+			return null;
+		}
+		int offset = descriptors.getInt(e + DATA_OFFSET);
+		ByteBuffer view = views[slot];
+		view.clear();
+		view.position(offset);
+		view.limit(offset + descriptors.getInt(e + DATA_LENGTH));
+		return view;
+	}
+	
+	public void close() {
+		if(batch_ptr != 0){
+			wrapper.deleteEventBatch(this);
+			batch_ptr = 0;
+			count = 0;
+			descriptors = null;
+			views = null;
+		}
+	}
+	
+	private int entry(int i) {
+		if(i < 0 || i >= count){
+			throw new IndexOutOfBoundsException("event " + i + " of a batch of " + count);
+		}
+		return i * ENTRY_SIZE;
+	}
+	
+	@Override
+	protected void finalize() throws Throwable {
+		close();
+		super.finalize();
+	}
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2011  Christos Tsilopoulos, Mobile Multimedia Laboratory, 
+ * Athens University of Economics and Business 
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+package eu.pursuit.client;
+
+import java.nio.ByteBuffer;
+import java.util.ArrayDeque;
+import java.util.ArrayList;
+
+/*
+ * our proposal a pool of direct ByteBuffers of bufferSize bytes each, allocated with malloc
+ * by the native code and reused, to publish with BlackadderWrapper.publishData(..., ByteBuffer, int, int)
+ * without creating garbage (ByteBuffer.allocateDirect zeroes the memory and is only freed by the GC)
+ * */
+public class NativeBufferPool {
+	private final BlackadderWrapper wrapper;
+	private final int bufferSize;
+	private final ArrayDeque<ByteBuffer> free = new ArrayDeque<ByteBuffer>();
+	private final ArrayList<ByteBuffer> all = new ArrayList<ByteBuffer>();
+	private boolean closed = false;
+	
+	NativeBufferPool(BlackadderWrapper wrapper, int bufferSize, int preallocate) {
+		this.wrapper = wrapper;
+		this.bufferSize = bufferSize;
+		for(int i = 0; i < preallocate; i++){
+			free.push(allocate());
+		}
+	}
+	
+	public int getBufferSize() {
+		return bufferSize;
+	}
+	
+	/*a cleared buffer, a new one only when all are in use*/
+	public synchronized ByteBuffer acquire() {
+		if(closed){
+			throw new IllegalStateException("the pool is closed");
+		}
+		ByteBuffer buffer = free.poll();
+		if(buffer == null){
+			buffer = allocate();
+		}
+		buffer.clear();
+		return buffer;
+	}
+	
+	public synchronized void release(ByteBuffer buffer) {
+		if(!closed){
+			free.push(buffer);
+		}
+	}
+	
+	/*frees the native memory of all buffers, none of them may be used afterwards*/
+	public synchronized void close() {
+		if(!closed){
+			closed = true;
+			for(ByteBuffer buffer : all){
+				wrapper.freeBuffer(buffer);
+			}
+			all.clear();
+			free.clear();
+		}
+	}
+	
+	private ByteBuffer allocate() {
+		ByteBuffer buffer = wrapper.allocateBuffer(bufferSize);
+		if(buffer == null){
+			throw new OutOfMemoryError("could not allocate a native buffer of " + bufferSize + " bytes");
+		}
+		all.add(buffer);
+		return buffer;
+	}
+	
+	@Override
+	protected void finalize() throws Throwable {
+		close();
+		super.finalize();
+	}
+}
@@ -16,7 +16,7 @@
 
 Blackadder* Blackadder::m_pInstance = NULL;
 
-Blackadder::Blackadder(bool user_space) {
+Blackadder::Blackadder(bool user_space) : in_user_space(user_space), shm_up(NULL), shm_down(NULL), shm_bytes(0), shm_reserved(false) {
     int ret;
 
     if (user_space) {
@@ -74,6 +74,10 @@ Blackadder::Blackadder(bool user_space) {
 }
 
 Blackadder::~Blackadder() {
+    release_shm_rings();
+    for (size_t i = 0; i < event_pool.size(); i++) {
+        free(event_pool[i]);
+    }
     if (sock_fd != -1) {
         close(sock_fd);
 #if !HAVE_USE_NETLINK
@@ -132,7 +136,7 @@ int Blackadder::create_and_send_buffers(unsigned char type, const string &id, co
         msg.msg_namelen = sizeof (d_nladdr);
         msg.msg_iov = iov;
         msg.msg_iovlen = 7;
-        ret = sendmsg(sock_fd, &msg, 0);
+        ret = send_message(&msg);
     } else {
         iov[7].iov_base = (void *) str_opt;
         iov[7].iov_len = str_opt_len;
@@ -141,7 +145,7 @@ int Blackadder::create_and_send_buffers(unsigned char type, const string &id, co
         msg.msg_namelen = sizeof (d_nladdr);
         msg.msg_iov = iov;
         msg.msg_iovlen = 8;
-        ret = sendmsg(sock_fd, &msg, 0);
+        ret = send_message(&msg);
     }
     free(iov);
     free(nlh);
@@ -174,12 +178,13 @@ void Blackadder::disconnect() {
     msg.msg_namelen = sizeof (d_nladdr);
     msg.msg_iov = iov;
     msg.msg_iovlen = 2;
-    ret = sendmsg(sock_fd, &msg, 0);
+    ret = send_message(&msg);
     if (ret < 0) {
         perror("Blackadder Library: Failed to send disconnection message");
     }
     free(nlh);
     delete [] iov;
+    release_shm_rings();
     close(sock_fd);
 #if !HAVE_USE_NETLINK
     unlink(s_nladdr.sun_path);
@@ -188,6 +193,150 @@ void Blackadder::disconnect() {
     sock_fd = -1;
 }
 
+struct ba_shm_ring *Blackadder::create_shm_ring(int dir, unsigned int ring_size) {
+    char name[64];
+    void *addr;
+    ba_shm_name(name, getpid(), dir);
+    shm_unlink(name); /*left by a previous process with the same pid*/
+    int shm_fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (shm_fd < 0) {
+        perror("Blackadder Library: shm_open");
+        return NULL;
+    }
+    if (ftruncate(shm_fd, shm_bytes) < 0) {
+        perror("Blackadder Library: ftruncate");
+        close(shm_fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    addr = mmap(NULL, shm_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    close(shm_fd);
+    if (addr == MAP_FAILED) {
+        perror("Blackadder Library: mmap");
+        shm_unlink(name);
+        return NULL;
+    }
+    /*Blackadder is asleep on the up ring until the first doorbell*/
+    ba_shm_ring_init((struct ba_shm_ring *) addr, ring_size, (dir == BA_SHM_UP) ? 1 : 0);
+    return (struct ba_shm_ring *) addr;
+}
+
+void Blackadder::release_shm_rings() {
+    char name[64];
+    if (shm_up != NULL) {
+        munmap(shm_up, shm_bytes);
+        ba_shm_name(name, getpid(), BA_SHM_UP);
+        shm_unlink(name);
+        shm_up = NULL;
+    }
+    if (shm_down != NULL) {
+        munmap(shm_down, shm_bytes);
+        ba_shm_name(name, getpid(), BA_SHM_DOWN);
+        shm_unlink(name);
+        shm_down = NULL;
+    }
+}
+
+bool Blackadder::use_shm_ring(unsigned int ring_size) {
+    int ret;
+    struct msghdr msg;
+    struct iovec iov[2];
+    struct nlmsghdr nlh;
+    struct pollfd pfd;
+    unsigned char connect[2] = {CONNECT, CONNECT_SHM_RING};
+    unsigned char reply[sizeof (struct nlmsghdr) + 1];
+    if (shm_up != NULL) {
+        return true;
+    }
+    if (!in_user_space || sock_fd == -1) {
+        cout << "Blackadder Library: shared-memory rings are only available when Blackadder runs in user space" << endl;
+        return false;
+    }
+    ring_size &= ~3U;
+    shm_bytes = ba_shm_ring_bytes(ring_size);
+    shm_up = create_shm_ring(BA_SHM_UP, ring_size);
+    shm_down = create_shm_ring(BA_SHM_DOWN, ring_size);
+    if (shm_up == NULL || shm_down == NULL) {
+        release_shm_rings();
+        return false;
+    }
+    memset(&nlh, 0, sizeof (nlh));
+    nlh.nlmsg_len = sizeof (struct nlmsghdr) + sizeof (connect);
+    nlh.nlmsg_pid = getpid();
+    nlh.nlmsg_flags = 1;
+    iov[0].iov_base = &nlh;
+    iov[0].iov_len = sizeof (struct nlmsghdr);
+    iov[1].iov_base = connect;
+    iov[1].iov_len = sizeof (connect);
+    memset(&msg, 0, sizeof (msg));
+    msg.msg_name = (void *) &d_nladdr;
+    msg.msg_namelen = sizeof (d_nladdr);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    ret = sendmsg(sock_fd, &msg, 0);
+    if (ret < 0) {
+        perror("Blackadder Library: Failed to send CONNECT");
+        release_shm_rings();
+        return false;
+    }
+    /*wait for the acknowledgement: a SHM_DOORBELL once Blackadder has mapped the rings*/
+    pfd.fd = sock_fd;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, 1000) <= 0 || recv(sock_fd, reply, sizeof (reply), 0) < (int) sizeof (reply) || reply[sizeof (struct nlmsghdr)] != SHM_DOORBELL) {
+        cout << "Blackadder Library: Blackadder did not map the shared-memory rings - using the socket" << endl;
+        release_shm_rings();
+        return false;
+    }
+    cout << "Blackadder Library: using shared-memory rings of " << ring_size << " bytes" << endl;
+    return true;
+}
+
+int Blackadder::send_message(struct msghdr *msg) {
+    int ret;
+    size_t len = 0;
+    for (size_t i = 0; i < (size_t) msg->msg_iovlen; i++) {
+        len += msg->msg_iov[i].iov_len;
+    }
+    /*a message that could never fit in the ring still goes through the socket, and so does one sent while a PublishBuffer holds the ring*/
+    if (shm_up == NULL || shm_reserved || len + 2 * sizeof (uint32_t) >= shm_up->size) {
+        return sendmsg(sock_fd, msg, 0);
+    }
+    /*the ring is full only while Blackadder is draining it, so just wait for some room*/
+    while ((ret = ba_shm_ring_write(shm_up, msg->msg_iov, msg->msg_iovlen)) == 0) {
+        usleep(10);
+    }
+    if (ring_doorbell() < 0) {
+        return -1;
+    }
+    return ret;
+}
+
+int Blackadder::ring_doorbell() {
+    if (ba_shm_ring_wakeup(shm_up)) {
+        struct msghdr doorbell;
+        struct iovec iov[2];
+        struct nlmsghdr nlh;
+        unsigned char type = SHM_DOORBELL;
+        memset(&nlh, 0, sizeof (nlh));
+        nlh.nlmsg_len = sizeof (struct nlmsghdr) + sizeof (type);
+        nlh.nlmsg_pid = getpid();
+        nlh.nlmsg_flags = 1;
+        iov[0].iov_base = &nlh;
+        iov[0].iov_len = sizeof (struct nlmsghdr);
+        iov[1].iov_base = &type;
+        iov[1].iov_len = sizeof (type);
+        memset(&doorbell, 0, sizeof (doorbell));
+        doorbell.msg_name = (void *) &d_nladdr;
+        doorbell.msg_namelen = sizeof (d_nladdr);
+        doorbell.msg_iov = iov;
+        doorbell.msg_iovlen = 2;
+        if (sendmsg(sock_fd, &doorbell, 0) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
 void Blackadder::publish_scope(const string&id, const string&prefix_id, unsigned char strategy, void *str_opt, unsigned int str_opt_len) {
     int ret;
     if (id.length() % PURSUIT_ID_LEN != 0) {
@@ -379,7 +528,7 @@ void Blackadder::publish_data(const string&id, unsigned char strategy, void *str
             msg.msg_namelen = sizeof (d_nladdr);
             msg.msg_iov = iov;
             msg.msg_iovlen = 6;
-            ret = sendmsg(sock_fd, &msg, 0);
+            ret = send_message(&msg);
         } else {
             iov[5].iov_base = (void *) str_opt;
             iov[5].iov_len = str_opt_len;
@@ -390,7 +539,7 @@ void Blackadder::publish_data(const string&id, unsigned char strategy, void *str
             msg.msg_namelen = sizeof (d_nladdr);
             msg.msg_iov = iov;
             msg.msg_iovlen = 7;
-            ret = sendmsg(sock_fd, &msg, 0);
+            ret = send_message(&msg);
         }
         if (ret < 0) {
             perror("Blackadder Library: Failed to publish data ");
@@ -400,19 +549,213 @@ void Blackadder::publish_data(const string&id, unsigned char strategy, void *str
     }
 }
 
+unsigned int publish_header_len(const string &id, unsigned int str_opt_len) {
+    return sizeof (struct nlmsghdr) + 1 /*type*/ + 1 /*for id length*/ + id.length() + 1 /*strategy*/ + str_opt_len;
+}
+
+void write_publish_header(char *header, const string &id, unsigned char strategy, void *str_opt, unsigned int str_opt_len, unsigned int data_len) {
+    struct nlmsghdr *nlh = (struct nlmsghdr *) header;
+    char *p = header + sizeof (struct nlmsghdr);
+    if (str_opt == NULL) {
+        str_opt_len = 0;
+    }
+    nlh->nlmsg_len = publish_header_len(id, str_opt_len) + data_len;
+    nlh->nlmsg_pid = getpid();
+    nlh->nlmsg_flags = 1;
+    nlh->nlmsg_type = 0;
+    *p++ = PUBLISH_DATA;
+    *p++ = (char) (id.length() / PURSUIT_ID_LEN);
+    memcpy(p, id.c_str(), id.length());
+    p += id.length();
+    *p++ = strategy;
+    if (str_opt_len > 0) {
+        memcpy(p, str_opt, str_opt_len);
+    }
+}
+
+bool Blackadder::alloc_publish_buffer(PublishBuffer &buf, const string &id, unsigned char strategy, void *str_opt, unsigned int str_opt_len, unsigned int capacity) {
+    if (id.length() % PURSUIT_ID_LEN != 0) {
+        cout << "Blackadder Library: Could not allocate a publish buffer - wrong ID size" << endl;
+        return false;
+    }
+    if (str_opt == NULL) {
+        str_opt_len = 0;
+    }
+    buf.header_len = publish_header_len(id, str_opt_len);
+    buf.capacity = capacity;
+    buf.in_ring = false;
+    buf.header = NULL;
+    if (shm_up != NULL && !shm_reserved && buf.header_len + capacity + 2 * sizeof (uint32_t) < shm_up->size) {
+        /*the ring is full only while Blackadder is draining it, so just wait for some room*/
+        while ((buf.header = ba_shm_ring_reserve(shm_up, buf.header_len + capacity)) == NULL) {
+            usleep(10);
+        }
+        buf.in_ring = true;
+        shm_reserved = true;
+    } else {
+        buf.header = (char *) malloc(buf.header_len + capacity);
+        if (buf.header == NULL) {
+            return false;
+        }
+    }
+    write_publish_header(buf.header, id, strategy, str_opt, str_opt_len, capacity);
+    buf.data = buf.header + buf.header_len;
+    return true;
+}
+
+void Blackadder::publish_buffer(PublishBuffer &buf, unsigned int data_len) {
+    int ret;
+    if (buf.header == NULL) {
+        return;
+    }
+    if (data_len > buf.capacity) {
+        data_len = buf.capacity;
+    }
+    ((struct nlmsghdr *) buf.header)->nlmsg_len = buf.header_len + data_len;
+    if (buf.in_ring) {
+        ba_shm_ring_commit(shm_up, buf.header, buf.header_len + data_len);
+        shm_reserved = false;
+        ret = ring_doorbell();
+    } else {
+        struct msghdr msg;
+        struct iovec iov;
+        iov.iov_base = buf.header;
+        iov.iov_len = buf.header_len + data_len;
+        memset(&msg, 0, sizeof (msg));
+        msg.msg_name = (void *) &d_nladdr;
+        msg.msg_namelen = sizeof (d_nladdr);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        ret = send_message(&msg);
+        free(buf.header);
+    }
+    if (ret < 0) {
+        perror("Blackadder Library: Failed to publish data ");
+    }
+    buf.header = NULL;
+    buf.data = NULL;
+}
+
+void Blackadder::release_publish_buffer(PublishBuffer &buf) {
+    if (buf.in_ring) {
+        /*nothing was committed, the reservation is simply forgotten*/
+        shm_reserved = false;
+    } else {
+        free(buf.header);
+    }
+    buf.header = NULL;
+    buf.data = NULL;
+}
+
+/*the buffers of one PUBLISH_DATA message of a batch*/
+struct PublishDataMessage {
+    struct nlmsghdr nlh;
+    unsigned char type;
+    unsigned char id_len;
+    struct iovec iov[7];
+};
+
+unsigned int Blackadder::publish_data_batch(const vector<PublishDataItem> &items, unsigned char strategy, void *str_opt, unsigned int str_opt_len) {
+    vector<PublishDataMessage> messages(items.size());
+    vector<struct msghdr> msgs(items.size());
+    unsigned int count = 0, sent = 0;
+    for (size_t i = 0; i < items.size(); i++) {
+        const PublishDataItem &item = items[i];
+        if (item.id.length() % PURSUIT_ID_LEN != 0) {
+            cout << "Blackadder Library: Could not send  - wrong ID size" << endl;
+            continue;
+        }
+        PublishDataMessage &m = messages[count];
+        struct msghdr &msg = msgs[count];
+        int iovlen = 0;
+        m.type = PUBLISH_DATA;
+        m.id_len = item.id.length() / PURSUIT_ID_LEN;
+        memset(&m.nlh, 0, sizeof (m.nlh));
+        m.nlh.nlmsg_len = sizeof (struct nlmsghdr) + 1 /*type*/ + 1 /*for id length*/ + item.id.length() + sizeof (strategy) + ((str_opt == NULL) ? 0 : str_opt_len) + item.data_len;
+        m.nlh.nlmsg_pid = getpid();
+        m.nlh.nlmsg_flags = 1;
+        m.iov[iovlen].iov_base = &m.nlh;
+        m.iov[iovlen++].iov_len = sizeof (struct nlmsghdr);
+        m.iov[iovlen].iov_base = &m.type;
+        m.iov[iovlen++].iov_len = sizeof (m.type);
+        m.iov[iovlen].iov_base = &m.id_len;
+        m.iov[iovlen++].iov_len = sizeof (m.id_len);
+        m.iov[iovlen].iov_base = (void *) item.id.c_str();
+        m.iov[iovlen++].iov_len = item.id.length();
+        m.iov[iovlen].iov_base = (void *) &strategy;
+        m.iov[iovlen++].iov_len = sizeof (strategy);
+        if (str_opt != NULL) {
+            m.iov[iovlen].iov_base = str_opt;
+            m.iov[iovlen++].iov_len = str_opt_len;
+        }
+        m.iov[iovlen].iov_base = item.data;
+        m.iov[iovlen++].iov_len = item.data_len;
+        memset(&msg, 0, sizeof (msg));
+        msg.msg_name = (void *) &d_nladdr;
+        msg.msg_namelen = sizeof (d_nladdr);
+        msg.msg_iov = m.iov;
+        msg.msg_iovlen = iovlen;
+        count++;
+    }
+#if HAVE_USE_NETLINK
+    if (shm_up == NULL) {
+        vector<struct mmsghdr> mmsgs(count);
+        for (unsigned int i = 0; i < count; i++) {
+            mmsgs[i].msg_hdr = msgs[i];
+            mmsgs[i].msg_len = 0;
+        }
+        while (sent < count) {
+            int ret = sendmmsg(sock_fd, &mmsgs[sent], min(count - sent, (unsigned int) PUBLISH_BATCH_MAX), 0);
+            if (ret < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                perror("Blackadder Library: Failed to publish data ");
+                break;
+            }
+            sent += ret;
+        }
+        return sent;
+    }
+#endif
+    /*the up ring (or a system without sendmmsg): one message at a time*/
+    for (unsigned int i = 0; i < count; i++) {
+        if (send_message(&msgs[i]) < 0) {
+            perror("Blackadder Library: Failed to publish data ");
+            break;
+        }
+        sent++;
+    }
+    return sent;
+}
+
 /*the event object should be already allocated*/
 void Blackadder::getEvent(Event &ev) {
     int total_buf_size = 0;
     int bytes_read;
-    unsigned char id_len;
     struct msghdr msg;
     struct iovec iov;
     memset(&msg, 0, sizeof (msg));
     msg.msg_iov = &iov;
     msg.msg_iovlen = 1;
+again:
     iov.iov_base = fake_buf;
     iov.iov_len = 1;
-again:
+    if (shm_down != NULL) {
+        /*our proposal events come through the down ring, the socket carries the doorbell (and the rare event too large for the ring)*/
+        uint32_t record_len;
+        const char *record = ba_shm_ring_peek(shm_down, &record_len);
+        if (record != NULL) {
+            ev.buffer = malloc(record_len);
+            memcpy(ev.buffer, record, record_len);
+            ba_shm_ring_pop(shm_down);
+            parse_event(ev, record_len);
+            return;
+        }
+        if (!ba_shm_ring_sleep(shm_down)) {
+            goto again;
+        }
+    }
 #if HAVE_USE_NETLINK
     total_buf_size = recvmsg(sock_fd, &msg, MSG_PEEK | MSG_TRUNC);
 #else
@@ -430,26 +773,12 @@ again:
             free(iov.iov_base);
             goto again;
         }
-        ev.buffer = iov.iov_base;
-        ev.type = *((char *) ev.buffer + sizeof (struct nlmsghdr));
-        id_len = *((char *) ev.buffer + sizeof (struct nlmsghdr) + sizeof (unsigned char));
-        ev.id = string((char *) ev.buffer + sizeof (struct nlmsghdr) + sizeof (unsigned char) + sizeof (unsigned char), ((int) id_len) * PURSUIT_ID_LEN);
-        if (ev.type == PUBLISHED_DATA) {
-            ev.data = (char *) ev.buffer + sizeof (struct nlmsghdr) + sizeof (unsigned char) + sizeof (unsigned char) + ((int) id_len) * PURSUIT_ID_LEN;
-            ev.data_len = bytes_read - (sizeof (struct nlmsghdr) + sizeof (unsigned char) + sizeof (unsigned char) + ((int) id_len) * PURSUIT_ID_LEN); /* XXX */
-        }
-        else if(ev.type == PLEASE_PUSH_DATA)
-        {
-            memcpy(ev.to_sub_FID._data, (char *) ev.buffer+sizeof(struct nlmsghdr)+sizeof(unsigned char)+sizeof(unsigned char)+\
-                                            ((int) id_len) * PURSUIT_ID_LEN, FID_LEN) ;
-            ev.fid_len = FID_LEN ;
-            ev.data = NULL ;
-            ev.data_len = 0 ;
-        }
-        else{
-            ev.data = NULL;
-            ev.data_len = 0;
+        if (bytes_read > (int) sizeof (struct nlmsghdr) && *((char *) iov.iov_base + sizeof (struct nlmsghdr)) == SHM_DOORBELL) {
+            free(iov.iov_base);
+            goto again;
         }
+        ev.buffer = iov.iov_base;
+        parse_event(ev, bytes_read);
     } else if (errno == EINTR) {
         /* Interrupted system call. */
         ev.type = 0;
@@ -459,8 +788,152 @@ again:
     }
 }
 
+void Blackadder::release_events(Event *events, int max_events) {
+    for (int i = 0; i < max_events; i++) {
+        if (events[i].buffer != NULL && !events[i].pooled) {
+            free(events[i].buffer);
+        }
+        events[i].buffer = NULL;
+        events[i].data = NULL;
+        events[i].pooled = false;
+    }
+}
+
+int Blackadder::getEvents(Event *events, int max_events) {
+    return receive_events(events, max_events, true);
+}
+
+int Blackadder::tryGetEvents(Event *events, int max_events) {
+    return receive_events(events, max_events, false);
+}
+
+int Blackadder::getFd() {
+    return sock_fd;
+}
+
+int Blackadder::receive_events(Event *events, int max_events, bool block) {
+    int count = 0;
+    if (max_events > EVENT_BATCH_MAX) {
+        max_events = EVENT_BATCH_MAX;
+    }
+    if (max_events <= 0) {
+        return 0;
+    }
+    release_events(events, max_events);
+    if (event_pool.empty()) {
+        for (int i = 0; i < EVENT_BATCH_MAX; i++) {
+            event_pool.push_back((char *) malloc(EVENT_BUFFER_SIZE));
+        }
+    }
+    while (count == 0) {
+        if (shm_down != NULL) {
+            uint32_t record_len;
+            const char *record;
+            while (count < max_events && (record = ba_shm_ring_peek(shm_down, &record_len)) != NULL) {
+                if (record_len <= EVENT_BUFFER_SIZE) {
+                    memcpy(event_pool[count], record, record_len);
+                    events[count].buffer = event_pool[count];
+                    events[count].pooled = true;
+                    parse_event(events[count], record_len);
+                    count++;
+                } else {
+                    cout << "Blackadder Library: dropped an event of " << record_len << " bytes (EVENT_BUFFER_SIZE)" << endl;
+                }
+                ba_shm_ring_pop(shm_down);
+            }
+            /*without waiting the ring is armed all the same, so that the next record rings the doorbell and the socket becomes readable*/
+            if (count > 0 || !ba_shm_ring_sleep(shm_down)) {
+                continue;
+            }
+        }
+        /*block for the first message (unless block is false), take whatever else is already queued*/
+        int received = 0;
+        int lengths[EVENT_BATCH_MAX];
+        int truncated[EVENT_BATCH_MAX];
+#if HAVE_USE_NETLINK
+        struct mmsghdr mmsgs[EVENT_BATCH_MAX];
+        struct iovec iovs[EVENT_BATCH_MAX];
+        memset(mmsgs, 0, sizeof (mmsgs));
+        for (int i = 0; i < max_events; i++) {
+            iovs[i].iov_base = event_pool[i];
+            iovs[i].iov_len = EVENT_BUFFER_SIZE;
+            mmsgs[i].msg_hdr.msg_iov = &iovs[i];
+            mmsgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        received = recvmmsg(sock_fd, mmsgs, max_events, block ? MSG_WAITFORONE : MSG_DONTWAIT, NULL);
+        for (int i = 0; i < received; i++) {
+            lengths[i] = mmsgs[i].msg_len;
+            truncated[i] = mmsgs[i].msg_hdr.msg_flags & MSG_TRUNC;
+        }
+#else
+        while (received < max_events) {
+            lengths[received] = recv(sock_fd, event_pool[received], EVENT_BUFFER_SIZE, (received == 0 && block) ? 0 : MSG_DONTWAIT);
+            if (lengths[received] < 0) {
+                if (received == 0) {
+                    received = -1;
+                }
+                break;
+            }
+            truncated[received] = 0;
+            received++;
+        }
+#endif
+        if (received < 0) {
+            if (errno == EINTR || (!block && (errno == EAGAIN || errno == EWOULDBLOCK))) {
+                return 0;
+            }
+            perror("Blackadder Library: recvmmsg");
+            if (!block) {
+                return -1;
+            }
+            continue;
+        }
+        for (int i = 0; i < received; i++) {
+            if (lengths[i] <= (int) sizeof (struct nlmsghdr) || *(event_pool[i] + sizeof (struct nlmsghdr)) == SHM_DOORBELL) {
+                continue;
+            }
+            if (truncated[i]) {
+                cout << "Blackadder Library: dropped an event longer than EVENT_BUFFER_SIZE" << endl;
+                continue;
+            }
+            /*keep the buffers of the events at the front of the pool*/
+            if (i != count) {
+                swap(event_pool[i], event_pool[count]);
+            }
+            events[count].buffer = event_pool[count];
+            events[count].pooled = true;
+            parse_event(events[count], lengths[i]);
+            count++;
+        }
+    }
+    return count;
+}
+
+void Blackadder::parse_event(Event &ev, int bytes_read) {
+    unsigned char id_len;
+    ev.type = *((char *) ev.buffer + sizeof (struct nlmsghdr));
+    id_len = *((char *) ev.buffer + sizeof (struct nlmsghdr) + sizeof (unsigned char));
+    ev.id = string((char *) ev.buffer + sizeof (struct nlmsghdr) + sizeof (unsigned char) + sizeof (unsigned char), ((int) id_len) * PURSUIT_ID_LEN);
+    if (ev.type == PUBLISHED_DATA) {
+        ev.data = (char *) ev.buffer + sizeof (struct nlmsghdr) + sizeof (unsigned char) + sizeof (unsigned char) + ((int) id_len) * PURSUIT_ID_LEN;
+        ev.data_len = bytes_read - (sizeof (struct nlmsghdr) + sizeof (unsigned char) + sizeof (unsigned char) + ((int) id_len) * PURSUIT_ID_LEN); /* XXX */
+    }
+    else if(ev.type == PLEASE_PUSH_DATA)
+    {
+        memcpy(ev.to_sub_FID._data, (char *) ev.buffer+sizeof(struct nlmsghdr)+sizeof(unsigned char)+sizeof(unsigned char)+\
+                                        ((int) id_len) * PURSUIT_ID_LEN, FID_LEN) ;
+        ev.fid_len = FID_LEN ;
+        ev.data = NULL ;
+        ev.data_len = 0 ;
+    }
+    else{
+        ev.data = NULL;
+        ev.data_len = 0;
+    }
+}
+
 Event::Event()
-    : type(0), id(), data(NULL), data_len(0), buffer(NULL), fid_len(0)
+    : type(0), id(), data(NULL), data_len(0), buffer(NULL), fid_len(0), pooled(false), release(NULL)
 {
     Bitvector tempfid(FID_LEN*8) ;
     to_sub_FID=tempfid ;
@@ -471,6 +944,8 @@ Event::Event(Event &ev) {
     id = ev.id;
     data_len = ev.data_len;
     fid_len = ev.fid_len ;
+    pooled = false;
+    release = NULL;
     buffer = malloc(sizeof (struct nlmsghdr) + sizeof (type) + sizeof (unsigned char) + id.length() + fid_len+ data_len);
     to_sub_FID = ev.to_sub_FID ;
     memcpy(buffer, ev.buffer, sizeof (struct nlmsghdr) + sizeof (type) +\
@@ -480,8 +955,12 @@ Event::Event(Event &ev) {
 }
 
 Event::~Event() {
-    if (buffer != NULL) {
-        free(buffer);
+    if (buffer != NULL && !pooled) {
+        if (release != NULL) {
+            release(buffer);
+        } else {
+            free(buffer);
+        }
     }
 }
 
@@ -30,12 +30,17 @@
 #include <sys/ioctl.h>
 #endif
 #include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
 #include <vector>
 #include <sstream>
 #include <iostream>
 
 #include "blackadder_defs.h"
 #include "bitvector.hpp"
+#include "ba_shmring.h"
 
 using namespace std;
 
@@ -56,6 +61,52 @@ string chararray_to_hex(const string &str);
 
 class Event;
 
+/**@brief (User Library) Our proposal one publication of a publish_data_batch call.
+ */
+struct PublishDataItem {
+    PublishDataItem() : id(), data(NULL), data_len(0) {}
+    PublishDataItem(const string &_id, void *_data, unsigned int _data_len) : id(_id), data(_data), data_len(_data_len) {}
+    /**@brief the full identifier of the information item.*/
+    string id;
+    void *data;
+    unsigned int data_len;
+};
+
+/**@brief (User Library) Our proposal a publication that the application writes in place (see Blackadder::alloc_publish_buffer and NB_Blackadder::alloc_publish_buffer).
+ *
+ * data points to capacity bytes for the payload. The PUBLISH_DATA request header is already written right in front of it (the headroom),
+ * so that header and payload are sent as they are, without being copied into another buffer.
+ */
+struct PublishBuffer {
+    PublishBuffer() : data(NULL), capacity(0), header(NULL), header_len(0), in_ring(false) {}
+    /**@brief where the application writes the payload.*/
+    void *data;
+    /**@brief the most bytes that may be written to data.*/
+    unsigned int capacity;
+    /*the rest is only used by the library*/
+    char *header;
+    unsigned int header_len;
+    bool in_ring;
+};
+
+/**@brief Our proposal the size of the PUBLISH_DATA request header (the headroom of a PublishBuffer).
+ */
+unsigned int publish_header_len(const string &id, unsigned int str_opt_len);
+
+/**@brief Our proposal writes the PUBLISH_DATA request header for a payload of data_len bytes to header (publish_header_len bytes).
+ */
+void write_publish_header(char *header, const string &id, unsigned char strategy, void *str_opt, unsigned int str_opt_len, unsigned int data_len);
+
+/**@brief Our proposal the number of messages handed to the kernel by one sendmmsg call of publish_data_batch.
+ */
+#define PUBLISH_BATCH_MAX 64
+/**@brief Our proposal the most events returned by one getEvents call (and the number of buffers in the receive pool).
+ */
+#define EVENT_BATCH_MAX 32
+/**@brief Our proposal the size of each buffer of the receive pool - a longer message is dropped by getEvents.
+ */
+#define EVENT_BUFFER_SIZE 65536
+
 /**@brief (User Library) This is the wrapper class that makes the service model available to all applications.
  *
  * blackadder expects requests to be sent in its netlink socket. Therefore the wrapper class just exports some human-friendly methods for creating service model compliant buffers that are sent to blackadder.
@@ -209,17 +260,92 @@ public:
      * @param data_len the size of the published data.
      */
     void publish_data(const string&id, unsigned char strategy, void *str_opt, unsigned int str_opt_len, void *data, unsigned int data_len);
+    /**@brief Our proposal sends many PUBLISH_DATA requests with the same strategy at once.
+     *
+     * The requests are the same as those of publish_data, but they are handed to the kernel with sendmmsg (PUBLISH_BATCH_MAX per system call) or written to the up ring
+     * (see use_shm_ring) with at most one doorbell, so that streaming applications do not pay a system call per publication.
+     * Items with a wrong ID size are skipped.
+     *
+     * @param items the identifiers and data to publish.
+     * @param strategy the dissemination strategy assigned to all requests.
+     * @param str_opt a bucket of bytes that are strategy specific (the same for all requests).
+     * @param str_opt_len the size of the provided bucket of bytes.
+     * @return the number of items that were sent.
+     */
+    unsigned int publish_data_batch(const vector<PublishDataItem> &items, unsigned char strategy, void *str_opt, unsigned int str_opt_len);
+    /**@brief Our proposal prepares a publication that the application writes in place (zero-copy publish_data).
+     *
+     * The request header is written first and buf.data points right after it. With use_shm_ring the whole request is reserved in the up ring,
+     * so the payload is written where Blackadder reads it; otherwise the request is built in one malloc'd buffer that is sent with a single iovec.
+     * Only one ring reservation can be open at a time: a second buffer allocated before the first is published falls back to malloc,
+     * and requests sent while the reservation is open go through the socket (so they may overtake the reserved publication).
+     * Every buffer must be passed to publish_buffer or release_publish_buffer.
+     *
+     * @param buf is updated accordingly.
+     * @param id the full identifier of the information item for which data is published.
+     * @param strategy the dissemination strategy assigned to the request.
+     * @param str_opt a bucket of bytes that are strategy specific. When the IMPLICIT_RENDEZVOUS strategy is used this bucket contains a LIPSIN identifier.
+     * @param str_opt_len the size of the provided bucket of bytes.
+     * @param capacity the most bytes the application will publish.
+     * @return false if the ID size is wrong or no memory could be allocated.
+     */
+    bool alloc_publish_buffer(PublishBuffer &buf, const string &id, unsigned char strategy, void *str_opt, unsigned int str_opt_len, unsigned int capacity);
+    /**@brief Our proposal sends the PUBLISH_DATA request of a buffer from alloc_publish_buffer and releases the buffer.
+     *
+     * @param buf the buffer (it must not be used afterwards).
+     * @param data_len the number of bytes written to buf.data (at most buf.capacity).
+     */
+    void publish_buffer(PublishBuffer &buf, unsigned int data_len);
+    /**@brief Our proposal releases a buffer from alloc_publish_buffer without publishing it.
+     */
+    void release_publish_buffer(PublishBuffer &buf);
     /**@brief This method blocks until an event is received from blackadder.
      *
      * @param ev a reference to an Event which will be updated accordingly. An application can read the Event (and the data when the event is PUBLISHED_DATA) when the method unblocks.
      */
     void getEvent(Event &ev);
+    /**@brief Our proposal blocks until at least one event is received and returns all events that are already waiting (up to max_events).
+     *
+     * On Linux the socket is drained with a single recvmmsg into a pool of EVENT_BATCH_MAX buffers owned by the Blackadder object; with use_shm_ring the records
+     * are copied from the down ring into the same pool. No memory is allocated per event: the returned Events are views into the pool and stay valid until the
+     * next getEvents call (use the Event copy constructor to keep one longer). The Events must not be passed to getEvent.
+     *
+     * @param events an array of at least max_events Events, which are updated accordingly.
+     * @param max_events the size of the array (at most EVENT_BATCH_MAX are used).
+     * @return the number of events, or 0 if the call was interrupted.
+     */
+    int getEvents(Event *events, int max_events);
+    /**@brief Our proposal getEvents without waiting: returns the events that are already waiting (up to max_events), 0 if there are none.
+     *
+     * It lets applications drive Blackadder from their own poll/epoll loop (see getFd). When it returns 0 the descriptor becomes readable
+     * as soon as another event arrives (with use_shm_ring the down ring is armed so that Blackadder rings the doorbell), so with
+     * edge-triggered epoll it must be called until it returns 0. The Events are views into the same pool as those of getEvents.
+     *
+     * @param events an array of at least max_events Events, which are updated accordingly.
+     * @param max_events the size of the array (at most EVENT_BATCH_MAX are used).
+     * @return the number of events, 0 if none is waiting, -1 on a socket error.
+     */
+    int tryGetEvents(Event *events, int max_events);
+    /**@brief Our proposal the socket on which events arrive, to be watched for POLLIN by an event loop that then calls tryGetEvents.
+     *
+     * Applications must only poll it: reading from it or changing its flags breaks the library.
+     */
+    int getFd();
     /**@brief This method will send a disconnect signal to Blackadder.
      *
      * In user space this is required so that Blackadder can then undo all requests the application has previously sent.
      * In kernel this is not required since Blackadder can monitor applications.
      */
     void disconnect();
+    /**@brief Our proposal moves the requests and events of this application to a pair of shared-memory rings (user space only).
+     *
+     * The application creates the rings and announces them with a CONNECT (flag CONNECT_SHM_RING); Blackadder maps them and acknowledges with a SHM_DOORBELL.
+     * From then on requests and events are copied through the rings and the socket only carries a doorbell when the other side sleeps.
+     * It should be called right after Instance, before any request is sent.
+     * @param ring_size the size of the data area of each ring in bytes.
+     * @return false if the rings could not be created or Blackadder did not acknowledge them - the socket is then used as before.
+     */
+    bool use_shm_ring(unsigned int ring_size = BA_SHM_RING_SIZE);
 private:
     /**@brief Constructor: It creates the netlink socket, binds it and construct the appropriate sockaddr_nl structures for sending requests to Blackadder.
      *
@@ -236,9 +362,44 @@ private:
      * @param str_opt_len as passed by a request method.
      */
     int create_and_send_buffers(unsigned char type, const string &id, const string &prefix_id, char strategy, void *str_opt, unsigned int str_opt_len);
+    /**@brief Our proposal sends a message to Blackadder: through the up ring if use_shm_ring succeeded, through the socket otherwise.
+     *
+     * @return the number of bytes sent or -1 (as sendmsg).
+     */
+    int send_message(struct msghdr *msg);
+    /**@brief Our proposal sends a SHM_DOORBELL if Blackadder sleeps on the up ring.
+     *
+     * @return -1 if the doorbell could not be sent.
+     */
+    int ring_doorbell();
+    /**@brief fills the Event from a message received from Blackadder (ev.buffer must already hold it).
+     */
+    void parse_event(Event &ev, int bytes_read);
+    /**@brief Our proposal getEvents (block) and tryGetEvents (!block).
+     */
+    int receive_events(Event *events, int max_events, bool block);
+    /**@brief Our proposal makes the Events passed to getEvents forget their buffers (pool buffers are kept, others are freed).
+     */
+    void release_events(Event *events, int max_events);
+    /**@brief Our proposal creates, sizes and maps one ring (see ba_shm_name).
+     */
+    struct ba_shm_ring *create_shm_ring(int dir, unsigned int ring_size);
+    /**@brief Our proposal unmaps both rings and removes their names if Blackadder did not.
+     */
+    void release_shm_rings();
     /** @brief The netlink socket file descriptor.
      */
     int sock_fd;
+    /**@brief whether Blackadder runs in user space (the rings are not available in kernel space).
+     */
+    bool in_user_space;
+    /**@brief Our proposal the rings of use_shm_ring (NULL when the socket is used).
+     */
+    struct ba_shm_ring *shm_up, *shm_down;
+    size_t shm_bytes;
+    /**@brief Our proposal true while a PublishBuffer holds a reservation in the up ring.
+     */
+    bool shm_reserved;
     /**@brief the netlink socket source and destination sockaddr_nl structures. They stay the same as long as the application runs.
      */
 #if HAVE_USE_NETLINK
@@ -249,6 +410,9 @@ private:
     /**@brief a dummy buffer for peeking the actual expected buffer so that we can learn its size.
      */
     char fake_buf[1];
+    /**@brief Our proposal the receive pool of getEvents (allocated on the first call).
+     */
+    vector<char *> event_pool;
     /**@brief the single static Blackadder object an application can access.
      */
     static Blackadder* m_pInstance;
@@ -314,6 +478,12 @@ public:
     /**@brief a buffer containing all the above, the buffer is used to receive the message from blackadder.
      */
     void *buffer; /*do not use that...only the destructor uses it to delete the whole buffer once*/
+    /**@brief Our proposal true when buffer belongs to the receive pool of getEvents (it is then not freed).
+     */
+    bool pooled;
+    /**@brief Our proposal when set, the destructor hands buffer back through it instead of freeing it (NB_Blackadder uses it for its buffer pool).
+     */
+    void (*release)(void *buffer);
 };
 
 #ifndef __LINUX_NETLINK_H
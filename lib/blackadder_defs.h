@@ -17,7 +17,9 @@
 
 /**********************************/
 #define PURSUIT_ID_LEN 8 //in bytes
-#define FID_LEN 8 //in bytes
+#ifndef FID_LEN
+#define FID_LEN 8 //in bytes - our proposal build with -DFID_LEN=N for the LIPSIN_ID_LENGTH of the deployment
+#endif
 #define NODEID_LEN PURSUIT_ID_LEN //in bytes
 /****some strategies*****/
 #define NODE_LOCAL          0
@@ -36,8 +38,9 @@
 #define UNSUBSCRIBE_SCOPE 6
 #define UNSUBSCRIBE_INFO 7
 #define PUBLISH_DATA  8 //the request
-#define CONNECT 12
+#define CONNECT 12 //our proposal followed by a flags byte (CONNECT_SHM_RING)
 #define DISCONNECT 13
+#define SHM_DOORBELL 14 //our proposal the producer of a shared-memory ring wrote to it
 /*****************************/
 #define START_PUBLISH 100
 #define STOP_PUBLISH 101
@@ -50,7 +53,18 @@
 #define INFO_PUBLISHED 108
 #define SCOPE_MATCH_PUB_SUB 109
 #define SCOPE_PROBING 110
+#define BATCHED_REQUESTS 111
+//our proposal topology updates published to the TM control identifier (FFFFFFFFFFFFFFFC)
+#define TOPOLOGY_LINK_ADD 112 //source, destination, LID (FID_LEN bytes)
+#define TOPOLOGY_LINK_REMOVE 113 //source, destination
+#define TOPOLOGY_NODE_ADD 114 //node, iLID (FID_LEN bytes)
+#define TOPOLOGY_NODE_REMOVE 115 //node
+//our proposal a Forwarder reports to the TM request identifier (FFFFFFFFFFFFFFFE/NODEID) the bytes it sent over its links since its last report:
+//node, interval in ms (4 bytes), number of links (2 bytes) and (LID (FID_LEN bytes), bytes (8 bytes))*
+#define TOPOLOGY_LINK_LOAD 116
 #define NETLINK_BADDER 20
+/*our proposal CONNECT flags*/
+#define CONNECT_SHM_RING 1 //the application created the /blackadder.<pid>.up and .down rings
 
 /*****************************/
 #define SCOPE_PROBING_MESSAGE 1
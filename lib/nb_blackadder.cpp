@@ -16,30 +16,32 @@
 
 NB_Blackadder* NB_Blackadder::m_pInstance = NULL;
 
-fd_set NB_Blackadder::read_set;
-fd_set NB_Blackadder::write_set;
-int NB_Blackadder::pipe_fds[2];
 int NB_Blackadder::sock_fd;
 
-queue <struct msghdr> NB_Blackadder::output_queue;
+BoundedQueue<struct msghdr> *NB_Blackadder::output_queue;
+BoundedQueue<char *> *NB_Blackadder::buffer_pool;
 pthread_t NB_Blackadder::selector_thread;
-pthread_mutex_t NB_Blackadder::selector_mutex;
-pthread_cond_t NB_Blackadder::queue_overflow_cond;
-
-queue <Event *> NB_Blackadder::event_queue;
-pthread_t NB_Blackadder::worker_thread;
-pthread_mutex_t NB_Blackadder::worker_mutex;
-pthread_cond_t NB_Blackadder::worker_cond;
+NB_Blackadder::NBWorker *NB_Blackadder::workers;
+int NB_Blackadder::number_of_workers;
+int NB_Blackadder::wakeup_fds[2];
+int NB_Blackadder::wakeup_pending = 0;
+#if HAVE_USE_NETLINK
+int NB_Blackadder::epoll_fd;
+#endif
 
-char NB_Blackadder::pipe_buf[1];
 char NB_Blackadder::fake_buf[1];
 
 #if !HAVE_USE_NETLINK
 struct sockaddr_un NB_Blackadder::s_nladdr, NB_Blackadder::d_nladdr;
 #endif
 
+/*Our proposal the message the selector thread could not send because the socket was full (only the selector thread touches it)*/
+static struct msghdr pending_msg;
+static bool pending_valid = false;
 
 callbacktype NB_Blackadder::cf = NULL;
+writabletype NB_Blackadder::wf = NULL;
+int NB_Blackadder::writable_wanted = 0;
 
 /**@relates NB_Blackadder
  * @brief This is the default Callback that will be whenever an event is received if the application hasn't registered its own callback.
@@ -54,128 +56,273 @@ void defaultCallback(Event *ev) {
 void NB_Blackadder::signal_handler(int sig) {
     (void) signal(SIGINT, SIG_DFL);
     pthread_cancel(selector_thread);
-    pthread_cancel(worker_thread);
+    for (int i = 0; i < number_of_workers; i++) {
+        pthread_cancel(workers[i].thread);
+    }
 }
 
 void *NB_Blackadder::worker(void *arg) {
+    NBWorker *w = (arg != NULL) ? (NBWorker *) arg : &workers[0];
     Event *ev;
     while (true) {
-        pthread_mutex_lock(&worker_mutex);
-        pthread_cond_wait(&worker_cond, &worker_mutex);
-        while (event_queue.size() > 0) {
-            ev = event_queue.front();
-            event_queue.pop();
-            pthread_mutex_unlock(&worker_mutex);
+        while (w->queue->pop(ev)) {
             cf(ev);
-            pthread_mutex_lock(&worker_mutex);
         }
-        pthread_mutex_unlock(&worker_mutex);
+        /*announce the sleep before checking the queue one last time, dispatch() does the opposite*/
+        pthread_mutex_lock(&w->mutex);
+        __atomic_store_n(&w->sleeping, 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        while (w->queue->empty()) {
+            pthread_cond_wait(&w->cond, &w->mutex);
+        }
+        __atomic_store_n(&w->sleeping, 0, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&w->mutex);
     }
 
     return NULL; /* Not reached unless the while-loop is terminated. */
 }
 
-void *NB_Blackadder::selector(void *arg) {
+void NB_Blackadder::dispatch(Event *ev) {
+    NBWorker *w = &workers[0];
+    if (number_of_workers > 1) {
+        /*FNV-1a over the identifier: the same identifier always goes to the same worker*/
+        uint32_t hash = 2166136261U;
+        for (string::size_type i = 0; i < ev->id.length(); i++) {
+            hash = (hash ^ (unsigned char) ev->id[i]) * 16777619U;
+        }
+        w = &workers[hash % number_of_workers];
+    }
+    while (!w->queue->push(ev)) {
+        /*the worker is behind: wait for it instead of growing without limit*/
+        usleep(100);
+    }
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&w->sleeping, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&w->mutex);
+        pthread_cond_signal(&w->cond);
+        pthread_mutex_unlock(&w->mutex);
+    }
+}
+
+void NB_Blackadder::release_buffer(void *buffer) {
+    if (!buffer_pool->push((char *) buffer)) {
+        free(buffer);
+    }
+}
+
+void NB_Blackadder::free_message(struct msghdr &msg) {
+    if (msg.msg_iovlen == 2) {
+        free(msg.msg_iov[0].iov_base);
+        free(msg.msg_iov[1].iov_base);
+    } else {
+        free(msg.msg_iov->iov_base);
+    }
+    free(msg.msg_iov);
+}
+
+void NB_Blackadder::enqueue(struct msghdr &msg) {
+    while (!output_queue->push(msg)) {
+        /*the output queue is full: wait for the selector thread to make room*/
+        usleep(100);
+    }
+    wake_selector();
+}
+
+bool NB_Blackadder::try_enqueue(struct msghdr &msg) {
+    if (!output_queue->push(msg)) {
+        /*ask for the writable callback, then look again: the selector thread may have made room (and checked writable_wanted) meanwhile*/
+        __atomic_store_n(&writable_wanted, 1, __ATOMIC_SEQ_CST);
+        if (!output_queue->push(msg)) {
+            return false;
+        }
+    }
+    wake_selector();
+    return true;
+}
+
+void NB_Blackadder::wake_selector() {
+    uint64_t one = 1;
+    if (__atomic_exchange_n(&wakeup_pending, 1, __ATOMIC_SEQ_CST) == 0) {
+        if (write(wakeup_fds[1], &one, sizeof (one)) < 0) {
+            perror("NB_Blackadder Library: could not wake the selector thread up");
+        }
+    }
+}
+
+unsigned int NB_Blackadder::credits() {
+    return output_queue->max_size() - output_queue->size();
+}
+
+void NB_Blackadder::setWritableCallback(writabletype function) {
+    wf = function;
+}
+
+void NB_Blackadder::notify_writable() {
+    if (__atomic_load_n(&writable_wanted, __ATOMIC_SEQ_CST) && output_queue->size() <= output_queue->max_size() - NB_WRITABLE_CREDITS) {
+        __atomic_store_n(&writable_wanted, 0, __ATOMIC_SEQ_CST);
+        if (wf != NULL) {
+            wf(credits());
+        }
+    }
+}
+
+bool NB_Blackadder::flush_output() {
+    while (true) {
+        if (!pending_valid) {
+            if (!output_queue->pop(pending_msg)) {
+                return true;
+            }
+            pending_valid = true;
+        }
+        if (sendmsg(sock_fd, &pending_msg, 0) < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+                return false;
+            }
+            perror("NB_Blackadder Library: could not write!!");
+        }
+        free_message(pending_msg);
+        pending_valid = false;
+    }
+}
+
+void NB_Blackadder::read_events() {
     struct msghdr msg;
     struct iovec iov;
     int total_buf_size;
     int bytes_read;
     unsigned char id_len;
-    int ret;
-    int high_sock;
-    if (pipe_fds[0] > sock_fd) {
-        high_sock = pipe_fds[0];
-    } else {
-        high_sock = sock_fd;
+    char *buffer;
+    bool pooled;
+    for (int burst = 0; burst < NB_READ_BURST; burst++) {
+        memset(&msg, 0, sizeof (msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        iov.iov_base = fake_buf;
+        iov.iov_len = 1;
+#if HAVE_USE_NETLINK
+        total_buf_size = recvmsg(sock_fd, &msg, MSG_PEEK | MSG_TRUNC);
+#else	
+        if (recvmsg(sock_fd, &msg, MSG_PEEK) < 0 || ioctl(sock_fd, FIONREAD, &total_buf_size) < 0) {
+            total_buf_size = -1;
+        }
+#endif
+        if (total_buf_size <= 0) {
+            if (burst == 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("NB_Blackadder Library: did not read ");
+            }
+            /*DO NOT call the callback function*/
+            return;
+        }
+        pooled = (total_buf_size <= NB_BUFFER_SIZE && buffer_pool->pop(buffer));
+        if (!pooled) {
+            buffer = (char *) malloc(total_buf_size);
+        }
+        iov.iov_base = buffer;
+        iov.iov_len = total_buf_size;
+        bytes_read = recvmsg(sock_fd, &msg, 0);
+        if (bytes_read <= 0) {
+            if (pooled) {
+                release_buffer(buffer);
+            } else {
+                free(buffer);
+            }
+            return;
+        }
+        Event *ev = new Event();
+        ev->buffer = buffer;
+        if (pooled) {
+            ev->release = &release_buffer;
+        }
+        ev->type = *((char *)ev->buffer + sizeof (struct nlmsghdr));
+        id_len = *((char *)ev->buffer + sizeof (struct nlmsghdr) + sizeof (unsigned char));
+        ev->id = string((char *)ev->buffer + sizeof (struct nlmsghdr) + sizeof (unsigned char) + sizeof (unsigned char), ((int) id_len) * PURSUIT_ID_LEN);
+        if (ev->type == PUBLISHED_DATA) {
+            ev->data = (char *)ev->buffer + sizeof (struct nlmsghdr) + sizeof (unsigned char) + sizeof (unsigned char) + ((int) id_len) * PURSUIT_ID_LEN;
+            ev->data_len = bytes_read - (sizeof (struct nlmsghdr) + sizeof (unsigned char) + sizeof (unsigned char) + ((int) id_len) * PURSUIT_ID_LEN);
+        } else {
+            ev->data = NULL;
+            ev->data_len = 0;
+        }
+        dispatch(ev);
     }
+}
+
+void *NB_Blackadder::selector(void *arg) {
+    uint64_t wakeups;
+    bool want_write = false;
+    bool readable, writable, woken;
+#if HAVE_USE_NETLINK
+    struct epoll_event events[2];
+    struct epoll_event sock_event;
+    int n;
+    memset(&sock_event, 0, sizeof (sock_event));
+    sock_event.data.fd = sock_fd;
+#else
+    struct pollfd fds[2];
+#endif
     while (true) {
-        if (select(high_sock + 1, &read_set, &write_set, NULL, NULL) == -1) {
-            perror("NB_Blackadder Library: select() error..retrying!");
-        } else {
-            if (FD_ISSET(pipe_fds[0], &read_set)) {
-                /*that's a control internal message sent in the pipe*/
-                ret = read(pipe_fds[0], pipe_buf, 1);
-                FD_ZERO(&write_set);
-                FD_SET(sock_fd, &write_set);
-            }
-            if (FD_ISSET(sock_fd, &read_set)) {
-                /*the netlink socket is readable*/
-                memset(&msg, 0, sizeof (msg));
-                msg.msg_iov = &iov;
-                msg.msg_iovlen = 1;
-                iov.iov_base = fake_buf;
-                iov.iov_len = 1;
+        readable = writable = woken = false;
 #if HAVE_USE_NETLINK
-                total_buf_size = recvmsg(sock_fd, &msg, MSG_PEEK | MSG_TRUNC);
-#else	
-                if (recvmsg(sock_fd, &msg, MSG_PEEK) < 0 || ioctl(sock_fd, FIONREAD, &total_buf_size) < 0) {
-                    cout << "recvmsg/ioctl: " << errno << endl;
-                    total_buf_size = -1;
-                }
+        n = epoll_wait(epoll_fd, events, 2, -1);
+        if (n < 0) {
+            if (errno != EINTR) {
+                perror("NB_Blackadder Library: epoll_wait() error..retrying!");
+            }
+            continue;
+        }
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.fd == sock_fd) {
+                readable = readable || (events[i].events & EPOLLIN);
+                writable = writable || (events[i].events & EPOLLOUT);
+            } else {
+                woken = true;
+            }
+        }
+#else
+        fds[0].fd = sock_fd;
+        fds[0].events = want_write ? (POLLIN | POLLOUT) : POLLIN;
+        fds[0].revents = 0;
+        fds[1].fd = wakeup_fds[0];
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+        if (poll(fds, 2, -1) < 0) {
+            if (errno != EINTR) {
+                perror("NB_Blackadder Library: poll() error..retrying!");
+            }
+            continue;
+        }
+        readable = fds[0].revents & POLLIN;
+        writable = fds[0].revents & POLLOUT;
+        woken = fds[1].revents & POLLIN;
 #endif
-                if (total_buf_size > 0) {
-                    iov.iov_base = malloc(total_buf_size);
-                    iov.iov_len = total_buf_size;
-                    bytes_read = recvmsg(sock_fd, &msg, 0);
-                    Event *ev = new Event();
-                    ev->buffer = (char *) iov.iov_base;
-                    ev->type = *((char *)ev->buffer + sizeof (struct nlmsghdr));
-                    id_len = *((char *)ev->buffer + sizeof (struct nlmsghdr) + sizeof (unsigned char));
-                    ev->id = string((char *)ev->buffer + sizeof (struct nlmsghdr) + sizeof (unsigned char) + sizeof (unsigned char), ((int) id_len) * PURSUIT_ID_LEN);
-                    if (ev->type == PUBLISHED_DATA) {
-                        ev->data = (char *)ev->buffer + sizeof (struct nlmsghdr) + sizeof (unsigned char) + sizeof (unsigned char) + ((int) id_len) * PURSUIT_ID_LEN;
-                        ev->data_len = bytes_read - (sizeof (struct nlmsghdr) + sizeof (unsigned char) + sizeof (unsigned char) + ((int) id_len) * PURSUIT_ID_LEN);
-                    } else {
-                        ev->data = NULL;
-                        ev->data_len = 0;
-                    }
-                    pthread_mutex_lock(&worker_mutex);
-                    event_queue.push(ev);
-                    pthread_cond_signal(&worker_cond);
-                    pthread_mutex_unlock(&worker_mutex);
-                } else {
-                    perror("NB_Blackadder Library: did not read ");
-                    /*DO NOT call the callback function*/
-                }
+        if (woken) {
+            /*that's a control internal message; clear the flag before flushing so that no request is left behind*/
+            if (read(wakeup_fds[0], &wakeups, sizeof (wakeups)) < 0) {
+                perror("NB_Blackadder Library: could not read the wakeup descriptor");
             }
-            if (FD_ISSET(sock_fd, &write_set)) {
-                /*the netlink socket is writable*/
-                pthread_mutex_lock(&selector_mutex);
-                msg = output_queue.front();
-                ret = sendmsg(sock_fd, &msg, MSG_WAITALL);
-                if (ret > 0) {
-                    output_queue.pop();
-                    if (msg.msg_iovlen == 2) {
-                        free(msg.msg_iov[0].iov_base);
-                        free(msg.msg_iov[1].iov_base);
-                    } else {
-                        free(msg.msg_iov->iov_base);
-                    }
-                    free(msg.msg_iov);
-                } 
-//                else {
-//                    perror("NB_Blackadder Library: could not write!!");
-//                }
-                FD_ZERO(&write_set);
-                if (output_queue.size() > 0) {
-                    FD_ZERO(&write_set);
-                    FD_SET(sock_fd, &write_set);
-                } else {
-                    FD_ZERO(&write_set);
-                    pthread_cond_signal(&queue_overflow_cond);
-                }
-                pthread_mutex_unlock(&selector_mutex);
+            __atomic_store_n(&wakeup_pending, 0, __ATOMIC_SEQ_CST);
+        }
+        if (readable) {
+            read_events();
+        }
+        if (woken || writable) {
+            bool flushed = flush_output();
+            /*register for writing only while the socket is full*/
+            if (want_write == flushed) {
+                want_write = !flushed;
+#if HAVE_USE_NETLINK
+                sock_event.events = want_write ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+                epoll_ctl(epoll_fd, EPOLL_CTL_MOD, sock_fd, &sock_event);
+#endif
             }
-            FD_ZERO(&read_set);
-            FD_SET(sock_fd, &read_set);
-            FD_SET(pipe_fds[0], &read_set);
+            notify_writable();
         }
     }
 
     return NULL; /* Not reached unless the while-loop is terminated. */
 }
 
-NB_Blackadder::NB_Blackadder(bool user_space) {
+NB_Blackadder::NB_Blackadder(bool user_space, int _number_of_workers) {
     int ret;
     (void) signal(SIGINT, signal_handler);
     if (user_space) {
@@ -236,32 +383,62 @@ NB_Blackadder::NB_Blackadder(bool user_space) {
     d_nladdr.sun_family = PF_LOCAL;
     ba_id2path(d_nladdr.sun_path, (user_space) ? 9999 : 0); /* XXX */
 #endif
-    /*initialize pipes*/
-    if (pipe(pipe_fds) != 0) {
+    /*initialize the wakeup descriptor(s)*/
+#if HAVE_USE_NETLINK
+    wakeup_fds[0] = wakeup_fds[1] = eventfd(0, EFD_NONBLOCK);
+    if (wakeup_fds[0] < 0) {
+        perror("eventfd");
+    }
+    epoll_fd = epoll_create(2);
+    if (epoll_fd < 0) {
+        perror("epoll_create");
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof (ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = sock_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sock_fd, &ev);
+    ev.data.fd = wakeup_fds[0];
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fds[0], &ev);
+#else
+    if (pipe(wakeup_fds) != 0) {
         perror("pipe");
         /* XXX: Should we raise an exception or something? */
     }
-    FD_ZERO(&read_set);
-    FD_SET(sock_fd, &read_set);
-    FD_SET(pipe_fds[0], &read_set);
+    x = fcntl(wakeup_fds[0], F_GETFL, 0);
+    fcntl(wakeup_fds[0], F_SETFL, x | O_NONBLOCK);
+#endif
+    output_queue = new BoundedQueue<struct msghdr>(NB_OUTPUT_QUEUE_SIZE);
+    buffer_pool = new BoundedQueue<char *>(NB_BUFFER_POOL_SIZE);
+    for (int i = 0; i < NB_BUFFER_POOL_SIZE; i++) {
+        buffer_pool->push((char *) malloc(NB_BUFFER_SIZE));
+    }
     /*register default callback method*/
     cf = &defaultCallback;
-    pthread_mutex_init(&selector_mutex, NULL);
-    pthread_mutex_init(&worker_mutex, NULL);
-    pthread_cond_init(&queue_overflow_cond, NULL);
-    pthread_cond_init(&worker_cond, NULL);
+    number_of_workers = (_number_of_workers > 1) ? _number_of_workers : 1;
+    workers = new NBWorker[number_of_workers];
+    for (int i = 0; i < number_of_workers; i++) {
+        workers[i].queue = new BoundedQueue<Event *>(NB_EVENT_QUEUE_SIZE);
+        workers[i].sleeping = 0;
+        pthread_mutex_init(&workers[i].mutex, NULL);
+        pthread_cond_init(&workers[i].cond, NULL);
+    }
     pthread_create(&selector_thread, NULL, selector, NULL);
-    pthread_create(&worker_thread, NULL, worker, NULL);
+    for (int i = 0; i < number_of_workers; i++) {
+        pthread_create(&workers[i].thread, NULL, worker, &workers[i]);
+    }
 }
 
 NB_Blackadder::~NB_Blackadder() {
+    char *buffer;
     cout << "NB_Blackadder Library: deleting Blackadder..." << endl;
-    pthread_mutex_lock(&selector_mutex);
-    if (output_queue.size() != 0) {
-        pthread_cond_wait(&queue_overflow_cond, &selector_mutex);
+    /*let the selector thread send all pending requests*/
+    while (!output_queue->empty() || pending_valid) {
+        usleep(1000);
+    }
+    for (int i = 0; i < number_of_workers; i++) {
+        pthread_cancel(workers[i].thread);
     }
-    pthread_mutex_unlock(&selector_mutex);
-    pthread_cancel(worker_thread);
     pthread_cancel(selector_thread);
     if (sock_fd != -1) {
         close(sock_fd);
@@ -270,18 +447,35 @@ NB_Blackadder::~NB_Blackadder() {
         unlink(s_nladdr.sun_path);
 #endif
     }
+#if HAVE_USE_NETLINK
+    close(epoll_fd);
+    close(wakeup_fds[0]);
+#else
+    close(wakeup_fds[0]);
+    close(wakeup_fds[1]);
+#endif
+    /*Events that are still alive may give their buffers back later, so the pool itself stays allocated*/
+    while (buffer_pool->pop(buffer)) {
+        free(buffer);
+    }
 }
 
 NB_Blackadder* NB_Blackadder::Instance(bool user_space) {
+    return Instance(user_space, 1);
+}
+
+NB_Blackadder* NB_Blackadder::Instance(bool user_space, int number_of_workers) {
     if (!m_pInstance) {
-        m_pInstance = new NB_Blackadder(user_space);
+        m_pInstance = new NB_Blackadder(user_space, number_of_workers);
     }
     return m_pInstance;
 }
 
 void NB_Blackadder::join() {
     pthread_join(selector_thread, NULL);
-    pthread_join(worker_thread, NULL);
+    for (int i = 0; i < number_of_workers; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
 }
 
 void NB_Blackadder::setCallback(callbacktype function) {
@@ -405,7 +599,6 @@ void NB_Blackadder::unsubscribe_info(const string &id, const string &prefix_id,
 }
 
 void NB_Blackadder::push(unsigned char type, const string &id, const string &prefix_id, char strategy, void *str_opt, unsigned int str_opt_len) {
-    int ret;
     char *buffer;
     int buffer_length;
     struct nlmsghdr *nlh;
@@ -442,23 +635,31 @@ void NB_Blackadder::push(unsigned char type, const string &id, const string &pre
     msg.msg_iov = iov;
     msg.msg_iovlen = 1;
 
-    pthread_mutex_lock(&selector_mutex);
-    output_queue.push(msg);
-    if (output_queue.size() == 1) {
-        ret = write(pipe_fds[1], pipe_buf, 1);
-    }
-    if (output_queue.size() == 1000) {
-        pthread_cond_wait(&queue_overflow_cond, &selector_mutex);
-    }
-    pthread_mutex_unlock(&selector_mutex);
+    enqueue(msg);
 }
 
 void NB_Blackadder::publish_data(const string &id, char strategy, void *str_opt, unsigned int str_opt_len, void *data, int data_len) {
-    int ret;
+    struct msghdr msg;
+    make_publish_data(msg, id, strategy, str_opt, str_opt_len, data, data_len);
+    enqueue(msg);
+}
+
+bool NB_Blackadder::try_publish_data(const string &id, char strategy, void *str_opt, unsigned int str_opt_len, void *data, int data_len) {
+    struct msghdr msg;
+    make_publish_data(msg, id, strategy, str_opt, str_opt_len, data, data_len);
+    if (!try_enqueue(msg)) {
+        /*the data stays with the application*/
+        free(msg.msg_iov[0].iov_base);
+        free(msg.msg_iov);
+        return false;
+    }
+    return true;
+}
+
+void NB_Blackadder::make_publish_data(struct msghdr &msg, const string &id, char strategy, void *str_opt, unsigned int str_opt_len, void *data, int data_len) {
     char *buffer;
     int buffer_length;
     struct nlmsghdr *nlh;
-    struct msghdr msg;
     unsigned char type = PUBLISH_DATA;
     struct iovec *iov = (struct iovec *) calloc(sizeof (struct iovec), 2);
     unsigned char id_len = id.length() / PURSUIT_ID_LEN;
@@ -492,16 +693,74 @@ void NB_Blackadder::publish_data(const string &id, char strategy, void *str_opt,
     msg.msg_namelen = sizeof (d_nladdr);
     msg.msg_iov = iov;
     msg.msg_iovlen = 2;
+}
 
-    pthread_mutex_lock(&selector_mutex);
-    output_queue.push(msg);
-    if (output_queue.size() == 1) {
-        ret = write(pipe_fds[1], pipe_buf, 1);
+bool NB_Blackadder::alloc_publish_buffer(PublishBuffer &buf, const string &id, unsigned char strategy, void *str_opt, unsigned int str_opt_len, unsigned int capacity) {
+    if (id.length() % PURSUIT_ID_LEN != 0) {
+        cout << "NB_Blackadder Library: Could not allocate a publish buffer - wrong ID size" << endl;
+        return false;
+    }
+    if (str_opt == NULL) {
+        str_opt_len = 0;
+    }
+    buf.header_len = publish_header_len(id, str_opt_len);
+    buf.capacity = capacity;
+    buf.in_ring = false;
+    buf.header = (char *) malloc(buf.header_len + capacity);
+    if (buf.header == NULL) {
+        return false;
     }
-    if (output_queue.size() == 1000) {
-        pthread_cond_wait(&queue_overflow_cond, &selector_mutex);
+    write_publish_header(buf.header, id, strategy, str_opt, str_opt_len, capacity);
+    buf.data = buf.header + buf.header_len;
+    return true;
+}
+
+void NB_Blackadder::publish_buffer(PublishBuffer &buf, unsigned int data_len) {
+    struct msghdr msg;
+    if (buf.header == NULL) {
+        return;
     }
-    pthread_mutex_unlock(&selector_mutex);
+    make_buffer_message(msg, buf, data_len);
+    enqueue(msg);
+    buf.header = NULL;
+    buf.data = NULL;
+}
+
+bool NB_Blackadder::try_publish_buffer(PublishBuffer &buf, unsigned int data_len) {
+    struct msghdr msg;
+    if (buf.header == NULL) {
+        return true;
+    }
+    make_buffer_message(msg, buf, data_len);
+    if (!try_enqueue(msg)) {
+        free(msg.msg_iov);
+        return false;
+    }
+    buf.header = NULL;
+    buf.data = NULL;
+    return true;
+}
+
+void NB_Blackadder::make_buffer_message(struct msghdr &msg, PublishBuffer &buf, unsigned int data_len) {
+    struct iovec *iov;
+    if (data_len > buf.capacity) {
+        data_len = buf.capacity;
+    }
+    ((struct nlmsghdr *) buf.header)->nlmsg_len = buf.header_len + data_len;
+    iov = (struct iovec *) malloc(sizeof (struct iovec));
+    iov->iov_base = buf.header;
+    iov->iov_len = buf.header_len + data_len;
+    memset(&msg, 0, sizeof (msg));
+    msg.msg_name = (void *) &d_nladdr;
+    msg.msg_namelen = sizeof (d_nladdr);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 1;
+}
+
+void NB_Blackadder::release_publish_buffer(PublishBuffer &buf) {
+    free(buf.header);
+    buf.header = NULL;
+    buf.data = NULL;
 }
 
 void NB_Blackadder::disconnect() {
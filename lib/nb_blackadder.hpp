@@ -20,6 +20,21 @@
 #include <signal.h>
 #include <queue>
 #include <fcntl.h>
+#include <pthread.h>
+#if HAVE_USE_NETLINK
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+#include "ba_queue.hpp"
+
+/*Our proposal sizes of the lock-free queues and of the receive buffer pool*/
+#define NB_OUTPUT_QUEUE_SIZE 1024 //pending requests before a request method waits
+#define NB_EVENT_QUEUE_SIZE 1024 //pending Events per worker before the selector thread waits
+#define NB_BUFFER_SIZE 2048 //larger Events are received in a malloc'd buffer
+#define NB_BUFFER_POOL_SIZE 256
+#define NB_READ_BURST 32 //Events read per wakeup of the selector thread
+#define NB_WRITABLE_CREDITS (NB_OUTPUT_QUEUE_SIZE / 4) //free room in the output_queue before the writable callback fires
 
 class Event;
 
@@ -28,15 +43,21 @@ class Event;
  */
 typedef void (*callbacktype)(Event *);
 
+/**@relates NB_Blackadder
+ * @brief Our proposal a type definition for the pointer to the writable callback method (see NB_Blackadder::setWritableCallback). It gets the current credits.
+ */
+typedef void (*writabletype)(unsigned int credits);
+
 /**@brief (User Library) This is the wrapper class that makes the service model available to all applications in a Non-Blocking manner. 
  * 
  * blackadder expects requests to be sent in its netlink socket. Therefore the wrapper class just exports some human-friendly methods for creating service model compliant buffers that are asynchronously sent to blackadder.
  * NB_Blackadder implements the Singleton Pattern. A single NB_Blackadder object can be created by a single process using the <b>public</b> Instance method. The Constructor is <b>private</b>.
  * 
- * NB_Blackadder uses two threads. A selector thread reads events when the netlink socket is readable and passes them to the worker thread. 
+ * NB_Blackadder uses a selector thread and one or more worker threads. A selector thread reads events when the netlink socket is readable and passes them to a worker thread. 
  * In the context of the worker thread, the callback method that <b>must be provided by the applications</b> is called with a reference to the received Event.
  * 
- * The selector thread is also notified (using a pipe) to register the netlink socket for write when requests are to be forwarded to blackadder.
+ * The selector thread is also notified (using an eventfd, or a pipe where it is not available) when requests are to be forwarded to blackadder.
+ * Our proposal requests and Events travel through bounded lock-free queues and Events are received in pooled buffers, so no lock is taken on the data path.
  * 
  * @note All service request related methods enforce some rules regarding the size of the identifiers so that blackadder is not confused.
  */
@@ -54,6 +75,14 @@ public:
      * @return 
      */
     static NB_Blackadder* Instance(bool user_space);
+    /**@brief Our proposal same as Instance(bool) but starts number_of_workers callback worker threads.
+     *
+     * Events for the same identifier are always delivered by the same worker and in the order they were received, but the callback may then run concurrently for different identifiers.
+     * @param user_space see Instance(bool).
+     * @param number_of_workers the number of worker threads (at least 1). It is ignored if the NB_Blackadder object already exists.
+     * @return 
+     */
+    static NB_Blackadder* Instance(bool user_space, int number_of_workers);
     /**@brief this method will send a PUBLISH_SCOPE request to blackadder. <b>It won't block. Instead the request buffer will be put in a queue and the selector thread will be notified to send the request to blackadder.</b>
      * 
      * If prefix_id is an empty string, the request is about a root scope.
@@ -186,6 +215,49 @@ public:
      * @param data_len the size of the published data.
      */
     void publish_data(const string &id, char strategy, void *str_opt, unsigned int str_opt_len, void *data, int data_len);
+    /**@brief Our proposal the same as publish_data but it never waits: if the output_queue is full nothing is queued and false is returned.
+     *
+     * The data then still belongs to the application, which can retry when the writable callback fires (see setWritableCallback) or drop it.
+     * @return true if the request was queued (the data then belongs to NB_Blackadder).
+     */
+    bool try_publish_data(const string &id, char strategy, void *str_opt, unsigned int str_opt_len, void *data, int data_len);
+    /**@brief Our proposal prepares a publication that the application writes in place (zero-copy publish_data).
+     *
+     * The whole request is built in one malloc'd buffer: the request header first and buf.data right after it. publish_buffer queues it as a single iovec
+     * and the selector thread frees it once it is sent. A buffer that is not published must be passed to release_publish_buffer.
+     *
+     * @param buf is updated accordingly.
+     * @param id the full identifier of the information item for which data is published.
+     * @param strategy the dissemination strategy assigned to the request.
+     * @param str_opt a bucket of bytes that are strategy specific. When the IMPLICIT_RENDEZVOUS strategy is used this bucket contains a LIPSIN identifier.
+     * @param str_opt_len the size of the provided bucket of bytes.
+     * @param capacity the most bytes the application will publish.
+     * @return false if the ID size is wrong or no memory could be allocated.
+     */
+    bool alloc_publish_buffer(PublishBuffer &buf, const string &id, unsigned char strategy, void *str_opt, unsigned int str_opt_len, unsigned int capacity);
+    /**@brief Our proposal queues the PUBLISH_DATA request of a buffer from alloc_publish_buffer. <b>It won't block.</b> The buffer belongs to NB_Blackadder afterwards.
+     *
+     * @param buf the buffer.
+     * @param data_len the number of bytes written to buf.data (at most buf.capacity).
+     */
+    void publish_buffer(PublishBuffer &buf, unsigned int data_len);
+    /**@brief Our proposal the same as publish_buffer but it never waits: if the output_queue is full nothing is queued, buf stays valid and false is returned.
+     */
+    bool try_publish_buffer(PublishBuffer &buf, unsigned int data_len);
+    /**@brief Our proposal the number of requests that can be queued right now without waiting (the free room in the output_queue).
+     *
+     * It is a snapshot: other threads may queue requests and the selector thread keeps sending them.
+     */
+    static unsigned int credits();
+    /**@brief Our proposal registers a callback that is called once the output_queue has NB_WRITABLE_CREDITS free slots again after a try_publish call found it full.
+     *
+     * The callback runs in the context of the selector thread, so it must not block (a try_publish call is fine). It may occasionally fire although nothing was refused.
+     * @param t a pointer to the callback function (of type writabletype)
+     */
+    void setWritableCallback(writabletype t);
+    /**@brief Our proposal releases a buffer from alloc_publish_buffer without publishing it.
+     */
+    void release_publish_buffer(PublishBuffer &buf);
     /**@brief This method will send a disconnect signal to Blackadder. 
      * 
      * In user space this is required so that Blackadder can then undo all requests the application has previously sent.
@@ -215,68 +287,111 @@ public:
     static void signal_handler(int sig);
     /**@brief This method MUST be called by the application so that the main function will not end before the NB_Blackadder threads end.
      * 
-     * it calls pthread_join for the worker and selector threads.
+     * it calls pthread_join for the worker(s) and selector threads.
      */
     void join();
+    /**@brief Our proposal one callback worker thread and the lock-free queue the selector thread fills for it.
+     *
+     * The worker only touches mutex and cond when its queue runs empty and it goes to sleep (sleeping is then set), so under load events are handed over without any lock.
+     */
+    struct NBWorker {
+        pthread_t thread;
+        BoundedQueue<Event *> *queue;
+        pthread_mutex_t mutex;
+        pthread_cond_t cond;
+        int sleeping;
+    };
     /**@brief The selector Thread (see details).
      * 
-     * The selector thread always blocks to the select() method. If the netlink socket is only registered for reading, select() unblocks only when an Event is sent by blackadder.
-     * When a request is ready to be sent to blackadder, a dummy message is sent to the pipe in which the selector thread always includes it in the reading fd_set. AT that point the netlink socket is also registered for writing.
-     * When the socket will unblock again it will send the message to blackadder.
+     * The selector thread always blocks in epoll_wait() (poll() where netlink is not available). The netlink socket is registered for reading and, only while the socket is full, for writing.
+     * When a request is ready to be sent to blackadder, the selector thread is woken up through wakeup_fds (an eventfd on Linux, a pipe elsewhere) and sends everything in the output_queue.
      */
     static pthread_t selector_thread;
-    /**@brief a mutex used to synchronize NB_Blackadder threads.
-     */
-    static pthread_mutex_t selector_mutex;
-    /**@brief this condition is used for putting a limit to the pending requests.
-     */
-    static pthread_cond_t queue_overflow_cond;
-    /**@brief the worker thread (see details).
+    /**@brief Our proposal the worker threads (see details).
      * 
-     * The worker thread always blocks in the worker_cond. The selector thread signals that condition whenever a new event from blackadder was read.
-     * The worker thread unblocks, reads the event from the event_queue and calls the application-defined callback method.
-     */
-    static pthread_t worker_thread;
-    /**@brief a mutex used to synchronize NB_Blackadder threads.
+     * The selector thread puts every Event in the queue of the worker chosen by hashing the Event identifier, so Events for the same identifier are always delivered in order by the same worker.
+     * A worker calls the application-defined callback method for all Events in its queue and sleeps when the queue is empty.
      */
-    static pthread_mutex_t worker_mutex;
-    /**@brief the condition for which the worker thread constantly waits. It is only signaled by the selector thread.
+    static NBWorker *workers;
+    /**@brief Our proposal the number of worker threads (1 unless the application asked for more in Instance()).
      */
-    static pthread_cond_t worker_cond;
-    /**@brief the set of file descriptions that are registered for reading. Only the netlink socket sock_fd and the pipefds are used.
+    static int number_of_workers;
+    /**@brief Our proposal the descriptors used to wake the selector thread up. With an eventfd both are the same descriptor.
      */
-    static fd_set read_set;
-    /**@brief the set of file descriptions that are registered for writing. Only the netlink socket sock_fd and the pipefds are used.
+    static int wakeup_fds[2];
+    /**@brief Our proposal 1 while a wakeup is in flight, so that producers write to wakeup_fds only once per batch of requests.
      */
-    static fd_set write_set;
-    /**@brief the file descriptors of the bidirectional pipe.
+    static int wakeup_pending;
+#if HAVE_USE_NETLINK
+    /**@brief Our proposal the epoll instance of the selector thread.
      */
-    static int pipe_fds[2];
+    static int epoll_fd;
+#endif
     /**@brief the netlink socket file descriptor.
      */
     static int sock_fd;
     /**@brief the queue where all service model related methods put their messages that are later sent to blackadder by the selector thread.
+     *
+     * Our proposal it is a bounded lock-free queue: a request method that finds it full waits until the selector thread has made room.
      */
-    static queue <struct msghdr> output_queue;
-    /**@brief the queue where the selector thread puts all Events sent by blackadder that are later processed by the worker thread.
-     */
-    static queue <Event *> event_queue;
-    /**@brief a dummy buffer for getting a dummy message from the pipe and interrupting the select() call.
+    static BoundedQueue<struct msghdr> *output_queue;
+    /**@brief Our proposal the pool of NB_BUFFER_SIZE receive buffers. Events hand their buffer back when they are deleted (see Event::release).
      */
-    static char pipe_buf[1];
+    static BoundedQueue<char *> *buffer_pool;
     /**@brief a dummy buffer for peeking to the actual netlink buffers.
      */
     static char fake_buf[1];
     /**@brief the Callback function registered with NB_Blackadder. The user must override the default by calling the setCallback() method.
      */
     static callbacktype cf;
+    /**@brief Our proposal the writable callback function registered with setWritableCallback (NULL by default).
+     */
+    static writabletype wf;
+    /**@brief Our proposal 1 after a try_publish call found the output_queue full, until the writable callback is called.
+     */
+    static int writable_wanted;
 
 private:
     /**@brief Constructor: It initiates the netlink socket appropriately. It initiates all mutexes and condition variables and starts the worker and selector threads.
      * 
      * @param user_space
      */
-    NB_Blackadder(bool user_space);
+    NB_Blackadder(bool user_space, int number_of_workers);
+    /**@brief Our proposal puts msg in the output_queue (waiting while it is full) and wakes the selector thread up if it is not already awake.
+     */
+    static void enqueue(struct msghdr &msg);
+    /**@brief Our proposal puts msg in the output_queue unless it is full.
+     * @return false if the queue is full (writable_wanted is then set).
+     */
+    static bool try_enqueue(struct msghdr &msg);
+    /**@brief Our proposal wakes the selector thread up if it is not already awake.
+     */
+    static void wake_selector();
+    /**@brief Our proposal calls the writable callback if it was asked for and there is enough room in the output_queue (selector thread only).
+     */
+    static void notify_writable();
+    /**@brief Our proposal builds the PUBLISH_DATA message of publish_data and try_publish_data.
+     */
+    void make_publish_data(struct msghdr &msg, const string &id, char strategy, void *str_opt, unsigned int str_opt_len, void *data, int data_len);
+    /**@brief Our proposal builds the message of publish_buffer and try_publish_buffer.
+     */
+    void make_buffer_message(struct msghdr &msg, PublishBuffer &buf, unsigned int data_len);
+    /**@brief Our proposal sends the queued messages until the output_queue is empty or the socket is full.
+     * @return false if the socket is full and the selector thread must wait for it to become writable.
+     */
+    static bool flush_output();
+    /**@brief Our proposal reads up to NB_READ_BURST Events from the socket and dispatches them to the workers.
+     */
+    static void read_events();
+    /**@brief Our proposal puts ev in the queue of the worker responsible for its identifier.
+     */
+    static void dispatch(Event *ev);
+    /**@brief Our proposal gives a receive buffer back to buffer_pool (it is the Event::release hook).
+     */
+    static void release_buffer(void *buffer);
+    /**@brief Our proposal frees the buffers of a message taken from the output_queue.
+     */
+    static void free_message(struct msghdr &msg);
     /**brief push a message in the queue and notify selector thread to send it to blackadder.
      * 
      * @param type as passed by a request method.
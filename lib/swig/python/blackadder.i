@@ -35,6 +35,9 @@
 // Python methods for Bitvector class
 %include bitvector.i
 
+// Batched events and in-place publications (Blackadder, PublishBuffer)
+%include events.i
+
 %include "blackadder_defs.h"
 %include "blackadder.hpp"
 %include "nb_blackadder.hpp"
@@ -42,8 +45,13 @@
 
 %inline %{
 // Convenience function for creating a read-write buffer object
+// (a bytearray on Python 3, which has no buffer objects)
 PyObject *rwbuffer(int len)
 {
+#if PY_MAJOR_VERSION >= 3
+    return PyByteArray_FromStringAndSize(NULL, len);
+#else
     return PyBuffer_New(len);
+#endif
 }
 %}
@@ -16,22 +16,37 @@
 
 // (void *BYTES, unsigned int LEN)
 // buffer -> (void *, unsigned int)
+// Our proposal objects supporting the buffer protocol (bytes, bytearray,
+// memoryview, array, numpy, ...) are passed without a copy: the buffer is
+// held for the duration of the call. Old-style buffers are still accepted
+// on Python 2.
 
-%typemap(in) (void *BYTES, unsigned int LEN) {
+%typemap(in) (void *BYTES, unsigned int LEN) (Py_buffer view, int got_view = 0) {
     // in: (void *BYTES, unsigned int LEN)
     void *buf = NULL;
-    ssize_t ssize;
-    int res;
+    Py_ssize_t ssize = 0;
+    int res = -1;
 
     if ($input == Py_None) {
         $1 = NULL;
         $2 = 0;
     }
     else {
-        if (PyObject_CheckReadBuffer($input))
+        if (PyObject_CheckBuffer($input)) {
+            if (PyObject_GetBuffer($input, &view, PyBUF_SIMPLE) == 0) {
+                got_view = 1;
+                buf = view.buf;
+                ssize = view.len;
+                res = SWIG_OK;
+            }
+            else {
+                PyErr_Clear();
+            }
+        }
+%#if PY_MAJOR_VERSION < 3
+        if (!got_view && PyObject_CheckReadBuffer($input))
             res = PyObject_AsReadBuffer($input, (const void **)&buf, &ssize);
-        else
-            res = -1;
+%#endif
         if (!SWIG_IsOK(res)) {
             %argument_fail(res, "(void *BYTES, unsigned int LEN)", $symname, $argnum);
         }
@@ -40,23 +55,39 @@
     }
 }
 
+%typemap(freearg) (void *BYTES, unsigned int LEN) {
+    // freearg: (void *BYTES, unsigned int LEN)
+    if (got_view$argnum)
+        PyBuffer_Release(&view$argnum);
+}
+
 
 // char *BYTE
 // buffer <-> char *
 
-%typemap(in) char *BYTE {
+%typemap(in) char *BYTE (Py_buffer view, int got_view = 0) {
     // in: char *BYTE
     void *buf = NULL;
-    ssize_t ssize = 0;
-    int res;
+    Py_ssize_t ssize = 0;
+    int res = -1;
 
     if ($input == Py_None)
         $1 = NULL;
     else {
-        if (PyObject_CheckReadBuffer($input))
+        if (PyObject_CheckBuffer($input)) {
+            if (PyObject_GetBuffer($input, &view, PyBUF_SIMPLE) == 0) {
+                got_view = 1;
+                buf = view.buf;
+                res = SWIG_OK;
+            }
+            else {
+                PyErr_Clear();
+            }
+        }
+%#if PY_MAJOR_VERSION < 3
+        if (!got_view && PyObject_CheckReadBuffer($input))
             res = PyObject_AsReadBuffer($input, (const void **)&buf, &ssize);
-        else
-            res = -1;
+%#endif
         if (!SWIG_IsOK(res)) {
             %argument_fail(res, "char *BYTE", $symname, $argnum);
         }
@@ -64,6 +95,12 @@
     }
 }
 
+%typemap(freearg) char *BYTE {
+    // freearg: char *BYTE
+    if (got_view$argnum)
+        PyBuffer_Release(&view$argnum);
+}
+
 %typemap(memberin) char *BYTE {
     // memberin: char *BYTE
     if ($input)
@@ -74,6 +111,26 @@
     // out: char *BYTE
     /* Note: We return a buffer that can be used more or less like a string. */
     /* XXX:  We shouldn't use data_len explicitly. */
-    PyObject *obj = PyBuffer_FromMemory($1, arg1->data_len); /* XXX: arg1 */
+    /* Our proposal a read-only memoryview on Python 3: no copy, valid as long as the Event. */
+    PyObject *obj = _ba_py_view($1, arg1->data_len, 0); /* XXX: arg1 */
     $result = SWIG_Python_AppendOutput($result, obj);
 }
+
+%{
+    /*
+     * Our proposal a view of len bytes at buf, without a copy (a memoryview
+     * on Python 3, a buffer object on Python 2). The memory must outlive it.
+     */
+    static PyObject *_ba_py_view(void *buf, Py_ssize_t len, int writable) {
+        if (buf == NULL) {
+            Py_RETURN_NONE;
+        }
+#if PY_VERSION_HEX >= 0x03030000
+        return PyMemoryView_FromMemory((char *)buf, len, writable ? PyBUF_WRITE : PyBUF_READ);
+#else
+        if (writable)
+            return PyBuffer_FromReadWriteMemory(buf, len);
+        return PyBuffer_FromMemory(buf, len);
+#endif
+    }
+%}
@@ -0,0 +1,98 @@
+/*-
+ * Copyright (C) 2011  Oy L M Ericsson Ab, NomadicLab
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of the
+ * BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+// Our proposal zero-copy data paths for Python: batched event retrieval
+// and in-place publications
+
+%{
+    /*
+     * Note: The Event array is static, not specific to a Blackadder
+     *       instance (there is only one, see Blackadder::Instance).
+     *       Its Events are views into the receive pool of getEvents.
+     */
+    static Event _py_events[EVENT_BATCH_MAX];
+
+    /*
+     * A list of (type, id, data) tuples, data being a read-only view of
+     * the payload in the receive pool (None if there is none). The views
+     * are only valid until the next get_events or try_get_events call:
+     * bytes(data) keeps a copy.
+     */
+    static PyObject *_py_event_list(int count) {
+        if (count < 0) {
+            PyErr_SetFromErrno(PyExc_IOError);
+            return NULL;
+        }
+        PyObject *list = PyList_New(count);
+        if (list == NULL)
+            return NULL;
+        for (int i = 0; i < count; i++) {
+            Event &ev = _py_events[i];
+            PyObject *item = Py_BuildValue("(iNN)", (int) ev.type,
+                                           PyBytes_FromStringAndSize(ev.id.data(), ev.id.length()),
+                                           _ba_py_view(ev.data_len > 0 ? ev.data : NULL, ev.data_len, 0));
+            if (item == NULL) {
+                Py_DECREF(list);
+                return NULL;
+            }
+            PyList_SET_ITEM(list, i, item);
+        }
+        return list;
+    }
+%}
+
+// These build Python objects, so they hold the GIL and only release it
+// while waiting for events.
+%nothread Blackadder::get_events;
+%nothread Blackadder::try_get_events;
+%nothread PublishBuffer::view;
+
+%extend Blackadder {
+    /*
+     * Blocks until at least one event arrives and returns all waiting
+     * ones (at most max_events, up to EVENT_BATCH_MAX) in one list, see
+     * getEvents. An interrupted wait returns an empty list.
+     */
+    PyObject *get_events(int max_events = EVENT_BATCH_MAX) {
+        int count;
+        Py_BEGIN_ALLOW_THREADS
+        count = $self->getEvents(_py_events, max_events);
+        Py_END_ALLOW_THREADS
+        return _py_event_list(count);
+    }
+
+    /*
+     * As get_events, without waiting: an empty list if none is waiting
+     * (for event loops polling getFd).
+     */
+    PyObject *try_get_events(int max_events = EVENT_BATCH_MAX) {
+        return _py_event_list($self->tryGetEvents(_py_events, max_events));
+    }
+}
+
+// The payload of a PublishBuffer is reached through view(), so that the
+// char *BYTE typemap (which needs a data_len) does not apply to it.
+%ignore PublishBuffer::data;
+%ignore PublishBuffer::header;
+
+%extend PublishBuffer {
+    /*
+     * A writable view of the capacity bytes of the payload (see
+     * alloc_publish_buffer): the application fills it in place and then
+     * calls publish_buffer with the number of bytes written. The view must
+     * not be used after publish_buffer or release_publish_buffer.
+     */
+    PyObject *view() {
+        return _ba_py_view($self->data, $self->capacity, 1);
+    }
+}
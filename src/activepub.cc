@@ -29,6 +29,7 @@ ActiveSubscription::ActiveSubscription(String _fullID, unsigned char _strategy,
     strategy = _strategy;
     isScope = _isScope;
     hop_count = 255 ;
+    probing_cost = 1e9 ;
 
     //kanycast
     probing_received = false ;
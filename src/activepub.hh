@@ -78,12 +78,25 @@ public:
      *FID to each remote subscriber
      *key:SubID element:FID*/
     HashTable<String, BABitvector> FID_to_eachsub ;
+    /**@brief Our proposal the FID_to_eachsub aggregated into a few multicast FIDs (see LocalProxy::aggregateFIDs).
+     * Messages that are the same for all remote subscribers are sent once per FID in here instead of once per subscriber*/
+    Vector<BABitvector> FID_groups ;
     /**@brief kanycast
      * if this is a scope IIDs store the informatin itmes published under this scope( not include the decsendent in the subgraph)
      */
     StringSet IIDs ;
 };
 
+/**@brief Our proposal a source (publisher, or a cache on the path to it) of an item of a scope subscription: the FID to it and its distance (see handleScopeProbingMessage).
+ */
+class SourceCandidate {
+public:
+    SourceCandidate() : distance(0) {}
+    SourceCandidate(const BABitvector &_FID, double _distance) : FID(_FID), distance(_distance) {}
+    BABitvector FID;
+    double distance;
+};
+
 /**
  * @brief (blackadder Core) ActiveSubscription represents an active subscription of an application or click element or another Linux module.
  *
@@ -133,6 +146,8 @@ public:
     BABitvector reverse_FID ;
     BABitvector incoming_FID ;
     unsigned char hop_count ;
+    /**@brief the cost (distance weighed against load) of the best probing response so far*/
+    double probing_cost ;
     unsigned char origin ;
     int noofpub ;
     String notificationIID ;
@@ -148,6 +163,8 @@ public:
     int noofrcvpub ;
     HashTable<String, BABitvector> iid_FID_map ;
     HashTable<String, double> iid_distance_map ;
+    /**@brief Our proposal with MULTI_SOURCE, the nearest sources of every item (the nearest first)*/
+    HashTable<String, Vector<SourceCandidate> > iid_sources ;
 };
 
 CLICK_ENDDECLS
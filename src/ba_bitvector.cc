@@ -183,6 +183,14 @@ BABitvector::nonzero_intersection(const BABitvector &o) const {
     return false;
 }
 
+int
+BABitvector::weight() const {
+    int n = 0;
+    for (int i = 0; i <= max_word(); i++)
+        n += __builtin_popcount(_data[i]);
+    return n;
+}
+
 void
 BABitvector::swap(BABitvector &x) {
     uint32_t u = _f0;
@@ -6,6 +6,8 @@
 #include <click/element.hh>
 #include <click/string.hh>
 
+#include "helper.hh"
+
 CLICK_DECLS
 
 /** @brief (blackadder Core) Stolen by Click's bitvector.
@@ -193,6 +195,9 @@ public:
      * This BABitvector and @a x may have different sizes; the smaller is used. */
     bool nonzero_intersection(const BABitvector &x) const;
 
+    /** @brief Return the number of true bits. */
+    int weight() const;
+
 
     /** @brief Swap the contents of this BABitvector and @a x. */
     void swap(BABitvector &x);
@@ -410,6 +415,211 @@ inline void click_swap(BABitvector &a, BABitvector &b) {
     a.swap(b);
 }
 
+/** @brief (blackadder Core) A fixed-width bitvector of @a N bits that stores its data words inline.
+ *
+ * It has the same operators as BABitvector (and the same _data layout) but never touches the heap and never branches on its size,
+ * so it is meant for the per-packet temporaries of fixed size (FID_LEN, IBFSIZE, EBFSIZE). It can be combined with a BABitvector of the same size.
+ */
+template <int N>
+class BAFixedBitvector {
+public:
+
+    enum {
+        nbits = N, nwords = (N + 31) >> 5
+    };
+
+    /** @brief Construct an all-false BAFixedBitvector. */
+    BAFixedBitvector() {
+        clear();
+    }
+
+    /** @brief Construct a BAFixedBitvector from the first nwords words of @a x. */
+    explicit BAFixedBitvector(const BABitvector &x) {
+        assign(x);
+    }
+
+    /** @brief Construct a BAFixedBitvector from N/8 bytes at @a data. */
+    explicit BAFixedBitvector(const unsigned char *data) {
+        clear();
+        memcpy(_data, data, N / 8);
+    }
+
+    /** @brief Return the number of bits in the BAFixedBitvector. */
+    int size() const {
+        return N;
+    }
+
+    /** @brief Set all bits to false. */
+    void clear() {
+        for (int i = 0; i < nwords; i++)
+            _data[i] = 0;
+    }
+
+    /** @brief Return true iff the BAFixedBitvector's bits are all false. */
+    bool zero() const {
+        for (int i = 0; i < nwords; i++)
+            if (_data[i])
+                return false;
+        return true;
+    }
+
+    /** @brief Return the bit at position @a i. */
+    BABitvector::Bit operator[](int i) {
+        assert(i >= 0 && i < N);
+        return BABitvector::Bit(_data[i >> 5], i & 31);
+    }
+
+    /** @overload */
+    bool operator[](int i) const {
+        assert(i >= 0 && i < N);
+        return (_data[i >> 5] & (1U << (i & 31))) != 0;
+    }
+
+    /** @brief Set this BAFixedBitvector to the first nwords words of @a x (missing words are zero). */
+    BAFixedBitvector &assign(const BABitvector &x) {
+        int n = x.max_word() + 1;
+        for (int i = 0; i < nwords; i++)
+            _data[i] = (i < n ? x._data[i] : 0);
+        clear_last();
+        return *this;
+    }
+
+    /** @brief Return a (heap-backed if N > 64) BABitvector copy. */
+    BABitvector to_babitvector() const {
+        BABitvector m(N);
+        memcpy(m._data, _data, nwords * 4);
+        return m;
+    }
+
+    /** @brief Check bitvectors for equality. */
+    bool operator==(const BAFixedBitvector &x) const {
+        return memcmp(_data, x._data, nwords * 4) == 0;
+    }
+
+    /** @overload */
+    bool operator==(const BABitvector &x) const {
+        return x.size() == N && memcmp(_data, x._data, nwords * 4) == 0;
+    }
+
+    /** @brief Check bitvectors for inequality. */
+    bool operator!=(const BAFixedBitvector &x) const {
+        return !(*this == x);
+    }
+
+    /** @overload */
+    bool operator!=(const BABitvector &x) const {
+        return !(*this == x);
+    }
+
+    /** @brief Negate this BAFixedBitvector by flipping each of its bits. */
+    void negate() {
+        for (int i = 0; i < nwords; i++)
+            _data[i] = ~_data[i];
+        clear_last();
+    }
+
+    /** @brief Return the bitwise negation of this BAFixedBitvector. */
+    BAFixedBitvector operator~() const {
+        BAFixedBitvector m = *this;
+        m.negate();
+        return m;
+    }
+
+    /** @brief Modify this BAFixedBitvector by bitwise and with @a x. */
+    BAFixedBitvector &operator&=(const BAFixedBitvector &x) {
+        for (int i = 0; i < nwords; i++)
+            _data[i] &= x._data[i];
+        return *this;
+    }
+
+    /** @overload
+     * @pre @a x.size() == N */
+    BAFixedBitvector &operator&=(const BABitvector &x) {
+        assert(x.size() == N);
+        for (int i = 0; i < nwords; i++)
+            _data[i] &= x._data[i];
+        return *this;
+    }
+
+    /** @brief Modify this BAFixedBitvector by bitwise or with @a x. */
+    BAFixedBitvector &operator|=(const BAFixedBitvector &x) {
+        for (int i = 0; i < nwords; i++)
+            _data[i] |= x._data[i];
+        return *this;
+    }
+
+    /** @overload
+     * @pre @a x.size() == N */
+    BAFixedBitvector &operator|=(const BABitvector &x) {
+        assert(x.size() == N);
+        for (int i = 0; i < nwords; i++)
+            _data[i] |= x._data[i];
+        return *this;
+    }
+
+    /** @brief Modify this BAFixedBitvector by bitwise exclusive or with @a x. */
+    BAFixedBitvector &operator^=(const BAFixedBitvector &x) {
+        for (int i = 0; i < nwords; i++)
+            _data[i] ^= x._data[i];
+        return *this;
+    }
+
+    /** @brief Return the bitwise and of two bitvectors. */
+    template <typename T>
+    BAFixedBitvector operator&(const T &x) const {
+        BAFixedBitvector m = *this;
+        m &= x;
+        return m;
+    }
+
+    /** @brief Return the bitwise or of two bitvectors. */
+    template <typename T>
+    BAFixedBitvector operator|(const T &x) const {
+        BAFixedBitvector m = *this;
+        m |= x;
+        return m;
+    }
+
+    /** @brief Return the bitwise exclusive or of two bitvectors. */
+    BAFixedBitvector operator^(const BAFixedBitvector &x) const {
+        BAFixedBitvector m = *this;
+        m ^= x;
+        return m;
+    }
+
+    /** @brief Return true iff every bit set in @a x is also set in this BAFixedBitvector (i.e. (*this & x) == x). */
+    template <typename T>
+    bool contains(const T &x) const {
+        for (int i = 0; i < nwords; i++)
+            if ((_data[i] & x._data[i]) != x._data[i])
+                return false;
+        return true;
+    }
+
+    String to_string() const {
+        String res;
+        for (int i = 0; i < N; i++)
+            res += ((*this)[N - i - 1] ? '1' : '0');
+        return res;
+    }
+
+    uint32_t _data[nwords];
+
+private:
+
+    void clear_last() {
+        if ((N & 0x1F) != 0)
+            _data[nwords - 1] &= (1U << (N & 0x1F)) - 1;
+    }
+
+};
+
+/** @brief a fixed-width bitvector for LIPSIN identifiers (see helper.hh). */
+typedef BAFixedBitvector<FID_LEN * 8> FIDBitvector;
+/** @brief a fixed-width bitvector for the information/exclusive Bloom filters (see helper.hh). */
+typedef BAFixedBitvector<IBFSIZE * 8> IBFBitvector;
+
+
 
 CLICK_ENDDECLS
 #endif
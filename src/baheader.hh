@@ -0,0 +1,92 @@
+#ifndef BAHEADER_HH_INCLUDED
+#define BAHEADER_HH_INCLUDED
+
+#include <click/config.h>
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <click/packet.hh>
+
+#include "helper.hh"
+
+CLICK_DECLS
+
+/**@brief the most identifiers a Blackadder header can carry (numberOfIDs is a single byte)*/
+#define BA_MAX_IDS 255
+
+/**@brief Our proposal a zero copy view of the identifier list of a Blackadder packet: numberOfIDs followed by (IDLength, ID)*, where each IDLength is in fragments of PURSUIT_ID_LEN.
+ * parse() walks the list once, checking it against the packet length, and keeps the position of every identifier, so that the elements neither repeat the offset arithmetic nor build a String per identifier unless they need one.
+ * The view points into the packet data, so it is valid only as long as the packet is not modified*/
+class BAHeader
+{
+public:
+    BAHeader() : _data(NULL), _count(0), _begin(0), _end(0) {}
+    /**@brief parses the list that starts at @a offset of the packet data. Returns false if it does not fit in the packet*/
+    inline bool parse(const Packet* p, uint32_t offset) {return parse(p->data(), p->length(), offset) ;}
+    /**@brief parses the list that starts at @a offset of the @a length bytes at @a data. Returns false if it does not fit*/
+    bool parse(const unsigned char* data, uint32_t length, uint32_t offset)
+    {
+        _data = data ;
+        _count = 0 ;
+        _begin = offset ;
+        if(offset + sizeof(unsigned char) > length)
+            return false ;
+        int number_of_ids = data[offset] ;
+        uint32_t index = offset + sizeof(unsigned char) ;
+        for(int i = 0 ; i < number_of_ids ; i++)
+        {
+            if(index + sizeof(unsigned char) > length)
+                return false ;
+            unsigned char fragments = data[index] ;
+            index += sizeof(unsigned char) ;
+            if(index + fragments * PURSUIT_ID_LEN > length)
+                return false ;
+            _offsets[i] = index ;
+            _fragments[i] = fragments ;
+            index += fragments * PURSUIT_ID_LEN ;
+        }
+        _count = number_of_ids ;
+        _end = index ;
+        return true ;
+    }
+    /**@brief the number of identifiers*/
+    inline int size() const {return _count ;}
+    /**@brief the first byte of identifier @a i*/
+    inline const unsigned char* id(int i) const {return _data + _offsets[i] ;}
+    /**@brief the length of identifier @a i in bytes*/
+    inline uint32_t id_length(int i) const {return _fragments[i] * PURSUIT_ID_LEN ;}
+    /**@brief the length of identifier @a i in fragments of PURSUIT_ID_LEN*/
+    inline unsigned char id_fragments(int i) const {return _fragments[i] ;}
+    /**@brief a copy of identifier @a i*/
+    inline String id_string(int i) const {return String((const char*)id(i), id_length(i)) ;}
+    /**@brief identifier @a i as a String that points into the packet (see String::make_stable): it is valid only as long as the packet is neither modified nor freed,
+     * so it is used as a lookup key and never stored*/
+    inline String id_span(int i) const {return String::make_stable((const char*)id(i), id_length(i)) ;}
+    /**@brief true if identifier @a i is @a s (no copy)*/
+    inline bool id_equals(int i, const String& s) const
+    {
+        return (uint32_t)s.length() == id_length(i) && memcmp(s.data(), id(i), id_length(i)) == 0 ;
+    }
+    /**@brief appends a copy of every identifier to @a out, for the callers that keep them (table keys, pending requests)*/
+    void ids(Vector<String>& out) const
+    {
+        out.reserve(out.size() + _count) ;
+        for(int i = 0 ; i < _count ; i++)
+            out.push_back(id_string(i)) ;
+    }
+    /**@brief the offset of numberOfIDs*/
+    inline uint32_t begin() const {return _begin ;}
+    /**@brief the offset right after the list (the rest of the header or the payload)*/
+    inline uint32_t end() const {return _end ;}
+    /**@brief the size of the list in bytes (numberOfIDs included)*/
+    inline uint32_t length() const {return _end - _begin ;}
+private:
+    const unsigned char* _data ;
+    int _count ;
+    uint32_t _begin ;
+    uint32_t _end ;
+    uint32_t _offsets[BA_MAX_IDS] ;
+    unsigned char _fragments[BA_MAX_IDS] ;
+};
+
+CLICK_ENDDECLS
+#endif // BAHEADER_HH_INCLUDED
@@ -0,0 +1,357 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+#include "bamicrobench.hh"
+#include "baheader.hh"
+#include <click/confparse.hh>
+#include <click/cycles.hh>
+#include <click/router.hh>
+#include <click/standard/scheduleinfo.hh>
+
+CLICK_DECLS
+
+#if CLICK_DMALLOC
+/*counted by operator new in click's glue.cc*/
+extern size_t click_dmalloc_totalnew;
+#endif
+
+/**@brief the number of allocations so far, or 0 if click does not count them*/
+static inline size_t allocations() {
+#if CLICK_DMALLOC
+    return click_dmalloc_totalnew;
+#else
+    return 0;
+#endif
+}
+
+BAMicroBench::BAMicroBench() : _task(NULL), kernel(KERNEL_PUSH), packets(1000000), ids(1), id_space(1), length(64), bloom_bits(FID_LEN * 8), ether(false), subinfo(false), warmup(false), stop(true),
+cycles(0), baseline_cycles(0), fixed_cycles(0), allocs(-1), done(false) {
+}
+
+BAMicroBench::~BAMicroBench() {
+}
+
+int BAMicroBench::configure(Vector<String> &conf, ErrorHandler *errh) {
+    String kernel_str = "push";
+    String fid_str;
+    if (cp_va_kparse(conf, this, errh,
+            "KERNEL", cpkP, cpString, &kernel_str,
+            "PACKETS", 0, cpUnsigned, &packets,
+            "FID", 0, cpString, &fid_str,
+            "IDS", 0, cpUnsigned, &ids,
+            "ID_SPACE", 0, cpUnsigned, &id_space,
+            "LENGTH", 0, cpUnsigned, &length,
+            "BLOOM_BITS", 0, cpUnsigned, &bloom_bits,
+            "ETHER", 0, cpBool, &ether,
+            "SUBINFO", 0, cpBool, &subinfo,
+            "WARMUP", 0, cpBool, &warmup,
+            "STOP", 0, cpBool, &stop,
+            cpEnd) < 0) {
+        return -1;
+    }
+    if (kernel_str == "push") {
+        kernel = KERNEL_PUSH;
+    } else if (kernel_str == "bitvector") {
+        kernel = KERNEL_BITVECTOR;
+    } else if (kernel_str == "bloom") {
+        kernel = KERNEL_BLOOM;
+    } else {
+        return errh->error("KERNEL should be push, bitvector or bloom");
+    }
+    if (packets == 0 || id_space == 0) {
+        return errh->error("PACKETS and ID_SPACE should be positive");
+    }
+    if (ids == 0 || ids > BA_MAX_IDS) {
+        return errh->error("IDS should be between 1 and %d", BA_MAX_IDS);
+    }
+    if (bloom_bits == 0 || bloom_bits % 32 != 0) {
+        return errh->error("BLOOM_BITS should be a positive multiple of 32");
+    }
+    if (kernel == KERNEL_PUSH && noutputs() == 0) {
+        return errh->error("the push kernel needs output 0");
+    }
+    if (warmup && noutputs() < 2) {
+        return errh->error("WARMUP needs output 1");
+    }
+    /*the same bit order as the LIDs of GlobalConf and Forwarder*/
+    fid = BABitvector(FID_LEN * 8);
+    if (fid_str.length() > 0) {
+        if (fid_str.length() != FID_LEN * 8) {
+            return errh->error("FID should be %d bits...it is %d bits", FID_LEN * 8, fid_str.length());
+        }
+        for (int j = 0; j < fid_str.length(); j++) {
+            fid[fid_str.length() - j - 1] = (fid_str[j] == '1');
+        }
+    }
+    return 0;
+}
+
+int BAMicroBench::initialize(ErrorHandler *errh) {
+    if (kernel == KERNEL_PUSH) {
+        unsigned int header_len = (ether ? 14 : 0) + FID_LEN + sizeof (unsigned char) + ids * (sizeof (unsigned char) + 2 * PURSUIT_ID_LEN);
+        unsigned int extra_len = subinfo ? FID_LEN + 2 * PURSUIT_ID_LEN : 0;
+        for (uint32_t i = 0; i < id_space; i++) {
+            WritablePacket *p = Packet::make(header_len + extra_len + length);
+            if (p == NULL) {
+                return errh->error("out of memory");
+            }
+            unsigned char *data = p->data();
+            memset(data, 0, p->length());
+            if (ether) {
+                data += 14;
+            }
+            memcpy(data, fid._data, FID_LEN);
+            data += FID_LEN;
+            *data++ = (unsigned char) ids;
+            for (uint32_t j = 0; j < ids; j++) {
+                String ID = randomID(2);
+                *data++ = 2;
+                memcpy(data, ID.data(), ID.length());
+                data += ID.length();
+            }
+            if (subinfo) {
+                /*the backFID and the notification IID*/
+                memcpy(data, fid._data, FID_LEN);
+                data += FID_LEN;
+                String IID = randomID(2);
+                memcpy(data, IID.data(), IID.length());
+            }
+            templates.push_back(p);
+        }
+    }
+    _task = new Task(this);
+    ScheduleInfo::initialize_task(this, _task, errh);
+    return 0;
+}
+
+void BAMicroBench::cleanup(CleanupStage stage) {
+    if (stage >= CLEANUP_ROUTER_INITIALIZED) {
+        _task->unschedule();
+    }
+    delete _task;
+    for (int i = 0; i < templates.size(); i++) {
+        templates[i]->kill();
+    }
+    templates.clear();
+}
+
+String BAMicroBench::randomID(int fragments) {
+    StringAccum sa;
+    for (int i = 0; i < fragments * PURSUIT_ID_LEN; i++) {
+        sa << (char) click_random(0, 255);
+    }
+    return sa.take_string();
+}
+
+bool BAMicroBench::run_task(Task *) {
+    if (done) {
+        return false;
+    }
+    switch (kernel) {
+        case KERNEL_PUSH:
+            runPush();
+            break;
+        case KERNEL_BITVECTOR:
+            runBitvector();
+            break;
+        case KERNEL_BLOOM:
+            runBloom();
+            break;
+    }
+    done = true;
+    click_chatter("%s: %s", declaration().c_str(), read_handler(this, (void *) H_RESULTS).c_str());
+    if (stop) {
+        router()->please_stop_driver();
+    }
+    return true;
+}
+
+void BAMicroBench::runPush() {
+    click_cycles_t start;
+    size_t allocations_before;
+    int space = templates.size();
+    if (warmup) {
+        for (int i = 0; i < space; i++) {
+            output(1).push(templates[i]->clone());
+        }
+    }
+    /*the cost of making the packets, as the LocalProxy does (a copy of the publication)*/
+    start = click_get_cycles();
+    for (uint32_t i = 0; i < packets; i++) {
+        Packet *t = templates[i % space];
+        WritablePacket *p = Packet::make(t->data(), t->length());
+        p->kill();
+    }
+    baseline_cycles = (double) (click_get_cycles() - start) / packets;
+    allocations_before = allocations();
+    start = click_get_cycles();
+    for (uint32_t i = 0; i < packets; i++) {
+        Packet *t = templates[i % space];
+        output(0).push(Packet::make(t->data(), t->length()));
+    }
+    cycles = (double) (click_get_cycles() - start) / packets;
+#if CLICK_DMALLOC
+    allocs = (double) (allocations() - allocations_before) / packets;
+#else
+    (void) allocations_before;
+#endif
+}
+
+void BAMicroBench::runBitvector() {
+    Vector<BABitvector> lids;
+    Vector<FIDBitvector> fixed_lids;
+    FIDBitvector fixed_fid;
+    BABitvector packet_fid = fid;
+    click_cycles_t start;
+    size_t allocations_before;
+    uint32_t matches = 0;
+    bool given = !fid.zero();
+    /*LIPSIN-like LIDs of a few bits each, without FID every other one is in the FID*/
+    for (uint32_t i = 0; i < ids; i++) {
+        BABitvector lid(FID_LEN * 8);
+        for (int k = 0; k < 5; k++) {
+            lid[click_random(0, FID_LEN * 8 - 1)] = true;
+        }
+        lids.push_back(lid);
+        if (!given && i % 2 == 0) {
+            packet_fid |= lid;
+        }
+    }
+    memcpy(fixed_fid._data, packet_fid._data, FID_LEN);
+    for (uint32_t i = 0; i < ids; i++) {
+        FIDBitvector fixed_lid;
+        memcpy(fixed_lid._data, lids[i]._data, FID_LEN);
+        fixed_lids.push_back(fixed_lid);
+    }
+    allocations_before = allocations();
+    start = click_get_cycles();
+    for (uint32_t i = 0; i < packets; i++) {
+        BABitvector out(FID_LEN * 8);
+        for (uint32_t j = 0; j < ids; j++) {
+            if ((packet_fid & lids[j]) == lids[j]) {
+                out |= lids[j];
+            }
+        }
+        matches += !out.zero();
+    }
+    cycles = (double) (click_get_cycles() - start) / packets;
+#if CLICK_DMALLOC
+    allocs = (double) (allocations() - allocations_before) / packets;
+#else
+    (void) allocations_before;
+#endif
+    start = click_get_cycles();
+    for (uint32_t i = 0; i < packets; i++) {
+        FIDBitvector out;
+        for (uint32_t j = 0; j < ids; j++) {
+            if ((fixed_fid & fixed_lids[j]) == fixed_lids[j]) {
+                out |= fixed_lids[j];
+            }
+        }
+        matches += !out.zero();
+    }
+    fixed_cycles = (double) (click_get_cycles() - start) / packets;
+    /*so that the loops are not optimised away*/
+    if (matches == 0) {
+        click_chatter("%s: no LID matched the FID", declaration().c_str());
+    }
+}
+
+void BAMicroBench::runBloom() {
+    BloomFilter bf(bloom_bits);
+    Vector<String> tested;
+    click_cycles_t start;
+    size_t allocations_before;
+    uint32_t positives = 0;
+    /*every other identifier is in the filter*/
+    for (uint32_t i = 0; i < ids; i++) {
+        String ID = randomID(2);
+        if (i % 2 == 0) {
+            bf.add2bf(ID);
+        }
+        tested.push_back(ID);
+    }
+    allocations_before = allocations();
+    start = click_get_cycles();
+    for (uint32_t i = 0; i < packets; i++) {
+        for (int j = 0; j < tested.size(); j++) {
+            positives += bf.test(tested[j]);
+        }
+    }
+    cycles = (double) (click_get_cycles() - start) / packets;
+#if CLICK_DMALLOC
+    allocs = (double) (allocations() - allocations_before) / packets;
+#else
+    (void) allocations_before;
+#endif
+    if (positives == 0) {
+        click_chatter("%s: no identifier was found in the filter", declaration().c_str());
+    }
+}
+
+String BAMicroBench::read_handler(Element *e, void *thunk) {
+    BAMicroBench *mb = (BAMicroBench *) e;
+    static const char * const kernels[] = {"push", "bitvector", "bloom"};
+    StringAccum sa;
+    switch ((intptr_t) thunk) {
+        case H_RESULTS:
+            sa << "kernel=" << kernels[mb->kernel] << " packets=" << mb->packets << " ids=" << mb->ids;
+            if (mb->kernel == KERNEL_PUSH) {
+                sa << " id_space=" << mb->id_space << " length=" << mb->length;
+            } else if (mb->kernel == KERNEL_BLOOM) {
+                sa << " bloom_bits=" << mb->bloom_bits;
+            }
+            if (!mb->done) {
+                sa << " pending";
+                break;
+            }
+            sa << " cycles_per_packet=" << mb->cycles;
+            if (mb->kernel == KERNEL_PUSH) {
+                sa << " baseline_cycles=" << mb->baseline_cycles;
+            } else if (mb->kernel == KERNEL_BITVECTOR) {
+                sa << " fixed_cycles=" << mb->fixed_cycles;
+            }
+            sa << " allocs_per_packet=";
+            if (mb->allocs < 0) {
+                sa << "-";
+            } else {
+                sa << mb->allocs;
+            }
+            break;
+        case H_CYCLES:
+            sa << mb->cycles;
+            break;
+        case H_ALLOCS:
+            if (mb->allocs < 0) {
+                sa << "-";
+            } else {
+                sa << mb->allocs;
+            }
+            break;
+        case H_PACKETS:
+            sa << mb->packets;
+            break;
+    }
+    return sa.take_string();
+}
+
+void BAMicroBench::add_handlers() {
+    add_read_handler("results", read_handler, (void *) H_RESULTS);
+    add_read_handler("cycles_per_packet", read_handler, (void *) H_CYCLES);
+    add_read_handler("allocations_per_packet", read_handler, (void *) H_ALLOCS);
+    add_read_handler("packets", read_handler, (void *) H_PACKETS);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(BAMicroBench)
+ELEMENT_REQUIRES(userlevel)
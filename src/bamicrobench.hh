@@ -0,0 +1,75 @@
+#ifndef BAMICROBENCH_HH_INCLUDED
+#define BAMICROBENCH_HH_INCLUDED
+
+#include "globalconf.hh"
+#include "bloomfilter.hh"
+#include <click/task.hh>
+#include <click/straccum.hh>
+
+CLICK_DECLS
+
+/**@brief Our proposal (User-Space only) a microbenchmark of the per-packet kernels of a Blackadder node.
+ *
+ * It runs once, when the router starts, and then stops the router (unless STOP false), so that a configuration is one measurement (see examples/benchmark/microbench.sh).
+ * KERNEL selects what is measured:
+ *
+ * push: PACKETS synthetic publications are pushed to output 0, e.g. into a Forwarder or a CacheUnit. A publication is FID_LEN bytes of FID (a binary string like the LIDs of the Forwarder),
+ * the number of IDs, IDS full identifiers of two fragments each and LENGTH bytes of data. ID_SPACE different publications are pushed in turn (e.g. to fill a cache with that many items).
+ * With ETHER true they start with an empty ethernet header, as the CacheUnit expects them. With SUBINFO true a backFID (the same FID) and a notification IID follow the IDs,
+ * so that they are subinfo requests (CacheUnit port 1). With WARMUP true every publication is pushed once to output 1, before the measurement, e.g. to CacheUnit port 2 to store the items that are then looked up.
+ * The cost of making the packets alone is measured first and reported as baseline_cycles.
+ *
+ * bitvector: the matching of the forwarding path, a FID against a table of IDS LIDs ((FID & LID) == LID, |= of the matches and zero()), with BABitvector (cycles_per_packet)
+ * and with FIDBitvector (fixed_cycles).
+ *
+ * bloom: BloomFilter::test of IDS identifiers (half of them in the filter) in a filter of BLOOM_BITS bits.
+ *
+ * The results handler reads one line of key=value results: the cycles per packet (or per operation group) and, when Click counts allocations (CLICK_DMALLOC), the allocations per packet.
+ */
+class BAMicroBench : public Element
+{
+public:
+    BAMicroBench() ;
+    ~BAMicroBench() ;
+    const char *class_name() const {return "BAMicroBench";}
+    /**@brief the push kernel sends its publications to output 0 and warms up through output 1*/
+    const char *port_count() const {return "0/0-2";}
+    const char *processing() const {return PUSH;}
+    int configure(Vector<String>&, ErrorHandler*) ;
+    int initialize(ErrorHandler *errh) ;
+    void cleanup(CleanupStage stage) ;
+    bool run_task(Task *t) ;
+    void add_handlers() ;
+    static String read_handler(Element *e, void *thunk) ;
+private:
+    enum {KERNEL_PUSH, KERNEL_BITVECTOR, KERNEL_BLOOM} ;
+    enum {H_RESULTS, H_CYCLES, H_ALLOCS, H_PACKETS} ;
+    void runPush() ;
+    void runBitvector() ;
+    void runBloom() ;
+    /**@brief a random identifier of fragments * PURSUIT_ID_LEN bytes*/
+    static String randomID(int fragments) ;
+    Task *_task ;
+    int kernel ;
+    uint32_t packets ;
+    uint32_t ids ;
+    uint32_t id_space ;
+    uint32_t length ;
+    uint32_t bloom_bits ;
+    bool ether ;
+    bool subinfo ;
+    bool warmup ;
+    bool stop ;
+    BABitvector fid ;
+    /**@brief the publications of the push kernel, one per ID_SPACE*/
+    Vector<Packet *> templates ;
+    /**@brief the results*/
+    double cycles ;
+    double baseline_cycles ;
+    double fixed_cycles ;
+    double allocs ;
+    bool done ;
+};
+
+CLICK_ENDDECLS
+#endif // BAMICROBENCH_HH_INCLUDED
@@ -2,18 +2,23 @@
 #define BLOOMFILTER_HH_INCLUDED
 
 #include "ba_bitvector.hh"
+#include "helper.hh"
 #include <click/string.hh>
+#include <click/vector.hh>
 #include <click/hashtable.hh>
 
 CLICK_DECLS
+/**@brief Our proposal a Bloom filter of identifiers with k hash functions (BF_HASHES unless given), working in place on the words of data.
+ * The k bit positions of an identifier come from double hashing (h1 + i*h2) of a 64-bit FNV-1a hash of all its bytes.
+ * Filters travel in packets and are tested by other nodes, so every node must use the same k*/
 class BloomFilter
 {
 public:
-    BloomFilter(): len_in_bytes(0), len_in_bits(0) {
+    BloomFilter(): len_in_bytes(0), len_in_bits(0), hashes(BF_HASHES) {
         BABitvector temp(0)  ;
         data = temp ;
     }
-    BloomFilter(int length)
+    BloomFilter(int length, int _hashes = BF_HASHES) : hashes(_hashes)
     {
         data.assign(length, false) ;
         len_in_bytes = length/8 ;
@@ -24,22 +29,53 @@ public:
     {
         data.zero() ;
     }
-    inline void add2bf(String str)
+    inline void add2bf(const String &str)
     {
-        BABitvector temp((int)len_in_bytes*8) ;
-        memcpy(temp._data, str.c_str(), len_in_bytes) ;
-        data = data | temp ;
+        if (len_in_bits == 0)
+            return ;
+        uint32_t h1, h2 ;
+        hash(str, h1, h2) ;
+        uint32_t *w = data._data ;
+        for (int i = 0 ; i < hashes ; i++)
+        {
+            uint32_t bit = (h1 + i * h2) % len_in_bits ;
+            w[bit >> 5] |= (1U << (bit & 31)) ;
+        }
     }
-    bool test(String str)
+    bool test(const String &str) const
     {
-        BABitvector temp((int)len_in_bytes*8) ;
-        memcpy(temp._data, str.c_str(), len_in_bytes) ;
-        BABitvector test((int)len_in_bytes*8) ;
-        test = temp & data ;
-        if(test == temp)
-            return true ;
-        else
+        if (len_in_bits == 0)
             return false ;
+        uint32_t h1, h2 ;
+        hash(str, h1, h2) ;
+        const uint32_t *w = data._data ;
+        for (int i = 0 ; i < hashes ; i++)
+        {
+            uint32_t bit = (h1 + i * h2) % len_in_bits ;
+            if (!(w[bit >> 5] & (1U << (bit & 31))))
+                return false ;
+        }
+        return true ;
+    }
+    /**@brief adds all identifiers of strs*/
+    void add2bf(const Vector<String> &strs)
+    {
+        for (int i = 0 ; i < strs.size() ; i++)
+            add2bf(strs[i]) ;
+    }
+    /**@brief appends to matches the identifiers of strs that the filter (probably) contains and returns how many they are*/
+    int test(const Vector<String> &strs, Vector<String> &matches) const
+    {
+        int n = 0 ;
+        for (int i = 0 ; i < strs.size() ; i++)
+        {
+            if (test(strs[i]))
+            {
+                matches.push_back(strs[i]) ;
+                n++ ;
+            }
+        }
+        return n ;
     }
     inline void resize(int bits)
     {
@@ -56,6 +92,22 @@ public:
     BABitvector data ;
     unsigned int len_in_bytes ;
     unsigned int len_in_bits ;
+    /**@brief the number of hash functions (k)*/
+    int hashes ;
+private:
+    static inline void hash(const String &str, uint32_t &h1, uint32_t &h2)
+    {
+        uint64_t h = 14695981039346656037ULL ;
+        const unsigned char *s = (const unsigned char *) str.data() ;
+        for (int i = 0 ; i < str.length() ; i++)
+        {
+            h ^= s[i] ;
+            h *= 1099511628211ULL ;
+        }
+        h1 = (uint32_t) h ;
+        /*odd, so that the k positions differ*/
+        h2 = (uint32_t) (h >> 32) | 1 ;
+    }
 };
 CLICK_ENDDECLS
 #endif // BLOOMFILTER_HH_INCLUDED
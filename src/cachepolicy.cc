@@ -0,0 +1,223 @@
+/*Our Proposal
+ *the eviction policies of the CacheUnit
+*/
+#include "cachepolicy.hh"
+
+CLICK_DECLS
+
+CachePolicy* CachePolicy::create(const String& name)
+{
+    if(name == "lru")
+        return new LRUPolicy() ;
+    else if(name == "lfu")
+        return new LFUPolicy() ;
+    else if(name == "gdsf")
+        return new GDSFPolicy() ;
+    return NULL ;
+}
+
+LFUPolicy::~LFUPolicy()
+{
+    while(head != NULL)
+    {
+        LFUBucket* next = head->next ;
+        delete head ;
+        head = next ;
+    }
+}
+
+void LFUPolicy::place(CacheItem* item, LFUBucket* after)
+{
+    LFUBucket* bucket = (after != NULL) ? after->next : head ;
+    if(bucket == NULL || bucket->hits != item->hits)
+    {
+        /*create the bucket for this hit count right after 'after'*/
+        LFUBucket* newbucket = new LFUBucket(item->hits) ;
+        newbucket->prev = after ;
+        newbucket->next = bucket ;
+        if(bucket != NULL)
+            bucket->prev = newbucket ;
+        if(after != NULL)
+            after->next = newbucket ;
+        else
+            head = newbucket ;
+        bucket = newbucket ;
+    }
+    bucket->items.push_front(item) ;
+    item->bucket = bucket ;
+}
+
+void LFUPolicy::unlink(LFUBucket* bucket)
+{
+    if(bucket->prev != NULL)
+        bucket->prev->next = bucket->next ;
+    else
+        head = bucket->next ;
+    if(bucket->next != NULL)
+        bucket->next->prev = bucket->prev ;
+    delete bucket ;
+}
+
+void LFUPolicy::insert(CacheItem* item)
+{
+    /*new items have the least hits, so their bucket is always the head (or right before it)*/
+    if(head != NULL && head->hits < item->hits)
+    {
+        LFUBucket* after = head ;
+        while(after->next != NULL && after->next->hits < item->hits)
+            after = after->next ;
+        place(item, after) ;
+    }
+    else
+    {
+        place(item, NULL) ;
+    }
+}
+
+void LFUPolicy::touch(CacheItem* item)
+{
+    LFUBucket* bucket = item->bucket ;
+    bucket->items.remove(item) ;
+    item->hits++ ;
+    place(item, bucket) ;
+    if(bucket->items.empty())
+        unlink(bucket) ;
+}
+
+void LFUPolicy::remove(CacheItem* item)
+{
+    LFUBucket* bucket = item->bucket ;
+    bucket->items.remove(item) ;
+    item->bucket = NULL ;
+    if(bucket->items.empty())
+        unlink(bucket) ;
+}
+
+void GDSFPolicy::swap(int i, int j)
+{
+    CacheItem* temp = heap[i] ;
+    heap[i] = heap[j] ;
+    heap[j] = temp ;
+    heap[i]->heap_index = i ;
+    heap[j]->heap_index = j ;
+}
+
+void GDSFPolicy::sift_up(int i)
+{
+    while(i > 0 && heap[(i - 1) / 2]->priority > heap[i]->priority)
+    {
+        swap(i, (i - 1) / 2) ;
+        i = (i - 1) / 2 ;
+    }
+}
+
+void GDSFPolicy::sift_down(int i)
+{
+    int size = heap.size() ;
+    while(true)
+    {
+        int smallest = i ;
+        int left = 2 * i + 1 ;
+        int right = 2 * i + 2 ;
+        if(left < size && heap[left]->priority < heap[smallest]->priority)
+            smallest = left ;
+        if(right < size && heap[right]->priority < heap[smallest]->priority)
+            smallest = right ;
+        if(smallest == i)
+            break ;
+        swap(i, smallest) ;
+        i = smallest ;
+    }
+}
+
+void GDSFPolicy::insert(CacheItem* item)
+{
+    update_priority(item) ;
+    item->heap_index = heap.size() ;
+    heap.push_back(item) ;
+    sift_up(item->heap_index) ;
+}
+
+void GDSFPolicy::touch(CacheItem* item)
+{
+    item->hits++ ;
+    update_priority(item) ;
+    /*the priority can only grow*/
+    sift_down(item->heap_index) ;
+}
+
+void GDSFPolicy::remove(CacheItem* item)
+{
+    int i = item->heap_index ;
+    swap(i, heap.size() - 1) ;
+    heap.pop_back() ;
+    item->heap_index = -1 ;
+    if(i < (int) heap.size())
+    {
+        sift_down(i) ;
+        sift_up(i) ;
+    }
+}
+
+void GDSFPolicy::evict(CacheItem* item)
+{
+    /*only an eviction ages the remaining items, an item that is replaced or deleted does not*/
+    L = item->priority ;
+    remove(item) ;
+}
+
+CacheItem* GDSFPolicy::victim()
+{
+    return heap.empty() ? NULL : heap[0] ;
+}
+
+void FrequencySketch::resize(unsigned int width)
+{
+    _width = (width > 0) ? width : 1 ;
+    counters.assign(FREQUENCY_SKETCH_DEPTH * _width, 0) ;
+    samples = 0 ;
+}
+
+inline unsigned int FrequencySketch::slot(const String& key, int row) const
+{
+    /*FNV-1a, one seed per row*/
+    uint32_t hash = 2166136261U ^ (uint32_t) (row * 0x9E3779B9U) ;
+    for(int i = 0 ; i < key.length() ; i++)
+        hash = (hash ^ (unsigned char) key[i]) * 16777619U ;
+    return row * _width + hash % _width ;
+}
+
+void FrequencySketch::increment(const String& key)
+{
+    unsigned int min = estimate(key) ;
+    /*conservative update: only the smallest counters grow*/
+    for(int row = 0 ; row < FREQUENCY_SKETCH_DEPTH ; row++)
+    {
+        unsigned char& counter = counters[slot(key, row)] ;
+        if(counter == min && counter < FREQUENCY_SKETCH_MAX)
+            counter++ ;
+    }
+    if(++samples >= 10 * _width)
+    {
+        for(int i = 0 ; i < counters.size() ; i++)
+            counters[i] >>= 1 ;
+        samples /= 2 ;
+    }
+}
+
+unsigned int FrequencySketch::estimate(const String& key) const
+{
+    unsigned int min = FREQUENCY_SKETCH_MAX ;
+    for(int row = 0 ; row < FREQUENCY_SKETCH_DEPTH ; row++)
+    {
+        unsigned int counter = counters[slot(key, row)] ;
+        if(counter < min)
+            min = counter ;
+    }
+    return min ;
+}
+
+CLICK_ENDDECLS
+
+ELEMENT_REQUIRES(userlevel)
+ELEMENT_PROVIDES(CachePolicy)
@@ -0,0 +1,231 @@
+#ifndef CACHEPOLICY_HH_INCLUDED
+#define CACHEPOLICY_HH_INCLUDED
+
+#include <click/config.h>
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <click/packet.hh>
+
+CLICK_DECLS
+
+class CacheEntry ;
+class LFUBucket ;
+
+/**@brief Our proposal one stored fragment of a fragmented publication: the fragment (its FragmentHeader and data) is at offset in packet*/
+struct CacheChunk
+{
+    Packet* packet ;
+    unsigned int offset ;
+    unsigned int length ;
+};
+
+/**@brief Our proposal one cached information item of a CacheEntry.
+ * The payload is not copied: the item holds a reference (a clone) to the Click packet it was received in, so the length is kept inline and the buffer is shared with the packet.
+ * A fragmented publication is stored per fragment instead (chunks, indexed by fragment number), so that an item may be only partially present.
+ * Besides the payload it carries the bookkeeping of the eviction policy, so that a touch on hit never allocates*/
+class CacheItem
+{
+public:
+    CacheItem(CacheEntry* _owner, String _IID, Packet* _packet, unsigned int _offset, unsigned int _length)
+    : IID(_IID), owner(_owner), packet(_packet), offset(_offset), length(_length), size(_packet->buffer_length()),\
+      msg_id(0), chunks_present(0), hits(1), prefetched(false), priority(0), prev(NULL), next(NULL), bucket(NULL), heap_index(-1) {}
+    /**@brief an empty chunked item for the count fragments of the publication msg_id (total_len bytes)*/
+    CacheItem(CacheEntry* _owner, String _IID, uint32_t _msg_id, unsigned int count, unsigned int total_len)
+    : IID(_IID), owner(_owner), packet(NULL), offset(0), length(total_len), size(0),\
+      msg_id(_msg_id), chunks_present(0), hits(1), prefetched(false), priority(0), prev(NULL), next(NULL), bucket(NULL), heap_index(-1)
+    {
+        CacheChunk empty = {NULL, 0, 0} ;
+        chunks.resize(count, empty) ;
+    }
+    ~CacheItem()
+    {
+        if(packet != NULL)
+            packet->kill() ;
+        for(int i = 0 ; i < chunks.size() ; i++)
+        {
+            if(chunks[i].packet != NULL)
+                chunks[i].packet->kill() ;
+        }
+    }
+    /**@brief the payload (of an item that is not chunked)*/
+    inline const unsigned char* data() const {return packet->data() + offset ;}
+    /**@brief true if the item is stored per fragment*/
+    inline bool chunked() const {return packet == NULL ;}
+    /**@brief true if all the payload is present*/
+    inline bool complete() const {return !chunked() || chunks_present == (unsigned int) chunks.size() ;}
+    /**@brief the information ID of this item*/
+    String IID ;
+    /**@brief the CacheEntry (scope) this item belongs to*/
+    CacheEntry* owner ;
+    /**@brief the packet holding the payload (owned by the item)*/
+    Packet* packet ;
+    /**@brief the offset of the payload in packet*/
+    unsigned int offset ;
+    /**@brief the payload length in bytes (the whole publication for a chunked item)*/
+    unsigned int length ;
+    /**@brief the memory the item occupies (the whole packet buffer, or the buffers of all present chunks), that is what counts against the cache capacity*/
+    unsigned int size ;
+    /**@brief the fragments of a chunked item (a NULL packet for a missing one)*/
+    Vector<CacheChunk> chunks ;
+    /**@brief the FragmentHeader msg_id of a chunked item*/
+    uint32_t msg_id ;
+    /**@brief the number of chunks present*/
+    unsigned int chunks_present ;
+    /**@brief the number of hits (including the insertion)*/
+    unsigned int hits ;
+    /**@brief true if the item was prefetched and has not been hit yet*/
+    bool prefetched ;
+    /**@brief GDSF priority*/
+    double priority ;
+    /**@brief LRU/LFU intrusive list pointers*/
+    CacheItem* prev ;
+    CacheItem* next ;
+    /**@brief LFU frequency bucket*/
+    LFUBucket* bucket ;
+    /**@brief GDSF heap position*/
+    int heap_index ;
+};
+
+/**@brief Our proposal an intrusive doubly linked list of CacheItem (head is the most recently used)*/
+class CacheItemList
+{
+public:
+    CacheItemList() : head(NULL), tail(NULL) {}
+    inline bool empty() const {return head == NULL ;}
+    inline void push_front(CacheItem* item)
+    {
+        item->prev = NULL ;
+        item->next = head ;
+        if(head != NULL)
+            head->prev = item ;
+        else
+            tail = item ;
+        head = item ;
+    }
+    inline void remove(CacheItem* item)
+    {
+        if(item->prev != NULL)
+            item->prev->next = item->next ;
+        else
+            head = item->next ;
+        if(item->next != NULL)
+            item->next->prev = item->prev ;
+        else
+            tail = item->prev ;
+        item->prev = item->next = NULL ;
+    }
+    CacheItem* head ;
+    CacheItem* tail ;
+};
+
+/**@brief Our proposal the eviction policy of the CacheUnit.
+ * The CacheUnit inserts every stored item, touches it on every hit, removes it when it is deleted and asks for a victim when it is over capacity (which it then evicts)*/
+class CachePolicy
+{
+public:
+    virtual ~CachePolicy() {}
+    virtual const char* name() const = 0 ;
+    virtual void insert(CacheItem* item) = 0 ;
+    virtual void touch(CacheItem* item) = 0 ;
+    virtual void remove(CacheItem* item) = 0 ;
+    /**@brief removes the victim that is being evicted, for the policies that age on eviction (remove by default)*/
+    virtual void evict(CacheItem* item) {remove(item) ;}
+    /**@brief returns the next item to evict (without removing it) or NULL if there are no items*/
+    virtual CacheItem* victim() = 0 ;
+    /**@brief returns a new policy by name (lru, lfu or gdsf) or NULL if the name is unknown*/
+    static CachePolicy* create(const String& name) ;
+};
+
+/**@brief Our proposal least recently used. O(1) insert, touch and evict*/
+class LRUPolicy : public CachePolicy
+{
+public:
+    const char* name() const {return "lru" ;}
+    void insert(CacheItem* item) {items.push_front(item) ;}
+    void touch(CacheItem* item) {items.remove(item) ; items.push_front(item) ;}
+    void remove(CacheItem* item) {items.remove(item) ;}
+    CacheItem* victim() {return items.tail ;}
+    CacheItemList items ;
+};
+
+/**@brief Our proposal a set of items with the same hit count (kept in LRU order)*/
+class LFUBucket
+{
+public:
+    LFUBucket(unsigned int _hits) : hits(_hits), prev(NULL), next(NULL) {}
+    unsigned int hits ;
+    CacheItemList items ;
+    LFUBucket* prev ;
+    LFUBucket* next ;
+};
+
+/**@brief Our proposal least frequently used (ties broken by LRU).
+ * Items live in a list of frequency buckets sorted by hit count, so insert, touch and evict are O(1)*/
+class LFUPolicy : public CachePolicy
+{
+public:
+    LFUPolicy() : head(NULL) {}
+    ~LFUPolicy() ;
+    const char* name() const {return "lfu" ;}
+    void insert(CacheItem* item) ;
+    void touch(CacheItem* item) ;
+    void remove(CacheItem* item) ;
+    CacheItem* victim() {return head != NULL ? head->items.tail : NULL ;}
+private:
+    /**@brief puts item to the bucket with item->hits after (or as the head if after is NULL)*/
+    void place(CacheItem* item, LFUBucket* after) ;
+    void unlink(LFUBucket* bucket) ;
+    /**@brief the bucket with the least hits*/
+    LFUBucket* head ;
+};
+
+/**@brief Our proposal Greedy-Dual-Size-Frequency: priority = L + hits / size, where L is the priority of the last victim.
+ * It favours small and popular items. Items are kept in a binary heap, so touch and evict are O(log n)*/
+class GDSFPolicy : public CachePolicy
+{
+public:
+    GDSFPolicy() : L(0) {}
+    const char* name() const {return "gdsf" ;}
+    void insert(CacheItem* item) ;
+    void touch(CacheItem* item) ;
+    void remove(CacheItem* item) ;
+    /**@brief ages all remaining items (L becomes the priority of item) and removes item*/
+    void evict(CacheItem* item) ;
+    CacheItem* victim() ;
+private:
+    inline void update_priority(CacheItem* item)
+    {
+        item->priority = L + (double)item->hits / (double)(item->size > 0 ? item->size : 1) ;
+    }
+    void sift_up(int i) ;
+    void sift_down(int i) ;
+    void swap(int i, int j) ;
+    double L ;
+    Vector<CacheItem*> heap ;
+};
+
+/**@brief Our proposal a TinyLFU frequency sketch: a count-min sketch of FREQUENCY_SKETCH_DEPTH rows of saturating counters.
+ * All counters are halved after 10 * width increments, so the estimates follow the recent popularity and one-hit wonders fade away*/
+#define FREQUENCY_SKETCH_DEPTH 4
+#define FREQUENCY_SKETCH_MAX 15
+class FrequencySketch
+{
+public:
+    FrequencySketch(unsigned int _width = 4096) {resize(_width) ;}
+    /**@brief clears the sketch and sets the number of counters per row*/
+    void resize(unsigned int _width) ;
+    /**@brief counts one access to key*/
+    void increment(const String& key) ;
+    /**@brief returns the estimated number of recent accesses to key (at most FREQUENCY_SKETCH_MAX)*/
+    unsigned int estimate(const String& key) const ;
+    inline unsigned int width() const {return _width ;}
+private:
+    /**@brief the counter of key in row*/
+    inline unsigned int slot(const String& key, int row) const ;
+    Vector<unsigned char> counters ;
+    unsigned int _width ;
+    unsigned int samples ;
+};
+
+CLICK_ENDDECLS
+#endif // CACHEPOLICY_HH_INCLUDED
@@ -2,86 +2,107 @@
  *This is the element that manipulate cache mechanism
 */
 #include "cacheunit.hh"
+#include "trace.hh"
+#include "baheader.hh"
+
+#include <click/straccum.hh>
 
 CLICK_DECLS
 
-bool CacheEntry::matchIID(Vector<String>& fullIDs)
-{
-    String IID ;
-    IID = fullIDs[0].substring(fullIDs[0].length() - PURSUIT_ID_LEN, PURSUIT_ID_LEN) ;//get the information ID
-    String tempSID ;
-    Vector<String> forSIDupdate ;
-    Vector<String>::iterator input_iter ;
-    Vector<String>::iterator SIDs_iter ;
-    Vector<String>::iterator IID_iter ;
-    bool ret = false ;
-    bool updateSID = false ;
-    for( input_iter = fullIDs.begin() ; input_iter != fullIDs.end() ; input_iter++)//for each input ID
-    {
-        tempSID = input_iter->substring(0, input_iter->length()-PURSUIT_ID_LEN) ;//get the Scope ID
-        forSIDupdate.push_back(tempSID) ;
-        for(SIDs_iter = SIDs.begin() ; SIDs_iter != SIDs.end() ; SIDs_iter++)//for each local cache Scope ID
-        {
-            if(!(tempSID.compare(*SIDs_iter)))
-            {
-                updateSID = true ;
-                for(IID_iter = IIDs.begin() ; IID_iter != IIDs.end() ; IID_iter++)
-                {
-                    if( !(IID.compare(*IID_iter)))
-                        ret = true ;
-                }
-            }
-        }
-    }
-    if(updateSID == true)
-        SIDs = forSIDupdate ;
-    return ret ;
-}
+enum {H_SIZE, H_CAPACITY, H_ITEMS, H_ENTRIES, H_HITS, H_PARTIAL_HITS, H_MISSES, H_INSERTIONS, H_EVICTIONS, H_REJECTIONS, H_AGGREGATED, H_FANNED_OUT, H_RELEASED, H_PREFETCH, H_PREFETCH_REQUESTS, H_PREFETCH_HITS,
+     H_PREFETCH_WASTED_BYTES, H_DISK_SIZE, H_DISK_CAPACITY, H_DISK_ITEMS, H_DISK_HITS, H_DEMOTIONS, H_PROMOTIONS,
+     H_DISK_OVERWRITES, H_POLICY, H_ADMISSION, H_POPULARITY, H_MEMORY, H_MEMORY_SCOPES, H_RESET_STATS} ;
 
-bool CacheEntry::matchSID(String SID)
+void CacheEntry::addItem(CacheItem* item)
 {
-    Vector<String>::iterator sid_iter ;
-    for(sid_iter = SIDs.begin() ; sid_iter != SIDs.end() ; sid_iter++)
-    {
-        if(!(SID.compare(*sid_iter)))
-        {
-            return true ;
-        }
-    }
-    return false ;
+    IIDs.push_back(item->IID) ;
+    items.set(item->IID, item) ;
+    total_len += item->size ;
 }
-bool CacheEntry::matchSID(Vector<String> _SIDs)
+
+void CacheEntry::removeItem(CacheItem* item)
 {
-    Vector<String>::iterator sid_iter ;
-    bool ret = false ;
-    for(sid_iter = SIDs.begin() ; sid_iter != SIDs.end() ; sid_iter++)
+    for(Vector<String>::iterator iid_iter = IIDs.begin() ; iid_iter != IIDs.end() ; iid_iter++)
     {
-        for(Vector<String>::iterator _sid_iter = _SIDs.begin() ; _sid_iter != _SIDs.end() ; _sid_iter++)
-        if(!(_sid_iter->compare(*sid_iter)))
+        if(*iid_iter == item->IID)
         {
-            ret = true ;
+            IIDs.erase(iid_iter) ;
             break ;
         }
     }
-    if(ret)
-        SIDs = _SIDs ;
-    return ret ;
+    items.erase(item->IID) ;
+    total_len -= item->size ;
 }
 
-
-CacheUnit::CacheUnit(){}
+CacheUnit::CacheUnit() : interest_timer(this) {policy = NULL ; disk = NULL ;}
 CacheUnit::~CacheUnit(){click_chatter("CacheUnit: destroyed!");}
 
 int CacheUnit::configure(Vector<String> &conf, ErrorHandler *errh)
 {
-    gc = (GlobalConf*) cp_element(conf[0], this) ;
+    Element* gc_element ;
+    Element* queue_element = NULL ;
+    unsigned int sketch_width = 4096 ;
+    cache_size = 1024*1024*50 ; //50MB
+    aggregate_window = 0 ;
+    prefetch_depth = 0 ;
+    disk_capacity = 1024*1024*1024 ; //1GB
+    policy_name = String("lru") ;
+    admission = false ;
+    if (cp_va_kparse(conf, this, errh,
+            "GLOBALCONF", cpkP+cpkM, cpElement, &gc_element,
+            "CAPACITY", 0, cpUnsigned, &cache_size,
+            "POLICY", 0, cpWord, &policy_name,
+            "ADMISSION", 0, cpBool, &admission,
+            "SKETCH_WIDTH", 0, cpUnsigned, &sketch_width,
+            "QUEUE", 0, cpElement, &queue_element,
+            "AGGREGATE", 0, cpUnsigned, &aggregate_window,
+            "PREFETCH", 0, cpUnsigned, &prefetch_depth,
+            "DISK_FILE", 0, cpFilename, &disk_file,
+            "DISK_CAPACITY", 0, cpUnsigned64, &disk_capacity,
+            cpEnd) < 0) {
+        return -1;
+    }
+    queue = NULL ;
+    if(queue_element != NULL && (queue = (Storage*) queue_element->cast("Storage")) == NULL)
+    {
+        return errh->error("QUEUE %s is not a queue", queue_element->name().c_str()) ;
+    }
+    sketch.resize(sketch_width) ;
+    gc = (GlobalConf*) gc_element ;
+    /*every offset below starts after the link header (ethernet in MAC mode, IP and UDP in IP mode)*/
+    link_len = LinkHeader::length(gc->use_mac) ;
+    policy = CachePolicy::create(policy_name) ;
+    if(policy == NULL)
+    {
+        errh->fatal("unknown cache POLICY %s (lru, lfu or gdsf)", policy_name.c_str()) ;
+        return -1 ;
+    }
+    click_chatter("CacheUnit: capacity %u bytes, %s eviction%s", cache_size, policy->name(), admission ? ", TinyLFU admission" : "") ;
     return 0 ;
 }
 int CacheUnit::initialize(ErrorHandler *errh)
 {
-    cache_size = 1024*1024*50 ; //50MB
     current_size = 0 ;
-    cache.clear() ;
+    number_of_entries = 0 ;
+    number_of_items = 0 ;
+    hits = partial_hits = misses = insertions = evictions = rejections = 0 ;
+    aggregated = fanned_out = released = 0 ;
+    prefetch_requests = prefetch_hits = prefetch_wasted_bytes = 0 ;
+    disk_hits = 0 ;
+    interest_timer.initialize(this) ;
+    load_window = Timestamp::now().sec() ;
+    window_requests = window_hits = last_requests = 0 ;
+    last_hit_rate = 100 ;
+    sidIndex.clear() ;
+    if(disk_file.length() > 0)
+    {
+        disk = new DiskTier() ;
+        int fd = disk->open(disk_file, disk_capacity, errh) ;
+        if(fd < 0)
+            return -1 ;
+        add_select(fd, SELECT_READ) ;
+        click_chatter("CacheUnit: disk tier of %llu bytes in %s", (unsigned long long) disk->capacity, disk_file.c_str()) ;
+    }
     return 0 ;
 }
 void CacheUnit::cleanup(CleanupStage stage)
@@ -89,22 +110,186 @@ void CacheUnit::cleanup(CleanupStage stage)
 
     if(stage >= CLEANUP_CONFIGURED)
     {
-        for(int i = 0 ; i < cache.size() ; i++)
+        /*removing the last item of an entry deletes the entry too*/
+        CacheItem* item ;
+        if(disk != NULL)
+        {
+            /*the requests that wait for promotions are dropped*/
+            delete disk ;
+            disk = NULL ;
+        }
+        while((item = policy->victim()) != NULL)
+        {
+            removeItem(item) ;
+        }
+        sidIndex.clear() ;
+        delete policy ;
+        policy = NULL ;
+        for(HashTable<String, PendingInterest*>::iterator it = interests.begin() ; it != interests.end() ; it++)
+        {
+            for(int i = 0 ; i < it.value()->held.size() ; i++)
+                it.value()->held[i]->kill() ;
+            delete it.value() ;
+        }
+        interests.clear() ;
+        for(HashTable<String, PrefetchStream*>::iterator it = streams.begin() ; it != streams.end() ; it++)
+            delete it.value() ;
+        streams.clear() ;
+        prefetching.clear() ;
+    }
+}
+
+String CacheUnit::read_handler(Element *e, void *thunk)
+{
+    CacheUnit* cu = (CacheUnit*) e ;
+    switch ((intptr_t) thunk)
+    {
+        case H_SIZE:
+            return String(cu->current_size) ;
+        case H_CAPACITY:
+            return String(cu->cache_size) ;
+        case H_ITEMS:
+            return String(cu->number_of_items) ;
+        case H_ENTRIES:
+            return String(cu->number_of_entries) ;
+        case H_HITS:
+            return String(cu->hits) ;
+        case H_PARTIAL_HITS:
+            return String(cu->partial_hits) ;
+        case H_MISSES:
+            return String(cu->misses) ;
+        case H_INSERTIONS:
+            return String(cu->insertions) ;
+        case H_EVICTIONS:
+            return String(cu->evictions) ;
+        case H_REJECTIONS:
+            return String(cu->rejections) ;
+        case H_AGGREGATED:
+            return String(cu->aggregated) ;
+        case H_FANNED_OUT:
+            return String(cu->fanned_out) ;
+        case H_RELEASED:
+            return String(cu->released) ;
+        case H_PREFETCH:
+            return String(cu->prefetch_depth) ;
+        case H_PREFETCH_REQUESTS:
+            return String(cu->prefetch_requests) ;
+        case H_PREFETCH_HITS:
+            return String(cu->prefetch_hits) ;
+        case H_PREFETCH_WASTED_BYTES:
+            return String(cu->prefetch_wasted_bytes) ;
+        case H_DISK_SIZE:
+            return String(cu->disk != NULL ? cu->disk->live_bytes : 0) ;
+        case H_DISK_CAPACITY:
+            return String(cu->disk != NULL ? cu->disk->capacity : 0) ;
+        case H_DISK_ITEMS:
+            return String(cu->disk != NULL ? cu->disk->live_records : 0) ;
+        case H_DISK_HITS:
+            return String(cu->disk_hits) ;
+        case H_DEMOTIONS:
+            return String(cu->disk != NULL ? cu->disk->demotions : 0) ;
+        case H_PROMOTIONS:
+            return String(cu->disk != NULL ? cu->disk->promotions : 0) ;
+        case H_DISK_OVERWRITES:
+            return String(cu->disk != NULL ? cu->disk->overwrites : 0) ;
+        case H_POLICY:
+            return String(cu->policy->name()) ;
+        case H_ADMISSION:
+            return String(cu->admission) ;
+        case H_POPULARITY:
+            return cu->popularity() ;
+        case H_MEMORY:
+        case H_MEMORY_SCOPES:
         {
-            CacheEntry* ce = cache.at(i) ;
-            ce->clean() ;
-            delete ce ;
+            MemReport report ;
+            cu->memoryReport(report) ;
+            return ((intptr_t) thunk == H_MEMORY) ? report.totals() : report.scopes() ;
         }
+        default:
+            return String() ;
     }
 }
+
+int CacheUnit::write_handler(const String &str, Element *e, void *thunk, ErrorHandler *errh)
+{
+    CacheUnit* cu = (CacheUnit*) e ;
+    switch ((intptr_t) thunk)
+    {
+        case H_CAPACITY:
+        {
+            unsigned int capacity ;
+            if(!cp_integer(cp_uncomment(str), &capacity))
+                return errh->error("capacity must be an unsigned integer (bytes)") ;
+            cu->cache_size = capacity ;
+            cu->evictItems() ;
+            return 0 ;
+        }
+        case H_PREFETCH:
+            if(!cp_integer(cp_uncomment(str), &cu->prefetch_depth))
+                return errh->error("prefetch must be an unsigned integer (items)") ;
+            return 0 ;
+        case H_ADMISSION:
+            if(!cp_bool(cp_uncomment(str), &cu->admission))
+                return errh->error("admission must be true or false") ;
+            return 0 ;
+        case H_RESET_STATS:
+            cu->hits = cu->partial_hits = cu->misses = cu->insertions = cu->evictions = cu->rejections = 0 ;
+            cu->aggregated = cu->fanned_out = cu->released = 0 ;
+            cu->prefetch_requests = cu->prefetch_hits = cu->prefetch_wasted_bytes = 0 ;
+            cu->disk_hits = 0 ;
+            if(cu->disk != NULL)
+                cu->disk->demotions = cu->disk->promotions = cu->disk->overwrites = 0 ;
+            return 0 ;
+        default:
+            return -1 ;
+    }
+}
+
+void CacheUnit::add_handlers()
+{
+    add_read_handler("size", read_handler, (void *) H_SIZE) ;
+    add_read_handler("capacity", read_handler, (void *) H_CAPACITY) ;
+    add_read_handler("items", read_handler, (void *) H_ITEMS) ;
+    add_read_handler("entries", read_handler, (void *) H_ENTRIES) ;
+    add_read_handler("hits", read_handler, (void *) H_HITS) ;
+    add_read_handler("partial_hits", read_handler, (void *) H_PARTIAL_HITS) ;
+    add_read_handler("misses", read_handler, (void *) H_MISSES) ;
+    add_read_handler("insertions", read_handler, (void *) H_INSERTIONS) ;
+    add_read_handler("evictions", read_handler, (void *) H_EVICTIONS) ;
+    add_read_handler("rejections", read_handler, (void *) H_REJECTIONS) ;
+    add_read_handler("aggregated", read_handler, (void *) H_AGGREGATED) ;
+    add_read_handler("fanned_out", read_handler, (void *) H_FANNED_OUT) ;
+    add_read_handler("released", read_handler, (void *) H_RELEASED) ;
+    add_read_handler("prefetch", read_handler, (void *) H_PREFETCH) ;
+    add_read_handler("prefetch_requests", read_handler, (void *) H_PREFETCH_REQUESTS) ;
+    add_read_handler("prefetch_hits", read_handler, (void *) H_PREFETCH_HITS) ;
+    add_read_handler("prefetch_wasted_bytes", read_handler, (void *) H_PREFETCH_WASTED_BYTES) ;
+    add_read_handler("disk_size", read_handler, (void *) H_DISK_SIZE) ;
+    add_read_handler("disk_capacity", read_handler, (void *) H_DISK_CAPACITY) ;
+    add_read_handler("disk_items", read_handler, (void *) H_DISK_ITEMS) ;
+    add_read_handler("disk_hits", read_handler, (void *) H_DISK_HITS) ;
+    add_read_handler("demotions", read_handler, (void *) H_DEMOTIONS) ;
+    add_read_handler("promotions", read_handler, (void *) H_PROMOTIONS) ;
+    add_read_handler("disk_overwrites", read_handler, (void *) H_DISK_OVERWRITES) ;
+    add_read_handler("policy", read_handler, (void *) H_POLICY) ;
+    add_read_handler("admission", read_handler, (void *) H_ADMISSION) ;
+    add_read_handler("popularity", read_handler, (void *) H_POPULARITY) ;
+    add_read_handler("memory", read_handler, (void *) H_MEMORY) ;
+    add_read_handler("memory_scopes", read_handler, (void *) H_MEMORY_SCOPES) ;
+    add_write_handler("capacity", write_handler, (void *) H_CAPACITY) ;
+    add_write_handler("prefetch", write_handler, (void *) H_PREFETCH) ;
+    add_write_handler("admission", write_handler, (void *) H_ADMISSION) ;
+    add_write_handler("reset_stats", write_handler, (void *) H_RESET_STATS) ;
+}
 void CacheUnit::push(int port, Packet *p)
 {
-    BABitvector FID(FID_LEN*8) ;
+    FIDBitvector FID;
     unsigned char numberOfIDs ;
     unsigned char IDLength /*in fragments of PURSUIT_ID_LEN each*/;
     unsigned char prefixIDLength /*in fragments of PURSUIT_ID_LEN each*/ ;
     Vector<String> IDs;
-    Vector<CacheEntry*>::iterator cache_iter ;
+    BAHeader hdr ;
+    CacheEntry* ce ;
     int index = 0 ;
     if(port == 0)//this is a probing message
     {
@@ -116,133 +301,133 @@ void CacheUnit::push(int port, Packet *p)
         unsigned char origin ;
         int i = 0 ;
         IIDs.clear() ;
-        if (gc->use_mac) {
-            memcpy(FID._data, p->data() + 14, FID_LEN);
-        } else {
-            return ;//right now only support ethernet level
-        }
-        memcpy(&numberOfIDs, p->data()+14+FID_LEN, sizeof(numberOfIDs)) ;//# of IDs
-        for (int i = 0; i < (int) numberOfIDs; i++) {
-            IDLength = *(p->data()+14+FID_LEN+sizeof(numberOfIDs)+index);
-            IDs.push_back(String((const char *) (p->data()+14+FID_LEN+sizeof(numberOfIDs)+sizeof(IDLength)+index),\
-                                IDLength * PURSUIT_ID_LEN));
-            index = index + sizeof (IDLength) + IDLength * PURSUIT_ID_LEN;
-        }
-        memcpy(&hop_count, p->data()+14+FID_LEN+sizeof(numberOfIDs)+index+FID_LEN, sizeof(hop_count)) ;//assign hop_count
-        memcpy(&origin, p->data()+14+FID_LEN+sizeof(numberOfIDs)+index+FID_LEN+sizeof(hop_count)+FID_LEN, sizeof(origin)) ;
+        memcpy(FID._data, p->data() + link_len, FID_LEN);
+        memcpy(&numberOfIDs, p->data()+link_len+FID_LEN, sizeof(numberOfIDs)) ;//# of IDs
+        if (!hdr.parse(p, link_len+FID_LEN)) {
+            p->kill();
+            return;
+        }
+        index = hdr.length() - sizeof (numberOfIDs);
+        if(hdr.size() == 0)
+        {
+            p->kill() ;
+            return ;
+        }
+        /*the identifiers are looked up in place: a probe passes every cache on the path and is seldom answered*/
+        sketch.increment(hdr.id_span(0)) ;
+        memcpy(&hop_count, p->data()+link_len+FID_LEN+sizeof(numberOfIDs)+index+FID_LEN, sizeof(hop_count)) ;//assign hop_count
+        memcpy(&origin, p->data()+link_len+FID_LEN+sizeof(numberOfIDs)+index+FID_LEN+sizeof(hop_count)+FID_LEN, sizeof(origin)) ;
+        /*an item on disk is served too, once it is promoted*/
+        bool cached = lookupItem(hdr) != NULL || (disk != NULL && lookupDisk(hdr) != NULL) ;
+        /*the spans of hdr are not valid past uniqueify*/
         WritablePacket* packet = p->uniqueify() ;
 
-        for(cache_iter = cache.begin() ; cache_iter != cache.end() ; cache_iter++)
+        if(cached)
         {
-            if((*cache_iter)->matchIID(IDs))
+            unsigned int load_offset = link_len+FID_LEN+sizeof(numberOfIDs)+index+FID_LEN+sizeof(hop_count)+FID_LEN+sizeof(origin)+sizeof(int)/*number of pub*/+\
+                    2*PURSUIT_ID_LEN/*pub notificationIID*/ ;
+            hop_count = 0 ;//start from 0
+            origin = 1 ;//origin is cache
+            memcpy(packet->data()+link_len+FID_LEN+sizeof(numberOfIDs)+index+FID_LEN, &hop_count, sizeof(hop_count)) ;
+            memcpy(packet->data()+link_len+FID_LEN+sizeof(numberOfIDs)+index+FID_LEN+sizeof(hop_count), gc->iLID._data, FID_LEN) ;
+            memcpy(packet->data()+link_len+FID_LEN+sizeof(numberOfIDs)+index+FID_LEN+sizeof(hop_count)+FID_LEN, &origin, sizeof(origin)) ;
+            if(packet->length() >= load_offset + sizeof(ProbingLoad))
             {
-                hop_count = 0 ;//start from 0
-                origin = 1 ;//origin is cache
-                memcpy(packet->data()+14+FID_LEN+sizeof(numberOfIDs)+index+FID_LEN, &hop_count, sizeof(hop_count)) ;
-                memcpy(packet->data()+14+FID_LEN+sizeof(numberOfIDs)+index+FID_LEN+sizeof(hop_count), gc->iLID._data, FID_LEN) ;
-                memcpy(packet->data()+14+FID_LEN+sizeof(numberOfIDs)+index+FID_LEN+sizeof(hop_count)+FID_LEN, &origin, sizeof(origin)) ;
-                packet->set_anno_u32(0, (uint32_t)(index+sizeof(numberOfIDs)+FID_LEN+14)) ;
-                output(0).push(packet) ;
-                return ;
+                /*let the subscribers weigh our load against the distance*/
+                ProbingLoad load ;
+                fillLoad(load) ;
+                memcpy(packet->data()+load_offset, &load, sizeof(load)) ;
             }
+            packet->set_anno_u32(0, (uint32_t)(index+sizeof(numberOfIDs)+FID_LEN+link_len)) ;
+            output(0).push(packet) ;
+            return ;
         }
         hop_count++ ;
-        memcpy(packet->data()+14+FID_LEN+sizeof(numberOfIDs)+index+FID_LEN, &hop_count, sizeof(hop_count)) ;
-        packet->set_anno_u32(0, (uint32_t)(index+sizeof(numberOfIDs)+FID_LEN+14)) ;
+        memcpy(packet->data()+link_len+FID_LEN+sizeof(numberOfIDs)+index+FID_LEN, &hop_count, sizeof(hop_count)) ;
+        packet->set_anno_u32(0, (uint32_t)(index+sizeof(numberOfIDs)+FID_LEN+link_len)) ;
         output(0).push(packet) ;
     }
     else if(port == 1)
     {
         /*this is a subinfo packet*/
-        memcpy(FID._data, p->data()+14, FID_LEN) ;
-        BABitvector testFID(FID_LEN*8) ;
-        testFID = FID & gc->iLID ;
-        if(testFID == gc->iLID)
+        memcpy(FID._data, p->data()+link_len, FID_LEN) ;
+        if(FID.contains(gc->iLID))
         {
             bool cachefound = false ;
-            BABitvector backFID(FID_LEN*8) ;
-            memcpy(&numberOfIDs, p->data()+14+FID_LEN, sizeof(numberOfIDs)) ;//# of IDs
-            for (int i = 0; i < (int) numberOfIDs; i++) {
-                IDLength = *(p->data()+14+FID_LEN+sizeof(numberOfIDs)+index);
-                IDs.push_back(String((const char *) (p->data()+14+FID_LEN+sizeof(numberOfIDs)+sizeof(IDLength)+index),\
-                                    IDLength * PURSUIT_ID_LEN));
-                index = index + sizeof (IDLength) + IDLength * PURSUIT_ID_LEN;
+            FIDBitvector backFID;
+            memcpy(&numberOfIDs, p->data()+link_len+FID_LEN, sizeof(numberOfIDs)) ;//# of IDs
+            if (!hdr.parse(p, link_len+FID_LEN)) {
+                p->kill();
+                return;
             }
-            memcpy(backFID._data, p->data()+14+FID_LEN+sizeof(numberOfIDs)+index, FID_LEN) ;
+            hdr.ids(IDs);
+            index = hdr.length() - sizeof (numberOfIDs);
+            sketch.increment(IDs[0]) ;
+            memcpy(backFID._data, p->data()+link_len+FID_LEN+sizeof(numberOfIDs)+index, FID_LEN) ;
+            String notificationIID = String((const char*)(p->data()+link_len+FID_LEN+sizeof(numberOfIDs)+index+FID_LEN), 2*PURSUIT_ID_LEN) ;
 
-            for(cache_iter = cache.begin() ; cache_iter != cache.end() ; cache_iter++)
+            ce = lookupItem(IDs) ;
+            DiskRecord* record ;
+            if(ce == NULL && disk != NULL && (record = lookupDisk(IDs)) != NULL)
             {
-                if((*cache_iter)->matchIID(IDs))
-                {//local cache found
-                    cachefound = true ;
-                    int reverse_proto ;
-                    int prototype ;
-                    cp_integer(String("0x080d"), 16, &reverse_proto);
-                    prototype = htons(reverse_proto);
-                    WritablePacket* packet ;
-
-                    String infoID = IDs[0].substring(IDs[0].length()-PURSUIT_ID_LEN, PURSUIT_ID_LEN) ;
-                    if((*cache_iter)->_data_length[infoID] > FID_LEN+2*PURSUIT_ID_LEN)
-                        packet = p->put((*cache_iter)->_data_length[infoID] - (FID_LEN+2*PURSUIT_ID_LEN)) ;
-                    else
-                    {
-                        p->take((FID_LEN+2*PURSUIT_ID_LEN) - ((*cache_iter)->_data_length[infoID])) ;
-                        packet = p->uniqueify() ;
-                    }
-
-                    memcpy(packet->data()+12, &prototype, 2) ;
-                    memcpy(packet->data()+14, backFID._data, FID_LEN) ;
-                    memcpy(packet->data()+14+FID_LEN+sizeof(numberOfIDs)+index, (*cache_iter)->_data[infoID],\
-                           (*cache_iter)->_data_length[infoID]) ;
-                    output(1).push(packet) ;
-                    break ;
-                }
+                /*the request is handled again when the item is back in memory*/
+                disk_hits++ ;
+                BA_TRACE(TRACE_CACHE, TRACE_DEBUG, "disk hit for %s", IDs[0].quoted_hex().c_str()) ;
+                disk->promote(record, p) ;
+                if(prefetch_depth > 0)
+                    prefetch(FID, IDs, notificationIID, backFID) ;
+                return ;
             }
-            if(!cachefound)
-            {//if get here, it means that the local cache has been flushed, so the forwarder must redirect the xubinfo
-            //request to the final publisher
-
-                unsigned char type = PLEASE_PUSH_DATA ;
-                unsigned char idno = 1 ;
-                unsigned char iidlen = 2 ;
-                String notificationIID ;
-                Vector<String>::iterator vec_str_iter ;
-                int total_ID_length = 0 ;
-                int packet_len ;
-                int IDindex = 0 ;
+            accountRequest(ce != NULL) ;
+            if(ce != NULL)
+            {//local cache found
+                cachefound = true ;
                 WritablePacket* packet ;
 
-                notificationIID = String((const char*)(p->data()+14+FID_LEN+sizeof(numberOfIDs)+index+FID_LEN),\
-                                         iidlen*PURSUIT_ID_LEN) ;
-                for( vec_str_iter = IDs.begin() ; vec_str_iter != IDs.end() ; vec_str_iter++)
+                String infoID = IDs[0].substring(IDs[0].length()-PURSUIT_ID_LEN, PURSUIT_ID_LEN) ;
+                CacheItem* item = ce->getItem(infoID) ;
+                hit(item) ;
+                /*the reply is the request header followed by the cached payload, built in a single exactly sized packet
+                 *(the request is not resized, so its buffer is never reallocated or copied)*/
+                if(!item->chunked())
                 {
-                    total_ID_length += vec_str_iter->length() ;
+                    packet = makeDataPacket(p->data(), link_len+FID_LEN+sizeof(numberOfIDs)+index, item) ;
+                    LinkHeader::set_class(packet, FW_ETHER_DATAPUSH, gc->use_mac) ;
+                    memcpy(packet->data()+link_len, backFID._data, FID_LEN) ;
+                    output(1).push(packet) ;
                 }
-                packet_len = FID_LEN/*FID to pub*/+sizeof(idno)+sizeof(iidlen)+iidlen*PURSUIT_ID_LEN/*the previous segments are RVnotification header*/+\
-                sizeof(type)/*type*/+sizeof(numberOfIDs)/*numberofID*/+numberOfIDs*sizeof(IDLength)/*number of fragment*/+\
-                total_ID_length/*IDs*/+FID_LEN/*for data push*/ ;
-                packet = Packet::make(packet_len) ;
-                memcpy(packet->data(), FID._data, FID_LEN) ;
-                memcpy(packet->data()+FID_LEN, &idno, sizeof(idno)) ;
-                memcpy(packet->data()+FID_LEN+sizeof(idno), &iidlen, sizeof(iidlen)) ;
-                memcpy(packet->data()+FID_LEN+sizeof(idno)+sizeof(iidlen), notificationIID.c_str(), iidlen*PURSUIT_ID_LEN) ;
-                memcpy(packet->data()+FID_LEN+sizeof(idno)+sizeof(iidlen)+iidlen*PURSUIT_ID_LEN, &type, sizeof(type)) ;
-                memcpy(packet->data()+FID_LEN+sizeof(idno)+sizeof(iidlen)+iidlen*PURSUIT_ID_LEN+sizeof(type),\
-                       &numberOfIDs, sizeof(numberOfIDs)) ;
-                for( vec_str_iter = IDs.begin() ; vec_str_iter != IDs.end() ;vec_str_iter++)//ID length ID
+                else
                 {
-                    IDLength = vec_str_iter->length()/PURSUIT_ID_LEN ;
-                    memcpy(packet->data()+FID_LEN+sizeof(idno)+sizeof(iidlen)+iidlen*PURSUIT_ID_LEN+\
-                           sizeof(type)+sizeof(numberOfIDs)+IDindex, &IDLength, sizeof(IDLength)) ;
-                    memcpy(packet->data()+FID_LEN+sizeof(idno)+sizeof(iidlen)+iidlen*PURSUIT_ID_LEN+\
-                           sizeof(type)+sizeof(numberOfIDs)+IDindex+sizeof(IDLength), vec_str_iter->c_str(),\
-                           vec_str_iter->length()) ;
-                    IDindex += sizeof(IDLength)+vec_str_iter->length() ;
+                    /*serve the fragments we have and ask the publisher only for the others*/
+                    for(int i = 0 ; i < item->chunks.size() ; i++)
+                    {
+                        if(item->chunks[i].packet == NULL)
+                            continue ;
+                        packet = makeDataPacket(p->data(), link_len+FID_LEN+sizeof(numberOfIDs)+index, item->chunks[i]) ;
+                        LinkHeader::set_class(packet, FW_ETHER_DATAPUSH, gc->use_mac) ;
+                        memcpy(packet->data()+link_len, backFID._data, FID_LEN) ;
+                        output(1).push(packet) ;
+                    }
+                    if(!item->complete())
+                    {
+                        partial_hits++ ;
+                        BA_TRACE(TRACE_CACHE, TRACE_DEBUG, "partial hit for %s (%u of %d fragments)", IDs[0].quoted_hex().c_str(),\
+                                 item->chunks_present, item->chunks.size()) ;
+                        requestData(FID, IDs, notificationIID, backFID, item) ;
+                    }
                 }
-                memcpy(packet->data()+FID_LEN+sizeof(idno)+sizeof(type)+sizeof(numberOfIDs)+IDindex,\
-                       backFID._data, FID_LEN) ;
-                output(2).push(packet) ;
+                p->kill() ;
             }
+            if(!cachefound)
+            {//if get here, it means that the local cache has been flushed, so the forwarder must redirect the xubinfo
+            //request to the final publisher
+                misses++ ;
+                BA_TRACE(TRACE_CACHE, TRACE_DEBUG, "miss for %s", IDs[0].quoted_hex().c_str()) ;
+                requestData(FID, IDs, notificationIID, backFID, NULL) ;
+                p->kill() ;
+            }
+            if(prefetch_depth > 0)
+                prefetch(FID, IDs, notificationIID, backFID) ;
         }
         else
         {
@@ -254,53 +439,46 @@ void CacheUnit::push(int port, Packet *p)
         Vector<String> IIDs ;
         int i = 0 ;
         bool cachefound = false ;
-        char* data ;
         unsigned int datalen ;
         IIDs.clear() ;
-        if (gc->use_mac) {
-            memcpy(FID._data, p->data() + 14, FID_LEN);
-        } else {
-            return ;//right now only support ethernet level
-        }
-        memcpy(&numberOfIDs, p->data()+14+FID_LEN, sizeof(numberOfIDs)) ;//# of IDs
-        for (int i = 0; i < (int) numberOfIDs; i++) {
-            IDLength = *(p->data()+14+FID_LEN+sizeof(numberOfIDs)+index);
-            IDs.push_back(String((const char *) (p->data()+14+FID_LEN+sizeof(numberOfIDs)+sizeof(IDLength)+index),\
-                                IDLength * PURSUIT_ID_LEN));
-            index = index + sizeof (IDLength) + IDLength * PURSUIT_ID_LEN;
-        }
-        datalen = p->length() - (14+FID_LEN+sizeof(numberOfIDs)+index) ;
-        data = (char*)malloc(datalen) ;
-        memcpy(data, p->data()+14+FID_LEN+sizeof(numberOfIDs)+index, datalen) ;
-        if(IDs.size() == 1 && !(IDs[0].substring(0,PURSUIT_ID_LEN-1).compare((gc->RVScope).substring(0, PURSUIT_ID_LEN-1))))
+        memcpy(FID._data, p->data() + link_len, FID_LEN);
+        memcpy(&numberOfIDs, p->data()+link_len+FID_LEN, sizeof(numberOfIDs)) ;//# of IDs
+        if (!hdr.parse(p, link_len+FID_LEN)) {
+            p->kill();
+            return;
+        }
+        index = hdr.length() - sizeof (numberOfIDs);
+        datalen = p->length() - (link_len+FID_LEN+sizeof(numberOfIDs)+index) ;
+        /*RV and TM notifications are not cached, they are told apart without copying their identifier*/
+        if(hdr.size() == 1 && hdr.id_length(0) >= PURSUIT_ID_LEN-1 && memcmp(hdr.id(0), gc->RVScope.data(), PURSUIT_ID_LEN-1) == 0)
         {
             output(3).push(p) ;
         }
         else
         {
-            storecache(IDs, data, datalen) ;
+            hdr.ids(IDs);
+            if(!interests.empty())
+                fanOut(IDs, p) ;
+            /*keep a reference to the received buffer, the payload is not copied*/
+            storecache(IDs, p->clone(), link_len+FID_LEN+sizeof(numberOfIDs)+index, datalen) ;
             output(3).push(p) ;
         }
     }
     else if(port == 3)
     {
         unsigned char type ;
-        if (gc->use_mac) {
-            memcpy(FID._data, p->data() + 14, FID_LEN);
-        } else {
-            return ;//right now only support ethernet level
-        }
-        memcpy(&type, p->data()+14+FID_LEN, sizeof(type)) ;
-        memcpy(&numberOfIDs, p->data()+14+FID_LEN+sizeof(type), sizeof(numberOfIDs)) ;//# of IDs
-        for (int i = 0; i < (int) numberOfIDs; i++) {
-            IDLength = *(p->data()+14+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index);
-            IDs.push_back(String((const char *) (p->data()+14+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+sizeof(IDLength)+index),\
-                                IDLength * PURSUIT_ID_LEN));
-            index = index + sizeof (IDLength) + IDLength * PURSUIT_ID_LEN;
+        memcpy(FID._data, p->data() + link_len, FID_LEN);
+        memcpy(&type, p->data()+link_len+FID_LEN, sizeof(type)) ;
+        memcpy(&numberOfIDs, p->data()+link_len+FID_LEN+sizeof(type), sizeof(numberOfIDs)) ;//# of IDs
+        if (!hdr.parse(p, link_len+FID_LEN+sizeof(type))) {
+            p->kill();
+            return;
         }
+        index = hdr.length() - sizeof (numberOfIDs);
         switch (type)
         {
             case SCOPE_PROBING_MESSAGE:
+            case SCOPE_PROBING_AGGREGATE:
             {
                 BloomFilter BFforIID(IBFSIZE*8) ;
                 unsigned int hop_passed ;
@@ -308,108 +486,99 @@ void CacheUnit::push(int port, Packet *p)
                 unsigned int noofcache ;
                 unsigned int hop_count ;
 
-                memcpy(BFforIID.data._data, p->data()+14+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index, IBFSIZE) ;
-                memcpy(&hop_passed, p->data()+14+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+\
+                memcpy(BFforIID.data._data, p->data()+link_len+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index, IBFSIZE) ;
+                memcpy(&hop_passed, p->data()+link_len+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+\
                        IBFSIZE+FID_LEN, sizeof(hop_passed)) ;
-                memcpy(&total_distance, p->data()+14+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+\
+                memcpy(&total_distance, p->data()+link_len+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+\
                        IBFSIZE+FID_LEN+sizeof(hop_passed), sizeof(total_distance)) ;
-                memcpy(&noofcache, p->data()+14+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+\
+                memcpy(&noofcache, p->data()+link_len+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+\
                        IBFSIZE+FID_LEN+sizeof(hop_passed)+sizeof(total_distance), sizeof(noofcache)) ;
-                memcpy(&hop_count, p->data()+14+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+\
+                memcpy(&hop_count, p->data()+link_len+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+\
                        IBFSIZE+FID_LEN+sizeof(hop_passed)+sizeof(total_distance)+sizeof(noofcache),\
                        sizeof(hop_count)) ;
                 hop_passed++ ;
 
+                /*the spans of hdr are not valid past uniqueify*/
+                ce = lookupScope(hdr) ;
                 WritablePacket* packet = p->uniqueify() ;
-                for(cache_iter = cache.begin() ; cache_iter != cache.end() ; cache_iter++)
+                if(ce != NULL)
                 {
-                    if((*cache_iter)->matchSID(IDs))
-                    {
-                        Vector<String>::iterator iter ;
-                        for(iter = (*cache_iter)->IIDs.begin() ; iter != (*cache_iter)->IIDs.end() ; iter++)
-                        {
-                            BFforIID.add2bf(*iter) ;
-                        }
-                        total_distance += ((*cache_iter)->IIDs.size())*(hop_count-hop_passed) ;
-                        noofcache += (*cache_iter)->IIDs.size() ;
-                        memcpy(packet->data()+14+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index,\
-                               BFforIID.data._data, IBFSIZE) ;
-                        memcpy(packet->data()+14+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+\
-                                IBFSIZE+FID_LEN, &hop_passed,sizeof(hop_passed)) ;
-                        memcpy(packet->data()+14+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+\
-                                IBFSIZE+FID_LEN+sizeof(hop_passed), &total_distance,sizeof(total_distance)) ;
-                        memcpy(packet->data()+14+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+\
-                                IBFSIZE+FID_LEN+sizeof(hop_passed)+sizeof(total_distance),&noofcache,  sizeof(noofcache)) ;
-                        packet->set_anno_u32(0, (uint32_t)(IBFSIZE+index+sizeof(numberOfIDs)+sizeof(type)+FID_LEN+14)) ;
-                        output(4).push(packet) ;
-                        return ;
-                    }
+                    BFforIID.add2bf(ce->IIDs) ;
+                    if(type == SCOPE_PROBING_AGGREGATE)//our proposal the subscribers know their own distance from the publisher
+                        total_distance += (ce->IIDs.size())*hop_passed ;
+                    else
+                        total_distance += (ce->IIDs.size())*(hop_count-hop_passed) ;
+                    noofcache += ce->IIDs.size() ;
+                    memcpy(packet->data()+link_len+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index,\
+                           BFforIID.data._data, IBFSIZE) ;
+                    memcpy(packet->data()+link_len+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+\
+                            IBFSIZE+FID_LEN, &hop_passed,sizeof(hop_passed)) ;
+                    memcpy(packet->data()+link_len+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+\
+                            IBFSIZE+FID_LEN+sizeof(hop_passed), &total_distance,sizeof(total_distance)) ;
+                    memcpy(packet->data()+link_len+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+\
+                            IBFSIZE+FID_LEN+sizeof(hop_passed)+sizeof(total_distance),&noofcache,  sizeof(noofcache)) ;
+                    packet->set_anno_u32(0, (uint32_t)(IBFSIZE+index+sizeof(numberOfIDs)+sizeof(type)+FID_LEN+link_len)) ;
+                    output(4).push(packet) ;
+                    return ;
                 }
-                packet->set_anno_u32(0, (uint32_t)(IBFSIZE+index+sizeof(numberOfIDs)+sizeof(type)+FID_LEN+14)) ;
+                packet->set_anno_u32(0, (uint32_t)(IBFSIZE+index+sizeof(numberOfIDs)+sizeof(type)+FID_LEN+link_len)) ;
                 output(4).push(packet) ;
                 break ;
             }
             case SUB_SCOPE_MESSAGE:
             {
-                for(cache_iter = cache.begin() ; cache_iter != cache.end() ; cache_iter++)
+                hdr.ids(IDs);
+                ce = lookupScope(IDs) ;
+                if(ce != NULL)
                 {
-                    if((*cache_iter)->matchSID(IDs))
+                    BloomFilter ebf(EBFSIZE*8) ;
+                    BloomFilter ibf(IBFSIZE*8) ;
+                    FIDBitvector to_sub_FID;
+                    memcpy(ebf.data._data, p->data()+link_len+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index, EBFSIZE) ;
+                    memcpy(ibf.data._data, p->data()+link_len+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+IBFSIZE, IBFSIZE) ;
+                    memcpy(to_sub_FID._data, p->data()+link_len+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+IBFSIZE+EBFSIZE, FID_LEN) ;
+
+                    Vector<String> infoIDs ;
+                    for(Vector<String>::iterator iter = ce->IIDs.begin() ; iter != ce->IIDs.end() ; iter++)
                     {
-                        BloomFilter ebf(EBFSIZE*8) ;
-                        BloomFilter ibf(IBFSIZE*8) ;
-                        BABitvector to_sub_FID(FID_LEN*8) ;
-                        memcpy(ebf.data._data, p->data()+14+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index, EBFSIZE) ;
-                        memcpy(ibf.data._data, p->data()+14+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+IBFSIZE, IBFSIZE) ;
-                        memcpy(to_sub_FID._data, p->data()+14+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+IBFSIZE+EBFSIZE, FID_LEN) ;
-
-                        Vector<String> infoIDs ;
-                        for(Vector<String>::iterator iter = (*cache_iter)->IIDs.begin() ; iter != (*cache_iter)->IIDs.end() ; iter++)
+                        /*an item we hold only partially is left to the caches and publisher upstream*/
+                        if(!ebf.test(*iter) && ibf.test(*iter) && ce->getItem(*iter)->complete())
                         {
-                            if(!ebf.test(*iter) && ibf.test(*iter))
-                            {
-                                ebf.add2bf(*iter) ;
-                                infoIDs.push_back(*iter) ;
-                            }
+                            ebf.add2bf(*iter) ;
+                            infoIDs.push_back(*iter) ;
                         }
-                        if(infoIDs.empty())
+                    }
+                    if(infoIDs.empty())
+                    {
+                        forwardSubScope(IDs, p, link_len+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index) ;
+                        return ;
+                    }
+
+                    else
+                    {
+                        sendbackData(IDs, infoIDs, to_sub_FID, ce) ;
+                        if(ebf != ibf)
                         {
-                            p->set_anno_u32(0,(uint32_t)(14+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+IBFSIZE+EBFSIZE)) ;
-                            output(5).push(p) ;
-                            return ;
+                            WritablePacket* packet = p->uniqueify() ;
+                            memcpy(packet->data()+link_len+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index, ebf.data._data, EBFSIZE) ;
+                            forwardSubScope(IDs, packet, link_len+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index) ;
                         }
-
                         else
                         {
-                            sendbackData(IDs, infoIDs, to_sub_FID, (*cache_iter)) ;
-                            if(ebf != ibf)
-                            {
-                                WritablePacket* packet = p->uniqueify() ;
-                                memcpy(packet->data()+14+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index, ebf.data._data, EBFSIZE) ;
-                                packet->set_anno_u32(0,(uint32_t)(14+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+IBFSIZE+EBFSIZE)) ;
-                                output(5).push(packet) ;
-                            }
-                            else
-                            {
-                                p->kill() ;
-                            }
-                            return ;
+                            p->kill() ;
                         }
+                        return ;
                     }
                 }
-                p->set_anno_u32(0,(uint32_t)(14+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+IBFSIZE+EBFSIZE)) ;
-                output(5).push(p) ;
+                forwardSubScope(IDs, p, link_len+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index) ;
             }
             default:
                 break ;
         }
     }
 }
-void CacheUnit::sendbackData(Vector<String>& SIDs, Vector<String>& IIDs, BABitvector FID, CacheEntry* ce)
+void CacheUnit::sendbackData(Vector<String>& SIDs, Vector<String>& IIDs, FIDBitvector &FID, CacheEntry* ce)
 {
-    int reverse_proto ;
-    int prototype ;
-    cp_integer(String("0x080d"), 16, &reverse_proto);
-    prototype = htons(reverse_proto);
     Vector<String> IDs ;
     for(Vector<String>::iterator iid_iter = IIDs.begin() ; iid_iter != IIDs.end() ; iid_iter++)
     {
@@ -428,100 +597,759 @@ void CacheUnit::sendbackData(Vector<String>& SIDs, Vector<String>& IIDs, BABitve
         {
             total_ID_length += id_iter->length() ;
         }
-        unsigned int packet_len = 14+FID_LEN/*reverse FID*/+sizeof(NOofID)/*numberofID*/+NOofID*sizeof(IDLength)/*number of fragment*/+\
-                     total_ID_length/*IDs*/+ce->_data_length[*iid_iter] ;
-        packet = Packet::make(packet_len) ;
-        memcpy(packet->data()+12, &prototype, 2) ;
-        memcpy(packet->data()+14, FID._data, FID_LEN) ;
-        memcpy(packet->data()+14+FID_LEN, &NOofID, sizeof(NOofID)) ;//#ofID
+        CacheItem* item = ce->getItem(*iid_iter) ;
+        hit(item) ;
+        unsigned int header_len = link_len+FID_LEN/*reverse FID*/+sizeof(NOofID)/*numberofID*/+NOofID*sizeof(IDLength)/*number of fragment*/+\
+                     total_ID_length/*IDs*/ ;
+        /*a whole item is one packet, a chunked one a packet per fragment with the same header*/
+        for(int i = item->chunked() ? 0 : -1 ; i < item->chunks.size() ; i++)
+        {
+            if(i >= 0 && item->chunks[i].packet == NULL)
+                continue ;
+            packet = (i < 0) ? makeDataPacket(NULL, header_len, item) : makeDataPacket(NULL, header_len, item->chunks[i]) ;
+            LinkHeader::set_class(packet, FW_ETHER_DATAPUSH, gc->use_mac) ;
+            memcpy(packet->data()+link_len, FID._data, FID_LEN) ;
+            memcpy(packet->data()+link_len+FID_LEN, &NOofID, sizeof(NOofID)) ;//#ofID
+
+            IDindex = 0 ;
+            for(Vector<String>::iterator id_iter = IDs.begin() ; id_iter != IDs.end() ;id_iter++)//ID length ID
+            {
+                IDLength = id_iter->length()/PURSUIT_ID_LEN ;
+                memcpy(packet->data()+link_len+FID_LEN+sizeof(NOofID)+IDindex, &IDLength, sizeof(IDLength)) ;
+                memcpy(packet->data()+link_len+FID_LEN+sizeof(NOofID)+IDindex+sizeof(IDLength), id_iter->c_str(),id_iter->length()) ;
+                IDindex += sizeof(IDLength)+id_iter->length() ;
+            }
+            output(1).push(packet) ;
+        }
+    }
+}
+
+CacheEntry* CacheUnit::lookupScope(Vector<String>& SIDs)
+{
+    for(Vector<String>::iterator sid_iter = SIDs.begin() ; sid_iter != SIDs.end() ; sid_iter++)
+    {
+        CacheEntry* ce = sidIndex.get(*sid_iter) ;
+        if(ce != sidIndex.default_value())
+        {
+            setSIDs(ce, SIDs) ;
+            return ce ;
+        }
+    }
+    return NULL ;
+}
+
+CacheEntry* CacheUnit::lookupScope(const BAHeader& hdr)
+{
+    Vector<String> SIDs ;
+    for(int i = 0 ; i < hdr.size() ; i++)
+        SIDs.push_back(hdr.id_span(i)) ;
+    return lookupScope(SIDs) ;
+}
+
+CacheEntry* CacheUnit::lookupItem(Vector<String>& fullIDs)
+{
+    String IID ;
+    IID = fullIDs[0].substring(fullIDs[0].length() - PURSUIT_ID_LEN, PURSUIT_ID_LEN) ;//get the information ID
+    Vector<String> SIDs ;
+    for(Vector<String>::iterator id_iter = fullIDs.begin() ; id_iter != fullIDs.end() ; id_iter++)
+    {
+        SIDs.push_back(id_iter->substring(0, id_iter->length()-PURSUIT_ID_LEN)) ;//get the Scope ID
+    }
+    return lookupItem(IID, SIDs) ;
+}
+
+CacheEntry* CacheUnit::lookupItem(const BAHeader& hdr)
+{
+    Vector<String> SIDs ;
+    for(int i = 0 ; i < hdr.size() ; i++)
+    {
+        if(hdr.id_length(i) < PURSUIT_ID_LEN)
+            return NULL ;
+        SIDs.push_back(String::make_stable((const char*)hdr.id(i), hdr.id_length(i) - PURSUIT_ID_LEN)) ;//the Scope ID, in place
+    }
+    if(SIDs.empty())
+        return NULL ;
+    String IID = String::make_stable((const char*)hdr.id(0) + hdr.id_length(0) - PURSUIT_ID_LEN, PURSUIT_ID_LEN) ;
+    return lookupItem(IID, SIDs) ;
+}
+
+CacheEntry* CacheUnit::lookupItem(const String& IID, Vector<String>& SIDs)
+{
+    CacheEntry* scope = NULL ;
+    for(Vector<String>::iterator sid_iter = SIDs.begin() ; sid_iter != SIDs.end() ; sid_iter++)
+    {
+        CacheEntry* ce = sidIndex.get(*sid_iter) ;
+        if(ce != sidIndex.default_value())
+        {
+            scope = ce ;
+            if(ce->hasIID(IID))
+                break ;
+        }
+    }
+    if(scope == NULL)
+        return NULL ;
+    /*the IDs in the request are more recent*/
+    setSIDs(scope, SIDs) ;
+    return scope->hasIID(IID) ? scope : NULL ;
+}
+
+void CacheUnit::setSIDs(CacheEntry* ce, Vector<String>& newSIDs)
+{
+    Vector<String>::iterator sid_iter ;
+    if(ce->SIDs.size() == newSIDs.size())
+    {
+        int i ;
+        for(i = 0 ; i < newSIDs.size() ; i++)
+        {
+            if(ce->SIDs[i] != newSIDs[i])
+                break ;
+        }
+        if(i == newSIDs.size())
+            return ;//nothing changed
+    }
+    for(sid_iter = ce->SIDs.begin() ; sid_iter != ce->SIDs.end() ; sid_iter++)
+    {
+        if(sidIndex.get(*sid_iter) == ce)
+            sidIndex.erase(*sid_iter) ;
+    }
+    /*newSIDs may point into a packet (see BAHeader::id_span), ce keeps copies*/
+    ce->SIDs.clear() ;
+    for(sid_iter = newSIDs.begin() ; sid_iter != newSIDs.end() ; sid_iter++)
+        ce->SIDs.push_back(String(sid_iter->data(), sid_iter->length())) ;
+    for(sid_iter = ce->SIDs.begin() ; sid_iter != ce->SIDs.end() ; sid_iter++)
+    {
+        sidIndex.set(*sid_iter, ce) ;
+    }
+}
+
+void CacheUnit::evict(CacheEntry* ce)
+{
+    for(Vector<String>::iterator sid_iter = ce->SIDs.begin() ; sid_iter != ce->SIDs.end() ; sid_iter++)
+    {
+        if(sidIndex.get(*sid_iter) == ce)
+            sidIndex.erase(*sid_iter) ;
+    }
+    ce->clean() ;
+    delete ce ;
+    number_of_entries-- ;
+}
+
+WritablePacket* CacheUnit::makeDataPacket(const unsigned char* header, unsigned int header_len, CacheItem* item)
+{
+    WritablePacket* packet ;
+    packet = Packet::make(header_len + item->length) ;
+    if(header != NULL)
+    {
+        memcpy(packet->data(), header, header_len) ;
+    }
+    memcpy(packet->data()+header_len, item->data(), item->length) ;
+    return packet ;
+}
+
+WritablePacket* CacheUnit::makeDataPacket(const unsigned char* header, unsigned int header_len, const CacheChunk& chunk)
+{
+    WritablePacket* packet ;
+    packet = Packet::make(header_len + chunk.length) ;
+    if(header != NULL)
+    {
+        memcpy(packet->data(), header, header_len) ;
+    }
+    memcpy(packet->data()+header_len, chunk.packet->data()+chunk.offset, chunk.length) ;
+    return packet ;
+}
+
+void CacheUnit::requestData(FIDBitvector& FID, Vector<String>& IDs, const String& notificationIID, FIDBitvector& backFID, CacheItem* partial)
+{
+    unsigned char type = PLEASE_PUSH_DATA ;
+    unsigned char idno = 1 ;
+    unsigned char iidlen = 2 ;
+    unsigned char numberOfIDs = IDs.size() ;
+    unsigned char IDLength /*in fragments of PURSUIT_ID_LEN each*/ ;
+    Vector<String>::iterator vec_str_iter ;
+    Vector<uint16_t> ranges ;
+    int total_ID_length = 0 ;
+    int packet_len ;
+    int IDindex = 0 ;
+    int header_len = FID_LEN/*FID to pub*/+sizeof(idno)+sizeof(iidlen)+iidlen*PURSUIT_ID_LEN/*the previous segments are RVnotification header*/+\
+            sizeof(type)/*type*/+sizeof(numberOfIDs)/*numberofID*/ ;
+    WritablePacket* packet ;
+
+    if(partial != NULL)
+    {
+        /*the runs of missing fragments, the last range covers everything after FRAGMENT_RANGES_MAX-1 runs*/
+        int count = partial->chunks.size() ;
+        for(int i = 0 ; i < count ; i++)
+        {
+            if(partial->chunks[i].packet != NULL)
+                continue ;
+            int first = i ;
+            if(ranges.size() / 2 == FRAGMENT_RANGES_MAX - 1)
+                i = count - 1 ;
+            else
+                while(i + 1 < count && partial->chunks[i + 1].packet == NULL)
+                    i++ ;
+            ranges.push_back(htons(first)) ;
+            ranges.push_back(htons(i)) ;
+        }
+    }
+    for( vec_str_iter = IDs.begin() ; vec_str_iter != IDs.end() ; vec_str_iter++)
+    {
+        total_ID_length += vec_str_iter->length() ;
+    }
+    packet_len = header_len+numberOfIDs*sizeof(IDLength)/*number of fragment*/+total_ID_length/*IDs*/+FID_LEN/*for data push*/ ;
+    if(partial != NULL)
+    {
+        packet_len += sizeof(uint32_t)/*msg_id*/+sizeof(uint16_t)/*count*/+sizeof(uint16_t)/*number of ranges*/+ranges.size()*sizeof(uint16_t) ;
+    }
+    packet = Packet::make(packet_len) ;
+    memcpy(packet->data(), FID._data, FID_LEN) ;
+    memcpy(packet->data()+FID_LEN, &idno, sizeof(idno)) ;
+    memcpy(packet->data()+FID_LEN+sizeof(idno), &iidlen, sizeof(iidlen)) ;
+    memcpy(packet->data()+FID_LEN+sizeof(idno)+sizeof(iidlen), notificationIID.data(), iidlen*PURSUIT_ID_LEN) ;
+    memcpy(packet->data()+FID_LEN+sizeof(idno)+sizeof(iidlen)+iidlen*PURSUIT_ID_LEN, &type, sizeof(type)) ;
+    memcpy(packet->data()+FID_LEN+sizeof(idno)+sizeof(iidlen)+iidlen*PURSUIT_ID_LEN+sizeof(type),\
+           &numberOfIDs, sizeof(numberOfIDs)) ;
+    for( vec_str_iter = IDs.begin() ; vec_str_iter != IDs.end() ;vec_str_iter++)//ID length ID
+    {
+        IDLength = vec_str_iter->length()/PURSUIT_ID_LEN ;
+        memcpy(packet->data()+header_len+IDindex, &IDLength, sizeof(IDLength)) ;
+        memcpy(packet->data()+header_len+IDindex+sizeof(IDLength), vec_str_iter->c_str(), vec_str_iter->length()) ;
+        IDindex += sizeof(IDLength)+vec_str_iter->length() ;
+    }
+    memcpy(packet->data()+header_len+IDindex, backFID._data, FID_LEN) ;
+    if(partial != NULL)
+    {
+        uint32_t msg_id = htonl(partial->msg_id) ;
+        uint16_t count = htons(partial->chunks.size()) ;
+        uint16_t number_of_ranges = htons(ranges.size() / 2) ;
+        unsigned char* appendix = packet->data()+header_len+IDindex+FID_LEN ;
+        memcpy(appendix, &msg_id, sizeof(msg_id)) ;
+        memcpy(appendix+sizeof(msg_id), &count, sizeof(count)) ;
+        memcpy(appendix+sizeof(msg_id)+sizeof(count), &number_of_ranges, sizeof(number_of_ranges)) ;
+        for(int i = 0 ; i < ranges.size() ; i++)
+        {
+            memcpy(appendix+sizeof(msg_id)+sizeof(count)+sizeof(number_of_ranges)+i*sizeof(uint16_t), &ranges[i], sizeof(uint16_t)) ;
+        }
+    }
+    output(2).push(packet) ;
+}
 
-        for(Vector<String>::iterator id_iter = IDs.begin() ; id_iter != IDs.end() ;id_iter++)//ID length ID
+void CacheUnit::prefetch(FIDBitvector& FID, Vector<String>& IDs, const String& notificationIID, FIDBitvector& backFID)
+{
+    String SID = IDs[0].substring(0, IDs[0].length()-PURSUIT_ID_LEN) ;
+    String IID = IDs[0].substring(IDs[0].length()-PURSUIT_ID_LEN, PURSUIT_ID_LEN) ;
+    PrefetchStream* ps = streams.get(SID) ;
+    if(ps == NULL)
+    {
+        if(streams.size() >= PREFETCH_STATE_MAX)
+        {
+            for(HashTable<String, PrefetchStream*>::iterator it = streams.begin() ; it != streams.end() ; it++)
+                delete it.value() ;
+            streams.clear() ;
+        }
+        ps = new PrefetchStream() ;
+        streams.set(SID, ps) ;
+    }
+    else if(IID == nextIID(ps->last))
+    {
+        ps->run++ ;
+    }
+    else if(IID != ps->last)
+    {
+        /*the same item again (e.g. another subscriber) does not break the run*/
+        ps->run = 0 ;
+    }
+    ps->last = IID ;
+    if(ps->run < PREFETCH_RUN)
+        return ;
+    Timestamp now = Timestamp::now() ;
+    Timestamp pending = Timestamp::make_msec(PREFETCH_PENDING_MSEC) ;
+    if(prefetching.size() >= PREFETCH_STATE_MAX)
+    {
+        /*the data of these never came*/
+        for(HashTable<String, Timestamp>::iterator it = prefetching.begin() ; it != prefetching.end() ; )
+        {
+            if(now - it.value() >= pending)
+                it = prefetching.erase(it) ;
+            else
+                it++ ;
+        }
+        if(prefetching.size() >= PREFETCH_STATE_MAX)
+            return ;
+    }
+    String next = IID ;
+    for(unsigned int i = 0 ; i < prefetch_depth ; i++)
+    {
+        next = nextIID(next) ;
+        if(next.length() == 0)
+            break ;
+        Vector<String> nextIDs ;
+        for(Vector<String>::iterator id_iter = IDs.begin() ; id_iter != IDs.end() ; id_iter++)
         {
-            IDLength = id_iter->length()/PURSUIT_ID_LEN ;
-            memcpy(packet->data()+14+FID_LEN+sizeof(NOofID)+IDindex, &IDLength, sizeof(IDLength)) ;
-            memcpy(packet->data()+14+FID_LEN+sizeof(NOofID)+IDindex+sizeof(IDLength), id_iter->c_str(),id_iter->length()) ;
-            IDindex += sizeof(IDLength)+id_iter->length() ;
+            nextIDs.push_back(id_iter->substring(0, id_iter->length()-PURSUIT_ID_LEN) + next) ;
         }
-        memcpy(packet->data()+14+FID_LEN+sizeof(NOofID)+IDindex, ce->_data[*iid_iter],\
-               ce->_data_length[*iid_iter]) ;
-        output(1).push(packet) ;
+        if(lookupItem(nextIDs) != NULL || (disk != NULL && lookupDisk(nextIDs) != NULL))
+            continue ;
+        Timestamp asked = prefetching.get(nextIDs[0]) ;
+        if(asked && now - asked < pending)
+            continue ;
+        prefetching.set(nextIDs[0], now) ;
+        prefetch_requests++ ;
+        BA_TRACE(TRACE_CACHE, TRACE_DEBUG, "prefetching %s", nextIDs[0].quoted_hex().c_str()) ;
+        /*the data follows the push FID of the request, which passes through this node*/
+        requestData(FID, nextIDs, notificationIID, backFID, NULL) ;
+    }
+}
+
+String CacheUnit::nextIID(const String& IID)
+{
+    if(IID.length() != PURSUIT_ID_LEN)
+        return String() ;
+    char next[PURSUIT_ID_LEN] ;
+    memcpy(next, IID.data(), PURSUIT_ID_LEN) ;
+    for(int i = PURSUIT_ID_LEN - 1 ; i >= 0 ; i--)
+    {
+        if(++next[i] != 0)
+            return String(next, PURSUIT_ID_LEN) ;
     }
+    return String() ;
 }
 
-void CacheUnit::storecache(Vector<String>& IDs, char* data, unsigned int datalen)
+void CacheUnit::hit(CacheItem* item)
+{
+    hits++ ;
+    if(item->prefetched)
+    {
+        prefetch_hits++ ;
+        item->prefetched = false ;
+    }
+    BA_TRACE(TRACE_CACHE, TRACE_DEBUG, "hit for %s (%u bytes)", item->IID.quoted_hex().c_str(), item->length) ;
+    policy->touch(item) ;
+}
+
+void CacheUnit::removeItem(CacheItem* item, bool evicted)
+{
+    CacheEntry* ce = item->owner ;
+    if(item->prefetched)
+        prefetch_wasted_bytes += item->size ;
+    if(evicted)
+        policy->evict(item) ;
+    else
+        policy->remove(item) ;
+    ce->removeItem(item) ;
+    current_size -= item->size ;
+    number_of_items-- ;
+    delete item ;
+    if(ce->IIDs.empty())
+        evict(ce) ;
+}
+
+void CacheUnit::evictItems()
+{
+    CacheItem* item ;
+    while(current_size > cache_size && (item = policy->victim()) != NULL)
+    {
+        if(disk != NULL)
+            demote(item) ;
+        removeItem(item, true) ;
+        evictions++ ;
+    }
+}
+
+void CacheUnit::storecache(Vector<String>& IDs, Packet* p, unsigned int offset, unsigned int datalen)
 {
     Vector<String>::iterator id_iter ;
-    Vector<CacheEntry*>::iterator cache_iter ;
-    Vector<String>::iterator local_iid_iter ;
     Vector<String> newSID ;
-    bool cacheupdate = false ;
+    CacheEntry* ce ;
     String IID ;
+    if(p->buffer_length() > cache_size)
+    {
+        /*it would evict everything and still not fit*/
+        p->kill() ;
+        return ;
+    }
     IID = IDs[0].substring(IDs[0].length()-PURSUIT_ID_LEN, PURSUIT_ID_LEN) ;
     for(id_iter = IDs.begin() ; id_iter != IDs.end() ; id_iter++)
     {
          newSID.push_back((*id_iter).substring(0, (*id_iter).length()-PURSUIT_ID_LEN)) ;
     }
-    for(id_iter = newSID.begin() ; id_iter != newSID.end() ; id_iter++)
+    FragmentHeader fragment ;
+    bool is_fragment = false ;
+    unsigned int index = 0, count = 0 ;
+    if(datalen >= sizeof(FragmentHeader))
+    {
+        memcpy(&fragment, p->data()+offset, sizeof(FragmentHeader)) ;
+        index = ntohs(fragment.index) ;
+        count = ntohs(fragment.count) ;
+        is_fragment = ntohl(fragment.magic) == FRAGMENT_MAGIC && index < count && ntohl(fragment.total_len) <= FRAGMENT_MAX_LENGTH ;
+    }
+    ce = lookupScope(newSID) ;
+    CacheItem* item = (ce != NULL) ? ce->getItem(IID) : NULL ;
+    if(item != NULL)
     {
-        for(cache_iter = cache.begin() ; cache_iter != cache.end() ; cache_iter++)
+        if(!item->chunked())
         {
-            if((*cache_iter)->matchSID(*id_iter))
+            /*the whole publication is already here*/
+            p->kill() ;
+            return ;
+        }
+        if(is_fragment && item->msg_id == ntohl(fragment.msg_id) && (unsigned int) item->chunks.size() == count)
+        {
+            if(item->chunks[index].packet != NULL)
             {
-                for(local_iid_iter = (*cache_iter)->IIDs.begin() ; local_iid_iter != (*cache_iter)->IIDs.end() ;local_iid_iter++)
-                {
-                    if(!IID.compare(*local_iid_iter))
-                    {
-                        cacheupdate = true ;
-                        free(data) ;
-                        break ;
-                    }
-                }
-                if(!cacheupdate)
-                {
-                    (*cache_iter)->IIDs.push_back(IID) ;
-                    (*cache_iter)->_data.set(IID, data) ;
-                    (*cache_iter)->_data_length.set(IID, datalen) ;
-                    (*cache_iter)->total_len += datalen ;
-                    current_size += datalen ;
-                    cacheupdate = true ;
-                }
-                (*cache_iter)->SIDs = newSID ;
-                break ;
+                p->kill() ;
+                return ;
             }
+            policy->remove(item) ;
+            storeChunk(item, index, p, offset, datalen) ;
+            policy->insert(item) ;
+            evictItems() ;
+            return ;
         }
-        if(cacheupdate)
+        /*the whole publication, or fragments of a different content, replace what we have*/
+        removeItem(item) ;
+        ce = lookupScope(newSID) ;
+    }
+    if(admission && !admit(IDs[0], p->buffer_length()))
+    {
+        rejections++ ;
+        BA_TRACE(TRACE_CACHE, TRACE_DEBUG, "admission refused %s", IDs[0].quoted_hex().c_str()) ;
+        p->kill() ;
+        return ;
+    }
+    if(ce == NULL)
+    {
+        ce = new CacheEntry(Vector<String>()) ;
+        setSIDs(ce, newSID) ;
+        number_of_entries++ ;
+    }
+    if(is_fragment)
+    {
+        item = new CacheItem(ce, IID, ntohl(fragment.msg_id), count, ntohl(fragment.total_len)) ;
+        ce->addItem(item) ;
+        number_of_items++ ;
+        storeChunk(item, index, p, offset, datalen) ;
+    }
+    else
+    {
+        item = new CacheItem(ce, IID, p, offset, datalen) ;
+        ce->addItem(item) ;
+        current_size += item->size ;
+        number_of_items++ ;
+    }
+    if(!prefetching.empty() && prefetching.erase(IDs[0]))
+        item->prefetched = true ;
+    if(disk != NULL)
+    {
+        /*a copy on disk is stale now*/
+        for(id_iter = IDs.begin() ; id_iter != IDs.end() ; id_iter++)
+            disk->drop(*id_iter) ;
+    }
+    policy->insert(item) ;
+    insertions++ ;
+    evictItems() ;
+}
+
+bool CacheUnit::admit(const String& ID, unsigned int size)
+{
+    CacheItem* victim ;
+    if(current_size + size <= cache_size || (victim = policy->victim()) == NULL)
+        return true ;
+    /*hits per byte: the candidate must be more popular for its size than the victim (ties keep the victim)*/
+    uint64_t candidate = sketch.estimate(ID) ;
+    uint64_t incumbent = sketch.estimate(victim->owner->SIDs[0] + victim->IID) ;
+    return candidate * (victim->size > 0 ? victim->size : 1) > incumbent * (size > 0 ? size : 1) ;
+}
+
+String CacheUnit::popularity()
+{
+    StringAccum sa ;
+    for(HashTable<String, CacheEntry*>::iterator it = sidIndex.begin() ; it != sidIndex.end() ; it++)
+    {
+        CacheEntry* ce = it.value() ;
+        /*an entry is indexed by all its SIDs, list it once*/
+        if(it.key() != ce->SIDs[0])
+            continue ;
+        for(Vector<String>::iterator iid_iter = ce->IIDs.begin() ; iid_iter != ce->IIDs.end() ; iid_iter++)
+        {
+            String ID = ce->SIDs[0] + *iid_iter ;
+            sa << ID.quoted_hex() << ' ' << sketch.estimate(ID) << ' ' << ce->getItem(*iid_iter)->hits << '\n' ;
+        }
+    }
+    return sa.take_string() ;
+}
+
+void CacheUnit::memoryReport(MemReport& report)
+{
+    /*an entry is indexed by all its SIDs, it is counted under the first one*/
+    report.begin("sids", sidIndex.size()) ;
+    for(HashTable<String, CacheEntry*>::iterator it = sidIndex.begin() ; it != sidIndex.end() ; it++)
+    {
+        CacheEntry* ce = it.value() ;
+        size_t bytes = mem_entry<String, CacheEntry*>() + it.key().length() ;
+        if(it.key() == ce->SIDs[0])
+            bytes += sizeof(CacheEntry) + mem_strings(ce->SIDs) + mem_strings(ce->IIDs) + ce->items.size() * mem_entry<String, CacheItem*>() ;
+        if(!report.sample(it.key(), bytes))
+            break ;
+    }
+    report.end() ;
+    /*the items with their packets, so the scopes that hold the cached data show up*/
+    report.begin("items", number_of_items) ;
+    bool more = true ;
+    for(HashTable<String, CacheEntry*>::iterator it = sidIndex.begin() ; more && it != sidIndex.end() ; it++)
+    {
+        CacheEntry* ce = it.value() ;
+        if(it.key() != ce->SIDs[0])
+            continue ;
+        for(HashTable<String, CacheItem*>::iterator item_it = ce->items.begin() ; more && item_it != ce->items.end() ; item_it++)
+        {
+            CacheItem* item = item_it.value() ;
+            more = report.sample(ce->SIDs[0], sizeof(CacheItem) + mem_string(item->IID) + item->chunks.size() * sizeof(CacheChunk) + item->size) ;
+        }
+    }
+    report.end() ;
+    report.begin("interests", interests.size()) ;
+    for(HashTable<String, PendingInterest*>::iterator it = interests.begin() ; it != interests.end() ; it++)
+    {
+        PendingInterest* pi = it.value() ;
+        size_t bytes = mem_entry<String, PendingInterest*>() + it.key().length() + sizeof(PendingInterest) + mem_strings(pi->SIDs) + pi->ibf.length() +\
+                       pi->requesters.size() * (sizeof(FIDBitvector) + FID_LEN) ;
+        for(int i = 0 ; i < pi->held.size() ; i++)
+            bytes += pi->held[i]->buffer_length() ;
+        if(!report.sample(pi->SIDs.size() > 0 ? pi->SIDs[0] : String(), bytes))
             break ;
     }
-    if(!cacheupdate)
+    report.end() ;
+    report.begin("streams", streams.size()) ;
+    for(HashTable<String, PrefetchStream*>::iterator it = streams.begin() ; it != streams.end() ; it++)
     {
-        CacheEntry* newentry = new CacheEntry(newSID, IID, data, datalen) ;
-        cache.push_back(newentry) ;
+        if(!report.sample(it.key(), mem_entry<String, PrefetchStream*>() + it.key().length() + sizeof(PrefetchStream) + it.value()->last.length()))
+            break ;
+    }
+    report.end() ;
+    report.begin("prefetching", prefetching.size()) ;
+    for(HashTable<String, Timestamp>::iterator it = prefetching.begin() ; it != prefetching.end() ; it++)
+    {
+        if(!report.sample(it.key(), mem_entry<String, Timestamp>() + it.key().length()))
+            break ;
+    }
+    report.end() ;
+    report.exact("sketch", FREQUENCY_SKETCH_DEPTH * sketch.width(), FREQUENCY_SKETCH_DEPTH * sketch.width()) ;
+    /*the records of the disk tier (dead ones are left out), an ID is a scope and an item identifier*/
+    unsigned int records = (disk != NULL) ? disk->live_records : 0 ;
+    report.exact("disk_index", records, (uint64_t) records * (sizeof(DiskRecord) + mem_entry<String, DiskRecord*>() + 2 * (sizeof(String) + PURSUIT_ID_LEN))) ;
+}
+
+void CacheUnit::forwardSubScope(Vector<String>& IDs, Packet* p, unsigned int bf_offset)
+{
+    p->set_anno_u32(0, (uint32_t)(bf_offset+IBFSIZE+EBFSIZE)) ;
+    if(aggregate_window == 0 || p->length() < bf_offset+IBFSIZE+EBFSIZE+FID_LEN)
+    {
+        output(5).push(p) ;
+        return ;
+    }
+    FIDBitvector reverse_FID ;
+    String ibf((const char*)(p->data()+bf_offset+EBFSIZE), IBFSIZE) ;
+    String key = ibf ;
+    memcpy(reverse_FID._data, p->data()+bf_offset+IBFSIZE+EBFSIZE, FID_LEN) ;
+    for(Vector<String>::iterator sid_iter = IDs.begin() ; sid_iter != IDs.end() ; sid_iter++)
+        key += *sid_iter ;
+    PendingInterest* pi = interests.get(key) ;
+    if(pi == NULL)
+    {
+        pi = new PendingInterest() ;
+        pi->SIDs = IDs ;
+        pi->ibf = ibf ;
+        pi->requesters.push_back(reverse_FID) ;
+        pi->expires = Timestamp::now() + Timestamp::make_msec(aggregate_window) ;
+        pi->answered = false ;
+        interests.set(key, pi) ;
+        if(!interest_timer.scheduled())
+            interest_timer.schedule_at(pi->expires) ;
+        output(5).push(p) ;
+        return ;
+    }
+    aggregated++ ;
+    for(int i = 0 ; i < pi->requesters.size() ; i++)
+    {
+        if(pi->requesters[i] == reverse_FID)
+        {
+            /*the same requester again (e.g. a wider ring of its search), it is pending already*/
+            p->kill() ;
+            return ;
+        }
+    }
+    BA_TRACE(TRACE_CACHE, TRACE_DEBUG, "merged a flooded request for %s", IDs[0].quoted_hex().c_str()) ;
+    pi->requesters.push_back(reverse_FID) ;
+    pi->held.push_back(p) ;
+}
+
+void CacheUnit::fanOut(Vector<String>& IDs, Packet* p)
+{
+    String IID = IDs[0].substring(IDs[0].length()-PURSUIT_ID_LEN, PURSUIT_ID_LEN) ;
+    /*the interests only live for the aggregation window, there are few of them*/
+    for(HashTable<String, PendingInterest*>::iterator it = interests.begin() ; it != interests.end() ; it++)
+    {
+        PendingInterest* pi = it.value() ;
+        bool match = false ;
+        for(int i = 0 ; i < IDs.size() && !match ; i++)
+        {
+            String SID = IDs[i].substring(0, IDs[i].length()-PURSUIT_ID_LEN) ;
+            for(int j = 0 ; j < pi->SIDs.size() && !match ; j++)
+                match = (pi->SIDs[j] == SID) ;
+        }
+        if(!match)
+            continue ;
+        BloomFilter ibf(IBFSIZE*8) ;
+        memcpy(ibf.data._data, pi->ibf.data(), IBFSIZE) ;
+        if(!ibf.test(IID))
+            continue ;
+        pi->answered = true ;
+        /*the first requester gets p itself*/
+        for(int i = 1 ; i < pi->requesters.size() ; i++)
+        {
+            WritablePacket* packet = p->clone()->uniqueify() ;
+            memcpy(packet->data()+link_len, pi->requesters[i]._data, FID_LEN) ;
+            output(1).push(packet) ;
+            fanned_out++ ;
+        }
     }
-    if( current_size >= cache_size )
+}
+
+void CacheUnit::run_timer(Timer*)
+{
+    Timestamp now = Timestamp::now() ;
+    Timestamp next ;
+    for(HashTable<String, PendingInterest*>::iterator it = interests.begin() ; it != interests.end() ; )
     {
-        unsigned int tempsize = 0 ;
-        int eraseno = 0 ;
-        for(cache_iter = cache.begin() ; cache_iter != cache.end() ; cache_iter++)
+        PendingInterest* pi = it.value() ;
+        if(pi->expires > now)
+        {
+            if(!next || pi->expires < next)
+                next = pi->expires ;
+            it++ ;
+            continue ;
+        }
+        for(int i = 0 ; i < pi->held.size() ; i++)
         {
-            eraseno++ ;
-            tempsize += (*cache_iter)->total_len ;
-            if(tempsize>(current_size-cache_size))
+            if(pi->answered)
+            {
+                pi->held[i]->kill() ;
+            }
+            else
             {
-                break;
+                /*nothing came back through this node (e.g. the request was answered locally): flood them after all*/
+                released++ ;
+                output(5).push(pi->held[i]) ;
             }
         }
-        for(int i = 0 ; i < eraseno ; i++)
+        delete pi ;
+        it = interests.erase(it) ;
+    }
+    if(next)
+        interest_timer.schedule_at(next) ;
+}
+
+DiskRecord* CacheUnit::lookupDisk(Vector<String>& fullIDs)
+{
+    for(Vector<String>::iterator id_iter = fullIDs.begin() ; id_iter != fullIDs.end() ; id_iter++)
+    {
+        DiskRecord* record = disk->find(*id_iter) ;
+        if(record != NULL)
+            return record ;
+    }
+    return NULL ;
+}
+
+DiskRecord* CacheUnit::lookupDisk(const BAHeader& hdr)
+{
+    for(int i = 0 ; i < hdr.size() ; i++)
+    {
+        DiskRecord* record = disk->find(hdr.id_span(i)) ;
+        if(record != NULL)
+            return record ;
+    }
+    return NULL ;
+}
+
+void CacheUnit::demote(CacheItem* item)
+{
+    /*a fragmented publication would be a record per fragment, it is only kept in memory*/
+    if(item->chunked())
+        return ;
+    BA_TRACE(TRACE_CACHE, TRACE_DEBUG, "demoting %s (%u bytes)", item->IID.quoted_hex().c_str(), item->length) ;
+    disk->demote(item->owner->SIDs[0] + item->IID, item->packet->clone(), item->offset, item->length) ;
+}
+
+void CacheUnit::selected(int, int)
+{
+    Vector<DiskJob*> done ;
+    if(disk == NULL)
+        return ;
+    disk->complete(done) ;
+    for(int i = 0 ; i < done.size() ; i++)
+    {
+        DiskJob* job = done[i] ;
+        if(job->packet != NULL)
+            job->packet->kill() ;
+        if(job->buffer != NULL)
         {
-            CacheEntry* ce = cache.at(0) ;
-            ce->clean() ;
-            cache.erase(cache.begin()) ;
-            delete ce ;
+            Vector<String> IDs ;
+            IDs.push_back(job->ID) ;
+            WritablePacket* packet = Packet::make(job->length) ;
+            memcpy(packet->data(), job->buffer, job->length) ;
+            free(job->buffer) ;
+            storecache(IDs, packet, 0, job->length) ;
         }
-        current_size = current_size - tempsize ;
+        /*a hit now, or a miss if the item could not be read or stored*/
+        for(int j = 0 ; j < job->waiting.size() ; j++)
+            push(1, job->waiting[j]) ;
+        delete job ;
     }
 }
 
+void CacheUnit::accountRequest(bool hit)
+{
+    uint32_t now = Timestamp::now().sec() ;
+    if(now != load_window)
+    {
+        /*a window without requests in between means we have been idle*/
+        last_requests = (now == load_window + 1) ? window_requests : 0 ;
+        last_hit_rate = (now == load_window + 1 && window_requests > 0) ? 100 * window_hits / window_requests : 100 ;
+        load_window = now ;
+        window_requests = window_hits = 0 ;
+    }
+    window_requests++ ;
+    if(hit)
+        window_hits++ ;
+}
+
+void CacheUnit::fillLoad(ProbingLoad& load)
+{
+    uint32_t now = Timestamp::now().sec() ;
+    /*the busier of the current and the last complete window*/
+    unsigned int requests = (now == load_window) ? window_requests : 0 ;
+    if(now <= load_window + 1 && last_requests > requests)
+        requests = last_requests ;
+    unsigned int depth = (queue != NULL) ? queue->size() : 0 ;
+    load.pending = htons(requests < 0xFFFF ? requests : 0xFFFF) ;
+    load.queue_depth = htons(depth < 0xFFFF ? depth : 0xFFFF) ;
+    load.hit_rate = (now <= load_window + 1) ? last_hit_rate : 100 ;
+    load.reserved = 0 ;
+}
+
+void CacheUnit::storeChunk(CacheItem* item, unsigned int index, Packet* p, unsigned int offset, unsigned int datalen)
+{
+    item->chunks[index].packet = p ;
+    item->chunks[index].offset = offset ;
+    item->chunks[index].length = datalen ;
+    item->chunks_present++ ;
+    item->size += p->buffer_length() ;
+    item->owner->total_len += p->buffer_length() ;
+    current_size += p->buffer_length() ;
+}
+
 CLICK_ENDDECLS
 EXPORT_ELEMENT(CacheUnit)
-ELEMENT_REQUIRES(userlevel)
+ELEMENT_REQUIRES(userlevel Trace MemStats)
 ELEMENT_PROVIDES(CacheEntry)
@@ -3,8 +3,16 @@
 
 #include "globalconf.hh"
 #include "bloomfilter.hh"
+#include "cachepolicy.hh"
+#include "disktier.hh"
+#include "linkheader.hh"
+#include "memstats.hh"
+#include "baheader.hh"
 
 #include <click/etheraddress.hh>
+#include <click/timestamp.hh>
+#include <click/timer.hh>
+#include <click/standard/storage.hh>
 CLICK_DECLS
 
 /**@brief Our proposal cache entry stores one piece of cache
@@ -12,49 +20,45 @@ CLICK_DECLS
 class CacheEntry
 {
 public:
-    /**@brief default constructor*/
-    CacheEntry() ;
     /**@brief constructor
-     * initialize the buffer with the datalen bytes data starting from data*/
-    CacheEntry(Vector<String> newSID, String IID, char* data, int datalen)
+     * an empty entry for the scope identified by newSID*/
+    CacheEntry(Vector<String> newSID)
     {
         SIDs = newSID ;
-        IIDs.push_back(IID) ;
-        _data[IID] = (char*)malloc(datalen) ;
-        _data_length[IID] = datalen ;
-        memcpy(_data[IID], data, datalen) ;
-        total_len = datalen ;
+        total_len = 0 ;
     }
     /**@brief destructor
-     * deallocate the _data*/
+     * deallocate all items*/
     ~CacheEntry()
     {
-        HashTable<String, char*>::iterator iter ;
-        for( iter = _data.begin() ; iter != _data.end() ; iter++)
-        {
-            if(iter->second != NULL)
-                free(iter->second) ;
-        }
+        clean() ;
     }
-    /**@brief cleans data*/
+    /**@brief deletes all items and their data*/
     inline void clean()
     {
-        HashTable<String, char*>::iterator iter ;
-        for(iter = _data.begin() ; iter != _data.end() ; iter++)
+        HashTable<String, CacheItem*>::iterator iter ;
+        for(iter = items.begin() ; iter != items.end() ; iter++)
         {
-            if((*iter).second != NULL)
-                free((*iter).second) ;
+            delete (*iter).second ;
         }
-
+        items.clear() ;
+        IIDs.clear() ;
+        total_len = 0 ;
     }
-    /**@brief
-     * match the fullID with the cache
-     * this method will only be called, if the information ID matches
-     * if match found the new IDs will be assigned to the cache IDs, since it's more update*/
-    bool matchIID(Vector<String>&) ;
-
-    bool matchSID(String) ;
-    bool matchSID(Vector<String> _SIDs) ;
+    /**@brief returns true if the information item IID is stored in this entry*/
+    inline bool hasIID(const String &IID)
+    {
+        return items.find(IID) != items.end() ;
+    }
+    /**@brief returns the item IID or NULL*/
+    inline CacheItem* getItem(const String &IID)
+    {
+        return items.get(IID) ;
+    }
+    /**@brief adds a new item to this entry*/
+    void addItem(CacheItem* item) ;
+    /**@brief removes item from this entry (it does not delete it)*/
+    void removeItem(CacheItem* item) ;
     /**@brief
      * ScopeIDs that identify the Scope, since multiple SIDs may refer to the same Scope*/
     Vector<String> SIDs ;
@@ -62,14 +66,46 @@ public:
      * the information ID in this scope*/
     Vector<String> IIDs ;
     /**@brief
-     * the actual data*/
-    HashTable<String, char*> _data ;
+     * the items (data and length) by information ID*/
+    HashTable<String, CacheItem*> items ;
     /**@brief
-     * the length of each item*/
-    HashTable<String, unsigned int> _data_length ;
+     * the total size of all items*/
     unsigned int total_len ;
 };
 
+/**@brief Our proposal the flooded subscriptions (SUB_SCOPE_MESSAGE) for the same scope and items that passed this node in the aggregation window.
+ * Only the first one is flooded further, the data answering it is copied to the reverse FIDs of the others*/
+class PendingInterest
+{
+public:
+    Vector<String> SIDs ;
+    /**@brief the IBF of the requested information items*/
+    String ibf ;
+    /**@brief the reverse FIDs (from this node) of all requesters, the first one is the flooded request*/
+    Vector<FIDBitvector> requesters ;
+    /**@brief the merged requests, flooded late if nothing answers in the window*/
+    Vector<Packet*> held ;
+    Timestamp expires ;
+    bool answered ;
+};
+
+/**@brief Our proposal the number of requests for the successor of the previous item of a scope after which the scope is read sequentially (and prefetched)*/
+#define PREFETCH_RUN 2
+/**@brief Our proposal the time (msec) in which a prefetched item is not asked for again*/
+#define PREFETCH_PENDING_MSEC 2000
+/**@brief Our proposal the number of scopes whose access pattern is followed and of prefetches waiting for their data (beyond it the stale state is dropped)*/
+#define PREFETCH_STATE_MAX 4096
+
+/**@brief Our proposal the access pattern of a scope: the last information ID asked for and the number of requests in a row for the successor of the previous one.
+ * The information IDs of ordered items (e.g. chunks) are numbers, the successor of an IID is the IID + 1 (big endian)*/
+class PrefetchStream
+{
+public:
+    PrefetchStream() : run(0) {}
+    String last ;
+    unsigned int run ;
+};
+
 /**@brief (Our Proposal with probing) A Cacheunit is responsible for caching some content and responding for any request
  * for the cache
  */
@@ -99,7 +135,17 @@ public:
      */
     const char *processing() const {return PUSH ;}
     /**
-     * @brief Element configuration, Cacheunit needs LIPSIN of this blackadder node
+     * @brief Element configuration, Cacheunit needs LIPSIN of this blackadder node.
+     * Optionally, CAPACITY is the cache size in bytes (default 50MB) and POLICY is the eviction policy: lru (default), lfu or gdsf.
+     * ADMISSION (default false) turns on the TinyLFU admission filter: when the cache is full, a new item is stored only if its
+     * estimated popularity per byte is higher than the one of the item the policy would evict. SKETCH_WIDTH is the number of counters per row of the sketch (default 4096).
+     * AGGREGATE (msec, default 0 = off) is the window in which identical flooded subscriptions are merged: the first one is flooded, the data
+     * answering it is fanned out to the others (see PendingInterest).
+     * PREFETCH (default 0 = off) is the number of items after the requested one that are asked for upstream ahead of demand once a scope is read sequentially
+     * (PREFETCH_RUN requests in a row for the next IID): they are pushed through this cache (along the push FID of the request) and stored.
+     * DISK_FILE (default none = off) is the file of a second, disk tier of DISK_CAPACITY bytes (default 1GB, see DiskTier): the items evicted from memory
+     * are demoted to it and promoted back when they are hit (a request for an item on disk is served once it is in memory again).
+     * QUEUE is the (optional) queue element in front of the device the CacheUnit sends data to; its length is reported as the egress queue depth in probing responses
      */
     int configure(Vector<String>&, ErrorHandler*) ;
     /**
@@ -108,13 +154,25 @@ public:
     int configure_phase() const{return 200 ;}
     /**
      * @brief This method is called by Click when the Element is about to be initialized.
-     * There is nothing that needs initialization though.
+     * It opens the disk tier, if there is one.
      */
     int initialize(ErrorHandler *errh) ;
     /**
      * @brief Cleanup everything
      */
     void cleanup(CleanupStage stage) ;
+    /**
+     * @brief read handlers: size, capacity, items, entries, hits, partial_hits, misses, insertions, evictions, rejections, policy, admission
+     * and popularity (a line per cached item: the hex ID, its estimated popularity and its hits).
+     * write handlers: capacity (evicts if required), admission, reset_stats.
+     * aggregated, fanned_out and released count the merged flooded subscriptions, the data copies sent to them and the merged requests flooded late.
+     * prefetch (read and write) is the PREFETCH depth, prefetch_requests the items asked for ahead of demand, prefetch_hits the prefetched items
+     * that were hit and prefetch_wasted_bytes the memory of the prefetched items that were evicted without a hit.
+     * disk_size, disk_capacity, disk_items, disk_hits, demotions, promotions and disk_overwrites describe the disk tier (live payload bytes and records,
+     * requests for items on disk, items written to and read back from it and live records lost to the wrap of the log).
+     * memory lists the entries and approximate bytes of the indexes, the cached items (with their packets) and the disk index, memory_scopes the largest root scopes (see memoryReport)
+     */
+    void add_handlers() ;
     /**
      * @brief The core method of Cacheunit
      * Upon receiving a probing message, the Cacheunit should check its local cache to see
@@ -122,18 +180,133 @@ public:
      */
     void push(int port, Packet *p) ;
     /**@brief send back data, only work for kanycast*/
-    void sendbackData(Vector<String>& SIDs, Vector<String>& IIDs, BABitvector FID, CacheEntry* ce) ;
-    /**@brief store the cache*/
-    void storecache(Vector<String>&, char*, unsigned int) ;
+    void sendbackData(Vector<String>& SIDs, Vector<String>& IIDs, FIDBitvector &FID, CacheEntry* ce) ;
+    /**@brief store the cache
+     * the cache keeps the packet (a reference to the received buffer) and does not copy the datalen bytes payload at offset*/
+    void storecache(Vector<String>&, Packet*, unsigned int offset, unsigned int datalen) ;
+    /**@brief returns a new datapush packet: header_len bytes copied from header (or left for the caller if header is NULL) followed by the item payload.
+     * This is the only copy of the payload on a cache hit*/
+    WritablePacket* makeDataPacket(const unsigned char* header, unsigned int header_len, CacheItem* item) ;
+    /**@brief the same for one chunk of a chunked item (the payload is the fragment with its FragmentHeader)*/
+    WritablePacket* makeDataPacket(const unsigned char* header, unsigned int header_len, const CacheChunk& chunk) ;
+    /**@brief sends a PLEASE_PUSH_DATA for IDs towards the publisher (through FID), asking it to push the data to backFID.
+     * If partial is not NULL, only the fragments missing in partial are asked for*/
+    void requestData(FIDBitvector& FID, Vector<String>& IDs, const String& notificationIID, FIDBitvector& backFID, CacheItem* partial) ;
+    /**@brief puts the fragment (datalen bytes at offset in p) as chunk index of the chunked item and accounts its size (the caller updates the policy)*/
+    void storeChunk(CacheItem* item, unsigned int index, Packet* p, unsigned int offset, unsigned int datalen) ;
+    /**@brief follows the access pattern of the scope of the subinfo request for IDs and, if it is read sequentially,
+     * asks the publisher (through FID) for the next items that are not cached nor asked for already, to be pushed along backFID*/
+    void prefetch(FIDBitvector& FID, Vector<String>& IDs, const String& notificationIID, FIDBitvector& backFID) ;
+    /**@brief returns the information ID after IID (IID + 1, big endian) or an empty String if IID is the last one*/
+    static String nextIID(const String& IID) ;
+    /**@brief accounts a hit on item and touches it in the eviction policy*/
+    void hit(CacheItem* item) ;
+    /**@brief removes item from its entry and the eviction policy and deletes it (and the entry if it's empty).
+     * evicted tells the policy that item is its victim (see CachePolicy::evict)*/
+    void removeItem(CacheItem* item, bool evicted = false) ;
+    /**@brief evicts items (the policy decides which) until current_size fits in cache_size*/
+    void evictItems() ;
+    /**@brief the admission filter: returns true if a new item of size bytes for ID may be stored.
+     * It is always true while the item fits without evicting anything*/
+    bool admit(const String& ID, unsigned int size) ;
+    /**@brief the popularity read handler*/
+    String popularity() ;
+    /**@brief Our proposal fills report with the state of the CacheUnit (see MemReport): up to MEM_SAMPLE entries of each index are measured*/
+    void memoryReport(MemReport& report) ;
+    /**@brief floods the SUB_SCOPE_MESSAGE p further (its EBF starts at bf_offset), unless an identical request is already pending:
+     * then it is merged into that PendingInterest*/
+    void forwardSubScope(Vector<String>& IDs, Packet* p, unsigned int bf_offset) ;
+    /**@brief copies the data push p (with IDs) to the merged requesters of the pending interests it answers*/
+    void fanOut(Vector<String>& IDs, Packet* p) ;
+    /**@brief collects the finished jobs of the disk tier: promoted items are stored again and the requests that waited for them are handled*/
+    void selected(int fd, int mask) ;
+    /**@brief returns the record of the disk tier of the item identified by any of the fullIDs (or NULL)*/
+    DiskRecord* lookupDisk(Vector<String>& fullIDs) ;
+    /**@brief lookupDisk on the identifiers of hdr, without copying them*/
+    DiskRecord* lookupDisk(const BAHeader& hdr) ;
+    /**@brief writes item (if it is not chunked) to the disk tier before it is evicted*/
+    void demote(CacheItem* item) ;
+    /**@brief expires the pending interests*/
+    void run_timer(Timer* timer) ;
+    /**@brief counts a subinfo request for this cache in the load window*/
+    void accountRequest(bool hit) ;
+    /**@brief the load this cache reports in a probing response (see ProbingLoad)*/
+    void fillLoad(ProbingLoad& load) ;
+    /**@brief returns the CacheEntry storing the information item identified by any of the fullIDs (or NULL).
+     * If a scope matches, its SIDs are updated to the (more recent) scope IDs of fullIDs*/
+    CacheEntry* lookupItem(Vector<String>& fullIDs) ;
+    /**@brief lookupItem on the identifiers of hdr: the lookups use spans into the packet and only the SIDs that are kept are copied (see setSIDs)*/
+    CacheEntry* lookupItem(const BAHeader& hdr) ;
+    /**@brief the lookup of lookupItem, on the information ID IID and the scope IDs SIDs of the request*/
+    CacheEntry* lookupItem(const String& IID, Vector<String>& SIDs) ;
+    /**@brief returns the CacheEntry of the scope identified by any of the SIDs (or NULL).
+     * If found, its SIDs are updated to SIDs*/
+    CacheEntry* lookupScope(Vector<String>& SIDs) ;
+    /**@brief lookupScope on the identifiers of hdr, without copying them unless the SIDs of the scope change*/
+    CacheEntry* lookupScope(const BAHeader& hdr) ;
+    /**@brief assigns (copies of) newSIDs to ce and updates sidIndex accordingly*/
+    void setSIDs(CacheEntry* ce, Vector<String>& newSIDs) ;
+    /**@brief removes ce from sidIndex, frees its data and deletes it*/
+    void evict(CacheEntry* ce) ;
+    static String read_handler(Element *e, void *thunk) ;
+    static int write_handler(const String &str, Element *e, void *thunk, ErrorHandler *errh) ;
     /**
      * @brief The global configuration
      */
     GlobalConf *gc ;
-    /**@brief The cache*/
-    Vector<CacheEntry*> cache ;
+    /**@brief Our proposal the length of the link header in the network mode of the node (LinkHeader::length)*/
+    uint32_t link_len ;
+    /**@brief Scope ID to CacheEntry index. A CacheEntry is indexed by all its SIDs and its items are hashed by IID,
+     * so an (SID, IID) lookup is two hash lookups*/
+    HashTable<String, CacheEntry*> sidIndex ;
     /**@brief The total cache size in bytes*/
     unsigned int cache_size ;
     unsigned int current_size ;
+    /**@brief The eviction policy*/
+    CachePolicy* policy ;
+    String policy_name ;
+    /**@brief The access frequencies of full IDs, counted from the probing and subinfo messages for this node*/
+    FrequencySketch sketch ;
+    bool admission ;
+    /**@brief the egress queue (or NULL)*/
+    Storage* queue ;
+    /**@brief the second of the current load window, the requests and hits in it and the totals of the previous window*/
+    uint32_t load_window ;
+    unsigned int window_requests ;
+    unsigned int window_hits ;
+    unsigned int last_requests ;
+    unsigned int last_hit_rate ;
+    /**@brief The number of CacheEntry (scopes) and CacheItem*/
+    unsigned int number_of_entries ;
+    unsigned int number_of_items ;
+    /*statistics*/
+    uint64_t hits ;
+    /**@brief hits on a chunked item that misses some chunks*/
+    uint64_t partial_hits ;
+    uint64_t misses ;
+    uint64_t insertions ;
+    uint64_t evictions ;
+    /**@brief new items refused by the admission filter*/
+    uint64_t rejections ;
+    /**@brief the AGGREGATE window and the pending interests by SIDs and IBF*/
+    unsigned int aggregate_window ;
+    HashTable<String, PendingInterest*> interests ;
+    Timer interest_timer ;
+    uint64_t aggregated ;
+    uint64_t fanned_out ;
+    uint64_t released ;
+    /**@brief the PREFETCH depth, the access patterns by SID and the prefetched full IDs waiting for their data (with the time they were asked for)*/
+    unsigned int prefetch_depth ;
+    HashTable<String, PrefetchStream*> streams ;
+    HashTable<String, Timestamp> prefetching ;
+    uint64_t prefetch_requests ;
+    uint64_t prefetch_hits ;
+    uint64_t prefetch_wasted_bytes ;
+    /**@brief the disk tier (or NULL), its DISK_FILE and DISK_CAPACITY and the requests for items that were on it*/
+    DiskTier* disk ;
+    String disk_file ;
+    uint64_t disk_capacity ;
+    uint64_t disk_hits ;
 };
 CLICK_ENDDECLS
 #endif // CACHEUNIT_HH_INCLUDED
@@ -18,6 +18,8 @@ CLICK_DECLS
 
 CLICK_ENDDECLS
 
+ELEMENT_REQUIRES(IDTable)
+ELEMENT_REQUIRES(HostSet)
 ELEMENT_PROVIDES(LocalHostSetItem)
 ELEMENT_PROVIDES(InformationItemSetItem)
 ELEMENT_PROVIDES(RemoteHostSetItem)
@@ -16,6 +16,8 @@
 #define CLICK_COMMON_HH
 
 #include "ba_bitvector.hh"
+#include "idtrie.hh"
+#include "hostset.hh"
 
 #include <click/string.hh>
 #include <click/hashtable.hh>
@@ -57,31 +59,6 @@ struct LocalHostSetItem {
     }
 };
 
-/** @brief (blackadder Core) A click-compatible way of implementing a set of RemoteHost (see remotehost.hh)
- *
- * RemoteHostSetItem represents a RemoteHost that can be inserted in a set (Click HashTable)
- */
-struct RemoteHostSetItem {
-    /**@brief pointer to RemoteHost.
-     */
-    RemoteHost * _rhpointer;
-    /**@brief required by Click to implement Sets using a HashTable.
-     */
-    typedef RemoteHost * key_type;
-    /**@brief required by Click to implement Sets using a HashTable.
-     */
-    typedef RemoteHost * key_const_reference;
-    /**@brief required by Click to implement Sets using a HashTable.
-     */
-    key_const_reference hashkey() const {
-        return _rhpointer;
-    }
-    /**@brief required by Click to implement Sets using a HashTable.
-     */
-    RemoteHostSetItem(RemoteHost * rhp) : _rhpointer(rhp) {
-    }
-};
-
 /** @brief (blackadder Core) A click-compatible way of implementing a set of String (Click's string)
  *
  * StringSetItem represents a String that can be inserted in a set (Click HashTable)
@@ -163,10 +140,10 @@ typedef HashTable<LocalHostSetItem> LocalHostSet;
 /** @brief An iterator to a set (implemented as a Click's HashTable) of applications and click elements (see localhost.hh).
  */
 typedef LocalHostSet::iterator LocalHostSetIter;
-/** @brief A set (implemented as a Click's HashTable) of Remote Hosts (see remotehost.hh).
+/** @brief A compact set (see hostset.hh) of Remote Hosts (see remotehost.hh).
  */
-typedef HashTable<RemoteHostSetItem> RemoteHostSet;
-/** @brief An iterator to a set (implemented as a Click's HashTable) of Remote Hosts (see remotehost.hh).
+typedef HostSet RemoteHostSet;
+/** @brief An iterator to a compact set (see hostset.hh) of Remote Hosts (see remotehost.hh).
  */
 typedef RemoteHostSet::iterator RemoteHostSetIter;
 /** @brief A set (implemented as a Click's HashTable) of Information Items (see informationitem.hh).
@@ -190,9 +167,9 @@ typedef StringSet::iterator StringSetIter;
 /** @brief A Click's Pair of remotehosts.
  */
 typedef Pair<RemoteHostSet, RemoteHostSet> RemoteHostPair;
-/** @brief A Click's HashTable of Click's Strings mapped to Pair of set of RemoteHosts.
+/** @brief An IDIndex (see idtable.hh) of full identifiers mapped to Pair of set of RemoteHosts.
  */
-typedef HashTable<String, RemoteHostPair *> IdsHashMap;
+typedef IDIndex<RemoteHostPair *> IdsHashMap;
 /** @brief An iterator to a Click's HashTable of Click's Strings mapped to Pair of set of RemoteHosts.
  */
 typedef IdsHashMap::iterator IdsHashMapIter;
@@ -202,15 +179,15 @@ typedef HashTable<String, RemoteHost *> RemoteHostHashMap;
 /** @brief An iterator to a Click's HashTable of Click's Strings mapped to a RemoteHost.
  */
 typedef RemoteHostHashMap::iterator RemoteHostHashMapIter;
-/** @brief A Click's HashTable of Click's Strings mapped to an InformationItem.
+/** @brief A GraphIndex (see idtrie.hh) of full identifiers mapped to an InformationItem.
  */
-typedef HashTable<String, InformationItem *> IIHashMap;
+typedef GraphIndex<InformationItem *> IIHashMap;
 /** @brief An iterator to a Click's HashTable of Click's Strings mapped to an InformationItem.
  */
 typedef IIHashMap::iterator IIHashMapIter;
-/** @brief A Click's HashTable of Click's Strings mapped to pointers to Scopes.
+/** @brief A GraphIndex (see idtrie.hh) of full identifiers mapped to pointers to Scopes.
  */
-typedef HashTable<String, Scope *> ScopeHashMap;
+typedef GraphIndex<Scope *> ScopeHashMap;
 /** @brief An iterator Click's HashTable of Click's Strings mapped to pointers to Scopes.
  */
 typedef ScopeHashMap::iterator ScopeHashMapIter;
@@ -229,21 +206,27 @@ typedef PublisherHashMap::iterator PublisherHashMapIter;
 /**A Click's HashTable of pointers to RemoteHost mapped to a pointer to BABitvector.
  */
 typedef Pair<RemoteHost *, BABitvector *> RemoteHostBitVectorPair;
+/** @brief A Click's HashTable of pointers to RemoteHost mapped to a reference count.
+ */
+typedef HashTable<RemoteHost *, unsigned int> RemoteHostCountMap;
+/** @brief An iterator to a Click's HashTable of pointers to RemoteHost mapped to a reference count.
+ */
+typedef RemoteHostCountMap::iterator RemoteHostCountMapIter;
 /** @brief A Click's HashTable of integers mapped to pointers of LocalHost.
  */
 typedef HashTable<int, LocalHost *> PubSubIdx;
 /** @brief An iterator to a Click's HashTable of integers mapped to pointers of LocalHost.
  */
 typedef PubSubIdx::iterator PubSubIdxIter;
-/** @brief A Click's HashTable of Click's Strings mapped to an ActivePublication.
+/** @brief An IDIndex of full identifiers mapped to an ActivePublication.
  */
-typedef HashTable<String, ActivePublication *> ActivePub;
+typedef IDIndex<ActivePublication *> ActivePub;
 /** @brief An iterator to a Click's HashTable of Click's Strings mapped to an ActivePublication.
  */
 typedef ActivePub::iterator ActivePubIter;
-/** @brief A Click's HashTable of Click's Strings mapped to an ActiveSubscription.
+/** @brief An IDIndex of full identifiers mapped to an ActiveSubscription.
  */
-typedef HashTable<String, ActiveSubscription *> ActiveSub;
+typedef IDIndex<ActiveSubscription *> ActiveSub;
 /** @brief An iterator to a Click's HashTable of Click's Strings mapped to an ActiveSubscription.
  */
 typedef ActiveSub::iterator ActiveSubIter;
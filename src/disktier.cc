@@ -0,0 +1,296 @@
+/*Our Proposal
+ *the disk tier of the CacheUnit
+*/
+#include "disktier.hh"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+
+CLICK_DECLS
+
+DiskTier::DiskTier() : capacity(0), live_bytes(0), live_records(0), demotions(0), promotions(0), overwrites(0),\
+    map(NULL), fd(-1), head(0), oldest(NULL), newest(NULL), running(false), stopping(false)
+{
+    wakeup[0] = wakeup[1] = -1 ;
+    pthread_mutex_init(&lock, NULL) ;
+    pthread_cond_init(&cond, NULL) ;
+}
+
+DiskTier::~DiskTier()
+{
+    close() ;
+    pthread_mutex_destroy(&lock) ;
+    pthread_cond_destroy(&cond) ;
+}
+
+int DiskTier::open(const String& path, uint64_t _capacity, ErrorHandler* errh)
+{
+    capacity = _capacity - _capacity % DISK_RECORD_ALIGN ;
+    if(capacity == 0)
+        return errh->error("DISK_CAPACITY must be at least %d bytes", DISK_RECORD_ALIGN) ;
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600) ;
+    if(fd < 0)
+        return errh->error("cannot open DISK_FILE %s: %s", path.c_str(), strerror(errno)) ;
+    if(ftruncate(fd, capacity) < 0)
+        return errh->error("cannot resize DISK_FILE %s to %llu bytes: %s", path.c_str(), (unsigned long long) capacity, strerror(errno)) ;
+    void* m = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) ;
+    if(m == MAP_FAILED)
+        return errh->error("cannot map DISK_FILE %s: %s", path.c_str(), strerror(errno)) ;
+    map = (unsigned char*) m ;
+    if(pipe(wakeup) < 0)
+        return errh->error("cannot create the pipe of the disk tier: %s", strerror(errno)) ;
+    fcntl(wakeup[0], F_SETFL, O_NONBLOCK) ;
+    fcntl(wakeup[1], F_SETFL, O_NONBLOCK) ;
+    stopping = false ;
+    if(pthread_create(&thread, NULL, run, this) != 0)
+        return errh->error("cannot start the I/O thread of the disk tier") ;
+    running = true ;
+    return wakeup[0] ;
+}
+
+void DiskTier::close()
+{
+    if(running)
+    {
+        pthread_mutex_lock(&lock) ;
+        stopping = true ;
+        pthread_cond_signal(&cond) ;
+        pthread_mutex_unlock(&lock) ;
+        pthread_join(thread, NULL) ;
+        running = false ;
+    }
+    /*the thread finished everything it was given*/
+    Vector<DiskJob*> done ;
+    complete(done) ;
+    for(int i = 0 ; i < done.size() ; i++)
+    {
+        if(done[i]->packet != NULL)
+            done[i]->packet->kill() ;
+        for(int j = 0 ; j < done[i]->waiting.size() ; j++)
+            done[i]->waiting[j]->kill() ;
+        if(done[i]->buffer != NULL)
+            free(done[i]->buffer) ;
+        delete done[i] ;
+    }
+    while(oldest != NULL)
+        dropOldest() ;
+    index.clear() ;
+    reading.clear() ;
+    if(map != NULL)
+        munmap(map, capacity) ;
+    map = NULL ;
+    if(fd >= 0)
+        ::close(fd) ;
+    fd = -1 ;
+    for(int i = 0 ; i < 2 ; i++)
+    {
+        if(wakeup[i] >= 0)
+            ::close(wakeup[i]) ;
+        wakeup[i] = -1 ;
+    }
+}
+
+bool DiskTier::demote(const String& ID, Packet* packet, unsigned int offset, unsigned int length)
+{
+    uint64_t span = sizeof(DiskRecordHeader) + ID.length() + length ;
+    span = (span + DISK_RECORD_ALIGN - 1) & ~((uint64_t) DISK_RECORD_ALIGN - 1) ;
+    if(map == NULL || span > capacity || ID.length() > 0xFFFF)
+    {
+        packet->kill() ;
+        return false ;
+    }
+    if(head + span > capacity)
+    {
+        /*wrap: the records between head and the end are the oldest ones*/
+        while(oldest != NULL && oldest->offset >= head)
+            dropOldest() ;
+        head = 0 ;
+    }
+    while(oldest != NULL && oldest->offset >= head && oldest->offset < head + span)
+        dropOldest() ;
+    drop(ID) ;
+    DiskRecord* record = new DiskRecord() ;
+    record->ID = ID ;
+    record->offset = head ;
+    record->length = length ;
+    record->span = span ;
+    record->live = true ;
+    record->next = NULL ;
+    if(newest != NULL)
+        newest->next = record ;
+    else
+        oldest = record ;
+    newest = record ;
+    index.set(ID, record) ;
+    live_bytes += length ;
+    live_records++ ;
+    head += span ;
+    demotions++ ;
+
+    DiskJob* job = new DiskJob() ;
+    job->type = DiskJob::DISK_WRITE ;
+    job->ID = ID ;
+    job->offset = record->offset ;
+    job->length = length ;
+    job->packet = packet ;
+    job->payload_offset = offset ;
+    job->buffer = NULL ;
+    queue(job) ;
+    return true ;
+}
+
+void DiskTier::promote(DiskRecord* record, Packet* request)
+{
+    DiskJob* job = reading.get(record->ID) ;
+    if(job == NULL)
+    {
+        job = new DiskJob() ;
+        job->type = DiskJob::DISK_READ ;
+        job->ID = record->ID ;
+        job->offset = record->offset ;
+        job->length = record->length ;
+        job->packet = NULL ;
+        job->payload_offset = 0 ;
+        job->buffer = NULL ;
+        job->waiting.push_back(request) ;
+        reading.set(record->ID, job) ;
+        /*the jobs are done in order, so the record is read before the log wraps over it*/
+        queue(job) ;
+        return ;
+    }
+    job->waiting.push_back(request) ;
+}
+
+void DiskTier::drop(const String& ID)
+{
+    DiskRecord* record = index.get(ID) ;
+    if(record == NULL)
+        return ;
+    record->live = false ;
+    live_bytes -= record->length ;
+    live_records-- ;
+    index.erase(ID) ;
+}
+
+void DiskTier::dropOldest()
+{
+    DiskRecord* record = oldest ;
+    if(record->live)
+    {
+        overwrites++ ;
+        drop(record->ID) ;
+    }
+    oldest = record->next ;
+    if(oldest == NULL)
+        newest = NULL ;
+    delete record ;
+}
+
+void DiskTier::queue(DiskJob* job)
+{
+    pthread_mutex_lock(&lock) ;
+    pending.push_back(job) ;
+    pthread_cond_signal(&cond) ;
+    pthread_mutex_unlock(&lock) ;
+}
+
+void DiskTier::complete(Vector<DiskJob*>& done)
+{
+    char bytes[64] ;
+    if(wakeup[0] >= 0)
+    {
+        while(read(wakeup[0], bytes, sizeof(bytes)) > 0)
+            ;
+    }
+    pthread_mutex_lock(&lock) ;
+    for(int i = 0 ; i < finished.size() ; i++)
+        done.push_back(finished[i]) ;
+    finished.clear() ;
+    pthread_mutex_unlock(&lock) ;
+    for(int i = 0 ; i < done.size() ; i++)
+    {
+        if(done[i]->type == DiskJob::DISK_READ && reading.get(done[i]->ID) == done[i])
+        {
+            reading.erase(done[i]->ID) ;
+            if(done[i]->buffer != NULL)
+            {
+                /*the item goes back to memory*/
+                promotions++ ;
+                drop(done[i]->ID) ;
+            }
+        }
+    }
+}
+
+void* DiskTier::run(void* arg)
+{
+    ((DiskTier*) arg)->work() ;
+    return NULL ;
+}
+
+void DiskTier::work()
+{
+    Vector<DiskJob*> jobs ;
+    long page = sysconf(_SC_PAGESIZE) ;
+    while(true)
+    {
+        pthread_mutex_lock(&lock) ;
+        while(pending.empty() && !stopping)
+            pthread_cond_wait(&cond, &lock) ;
+        if(pending.empty())
+        {
+            pthread_mutex_unlock(&lock) ;
+            break ;
+        }
+        jobs.swap(pending) ;
+        pthread_mutex_unlock(&lock) ;
+        for(int i = 0 ; i < jobs.size() ; i++)
+        {
+            DiskJob* job = jobs[i] ;
+            unsigned char* record = map + job->offset ;
+            DiskRecordHeader header ;
+            if(job->type == DiskJob::DISK_WRITE)
+            {
+                header.magic = DISK_RECORD_MAGIC ;
+                header.length = job->length ;
+                header.id_length = job->ID.length() ;
+                header.reserved = 0 ;
+                memcpy(record, &header, sizeof(header)) ;
+                memcpy(record+sizeof(header), job->ID.data(), job->ID.length()) ;
+                memcpy(record+sizeof(header)+job->ID.length(), job->packet->data()+job->payload_offset, job->length) ;
+                /*start the writeback, the pages stay in the page cache*/
+                uintptr_t start = (uintptr_t) record & ~((uintptr_t) page - 1) ;
+                msync((void*) start, (uintptr_t) record + sizeof(header) + job->ID.length() + job->length - start, MS_ASYNC) ;
+            }
+            else
+            {
+                memcpy(&header, record, sizeof(header)) ;
+                if(header.magic == DISK_RECORD_MAGIC && header.length == job->length && header.id_length == job->ID.length() &&\
+                   memcmp(record+sizeof(header), job->ID.data(), job->ID.length()) == 0 && (job->buffer = (char*) malloc(job->length > 0 ? job->length : 1)) != NULL)
+                {
+                    memcpy(job->buffer, record+sizeof(header)+job->ID.length(), job->length) ;
+                }
+            }
+        }
+        pthread_mutex_lock(&lock) ;
+        for(int i = 0 ; i < jobs.size() ; i++)
+            finished.push_back(jobs[i]) ;
+        pthread_mutex_unlock(&lock) ;
+        jobs.clear() ;
+        if(write(wakeup[1], "", 1) < 0)
+        {
+            /*the pipe is full, the CacheUnit has been woken up already*/
+        }
+    }
+}
+
+CLICK_ENDDECLS
+
+ELEMENT_REQUIRES(userlevel)
+ELEMENT_PROVIDES(DiskTier)
+ELEMENT_LIBS(-lpthread)
@@ -0,0 +1,133 @@
+#ifndef DISKTIER_HH_INCLUDED
+#define DISKTIER_HH_INCLUDED
+
+#include <click/config.h>
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <click/hashtable.hh>
+#include <click/packet.hh>
+#include <click/error.hh>
+
+#include <pthread.h>
+
+CLICK_DECLS
+
+/**@brief Our proposal the magic number of a record of the disk tier*/
+#define DISK_RECORD_MAGIC 0xBADD15C0
+/**@brief Our proposal the records of the disk tier are aligned to this many bytes*/
+#define DISK_RECORD_ALIGN 8
+
+/**@brief Our proposal the header of a record in the log of the disk tier, followed by the full ID and the payload*/
+struct DiskRecordHeader
+{
+    uint32_t magic ;
+    uint32_t length ;
+    uint16_t id_length ;
+    uint16_t reserved ;
+};
+
+/**@brief Our proposal a record of the log: where it is and, while it is live, the item it holds.
+ * A record that was promoted or replaced is dead, its space is only reused when the log wraps over it*/
+class DiskRecord
+{
+public:
+    String ID ;
+    uint64_t offset ;
+    /**@brief the payload length and the bytes the record takes in the log*/
+    uint32_t length ;
+    uint32_t span ;
+    bool live ;
+    /**@brief the next (newer) record of the log*/
+    DiskRecord* next ;
+};
+
+/**@brief Our proposal a request of the CacheUnit to the I/O thread of the disk tier.
+ * A demotion writes the payload of a (cloned) packet to the log, a promotion copies a record to a buffer; both come back to the CacheUnit (complete()),
+ * which kills the packet and builds the item of a promotion and serves the subinfo requests that waited for it*/
+class DiskJob
+{
+public:
+    enum {DISK_WRITE, DISK_READ} ;
+    int type ;
+    String ID ;
+    uint64_t offset ;
+    uint32_t length ;
+    /**@brief the payload to write (at payload_offset in packet)*/
+    Packet* packet ;
+    unsigned int payload_offset ;
+    /**@brief the payload that was read (malloc'ed by the I/O thread, freed by the CacheUnit) or NULL if the record was corrupt*/
+    char* buffer ;
+    /**@brief the requests that wait for a promotion*/
+    Vector<Packet*> waiting ;
+};
+
+/**@brief Our proposal the second tier of the CacheUnit: a log structured file (DISK_FILE, mmap'ed) with an index of full IDs in memory.
+ *
+ * Items evicted from memory are appended to the log (demoted) and read back when they are hit (promoted), a promoted record is dropped from the index.
+ * When the log is full it wraps and the oldest records are overwritten, so the tier is FIFO and never needs compaction.
+ * The memory copies to and from the mapped file (and the page faults and writeback they cause) are made by an I/O thread, never in push():
+ * the CacheUnit queues jobs and collects them when the thread wakes it up through a pipe (selected).
+ * The index is not persistent, the log starts empty at every start.
+ */
+class DiskTier
+{
+public:
+    DiskTier() ;
+    ~DiskTier() ;
+    /**@brief creates (or truncates) the file of capacity bytes, maps it and starts the I/O thread.
+     * @return the file descriptor the CacheUnit selects to collect the finished jobs, or -1 on error*/
+    int open(const String& path, uint64_t capacity, ErrorHandler* errh) ;
+    /**@brief stops the I/O thread, unmaps the file and kills the packets of the finished and pending jobs*/
+    void close() ;
+    /**@brief returns the live record of ID or NULL*/
+    inline DiskRecord* find(const String& ID)
+    {
+        return index.get(ID) ;
+    }
+    /**@brief appends the item ID (length bytes at offset in packet, a reference the tier keeps until the write is done) to the log.
+     * Returns false (and kills packet) if the record is larger than the log*/
+    bool demote(const String& ID, Packet* packet, unsigned int offset, unsigned int length) ;
+    /**@brief reads the record back for request (which is returned with the finished job); a record that is being read already only gets the request added*/
+    void promote(DiskRecord* record, Packet* request) ;
+    /**@brief drops the record of ID (if any) from the index: the item is in memory again*/
+    void drop(const String& ID) ;
+    /**@brief moves the finished jobs to done (called when the fd of open() is readable)*/
+    void complete(Vector<DiskJob*>& done) ;
+    /**@brief the capacity, the payload bytes and number of the live records*/
+    uint64_t capacity ;
+    uint64_t live_bytes ;
+    unsigned int live_records ;
+    /*statistics*/
+    uint64_t demotions ;
+    uint64_t promotions ;
+    /**@brief live records overwritten by the log*/
+    uint64_t overwrites ;
+private:
+    static void* run(void* arg) ;
+    void work() ;
+    /**@brief unlinks and deletes the oldest record*/
+    void dropOldest() ;
+    void queue(DiskJob* job) ;
+    unsigned char* map ;
+    int fd ;
+    /**@brief the pipe the I/O thread writes a byte to when it finishes jobs*/
+    int wakeup[2] ;
+    /**@brief where the next record is written*/
+    uint64_t head ;
+    DiskRecord* oldest ;
+    DiskRecord* newest ;
+    HashTable<String, DiskRecord*> index ;
+    /**@brief the promotions in progress by ID*/
+    HashTable<String, DiskJob*> reading ;
+    /**@brief the jobs for and from the I/O thread (under lock)*/
+    Vector<DiskJob*> pending ;
+    Vector<DiskJob*> finished ;
+    pthread_t thread ;
+    pthread_mutex_t lock ;
+    pthread_cond_t cond ;
+    bool running ;
+    bool stopping ;
+};
+
+CLICK_ENDDECLS
+#endif // DISKTIER_HH_INCLUDED
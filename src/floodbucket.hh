@@ -0,0 +1,49 @@
+#ifndef FLOODBUCKET_HH_INCLUDED
+#define FLOODBUCKET_HH_INCLUDED
+
+#include <click/config.h>
+#include <click/timestamp.hh>
+
+CLICK_DECLS
+
+/**@brief Our proposal a token bucket that limits flooded requests (per LocalHost and per node in the LocalProxy, per ingress link in the Forwarder).
+ *
+ * It refills rate tokens per second up to burst and every flood takes one. A rate of 0 never limits.
+ * The credit is kept in microseconds (a token is worth 1000000 / rate of them), so that it needs no floating point in the kernel.
+ */
+class FloodBucket {
+public:
+    FloodBucket() : credit(0), primed(false) {}
+    /**@brief takes a token if there is one at @a now and returns true, or returns false (the flood must be dropped).*/
+    inline bool take(uint32_t rate, uint32_t burst, const Timestamp &now) {
+        if (rate == 0) {
+            return true;
+        }
+        uint64_t cost = 1000000 / rate;
+        uint64_t full = cost * (burst > 0 ? burst : 1);
+        if (!primed) {
+            /*a new bucket starts full*/
+            credit = full;
+            primed = true;
+        } else if (now > last) {
+            Timestamp elapsed = now - last;
+            credit += (uint64_t) elapsed.sec() * 1000000 + elapsed.usec();
+            if (credit > full) {
+                credit = full;
+            }
+        }
+        last = now;
+        if (credit < cost) {
+            return false;
+        }
+        credit -= cost;
+        return true;
+    }
+private:
+    uint64_t credit;
+    Timestamp last;
+    bool primed;
+};
+
+CLICK_ENDDECLS
+#endif // FLOODBUCKET_HH_INCLUDED
@@ -13,6 +13,18 @@
  */
 
 #include "forwarder.hh"
+#include "trace.hh"
+#include "telemetry.hh"
+#include "baheader.hh"
+#include <click/straccum.hh>
+#include <click/packet_anno.hh>
+#if CLICK_LINUXMODULE
+#include <click/cxxprotect.h>
+CLICK_CXX_PROTECT
+#include <linux/skbuff.h>
+CLICK_CXX_UNPROTECT
+#include <click/cxxunprotect.h>
+#endif
 
 CLICK_DECLS
 
@@ -42,8 +54,8 @@ ForwardingEntry::~ForwardingEntry() {
     }
 }
 
-Forwarder::Forwarder() {
-
+Forwarder::Forwarder() : stats_timer(this), load_timer(this) {
+    lidTable = NULL;
 }
 
 Forwarder::~Forwarder() {
@@ -52,25 +64,11 @@ Forwarder::~Forwarder() {
 
 int Forwarder::configure(Vector<String> &conf, ErrorHandler *errh) {
     int port;
-    int reverse_proto;
-    int reverse_probing ;
-    int reverse_subinfo ;
-    int reverse_datapush ;
-    int reverse_kanycast ;
     gc = (GlobalConf *) cp_element(conf[0], this);
     _id = 0;
+    link_len = LinkHeader::length(gc->use_mac);
     click_chatter("*****************************************************FORWARDER CONFIGURATION*****************************************************");
     click_chatter("Forwarder: internal LID: %s", gc->iLID.to_string().c_str());
-    cp_integer(String("0x080a"), 16, &reverse_proto);
-    cp_integer(String("0x080b"), 16, &reverse_subinfo) ;//our propsal ethernet type for subscribe information item
-    cp_integer(String("0x080c"), 16, &reverse_probing) ;//our proposal ethernet type for probing
-    cp_integer(String("0x080d"), 16, &reverse_datapush) ;//our proposal ethernet type for data pushing
-    cp_integer(String("0x0901"), 16, &reverse_kanycast) ;
-    proto_type = htons(reverse_proto);
-    subinfo_type = htons(reverse_subinfo) ;
-    probing_type = htons(reverse_probing) ;
-    datapush_type = htons(reverse_datapush) ;
-    kanycast_type = htons(reverse_kanycast) ;
     if (gc->use_mac == true) {
         cp_integer(conf[1], &number_of_links);
         click_chatter("Forwarder: Number of Links: %d", number_of_links);
@@ -84,16 +82,11 @@ int Forwarder::configure(Vector<String> &conf, ErrorHandler *errh) {
             fe->src = src;
             fe->dst = dst;
             fe->port = port;
-            fe->LID = new BABitvector(FID_LEN * 8);
-            for (int j = 0; j < conf[5 + 4 * i].length(); j++) {
-		//assign LID
-                if (conf[5 + 4 * i].at(j) == '1') {
-                    (*fe->LID)[conf[5 + 4 * i].length() - j - 1] = true;
-                } else {
-                    (*fe->LID)[conf[5 + 4 * i].length() - j - 1] = false;
-                }
-            }
+            fe->index = i;
             fwTable.push_back(fe);
+            if (parseLIDs(conf[5 + 4 * i], fe, i, errh) < 0) {
+                return -1;
+            }
             if (port != 0) {
       //          click_chatter("Forwarder: Added forwarding entry: port %d - source MAC: %s - destination MAC: %s - LID: %s", fe->port, fe->src->unparse().c_str(), fe->dst->unparse().c_str(), fe->LID->to_string().c_str());
             } else {
@@ -113,18 +106,88 @@ int Forwarder::configure(Vector<String> &conf, ErrorHandler *errh) {
             fe->src_ip = src_ip;
             fe->dst_ip = dst_ip;
             fe->port = port;
-            fe->LID = new BABitvector(FID_LEN * 8);
-            for (int j = 0; j < conf[5 + 4 * i].length(); j++) {
-                if (conf[5 + 4 * i].at(j) == '1') {
-                    (*fe->LID)[conf[5 + 4 * i].length() - j - 1] = true;
-                } else {
-                    (*fe->LID)[conf[5 + 4 * i].length() - j - 1] = false;
-                }
-            }
+            fe->index = i;
+            LinkHeader::prepare_ip(fe->ip_template, src_ip->in_addr(), dst_ip->in_addr());
             fwTable.push_back(fe);
+            if (parseLIDs(conf[5 + 4 * i], fe, i, errh) < 0) {
+                return -1;
+            }
          //   click_chatter("Forwarder: Added forwarding entry: port %d - source IP: %s - destination IP: %s - LID: %s", fe->port, fe->src_ip->unparse().c_str(), fe->dst_ip->unparse().c_str(), fe->LID->to_string().c_str());
         }
     }
+    /*pack all LIDs in a contiguous table for the fast path
+     *the table is sorted by output port so that the copies of a multicast packet are pushed to each ToDevice back to back*/
+    lid_tables = (fwTable.size() > 0) ? fwTable[0]->tableLIDs.size() + 1 : 1;
+    lid_table_bits = 0;
+    while ((1 << lid_table_bits) < lid_tables) {
+        lid_table_bits++;
+    }
+    if ((1 << lid_table_bits) != lid_tables) {
+        return errh->error("the number of LID tables (%d) must be a power of 2", lid_tables);
+    }
+    lidTable = new LIDMatchEntry[fwTable.size() > 0 ? lid_tables * fwTable.size() : 1];
+    for (int i = 0; i < fwTable.size(); i++) {
+        if (fwTable[i]->tableLIDs.size() + 1 != lid_tables) {
+            return errh->error("link %d has %d LID tables...link 0 has %d", i, fwTable[i]->tableLIDs.size() + 1, lid_tables);
+        }
+        LIDMatchEntry entry;
+        entry.mask = read_fid((const unsigned char *) fwTable[i]->LID->_data);
+        entry.port = fwTable[i]->port;
+        entry.index = i;
+        int j = i;
+        while (j > 0 && lidTable[j - 1].port > entry.port) {
+            lidTable[j] = lidTable[j - 1];
+            j--;
+        }
+        lidTable[j] = entry;
+    }
+    /*our proposal the other LID tables follow, in the same (port) order*/
+    for (int t = 1; t < lid_tables; t++) {
+        for (int j = 0; j < fwTable.size(); j++) {
+            LIDMatchEntry entry = lidTable[j];
+            entry.mask = read_fid((const unsigned char *) fwTable[entry.index]->tableLIDs[t - 1]._data);
+            lidTable[t * fwTable.size() + j] = entry;
+        }
+    }
+    iLID_mask = read_fid((const unsigned char *) gc->iLID._data);
+    /*the keywords after the links*/
+    Vector<String> keywords;
+    for (int i = 2 + 4 * number_of_links; i < conf.size(); i++) {
+        keywords.push_back(conf[i]);
+    }
+    stats_interval = 1000;
+    load_interval = 0;
+    String checksum = String("FULL");
+    relay_flood_rate = 0;
+    relay_flood_burst = 16;
+    if (cp_va_kparse(keywords, this, errh,
+            "STATS_FILE", 0, cpFilename, &stats_file,
+            "STATS_INTERVAL", 0, cpSecondsAsMilli, &stats_interval,
+            "UDP_CHECKSUM", 0, cpWord, &checksum,
+            "RELAY_FLOOD_RATE", 0, cpUnsigned, &relay_flood_rate,
+            "RELAY_FLOOD_BURST", 0, cpUnsigned, &relay_flood_burst,
+            "LOAD_REPORT", 0, cpSecondsAsMilli, &load_interval,
+            cpEnd) < 0) {
+        return -1;
+    }
+    if (load_interval > 0 && number_of_links > FORWARDER_MAX_LINKS) {
+        return errh->error("LOAD_REPORT counts the bytes of at most %d links...there are %d", FORWARDER_MAX_LINKS, number_of_links);
+    }
+    if (checksum.equals("FULL", -1)) {
+        udp_csum = LINK_UDP_CSUM_FULL;
+    } else if (checksum.equals("NONE", -1)) {
+        udp_csum = LINK_UDP_CSUM_NONE;
+    } else if (checksum.equals("OFFLOAD", -1)) {
+#if CLICK_LINUXMODULE
+        udp_csum = LINK_UDP_CSUM_OFFLOAD;
+#else
+        /*the raw socket sends the datagrams as they are*/
+        errh->warning("UDP_CHECKSUM OFFLOAD needs kernel click, using NONE");
+        udp_csum = LINK_UDP_CSUM_NONE;
+#endif
+    } else {
+        return errh->error("UDP_CHECKSUM must be FULL, NONE or OFFLOAD");
+    }
     click_chatter("*********************************************************************************************************************************");
     //click_chatter("Forwarder: Configured!");
     return 0;
@@ -132,13 +195,17 @@ int Forwarder::configure(Vector<String> &conf, ErrorHandler *errh) {
 
 int Forwarder::initialize(ErrorHandler *errh) {
     //click_chatter("Forwarder: Initialized!");
-    /*for data collection*/
-    no_req = 0 ;
-    req_size = 0 ;
-    data_size = 0 ;
-    total_throughput = 0 ;
-    GB_ds = 0 ;
-    GB_tt = 0 ;
+    memset(stats, 0, sizeof(stats));
+    flood_seen_head = 0;
+    stats_timer.initialize(this);
+    if (stats_file && stats_interval > 0) {
+        stats_timer.schedule_after_msec(stats_interval);
+    }
+    load_reported.assign(fwTable.size(), 0);
+    load_timer.initialize(this);
+    if (load_interval > 0) {
+        load_timer.schedule_after_msec(load_interval);
+    }
     return 0;
 }
 
@@ -148,16 +215,348 @@ void Forwarder::cleanup(CleanupStage stage) {
             ForwardingEntry *fe = fwTable.at(i);
             delete fe;
         }
+        delete [] lidTable;
+        lidTable = NULL;
     }
+    stats_timer.clear();
+    load_timer.clear();
     click_chatter("Forwarder: Cleaned Up!");
-    /*for data collection*/
-    int fd ;
-    fd = open("/tmp/flooding.dat", O_RDWR|O_CREAT|O_TRUNC, S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP) ;
-    char input[100] ;
-    sprintf(input, "no_req: %d\nreq_size: %d\nGB_ds: %d\ndata_size: %d\nGB_tt: %d\nthroughput: %d",\
-    no_req, req_size, GB_ds, data_size, GB_tt, total_throughput) ;
-    write(fd, input, strlen(input)) ;
-    close(fd) ;
+}
+
+void Forwarder::sumStats(ForwarderStats &total) const {
+    memset(&total, 0, sizeof(total));
+    for (int t = 0; t < FORWARDER_MAX_THREADS; t++) {
+        const ForwarderStats &s = stats[t];
+        for (int i = 0; i < FORWARDER_MAX_PORTS; i++) {
+            total.rx[i].packets += s.rx[i].packets;
+            total.rx[i].bytes += s.rx[i].bytes;
+            total.tx[i].packets += s.tx[i].packets;
+            total.tx[i].bytes += s.tx[i].bytes;
+        }
+        for (int i = 0; i < FORWARDER_MAX_LINKS; i++) {
+            total.tx_link[i].packets += s.tx_link[i].packets;
+            total.tx_link[i].bytes += s.tx_link[i].bytes;
+        }
+        for (int i = 0; i < FW_ETHERTYPES; i++) {
+            total.tx_ether[i].packets += s.tx_ether[i].packets;
+            total.tx_ether[i].bytes += s.tx_ether[i].bytes;
+        }
+        total.flood_duplicates += s.flood_duplicates;
+        total.flood_limited += s.flood_limited;
+    }
+}
+
+static void unparse_counters(StringAccum &sa, const char *name, const ForwarderCounter *c, int n) {
+    sa << '"' << name << "\":[";
+    for (int i = 0; i < n; i++) {
+        sa << (i ? "," : "") << "{\"packets\":" << c[i].packets << ",\"bytes\":" << c[i].bytes << '}';
+    }
+    sa << ']';
+}
+
+String Forwarder::unparseStats() const {
+    static const char *ether_names[FW_ETHERTYPES] = {"pub", "subinfo", "probing", "datapush", "kanycast", "other"};
+    ForwarderStats total;
+    StringAccum sa;
+    sumStats(total);
+    sa << "{\"time\":" << Timestamp::now() << ',';
+    unparse_counters(sa, "rx", total.rx, ninputs() < FORWARDER_MAX_PORTS ? ninputs() : FORWARDER_MAX_PORTS);
+    sa << ',';
+    unparse_counters(sa, "tx", total.tx, noutputs() < FORWARDER_MAX_PORTS ? noutputs() : FORWARDER_MAX_PORTS);
+    sa << ",\"ethertypes\":{";
+    for (int i = 0; i < FW_ETHERTYPES; i++) {
+        sa << (i ? "," : "") << '"' << ether_names[i] << "\":{\"packets\":" << total.tx_ether[i].packets << ",\"bytes\":" << total.tx_ether[i].bytes << '}';
+    }
+    sa << "},\"flood_duplicates\":" << total.flood_duplicates << ",\"flood_limited\":" << total.flood_limited << '}';
+    return sa.take_string();
+}
+
+enum {H_STATS, H_RX_PACKETS, H_RX_BYTES, H_TX_PACKETS, H_TX_BYTES, H_FLOOD_REQUESTS, H_FLOOD_BYTES, H_DATA_BYTES, H_FLOOD_DUPLICATES, H_FLOOD_LIMITED, H_RESET_STATS};
+
+String Forwarder::read_handler(Element *e, void *thunk) {
+    Forwarder *fw = (Forwarder *) e;
+    ForwarderStats total;
+    StringAccum sa;
+    int inputs = fw->ninputs() < FORWARDER_MAX_PORTS ? fw->ninputs() : FORWARDER_MAX_PORTS;
+    int outputs = fw->noutputs() < FORWARDER_MAX_PORTS ? fw->noutputs() : FORWARDER_MAX_PORTS;
+    fw->sumStats(total);
+    switch ((intptr_t) thunk) {
+        case H_STATS:
+            return fw->unparseStats();
+        case H_RX_PACKETS:
+            for (int i = 0; i < inputs; i++)
+                sa << (i ? " " : "") << total.rx[i].packets;
+            return sa.take_string();
+        case H_RX_BYTES:
+            for (int i = 0; i < inputs; i++)
+                sa << (i ? " " : "") << total.rx[i].bytes;
+            return sa.take_string();
+        case H_TX_PACKETS:
+            for (int i = 0; i < outputs; i++)
+                sa << (i ? " " : "") << total.tx[i].packets;
+            return sa.take_string();
+        case H_TX_BYTES:
+            for (int i = 0; i < outputs; i++)
+                sa << (i ? " " : "") << total.tx[i].bytes;
+            return sa.take_string();
+        case H_FLOOD_REQUESTS:
+            return String(total.tx_ether[FW_ETHER_KANYCAST].packets);
+        case H_FLOOD_BYTES:
+            return String(total.tx_ether[FW_ETHER_KANYCAST].bytes);
+        case H_DATA_BYTES:
+            return String(total.tx_ether[FW_ETHER_DATAPUSH].bytes);
+        case H_FLOOD_DUPLICATES:
+            return String(total.flood_duplicates);
+        case H_FLOOD_LIMITED:
+            return String(total.flood_limited);
+        default:
+            return String();
+    }
+}
+
+int Forwarder::write_handler(const String &, Element *e, void *thunk, ErrorHandler *) {
+    Forwarder *fw = (Forwarder *) e;
+    switch ((intptr_t) thunk) {
+        case H_RESET_STATS:
+            memset(fw->stats, 0, sizeof(fw->stats));
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+void Forwarder::add_handlers() {
+    add_read_handler("stats", read_handler, (void *) H_STATS);
+    add_read_handler("rx_packets", read_handler, (void *) H_RX_PACKETS);
+    add_read_handler("rx_bytes", read_handler, (void *) H_RX_BYTES);
+    add_read_handler("tx_packets", read_handler, (void *) H_TX_PACKETS);
+    add_read_handler("tx_bytes", read_handler, (void *) H_TX_BYTES);
+    add_read_handler("flood_requests", read_handler, (void *) H_FLOOD_REQUESTS);
+    add_read_handler("flood_bytes", read_handler, (void *) H_FLOOD_BYTES);
+    add_read_handler("data_bytes", read_handler, (void *) H_DATA_BYTES);
+    add_read_handler("flood_duplicates", read_handler, (void *) H_FLOOD_DUPLICATES);
+    add_read_handler("flood_limited", read_handler, (void *) H_FLOOD_LIMITED);
+    add_write_handler("reset_stats", write_handler, (void *) H_RESET_STATS);
+}
+
+void Forwarder::run_timer(Timer *timer) {
+    if (timer == &load_timer) {
+        reportLoad();
+        load_timer.reschedule_after_msec(load_interval);
+        return;
+    }
+#if CLICK_USERLEVEL
+    FILE *f = fopen(stats_file.c_str(), "a");
+    if (f != NULL) {
+        String line = unparseStats();
+        fwrite(line.data(), 1, line.length(), f);
+        fputc('\n', f);
+        fclose(f);
+    } else {
+        BA_TRACE(TRACE_FORWARDER, TRACE_ERROR, "cannot open STATS_FILE %s", stats_file.c_str());
+    }
+#endif
+    stats_timer.reschedule_after_msec(stats_interval);
+}
+
+void Forwarder::reportLoad() {
+    ForwarderStats total;
+    unsigned char no_ids = 1;
+    unsigned char id_len = gc->nodeTMScope.length() / PURSUIT_ID_LEN;
+    unsigned char type = TOPOLOGY_LINK_LOAD;
+    uint32_t interval = load_interval;
+    uint16_t no_links = fwTable.size();
+    uint32_t header_len = FID_LEN + sizeof (no_ids) + sizeof (id_len) + gc->nodeTMScope.length();
+    uint32_t index = header_len + sizeof (type) + PURSUIT_ID_LEN + sizeof (interval) + sizeof (no_links);
+    sumStats(total);
+    WritablePacket *p = Packet::make(50, NULL, index + no_links * (FID_LEN + sizeof (uint64_t)), 0);
+    if (p == NULL) {
+        return;
+    }
+    /*the publication, as the LocalProxy sends it: the FID to all TM replicas and the identifier /FFFFFFFFFFFFFFFE/NODEID*/
+    memcpy(p->data(), gc->tmAllFID._data, FID_LEN);
+    memcpy(p->data() + FID_LEN, &no_ids, sizeof (no_ids));
+    memcpy(p->data() + FID_LEN + sizeof (no_ids), &id_len, sizeof (id_len));
+    memcpy(p->data() + FID_LEN + sizeof (no_ids) + sizeof (id_len), gc->nodeTMScope.data(), gc->nodeTMScope.length());
+    /*the update*/
+    memcpy(p->data() + header_len, &type, sizeof (type));
+    memcpy(p->data() + header_len + sizeof (type), gc->nodeID.data(), PURSUIT_ID_LEN);
+    memcpy(p->data() + header_len + sizeof (type) + PURSUIT_ID_LEN, &interval, sizeof (interval));
+    memcpy(p->data() + header_len + sizeof (type) + PURSUIT_ID_LEN + sizeof (interval), &no_links, sizeof (no_links));
+    for (int i = 0; i < fwTable.size(); i++) {
+        uint64_t bytes = total.tx_link[i].bytes;
+        /*the counters start again from 0 when the stats are reset*/
+        uint64_t sent = (bytes >= load_reported[i]) ? bytes - load_reported[i] : bytes;
+        load_reported[i] = bytes;
+        memcpy(p->data() + index, fwTable[i]->LID->_data, FID_LEN);
+        memcpy(p->data() + index + FID_LEN, &sent, sizeof (sent));
+        index += FID_LEN + sizeof (sent);
+    }
+    FIDMask fid = read_fid((const unsigned char *) gc->tmAllFID._data);
+    Vector<ForwardingEntry *> out_links;
+    matchLIDs(fid, out_links);
+    if (lid_match(fid, iLID_mask)) {
+        /*a TM (replica) runs here*/
+        if (out_links.size() == 0) {
+            p->pull(FID_LEN);
+            output(0).push(p);
+            return;
+        }
+        Packet *local = p->clone();
+        if (local != NULL) {
+            local->pull(FID_LEN);
+            output(0).push(local);
+        }
+    }
+    if (out_links.size() == 0) {
+        p->kill();
+        return;
+    }
+    WritablePacket *frame = pushLinkHeader(p, FW_ETHER_PUB);
+    if (frame == NULL) {
+        return;
+    }
+    uint16_t psum = linkPayloadSum(frame);
+    for (int i = 0; i < out_links.size(); i++) {
+        WritablePacket *copy = linkCopy(frame, i == out_links.size() - 1);
+        if (copy == NULL) {
+            continue;
+        }
+        addressLink(copy, out_links[i], FW_ETHER_PUB, psum);
+        countTx(out_links[i], FW_ETHER_PUB, copy->length());
+        output(out_links[i]->port).push(copy);
+    }
+}
+
+int Forwarder::parseLIDs(const String &lids, ForwardingEntry *fe, int link, ErrorHandler *errh) {
+    /*our proposal the LIDs of all LID tables separated by ':' - the first one is the LID of table 0*/
+    int start = 0;
+    for (int table = 0; start <= lids.length(); table++) {
+        int end = lids.find_left(':', start);
+        if (end < 0) {
+            end = lids.length();
+        }
+        String lid = lids.substring(start, end - start);
+        if (lid.length() != FID_LEN * 8) {
+            return errh->error("the LID of link %d (table %d) should be %d bits...it is %d bits (is the node built with the FID_LEN of the deployment?)", link, table, FID_LEN * 8, lid.length());
+        }
+        BABitvector bv(FID_LEN * 8);
+        for (int j = 0; j < lid.length(); j++) {
+            //assign LID
+            bv[lid.length() - j - 1] = (lid.at(j) == '1');
+        }
+        if (table == 0) {
+            fe->LID = new BABitvector(bv);
+        } else {
+            fe->tableLIDs.push_back(bv);
+        }
+        start = end + 1;
+    }
+    return 0;
+}
+
+void Forwarder::matchLIDs(const FIDMask &fid, Vector<ForwardingEntry *> &out_links) {
+    int i = 0;
+    int size = fwTable.size();
+    /*our proposal the top bits of the FID select the LID table*/
+    const LIDMatchEntry *table = lidTable + fidTable(fid) * size;
+#if FORWARDER_SIMD
+    if (FID_WORDS == 1 && size >= FORWARDER_SIMD_MIN_LINKS) {
+        /*64-bit FIDs: each 256-bit load holds two LIDMatchEntry (mask, port/index) - only the mask lanes (0 and 2) are checked*/
+        __m256i f = _mm256_set1_epi64x((long long) fid.w[0]);
+        for (; i + 4 <= size; i += 4) {
+            __m256i e0 = _mm256_loadu_si256((const __m256i *) (table + i));
+            __m256i e1 = _mm256_loadu_si256((const __m256i *) (table + i + 2));
+            int m0 = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(e0, f), e0)));
+            int m1 = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(e1, f), e1)));
+            if (m0 & 1) out_links.push_back(fwTable[table[i].index]);
+            if (m0 & 4) out_links.push_back(fwTable[table[i + 1].index]);
+            if (m1 & 1) out_links.push_back(fwTable[table[i + 2].index]);
+            if (m1 & 4) out_links.push_back(fwTable[table[i + 3].index]);
+        }
+    }
+#endif
+    for (; i < size; i++) {
+        if (lid_match(fid, table[i].mask)) {
+            out_links.push_back(fwTable[table[i].index]);
+        }
+    }
+}
+
+uint32_t Forwarder::floodStampOffset(const unsigned char *data, uint32_t length) {
+    /*FID | type | numberOfIDs | (IDLength, ID)* | EBF | IBF | reverse FID | stamp | ttl*/
+    BAHeader hdr;
+    if (!hdr.parse(data, length, FID_LEN + sizeof(unsigned char))) {
+        return 0;
+    }
+    uint32_t stamp = hdr.end() + EBFSIZE + IBFSIZE + FID_LEN;
+    if (stamp + FLOOD_STAMP_LEN + FLOOD_TTL_LEN > length) {
+        return 0;
+    }
+    return stamp;
+}
+
+bool Forwarder::floodSeen(const unsigned char *stamp) {
+    Timestamp now = Timestamp::now();
+    String key((const char *) stamp, FLOOD_STAMP_LEN);
+    /*expire the oldest entries first (they are kept in arrival order)*/
+    while (flood_seen_head < flood_seen_order.size()) {
+        String &oldest = flood_seen_order[flood_seen_head];
+        if (((now - flood_seen.get(oldest)).sec() < FLOOD_SEEN_LIFETIME) && (flood_seen.size() < FLOOD_SEEN_MAX)) {
+            break;
+        }
+        flood_seen.erase(oldest);
+        flood_seen_head++;
+    }
+    if (flood_seen_head > 0 && flood_seen_head * 2 >= flood_seen_order.size()) {
+        flood_seen_order.erase(flood_seen_order.begin(), flood_seen_order.begin() + flood_seen_head);
+        flood_seen_head = 0;
+    }
+    if (flood_seen.find(key) != flood_seen.end()) {
+        return true;
+    }
+    flood_seen.set(key, now);
+    flood_seen_order.push_back(key);
+    return false;
+}
+
+WritablePacket *Forwarder::pushLinkHeader(Packet *p, int cls) {
+    WritablePacket *frame = gc->use_mac ? p->push_mac_header(LINK_ETHER_LEN) : p->push(LINK_IP_LEN);
+    if (frame != NULL) {
+        LinkHeader::set_class(frame, cls, gc->use_mac);
+    }
+    return frame;
+}
+
+uint16_t Forwarder::linkPayloadSum(const Packet *frame) const {
+    return (!gc->use_mac && udp_csum == LINK_UDP_CSUM_FULL) ? LinkHeader::payload_sum(frame) : 0;
+}
+
+void Forwarder::addressLink(WritablePacket *p, ForwardingEntry *fe, int cls, uint16_t psum) {
+    if (gc->use_mac) {
+        /*destination MAC*/
+        memcpy(p->data(), fe->dst->data(), MAC_LEN);
+        /*source MAC*/
+        memcpy(p->data() + MAC_LEN, fe->src->data(), MAC_LEN);
+    } else {
+        LinkHeader::write_ip(p, fe->ip_template, _id.fetch_and_add(1), cls, udp_csum, psum);
+#if CLICK_LINUXMODULE
+        if (udp_csum == LINK_UDP_CSUM_OFFLOAD) {
+            skb_partial_csum_set(p->skb(), sizeof (click_ip), offsetof(click_udp, uh_sum));
+        }
+#endif
+    }
+    /*for the egress queues*/
+    SET_PAINT_ANNO(p, LinkHeader::traffic_class(cls));
+}
+
+bool Forwarder::arrivedOver(const Packet *p, const ForwardingEntry *fe) const {
+    if (gc->use_mac) {
+        /*the frame went from the destination of the entry to its source*/
+        return (memcmp(p->data(), fe->src->data(), MAC_LEN) == 0) && (memcmp(p->data() + MAC_LEN, fe->dst->data(), MAC_LEN) == 0);
+    }
+    const click_ip *ip = reinterpret_cast<const click_ip *> (p->data());
+    return (ip->ip_dst.s_addr == fe->src_ip->addr()) && (ip->ip_src.s_addr == fe->dst_ip->addr());
 }
 
 void Forwarder::push(int in_port, Packet *p) {
@@ -165,196 +564,132 @@ void Forwarder::push(int in_port, Packet *p) {
     WritablePacket *payload = NULL;
     ForwardingEntry *fe;
     Vector<ForwardingEntry *> out_links;
-    BABitvector FID(FID_LEN * 8);
-    BABitvector andVector(FID_LEN * 8);
+    FIDBitvector FID;
     Vector<ForwardingEntry *>::iterator out_links_it;
     int counter = 1;
     bool pushLocally = false;
-    click_ip *ip;
-    click_udp *udp;
+    threadStats().rx[in_port & (FORWARDER_MAX_PORTS - 1)].count(p->length());
     if (in_port == 0 || in_port == 2 || in_port == 4 || in_port == 5) {
+        int ether = (in_port == 0) ? FW_ETHER_PUB : (in_port == 2) ? FW_ETHER_PROBING : (in_port == 4) ? FW_ETHER_SUBINFO : FW_ETHER_DATAPUSH;
         /*0 for local packet, 2 for probing message , 4 for subinfo message, 5 for data push*/
+        Timestamp since = Telemetry::stamp(p, TELEMETRY_PROXY);
         memcpy(FID._data, p->data(), FID_LEN);
         //Check all entries in my forwarding table and forward appropriately
-        for (int i = 0; i < fwTable.size(); i++) {
-            fe = fwTable[i];
-            andVector = (FID)&(*fe->LID);
-            if (andVector == (*fe->LID)) {
-                out_links.push_back(fe);
-            }
-        }
+        matchLIDs(read_fid(p->data()), out_links);
         if (out_links.size() == 0) {
             /*I can get here when an app or a click element did publish_data with a specific FID
              *Note that I never check if I can push back the packet above if it matches my iLID
              * the upper elements should check before pushing*/
             p->kill();
-        }
-        for (out_links_it = out_links.begin(); out_links_it != out_links.end(); out_links_it++) {
-        	/*for data collection*/
-            int temp_tt = total_throughput ;
-            total_throughput += p->length() ;
-            if(total_throughput	< temp_tt)
-            	GB_tt++ ;
-            if (counter == out_links.size()) {
-                payload = p->uniqueify();
-            } else {
-                payload = p->clone()->uniqueify();
+        } else {
+            if (in_port == 2) {
+                /*our proposal protocol type 0x080c to be probing*/
+                BA_TRACE(TRACE_FORWARDER, TRACE_DEBUG, "sending out a probing message") ;
+            } else if (in_port == 4) {
+                /*our proposal protocol type 0x080b to be subinfo*/
+                BA_TRACE(TRACE_FORWARDER, TRACE_DEBUG, "sending out a subinfo request") ;
+            } else if (in_port == 5) {
+                BA_TRACE(TRACE_FORWARDER, TRACE_DEBUG, "sending out data") ;
             }
-            fe = *out_links_it;
-            if (gc->use_mac) {
-                newPacket = payload->push_mac_header(14);
-                /*prepare the mac header*/
-                /*destination MAC*/
-                memcpy(newPacket->data(), fe->dst->data(), MAC_LEN);
-                /*source MAC*/
-                memcpy(newPacket->data() + MAC_LEN, fe->src->data(), MAC_LEN);
-                if(in_port == 0)
-                {
-                    /*protocol type 0x080a*/
-                    memcpy(newPacket->data() + MAC_LEN + MAC_LEN, &proto_type, 2);
-                }
-                else if(in_port == 2)
-                {
-                    /*our proposal protocol type 0x080c to be probing*/
-                    click_chatter("fw: sending out a probing message") ;
-                    memcpy(newPacket->data() + MAC_LEN + MAC_LEN, &probing_type, 2);
-                }
-                else if(in_port == 4)
-                {
-                    /*our proposal protocol type 0x080b to be subinfo*/
-                    click_chatter("fw: sending out a subinfo request") ;
-                    BABitvector testfid(FID_LEN*8) ;
-                    testfid = FID & gc->iLID ;
-
-                    memcpy(newPacket->data() + MAC_LEN + MAC_LEN, &subinfo_type, 2) ;
-                    if( testfid == gc->iLID )
-                    {
-                        output(3).push(newPacket) ;
-                        counter++ ;
-                        continue ;
-                    }
+            /*prepare the link header once - the links only differ in the addresses*/
+            WritablePacket *frame = pushLinkHeader(p, ether);
+            if (frame == NULL) {
+                return;
+            }
+            if (in_port == 0 && Telemetry::sampled() && (!gc->use_mac || frame->length() + Telemetry::trace_length(1) >= TELEMETRY_MIN_FRAME)) {
+                /*our proposal the first hop of the in-band trace (see telemetry.hh)*/
+                TelemetryHop hop = {Telemetry::usec(since), Telemetry::node, 0};
+                frame = Telemetry::append(frame, &hop, 1);
+                if (frame == NULL) {
+                    return;
                 }
-                else if(in_port == 5)
-                {
-                    click_chatter("fw: sending out data") ;
-                    /*for data collection*/
-                    int temp_ds = data_size ;
-                    data_size += p->length() ;
-                    if(data_size < temp_ds)
-                    	GB_ds++ ;
-                    memcpy(newPacket->data() + MAC_LEN + MAC_LEN, &datapush_type, 2) ;
+            }
+            uint16_t psum = linkPayloadSum(frame);
+            for (out_links_it = out_links.begin(); out_links_it != out_links.end(); out_links_it++) {
+                newPacket = linkCopy(frame, counter == out_links.size());
+                counter++;
+                if (newPacket == NULL) {
+                    continue;
                 }
-                else if(in_port == 6)
-                {
-                    click_chatter("fw: sending out a kanycast message") ;
-                    memcpy(newPacket->data() + MAC_LEN + MAC_LEN, &kanycast_type, 2) ;
+                fe = *out_links_it;
+                addressLink(newPacket, fe, ether, psum);
+                if (in_port == 4 && lid_match(read_fid((const unsigned char *) FID._data), iLID_mask)) {
+                    output(3).push(newPacket) ;
+                    continue ;
                 }
+                countTx(fe, ether, newPacket->length());
                 /*push the packet to the appropriate ToDevice Element*/
                 output(fe->port).push(newPacket);
-            } else {
-                newPacket = payload->push(sizeof (click_udp) + sizeof (click_ip));
-                ip = reinterpret_cast<click_ip *> (newPacket->data());
-                udp = reinterpret_cast<click_udp *> (ip + 1);
-                // set up IP header
-                ip->ip_v = 4;
-                ip->ip_hl = sizeof (click_ip) >> 2;
-                ip->ip_len = htons(newPacket->length());
-                ip->ip_id = htons(_id.fetch_and_add(1));
-                ip->ip_p = IP_PROTO_UDP;
-                ip->ip_src = fe->src_ip->in_addr();
-                ip->ip_dst = fe->dst_ip->in_addr();
-                ip->ip_tos = 0;
-                ip->ip_off = 0;
-                ip->ip_ttl = 250;
-                ip->ip_sum = 0;
-                ip->ip_sum = click_in_cksum((unsigned char *) ip, sizeof (click_ip));
-                newPacket->set_ip_header(ip, sizeof (click_ip));
-                // set up UDP header
-                udp->uh_sport = htons(55555);
-                udp->uh_dport = htons(55555);
-                uint16_t len = newPacket->length() - sizeof (click_ip);
-                udp->uh_ulen = htons(len);
-                udp->uh_sum = 0;
-                unsigned csum = click_in_cksum((unsigned char *) udp, len);
-                udp->uh_sum = click_in_cksum_pseudohdr(csum, ip, len);
-                output(fe->port).push(newPacket);
             }
-            counter++;
+            Telemetry::done(TELEMETRY_FORWARDER, since);
         }
     }else if( in_port == 6)
     {//flooding push the packet out from every output port
+        if (*(p->data()+FID_LEN) == SUB_SCOPE_MESSAGE) {
+            /*remember our own request so that it is dropped when it comes back*/
+            uint32_t stamp = floodStampOffset(p->data(), p->length());
+            if (stamp != 0) {
+                floodSeen(p->data() + stamp);
+            }
+        }
         for (int i = 0; i < fwTable.size(); i++) {
             fe = fwTable[i];
             out_links.push_back(fe);//get all the output port
         }
         if (out_links.size() == 0) {
             p->kill();
-        }
-        for (out_links_it = out_links.begin(); out_links_it != out_links.end(); out_links_it++) {
-        	/*for data collection*/
-            no_req++ ;
-            req_size += p->length() ;
-            int temp_tt = total_throughput ;
-            total_throughput += p->length() ;
-            if(total_throughput	< temp_tt)
-            	GB_tt++ ;
-            if (counter == out_links.size()) {
-                payload = p->uniqueify();
-            } else {
-                payload = p->clone()->uniqueify();
+        } else {
+            BA_TRACE(TRACE_FORWARDER, TRACE_DEBUG, "sending out a kanycast message") ;
+            WritablePacket *frame = pushLinkHeader(p, FW_ETHER_KANYCAST);
+            if (frame == NULL) {
+                return;
             }
-            fe = *out_links_it;
-            if (gc->use_mac) {
-                newPacket = payload->push_mac_header(14);
-                /*prepare the mac header*/
-                /*destination MAC*/
-                memcpy(newPacket->data(), fe->dst->data(), MAC_LEN);
-                /*source MAC*/
-                memcpy(newPacket->data() + MAC_LEN, fe->src->data(), MAC_LEN);
-                click_chatter("fw: sending out a kanycast message") ;
-                memcpy(newPacket->data() + MAC_LEN + MAC_LEN, &kanycast_type, 2) ;
+            uint16_t psum = linkPayloadSum(frame);
+            for (out_links_it = out_links.begin(); out_links_it != out_links.end(); out_links_it++) {
+                newPacket = linkCopy(frame, counter == out_links.size());
+                counter++;
+                if (newPacket == NULL) {
+                    continue;
+                }
+                fe = *out_links_it;
+                addressLink(newPacket, fe, FW_ETHER_KANYCAST, psum);
+                countTx(fe, FW_ETHER_KANYCAST, newPacket->length());
                 /*push the packet to the appropriate ToDevice Element*/
                 output(fe->port).push(newPacket);
             }
-            else
-            {
-                click_chatter("only support mac") ;
-            }
-            counter++;
         }
     } else if (in_port == 1 || in_port == 3 || in_port == 7) {
         /**a packet has been pushed by the underlying network.**/
-        /*check if it needs to be forwarded*/
-        if (gc->use_mac) {
-            memcpy(FID._data, p->data() + 14, FID_LEN);
-        } else {
-            memcpy(FID._data, p->data() + 28, FID_LEN);
+        Timestamp since = Telemetry::stamp(p, TELEMETRY_INGRESS);
+        /*our proposal the in-band trace of a sampled publication is taken off first: nothing after the Forwarder sees it*/
+        TelemetryHop hops[TELEMETRY_MAX_HOPS + 1];
+        int trace_hops = 0;
+        if (in_port == 1 && Telemetry::enabled && LinkHeader::message_class(p, gc->use_mac) == FW_ETHER_PUB) {
+            trace_hops = Telemetry::strip(p, link_len + FID_LEN, hops);
+            if (trace_hops > 0) {
+                Telemetry::elapsed(TELEMETRY_WIRE, hops[trace_hops - 1].usec, Telemetry::usec(since));
+            }
         }
-        BABitvector testFID(FID);
-        BABitvector reverse_FID(FID_LEN*8) ;//our proposal the reverse FID, from sub to pub
-        EtherAddress reverse_dst ;//our proposal reverse link source
-        EtherAddress reverse_src ;//our proposal reverse link destination
+        /*check if it needs to be forwarded*/
+        memcpy(FID._data, p->data() + link_len, FID_LEN);
+        FIDBitvector testFID(FID);
+        FIDBitvector reverse_FID;//our proposal the reverse FID, from sub to pub
         uint32_t offset = 0 ;//our proposal the offset to reverse FID in the probing message
         if(in_port == 3 || in_port == 7)
-        {//get the reverse src and dst
+        {
             offset = *(p->anno_u32()) ;
-            memcpy(reverse_src.data(), p->data(), MAC_LEN) ;
-            memcpy(reverse_dst.data(), p->data()+MAC_LEN, MAC_LEN) ;
             memcpy(reverse_FID._data, p->data()+offset, FID_LEN) ;
         }
         testFID.negate();
+        FIDMask fid = read_fid((const unsigned char *) FID._data);
         if (!testFID.zero()) {
             /*Check all entries in my forwarding table and forward appropriately*/
-            for (int i = 0; i < fwTable.size(); i++) {
-                fe = fwTable[i];
-                andVector = (FID)&(*fe->LID);
-                if (andVector == (*fe->LID)) {
-                    //click_chatter(" notify %d\n",fe->port);
-                    out_links.push_back(fe);
-                }
-                if(in_port == 3 || in_port == 7)//our proposal find the reverse link
-                {
-                    if(((*fe->src) == reverse_src) && ((*fe->dst) == reverse_dst))
+            matchLIDs(fid, out_links);
+            if(in_port == 3 || in_port == 7)//our proposal find the reverse link
+            {
+                for (int i = 0; i < fwTable.size(); i++) {
+                    fe = fwTable[i];
+                    if(arrivedOver(p, fe))
                     {
                         reverse_FID |= (*fe->LID) ;
                     }
@@ -364,88 +699,81 @@ void Forwarder::push(int in_port, Packet *p) {
             /*all bits were 1 - probably from a link_broadcast strategy--do not forward*/
         }
         /*check if the packet must be pushed locally*/
-        andVector = FID & gc->iLID;/*this is how to check wether the packet is destined to the local node*/
-        if (andVector == gc->iLID) {
+        if (lid_match(fid, iLID_mask)) {/*this is how to check wether the packet is destined to the local node*/
             pushLocally = true;
         }
-        if (!testFID.zero()) {
-
-
+        if (!testFID.zero() && out_links.size() > 0) {
+            WritablePacket *frame = p->uniqueify();
+            p = frame;
+            int ether = LinkHeader::message_class(frame, gc->use_mac);
+            if(in_port == 3 || in_port == 7)//our proposal modify the reverse FID (once, for all links)
+            {
+                memcpy(frame->data()+offset, reverse_FID._data, FID_LEN) ;
+            }
+            int forwarded_hops = 0;
+            if (trace_hops > 0 && trace_hops < TELEMETRY_MAX_HOPS) {
+                /*our proposal this node is the next hop of the trace - a trace that is full ends here*/
+                forwarded_hops = trace_hops + 1;
+                hops[trace_hops].usec = Telemetry::usec(Timestamp::now());
+                hops[trace_hops].node = Telemetry::node;
+                frame = Telemetry::append(frame, hops, forwarded_hops);
+                p = frame;
+                if (frame == NULL) {
+                    return;
+                }
+            }
+            uint16_t psum = linkPayloadSum(frame);
             for (out_links_it = out_links.begin(); out_links_it != out_links.end(); out_links_it++) {
-            	/*for data collection*/
-                int temp_tt = total_throughput ;
-           	total_throughput += p->length() ;
-            	if(total_throughput< temp_tt)
-            		GB_tt++ ;
-                if ((counter == out_links.size()) && (pushLocally == false)) {
-                    payload = p->uniqueify();
-                } else {
-                    payload = p->clone()->uniqueify();
+                payload = linkCopy(frame, (counter == out_links.size()) && (pushLocally == false));
+                counter++;
+                if (payload == NULL) {
+                    continue;
                 }
                 fe = *out_links_it;
-                if (gc->use_mac) {
-                    /*prepare the mac header*/
-                    /*destination MAC*/
-                    if(in_port == 3 || in_port == 7)//our proposal modify the reverse FID
-                    {
-                        memcpy(payload->data()+offset, reverse_FID._data, FID_LEN) ;
-                    }
-                    memcpy(payload->data(), fe->dst->data(), MAC_LEN);
-                    /*source MAC*/
-                    memcpy(payload->data() + MAC_LEN, fe->src->data(), MAC_LEN);
-                    /*push the packet to the appropriate ToDevice Element*/
-                    output(fe->port).push(payload);
-                } else {
-                    click_ip *ip = reinterpret_cast<click_ip *> (payload->data());
-                    ip->ip_src = fe->src_ip->in_addr();
-                    ip->ip_dst = fe->dst_ip->in_addr();
-                    ip->ip_tos = 0;
-                    ip->ip_off = 0;
-                    ip->ip_ttl = 250;
-                    ip->ip_sum = 0;
-                    ip->ip_sum = click_in_cksum((unsigned char *) ip, sizeof (click_ip));
-#if NOTYET
-                    click_udp *udp = reinterpret_cast<click_udp *> (ip + 1);
-                    uint16_t len = udp->uh_ulen;
-                    udp->uh_sum = 0;
-                    unsigned csum = click_in_cksum((unsigned char *) udp, len);
-                    udp->uh_sum = click_in_cksum_pseudohdr(csum, ip, len);
-#endif
-                    output(fe->port).push(payload);
-                }
-                counter++;
+                /*the link header of the next hop*/
+                addressLink(payload, fe, ether, psum);
+                countTx(fe, ether, payload->length());
+                /*push the packet to the appropriate ToDevice Element*/
+                output(fe->port).push(payload);
+            }
+            Telemetry::done(TELEMETRY_FORWARDER, since);
+            if (pushLocally && forwarded_hops > 0) {
+                p->take(Telemetry::trace_length(forwarded_hops));
             }
         } else {
             /*all bits were 1 - probably from a link_broadcast strategy--do not forward*/
         }
         if (pushLocally) {
-            if (gc->use_mac) {
-                if(in_port == 3)
-                {
-                    p->pull(14);
-                    payload = p->uniqueify();
-                    memcpy(payload->data()+offset-14, reverse_FID._data, FID_LEN) ;
-                    output(2).push(payload);//push to localproxy via port 2, don't pull the FID
-                }
-                else if(in_port == 7)
-                {
-                    p->pull(14);
-                    payload = p->uniqueify();
-                    memcpy(payload->data()+offset-14, reverse_FID._data, FID_LEN) ;
-                    output(4).push(payload);//push to localproxy via port 2, don't pull the FID
-                }
-                else if(in_port == 8)
-                {
-                    p->pull(14);
-                    output(4).push(p) ;
-                }
-                else
-                {
-                    p->pull(14 + FID_LEN);
-                    output(0).push(p);
+            if(in_port == 3)
+            {
+                p->pull(link_len);
+                payload = p->uniqueify();
+                memcpy(payload->data()+offset-link_len, reverse_FID._data, FID_LEN) ;
+                output(2).push(payload);//push to localproxy via port 2, don't pull the FID
+            }
+            else if(in_port == 7)
+            {
+                p->pull(link_len);
+                payload = p->uniqueify();
+                memcpy(payload->data()+offset-link_len, reverse_FID._data, FID_LEN) ;
+                output(4).push(payload);//push to localproxy via port 2, don't pull the FID
+            }
+            else if(in_port == 8)
+            {
+                p->pull(link_len);
+                output(4).push(p) ;
+            }
+            else
+            {
+                if (trace_hops > 0) {
+                    /*our proposal the trace ends here*/
+                    uint32_t now = Telemetry::usec(Timestamp::now());
+                    Telemetry::elapsed(TELEMETRY_END_TO_END, hops[0].usec, now);
+                    hops[trace_hops].usec = now;
+                    hops[trace_hops].node = Telemetry::node;
+                    Telemetry::keep(hops, trace_hops + 1);
                 }
-            } else {
-                p->pull(20 + 8 + FID_LEN);
+                p->pull(link_len + FID_LEN);
                 output(0).push(p);
             }
         }
@@ -456,85 +784,66 @@ void Forwarder::push(int in_port, Packet *p) {
     }else if(in_port==8)
     {//this is a flooding request
     //add the reverse LID, and check there is loop
-        unsigned char numberOfIDs ;
-        unsigned char IDLength /*in fragments of PURSUIT_ID_LEN each*/;
-        int index = 0 ;
-        click_chatter("fw: receive a flooding request") ;
-
-
-        memcpy(&numberOfIDs, p->data()+14+FID_LEN+sizeof(unsigned char), sizeof(numberOfIDs)) ;
-        for (int i = 0; i < (int) numberOfIDs; i++) {
-            IDLength = *(p->data()+14+FID_LEN+sizeof(unsigned char)+sizeof(numberOfIDs)+index);
-            index = index + sizeof (IDLength) + IDLength * PURSUIT_ID_LEN;
+        BA_TRACE(TRACE_FORWARDER, TRACE_DEBUG, "receive a flooding request") ;
+        if (*(p->data()+link_len+FID_LEN) != SUB_SCOPE_MESSAGE) {
+            /*scope probing messages get their reverse FID via in_port 7*/
+            output(5).push(p);
+            return;
         }
-
-        BABitvector reverse_FID(FID_LEN*8) ;//our proposal the reverse FID, from sub to pub
-        EtherAddress reverse_dst ;//our proposal reverse link source
-        EtherAddress reverse_src ;//our proposal reverse link destination
+        FIDBitvector reverse_FID;//our proposal the reverse FID, from sub to pub
         uint32_t offset = 0 ;//our proposal the offset to reverse FID in the probing message
 
         //get the reverse src and dst
-        offset = 14+FID_LEN+sizeof(unsigned char)+sizeof(numberOfIDs)+index+IBFSIZE+EBFSIZE ;
-        
-        
-        unsigned char noofnode ;
-        memcpy(&noofnode, p->data()+offset+FID_LEN, sizeof(noofnode)) ;
-        int avoidindex ;
-        for(avoidindex = 0 ; avoidindex < (int)noofnode ; avoidindex++)
-        {//check all the node that this request has been passed
-            String tempnodeid = String((const char*)(p->data()+offset+FID_LEN+sizeof(noofnode)+avoidindex*NODEID_LEN), NODEID_LEN) ;
-            if(tempnodeid == gc->nodeID)
-            {//loop found
-            	p->kill() ;
-            	return ;
-            }
-                
-        }
-        noofnode++ ;
-        
-        
-        
-        
-        memcpy(reverse_src.data(), p->data(), MAC_LEN) ;
-        memcpy(reverse_dst.data(), p->data()+MAC_LEN, MAC_LEN) ;
+        uint32_t stamp = floodStampOffset(p->data()+link_len, p->length()-link_len);
+        if (stamp == 0) {
+            /*malformed*/
+            p->kill();
+            return;
+        }
+        offset = link_len + stamp - FID_LEN ;
+        if (floodSeen(p->data()+offset+FID_LEN)) {
+            /*duplicate (or loop) - this request has already been through this node*/
+            threadStats().flood_duplicates++;
+            p->kill();
+            return;
+        }
+        unsigned char ttl = *(p->data()+offset+FID_LEN+FLOOD_STAMP_LEN);
         memcpy(reverse_FID._data, p->data()+offset, FID_LEN) ;
         for (int i = 0; i < fwTable.size(); i++)
         {
             fe = fwTable[i];
-            if(((*fe->src) == reverse_src) && ((*fe->dst) == reverse_dst))
+            if(arrivedOver(p, fe))
             {//add the reverse LID
+                if (!fe->relay_bucket.take(relay_flood_rate, relay_flood_burst, Timestamp::now())) {
+                    /*over the relay limit of the link (flooded requests come in on thread 0 only)*/
+                    threadStats().flood_limited++;
+                    p->kill();
+                    return;
+                }
                 reverse_FID |= (*fe->LID) ;
                 break ;
             }
         }
-        payload = p->put(NODEID_LEN) ;
+        payload = p->uniqueify() ;
         memcpy(payload->data()+offset, reverse_FID._data, FID_LEN) ;
-        
-        
-        memcpy(payload->data()+offset+FID_LEN, &noofnode, sizeof(noofnode)) ;
-        memcpy(payload->data()+offset+FID_LEN+sizeof(noofnode)+avoidindex*NODEID_LEN, gc->nodeID.c_str(), NODEID_LEN) ;
-        //add this node ID to this reqeust
-        
+        if (ttl != FLOOD_TTL_UNLIMITED && ttl > 0) {
+            /*one more hop - the cache and the local node still see the request, but at 0 it is not flooded further (in_port 9)*/
+            *(payload->data()+offset+FID_LEN+FLOOD_STAMP_LEN) = ttl - 1;
+        }
         output(5).push(payload) ;
     }else if(in_port == 9)
     {
-        if (gc->use_mac) {
-            memcpy(FID._data, p->data() + 14, FID_LEN);
-        } else {
-            memcpy(FID._data, p->data() + 28, FID_LEN);
-        }
-        BABitvector testFID(FID);
+        memcpy(FID._data, p->data() + link_len, FID_LEN);
+        FIDBitvector testFID(FID);
         testFID.negate();
-        EtherAddress reverse_dst ;//our proposal reverse link source
-        EtherAddress reverse_src ;//our proposal reverse link destination
-
-        memcpy(reverse_src.data(), p->data(), MAC_LEN) ;
-        memcpy(reverse_dst.data(), p->data()+MAC_LEN, MAC_LEN) ;
-        if (!testFID.zero()) {
+        /*the hop limit of the request ran out*/
+        uint32_t stamp = floodStampOffset(p->data()+link_len, p->length()-link_len);
+        bool expired = (stamp == 0) || (*(p->data()+link_len+stamp+FLOOD_STAMP_LEN) == 0);
+        if (!testFID.zero() && !expired) {
             /*Check all entries in my forwarding table and forward appropriately*/
             for (int i = 0; i < fwTable.size(); i++) {
                 fe = fwTable[i];
-                if(((*fe->src) == reverse_src) && ((*fe->dst) == reverse_dst))
+                if(arrivedOver(p, fe))
                 {//forward this request to every output port except the one the request arrives
                     continue ;
                 }
@@ -544,46 +853,33 @@ void Forwarder::push(int in_port, Packet *p) {
             /*all bits were 1 - probably from a link_broadcast strategy--do not forward*/
         }
         /*check if the packet must be pushed locally*/
-        andVector = FID  & gc->iLID;/*this is how to check wether the packet is destined to the local node*/
-        if (andVector == gc->iLID) {
+        if (lid_match(read_fid((const unsigned char *) FID._data), iLID_mask)) {/*this is how to check wether the packet is destined to the local node*/
             pushLocally = true;
         }
-        if ( (!testFID.zero()) && (!pushLocally) )
+        if ( (!testFID.zero()) && (!pushLocally) && (!expired) && out_links.size() > 0)
         {
+            WritablePacket *frame = p->uniqueify();
+            if (frame == NULL) {
+                return;
+            }
+            uint16_t psum = linkPayloadSum(frame);
             for (out_links_it = out_links.begin(); out_links_it != out_links.end(); out_links_it++)
             {
-            	/*for data collection*/
-            	no_req++ ;
-            	req_size += p->length() ;
-                int temp_tt = total_throughput ;
-            	total_throughput += p->length() ;
-            	if(total_throughput< temp_tt)
-            		GB_tt++ ;
-                if ((counter == out_links.size()) && (pushLocally == false)) {
-                    payload = p->uniqueify();
-                } else {
-                    payload = p->clone()->uniqueify();
+                payload = linkCopy(frame, counter == out_links.size());
+                counter++ ;
+                if (payload == NULL) {
+                    continue;
                 }
                 fe = *out_links_it;
-                if (gc->use_mac) {
-                    memcpy(payload->data(), fe->dst->data(), MAC_LEN);
-                    /*source MAC*/
-                    memcpy(payload->data() + MAC_LEN, fe->src->data(), MAC_LEN);
-                    /*push the packet to the appropriate ToDevice Element*/
-                    output(fe->port).push(payload);
-                }
-                else
-                {
-                    click_chatter("only support mac") ;
-                }
-                counter++ ;
+                addressLink(payload, fe, FW_ETHER_KANYCAST, psum);
+                countTx(fe, FW_ETHER_KANYCAST, payload->length());
+                /*push the packet to the appropriate ToDevice Element*/
+                output(fe->port).push(payload);
             }
         }
         if (pushLocally) {
-            if (gc->use_mac) {
-                p->pull(14);
-                output(4).push(p);
-            }
+            p->pull(link_len);
+            output(4).push(p);
         }
         if ((out_links.size() == 0) && (!pushLocally)) {
             p->kill();
@@ -592,4 +888,5 @@ void Forwarder::push(int in_port, Packet *p) {
 }
 CLICK_ENDDECLS
 EXPORT_ELEMENT(Forwarder)
+ELEMENT_REQUIRES(Trace Telemetry)
 ELEMENT_PROVIDES(ForwardingEntry)
@@ -17,16 +17,76 @@
 #define MAC_LEN 6
 
 #include "globalconf.hh"
+#include "linkheader.hh"
+#include "floodbucket.hh"
 
 #include <click/etheraddress.hh>
+#include <click/timestamp.hh>
+#include <click/timer.hh>
 #include <clicknet/udp.h>
 
 #include <stdio.h>
-#include <fcntl.h>
-#include <unistd.h>
+
+#if CLICK_USERLEVEL && defined(__AVX2__)
+#include <immintrin.h>
+#define FORWARDER_SIMD 1
+#endif
+
+/**@brief the minimum number of links for which the SIMD matching path is used (it only pays off for nodes with many links).
+ */
+#define FORWARDER_SIMD_MIN_LINKS 8
+
+#if FID_LEN % 8 != 0
+#error "the Forwarder matches LIPSIN identifiers in 64-bit words: FID_LEN must be a multiple of 8 bytes"
+#endif
+
+/**@brief the number of 64-bit words of a LIPSIN identifier (1 for the default 64-bit FIDs, 4 for 256 bits, 8 for 512 bits).
+ */
+#define FID_WORDS (FID_LEN / 8)
+
+/**@brief the number of Forwarder ports for which packets and bytes are counted (input and output).
+ */
+#define FORWARDER_MAX_PORTS 16
+/**@brief our proposal the number of links for which the bytes sent are counted and reported to the TM (LOAD_REPORT).
+ */
+#define FORWARDER_MAX_LINKS 64
+/**@brief the number of per thread statistics blocks (a power of 2) - threads beyond it share blocks.
+ */
+#define FORWARDER_MAX_THREADS 8
 
 CLICK_DECLS
 
+/**@brief a 64-bit packet and byte counter.
+ */
+struct ForwarderCounter {
+    uint64_t packets;
+    uint64_t bytes;
+    inline void count(uint32_t len) {
+        packets++;
+        bytes += len;
+    }
+};
+
+/**@brief The statistics a single thread collects in the Forwarder.
+ *
+ * Every thread only writes its own block (so no locks or atomic operations are needed) and the read handlers sum all blocks.
+ * Blocks are cache line aligned so that threads do not share lines.
+ */
+struct ForwarderStats {
+    /**@brief received packets by Forwarder input port*/
+    ForwarderCounter rx[FORWARDER_MAX_PORTS];
+    /**@brief sent packets by Forwarder output port*/
+    ForwarderCounter tx[FORWARDER_MAX_PORTS];
+    /**@brief sent packets by message class (network links only, see LinkHeader)*/
+    ForwarderCounter tx_ether[FW_ETHERTYPES];
+    /**@brief our proposal sent packets by link (ForwardingEntry::index) - several links may share an output port*/
+    ForwarderCounter tx_link[FORWARDER_MAX_LINKS];
+    /**@brief flooded requests dropped as duplicates*/
+    uint64_t flood_duplicates;
+    /**@brief our proposal flooded requests dropped by the relay limit of their ingress link*/
+    uint64_t flood_limited;
+} __attribute__((aligned(64)));
+
 /**@brief (blackadder Core) a forwarding_entry represents an entry in the forwarding table of this Blackadder node.
  *
  * Depending on the network mode in which Blackadder runs in this node, a forwarding entru may have an src and dst EtherAddress, or a src_ip and dst_ip IP address.
@@ -47,19 +107,53 @@ public:
     /**@brief the destination IP address for this entry (or unused).
      */
     IPAddress *dst_ip;
+    /**@brief our proposal the IP and UDP headers of this link (IP mode), built once in Forwarder::configure.
+     */
+    LinkTemplate ip_template;
+    /**@brief our proposal limits the flooded requests received over this link that the Forwarder relays (RELAY_FLOOD_RATE).
+     */
+    FloodBucket relay_bucket;
     /**@brief the output port for the network element that where packets should be forwarded when this entry is used.
      */
     int port;
+    /**@brief our proposal the position of this entry in the forwarding table (its counter in ForwarderStats::tx_link).
+     */
+    int index;
     /**@brief A bitvector that represents the Link Identifier.
      */
     BABitvector *LID;
+    /**@brief our proposal the Link Identifiers of this link in LID tables 1..d-1 (LID is the one of table 0).
+     */
+    Vector<BABitvector> tableLIDs;
+};
+
+/**@brief (blackadder Core) a LIPSIN identifier as FID_WORDS 64-bit words (same byte layout as the BABitvector data).
+ */
+struct FIDMask {
+    uint64_t w[FID_WORDS];
 };
 
+/**@brief (blackadder Core) a packed Link Identifier used by the Forwarder fast path.
+ *
+ * All LIDs are stored contiguously (along with the output port and the index of the ForwardingEntry in fwTable),
+ * so that matching a FID against the whole forwarding table is FID_WORDS AND/compares per link.
+ */
+struct LIDMatchEntry {
+    /**@brief the Link Identifier as a mask.
+     */
+    FIDMask mask;
+    /**@brief the output port for this link.
+     */
+    uint32_t port;
+    /**@brief the index of the respective ForwardingEntry in fwTable.
+     */
+    uint32_t index;
+};
 
 /**@brief (blackadder Core) The Forwarder Element implements the forwarding function. Currently it supports the basic LIPSIN mechanism.
  *
  * It can work in two modes. In a MAC mode it expects ethernet frames from the network devices. It checks the LIPSIN identifiers and pushes packets to another Ethernet interface or to the LocalProxy.
- * In IP mode, the Forwarder expects raw IP sockets as the underlying network. Note that a mixed mode is currently not supported. Some lines must be written.
+ * In IP mode, the Forwarder expects raw IP sockets as the underlying network (UDP datagrams, see LinkHeader). Flooding and the cache ports work the same in both modes. Note that a mixed mode is currently not supported.
  */
 class Forwarder : public Element {
 public:
@@ -93,6 +187,10 @@ public:
      * @brief Element configuration. Forwarder needs a pointer to the GlovalConf Element so that it can read the Global Configuration.
      * Then, there is the number of (LIPSIN) links.
      * For each such link the Forwarder reads the outgoing port (to a "network" Element), the source and destination Ethernet or IP addresses (depending on the network mode) as well as the Link identifier (FID_LEN size see helper.hh).
+     * The links may be followed by the optional STATS_FILE and STATS_INTERVAL (default 1 second) keywords to export the statistics periodically.
+     * RELAY_FLOOD_RATE (floods per second, default 0: no limit) and RELAY_FLOOD_BURST (default 16) limit the flooded requests relayed from each ingress link, so that a storm from one neighbour cannot take the control capacity of the node.
+     * In IP mode UDP_CHECKSUM (FULL, NONE or OFFLOAD, default FULL) sets how the UDP checksum is filled in (see LINK_UDP_CSUM_FULL) - OFFLOAD needs kernel click and is NONE otherwise.
+     * LOAD_REPORT (default 0: never) is the period at which the bytes sent over every link are published to the TM (see reportLoad()), so that it can route around busy links.
      */
     int configure(Vector<String>&, ErrorHandler*);
     /**@brief This Element must be configured AFTER the GlobalConf Element
@@ -119,48 +217,174 @@ public:
      * When a packet is pushed by the network the Forwarder checks with all its entries as well as the internal Link identifier and pushes the packet accordingly.
      *
      * In general, if now entries that match are found the packet is killed. Moreover the packet is copied only as required by the number of entries that match the LIPSIN identifier.
+     * Input 1 (publications from the network) may be pushed by several Click threads at once (see the threads option of the deployment tool): it only reads the forwarding table, which is never modified after configure(), and it only writes the statistics block of its own thread.
+     * All other inputs (flooding and duplicate suppression, cache and proxy traffic) must be pushed from a single thread.
+     * Our proposal with TELEMETRY the Forwarder stamps what it handles and appends, extends and takes off the in-band hop traces of the publications (see telemetry.hh);
+     * the Telemetry counters are atomic, so input 1 stays safe for several threads.
      * @param port the port from which the packet was pushed. 0 for LocalProxy, >0 for network elements
      * @param p a pointer to the packet
      */
     void push(int port, Packet *p);
+    /**@brief Reads FID_LEN bytes from @a data as a FIDMask that can be matched against the LIDMatchEntry masks.
+     */
+    static inline FIDMask read_fid(const unsigned char *data) {
+        FIDMask fid;
+        memcpy(fid.w, data, FID_LEN);
+        return fid;
+    }
+    /**@brief Returns true if all bits of @a lid are set in @a fid (the LIPSIN match).
+     * FID_WORDS is a constant, so the loop is unrolled for each width; with AVX2, 256 and 512-bit identifiers are matched 256 bits at a time.
+     */
+    static inline bool lid_match(const FIDMask &fid, const FIDMask &lid) {
+#if FORWARDER_SIMD
+        if (FID_WORDS % 4 == 0) {
+            for (int i = 0; i < FID_WORDS; i += 4) {
+                /*testc: (~fid & lid) == 0*/
+                if (!_mm256_testc_si256(_mm256_loadu_si256((const __m256i *) (fid.w + i)), _mm256_loadu_si256((const __m256i *) (lid.w + i)))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+#endif
+        uint64_t missing = 0;
+        for (int i = 0; i < FID_WORDS; i++) {
+            missing |= lid.w[i] & ~fid.w[i];
+        }
+        return missing == 0;
+    }
+    /**@brief Pushes back to @a out_links all ForwardingEntry whose LID matches the @a fid, using lidTable.
+     */
+    void matchLIDs(const FIDMask &fid, Vector<ForwardingEntry *> &out_links);
+    /**@brief our proposal Returns the LID table a FID was built in: its top lid_table_bits bits (no LID sets them).
+     */
+    inline int fidTable(const FIDMask &fid) const {
+        return (lid_table_bits == 0) ? 0 : (int) (fid.w[FID_WORDS - 1] >> (64 - lid_table_bits));
+    }
+    /**@brief our proposal Parses the LID configuration of a link: the LIDs of all LID tables, separated by ':'.
+     */
+    int parseLIDs(const String &lids, ForwardingEntry *fe, int link, ErrorHandler *errh);
+    /**@brief Returns the packet to send to one of the links a multicast @a frame goes to.
+     * The last link gets @a frame itself. The others get an exactly sized copy of its data (no headroom or tailroom, annotations kept), so there is only one copy per extra link, never a copy of the whole buffer followed by a reallocation for the MAC header.
+     */
+    static inline WritablePacket *linkCopy(WritablePacket *frame, bool last) {
+        if (last) {
+            return frame;
+        }
+        WritablePacket *copy = Packet::make(0, frame->data(), frame->length(), 0);
+        if (copy != NULL) {
+            copy->copy_annotations(frame);
+        }
+        return copy;
+    }
+    /**@brief Returns the offset of the (origin node ID, sequence) stamp in the flooded SUB_SCOPE_MESSAGE of @a length bytes that starts (with its FID) at @a data, or 0 if the message is malformed.
+     */
+    static uint32_t floodStampOffset(const unsigned char *data, uint32_t length);
+    /**@brief Returns true if the flooded request with the FLOOD_STAMP_LEN bytes @a stamp has already been seen in the last FLOOD_SEEN_LIFETIME seconds.
+     * Otherwise it remembers it and returns false.
+     */
+    bool floodSeen(const unsigned char *stamp);
+    /**@brief Our proposal pushes an empty link header of the message class @a cls in front of @a p - the links then only differ in the addresses (see addressLink).
+     */
+    WritablePacket *pushLinkHeader(Packet *p, int cls);
+    /**@brief Our proposal the payload sum that the copies of @a frame (built by pushLinkHeader or received) share, if the UDP checksum is computed in software (0 otherwise).
+     */
+    uint16_t linkPayloadSum(const Packet *frame) const;
+    /**@brief Our proposal writes the addresses of the link @a fe to the link header of @a p: the MAC addresses, or the IP and UDP headers of class @a cls from the template of the link.
+     * @a psum is linkPayloadSum() of the packet. The PAINT annotation is set to the traffic class of @a cls (LINK_TRAFFIC_*).
+     */
+    void addressLink(WritablePacket *p, ForwardingEntry *fe, int cls, uint16_t psum);
+    /**@brief Our proposal returns true if @a p was received over the link @a fe (the reverse direction of the entry).
+     */
+    bool arrivedOver(const Packet *p, const ForwardingEntry *fe) const;
     /**@brief A pointer to the GlobalConf Element for reading some global node configuration.
      */
     GlobalConf *gc;
+    /**@brief Our proposal the length of the link header in the network mode of the node (LinkHeader::length).
+     */
+    uint32_t link_len;
+    /**@brief Our proposal how the UDP checksum is filled in (LINK_UDP_CSUM_*, IP mode).
+     */
+    int udp_csum;
+    /**@brief Our proposal the relay limit of the flooded requests from each ingress link (see ForwardingEntry::relay_bucket).
+     */
+    uint32_t relay_flood_rate;
+    uint32_t relay_flood_burst;
     /**@brief It is used for filling the ip_id field in the IP packet when sending over raw sockets. It is increased for every sent packet.
      */
     atomic_uint32_t _id;
     /**@brief The number of links in the forwarding table.
      */
     int number_of_links;
-    /**@brief The Ethernet protocol type (hardcoded to be 0x080a)
-     */
-    int proto_type;
     /**@brief A vector containing all ForwardingEntry.
      */
     Vector<ForwardingEntry *> fwTable;
-    /**@brief Our Proposal
-     * ethernet type for probing (hardcoded to be 0x080b)
-     */
-    int probing_type ;
-    /**@brief Our Proposal
-     * ethernet type for subscribe information item
-     */
-    int subinfo_type ;
-    /**@brief Our proposal
-     * ethernet type for data pushing
-     */
-    int datapush_type ;
-    /**@brief kanycast
-     * ethernet type for scope probing
-     */
-    int kanycast_type ;
-    /*for data collection*/
-    unsigned int no_req ;
-    unsigned int req_size ;
-    unsigned int data_size ;
-    unsigned int GB_ds ;
-    unsigned int total_throughput ;
-    unsigned int GB_tt ;
+    /**@brief The LIDs of all ForwardingEntry in fwTable, packed in a single array (built once in configure()).
+     * our proposal with d LID tables, table t is at lidTable + t * fwTable.size().
+     */
+    LIDMatchEntry *lidTable;
+    /**@brief our proposal the number of LID tables (d, a power of 2) and log2(d).
+     */
+    int lid_tables;
+    int lid_table_bits;
+    /**@brief The internal LID of this node (gc->iLID) as a mask.
+     */
+    FIDMask iLID_mask;
+    /**@brief read handlers: stats (all counters as a single JSON object), rx_packets, rx_bytes, tx_packets, tx_bytes (space separated, by port), flood_requests, flood_bytes, data_bytes, flood_duplicates, flood_limited.
+     * write handlers: reset_stats
+     */
+    void add_handlers();
+    static String read_handler(Element *e, void *thunk);
+    static int write_handler(const String &str, Element *e, void *thunk, ErrorHandler *errh);
+    /**@brief appends the stats to STATS_FILE every STATS_INTERVAL and reports the load of the links every LOAD_REPORT (load_timer).
+     */
+    void run_timer(Timer *timer);
+    /**@brief the sum of the statistics of all threads.
+     */
+    void sumStats(ForwarderStats &total) const;
+    /**@brief the statistics as a single line JSON object.
+     */
+    String unparseStats() const;
+    /**@brief the statistics block of the running thread.
+     */
+    inline ForwarderStats &threadStats() {
+        return stats[click_current_cpu_id() & (FORWARDER_MAX_THREADS - 1)];
+    }
+    /**@brief counts a packet of @a len bytes sent to the network over the link @a fe with the message class @a ether.
+     */
+    inline void countTx(const ForwardingEntry *fe, int ether, uint32_t len) {
+        ForwarderStats &s = threadStats();
+        s.tx[fe->port & (FORWARDER_MAX_PORTS - 1)].count(len);
+        s.tx_link[fe->index & (FORWARDER_MAX_LINKS - 1)].count(len);
+        s.tx_ether[ether].count(len);
+    }
+    /**@brief our proposal publishes a TOPOLOGY_LINK_LOAD update with the bytes sent over every link since the last one to /FFFFFFFFFFFFFFFE/NODEID, using the FID to all TM replicas.
+     *
+     * The update is sent over the links that the FID to all TM replicas (GlobalConf::tmAllFID) matches like a publication of the LocalProxy, and pushed to the LocalProxy if a TM runs in this node.
+     */
+    void reportLoad();
+    /**@brief the per thread statistics (see ForwarderStats).
+     */
+    ForwarderStats stats[FORWARDER_MAX_THREADS];
+    /**@brief the file the statistics are periodically appended to (one JSON object per line), or empty.
+     */
+    String stats_file;
+    /**@brief the export period in milliseconds.
+     */
+    uint32_t stats_interval;
+    Timer stats_timer;
+    /**@brief our proposal the load report period in milliseconds (0 if the load is not reported) and the bytes of every link at the last report.
+     */
+    uint32_t load_interval;
+    Timer load_timer;
+    Vector<uint64_t> load_reported;
+    /**@brief kanycast the flooded requests seen recently (stamp to arrival time) - see floodSeen().
+     */
+    HashTable<String, Timestamp> flood_seen;
+    /**@brief the stamps in flood_seen in arrival order (starting at flood_seen_head), so that they expire in O(1).
+     */
+    Vector<String> flood_seen_order;
+    int flood_seen_head;
 };
 
 CLICK_ENDDECLS
@@ -12,6 +12,7 @@
  * See LICENSE and COPYING for more details.
  */
 #include "fromnetlink.hh"
+#include "telemetry.hh"
 
 #if !HAVE_USE_NETLINK
 #include <sys/ioctl.h>
@@ -64,6 +65,7 @@ void nl_callback(struct sk_buff *skb) {
     /*pull the netlink header*/
     p->pull(sizeof (nlmsghdr));
     p->set_anno_u32(0, nlh->nlmsg_pid);
+    Telemetry::start(p);
 
     mutex_lock(&down_mutex);
     down_queue->push_front(p);
@@ -199,35 +201,98 @@ void FromNetlink::selected(int fd, int mask) {
     int total_buf_size;
     int bytes_read;
     if ((mask & SELECT_READ) == SELECT_READ) {
-        /*read from the socket*/
+        /*our proposal read up to FROM_NETLINK_BURST messages per wakeup (see publish_data_batch)*/
+        for (int burst = 0; burst < FROM_NETLINK_BURST; burst++) {
+            /*read from the socket*/
 #if HAVE_USE_NETLINK
-        total_buf_size = recv(fd, fake_buf, 1, MSG_PEEK | MSG_TRUNC | MSG_DONTWAIT);
+            total_buf_size = recv(fd, fake_buf, 1, MSG_PEEK | MSG_TRUNC | MSG_DONTWAIT);
 #else
-        total_buf_size = -1;
-        if (recv(fd, fake_buf, 1, MSG_PEEK | MSG_DONTWAIT) < 0 || ioctl(fd, FIONREAD, &total_buf_size) < 0) {
-            click_chatter("recv/ioctl: %d", errno);
-            return;
-        }
+            total_buf_size = -1;
+            if (recv(fd, fake_buf, 1, MSG_PEEK | MSG_DONTWAIT) < 0 || ioctl(fd, FIONREAD, &total_buf_size) < 0) {
+                if (burst == 0) {
+                    click_chatter("recv/ioctl: %d", errno);
+                }
+                return;
+            }
 #endif
-        if (total_buf_size < 0) {
-            click_chatter("HMmmm");
-            return;
+            if (total_buf_size < 0) {
+                if (burst == 0) {
+                    click_chatter("HMmmm");
+                }
+                return;
+            }
+            newPacket = Packet::make(100, NULL, total_buf_size, 100);
+            bytes_read = recv(fd, newPacket->data(), newPacket->length(), MSG_DONTWAIT);
+            if (bytes_read > 0) {
+                if ((uint32_t)bytes_read < newPacket->length()) {
+                    /* truncate to actual length */
+                    newPacket->take(newPacket->length() - bytes_read);
+                }
+                struct nlmsghdr *nlh = (struct nlmsghdr *) newPacket->data();
+                uint32_t pid = nlh->nlmsg_pid;
+                /*pull the netlink header*/
+                newPacket->pull(sizeof (nlmsghdr));
+                newPacket->set_anno_u32(0, pid);/*annotate with the information of the application*/
+                Telemetry::start(newPacket);
+                /*our proposal CONNECT and SHM_DOORBELL are about the transport and stop here*/
+                if (newPacket->length() > 0 && *(newPacket->data()) == CONNECT) {
+                    if (newPacket->length() > 1 && (*(newPacket->data() + 1) & CONNECT_SHM_RING)) {
+                        if (netlink_element->attach_rings(pid) != NULL) {
+                            netlink_element->send_doorbell(pid);
+                            drain_ring(pid);
+                        }
+                    }
+                    newPacket->kill();
+                } else if (newPacket->length() > 0 && *(newPacket->data()) == SHM_DOORBELL) {
+                    newPacket->kill();
+                    drain_ring(pid);
+                } else {
+                    bool disconnect = (newPacket->length() > 0 && *(newPacket->data()) == DISCONNECT);
+                    output(0).push(newPacket);
+                    if (disconnect) {
+                        netlink_element->detach_rings(pid);
+                    }
+                }
+            } else {
+                click_chatter("recv returned %d", bytes_read);
+                newPacket->kill();
+                return;
+            }
         }
-        newPacket = Packet::make(100, NULL, total_buf_size, 100);
-        bytes_read = recv(fd, newPacket->data(), newPacket->length(), MSG_DONTWAIT);
-        if (bytes_read > 0) {
-            if ((uint32_t)bytes_read < newPacket->length()) {
-                /* truncate to actual length */
-                newPacket->take(newPacket->length() - bytes_read);
+    }
+}
+
+void FromNetlink::drain_ring(uint32_t pid) {
+    ShmRings *rings = netlink_element->shm_rings.get(pid);
+    const char *record;
+    uint32_t len;
+    while (rings != NULL && rings->sane()) {
+        record = ba_shm_ring_peek(rings->up, &len);
+        if (record == NULL) {
+            if (!ba_shm_ring_empty(rings->up)) {
+                click_chatter("FromNetlink: the ring of application %u is corrupted - it goes back to the socket", pid);
+                netlink_element->detach_rings(pid);
+                return;
             }
-            struct nlmsghdr *nlh = (struct nlmsghdr *) newPacket->data();
-            /*pull the netlink header*/
-            newPacket->pull(sizeof (nlmsghdr));
-            newPacket->set_anno_u32(0, nlh->nlmsg_pid);/*annotate with the information of the application*/
-            output(0).push(newPacket);
-        } else {
-            click_chatter("recv returned %d", bytes_read);
-            newPacket->kill();
+            if (ba_shm_ring_sleep(rings->up)) {
+                return;
+            }
+            continue;
+        }
+        if (len <= sizeof (struct nlmsghdr)) {
+            ba_shm_ring_pop(rings->up);
+            continue;
+        }
+        /*the records are the messages the application would have sent through the socket*/
+        WritablePacket *newPacket = Packet::make(100, record + sizeof (struct nlmsghdr), len - sizeof (struct nlmsghdr), 100);
+        ba_shm_ring_pop(rings->up);
+        newPacket->set_anno_u32(0, pid);
+        Telemetry::start(newPacket);
+        bool disconnect = (*(newPacket->data()) == DISCONNECT);
+        output(0).push(newPacket);
+        if (disconnect) {
+            netlink_element->detach_rings(pid);
+            return;
         }
     }
 }
@@ -235,4 +300,4 @@ void FromNetlink::selected(int fd, int mask) {
 
 CLICK_ENDDECLS
 EXPORT_ELEMENT(FromNetlink)
-ELEMENT_REQUIRES(Netlink)
+ELEMENT_REQUIRES(Netlink Telemetry)
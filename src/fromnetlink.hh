@@ -19,6 +19,9 @@
 
 CLICK_DECLS
 
+/*our proposal the number of messages read from the socket in one selected call (User-Space only)*/
+#define FROM_NETLINK_BURST 32
+
 /**
  * @brief (blackadder Core) The FromNetlink Element receives packets from applications, annotates and pushes them to the LocalProxy Element.
  * 
@@ -98,6 +101,12 @@ public:
      *  It reads a packet from the socket buffer (if possible), annotates it using the source netlink port and pushes it to the LocalProxy.
      */
     void selected(int fd, int mask);
+    /**@brief Our proposal pushes to the LocalProxy every request waiting in the up ring of an application (User-Space only).
+     *
+     * It is called when the CONNECT with CONNECT_SHM_RING or a SHM_DOORBELL arrives. It stops when the ring is empty and the waiting flag is raised,
+     * so that the application rings the doorbell again for its next request.
+     */
+    void drain_ring(uint32_t pid);
 #endif
     /**@brief A pointer to the base Netlink Element.
      */
@@ -12,9 +12,33 @@
 * See LICENSE and COPYING for more details.
 */
 #include "globalconf.hh"
+#include "trace.hh"
+#include "telemetry.hh"
 
 CLICK_DECLS
 
+/*FNV-1a*/
+static uint32_t ring_hash(const char *data, int len, uint32_t seed) {
+    uint32_t hash = 2166136261U ^ seed;
+    for (int i = 0; i < len; i++) {
+        hash ^= (unsigned char) data[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+/*parses a string of FID_LEN * 8 bits (the first character is the last bit)*/
+static bool parse_fid(const String &str, BABitvector &fid) {
+    if (str.length() != FID_LEN * 8) {
+        return false;
+    }
+    fid = BABitvector(FID_LEN * 8);
+    for (int j = 0; j < str.length(); j++) {
+        fid[str.length() - j - 1] = (str.at(j) == '1');
+    }
+    return true;
+}
+
 GlobalConf::GlobalConf() {
 
 }
@@ -28,6 +52,10 @@ int GlobalConf::configure(Vector<String> &conf, ErrorHandler *errh) {
     String defRVFID;
     String internalLID;
     String TMFID_str = String();
+    String RVShards_str;
+    String TMReplicas_str;
+    bool telemetry = false;
+    uint32_t telemetry_sample = 100;
     click_chatter("*******************************************************GLOBAL CONFIGURATION*******************************************************");
     if (cp_va_kparse(conf, this, errh,
             "MODE", cpkM, cpString, &mode,
@@ -35,6 +63,10 @@ int GlobalConf::configure(Vector<String> &conf, ErrorHandler *errh) {
             "DEFAULTRV", cpkM, cpString, &defRVFID,
             "iLID", cpkM, cpString, &internalLID,
             "TMFID", cpkN, cpString, &TMFID_str,
+            "RVSHARDS", 0, cpString, &RVShards_str,
+            "TMREPLICAS", 0, cpString, &TMReplicas_str,
+            "TELEMETRY", 0, cpBool, &telemetry,
+            "TELEMETRY_SAMPLE", 0, cpUnsigned, &telemetry_sample,
             cpEnd) < 0) {
         return -1;
     }
@@ -91,7 +123,11 @@ int GlobalConf::configure(Vector<String> &conf, ErrorHandler *errh) {
         notificationIID += (char) 255;
     }
     notificationIID += (char) 253;
+    groupNotificationIID = notificationIID;
     notificationIID += nodeID;
+    for (int j = 0; j < PURSUIT_ID_LEN; j++) {
+        groupNotificationIID += (char) 255;
+    }
     click_chatter("GlobalConf: NodeID: %s", nodeID.c_str());
     if (TMFID_str.length() != 0) {
         if (TMFID_str.length() != FID_LEN * 8) {
@@ -119,10 +155,99 @@ int GlobalConf::configure(Vector<String> &conf, ErrorHandler *errh) {
     if (defaultRV_dl == iLID) {
         click_chatter("GlobalConf: I am the RV node for this domain");
     }
+    if (RVShards_str.length() > 0) {
+        Vector<String> shards;
+        cp_spacevec(RVShards_str, shards);
+        for (int i = 0; i < shards.size(); i++) {
+            int colon = shards[i].find_left(':');
+            BABitvector fid;
+            if ((colon <= 0) || !parse_fid(shards[i].substring(colon + 1), fid)) {
+                return errh->error("RVSHARDS: %s is not a NODEID:FID pair of %d bits", shards[i].c_str(), FID_LEN * 8);
+            }
+            rvShardIDs.push_back(shards[i].substring(0, colon));
+            rvShardFIDs.push_back(fid);
+            for (uint32_t point = 0; point < RV_SHARD_POINTS; point++) {
+                rvRing.push_back(Pair<uint32_t, int>(ring_hash(rvShardIDs.back().data(), rvShardIDs.back().length(), point * 0x9E3779B9U), i));
+            }
+            click_chatter("GlobalConf: RV shard %s: %s%s", rvShardIDs.back().c_str(), fid.to_string().c_str(), (fid == iLID) ? " (this node)" : "");
+        }
+        /*few shards, so insertion sort will do*/
+        for (int i = 1; i < rvRing.size(); i++) {
+            Pair<uint32_t, int> point = rvRing[i];
+            int j = i - 1;
+            for (; (j >= 0) && (rvRing[j].first > point.first); j--) {
+                rvRing[j + 1] = rvRing[j];
+            }
+            rvRing[j + 1] = point;
+        }
+    }
+    tmAllFID = TMFID;
+    if (TMReplicas_str.length() > 0) {
+        Vector<String> replicas;
+        cp_spacevec(TMReplicas_str, replicas);
+        tmAllFID = BABitvector(FID_LEN * 8);
+        for (int i = 0; i < replicas.size(); i++) {
+            int colon = replicas[i].find_left(':');
+            BABitvector fid;
+            if ((colon <= 0) || !parse_fid(replicas[i].substring(colon + 1), fid)) {
+                return errh->error("TMREPLICAS: %s is not a NODEID:FID pair of %d bits", replicas[i].c_str(), FID_LEN * 8);
+            }
+            tmReplicaIDs.push_back(replicas[i].substring(0, colon));
+            tmReplicaFIDs.push_back(fid);
+            tmAllFID |= fid;
+            click_chatter("GlobalConf: TM replica %s: %s%s", tmReplicaIDs.back().c_str(), fid.to_string().c_str(), (fid == iLID) ? " (this node)" : "");
+        }
+    }
+    Telemetry::enabled = telemetry;
+    Telemetry::sample = telemetry_sample;
+    Telemetry::node = Telemetry::node_label(nodeID);
+    if (telemetry) {
+        click_chatter("GlobalConf: telemetry on, node label %u, hop traces for 1 in %u publications", Telemetry::node, telemetry_sample);
+    }
     //click_chatter("GlobalConf: configured!");
     return 0;
 }
 
+const BABitvector &GlobalConf::rvFID(const String &ID) const {
+    if (rvRing.empty()) {
+        return defaultRV_dl;
+    }
+    uint32_t hash = ring_hash(ID.data(), (ID.length() < PURSUIT_ID_LEN) ? ID.length() : PURSUIT_ID_LEN, 0);
+    /*the first point at or after the hash, wrapping around*/
+    int first = 0, last = rvRing.size();
+    while (first < last) {
+        int middle = (first + last) / 2;
+        if (rvRing[middle].first < hash) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+    return rvShardFIDs[rvRing[(first == rvRing.size()) ? 0 : first].second];
+}
+
+int GlobalConf::tmReplica(const String &key, const Vector<bool> &down) const {
+    int best = -1;
+    uint32_t best_weight = 0;
+    for (int i = 0; i < tmReplicaIDs.size(); i++) {
+        if (down[i]) {
+            continue;
+        }
+        uint32_t weight = ring_hash(key.data(), key.length(), ring_hash(tmReplicaIDs[i].data(), tmReplicaIDs[i].length(), 0));
+        /*FNV-1a ends with a multiplication, mix the last bytes into the high bits (murmur3 finalizer)*/
+        weight ^= weight >> 16;
+        weight *= 0x85EBCA6BU;
+        weight ^= weight >> 13;
+        weight *= 0xC2B2AE35U;
+        weight ^= weight >> 16;
+        if ((best < 0) || (weight > best_weight)) {
+            best = i;
+            best_weight = weight;
+        }
+    }
+    return best;
+}
+
 int GlobalConf::initialize(ErrorHandler *errh) {
     //click_chatter("GlobalConf: initialized!");
     return 0;
@@ -132,5 +257,47 @@ void GlobalConf::cleanup(CleanupStage stage) {
     click_chatter("GlobalConf: Cleaned Up!");
 }
 
+enum {H_TRACE, H_TRACE_LEVEL, H_TELEMETRY, H_HOP_TRACES, H_TELEMETRY_RESET};
+
+String GlobalConf::read_handler(Element *, void *thunk) {
+    switch ((intptr_t) thunk) {
+        case H_TRACE:
+            return Trace::drain();
+        case H_TRACE_LEVEL:
+            return Trace::unparse_levels();
+        case H_TELEMETRY:
+            return Telemetry::histograms();
+        case H_HOP_TRACES:
+            return Telemetry::drain();
+        default:
+            return String();
+    }
+}
+
+int GlobalConf::write_handler(const String &str, Element *, void *thunk, ErrorHandler *errh) {
+    switch ((intptr_t) thunk) {
+        case H_TRACE_LEVEL:
+            if (!Trace::configure(str)) {
+                return errh->error("expected CATEGORY LEVEL (forwarder, cache, proxy or all; off, error, info or debug, or 0 to 3)");
+            }
+            return 0;
+        case H_TELEMETRY_RESET:
+            Telemetry::reset();
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+void GlobalConf::add_handlers() {
+    add_read_handler("trace", read_handler, (void *) H_TRACE);
+    add_read_handler("trace_level", read_handler, (void *) H_TRACE_LEVEL);
+    add_write_handler("trace_level", write_handler, (void *) H_TRACE_LEVEL);
+    add_read_handler("telemetry", read_handler, (void *) H_TELEMETRY);
+    add_read_handler("hop_traces", read_handler, (void *) H_HOP_TRACES);
+    add_write_handler("telemetry_reset", write_handler, (void *) H_TELEMETRY_RESET);
+}
+
 CLICK_ENDDECLS
 EXPORT_ELEMENT(GlobalConf)
+ELEMENT_REQUIRES(Trace Telemetry)
@@ -68,6 +68,16 @@ public:
      * iLID:      a String representing the internal Link Identifier. It is wrapped to a BitVector.
      * 
      * TMFID:     a String representing the LIPSIN identifier to the domain's Topology Manager. It is wrapped to a BitVector.
+     *
+     * RVSHARDS:  Our proposal (optional) a space separated list of NODEID:FID pairs, one per rendezvous node of the domain. The RV state is then partitioned by root scope over these nodes (see rvFID).
+     *            All nodes of the domain must list the same node labels; the FIDs are their own FIDs to each of them.
+     *
+     * TMREPLICAS: Our proposal (optional) a space separated list of NODEID:FID pairs, one per Topology Manager replica of the domain. Every request is sent to one replica (see tmReplica),
+     *            the load reports of the Forwarder to all of them (see tmAllFID). All nodes of the domain must list the same node labels; TMFID is then not used.
+     *
+     * TELEMETRY: Our proposal (optional, false) stamps the packets of the data path and counts per stage latency histograms (see telemetry.hh). All nodes of the domain must agree.
+     *
+     * TELEMETRY_SAMPLE: Our proposal (optional, 100) 1 in TELEMETRY_SAMPLE publications sent by this node carries an in-band hop trace, 0 for none.
      */
     int configure(Vector<String>&, ErrorHandler*);
     /**
@@ -85,6 +95,26 @@ public:
     /**@brief It does nothing since nothing is dynamically allocated.
      */
     void cleanup(CleanupStage stage);
+    /**@brief read handlers: trace (drains the trace ring, see trace.hh), trace_level,
+     * telemetry (a line per stage: name, count and the log2 usec buckets), hop_traces (drains the hop traces that ended here: node:usec per hop).
+     * write handlers: trace_level ("CATEGORY LEVEL", e.g. "forwarder debug" or "all off"), telemetry_reset
+     */
+    void add_handlers();
+    static String read_handler(Element *e, void *thunk);
+    static int write_handler(const String &str, Element *e, void *thunk, ErrorHandler *errh);
+    /**@brief Our proposal the LIPSIN identifier to the rendezvous node responsible for ID (a full identifier or one starting with its root scope).
+     *
+     * Without RVSHARDS this is defaultRV_dl. Otherwise the root scope is hashed onto a ring where every shard has RV_SHARD_POINTS points (hashed from its node label),
+     * so that every node picks the same shard for a root scope and adding a shard moves only the root scopes that now fall on it.
+     * The whole graph under a root scope lives in one shard, so a scope can not be republished under a root scope of another shard.
+     */
+    const BABitvector &rvFID(const String &ID) const;
+    /**@brief Our proposal the TM replica (an index in tmReplicaFIDs) that handles the requests of key, or -1 if all replicas are down.
+     *
+     * Rendezvous hashing: every replica that is not down gets the weight hash(its node label, key) and the heaviest one wins, so all LocalRVs pick the same replica for an identifier
+     * and a replica that goes down only moves its own identifiers to the others (each to its second heaviest replica).
+     */
+    int tmReplica(const String &key, const Vector<bool> &down) const;
     /** @brief the Blackadder's node label.
      * 
      * This label should be statistically unique and it is self-assigned by the node itself.
@@ -99,6 +129,13 @@ public:
      * Right now it is calculated by the deployment application utility.
      */
     BABitvector defaultRV_dl;
+    /**@brief Our proposal the node labels and LIPSIN identifiers of the RV shards (empty without RVSHARDS).
+     */
+    Vector<String> rvShardIDs;
+    Vector<BABitvector> rvShardFIDs;
+    /**@brief Our proposal the consistent hashing ring: (point, index in rvShardFIDs) sorted by point.
+     */
+    Vector<Pair<uint32_t, int> > rvRing;
     /**@brief The internal Link Identifier of this Blackadder node.
      * 
      * Right now it is calculated by the deployment application utility.
@@ -110,6 +147,15 @@ public:
      * Right now it is calculated by the deployment application utility.
      */
     BABitvector TMFID;
+    /**@brief Our proposal the node labels and LIPSIN identifiers of the TM replicas (empty without TMREPLICAS).
+     */
+    Vector<String> tmReplicaIDs;
+    Vector<BABitvector> tmReplicaFIDs;
+    /**@brief Our proposal the LIPSIN identifier to all TM replicas (TMFID without TMREPLICAS).
+     *
+     * The topology updates reach every replica since they all subscribe to the control scope, and the load reports are sent with this FID, so all replicas keep the same graph.
+     */
+    BABitvector tmAllFID;
     /**@brief This boolean variable denotes the mode in which this Blackadder node runs.
      * 
      * True for overlaying over Ethernet.
@@ -148,6 +194,11 @@ public:
      * Note that the node label is the same size as the information labels (see helper.hh).
      */
     String notificationIID;
+    /**@brief the Information identifier of the notifications that the TM publishes once to a group of Blackadder nodes (our proposal).
+     * 
+     * It is hardcoded to be the /FFFFFFFFFFFFFFFD/FFFFFFFFFFFFFFFF. The LocalProxy accepts it like notificationIID and notifies only its own subscribers.
+     */
+    String groupNotificationIID;
 };
 
 CLICK_ENDDECLS
@@ -23,13 +23,20 @@
  */
 #define IBFSIZE PURSUIT_ID_LEN
 #define EBFSIZE IBFSIZE
+/**
+ *our proposal the number of hash functions of the information bloom filters (all nodes must agree on it)
+ */
+#define BF_HASHES 3
 /** The size in bytes of the label of each Blackadder node (should be statistically unique)
  *  This label is used as an information item in pub/sub requests and therefore it has to be the same size as the PURSUIT_ID_LEN
  */
 #define NODEID_LEN PURSUIT_ID_LEN
 /** The size in bytes of the all LIPSIN identifiers, Link identifiers and internal identifiers
+ *  our proposal it is a build option (configure --with-fid-len=32 for 256-bit FIDs) and must be the LIPSIN_ID_LENGTH of the deployment
  */
+#ifndef FID_LEN
 #define FID_LEN 8
+#endif
 /****some strategies*****/
 #define NODE_LOCAL          0
 #define LINK_LOCAL          1
@@ -49,8 +56,11 @@
 #define UNSUBSCRIBE_SCOPE 6
 #define UNSUBSCRIBE_INFO 7
 #define PUBLISH_DATA  8 //the request
-#define CONNECT 12
+#define LEASE_REFRESH 9 //our proposal a node renews (with no ID) the soft state a rendezvous node keeps for it
+#define LEASE_SWEEP_BATCH 64 //our proposal the default number of hosts the lease sweepers check per run
+#define CONNECT 12 //our proposal followed by a flags byte (CONNECT_SHM_RING)
 #define DISCONNECT 13
+#define SHM_DOORBELL 14 //our proposal the producer of a shared-memory ring wrote to it
 /*****************************/
 #define START_PUBLISH 100
 #define STOP_PUBLISH 101
@@ -67,6 +77,12 @@
 #define SCOPE_MATCH_PUB_SUB 109
 //k-anycast pub send scope probing message
 #define SCOPE_PROBING 110
+//our proposal many TM requests packed in one publication: no_requests (2 bytes) and (length (2 bytes), request)*
+#define BATCHED_REQUESTS 111
+//our proposal the per link byte counters a Forwarder reports to the TM (see TOPOLOGY_LINK_LOAD in lib/blackadder_defs.h)
+#define TOPOLOGY_LINK_LOAD 116
+/*our proposal CONNECT flags*/
+#define CONNECT_SHM_RING 1 //the application created the /blackadder.<pid>.up and .down rings
 /*RV RETURN CODES - these are unused..The LocalRV returns them for each pub/sub request*/
 #define SUCCESS 0
 #define WRONG_IDS 1
@@ -85,5 +101,62 @@
 /**********************************/
 #define SCOPE_PROBING_MESSAGE 1
 #define SUB_SCOPE_MESSAGE 2
+/*our proposal a single SCOPE_PROBING_MESSAGE to all subscribers of a scope (PROBE_AGGREGATE): instead of the hop count of one subscriber
+ *it ends with a table of the subscribers (node ID and hop count) and the caches add their hops from the publisher, the subscribers compute the distances*/
+#define SCOPE_PROBING_AGGREGATE 3
+/*flooded SUB_SCOPE_MESSAGEs carry a fixed size stamp: the origin node ID and a sequence number*/
+#define FLOOD_STAMP_LEN (NODEID_LEN + 4)
+/*seconds a Forwarder remembers a flooded request for duplicate suppression*/
+#define FLOOD_SEEN_LIFETIME 10
+/*the maximum number of remembered flooded requests*/
+#define FLOOD_SEEN_MAX 8192
+/*after the stamp flooded SUB_SCOPE_MESSAGEs carry a hop limit, decremented by every Forwarder they reach*/
+#define FLOOD_TTL_LEN 1
+/*a hop limit that is never decremented: flood the whole network*/
+#define FLOOD_TTL_UNLIMITED 255
+/*the LocalRV flushes a batch of TM requests once it grows beyond this size, so that it still fits in a single frame*/
+#define TM_BATCH_MAX_BYTES 1200
+/*our proposal the points every RV shard gets on the consistent hashing ring of root scopes (see GlobalConf::rvFID)*/
+#define RV_SHARD_POINTS 64
+//our proposal the LocalRV snapshot file (see LocalRV::writeSnapshot)
+#define RV_SNAPSHOT_MAGIC 0x56524142 //"BARV"
+#define RV_SNAPSHOT_VERSION 1
+/*our proposal the largest number of IDs whose local subscribers the LocalProxy keeps resolved (see LocalProxy::localFanOut); the table starts over when it is full*/
+#define LOCAL_FANOUT_MAX 4096
+
+/*Our proposal a publication larger than the FRAGMENT size of the LocalProxy is sent as fragments of the same ID.
+ *The data of every fragment starts with a FragmentHeader (all fields in network byte order)*/
+#define FRAGMENT_MAGIC 0xBAF7A600
+/*the largest publication that is fragmented and reassembled*/
+#define FRAGMENT_MAX_LENGTH (16 * 1024 * 1024)
+struct FragmentHeader {
+    uint32_t magic;
+    /*the same for all fragments of one publication: a hash of its content, so that fragments of the same content sent at different times (e.g. by a cache and by the publisher) can be reassembled together*/
+    uint32_t msg_id;
+    /*the length of the whole publication*/
+    uint32_t total_len;
+    /*where the data of this fragment goes in the publication*/
+    uint32_t offset;
+    uint16_t index;
+    uint16_t count;
+};
+/*Our proposal a CacheUnit that holds only some fragments of a publication appends the ranges it misses to its PLEASE_PUSH_DATA request (after the FID):
+ *msg_id (4 bytes), count (2 bytes), the number of ranges (2 bytes) and for each range its first and last index (2 bytes each), all in network byte order.
+ *The LocalProxy of the publisher then sends only these fragments to that FID*/
+#define FRAGMENT_RANGES_MAX 64
+
+/*Our proposal the load of whoever answers a probing message, appended after the publisher notification IID (all fields in network byte order).
+ *The publisher sends it empty, a CacheUnit that hits overwrites it with its own load*/
+struct ProbingLoad {
+    /*the subinfo requests the answering node served in the last second*/
+    uint16_t pending;
+    /*the packets waiting in its egress queue*/
+    uint16_t queue_depth;
+    /*the percentage of its requests it served in the last second (100 for a publisher)*/
+    uint8_t hit_rate;
+    uint8_t reserved;
+};
+/*the load (pending requests plus queued packets) a subscriber considers worth one hop*/
+#define PROBING_LOAD_UNIT 32
 
 #endif
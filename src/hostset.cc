@@ -0,0 +1,422 @@
+/*Our Proposal
+ *compact sets of remote hosts (see hostset.hh)
+*/
+#include "hostset.hh"
+#include "remotehost.hh"
+#include <click/glue.hh>
+
+CLICK_DECLS
+
+#define HOST_SET_WORDS (65536 / 64)
+
+HostTable HostTable::node_table ;
+
+HostHandle HostTable::intern(RemoteHost* host)
+{
+    HostHandle handle ;
+    if(!free_handles.empty())
+    {
+        /*reuse the smallest free handle, so that the sets stay in as few chunks as possible*/
+        int smallest = 0 ;
+        for(int i = 1 ; i < free_handles.size() ; i++)
+            if(free_handles[i] < free_handles[smallest])
+                smallest = i ;
+        handle = free_handles[smallest] ;
+        free_handles[smallest] = free_handles.back() ;
+        free_handles.pop_back() ;
+        hosts[handle] = host ;
+    }
+    else
+    {
+        handle = hosts.size() ;
+        hosts.push_back(host) ;
+    }
+    return handle ;
+}
+
+void HostTable::release(HostHandle handle)
+{
+    hosts[handle] = NULL ;
+    free_handles.push_back(handle) ;
+}
+
+static int next_bit(const uint64_t* bits, int pos)
+{
+    for(int word = pos / 64 ; word < HOST_SET_WORDS ; word++)
+    {
+        uint64_t w = bits[word] ;
+        if(word == pos / 64)
+            w &= ~(uint64_t) 0 << (pos % 64) ;
+        if(w != 0)
+            return word * 64 + __builtin_ctzll(w) ;
+    }
+    return -1 ;
+}
+
+/*the first index of values[0..count) that is not smaller than low*/
+static int lower_bound(const uint16_t* values, int count, uint16_t low)
+{
+    int first = 0, last = count ;
+    while(first < last)
+    {
+        int middle = (first + last) / 2 ;
+        if(values[middle] < low)
+            first = middle + 1 ;
+        else
+            last = middle ;
+    }
+    return first ;
+}
+
+void HostSet::iterator::settle()
+{
+    while(chunk < set->chunks.size())
+    {
+        const HostChunk& c = set->chunks[chunk] ;
+        if(c.bits == NULL)
+        {
+            if(pos < (int) c.count)
+                return ;
+        }
+        else if(pos < 65536)
+        {
+            int next = next_bit(c.bits, pos) ;
+            if(next >= 0)
+            {
+                pos = next ;
+                return ;
+            }
+        }
+        chunk++ ;
+        pos = 0 ;
+    }
+    pos = 0 ;
+}
+
+HostSet& HostSet::operator=(const HostSet& other)
+{
+    if(this != &other)
+    {
+        clear() ;
+        chunks.resize(other.chunks.size()) ;
+        for(int i = 0 ; i < other.chunks.size() ; i++)
+            copyChunk(chunks[i], other.chunks[i]) ;
+        count = other.count ;
+    }
+    return *this ;
+}
+
+int HostSet::findChunk(uint16_t high) const
+{
+    int first = 0, last = chunks.size() ;
+    while(first < last)
+    {
+        int middle = (first + last) / 2 ;
+        if(chunks[middle].high == high)
+            return middle ;
+        if(chunks[middle].high < high)
+            first = middle + 1 ;
+        else
+            last = middle ;
+    }
+    return -first - 1 ;
+}
+
+HostSet::iterator HostSet::find(RemoteHost* host) const
+{
+    HostHandle handle = host->handle ;
+    int index = findChunk(handle >> 16) ;
+    if(index < 0)
+        return end() ;
+    const HostChunk& c = chunks[index] ;
+    uint16_t low = handle & 0xFFFF ;
+    if(c.bits != NULL)
+        return containsLow(c, low) ? iterator(this, index, low) : end() ;
+    int pos = lower_bound(c.values, c.count, low) ;
+    return (pos < (int) c.count && c.values[pos] == low) ? iterator(this, index, pos) : end() ;
+}
+
+bool HostSet::find_insert(const RemoteHostSetItem& item)
+{
+    HostHandle handle = item._rhpointer->handle ;
+    int index = findChunk(handle >> 16) ;
+    if(index < 0)
+    {
+        HostChunk c ;
+        c.high = handle >> 16 ;
+        c.count = 0 ;
+        c.capacity = 0 ;
+        c.values = NULL ;
+        c.bits = NULL ;
+        index = -index - 1 ;
+        chunks.insert(chunks.begin() + index, c) ;
+    }
+    if(!insertLow(chunks[index], handle & 0xFFFF))
+        return false ;
+    count++ ;
+    return true ;
+}
+
+int HostSet::erase(RemoteHost* host)
+{
+    HostHandle handle = host->handle ;
+    int index = findChunk(handle >> 16) ;
+    if(index < 0 || !eraseLow(chunks[index], handle & 0xFFFF))
+        return 0 ;
+    count-- ;
+    if(chunks[index].count == 0)
+    {
+        freeChunk(chunks[index]) ;
+        chunks.erase(chunks.begin() + index) ;
+    }
+    return 1 ;
+}
+
+void HostSet::clear()
+{
+    for(int i = 0 ; i < chunks.size() ; i++)
+        freeChunk(chunks[i]) ;
+    chunks.clear() ;
+    count = 0 ;
+}
+
+void HostSet::unite(const HostSet& other)
+{
+    if(this == &other)
+        return ;
+    for(int i = 0 ; i < other.chunks.size() ; i++)
+    {
+        const HostChunk& o = other.chunks[i] ;
+        int index = findChunk(o.high) ;
+        if(index < 0)
+        {
+            HostChunk c ;
+            copyChunk(c, o) ;
+            chunks.insert(chunks.begin() + (-index - 1), c) ;
+            count += c.count ;
+            continue ;
+        }
+        HostChunk& c = chunks[index] ;
+        count -= c.count ;
+        if(c.bits == NULL && o.bits == NULL && c.count + o.count <= HOST_SET_ARRAY_MAX)
+        {
+            /*merge the two sorted arrays*/
+            uint16_t* values = new uint16_t[c.count + o.count] ;
+            uint32_t n = 0, a = 0, b = 0 ;
+            while(a < c.count || b < o.count)
+            {
+                if(b == o.count || (a < c.count && c.values[a] < o.values[b]))
+                    values[n++] = c.values[a++] ;
+                else if(a == c.count || o.values[b] < c.values[a])
+                    values[n++] = o.values[b++] ;
+                else
+                {
+                    values[n++] = c.values[a++] ;
+                    b++ ;
+                }
+            }
+            delete [] c.values ;
+            c.values = values ;
+            c.capacity = c.count + o.count ;
+            c.count = n ;
+        }
+        else
+        {
+            if(c.bits == NULL)
+                toBitmap(c) ;
+            if(o.bits != NULL)
+            {
+                c.count = 0 ;
+                for(int w = 0 ; w < HOST_SET_WORDS ; w++)
+                {
+                    c.bits[w] |= o.bits[w] ;
+                    c.count += __builtin_popcountll(c.bits[w]) ;
+                }
+            }
+            else
+                for(uint32_t v = 0 ; v < o.count ; v++)
+                    insertLow(c, o.values[v]) ;
+        }
+        count += c.count ;
+    }
+}
+
+void HostSet::intersect(const HostSet& other)
+{
+    if(this == &other)
+        return ;
+    count = 0 ;
+    for(int i = 0 ; i < chunks.size() ;)
+    {
+        HostChunk& c = chunks[i] ;
+        int index = other.findChunk(c.high) ;
+        if(index >= 0)
+        {
+            const HostChunk& o = other.chunks[index] ;
+            if(c.bits != NULL && o.bits != NULL)
+            {
+                c.count = 0 ;
+                for(int w = 0 ; w < HOST_SET_WORDS ; w++)
+                {
+                    c.bits[w] &= o.bits[w] ;
+                    c.count += __builtin_popcountll(c.bits[w]) ;
+                }
+                if(c.count <= HOST_SET_ARRAY_MAX / 2)
+                    toArray(c) ;
+            }
+            else if(c.bits != NULL)
+            {
+                /*the result is at most as large as the array of other*/
+                HostChunk result ;
+                copyChunk(result, o) ;
+                uint32_t n = 0 ;
+                for(uint32_t v = 0 ; v < o.count ; v++)
+                    if(containsLow(c, o.values[v]))
+                        result.values[n++] = o.values[v] ;
+                result.count = n ;
+                freeChunk(c) ;
+                c = result ;
+            }
+            else
+            {
+                uint32_t n = 0 ;
+                for(uint32_t v = 0 ; v < c.count ; v++)
+                    if(containsLow(o, c.values[v]))
+                        c.values[n++] = c.values[v] ;
+                c.count = n ;
+            }
+        }
+        else
+            c.count = 0 ;
+        if(c.count == 0)
+        {
+            freeChunk(c) ;
+            chunks.erase(chunks.begin() + i) ;
+            continue ;
+        }
+        count += c.count ;
+        i++ ;
+    }
+}
+
+size_t HostSet::bytes() const
+{
+    size_t total = chunks.capacity() * sizeof(HostChunk) ;
+    for(int i = 0 ; i < chunks.size() ; i++)
+        total += (chunks[i].bits != NULL) ? HOST_SET_WORDS * sizeof(uint64_t) : chunks[i].capacity * sizeof(uint16_t) ;
+    return total ;
+}
+
+bool HostSet::containsLow(const HostChunk& c, uint16_t low)
+{
+    if(c.bits != NULL)
+        return (c.bits[low / 64] >> (low % 64)) & 1 ;
+    int pos = lower_bound(c.values, c.count, low) ;
+    return pos < (int) c.count && c.values[pos] == low ;
+}
+
+bool HostSet::insertLow(HostChunk& c, uint16_t low)
+{
+    if(c.bits != NULL)
+    {
+        if((c.bits[low / 64] >> (low % 64)) & 1)
+            return false ;
+        c.bits[low / 64] |= (uint64_t) 1 << (low % 64) ;
+        c.count++ ;
+        return true ;
+    }
+    int pos = lower_bound(c.values, c.count, low) ;
+    if(pos < (int) c.count && c.values[pos] == low)
+        return false ;
+    if(c.count == HOST_SET_ARRAY_MAX)
+    {
+        toBitmap(c) ;
+        return insertLow(c, low) ;
+    }
+    if(c.count == c.capacity)
+    {
+        c.capacity = (c.capacity == 0) ? 4 : ((2 * c.capacity < HOST_SET_ARRAY_MAX) ? 2 * c.capacity : HOST_SET_ARRAY_MAX) ;
+        uint16_t* values = new uint16_t[c.capacity] ;
+        if(c.count > 0)
+            memcpy(values, c.values, c.count * sizeof(uint16_t)) ;
+        delete [] c.values ;
+        c.values = values ;
+    }
+    memmove(c.values + pos + 1, c.values + pos, (c.count - pos) * sizeof(uint16_t)) ;
+    c.values[pos] = low ;
+    c.count++ ;
+    return true ;
+}
+
+bool HostSet::eraseLow(HostChunk& c, uint16_t low)
+{
+    if(c.bits != NULL)
+    {
+        if(!((c.bits[low / 64] >> (low % 64)) & 1))
+            return false ;
+        c.bits[low / 64] &= ~((uint64_t) 1 << (low % 64)) ;
+        c.count-- ;
+        /*go back to an array well below the limit, so that a chunk at the limit does not flip at every change*/
+        if(c.count <= HOST_SET_ARRAY_MAX / 2)
+            toArray(c) ;
+        return true ;
+    }
+    int pos = lower_bound(c.values, c.count, low) ;
+    if(pos == (int) c.count || c.values[pos] != low)
+        return false ;
+    memmove(c.values + pos, c.values + pos + 1, (c.count - pos - 1) * sizeof(uint16_t)) ;
+    c.count-- ;
+    return true ;
+}
+
+void HostSet::toBitmap(HostChunk& c)
+{
+    c.bits = new uint64_t[HOST_SET_WORDS] ;
+    memset(c.bits, 0, HOST_SET_WORDS * sizeof(uint64_t)) ;
+    for(uint32_t v = 0 ; v < c.count ; v++)
+        c.bits[c.values[v] / 64] |= (uint64_t) 1 << (c.values[v] % 64) ;
+    delete [] c.values ;
+    c.values = NULL ;
+    c.capacity = 0 ;
+}
+
+void HostSet::toArray(HostChunk& c)
+{
+    c.capacity = (c.count > 0) ? c.count : 1 ;
+    c.values = new uint16_t[c.capacity] ;
+    uint32_t n = 0 ;
+    for(int pos = next_bit(c.bits, 0) ; pos >= 0 ; pos = (pos < 65535) ? next_bit(c.bits, pos + 1) : -1)
+        c.values[n++] = pos ;
+    delete [] c.bits ;
+    c.bits = NULL ;
+}
+
+void HostSet::freeChunk(HostChunk& c)
+{
+    delete [] c.values ;
+    delete [] c.bits ;
+    c.values = NULL ;
+    c.bits = NULL ;
+    c.count = 0 ;
+    c.capacity = 0 ;
+}
+
+void HostSet::copyChunk(HostChunk& to, const HostChunk& from)
+{
+    to = from ;
+    if(from.bits != NULL)
+    {
+        to.bits = new uint64_t[HOST_SET_WORDS] ;
+        memcpy(to.bits, from.bits, HOST_SET_WORDS * sizeof(uint64_t)) ;
+    }
+    else if(from.capacity > 0)
+    {
+        to.capacity = from.count > 0 ? from.count : 1 ;
+        to.values = new uint16_t[to.capacity] ;
+        memcpy(to.values, from.values, from.count * sizeof(uint16_t)) ;
+    }
+}
+
+CLICK_ENDDECLS
+
+ELEMENT_PROVIDES(HostSet)
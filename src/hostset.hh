@@ -0,0 +1,139 @@
+#ifndef HOSTSET_HH_INCLUDED
+#define HOSTSET_HH_INCLUDED
+
+#include <click/config.h>
+#include <click/vector.hh>
+
+CLICK_DECLS
+
+class RemoteHost;
+
+/**@brief a dense handle of a RemoteHost, given by the HostTable*/
+typedef uint32_t HostHandle ;
+
+/**@brief the largest sorted array of a HostSet chunk; a fuller chunk becomes a bitmap of 65536 bits (the same 8 KB)*/
+#define HOST_SET_ARRAY_MAX 4096
+
+/**@brief Our proposal the node-wide table of RemoteHost handles.
+ * Every RemoteHost gets the smallest free handle when it is constructed and gives it back when it is deleted, so handles stay dense and HostSets of them stay small.
+ * Only the LocalRV creates RemoteHosts, so the table is not locked*/
+class HostTable
+{
+public:
+    /**@brief the table shared by all elements of the node*/
+    static HostTable& node() {return node_table ;}
+    HostHandle intern(RemoteHost* host) ;
+    void release(HostHandle handle) ;
+    inline RemoteHost* host(HostHandle handle) const {return hosts[handle] ;}
+    /**@brief the number of live handles*/
+    inline int size() const {return hosts.size() - free_handles.size() ;}
+private:
+    static HostTable node_table ;
+    /**@brief indexed by handle*/
+    Vector<RemoteHost*> hosts ;
+    Vector<HostHandle> free_handles ;
+};
+
+/** @brief (blackadder Core) A click-compatible way of implementing a set of RemoteHost (see remotehost.hh)
+ *
+ * RemoteHostSetItem represents a RemoteHost that can be inserted in a set (a HostSet)
+ */
+struct RemoteHostSetItem {
+    /**@brief pointer to RemoteHost.
+     */
+    RemoteHost * _rhpointer;
+    /**@brief required by Click to implement Sets using a HashTable.
+     */
+    typedef RemoteHost * key_type;
+    /**@brief required by Click to implement Sets using a HashTable.
+     */
+    typedef RemoteHost * key_const_reference;
+    /**@brief required by Click to implement Sets using a HashTable.
+     */
+    key_const_reference hashkey() const {
+        return _rhpointer;
+    }
+    /**@brief required by Click to implement Sets using a HashTable.
+     */
+    RemoteHostSetItem(RemoteHost * rhp) : _rhpointer(rhp) {
+    }
+};
+
+/**@brief the members of a HostSet that share the upper 16 bits of their handle: a sorted array of the lower 16 bits or, above HOST_SET_ARRAY_MAX members, a bitmap*/
+struct HostChunk
+{
+    uint16_t high ;
+    uint32_t count ;
+    uint32_t capacity ;
+    uint16_t* values ;
+    uint64_t* bits ;
+};
+
+/**@brief Our proposal a set of RemoteHosts stored as their HostTable handles, in the way of a roaring bitmap.
+ * An empty set is a Vector; a member costs 2 bytes in a sorted array (or one bit once its chunk is dense) instead of a HashTable entry, and union and intersection work chunk by chunk.
+ * It has the interface of the Click HashTable of RemoteHostSetItem it replaces (find, find_insert, erase, iteration with (*it)._rhpointer), so the call sites are unchanged.
+ * Members are visited in handle order*/
+class HostSet
+{
+public:
+    class iterator
+    {
+    public:
+        iterator() : set(NULL), chunk(0), pos(0) {}
+        inline void operator++() {pos++ ; settle() ;}
+        inline void operator++(int) {pos++ ; settle() ;}
+        inline bool live() const {return chunk < set->chunks.size() ;}
+        inline HostHandle handle() const
+        {
+            const HostChunk& c = set->chunks[chunk] ;
+            return ((HostHandle) c.high << 16) | (c.bits ? pos : c.values[pos]) ;
+        }
+        inline RemoteHostSetItem operator*() const {return RemoteHostSetItem(HostTable::node().host(handle())) ;}
+        inline bool operator==(const iterator& other) const {return chunk == other.chunk && pos == other.pos ;}
+        inline bool operator!=(const iterator& other) const {return !(*this == other) ;}
+    private:
+        iterator(const HostSet* _set, int _chunk, int _pos) : set(_set), chunk(_chunk), pos(_pos) {settle() ;}
+        /**@brief moves to the first member at or after (chunk, pos)*/
+        void settle() ;
+        const HostSet* set ;
+        int chunk ;
+        int pos ;
+        friend class HostSet ;
+    };
+    HostSet() : count(0) {}
+    HostSet(const HostSet& other) : count(0) {*this = other ;}
+    ~HostSet() {clear() ;}
+    HostSet& operator=(const HostSet& other) ;
+    inline int size() const {return count ;}
+    inline bool empty() const {return count == 0 ;}
+    inline iterator begin() const {return iterator(this, 0, 0) ;}
+    inline iterator end() const {return iterator(this, chunks.size(), 0) ;}
+    iterator find(RemoteHost* host) const ;
+    inline bool contains(RemoteHost* host) const {return find(host) != end() ;}
+    /**@return true if the host was not a member*/
+    bool find_insert(const RemoteHostSetItem& item) ;
+    /**@return the number of removed members (0 or 1)*/
+    int erase(RemoteHost* host) ;
+    void clear() ;
+    /**@brief adds all members of other*/
+    void unite(const HostSet& other) ;
+    /**@brief keeps only the members that are also members of other*/
+    void intersect(const HostSet& other) ;
+    /**@brief the heap bytes used by the members*/
+    size_t bytes() const ;
+private:
+    /**@return the index of the chunk of high, or -(insertion index) - 1*/
+    int findChunk(uint16_t high) const ;
+    static bool containsLow(const HostChunk& c, uint16_t low) ;
+    static bool insertLow(HostChunk& c, uint16_t low) ;
+    static bool eraseLow(HostChunk& c, uint16_t low) ;
+    static void toBitmap(HostChunk& c) ;
+    static void toArray(HostChunk& c) ;
+    static void freeChunk(HostChunk& c) ;
+    static void copyChunk(HostChunk& to, const HostChunk& from) ;
+    Vector<HostChunk> chunks ;
+    int count ;
+};
+
+CLICK_ENDDECLS
+#endif // HOSTSET_HH_INCLUDED
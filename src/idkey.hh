@@ -0,0 +1,194 @@
+#ifndef IDKEY_HH_INCLUDED
+#define IDKEY_HH_INCLUDED
+
+#include <click/config.h>
+#include <click/string.hh>
+#include <click/hashcode.hh>
+
+#include "helper.hh"
+
+CLICK_DECLS
+
+/**@brief Our proposal the number of fragments up to which the IDTable keys identifiers with an IDKey (longer identifiers are keyed with Click Strings).
+ */
+#define ID_KEY_FRAGMENTS 4
+
+/**@brief Our proposal a full identifier of up to N fragments (PURSUIT_ID_LEN bytes each) stored inline in 64-bit words.
+ *
+ * It has no reference count and no allocation and is filled straight from the bytes of the identifier (e.g. from a packet, without a substring).
+ * The unused words are always 0, so that equality compares a fixed number of words (which the compiler unrolls or vectorises) and the hash needs no length check per byte.
+ */
+template <int N>
+class IDKey {
+public:
+    enum {
+        WORDS = (N * PURSUIT_ID_LEN + 7) / 8
+    };
+    IDKey() : frags(0) {
+        memset(words, 0, sizeof (words));
+    }
+    /**@brief true if an identifier of @a len bytes has an IDKey.*/
+    static inline bool fits(int len) {
+        return len > 0 && len % PURSUIT_ID_LEN == 0 && len / PURSUIT_ID_LEN <= N;
+    }
+    /**@brief fills the key with the identifier of @a len bytes at @a data (fits(len) must be true).*/
+    inline void assign(const char *data, int len) {
+        memset(words, 0, sizeof (words));
+        memcpy(words, data, len);
+        frags = len / PURSUIT_ID_LEN;
+    }
+    /**@brief the number of fragments, 0 for the empty key.*/
+    inline int fragments() const {
+        return frags;
+    }
+    inline bool empty() const {
+        return frags == 0;
+    }
+    /**@brief a 64-bit hash of the identifier: every word is mixed (the finaliser of MurmurHash3) and folded in with the fragment count.*/
+    inline uint64_t hash() const {
+        uint64_t h = frags * 0x9E3779B97F4A7C15ULL;
+        int used = (frags * PURSUIT_ID_LEN + 7) / 8;
+        for (int i = 0; i < used; i++) {
+            h = (h ^ mix(words[i])) * 0x9E3779B97F4A7C15ULL;
+        }
+        return mix(h);
+    }
+    /**@brief required by Click to use IDKey as the key of a HashTable.*/
+    inline hashcode_t hashcode() const {
+        return (hashcode_t) hash();
+    }
+    inline bool operator==(const IDKey &other) const {
+        unsigned diff = frags ^ other.frags;
+        for (int i = 0; i < WORDS; i++) {
+            diff |= (words[i] != other.words[i]);
+        }
+        return diff == 0;
+    }
+    inline bool operator!=(const IDKey &other) const {
+        return !(*this == other);
+    }
+private:
+    static inline uint64_t mix(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xFF51AFD7ED558CCDULL;
+        x ^= x >> 33;
+        x *= 0xC4CEB9FE1A85EC53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+    uint64_t words[WORDS];
+    int frags;
+};
+
+/**@brief Our proposal an open addressing (linear probing) hash table of IDKeys to V.
+ *
+ * The slots are one array that holds the keys inline with their hashes, so that a lookup is a hash and, mostly, a single compare in one cache line or two.
+ * Empty slots have an empty key. The table doubles when it is 3/4 full and erasures shift the following entries back, so that there are no tombstones.
+ */
+template <int N, typename V>
+class IDKeyTable {
+    struct Slot {
+        IDKey<N> key;
+        uint32_t hash;
+        V value;
+    };
+public:
+    IDKeyTable(const V &default_value) : slots(0), capacity(0), count(0), dflt(default_value) {}
+    ~IDKeyTable() {
+        delete[] slots;
+    }
+    inline int size() const {
+        return count;
+    }
+    /**@brief the value of @a key, or the default value.*/
+    inline const V &get(const IDKey<N> &key) const {
+        if (count == 0) {
+            return dflt;
+        }
+        uint32_t h = (uint32_t) key.hash();
+        for (uint32_t i = h & (capacity - 1);; i = (i + 1) & (capacity - 1)) {
+            const Slot &s = slots[i];
+            if (s.key.empty()) {
+                return dflt;
+            }
+            if (s.hash == h && s.key == key) {
+                return s.value;
+            }
+        }
+    }
+    /**@brief sets the value of @a key (adding it if it is not there).*/
+    void set(const IDKey<N> &key, const V &value) {
+        if ((count + 1) * 4 > capacity * 3) {
+            grow();
+        }
+        uint32_t h = (uint32_t) key.hash();
+        uint32_t i = h & (capacity - 1);
+        while (!slots[i].key.empty() && !(slots[i].hash == h && slots[i].key == key)) {
+            i = (i + 1) & (capacity - 1);
+        }
+        if (slots[i].key.empty()) {
+            slots[i].key = key;
+            slots[i].hash = h;
+            count++;
+        }
+        slots[i].value = value;
+    }
+    /**@brief removes @a key, returns 1 if it was there and 0 otherwise.*/
+    int erase(const IDKey<N> &key) {
+        if (count == 0) {
+            return 0;
+        }
+        uint32_t mask = capacity - 1;
+        uint32_t h = (uint32_t) key.hash();
+        uint32_t i = h & mask;
+        while (!(slots[i].hash == h && slots[i].key == key)) {
+            if (slots[i].key.empty()) {
+                return 0;
+            }
+            i = (i + 1) & mask;
+        }
+        /*backward shift: move up every following entry that may not be probed past the hole*/
+        uint32_t j = i;
+        while (true) {
+            j = (j + 1) & mask;
+            if (slots[j].key.empty()) {
+                break;
+            }
+            uint32_t home = slots[j].hash & mask;
+            if (((j - home) & mask) >= ((j - i) & mask)) {
+                slots[i] = slots[j];
+                i = j;
+            }
+        }
+        slots[i].key = IDKey<N>();
+        slots[i].value = dflt;
+        count--;
+        return 1;
+    }
+private:
+    void grow() {
+        Slot *old = slots;
+        uint32_t old_capacity = capacity;
+        capacity = capacity ? capacity * 2 : 64;
+        slots = new Slot[capacity];
+        for (uint32_t i = 0; i < capacity; i++) {
+            slots[i].value = dflt;
+        }
+        count = 0;
+        for (uint32_t i = 0; i < old_capacity; i++) {
+            if (!old[i].key.empty()) {
+                set(old[i].key, old[i].value);
+            }
+        }
+        delete[] old;
+    }
+    IDKeyTable(const IDKeyTable &);
+    IDKeyTable &operator=(const IDKeyTable &);
+    Slot *slots;
+    uint32_t capacity;
+    int count;
+    V dflt;
+};
+
+CLICK_ENDDECLS
+#endif // IDKEY_HH_INCLUDED
@@ -0,0 +1,120 @@
+/*Our Proposal
+ *the node-wide interning table of identifiers
+*/
+#include "idtable.hh"
+
+CLICK_DECLS
+
+IDTable IDTable::node_table ;
+
+IDTable::IDTable() : short_handles(ID_HANDLE_NONE), handles(ID_HANDLE_NONE), id_bytes(0)
+{
+    /*handle 0 is ID_HANDLE_NONE*/
+    ids.push_back(String()) ;
+    refs.push_back(0) ;
+}
+
+IDHandle IDTable::find_handle(const String& id) const
+{
+    if(IDKey<ID_KEY_FRAGMENTS>::fits(id.length()))
+    {
+        IDKey<ID_KEY_FRAGMENTS> key ;
+        key.assign(id.data(), id.length()) ;
+        return short_handles.get(key) ;
+    }
+    return handles.get(id) ;
+}
+
+void IDTable::set_handle(const String& id, IDHandle handle)
+{
+    if(IDKey<ID_KEY_FRAGMENTS>::fits(id.length()))
+    {
+        IDKey<ID_KEY_FRAGMENTS> key ;
+        key.assign(id.data(), id.length()) ;
+        short_handles.set(key, handle) ;
+    }
+    else
+        handles.set(id, handle) ;
+}
+
+void IDTable::erase_handle(const String& id)
+{
+    if(IDKey<ID_KEY_FRAGMENTS>::fits(id.length()))
+    {
+        IDKey<ID_KEY_FRAGMENTS> key ;
+        key.assign(id.data(), id.length()) ;
+        short_handles.erase(key) ;
+    }
+    else
+        handles.erase(id) ;
+}
+
+IDHandle IDTable::intern(const String& id)
+{
+    lock.acquire() ;
+    IDHandle handle = find_handle(id) ;
+    if(handle != ID_HANDLE_NONE)
+    {
+        refs[handle]++ ;
+        lock.release() ;
+        return handle ;
+    }
+    /*keep a private copy, so that an identifier cut out of a packet does not keep the whole packet data alive*/
+    if(!free_handles.empty())
+    {
+        handle = free_handles.back() ;
+        free_handles.pop_back() ;
+        ids[handle] = String(id.data(), id.length()) ;
+        refs[handle] = 1 ;
+    }
+    else
+    {
+        handle = ids.size() ;
+        ids.push_back(String(id.data(), id.length())) ;
+        refs.push_back(1) ;
+    }
+    set_handle(ids[handle], handle) ;
+    id_bytes += id.length() ;
+    lock.release() ;
+    return handle ;
+}
+
+IDHandle IDTable::lookup(const String& id) const
+{
+    lock.acquire() ;
+    IDHandle handle = find_handle(id) ;
+    lock.release() ;
+    return handle ;
+}
+
+void IDTable::retain(IDHandle handle)
+{
+    lock.acquire() ;
+    refs[handle]++ ;
+    lock.release() ;
+}
+
+void IDTable::release(IDHandle handle)
+{
+    lock.acquire() ;
+    if(--refs[handle] == 0)
+    {
+        id_bytes -= ids[handle].length() ;
+        erase_handle(ids[handle]) ;
+        ids[handle] = String() ;
+        free_handles.push_back(handle) ;
+    }
+    lock.release() ;
+}
+
+String IDTable::id(IDHandle handle) const
+{
+    lock.acquire() ;
+    String id = ids[handle] ;
+    lock.release() ;
+    return id ;
+}
+
+CLICK_ENDDECLS
+
+ELEMENT_PROVIDES(IDTable)
@@ -0,0 +1,163 @@
+#ifndef IDTABLE_HH_INCLUDED
+#define IDTABLE_HH_INCLUDED
+
+#include <click/config.h>
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <click/hashtable.hh>
+#include <click/sync.hh>
+
+#include "idkey.hh"
+
+CLICK_DECLS
+
+/**@brief a compact handle of an interned identifier (0 is never a valid handle)*/
+typedef uint32_t IDHandle ;
+
+#define ID_HANDLE_NONE 0
+
+/**@brief Our proposal the node-wide interning table of full scope and information identifiers.
+ * Every distinct identifier is stored once and is given a 32-bit handle, so that the rendezvous and proxy indexes hash and compare integers.
+ * Short identifiers are keyed inline (IDKey), so that a lookup neither hashes a String nor takes a reference to it.
+ * Handles are reference counted: an identifier is dropped (and its handle reused) when the last index entry holding it is erased.
+ * LocalRV and LocalProxy may run on different Click threads, so the table is protected by a spinlock*/
+class IDTable
+{
+public:
+    /**@brief the table shared by all elements of the node*/
+    static IDTable& node() {return node_table ;}
+    IDTable() ;
+    /**@brief returns the handle of id (adding it if it is unknown) and takes a reference to it*/
+    IDHandle intern(const String& id) ;
+    /**@brief returns the handle of id or ID_HANDLE_NONE if it is not interned (no reference is taken)*/
+    IDHandle lookup(const String& id) const ;
+    /**@brief takes one more reference to an interned handle*/
+    void retain(IDHandle handle) ;
+    /**@brief drops a reference; the identifier is forgotten when the last one is dropped*/
+    void release(IDHandle handle) ;
+    /**@brief returns the identifier of a handle*/
+    String id(IDHandle handle) const ;
+    /**@brief the number of interned identifiers (short and long ones)*/
+    int size() const {return short_handles.size() + handles.size() ;}
+    /**@brief the number of bytes of identifier data held by the table (of the short and the long identifiers alike, see intern and release)*/
+    size_t bytes() const {return id_bytes ;}
+private:
+    static IDTable node_table ;
+    /**@brief identifiers of up to ID_KEY_FRAGMENTS fragments (nearly all of them), hashed as inline words*/
+    IDKeyTable<ID_KEY_FRAGMENTS, IDHandle> short_handles ;
+    /**@brief the longer identifiers*/
+    HashTable<String, IDHandle> handles ;
+    IDHandle find_handle(const String& id) const ;
+    void set_handle(const String& id, IDHandle handle) ;
+    void erase_handle(const String& id) ;
+    /**@brief indexed by handle*/
+    Vector<String> ids ;
+    Vector<uint32_t> refs ;
+    Vector<IDHandle> free_handles ;
+    size_t id_bytes ;
+    mutable Spinlock lock ;
+};
+
+/**@brief Our proposal the key/value view of an IDIndex entry (the identifier is resolved through the IDTable)*/
+template <typename T>
+struct IDIndexPair
+{
+    IDIndexPair(const String& _first, const T& _second) : first(_first), second(_second) {}
+    String first ;
+    T second ;
+};
+
+/**@brief Our proposal a HashTable of full identifiers to T that is keyed on IDTable handles.
+ * It has the interface of the Click HashTable it replaces (get, set, find, erase, iteration with key(), value() and (*it).first/second),
+ * so the String based call sites are unchanged; code that already holds a handle can use the handle based methods and skip the String hash*/
+template <typename T>
+class IDIndex
+{
+    typedef HashTable<IDHandle, T> Table ;
+public:
+    class iterator
+    {
+    public:
+        iterator() {}
+        iterator(const typename Table::iterator& _it) : it(_it) {}
+        inline void operator++() {++it ;}
+        inline void operator++(int) {++it ;}
+        inline bool live() const {return it.live() ;}
+        inline IDHandle handle() const {return it.key() ;}
+        inline String key() const {return IDTable::node().id(it.key()) ;}
+        inline T& value() const {return it.value() ;}
+        inline IDIndexPair<T> operator*() const {return IDIndexPair<T>(key(), it.value()) ;}
+        inline bool operator==(const iterator& other) const {return it == other.it ;}
+        inline bool operator!=(const iterator& other) const {return it != other.it ;}
+    private:
+        typename Table::iterator it ;
+        friend class IDIndex ;
+    };
+    IDIndex() : table(T()) {}
+    IDIndex(const IDIndex& other) : table(other.table)
+    {
+        for(typename Table::iterator it = table.begin() ; it != table.end() ; it++)
+            IDTable::node().retain(it.key()) ;
+    }
+    ~IDIndex() {clear() ;}
+    IDIndex& operator=(const IDIndex& other)
+    {
+        if(this != &other)
+        {
+            clear() ;
+            table = other.table ;
+            for(typename Table::iterator it = table.begin() ; it != table.end() ; it++)
+                IDTable::node().retain(it.key()) ;
+        }
+        return *this ;
+    }
+    inline int size() const {return table.size() ;}
+    inline bool empty() const {return table.empty() ;}
+    inline const T& default_value() const {return table.default_value() ;}
+    inline iterator begin() {return iterator(table.begin()) ;}
+    inline iterator end() {return iterator(table.end()) ;}
+    inline const T& get(IDHandle handle) const {return table.get(handle) ;}
+    inline const T& get(const String& id) const {return table.get(IDTable::node().lookup(id)) ;}
+    inline iterator find(IDHandle handle) {return iterator(table.find(handle)) ;}
+    inline iterator find(const String& id) {return iterator(table.find(IDTable::node().lookup(id))) ;}
+    void set(const String& id, const T& value)
+    {
+        IDHandle handle = IDTable::node().lookup(id) ;
+        typename Table::iterator it = table.find(handle) ;
+        if(it != table.end())
+        {
+            it.value() = value ;
+            return ;
+        }
+        table.set(IDTable::node().intern(id), value) ;
+    }
+    int erase(const String& id)
+    {
+        return erase(IDTable::node().lookup(id)) ;
+    }
+    int erase(IDHandle handle)
+    {
+        if(handle == ID_HANDLE_NONE || table.erase(handle) == 0)
+            return 0 ;
+        IDTable::node().release(handle) ;
+        return 1 ;
+    }
+    iterator erase(const iterator& it)
+    {
+        IDHandle handle = it.handle() ;
+        iterator next(table.erase(it.it)) ;
+        IDTable::node().release(handle) ;
+        return next ;
+    }
+    void clear()
+    {
+        for(typename Table::iterator it = table.begin() ; it != table.end() ; it++)
+            IDTable::node().release(it.key()) ;
+        table.clear() ;
+    }
+private:
+    Table table ;
+};
+
+CLICK_ENDDECLS
+#endif // IDTABLE_HH_INCLUDED
@@ -0,0 +1,171 @@
+#ifndef IDTRIE_HH_INCLUDED
+#define IDTRIE_HH_INCLUDED
+
+#include <click/config.h>
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <click/pair.hh>
+#include <click/hashtable.hh>
+#include "helper.hh"
+#include "idtable.hh"
+
+CLICK_DECLS
+
+/**@brief Our proposal a fragment-level trie of full identifiers.
+ * Every edge is one PURSUIT_ID_LEN fragment, so the node of a full identifier is reached in (length / PURSUIT_ID_LEN) steps and
+ * every identifier that starts with a prefix lives in the subtree of the prefix node. Nodes without a value and without children are pruned*/
+template <typename T>
+class IDTrie
+{
+    struct Node
+    {
+        Node(Node* _parent, const String& _fragment) : value(), has_value(false), parent(_parent), fragment(_fragment), children(NULL) {}
+        T value ;
+        bool has_value ;
+        Node* parent ;
+        /**@brief the fragment of the edge from the parent*/
+        String fragment ;
+        HashTable<String, Node*> children ;
+    };
+public:
+    IDTrie() : root(NULL, String()), count(0) {}
+    ~IDTrie() {clear() ;}
+    /**@brief the number of identifiers in the trie*/
+    inline int size() const {return count ;}
+    /**@brief maps id to value*/
+    void insert(const String& id, const T& value)
+    {
+        Node* node = &root ;
+        for(int i = 0 ; i + PURSUIT_ID_LEN <= id.length() ; i += PURSUIT_ID_LEN)
+        {
+            String fragment = id.substring(i, PURSUIT_ID_LEN) ;
+            Node* child = node->children.get(fragment) ;
+            if(child == NULL)
+            {
+                child = new Node(node, String(fragment.data(), fragment.length())) ;
+                node->children.set(child->fragment, child) ;
+            }
+            node = child ;
+        }
+        if(!node->has_value)
+            count++ ;
+        node->value = value ;
+        node->has_value = true ;
+    }
+    /**@brief removes id (if it exists) and prunes the nodes left empty*/
+    void remove(const String& id)
+    {
+        Node* node = lookup(id) ;
+        if(node == NULL || !node->has_value)
+            return ;
+        node->value = T() ;
+        node->has_value = false ;
+        count-- ;
+        while(node != &root && !node->has_value && node->children.empty())
+        {
+            Node* parent = node->parent ;
+            parent->children.erase(node->fragment) ;
+            delete node ;
+            node = parent ;
+        }
+    }
+    /**@brief appends (suffix relative to prefix, value) for all identifiers that start with prefix (including prefix itself, with an empty suffix)*/
+    void subtree(const String& prefix, Vector<Pair<String, T> >& out) const
+    {
+        const Node* node = lookup(prefix) ;
+        if(node != NULL)
+            collect(node, String(), out) ;
+    }
+    /**@brief returns the number of identifiers that start with prefix*/
+    int subtree_size(const String& prefix) const
+    {
+        const Node* node = lookup(prefix) ;
+        return (node != NULL) ? count_nodes(node) : 0 ;
+    }
+    void clear()
+    {
+        destroy(&root) ;
+        root.value = T() ;
+        root.has_value = false ;
+        count = 0 ;
+    }
+private:
+    IDTrie(const IDTrie&) ;
+    IDTrie& operator=(const IDTrie&) ;
+    Node* lookup(const String& id) const
+    {
+        Node* node = const_cast<Node*>(&root) ;
+        for(int i = 0 ; node != NULL && i + PURSUIT_ID_LEN <= id.length() ; i += PURSUIT_ID_LEN)
+            node = node->children.get(id.substring(i, PURSUIT_ID_LEN)) ;
+        return node ;
+    }
+    static void collect(const Node* node, const String& suffix, Vector<Pair<String, T> >& out)
+    {
+        if(node->has_value)
+            out.push_back(Pair<String, T>(suffix, node->value)) ;
+        for(typename HashTable<String, Node*>::const_iterator it = node->children.begin() ; it != node->children.end() ; it++)
+            collect(it.value(), suffix + it.key(), out) ;
+    }
+    static int count_nodes(const Node* node)
+    {
+        int n = node->has_value ? 1 : 0 ;
+        for(typename HashTable<String, Node*>::const_iterator it = node->children.begin() ; it != node->children.end() ; it++)
+            n += count_nodes(it.value()) ;
+        return n ;
+    }
+    static void destroy(Node* node)
+    {
+        for(typename HashTable<String, Node*>::iterator it = node->children.begin() ; it != node->children.end() ; it++)
+        {
+            destroy(it.value()) ;
+            delete it.value() ;
+        }
+        node->children.clear() ;
+    }
+    Node root ;
+    int count ;
+};
+
+/**@brief Our proposal the rendezvous index of LocalRV: an IDIndex (exact lookups on interned handles) kept in step with an IDTrie (prefix queries over the information graph).
+ * Every id set or erased here is mirrored in the trie, so subtree() returns everything that lives under a scope identifier without walking the graph*/
+template <typename T>
+class GraphIndex : public IDIndex<T>
+{
+    typedef IDIndex<T> Base ;
+public:
+    typedef typename Base::iterator iterator ;
+    void set(const String& id, const T& value)
+    {
+        Base::set(id, value) ;
+        trie.insert(id, value) ;
+    }
+    int erase(const String& id)
+    {
+        trie.remove(id) ;
+        return Base::erase(id) ;
+    }
+    int erase(IDHandle handle)
+    {
+        trie.remove(IDTable::node().id(handle)) ;
+        return Base::erase(handle) ;
+    }
+    iterator erase(const iterator& it)
+    {
+        trie.remove(it.key()) ;
+        return Base::erase(it) ;
+    }
+    void clear()
+    {
+        trie.clear() ;
+        Base::clear() ;
+    }
+    /**@brief see IDTrie::subtree*/
+    inline void subtree(const String& prefix, Vector<Pair<String, T> >& out) const {trie.subtree(prefix, out) ;}
+    /**@brief see IDTrie::subtree_size*/
+    inline int subtree_size(const String& prefix) const {return trie.subtree_size(prefix) ;}
+private:
+    IDTrie<T> trie ;
+};
+
+CLICK_ENDDECLS
+#endif // IDTRIE_HH_INCLUDED
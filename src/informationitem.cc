@@ -21,6 +21,8 @@ InformationItem::InformationItem(unsigned char _strategy, Scope *_father_scope)
     fatherScopes.find_insert(ScopeSetItem(_father_scope));
     _father_scope->informationitems.find_insert(InformationItemSetItem(this));
     strategy = _strategy;
+    effectiveSubscribersChanged = false;
+    addFatherSubscribers(_father_scope);
 }
 
 /*Destructor - Ensure that all pairs are deleted*/
@@ -81,9 +83,62 @@ bool InformationItem::updateSubscribers(String fullID, RemoteHost *_subscriber)
         pair->second.find_insert(_subscriber);
         ids.set(fullID, pair);
     }
+    addEffectiveSubscriber(_subscriber);
     return true;
 }
 
+bool InformationItem::removeSubscriber(String fullID, RemoteHost *_subscriber) {
+    RemoteHostPair * pair = ids.get(fullID);
+    if ((pair == ids.default_value()) || (pair->second.find(_subscriber) == pair->second.end())) {
+        return false;
+    }
+    pair->second.erase(_subscriber);
+    removeEffectiveSubscriber(_subscriber);
+    return true;
+}
+
+void InformationItem::addEffectiveSubscriber(RemoteHost *_subscriber) {
+    RemoteHostCountMapIter it = effectiveSubscribers.find(_subscriber);
+    if (it == effectiveSubscribers.end()) {
+        effectiveSubscribers.set(_subscriber, 1);
+        effectiveSubscribersChanged = true;
+    } else {
+        it.value()++;
+    }
+}
+
+void InformationItem::removeEffectiveSubscriber(RemoteHost *_subscriber) {
+    RemoteHostCountMapIter it = effectiveSubscribers.find(_subscriber);
+    if (it != effectiveSubscribers.end()) {
+        if (--it.value() == 0) {
+            effectiveSubscribers.erase(it);
+            effectiveSubscribersChanged = true;
+        }
+    }
+}
+
+void InformationItem::addFatherSubscribers(Scope *fatherScope) {
+    for (IdsHashMapIter id_it = fatherScope->ids.begin(); id_it != fatherScope->ids.end(); id_it++) {
+        for (RemoteHostSetIter subscriber_it = (*id_it).second->second.begin(); subscriber_it != (*id_it).second->second.end(); subscriber_it++) {
+            addEffectiveSubscriber((*subscriber_it)._rhpointer);
+        }
+    }
+}
+
+void InformationItem::removeFatherSubscribers(Scope *fatherScope) {
+    for (IdsHashMapIter id_it = fatherScope->ids.begin(); id_it != fatherScope->ids.end(); id_it++) {
+        for (RemoteHostSetIter subscriber_it = (*id_it).second->second.begin(); subscriber_it != (*id_it).second->second.end(); subscriber_it++) {
+            removeEffectiveSubscriber((*subscriber_it)._rhpointer);
+        }
+    }
+}
+
+void InformationItem::getEffectiveSubscribers(RemoteHostSet &subscribers) {
+    for (RemoteHostCountMapIter it = effectiveSubscribers.begin(); it != effectiveSubscribers.end(); it++) {
+        subscribers.find_insert(RemoteHostSetItem(it.key()));
+    }
+}
+
 /*Return true if there are active publishers or subscribers for that InformationItem under the specific fatherScope*/
 bool InformationItem::checkForOtherPubSub(Scope *fatherScope) {
     String suffixID = (*ids.begin()).first.substring((*ids.begin()).first.length() - PURSUIT_ID_LEN, PURSUIT_ID_LEN);
@@ -99,20 +154,14 @@ bool InformationItem::checkForOtherPubSub(Scope *fatherScope) {
 void InformationItem::getSubscribers(RemoteHostSet &subscribers) {
     /*add the subscribers of this information item for all ids*/
     for (IdsHashMapIter id_it = ids.begin(); id_it != ids.end(); id_it++) {
-        RemoteHostSetIter subscriber_it;
-        for (subscriber_it = (*id_it).second->second.begin(); subscriber_it != (*id_it).second->second.end(); subscriber_it++) {
-            subscribers.find_insert(*subscriber_it);
-        }
+        subscribers.unite((*id_it).second->second);
     }
 }
 
 void InformationItem::getPublishers(RemoteHostSet &publishers) {
     /*add the publishers of this information item for all ids*/
     for (IdsHashMapIter id_it = ids.begin(); id_it != ids.end(); id_it++) {
-        RemoteHostSetIter publisher_it;
-        for (publisher_it = (*id_it).second->first.begin(); publisher_it != (*id_it).second->first.end(); publisher_it++) {
-            publishers.find_insert((*publisher_it));
-        }
+        publishers.unite((*id_it).second->first);
     }
 }
 
@@ -92,6 +92,34 @@ public:
      * @param subscribers a set of subscribers passed by reference.
      */
     void getSubscribers(RemoteHostSet &subscribers);
+    /**
+     * @brief Removes the subscriber from the set of subscribers of the provided identifier and updates the effective subscribers.
+     * 
+     * @param fullID the information identifier for which the set of subscribers will be updated.
+     * @param _subscriber A pointer to a RemoteHost representing a subscriber.
+     * @return False if the subscriber was not in the set for the provided ID.
+     */
+    bool removeSubscriber(String fullID, RemoteHost *_subscriber);
+    /**
+     * @brief Updates the provided set of subscribers with the effective subscribers of this item: the subscribers of all its ids AND of all ids of its father scopes.
+     * 
+     * It returns what getSubscribers() plus getSubscribers() of every father scope would, without walking the father scopes.
+     * @param subscribers a set of subscribers passed by reference.
+     */
+    void getEffectiveSubscribers(RemoteHostSet &subscribers);
+    /**
+     * @brief Takes a reference to _subscriber in the effective subscribers. Called for every subscription added to the item or to one of its father scopes.
+     */
+    void addEffectiveSubscriber(RemoteHost *_subscriber);
+    /**
+     * @brief Drops a reference to _subscriber from the effective subscribers. Called for every subscription removed from the item or from one of its father scopes.
+     */
+    void removeEffectiveSubscriber(RemoteHost *_subscriber);
+    /**
+     * @brief Adds (or removes) the subscriptions of all ids of a scope that becomes (or stops being) a father of this item to the effective subscribers.
+     */
+    void addFatherSubscribers(Scope *fatherScope);
+    void removeFatherSubscribers(Scope *fatherScope);
     /**
      * @brief Returns the first identifier of this InformationItem in a binary format. It has to be quoted_hex() for printing in the usual hex format.
      * 
@@ -110,9 +138,15 @@ public:
      */
     IdsHashMap ids;
     /**
-     * @brief A set containing all subscribers for this item (regardless of the potentially multiple ids)
+     * @brief All effective subscribers of this item (regardless of the potentially multiple ids), each mapped to the number of subscriptions (of the item or of a father scope, for any id) it holds.
+     *
+     * It is maintained incrementally as subscriptions change, so that a rendezvous does not have to rebuild the set from all father scopes.
+     */
+    RemoteHostCountMap effectiveSubscribers;
+    /**
+     * @brief True if the set of effective subscribers changed since the last rendezvous for this item.
      */
-    RemoteHostSet fullSubscribersList;
+    bool effectiveSubscribersChanged;
     /** 
      * @brief A set of scopes which are the father of this information item
      */
@@ -0,0 +1,173 @@
+#ifndef LINKHEADER_HH_INCLUDED
+#define LINKHEADER_HH_INCLUDED
+
+#include <click/config.h>
+#include <click/packet.hh>
+#include <clicknet/ip.h>
+#include <clicknet/udp.h>
+
+CLICK_DECLS
+
+/**@brief The classes of the messages between nodes (the ethertypes for which the Forwarder counts the packets it sends).
+ */
+enum {
+    FW_ETHER_PUB,/*0x080a*/
+    FW_ETHER_SUBINFO,/*0x080b*/
+    FW_ETHER_PROBING,/*0x080c*/
+    FW_ETHER_DATAPUSH,/*0x080d*/
+    FW_ETHER_KANYCAST,/*0x0901 (flooded requests)*/
+    FW_ETHER_OTHER,
+    FW_ETHERTYPES
+};
+
+/**@brief Our proposal the traffic classes of the egress queues of a node, in the PAINT annotation of every packet the Forwarder sends to a link.
+ *
+ * Scope probing, subinfo requests and flooded requests are control, publications and data pushes are data:
+ * a PaintSwitch in front of the device can then keep the control messages ahead of bulk data (see deployment, egress).
+ */
+enum {
+    LINK_TRAFFIC_CONTROL,
+    LINK_TRAFFIC_DATA
+};
+
+/**@brief Our proposal the length of the link header in MAC mode: an ethernet header.
+ */
+#define LINK_ETHER_LEN 14
+/**@brief Our proposal the length of the link header in IP mode: an IP header without options and a UDP header.
+ */
+#define LINK_IP_LEN (sizeof (click_ip) + sizeof (click_udp))
+/**@brief Our proposal the UDP destination port of the datagrams between nodes in IP mode (the port the RawSocket of the node binds).
+ */
+#define LINK_UDP_PORT 55000
+
+/**@brief Our proposal how the UDP checksum of the datagrams between nodes is filled in (IP mode).
+ */
+enum {
+    LINK_UDP_CSUM_FULL,/*computed in software - the payload is summed once per packet, not once per link*/
+    LINK_UDP_CSUM_NONE,/*0, "no checksum" in IPv4 - the link layer CRC still protects every hop*/
+    LINK_UDP_CSUM_OFFLOAD/*the pseudo header sum only, the NIC completes it (CHECKSUM_PARTIAL, kernel click)*/
+};
+
+/**@brief Our proposal the IP and UDP headers of a link, filled in once when the Forwarder is configured.
+ *
+ * Only ip_len, ip_id, the UDP source port (the class), uh_ulen and the checksums change from packet to packet:
+ * ip_partial and udp_partial are the (unfolded) one's complement sums of everything else, so that both checksums are updated incrementally.
+ */
+struct LinkTemplate {
+    click_ip ip;
+    click_udp udp;
+    /**@brief the sum of the IP header with ip_len, ip_id and ip_sum set to 0.*/
+    uint32_t ip_partial;
+    /**@brief the sum of the UDP pseudo header without the length.*/
+    uint32_t udp_partial;
+};
+
+/**@brief Our proposal the encapsulation of the packets between nodes, for both network modes.
+ *
+ * In MAC mode a packet is an ethernet frame and its class (FW_ETHER_*) is the ethertype, so that a Classifier can dispatch it.
+ * In IP mode it is a UDP datagram to LINK_UDP_PORT from port LINK_UDP_PORT + class, so that an IPClassifier on the source port dispatches it the same way.
+ * Everything after the link header is the same in both modes: the elements only need length() as the offset of the FID and, when they build a packet, set_class().
+ * The addresses are written per link by the Forwarder.
+ */
+class LinkHeader {
+public:
+    /**@brief the length of the link header.*/
+    static inline uint32_t length(bool use_mac) {
+        return use_mac ? LINK_ETHER_LEN : LINK_IP_LEN;
+    }
+    /**@brief the ethertype (host order) of a message class, 0 for FW_ETHER_OTHER.*/
+    static inline uint16_t ether_type(int cls) {
+        static const uint16_t types[FW_ETHER_OTHER] = {0x080a, 0x080b, 0x080c, 0x080d, 0x0901};
+        return (cls >= 0 && cls < FW_ETHER_OTHER) ? types[cls] : 0;
+    }
+    /**@brief the traffic class (LINK_TRAFFIC_*) of a message class.*/
+    static inline int traffic_class(int cls) {
+        return (cls == FW_ETHER_PUB || cls == FW_ETHER_DATAPUSH) ? LINK_TRAFFIC_DATA : LINK_TRAFFIC_CONTROL;
+    }
+    /**@brief the message class of a packet that starts with its link header.*/
+    static inline int message_class(const Packet *p, bool use_mac) {
+        uint16_t value;
+        if (use_mac) {
+            memcpy(&value, p->data() + 12, sizeof (value));
+            value = ntohs(value);
+            for (int cls = 0; cls < FW_ETHER_OTHER; cls++) {
+                if (ether_type(cls) == value) {
+                    return cls;
+                }
+            }
+            return FW_ETHER_OTHER;
+        }
+        const click_udp *udp = reinterpret_cast<const click_udp *> (p->data() + sizeof (click_ip));
+        value = ntohs(udp->uh_sport) - LINK_UDP_PORT;
+        return (value < FW_ETHER_OTHER) ? value : FW_ETHER_OTHER;
+    }
+    /**@brief writes the message class to the link header of @a p (the rest of the header is left to the Forwarder).*/
+    static inline void set_class(WritablePacket *p, int cls, bool use_mac) {
+        if (use_mac) {
+            uint16_t type = htons(ether_type(cls));
+            memcpy(p->data() + 12, &type, sizeof (type));
+        } else {
+            click_udp *udp = reinterpret_cast<click_udp *> (p->data() + sizeof (click_ip));
+            udp->uh_sport = htons(LINK_UDP_PORT + cls);
+        }
+    }
+    /**@brief fills in the header template of the link from @a src to @a dst (IP mode).*/
+    static inline void prepare_ip(LinkTemplate &t, struct in_addr src, struct in_addr dst) {
+        memset(&t, 0, sizeof (t));
+        t.ip.ip_v = 4;
+        t.ip.ip_hl = sizeof (click_ip) >> 2;
+        t.ip.ip_p = IP_PROTO_UDP;
+        t.ip.ip_src = src;
+        t.ip.ip_dst = dst;
+        t.ip.ip_ttl = 250;
+        t.udp.uh_dport = htons(LINK_UDP_PORT);
+        /*one's complement sums do not depend on the byte order, so the words are added as stored*/
+        t.ip_partial = sum16((const unsigned char *) &t.ip, sizeof (click_ip));
+        t.udp_partial = sum16((const unsigned char *) &src, sizeof (src)) + sum16((const unsigned char *) &dst, sizeof (dst)) + htons(IP_PROTO_UDP);
+    }
+    /**@brief the (folded, not complemented) one's complement sum of what follows the link header of @a p, for LINK_UDP_CSUM_FULL.
+     * The copies of a packet to several links share it.
+     */
+    static inline uint16_t payload_sum(const Packet *p) {
+        return ~click_in_cksum(p->data() + LINK_IP_LEN, p->length() - LINK_IP_LEN);
+    }
+    /**@brief writes the IP and UDP headers of a datagram of class @a cls over the link of template @a t (IP mode) - the packet length is that of @a p.
+     * @a psum is payload_sum() of the packet (only used with LINK_UDP_CSUM_FULL).
+     */
+    static inline void write_ip(WritablePacket *p, const LinkTemplate &t, uint16_t ip_id, int cls, int csum_mode, uint16_t psum) {
+        click_ip *ip = reinterpret_cast<click_ip *> (p->data());
+        click_udp *udp = reinterpret_cast<click_udp *> (ip + 1);
+        memcpy(ip, &t.ip, LINK_IP_LEN);
+        ip->ip_len = htons(p->length());
+        ip->ip_id = htons(ip_id);
+        ip->ip_sum = ~fold(t.ip_partial + ip->ip_len + ip->ip_id);
+        p->set_ip_header(ip, sizeof (click_ip));
+        udp->uh_sport = htons(LINK_UDP_PORT + cls);
+        udp->uh_ulen = htons(p->length() - sizeof (click_ip));
+        if (csum_mode == LINK_UDP_CSUM_FULL) {
+            /*the length is in both the pseudo header and the header*/
+            uint16_t sum = ~fold(t.udp_partial + udp->uh_ulen + udp->uh_ulen + udp->uh_sport + udp->uh_dport + psum);
+            udp->uh_sum = (sum == 0) ? 0xFFFF : sum;
+        } else if (csum_mode == LINK_UDP_CSUM_OFFLOAD) {
+            udp->uh_sum = fold(t.udp_partial + udp->uh_ulen);
+        }
+    }
+private:
+    static inline uint32_t sum16(const unsigned char *data, int len) {
+        uint32_t sum = 0;
+        uint16_t word;
+        for (int i = 0; i + 1 < len; i += 2) {
+            memcpy(&word, data + i, sizeof (word));
+            sum += word;
+        }
+        return sum;
+    }
+    static inline uint16_t fold(uint32_t sum) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+        sum = (sum & 0xFFFF) + (sum >> 16);
+        return sum;
+    }
+};
+
+CLICK_ENDDECLS
+#endif // LINKHEADER_HH_INCLUDED
@@ -18,6 +18,7 @@ CLICK_DECLS
 LocalHost::LocalHost(int _type, int _id) {
     type = _type;
     id = _id;
+    floods_limited = 0;
     switch (type) {
         case LOCAL_PROCESS:
             localHostID = "app" + String::make_numeric((uint64_t) id);
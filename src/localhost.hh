@@ -17,9 +17,26 @@
 
 #include "helper.hh"
 #include "common.hh"
+#include "floodbucket.hh"
 
 CLICK_DECLS
 
+class LocalHost;
+class ActivePublication;
+
+/**@brief Our proposal what the LocalProxy resolved for the last publish_data of a LocalHost: the ActivePublication and its local subscribers (see LocalProxy::handleUserPublication).
+ * It is valid only while epoch equals the epoch of the LocalProxy, which changes with every publication, subscription and RV notification.
+ */
+struct PublicationCache {
+    PublicationCache() : epoch(0), ap(NULL) {}
+    uint64_t epoch;
+    String ID;
+    ActivePublication *ap;
+    /**@brief the local subscribers (without the publisher) and the ID each one subscribed to*/
+    Vector<LocalHost *> subscribers;
+    Vector<String> subscriberIDs;
+};
+
 /**
  * @brief (blackadder Core) The LocalHost class represents a local software entity that accesses Blackadder's world using the provided service model.
  * 
@@ -51,6 +68,12 @@ public:
      * 
      */
     StringSet activeSubscriptions;
+    /**@brief Our proposal the fast path of repeated publish_data requests for the same ID*/
+    PublicationCache lastPublication;
+    /**@brief Our proposal limits the scope subscriptions of this LocalHost, which may each turn into a network-wide flood (see LocalProxy HOST_FLOOD_RATE)*/
+    FloodBucket flood_bucket;
+    /**@brief Our proposal the scope subscriptions of this LocalHost refused by flood_bucket*/
+    uint64_t floods_limited;
 };
 
 CLICK_ENDDECLS
@@ -14,10 +14,18 @@
 #include "localproxy.hh"
 #include "helper.hh"
 #include "ba_bitvector.hh"
+#include "trace.hh"
+#include "telemetry.hh"
+#include "baheader.hh"
+#include <click/straccum.hh>
+#if CLICK_USERLEVEL
+#include <signal.h>
+#include <errno.h>
+#endif
 
 CLICK_DECLS
 
-LocalProxy::LocalProxy() {
+LocalProxy::LocalProxy() : flood_timer(this), retrieval_timer(this), pull_timer(this), lease_timer(this), pubsub_epoch(1), fanout_links(0) {
 }
 
 LocalProxy::~LocalProxy() {
@@ -25,13 +33,77 @@ LocalProxy::~LocalProxy() {
 }
 
 int LocalProxy::configure(Vector<String> &conf, ErrorHandler *errh) {
-    gc = (GlobalConf *) cp_element(conf[0], this);
+    Element *gc_element;
+    flood_ttl = 0;
+    flood_ttl_max = 16;
+    flood_retry = 500;
+    fragment_size = 0;
+    load_weight = 1;
+    multicast_fill = 50;
+    lease_refresh = 0;
+    flood_rate = 0;
+    flood_burst = 16;
+    host_flood_rate = 0;
+    host_flood_burst = 16;
+    floods_sent = floods_limited = subscriptions_limited = 0;
+    probe_aggregate = false;
+    multi_source = 1;
+    source_timeout = 1000;
+    pull_window = 0;
+    pull_retries = 3;
+    dedup_window = 0;
+    duplicates_suppressed = duplicate_bytes_suppressed = 0;
+    if (cp_va_kparse(conf, this, errh,
+            "GLOBALCONF", cpkP + cpkM, cpElement, &gc_element,
+            "FLOOD_TTL", 0, cpUnsigned, &flood_ttl,
+            "FLOOD_TTL_MAX", 0, cpUnsigned, &flood_ttl_max,
+            "FLOOD_RETRY", 0, cpUnsigned, &flood_retry,
+            "FLOOD_RATE", 0, cpUnsigned, &flood_rate,
+            "FLOOD_BURST", 0, cpUnsigned, &flood_burst,
+            "HOST_FLOOD_RATE", 0, cpUnsigned, &host_flood_rate,
+            "HOST_FLOOD_BURST", 0, cpUnsigned, &host_flood_burst,
+            "PROBE_AGGREGATE", 0, cpBool, &probe_aggregate,
+            "MULTI_SOURCE", 0, cpUnsigned, &multi_source,
+            "SOURCE_TIMEOUT", 0, cpUnsigned, &source_timeout,
+            "PULL_WINDOW", 0, cpUnsigned, &pull_window,
+            "PULL_RETRIES", 0, cpUnsigned, &pull_retries,
+            "FRAGMENT", 0, cpUnsigned, &fragment_size,
+            "DEDUP_WINDOW", 0, cpUnsigned, &dedup_window,
+            "LOAD_WEIGHT", 0, cpDouble, &load_weight,
+            "MULTICAST_FILL", 0, cpUnsigned, &multicast_fill,
+            "LEASE_REFRESH", 0, cpUnsigned, &lease_refresh,
+            cpEnd) < 0) {
+        return -1;
+    }
+    gc = (GlobalConf *) gc_element;
+    if (flood_ttl_max >= FLOOD_TTL_UNLIMITED || flood_ttl > flood_ttl_max) {
+        return errh->error("FLOOD_TTL must not exceed FLOOD_TTL_MAX, which must be less than %d", FLOOD_TTL_UNLIMITED);
+    }
+    if (multicast_fill > 100) {
+        return errh->error("MULTICAST_FILL is a percentage");
+    }
+    if (multi_source == 0) {
+        return errh->error("MULTI_SOURCE must be at least 1");
+    }
+    if (fragment_size != 0 && fragment_size <= 2 * sizeof (FragmentHeader)) {
+        return errh->error("FRAGMENT must be larger than %d bytes", (int) (2 * sizeof (FragmentHeader)));
+    }
     //click_chatter("LocalProxy: configured!");
     return 0;
 }
 
 int LocalProxy::initialize(ErrorHandler *errh) {
     //click_chatter("LocalProxy: initialized!");
+    flood_seq = 0;
+    flood_timer.initialize(this);
+    retrieval_timer.initialize(this);
+    pull_timer.initialize(this);
+    sweep_cursor = 0;
+    dedup_head = 0;
+    lease_timer.initialize(this);
+    if (lease_refresh > 0) {
+        lease_timer.schedule_after_msec(lease_refresh * 1000);
+    }
     return 0;
 }
 
@@ -56,33 +128,84 @@ void LocalProxy::cleanup(CleanupStage stage) {
             delete (*it3).second;
             it3 = activeSubscriptionIndex.erase(it3);
         }
+        local_fanout.clear();
+        fanout_children.clear();
+        flood_timer.clear();
+        for (int i = 0; i < pending_floods.size(); i++) {
+            delete pending_floods[i];
+        }
+        pending_floods.clear();
+        retrieval_timer.clear();
+        for (int i = 0; i < pending_retrievals.size(); i++) {
+            delete pending_retrievals[i];
+        }
+        pending_retrievals.clear();
+        pull_timer.clear();
+        for (HashTable<String, PullRequest *>::iterator it = pull_requests.begin(); it != pull_requests.end(); it++) {
+            delete it.value();
+        }
+        pull_requests.clear();
+        for (HashTable<String, PullWindow *>::iterator it = pull_windows.begin(); it != pull_windows.end(); it++) {
+            delete it.value();
+        }
+        pull_windows.clear();
+        for (HashTable<String, Reassembly *>::iterator it = reassemblies.begin(); it != reassemblies.end(); it++) {
+            delete it.value();
+        }
+        reassemblies.clear();
+        for (HashTable<String, FragmentRequest *>::iterator it = fragment_requests.begin(); it != fragment_requests.end(); it++) {
+            delete it.value();
+        }
+        fragment_requests.clear();
+        for (HashTable<String, DedupWindow *>::iterator it = dedup.begin(); it != dedup.end(); it++) {
+            delete it.value();
+        }
+        dedup.clear();
+        dedup_order.clear();
     }
     click_chatter("LocalProxy: Cleaned Up!");
 }
 
+/*our proposal points span at the identifier of fragments * PURSUIT_ID_LEN bytes that starts at offset, without copying it (see String::make_stable).
+ *span is valid only as long as p is neither pushed nor killed. It returns false if the identifier and the trailer bytes that follow it are not all in p*/
+static inline bool request_span(Packet *p, int offset, int fragments, int trailer, String &span) {
+    int length = fragments * PURSUIT_ID_LEN;
+    if (offset + length + trailer > (int) p->length()) {
+        return false;
+    }
+    span = String::make_stable((const char *) (p->data() + offset), length);
+    return true;
+}
+
 void LocalProxy::push(int in_port, Packet * p) {
     int descriptor, index;
     int type_of_publisher;
     bool forward;
     unsigned char type, numberOfIDs, IDLength /*in fragments of PURSUIT_ID_LEN each*/, prefixIDLength /*in fragments of PURSUIT_ID_LEN each*/, strategy;
     Vector<String> IDs;
+    BAHeader hdr;
     LocalHost *_localhost;
     BABitvector RVFID;
     BABitvector FID_to_subscribers;
     String ID, prefixID;
     index = 0;
+    if (in_port == 0) {
+        Telemetry::stamp(p, TELEMETRY_NETLINK);
+    }
     if(in_port == 4)
     {
         memcpy(&type, p->data()+FID_LEN, sizeof(type)) ;
         memcpy(&numberOfIDs, p->data()+FID_LEN+sizeof(type), sizeof(numberOfIDs)) ;
-        for (int i = 0; i < (int) numberOfIDs; i++) {
-            IDLength = *(p->data() + FID_LEN+sizeof(type) + sizeof (numberOfIDs) + index);
-            IDs.push_back(String((const char *) (p->data() + FID_LEN+sizeof(type) + sizeof (numberOfIDs) + sizeof (IDLength) + index), IDLength * PURSUIT_ID_LEN));
-            index = index + sizeof (IDLength) + IDLength * PURSUIT_ID_LEN;
+        if (!hdr.parse(p, FID_LEN+sizeof(type))) {
+            p->kill();
+            return;
         }
+        hdr.ids(IDs);
+        index = hdr.length() - sizeof (numberOfIDs);
         switch (type)
         {
             case SCOPE_PROBING_MESSAGE:
+            case SCOPE_PROBING_AGGREGATE:
             {
                 handleScopeProbingMessage(IDs, p) ;
                 break ;
@@ -103,12 +226,13 @@ void LocalProxy::push(int in_port, Packet * p) {
         memcpy(incoming_FID._data, p->data(), FID_LEN) ;
         numberOfIDs = *(p->data()+FID_LEN);
         /*Read all the identifiers*/
-        for (int i = 0; i < (int) numberOfIDs; i++) {
-            IDLength = *(p->data() + FID_LEN + sizeof (numberOfIDs) + index);
-            IDs.push_back(String((const char *) (p->data() + FID_LEN + sizeof (numberOfIDs) + sizeof (IDLength) + index), IDLength * PURSUIT_ID_LEN));
-            index = index + sizeof (IDLength) + IDLength * PURSUIT_ID_LEN;
+        if (!hdr.parse(p, FID_LEN)) {
+            p->kill();
+            return;
         }
-        click_chatter("localproxy: probing message received") ;
+        hdr.ids(IDs);
+        index = hdr.length() - sizeof (numberOfIDs);
+        BA_TRACE(TRACE_PROXY, TRACE_DEBUG, "localproxy: probing message received") ;
         p->pull(FID_LEN+sizeof (numberOfIDs) + index);
         handleProbingMessage(IDs, p, incoming_FID) ;
     }
@@ -117,15 +241,17 @@ void LocalProxy::push(int in_port, Packet * p) {
         index = 0;
         /*read the "header"*/
         numberOfIDs = *(p->data());
-        click_chatter("localproxy: receive a packet from network") ;
+        BA_TRACE(TRACE_PROXY, TRACE_DEBUG, "localproxy: receive a packet from network") ;
         /*Read all the identifiers*/
-        for (int i = 0; i < (int) numberOfIDs; i++) {
-            IDLength = *(p->data() + sizeof (numberOfIDs) + index);
-            IDs.push_back(String((const char *) (p->data() + sizeof (numberOfIDs) + sizeof (IDLength) + index), IDLength * PURSUIT_ID_LEN));
-            index = index + sizeof (IDLength) + IDLength * PURSUIT_ID_LEN;
+        if (!hdr.parse(p, 0)) {
+            p->kill();
+            return;
         }
-        if ((IDs.size() == 1) && (IDs[0].compare(gc->notificationIID) == 0)) {
+        index = hdr.length() - sizeof (numberOfIDs);
+        /*notifications are told apart in place, only publications need their identifiers as keys*/
+        if ((hdr.size() == 1) && (hdr.id_equals(0, gc->notificationIID) || hdr.id_equals(0, gc->groupNotificationIID))) {
             /*a special case here: Got back an RV/TM event...it was published using the ID /FFFFFFFFFFFFFFFD/MYNODEID*/
+            /*or /FFFFFFFFFFFFFFFD/FFFFFFFFFFFFFFFF when the TM notified a group of nodes with one FID*/
             /*remove the header*/
 	    /*see publishReqToRV*/
             p->pull(sizeof (numberOfIDs) + index);
@@ -135,8 +261,11 @@ void LocalProxy::push(int in_port, Packet * p) {
             /*a regular network publication..I will look for local subscribers*/
             /*Careful: I will not kill the packet - I will reuse it one way or another, so....get rid of everything except the data*/
             /*remove the header*/
+            hdr.ids(IDs);
             p->pull(sizeof (numberOfIDs) + index);
-            handleNetworkPublication(IDs, p);
+            if ((p = reassemblePublication(IDs, p)) != NULL) {
+                handleNetworkPublication(IDs, p);
+            }
         }
     } else {
         /*the request comes from the IPC element or from a click Element. The descriptor here may be the netlink ID of an application or the click port of an Element*/
@@ -150,6 +279,10 @@ void LocalProxy::push(int in_port, Packet * p) {
             type_of_publisher = CLICK_ELEMENT;
         }
         _localhost = getLocalHost(type_of_publisher, descriptor);
+        if (p->length() < sizeof (type) + sizeof (IDLength)) {
+            p->kill();
+            return;
+        }
         type = *(p->data());
         if (type == DISCONNECT) {
             disconnect(_localhost);
@@ -158,8 +291,20 @@ void LocalProxy::push(int in_port, Packet * p) {
         } else if (type == PUBLISH_DATA) {
             /*this is a publication coming from an application or a click element*/
             IDLength = *(p->data() + sizeof (type));/*# of fragments*/
-            ID = String((const char *) (p->data() + sizeof (type) + sizeof (IDLength)), IDLength * PURSUIT_ID_LEN);
+            /*our proposal the ID is read in place: the ActivePublication is found without copying it*/
+            if (!request_span(p, sizeof (type) + sizeof (IDLength), IDLength, sizeof (strategy), ID)) {
+                p->kill();
+                return;
+            }
             strategy = *(p->data() + sizeof (type) + sizeof (IDLength) + ID.length());
+            if ((strategy == IMPLICIT_RENDEZVOUS || strategy == LINK_LOCAL) && p->length() < sizeof (type) + sizeof (IDLength) + ID.length() + sizeof (strategy) + FID_LEN) {
+                p->kill();
+                return;
+            }
+            if (strategy == IMPLICIT_RENDEZVOUS || strategy == LINK_LOCAL || strategy == BROADCAST_IF) {
+                /*these publications keep the ID (in the IDs of the packet and sometimes in a new ActiveSubscription) while the packet is pushed, so they get their own copy*/
+                ID = String(ID.data(), ID.length());
+            }
             if (strategy == IMPLICIT_RENDEZVOUS) {
                 FID_to_subscribers = BABitvector(FID_LEN * 8);
                 memcpy(FID_to_subscribers._data, p->data() + sizeof (type) + sizeof (IDLength) + ID.length() + sizeof (strategy), FID_LEN);
@@ -195,9 +340,16 @@ void LocalProxy::push(int in_port, Packet * p) {
             /*read user request*/
             click_chatter("this node publish a %d", (int) type) ;
             IDLength = *(p->data() + sizeof (type));
-            ID = String((const char *) (p->data() + sizeof (type) + sizeof (IDLength)), IDLength * PURSUIT_ID_LEN);
+            /*our proposal ID and prefixID are read in place; handleLocalRequest copies only the fullID that it may store*/
+            if (!request_span(p, sizeof (type) + sizeof (IDLength), IDLength, sizeof (prefixIDLength), ID)) {
+                p->kill();
+                return;
+            }
             prefixIDLength = *(p->data() + sizeof (type) + sizeof (IDLength) + ID.length());
-            prefixID = String((const char *) (p->data() + sizeof (type) + sizeof (IDLength) + ID.length() + sizeof (prefixIDLength)), prefixIDLength * PURSUIT_ID_LEN);
+            if (!request_span(p, sizeof (type) + sizeof (IDLength) + ID.length() + sizeof (prefixIDLength), prefixIDLength, sizeof (strategy), prefixID)) {
+                p->kill();
+                return;
+            }
             strategy = *(p->data() + sizeof (type) + sizeof (IDLength) + ID.length() + sizeof (prefixIDLength) + prefixID.length());
             RVFID = BABitvector(FID_LEN * 8);
             switch (strategy) {
@@ -210,7 +362,8 @@ void LocalProxy::push(int in_port, Packet * p) {
                     /*don't do anything here..just a placeholder to remind us about that strategy...subscriptions will recorded only locally. No publication will be sent to the RV (wherever that is)*/
                     break;
                 case DOMAIN_LOCAL:
-                    RVFID = gc->defaultRV_dl;
+                    /*the RV shard of the root scope (the root of the new father when republishing)*/
+                    RVFID = gc->rvFID((prefixID.length() > 0) ? prefixID : ID);
                     break;
                 case IMPLICIT_RENDEZVOUS:
                     /*don't do anything here..just a placeholder to remind us about that strategy...subscriptions will recorded only locally. No publication will be sent to the RV (wherever that is)*/
@@ -242,6 +395,8 @@ LocalHost * LocalProxy::getLocalHost(int type, int id) {
 
 void LocalProxy::disconnect(LocalHost *_localhost) {
     click_chatter("disconnect");
+    /*the caches of the other LocalHosts may point to this one*/
+    pubsub_epoch++;
     /*there is a bug here...I have to rethink how to correctly delete all entries in the right sequence*/
     if (_localhost != NULL) {
         click_chatter("LocalProxy: Entity %s disconnected...cleaning...", _localhost->localHostID.c_str());
@@ -286,6 +441,13 @@ bool LocalProxy::handleLocalRequest(unsigned char &type, LocalHost *_localhost,
             break;
         case SUBSCRIBE_SCOPE:
             click_chatter("LocalProxy: received SUBSCRIBE_SCOPE request: %s, %s, %s, %d", _localhost->localHostID.c_str(), ID.quoted_hex().c_str(), prefixID.quoted_hex().c_str(), (int) strategy);
+            if (!_localhost->flood_bucket.take(host_flood_rate, host_flood_burst, Timestamp::now())) {
+                /*a scope subscription may be flooded through the whole network*/
+                click_chatter("LocalProxy: %s subscribes to scopes too fast - refused", _localhost->localHostID.c_str());
+                _localhost->floods_limited++;
+                subscriptions_limited++;
+                break;
+            }
             forward = storeActiveSubscription(_localhost, fullID, strategy, RVFID, true);
             break;
         case SUBSCRIBE_INFO:
@@ -310,6 +472,7 @@ bool LocalProxy::handleLocalRequest(unsigned char &type, LocalHost *_localhost,
 /*store the remote scope for the _publisher..forward the message to the RV point only if this is the first time the scope is published.
  If not, the RV point already knows about this node's publication...Note that RV points know only about network nodes - NOT for processes or click modules*/
 bool LocalProxy::storeActivePublication(LocalHost *_publisher, String &fullID, unsigned char strategy, BABitvector &RVFID, bool isScope) {
+    pubsub_epoch++;
     if(!isScope)
     {
         //kanycast if publish a information, save it in its father scope
@@ -359,6 +522,7 @@ bool LocalProxy::storeActivePublication(LocalHost *_publisher, String &fullID, u
 /*delete the remote publication for the _publisher..forward the message to the RV point only if there aren't any other publishers or subscribers for this scope*/
 bool LocalProxy::removeActivePublication(LocalHost *_publisher, String &fullID, unsigned char strategy) {
     ActivePublication *ap;
+    pubsub_epoch++;
     if ((strategy == NODE_LOCAL) || (strategy == DOMAIN_LOCAL)) {
         ap = activePublicationIndex.get(fullID);
         if (ap != activePublicationIndex.default_value()) {
@@ -403,6 +567,7 @@ bool LocalProxy::removeActivePublication(LocalHost *_publisher, String &fullID,
  If not, the RV point already knows about this node's subscription...Note that RV points know only about network nodes - NOT about processes or click modules*/
 bool LocalProxy::storeActiveSubscription(LocalHost *_subscriber, String &fullID, unsigned char strategy, BABitvector &RVFID, bool isScope) {
     ActiveSubscription *as;
+    pubsub_epoch++;
     as = activeSubscriptionIndex.get(fullID);
     if (as == activeSubscriptionIndex.default_value()) {
         as = new ActiveSubscription(fullID, strategy, isScope);
@@ -411,6 +576,7 @@ bool LocalProxy::storeActiveSubscription(LocalHost *_subscriber, String &fullID,
         activeSubscriptionIndex.set(fullID, as);
         /*update the subscribers of that remote scope*/
         as->subscribers.find_insert(LocalHostSetItem(_subscriber));
+        invalidateFanOut(fullID);
         /*update the subscribed remote scopes for this publsher*/
         _subscriber->activeSubscriptions.find_insert(StringSetItem(fullID));
         //click_chatter("LocalProxy: store Active Subscription %s for local subscriber %s", fullID.quoted_hex().c_str(), _subscriber->localHostID.c_str());
@@ -423,6 +589,7 @@ bool LocalProxy::storeActiveSubscription(LocalHost *_subscriber, String &fullID,
         if (as->strategy == strategy) {
             /*update the subscribers of that remote scope*/
             as->subscribers.find_insert(LocalHostSetItem(_subscriber));
+            invalidateFanOut(fullID);
             /*update the subscribed remote scopes for this publsher*/
             _subscriber->activeSubscriptions.find_insert(StringSetItem(fullID));
             //click_chatter("LocalProxy: Active Subscription %s exists...updated for local subscriber %s", fullID.quoted_hex().c_str(), _subscriber->localHostID.c_str());
@@ -436,11 +603,13 @@ bool LocalProxy::storeActiveSubscription(LocalHost *_subscriber, String &fullID,
 /*delete the remote scope for the _subscriber..forward the message to the RV point only if there aren't any other publishers or subscribers for this scope*/
 bool LocalProxy::removeActiveSubscription(LocalHost *_subscriber, String &fullID, unsigned char strategy) {
     ActiveSubscription *as;
+    pubsub_epoch++;
     as = activeSubscriptionIndex.get(fullID);
     if (as != activeSubscriptionIndex.default_value()) {
         if (as->strategy == strategy) {
             _subscriber->activeSubscriptions.erase(fullID);
             as->subscribers.erase(_subscriber);
+            invalidateFanOut(fullID);
             //click_chatter("LocalProxy: deleted subscriber %s from Active Subscription %s", _subscriber->localHostID.c_str(), fullID.quoted_hex().c_str());
             if (as->subscribers.size() == 0) {
                 //click_chatter("LocalProxy: delete Active Subscription %s", fullID.quoted_hex().c_str());
@@ -468,14 +637,18 @@ void LocalProxy::handleRVNotification(Packet *p) {
     ActivePublication *ap;
     bool shouldBreak = false;
     BABitvector FID;
-    BABitvector incomingFID(FID_LEN*8) ;
+    /*notifications change the FIDs and the known IDs of ActivePublications*/
+    pubsub_epoch++;
+    FIDBitvector incomingFID ;
     type = *(p->data());
     numberOfIDs = *(p->data() + sizeof (type));
-    for (int i = 0; i < (int) numberOfIDs; i++) {
-        IDLength = *(p->data() + sizeof (type) + sizeof (numberOfIDs) + index);
-        IDs.push_back(String((const char *) (p->data() + sizeof (type) + sizeof (numberOfIDs) + sizeof (IDLength) + index), IDLength * PURSUIT_ID_LEN));
-        index = index + sizeof (IDLength) + IDLength*PURSUIT_ID_LEN;
+    BAHeader hdr;
+    if (!hdr.parse(p, sizeof (type))) {
+        /*the caller kills the packet*/
+        return;
     }
+    hdr.ids(IDs);
+    index = hdr.length() - sizeof (numberOfIDs);
     switch (type) {
         case SCOPE_PUBLISHED:
             //click_chatter("Received notification about new scope");
@@ -530,9 +703,11 @@ void LocalProxy::handleRVNotification(Packet *p) {
             }
             memcpy(&noofpub, p->data() + sizeof (type) + sizeof (numberOfIDs) + index + FID_LEN + sizeof(no_sub)+\
                     no_sub*PURSUIT_ID_LEN+no_sub*FID_LEN, sizeof(noofpub)) ;//get the nunber of publisher, send it to subs
-            /*our proposal send the probing message*/
-            sendProbingMessage(IDs, sub_FID, noofpub) ;
-            click_chatter("LocalProxy: RECEIVED FID:%s\n", FID.to_string().c_str());
+            /*our proposal send the probing message, it is the same for all subscribers*/
+            Vector<BABitvector> FID_groups ;
+            aggregateFIDs(sub_FID, FID_groups) ;
+            sendProbingMessage(IDs, FID_groups, noofpub) ;
+            BA_TRACE(TRACE_PROXY, TRACE_DEBUG, "LocalProxy: RECEIVED FID:%s", FID.to_string().c_str());
             for (int i = 0; i < (int) numberOfIDs; i++) {
                 ap = activePublicationIndex.get(IDs[i]);
                 if (ap != activePublicationIndex.default_value()) {
@@ -545,6 +720,7 @@ void LocalProxy::handleRVNotification(Packet *p) {
                     {
                         ap->FID_to_eachsub[str_map_iter->first] = str_map_iter->second ;
                     }
+                    aggregateFIDs(ap->FID_to_eachsub, ap->FID_groups) ;
 
                     /*iterate once to see if any of the publishers for this item (which may be represented by many ids) is already notified*/
                     for (PublisherHashMapIter publishers_it = ap->publishers.begin(); publishers_it != ap->publishers.end(); publishers_it++) {
@@ -608,6 +784,14 @@ void LocalProxy::handleRVNotification(Packet *p) {
             //notify publisher
             shouldBreak = false ;
             memcpy(incomingFID._data, p->data() + sizeof (type) + sizeof (numberOfIDs) + index, FID_LEN) ;
+            if (p->length() > sizeof (type) + sizeof (numberOfIDs) + index + FID_LEN) {
+                /*a CacheUnit that has part of a fragmented publication asks only for what it misses*/
+                for (int i = 0; i < (int) numberOfIDs; i++) {
+                    storeFragmentRequest(IDs[i] + String((const char *) incomingFID._data, FID_LEN),
+                            p->data() + sizeof (type) + sizeof (numberOfIDs) + index + FID_LEN,
+                            p->length() - (sizeof (type) + sizeof (numberOfIDs) + index + FID_LEN));
+                }
+            }
             for (int i = 0; i < (int) numberOfIDs; i++)
             {
                 ap = activePublicationIndex.get(IDs[i]);
@@ -660,7 +844,7 @@ void LocalProxy::handleRVNotification(Packet *p) {
                                 index + sizeof(noofiids)+i*PURSUIT_ID_LEN, sizeof(noofpub)) ;
             memcpy(pubiLIDs._data, p->data() + sizeof (type) + sizeof (numberOfIDs) +\
                                 index + sizeof(noofiids)+i*PURSUIT_ID_LEN+sizeof(noofpub), FID_LEN) ;
-            floodingReq(IDs, IIDs, pubiLIDs) ;
+            startFlooding(IDs, IIDs, pubiLIDs) ;
             //save iid to ativesub, notify subscriber
 //            for(i = 0 ; i < (int) numberOfIDs ; i++)
 //            {
@@ -728,7 +912,8 @@ void LocalProxy::pushDataToLocalSubscriber(LocalHost *_localhost, String &ID, Pa
     unsigned char type = PUBLISHED_DATA;
     WritablePacket *newPacket;
     IDLength = ID.length() / PURSUIT_ID_LEN;
-    click_chatter("pushing data to subscriber %s", _localhost->localHostID.c_str());
+    BA_TRACE(TRACE_PROXY, TRACE_DEBUG, "pushing data to subscriber %s", _localhost->localHostID.c_str());
+    Telemetry::stamp(p, TELEMETRY_DELIVERY);
     newPacket = p->push(sizeof (unsigned char) + sizeof (unsigned char) +ID.length());
     memcpy(newPacket->data(), &type, sizeof (unsigned char));
     memcpy(newPacket->data() + sizeof (unsigned char), &IDLength, sizeof (unsigned char));
@@ -748,12 +933,19 @@ void LocalProxy::pushDataToRemoteSubscribers(ActivePublication *ap, Packet *p) {
     unsigned char numberOfIDs;
     int totalIDsLength = 0;
     Vector<String>::iterator it;
+    Vector<Packet *> fragments;
+    if (fragmentPublication(p, fragments)) {
+        for (int i = 0; i < fragments.size(); i++) {
+            pushDataToRemoteSubscribers(ap, fragments[i]);
+        }
+        return;
+    }
     numberOfIDs = (unsigned char) ap->allKnownIDs.size();
     for (it = ap->allKnownIDs.begin(); it != ap->allKnownIDs.end(); it++) {
         totalIDsLength = totalIDsLength + (*it).length();
     }
     newPacket = p->push(FID_LEN + sizeof (numberOfIDs) /*number of ids more than one ids may refer to the same thing*/+((int) numberOfIDs) * sizeof (unsigned char) /*id length for each ID*/ +totalIDsLength);
-    click_chatter("PUBLISHING DATA USING: %s", ap->FID_to_subscribers.to_string().c_str());
+    BA_TRACE(TRACE_PROXY, TRACE_DEBUG, "PUBLISHING DATA USING: %s", ap->FID_to_subscribers.to_string().c_str());
     memcpy(newPacket->data(), ap->FID_to_subscribers._data, FID_LEN);
     memcpy(newPacket->data() + FID_LEN, &numberOfIDs, sizeof (numberOfIDs));
     index = 0;
@@ -765,7 +957,7 @@ void LocalProxy::pushDataToRemoteSubscribers(ActivePublication *ap, Packet *p) {
         index = index + sizeof (IDLength) + (*it).length();
         it++;
     }
-    click_chatter("pushing data packet of size %d to FID: %s", newPacket->length() ,ap->FID_to_subscribers.to_string().c_str());
+    BA_TRACE(TRACE_PROXY, TRACE_DEBUG, "pushing data packet of size %d to FID: %s", newPacket->length() ,ap->FID_to_subscribers.to_string().c_str());
     output(2).push(newPacket);
 }
 
@@ -779,6 +971,13 @@ void LocalProxy::pushDataToRemoteSubscribers(Vector<String> &IDs, BABitvector &F
     unsigned char numberOfIDs;
     int totalIDsLength = 0;
     Vector<String>::iterator it;
+    Vector<Packet *> fragments;
+    if (fragmentPublication(p, fragments, IDs.back() + String((const char *) FID_to_subscribers._data, FID_LEN))) {
+        for (int i = 0; i < fragments.size(); i++) {
+            pushDataToRemoteSubscribers(IDs, FID_to_subscribers, fragments[i]);
+        }
+        return;
+    }
     numberOfIDs = (unsigned char) IDs.size();
     for (it = IDs.begin(); it != IDs.end(); it++) {
         totalIDsLength = totalIDsLength + (*it).length();
@@ -798,12 +997,178 @@ void LocalProxy::pushDataToRemoteSubscribers(Vector<String> &IDs, BABitvector &F
     output(5).push(newPacket);
 }
 
+bool LocalProxy::fragmentPublication(Packet *p, Vector<Packet *> &fragments, const String &key) {
+    unsigned int total_len = p->length();
+    unsigned int chunk = fragment_size - sizeof (FragmentHeader);
+    unsigned int count;
+    uint32_t msg_id = 2166136261U;
+    FragmentRequest *request = NULL;
+    if (fragment_size == 0 || total_len <= fragment_size) {
+        return false;
+    }
+    count = (total_len + chunk - 1) / chunk;
+    if (total_len > FRAGMENT_MAX_LENGTH || count > 0xFFFF) {
+        click_chatter("LocalProxy: publication of %u bytes is too large to be fragmented", total_len);
+        return false;
+    }
+    /*FNV-1a over the content*/
+    for (unsigned int i = 0; i < total_len; i++) {
+        msg_id = (msg_id ^ p->data()[i]) * 16777619U;
+    }
+    if (key.length() > 0 && (request = fragment_requests.get(key)) != NULL) {
+        fragment_requests.erase(key);
+        if (request->msg_id != msg_id || request->count != count) {
+            /*the content changed since the CacheUnit stored its fragments: send everything*/
+            delete request;
+            request = NULL;
+        }
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        unsigned int offset = i * chunk;
+        if (request != NULL && !request->wanted[i]) {
+            continue;
+        }
+        unsigned int len = (total_len - offset < chunk) ? total_len - offset : chunk;
+        WritablePacket *fragment = Packet::make(p->headroom(), NULL, sizeof (FragmentHeader) + len, 0);
+        if (fragment == NULL) {
+            /*out of memory: the fragments made so far are useless*/
+            for (int j = 0; j < fragments.size(); j++) {
+                fragments[j]->kill();
+            }
+            fragments.clear();
+            break;
+        }
+        FragmentHeader hdr;
+        hdr.magic = htonl(FRAGMENT_MAGIC);
+        hdr.msg_id = htonl(msg_id);
+        hdr.total_len = htonl(total_len);
+        hdr.offset = htonl(offset);
+        hdr.index = htons(i);
+        hdr.count = htons(count);
+        memcpy(fragment->data(), &hdr, sizeof (FragmentHeader));
+        memcpy(fragment->data() + sizeof (FragmentHeader), p->data() + offset, len);
+        fragments.push_back(fragment);
+    }
+    delete request;
+    p->kill();
+    return true;
+}
+
+void LocalProxy::storeFragmentRequest(const String &key, const unsigned char *ranges, unsigned int len) {
+    uint32_t msg_id;
+    uint16_t count, number_of_ranges, first, last;
+    if (len < sizeof (msg_id) + sizeof (count) + sizeof (number_of_ranges)) {
+        return;
+    }
+    memcpy(&msg_id, ranges, sizeof (msg_id));
+    memcpy(&count, ranges + sizeof (msg_id), sizeof (count));
+    memcpy(&number_of_ranges, ranges + sizeof (msg_id) + sizeof (count), sizeof (number_of_ranges));
+    count = ntohs(count);
+    number_of_ranges = ntohs(number_of_ranges);
+    if (count == 0 || number_of_ranges > FRAGMENT_RANGES_MAX || len < sizeof (msg_id) + sizeof (count) + sizeof (number_of_ranges) + number_of_ranges * 2 * sizeof (uint16_t)) {
+        return;
+    }
+    FragmentRequest *request = fragment_requests.get(key);
+    if (request == NULL) {
+        request = new FragmentRequest();
+        fragment_requests.set(key, request);
+    }
+    request->msg_id = ntohl(msg_id);
+    request->count = count;
+    request->wanted = Bitvector(count);
+    ranges += sizeof (msg_id) + sizeof (count) + sizeof (number_of_ranges);
+    for (int i = 0; i < number_of_ranges; i++) {
+        memcpy(&first, ranges + i * 2 * sizeof (uint16_t), sizeof (first));
+        memcpy(&last, ranges + i * 2 * sizeof (uint16_t) + sizeof (first), sizeof (last));
+        for (int j = ntohs(first); j <= ntohs(last) && j < count; j++) {
+            request->wanted[j] = true;
+        }
+    }
+}
+
+Packet *LocalProxy::reassemblePublication(Vector<String> &IDs, Packet *p) {
+    FragmentHeader hdr;
+    uint32_t msg_id, total_len, offset;
+    uint16_t index, count;
+    unsigned int len;
+    if (p->length() < sizeof (FragmentHeader)) {
+        return p;
+    }
+    memcpy(&hdr, p->data(), sizeof (FragmentHeader));
+    if (ntohl(hdr.magic) != FRAGMENT_MAGIC) {
+        return p;
+    }
+    msg_id = ntohl(hdr.msg_id);
+    total_len = ntohl(hdr.total_len);
+    offset = ntohl(hdr.offset);
+    index = ntohs(hdr.index);
+    count = ntohs(hdr.count);
+    len = p->length() - sizeof (FragmentHeader);
+    if (total_len > FRAGMENT_MAX_LENGTH || index >= count || offset > total_len || len > total_len - offset) {
+        BA_TRACE(TRACE_PROXY, TRACE_DEBUG, "LocalProxy: dropping a malformed fragment");
+        p->kill();
+        return NULL;
+    }
+    Reassembly *r = reassemblies.get(IDs[0]);
+    if (r != NULL && (r->msg_id != msg_id || r->total_len != total_len || r->got.size() != count)) {
+        /*a new publication for the ID: what is left of the previous one will never be completed*/
+        delete r;
+        reassemblies.erase(IDs[0]);
+        r = NULL;
+    }
+    if (r == NULL) {
+        r = new Reassembly();
+        r->msg_id = msg_id;
+        r->total_len = total_len;
+        r->received = 0;
+        r->got = Bitvector(count);
+        r->packet = Packet::make(p->headroom(), NULL, total_len, 0);
+        if (r->packet == NULL) {
+            delete r;
+            p->kill();
+            return NULL;
+        }
+        reassemblies.set(IDs[0], r);
+    }
+    if (!r->got[index]) {
+        r->got[index] = true;
+        memcpy(r->packet->data() + offset, p->data() + sizeof (FragmentHeader), len);
+        r->received += len;
+    }
+    p->kill();
+    if (r->received < r->total_len) {
+        return NULL;
+    }
+    WritablePacket *publication = r->packet;
+    r->packet = NULL;
+    delete r;
+    reassemblies.erase(IDs[0]);
+    return publication;
+}
+
 void LocalProxy::handleNetworkPublication(Vector<String> &IDs, Packet *p /*the packet has some headroom and only the data which hasn't been copied yet*/) {
     LocalHostStringHashMap localSubscribers;/*key is localhost, element is host ID string*/
     int counter = 1;
-    click_chatter("received data for ID: %s", IDs[0].quoted_hex().c_str());
+    BA_TRACE(TRACE_PROXY, TRACE_DEBUG, "received data for ID: %s", IDs[0].quoted_hex().c_str());
+    if (dedup_window > 0 && duplicatePublication(IDs[0], p)) {
+        /*our proposal another copy of data that was delivered already (from another path, source or cache)*/
+        duplicates_suppressed++;
+        duplicate_bytes_suppressed += p->length();
+        BA_TRACE(TRACE_PROXY, TRACE_DEBUG, "dropping a duplicate publication for ID: %s", IDs[0].quoted_hex().c_str());
+        p->kill();
+        return;
+    }
+    if (!pending_floods.empty()) {
+        floodAnswered(IDs);
+    }
+    if (!pending_retrievals.empty()) {
+        retrievalAnswered(IDs);
+    }
+    if (!pull_requests.empty()) {
+        pullAnswered(IDs);
+    }
     bool foundLocalSubscribers = findLocalSubscribers(IDs, localSubscribers);
-    click_chatter("/*that's a special case written for hotnets fragmentation paper - I will subscribe locally on behalf of all local subscribers*/");
+    BA_TRACE(TRACE_PROXY, TRACE_DEBUG, "/*that's a special case written for hotnets fragmentation paper - I will subscribe locally on behalf of all local subscribers*/");
     int localSubscribersSize = localSubscribers.size();
     if (foundLocalSubscribers) {
         for (LocalHostStringHashMapIter localSubscribers_it = localSubscribers.begin(); localSubscribers_it != localSubscribers.end(); localSubscribers_it++) {
@@ -828,21 +1193,66 @@ void LocalProxy::handleNetworkPublication(Vector<String> &IDs, Packet *p /*the p
     }
 }
 
+bool LocalProxy::duplicatePublication(const String &ID, Packet *p) {
+    Timestamp now = Timestamp::now();
+    Timestamp window = Timestamp::make_msec(dedup_window);
+    uint64_t digest = 14695981039346656037ULL ^ p->length();
+    const unsigned char *data = p->data();
+    for (uint32_t i = 0; i < p->length(); i++) {
+        digest = (digest ^ data[i]) * 1099511628211ULL;
+    }
+    DedupWindow *w = dedup.get(ID);
+    if (w != NULL) {
+        for (int i = 0; i < DEDUP_DEPTH; i++) {
+            if (w->when[i] && w->digest[i] == digest && now - w->when[i] <= window) {
+                return true;
+            }
+        }
+    } else {
+        /*look at the two oldest windows for every new one: expired ones are deleted (as are windows in use when there are too many IDs), the others go to the end*/
+        for (int n = 0; n < 2 && dedup_head < dedup_order.size(); n++) {
+            String oldest = dedup_order[dedup_head++];
+            DedupWindow *o = dedup.get(oldest);
+            if (o != NULL && now - o->last <= window && dedup.size() < DEDUP_MAX_IDS) {
+                dedup_order.push_back(oldest);
+                continue;
+            }
+            delete o;
+            dedup.erase(oldest);
+        }
+        if (dedup_head > 0 && dedup_head * 2 >= dedup_order.size()) {
+            dedup_order.erase(dedup_order.begin(), dedup_order.begin() + dedup_head);
+            dedup_head = 0;
+        }
+        w = new DedupWindow();
+        dedup.set(ID, w);
+        dedup_order.push_back(ID);
+    }
+    w->digest[w->next] = digest;
+    w->when[w->next] = now;
+    w->next = (w->next + 1) % DEDUP_DEPTH;
+    w->last = now;
+    return false;
+}
+
 void LocalProxy::handleUserPublication(String &ID, Packet *p /*the packet has some headroom and only the data which hasn't been copied yet*/, LocalHost *__localhost) {
     int localSubscribersSize;
-    int counter = 1;
     bool remoteSubscribersExist = true;
-    LocalHostStringHashMap localSubscribers;
-    ActivePublication *ap = activePublicationIndex.get(ID);
-    if (ap != activePublicationIndex.default_value()) {
-        if ((ap->FID_to_subscribers.zero()) || (ap->FID_to_subscribers == gc->iLID)) {
-            remoteSubscribersExist = false;
+    PublicationCache &cache = __localhost->lastPublication;
+    ActivePublication *ap;
+    /*our proposal a publisher that streams on the same ID finds everything resolved in its cache, as long as the pub/sub state did not change*/
+    if (cache.epoch != pubsub_epoch || cache.ap == NULL || cache.ID != ID) {
+        LocalHostStringHashMap localSubscribers;
+        cache.ap = NULL;
+        ap = activePublicationIndex.get(ID);
+        if (ap == activePublicationIndex.default_value()) {
+            p->kill();
+            return;
         }
         /*I have to find any subscribers that exist locally*/
         /*Careful: I will use all known IDs of the aiip and check for each one (findLocalSubscribers() does that)*/
         bool foundLocalSubscribers = findLocalSubscribers(ap->allKnownIDs, localSubscribers);/*all the ids that refer to the same thing*/
         localSubscribers.erase(__localhost);
-        localSubscribersSize = localSubscribers.size();
         if (foundLocalSubscribers) {
             for (LocalHostStringHashMapIter localSubscribers_it = localSubscribers.begin(); localSubscribers_it != localSubscribers.end(); localSubscribers_it++) {
                 LocalHost *_localhost = (*localSubscribers_it).first;
@@ -855,41 +1265,42 @@ void LocalProxy::handleUserPublication(String &ID, Packet *p /*the packet has so
                 }
             }
         }
-        /*Now I know if I should send the packet to the Network and how many local subscribers exist*/
-        /*I should be able to minimise packet copy*/
-        if ((localSubscribersSize == 0) && (!remoteSubscribersExist)) {
-            p->kill();
-        } else if ((localSubscribersSize == 0) && (remoteSubscribersExist)) {
-            /*no need to clone..packet will be sent only to the network*/
-            pushDataToRemoteSubscribers(ap, p);
-        } else if ((localSubscribersSize > 0) && (!remoteSubscribersExist)) {
-            /*only local subscribers exist*/
-            for (LocalHostStringHashMapIter localSubscribers_it = localSubscribers.begin(); localSubscribers_it != localSubscribers.end(); localSubscribers_it++) {
-                LocalHost *_localhost = (*localSubscribers_it).first;
-                if (counter == localSubscribersSize) {
-                    /*don't clone the packet since this is the last subscriber*/
-                    pushDataToLocalSubscriber(_localhost, (*localSubscribers_it).second, p);
-                } else {
-                    pushDataToLocalSubscriber(_localhost, (*localSubscribers_it).second, p->clone()->uniqueify());
-                }
-                counter++;
-            }
-        } else {
+        /*the cache is filled after storeActiveSubscription, which changes the epoch. ID may point into the request packet, so the cache keeps a copy*/
+        cache.subscribers.clear();
+        cache.subscriberIDs.clear();
+        for (LocalHostStringHashMapIter localSubscribers_it = localSubscribers.begin(); localSubscribers_it != localSubscribers.end(); localSubscribers_it++) {
+            cache.subscribers.push_back((*localSubscribers_it).first);
+            cache.subscriberIDs.push_back((*localSubscribers_it).second);
+        }
+        cache.ID = String(ID.data(), ID.length());
+        cache.ap = ap;
+        cache.epoch = pubsub_epoch;
+    }
+    ap = cache.ap;
+    if ((ap->FID_to_subscribers.zero()) || (ap->FID_to_subscribers == gc->iLID)) {
+        remoteSubscribersExist = false;
+    }
+    localSubscribersSize = cache.subscribers.size();
+    /*Now I know if I should send the packet to the Network and how many local subscribers exist*/
+    /*I should be able to minimise packet copy*/
+    if ((localSubscribersSize == 0) && (!remoteSubscribersExist)) {
+        p->kill();
+    } else if ((localSubscribersSize == 0) && (remoteSubscribersExist)) {
+        /*no need to clone..packet will be sent only to the network*/
+        pushDataToRemoteSubscribers(ap, p);
+    } else {
+        if (remoteSubscribersExist) {
             /*local and remote subscribers exist*/
             pushDataToRemoteSubscribers(ap, p->clone()->uniqueify());
-            for (LocalHostStringHashMapIter localSubscribers_it = localSubscribers.begin(); localSubscribers_it != localSubscribers.end(); localSubscribers_it++) {
-                LocalHost *_localhost = (*localSubscribers_it).first;
-                if (counter == localSubscribersSize) {
-                    /*don't clone the packet since this is the last subscriber*/
-                    pushDataToLocalSubscriber(_localhost, (*localSubscribers_it).second, p);
-                } else {
-                    pushDataToLocalSubscriber(_localhost, (*localSubscribers_it).second, p->clone()->uniqueify());
-                }
-                counter++;
+        }
+        for (int i = 0; i < localSubscribersSize; i++) {
+            if (i == localSubscribersSize - 1) {
+                /*don't clone the packet since this is the last subscriber*/
+                pushDataToLocalSubscriber(cache.subscribers[i], cache.subscriberIDs[i], p);
+            } else {
+                pushDataToLocalSubscriber(cache.subscribers[i], cache.subscriberIDs[i], p->clone()->uniqueify());
             }
         }
-    } else {
-        p->kill();
     }
 }
 
@@ -911,7 +1322,7 @@ void LocalProxy::handleUserPublication(String &ID, BABitvector &FID_to_subscribe
             /*i will augment the IDs vector using my father publication*/
             for (int i = 0; i < ap->allKnownIDs.size(); i++) {
                 String knownID = ap->allKnownIDs[i] + ID.substring(ID.length() - PURSUIT_ID_LEN, PURSUIT_ID_LEN);
-                click_chatter("knownID: %s", knownID.quoted_hex().c_str());
+                BA_TRACE(TRACE_PROXY, TRACE_DEBUG, "knownID: %s", knownID.quoted_hex().c_str());
                 if (knownID.compare(ID) != 0) {
                     /*I will add the original ID afterwards*/
                     IDs.push_back(knownID);
@@ -1014,31 +1425,74 @@ void LocalProxy::findActiveSubscriptions(String &ID, LocalHostSet &local_subscri
 
 bool LocalProxy::findLocalSubscribers(Vector<String> &IDs, LocalHostStringHashMap & _localSubscribers) {
     bool foundSubscribers;
-    String knownID;
-    LocalHostSetIter set_it;
     Vector<String>::iterator id_it;
-    ActiveSubscription *as;
     foundSubscribers = false;
     /*prefix-match checking here for all known IDS of aiip*/
     for (id_it = IDs.begin(); id_it != IDs.end(); id_it++) {
-        knownID = *id_it;
-        /*check for local subscription for the specific information item*/
-        as = activeSubscriptionIndex.get(knownID);
-        if (as != activeSubscriptionIndex.default_value()) {
-            for (set_it = as->subscribers.begin(); set_it != as->subscribers.end(); set_it++) {
-                _localSubscribers.set((*set_it)._lhpointer, knownID);
-                foundSubscribers = true;
-            }
+        /*the subscribers of the specific information item and of its father scope*/
+        const Vector<LocalHost *> &subscribers = localFanOut(*id_it);
+        for (int i = 0; i < subscribers.size(); i++) {
+            _localSubscribers.set(subscribers[i], *id_it);
+            foundSubscribers = true;
         }
-        as = activeSubscriptionIndex.get(knownID.substring(0, knownID.length() - PURSUIT_ID_LEN));
-        if (as != activeSubscriptionIndex.default_value()) {
-            for (set_it = as->subscribers.begin(); set_it != as->subscribers.end(); set_it++) {
-                _localSubscribers.set((*set_it)._lhpointer, knownID);
-                foundSubscribers = true;
+    }
+    return foundSubscribers;
+}
+
+const Vector<LocalHost *> &LocalProxy::localFanOut(const String &ID) {
+    LocalHostSetIter set_it;
+    ActiveSubscription *as;
+    Vector<LocalHost *> *subscribers = local_fanout.get_pointer(ID);
+    if (subscribers != NULL) {
+        return *subscribers;
+    }
+    /*an item that is resolved again after an invalidation is listed again under its father, so the links are bounded as well*/
+    if (local_fanout.size() >= LOCAL_FANOUT_MAX || fanout_links >= 2 * LOCAL_FANOUT_MAX) {
+        local_fanout.clear();
+        fanout_children.clear();
+        fanout_links = 0;
+    }
+    /*ID may be a stable String pointing into a packet*/
+    String key(ID.data(), ID.length());
+    String father = key.substring(0, key.length() - PURSUIT_ID_LEN);
+    Vector<LocalHost *> resolved;
+    as = activeSubscriptionIndex.get(key);
+    if (as != activeSubscriptionIndex.default_value()) {
+        for (set_it = as->subscribers.begin(); set_it != as->subscribers.end(); set_it++) {
+            resolved.push_back((*set_it)._lhpointer);
+        }
+    }
+    as = activeSubscriptionIndex.get(father);
+    if (as != activeSubscriptionIndex.default_value()) {
+        int item_subscribers = resolved.size();
+        for (set_it = as->subscribers.begin(); set_it != as->subscribers.end(); set_it++) {
+            int i;
+            for (i = 0; i < item_subscribers && resolved[i] != (*set_it)._lhpointer; i++) {
+            }
+            if (i == item_subscribers) {
+                resolved.push_back((*set_it)._lhpointer);
             }
         }
     }
-    return foundSubscribers;
+    if (father.length() > 0) {
+        fanout_children[father].push_back(key);
+        fanout_links++;
+    }
+    local_fanout.set(key, resolved);
+    return *local_fanout.get_pointer(key);
+}
+
+void LocalProxy::invalidateFanOut(const String &fullID) {
+    Vector<String> *children;
+    local_fanout.erase(fullID);
+    children = fanout_children.get_pointer(fullID);
+    if (children != NULL) {
+        for (int i = 0; i < children->size(); i++) {
+            local_fanout.erase((*children)[i]);
+        }
+        fanout_links -= children->size();
+        fanout_children.erase(fullID);
+    }
 }
 
 void LocalProxy::sendNotificationLocally(unsigned char type, LocalHost *_localhost, String ID) {
@@ -1158,6 +1612,7 @@ void LocalProxy::deleteAllActiveInformationItemSubscriptions(LocalHost * _subscr
         if (!as->isScope) {
             it = _subscriber->activeSubscriptions.erase(it);
             as->subscribers.erase(_subscriber);
+            invalidateFanOut(as->fullID);
             //click_chatter("LocalProxy: deleted subscriber %s from Active Information Item Publication %s", _subscriber->localHostID.c_str(), as->fullID.quoted_hex().c_str());
             if (as->subscribers.size() == 0) {
                 //click_chatter("LocalProxy: delete Active Information item Subscription %s", as->fullID.quoted_hex().c_str());
@@ -1253,6 +1708,7 @@ void LocalProxy::deleteAllActiveScopeSubscriptions(LocalHost * _subscriber) {
                 if (as->isScope) {
                     _subscriber->activeSubscriptions.erase(fullID);
                     as->subscribers.erase(_subscriber);
+                    invalidateFanOut(fullID);
                     //click_chatter("LocalProxy: deleted subscriber %s from Active Scope Subscription %s", _subscriber->localHostID.c_str(), as->fullID.quoted_hex().c_str());
                     if (as->subscribers.size() == 0) {
                         //click_chatter("LocalProxy: delete Active Scope Subscription %s", as->fullID.quoted_hex().c_str());
@@ -1274,10 +1730,31 @@ void LocalProxy::deleteAllActiveScopeSubscriptions(LocalHost * _subscriber) {
     }
 }
 
-void LocalProxy::sendProbingMessage(Vector<String> IDs, HashTable<String, BABitvector> FID_to_each_sub, int noofpub)
+void LocalProxy::aggregateFIDs(HashTable<String, BABitvector> &FID_to_each_sub, Vector<BABitvector> &FID_groups)
 {
-    click_chatter("localproxy: sending probing message") ;
-    HashTable<String, BABitvector>::iterator str_map_iter ;
+    FID_groups.clear() ;
+    for(HashTable<String, BABitvector>::iterator str_map_iter = FID_to_each_sub.begin() ; str_map_iter != FID_to_each_sub.end() ; str_map_iter++)
+    {
+        BABitvector &FID = str_map_iter->second ;
+        int i ;
+        /*first fit: the first group that stays under the bound takes the subscriber*/
+        for(i = 0 ; multicast_fill > 0 && i < FID_groups.size() ; i++)
+        {
+            BABitvector merged = FID_groups[i] | FID ;
+            if((unsigned int) merged.weight() * 100 <= multicast_fill * (unsigned int) merged.size())
+            {
+                FID_groups[i] = merged ;
+                break ;
+            }
+        }
+        if(multicast_fill == 0 || i == FID_groups.size())
+            FID_groups.push_back(FID) ;
+    }
+}
+
+void LocalProxy::sendProbingMessage(Vector<String> IDs, const Vector<BABitvector> &FID_groups, int noofpub)
+{
+    BA_TRACE(TRACE_PROXY, TRACE_DEBUG, "localproxy: sending probing message to %d FIDs", FID_groups.size()) ;
     char* probingchar ;
     Vector<String>::iterator vec_str_iter ;
     int packet_len_without_FID ;
@@ -1287,13 +1764,17 @@ void LocalProxy::sendProbingMessage(Vector<String> IDs, HashTable<String, BABitv
     unsigned char IDLength /*in fragments*/ ;
     unsigned char hop_count = 0 ;
     unsigned char origin = 0 ; /*0 for publication*/
+    ProbingLoad load ;
+    memset(&load, 0, sizeof(load)) ;
+    load.hit_rate = 100 ;
     for( vec_str_iter = IDs.begin() ; vec_str_iter != IDs.end() ; vec_str_iter++)
     {
         total_ID_length += vec_str_iter->length() ;
     }
     packet_len_without_FID = sizeof(NOofID)/*numberofID*/+NOofID*sizeof(IDLength)/*number of fragment*/+\
                  total_ID_length/*IDs*/+FID_LEN/*reverse_path*/+sizeof(hop_count)/*hop passed*/+FID_LEN/*internal LID*/+\
-                 sizeof(origin)/*cache or pub*/+sizeof(noofpub)/*number of pub*/+2*PURSUIT_ID_LEN/*pub notificationIID*/ ;
+                 sizeof(origin)/*cache or pub*/+sizeof(noofpub)/*number of pub*/+2*PURSUIT_ID_LEN/*pub notificationIID*/+\
+                 sizeof(load)/*load of the answering node*/ ;
     probingchar = (char*)malloc(packet_len_without_FID) ;
     memcpy(probingchar, &NOofID, sizeof(NOofID)) ;//#ofID
 
@@ -1312,6 +1793,7 @@ void LocalProxy::sendProbingMessage(Vector<String> IDs, HashTable<String, BABitv
     memcpy(probingchar+sizeof(NOofID)+IDindex+FID_LEN+sizeof(hop_count)+FID_LEN, &origin, sizeof(origin)) ;//origin is publication
     memcpy(probingchar+sizeof(NOofID)+IDindex+FID_LEN+sizeof(hop_count)+FID_LEN+sizeof(origin), &noofpub, sizeof(noofpub)) ;
     memcpy(probingchar+sizeof(NOofID)+IDindex+FID_LEN+sizeof(hop_count)+FID_LEN+sizeof(origin)+sizeof(noofpub), gc->notificationIID.c_str(), 2*PURSUIT_ID_LEN) ;
+    memcpy(probingchar+sizeof(NOofID)+IDindex+FID_LEN+sizeof(hop_count)+FID_LEN+sizeof(origin)+sizeof(noofpub)+2*PURSUIT_ID_LEN, &load, sizeof(load)) ;
     /*this is for k-anycast
     memcpy(probingchar+sizeof(NOofID)+IDindex+FID_LEN, BFforIID._data, PURSUIT_ID_LEN) ;//bloom filter for information ID
     memcpy(probingchar+sizeof(NOofID)+IDindex+FID_LEN+PURSUIT_ID_LEN, &numberOfIID, sizeof(numberOfIID)) ;//# of IID
@@ -1319,10 +1801,10 @@ void LocalProxy::sendProbingMessage(Vector<String> IDs, HashTable<String, BABitv
         &hop_passed, sizeof(hop_passed)) ;//hop passed
     memcpy(probingchar+sizeof(NOofID)+IDindex+FID_LEN+sizeof(hop_passed), &origin, sizeof(origin)) ;//origin 0 for publication
     memcpy(probingchar+sizeof(NOofID)+IDindex++FID_LEN+sizeof(hop_passed)+sizeof(origin), gc->nodeID, NODEID_LEN) ;//nodeID*/
-    for(str_map_iter = FID_to_each_sub.begin() ; str_map_iter != FID_to_each_sub.end() ; str_map_iter++)
+    for(int i = 0 ; i < FID_groups.size() ; i++)
     {
         WritablePacket* probingmessage = Packet::make(50, NULL, packet_len_without_FID+FID_LEN, 50) ;
-        memcpy(probingmessage->data(), str_map_iter->second._data, FID_LEN) ;//FID
+        memcpy(probingmessage->data(), FID_groups[i]._data, FID_LEN) ;//FID
         memcpy(probingmessage->data()+FID_LEN, probingchar, packet_len_without_FID) ;
         output(3).push(probingmessage) ;
     }
@@ -1331,7 +1813,7 @@ void LocalProxy::sendProbingMessage(Vector<String> IDs, HashTable<String, BABitv
 
 void LocalProxy::handleProbingMessage(Vector<String> IDs, Packet* p, BABitvector incoming_FID)
 {
-    click_chatter("localproxy: handling probing message") ;
+    BA_TRACE(TRACE_PROXY, TRACE_DEBUG, "localproxy: handling probing message") ;
     WritablePacket* packet ;
     BABitvector reverse_FID(FID_LEN*8) ;
     unsigned char hop_count ;
@@ -1340,6 +1822,8 @@ void LocalProxy::handleProbingMessage(Vector<String> IDs, Packet* p, BABitvector
     int noofpub ;
     String pubnodeID ;
     bool sentsub = false ;
+    ProbingLoad load ;
+    double cost ;
 
     memcpy(reverse_FID._data, p->data(), FID_LEN) ;
     memcpy(&hop_count, p->data()+FID_LEN, sizeof(hop_count)) ;
@@ -1347,6 +1831,13 @@ void LocalProxy::handleProbingMessage(Vector<String> IDs, Packet* p, BABitvector
     memcpy(&origin, p->data()+FID_LEN+sizeof(hop_count)+FID_LEN, sizeof(origin)) ;
     memcpy(&noofpub, p->data()+FID_LEN+sizeof(hop_count)+FID_LEN+sizeof(origin), sizeof(noofpub)) ;
     pubnodeID = String( (const char*)(p->data()+FID_LEN+sizeof(hop_count)+FID_LEN+sizeof(origin)+sizeof(noofpub)), 2*PURSUIT_ID_LEN ) ;
+    memset(&load, 0, sizeof(load)) ;
+    load.hit_rate = 100 ;
+    if(p->length() >= FID_LEN+sizeof(hop_count)+FID_LEN+sizeof(origin)+sizeof(noofpub)+2*PURSUIT_ID_LEN+sizeof(load))
+    {
+        memcpy(&load, p->data()+FID_LEN+sizeof(hop_count)+FID_LEN+sizeof(origin)+sizeof(noofpub)+2*PURSUIT_ID_LEN, sizeof(load)) ;
+    }
+    cost = probingCost(hop_count, load) ;
     reverse_FID = reverse_FID|cache_iLID ;//or the internal ID
 
     Vector<String>::iterator id_iter ;
@@ -1358,8 +1849,9 @@ void LocalProxy::handleProbingMessage(Vector<String> IDs, Packet* p, BABitvector
             continue ;
         as->allKnownIDs = IDs ;
         as->noofpub++ ;
-        if(as->hop_count >= hop_count)
+        if(as->probing_cost >= cost)
         {
+            as->probing_cost = cost ;
             as->hop_count = hop_count ;
             as->incoming_FID = incoming_FID ;
             as->reverse_FID = reverse_FID ;
@@ -1398,7 +1890,10 @@ void LocalProxy::handleProbingMessage(Vector<String> IDs, Packet* p, BABitvector
                 }
                 memcpy(packet->data()+FID_LEN+sizeof(NOofID)+IDindex, as->incoming_FID._data, FID_LEN) ;
                 memcpy(packet->data()+FID_LEN+sizeof(NOofID)+IDindex+FID_LEN, as->notificationIID.c_str(), 2*PURSUIT_ID_LEN) ;
-                output(4).push(packet) ;
+                if(pull_window > 0)
+                    pullItem(IDs[0], as->reverse_FID, packet, 4) ;
+                else
+                    output(4).push(packet) ;
             }
             else
             {
@@ -1433,18 +1928,28 @@ void LocalProxy::handleProbingMessage(Vector<String> IDs, Packet* p, BABitvector
                 }
                 memcpy(packet->data()+FID_LEN+sizeof(numberofID)+sizeof(iidlen)+iidlen*PURSUIT_ID_LEN+\
                 	sizeof(type)+sizeof(NOofID)+IDindex, as->incoming_FID._data, FID_LEN) ;
-                output(2).push(packet) ;
+                if(pull_window > 0)
+                    pullItem(IDs[0], as->reverse_FID, packet, 2) ;
+                else
+                    output(2).push(packet) ;
             }
         }
     }
 }
 
+double LocalProxy::probingCost(unsigned char hop_count, const ProbingLoad &load)
+{
+    unsigned int hit_rate = (load.hit_rate <= 100) ? load.hit_rate : 100 ;
+    /*a busy cache is as good as a farther but idle one, and a cache that misses often forwards the request anyway*/
+    return hop_count + load_weight * ((double) (ntohs(load.pending) + ntohs(load.queue_depth)) / PROBING_LOAD_UNIT + (100 - hit_rate) / 100.0) ;
+}
+
 void LocalProxy::sendScopeProbingMessage(Vector<String> IDs, HashTable<String, BABitvector> FID_to_each_sub,\
                                  HashTable<String, unsigned int> each_sub_hopcount)
 {
-    unsigned char type = SCOPE_PROBING_MESSAGE ;
+    unsigned char type = probe_aggregate ? SCOPE_PROBING_AGGREGATE : SCOPE_PROBING_MESSAGE ;
     HashTable<String, BABitvector>::iterator str_map_iter ;
-    char* probingchar ;
+    unsigned char* probingchar ;
     Vector<String>::iterator vec_str_iter ;
     int packet_len_without_FID ;
     int total_ID_length = 0 ;
@@ -1458,6 +1963,9 @@ void LocalProxy::sendScopeProbingMessage(Vector<String> IDs, HashTable<String, B
 
     BloomFilter BFforIID(IBFSIZE*8) ;//Bloom Filter for Information ID
     int numberOfIID = 0 ;//# of Information ID
+    unsigned char no_sub = FID_to_each_sub.size() ;
+    if(no_sub == 0)
+        return ;
     for( vec_str_iter = IDs.begin() ; vec_str_iter != IDs.end() ; vec_str_iter++)
     {
         total_ID_length += vec_str_iter->length() ;
@@ -1465,8 +1973,15 @@ void LocalProxy::sendScopeProbingMessage(Vector<String> IDs, HashTable<String, B
     packet_len_without_FID = sizeof(type)/*type*/+sizeof(NOofID)/*numberofID*/+NOofID*sizeof(IDLength)/*number of fragment*/+\
                  total_ID_length/*IDs*/+IBFSIZE/*bloom filter*/+FID_LEN/*reverse_path*/+\
                  sizeof(hop_passed)/*hop passed*/+sizeof(total_distance)/*total distance for avg calc*/+\
-                 sizeof(noofcache)/*# of cache for avg calc*/+sizeof(unsigned int)/*hop count*/ ;
-    probingchar = (char*)malloc(packet_len_without_FID) ;
+                 sizeof(noofcache)/*# of cache for avg calc*/ ;
+    int hop_offset = packet_len_without_FID ;
+    if(probe_aggregate)
+        packet_len_without_FID += sizeof(no_sub)+no_sub*(NODEID_LEN+sizeof(hop_count))/*subscriber table*/ ;
+    else
+        packet_len_without_FID += sizeof(hop_count)/*hop count*/ ;
+    /*the template is built once, in the packet that is sent last*/
+    WritablePacket* probingmessage = Packet::make(50, NULL, packet_len_without_FID+FID_LEN, 50) ;
+    probingchar = probingmessage->data()+FID_LEN ;
     memcpy(probingchar, &type, sizeof(type)) ;
     memcpy(probingchar+sizeof(type), &NOofID, sizeof(NOofID)) ;//#ofID
 
@@ -1486,38 +2001,83 @@ void LocalProxy::sendScopeProbingMessage(Vector<String> IDs, HashTable<String, B
     memcpy(probingchar+sizeof(type)+sizeof(NOofID)+IDindex+IBFSIZE+FID_LEN+sizeof(hop_passed)+sizeof(total_distance),\
            &noofcache, sizeof(noofcache)) ;
 
+    if(probe_aggregate)
+    {//a single message along the delivery tree to all subscribers
+        BABitvector FID(FID_LEN*8) ;
+        int table_index = hop_offset+sizeof(no_sub) ;
+        memcpy(probingchar+hop_offset, &no_sub, sizeof(no_sub)) ;
+        for(str_map_iter = FID_to_each_sub.begin() ; str_map_iter != FID_to_each_sub.end() ; str_map_iter++)
+        {
+            hop_count = each_sub_hopcount.get(str_map_iter->first) ;
+            memcpy(probingchar+table_index, str_map_iter->first.c_str(), NODEID_LEN) ;
+            memcpy(probingchar+table_index+NODEID_LEN, &hop_count, sizeof(hop_count)) ;
+            table_index += NODEID_LEN+sizeof(hop_count) ;
+            FID |= str_map_iter->second ;
+        }
+        memcpy(probingmessage->data(), FID._data, FID_LEN) ;
+        output(6).push(probingmessage) ;
+        return ;
+    }
+    int sent = 0 ;
     for(str_map_iter = FID_to_each_sub.begin() ; str_map_iter != FID_to_each_sub.end() ; str_map_iter++)
     {
+        WritablePacket* packet = probingmessage ;
+        if(++sent < (int) no_sub)
+        {//a copy of the template
+            packet = Packet::make(50, NULL, probingmessage->length(), 50) ;
+            memcpy(packet->data(), probingmessage->data(), probingmessage->length()) ;
+        }
         hop_count = each_sub_hopcount.get(str_map_iter->first) ;
-        memcpy(probingchar+sizeof(type)+sizeof(NOofID)+IDindex+IBFSIZE+FID_LEN+sizeof(hop_passed)+\
-               sizeof(total_distance)+sizeof(noofcache), &hop_count, sizeof(hop_count)) ;
-        WritablePacket* probingmessage = Packet::make(50, NULL, packet_len_without_FID+FID_LEN, 50) ;
-        memcpy(probingmessage->data(), str_map_iter->second._data, FID_LEN) ;//FID
-        memcpy(probingmessage->data()+FID_LEN, probingchar, packet_len_without_FID) ;
-        output(6).push(probingmessage) ;
+        memcpy(packet->data()+FID_LEN+hop_offset, &hop_count, sizeof(hop_count)) ;
+        memcpy(packet->data(), str_map_iter->second._data, FID_LEN) ;//FID
+        output(6).push(packet) ;
     }
-    free(probingchar) ;
+}
+
+/*our proposal keeps the max nearest sources of an item, the nearest first (a source that probes again keeps its best distance)*/
+static void addSource(Vector<SourceCandidate> &sources, const BABitvector &FID, double distance, unsigned int max)
+{
+    for(int i = 0 ; i < sources.size() ; i++)
+    {
+        if(sources[i].FID == FID)
+        {
+            if(sources[i].distance <= distance)
+                return ;
+            sources.erase(sources.begin()+i) ;
+            break ;
+        }
+    }
+    int pos = 0 ;
+    while(pos < sources.size() && sources[pos].distance <= distance)
+        pos++ ;
+    if(pos >= (int) max)
+        return ;
+    sources.insert(sources.begin()+pos, SourceCandidate(FID, distance)) ;
+    if(sources.size() > (int) max)
+        sources.pop_back() ;
 }
 
 void LocalProxy::handleScopeProbingMessage(Vector<String> IDs, Packet* p)
 {
     unsigned char numberOfIDs, IDLength /*in fragments of PURSUIT_ID_LEN each*/, prefixIDLength /*in fragments of PURSUIT_ID_LEN each*/, strategy;
     int index = 0;
+    BAHeader hdr;
     BloomFilter cbf(IBFSIZE*8) ;
     unsigned int total_distance ;
     unsigned int noofcache ;
     unsigned int hop_count ;
     double avg_hop_count = 0.0 ;
-    BABitvector to_sub_FID(FID_LEN*8) ;
+    FIDBitvector to_sub_FID ;
     BABitvector to_pub_FID(FID_LEN*8) ;
     bool subreq_sent = false ;
 
     memcpy(to_sub_FID._data, p->data(), FID_LEN) ;
     memcpy(&numberOfIDs, p->data()+FID_LEN+sizeof(unsigned char), sizeof(numberOfIDs)) ;
-    for (int i = 0; i < (int) numberOfIDs; i++) {
-        IDLength = *(p->data() + FID_LEN+sizeof(unsigned char) + sizeof (numberOfIDs) + index);
-        index = index + sizeof (IDLength) + IDLength * PURSUIT_ID_LEN;
+    if (!hdr.parse(p, FID_LEN+sizeof(unsigned char))) {
+        p->kill();
+        return;
     }
+    index = hdr.length() - sizeof (numberOfIDs);
     memcpy(cbf.data._data, p->data()+FID_LEN+sizeof(unsigned char)+sizeof (numberOfIDs)+index, IBFSIZE) ;
     memcpy(to_pub_FID._data, p->data()+FID_LEN+sizeof(unsigned char)+sizeof (numberOfIDs)+index+\
            IBFSIZE, FID_LEN) ;
@@ -1528,6 +2088,32 @@ void LocalProxy::handleScopeProbingMessage(Vector<String> IDs, Packet* p)
     memcpy(&noofcache, p->data()+FID_LEN+sizeof(unsigned char)+sizeof (numberOfIDs)+index+IBFSIZE+\
            FID_LEN+sizeof(hop_count)+sizeof(total_distance), sizeof(noofcache)) ;
 
+    if(*(p->data()+FID_LEN) == SCOPE_PROBING_AGGREGATE)
+    {//our proposal total_distance is the sum of the hops from the publisher to the caches: the distances follow from our own hop count
+        unsigned int table_index = FID_LEN+sizeof(unsigned char)+sizeof (numberOfIDs)+index+IBFSIZE+FID_LEN+3*sizeof(unsigned int) ;
+        unsigned char no_sub = 0 ;
+        unsigned int my_hops = 0 ;
+        bool found = false ;
+        if(p->length() > table_index)
+            no_sub = *(p->data()+table_index) ;
+        table_index += sizeof(no_sub) ;
+        for(int i = 0 ; i < (int) no_sub && table_index+NODEID_LEN+sizeof(my_hops) <= p->length() ; i++)
+        {
+            if(memcmp(p->data()+table_index, gc->nodeID.data(), NODEID_LEN) == 0)
+            {
+                memcpy(&my_hops, p->data()+table_index+NODEID_LEN, sizeof(my_hops)) ;
+                found = true ;
+                break ;
+            }
+            table_index += NODEID_LEN+sizeof(my_hops) ;
+        }
+        if(!found)
+        {//the probe is for the other subscribers
+            p->kill() ;
+            return ;
+        }
+        total_distance = (noofcache*my_hops > total_distance) ? noofcache*my_hops-total_distance : 0 ;
+    }
     if(noofcache > 0)
         avg_hop_count = (double) total_distance/noofcache ;
 
@@ -1549,6 +2135,8 @@ void LocalProxy::handleScopeProbingMessage(Vector<String> IDs, Packet* p)
         {
             bool cached = false ;
             cached = cbf.test(iid_iter->_strData) ;
+            if(multi_source > 1)
+                addSource(as->iid_sources[iid_iter->_strData], to_pub_FID, cached ? avg_hop_count : (double) hop_count, multi_source) ;
             tempdis = as->iid_distance_map.get(iid_iter->_strData) ;
             if(tempdis == as->iid_distance_map.default_value())
             {
@@ -1575,70 +2163,486 @@ void LocalProxy::handleScopeProbingMessage(Vector<String> IDs, Packet* p)
         if(as->noofrcvpub >= as->noofiipub && !subreq_sent)
         {
             subreq_sent = true ;
-            unsigned char type = SUB_SCOPE_MESSAGE ;
-
-            HashTable<String, BloomFilter> strfid_ibf ;
-            HashTable<String, BABitvector> str_fid ;
-            for(StringSetIter iid_iter = as->IIDs.begin() ; iid_iter != as->IIDs.end() ; iid_iter++)
-            {//kanycast determine how to retreive the content
-                BloomFilter tempibf(IBFSIZE*8) ;//temp information bloom filter
-                BABitvector tempfid(FID_LEN*8) ;
-                String tempfidstr ;
-
-                tempfid = as->iid_FID_map.get(iid_iter->_strData) ;
-                tempfidstr = String((const char*)(tempfid._data), FID_LEN) ;
-                tempibf = strfid_ibf.get(tempfidstr) ;
-                str_fid.set(tempfidstr, tempfid) ;
-
-                if(tempibf == strfid_ibf.default_value())
-                {//if this path hasn't be choosen before, then add the iid to the empty bf
-                    tempibf.resize(IBFSIZE*8) ;
-                    tempibf.zero() ;
-                    tempibf.add2bf(iid_iter->_strData) ;
+            String ids_header((const char *) p->data()+FID_LEN+sizeof(unsigned char)+sizeof(numberOfIDs), index) ;
+            HashTable<String, BABitvector> iid_FIDs ;
+            if(multi_source > 1)
+                assignSources(as, IDs, ids_header, numberOfIDs, to_sub_FID, iid_FIDs) ;
+            else
+            {
+                for(StringSetIter iid_iter = as->IIDs.begin() ; iid_iter != as->IIDs.end() ; iid_iter++)
+                    iid_FIDs.set(iid_iter->_strData, as->iid_FID_map.get(iid_iter->_strData)) ;
+            }
+            sendScopeRequests(ids_header, numberOfIDs, to_sub_FID, iid_FIDs) ;
+        }
+    }
+}
+
+void LocalProxy::sendScopeRequests(const String &ids_header, unsigned char numberOfIDs, const FIDBitvector &to_sub_FID, HashTable<String, BABitvector> &iid_FIDs)
+{
+    unsigned char type = SUB_SCOPE_MESSAGE ;
+    int index = ids_header.length() ;
+
+    HashTable<String, BloomFilter> strfid_ibf ;
+    HashTable<String, BABitvector> str_fid ;
+    for(HashTable<String, BABitvector>::iterator iid_iter = iid_FIDs.begin() ; iid_iter != iid_FIDs.end() ; iid_iter++)
+    {//kanycast determine how to retreive the content
+        BloomFilter tempibf(IBFSIZE*8) ;//temp information bloom filter
+        BABitvector tempfid(FID_LEN*8) ;
+        String tempfidstr ;
+
+        tempfid = iid_iter.value() ;
+        tempfidstr = String((const char*)(tempfid._data), FID_LEN) ;
+        tempibf = strfid_ibf.get(tempfidstr) ;
+        str_fid.set(tempfidstr, tempfid) ;
+
+        if(tempibf == strfid_ibf.default_value())
+        {//if this path hasn't be choosen before, then add the iid to the empty bf
+            tempibf.resize(IBFSIZE*8) ;
+            tempibf.zero() ;
+            tempibf.add2bf(iid_iter.key()) ;
+        }
+        else
+            tempibf.add2bf(iid_iter.key()) ;//if choosen before, just add the iid to it
+        strfid_ibf.set(tempfidstr, tempibf) ;
+
+    }
+    BloomFilter ebf(EBFSIZE*8) ;
+    for(HashTable<String,BloomFilter>::iterator strfid_ibf_iter = strfid_ibf.begin() ;\
+        strfid_ibf_iter != strfid_ibf.end() ; strfid_ibf_iter++)
+    {
+        WritablePacket* packet ;
+        int packet_size = FID_LEN+sizeof(type)+index+sizeof(numberOfIDs)+EBFSIZE+IBFSIZE+FID_LEN ;
+        packet = Packet::make(packet_size) ;
+
+        memcpy(packet->data(), str_fid[strfid_ibf_iter->first]._data, FID_LEN) ;
+        memcpy(packet->data()+FID_LEN, &type, sizeof(type)) ;
+        memcpy(packet->data()+FID_LEN+sizeof(type), &numberOfIDs, sizeof(numberOfIDs)) ;
+        memcpy(packet->data()+FID_LEN+sizeof(type)+sizeof(numberOfIDs), ids_header.data(), index) ;
+        memcpy(packet->data()+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index, ebf.data._data, EBFSIZE) ;
+        memcpy(packet->data()+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+EBFSIZE, strfid_ibf_iter->second.data._data, IBFSIZE) ;
+        memcpy(packet->data()+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+EBFSIZE+IBFSIZE, to_sub_FID._data, FID_LEN) ;
+        output(6).push(packet) ;
+    }
+}
+
+void LocalProxy::assignSources(ActiveSubscription *as, Vector<String> &IDs, const String &ids_header, unsigned char numberOfIDs, const FIDBitvector &to_sub_FID,\
+                               HashTable<String, BABitvector> &iid_FIDs)
+{
+    HashTable<String, int> assigned(0) ;
+    SourceRetrieval *sr = new SourceRetrieval() ;
+    sr->SIDs = IDs ;
+    sr->ids_header = ids_header ;
+    sr->numberOfIDs = numberOfIDs ;
+    sr->to_sub_FID = to_sub_FID ;
+    for(StringSetIter iid_iter = as->IIDs.begin() ; iid_iter != as->IIDs.end() ; iid_iter++)
+    {
+        Vector<SourceCandidate> &candidates = as->iid_sources[iid_iter->_strData] ;
+        if(candidates.empty())
+        {//no probe listed the item: the best path it has
+            iid_FIDs.set(iid_iter->_strData, as->iid_FID_map.get(iid_iter->_strData)) ;
+            continue ;
+        }
+        /*the nearest of the least loaded sources of the item*/
+        int best = 0 ;
+        for(int i = 1 ; i < candidates.size() ; i++)
+        {
+            if(assigned.get(String((const char *) candidates[i].FID._data, FID_LEN)) <\
+               assigned.get(String((const char *) candidates[best].FID._data, FID_LEN)))
+                best = i ;
+        }
+        assigned[String((const char *) candidates[best].FID._data, FID_LEN)]++ ;
+        iid_FIDs.set(iid_iter->_strData, candidates[best].FID) ;
+        /*the fallback: the chosen source first, then the others from the nearest*/
+        Vector<BABitvector> &order = sr->sources[iid_iter->_strData] ;
+        order.push_back(candidates[best].FID) ;
+        for(int i = 0 ; i < candidates.size() ; i++)
+        {
+            if(i != best)
+                order.push_back(candidates[i].FID) ;
+        }
+    }
+    as->iid_sources.clear() ;
+    if(sr->sources.empty() || source_timeout == 0)
+    {
+        delete sr ;
+        return ;
+    }
+    sr->deadline = Timestamp::now() + Timestamp::make_msec(source_timeout) ;
+    pending_retrievals.push_back(sr) ;
+    if(!retrieval_timer.scheduled())
+        retrieval_timer.schedule_at(sr->deadline) ;
+}
+
+void LocalProxy::retrievalAnswered(Vector<String> &IDs)
+{
+    for(int i = 0 ; i < pending_retrievals.size() ;)
+    {
+        SourceRetrieval *sr = pending_retrievals[i] ;
+        for(int j = 0 ; j < IDs.size() ; j++)
+        {
+            if(IDs[j].length() <= PURSUIT_ID_LEN)
+                continue ;
+            String scope = IDs[j].substring(0, IDs[j].length() - PURSUIT_ID_LEN) ;
+            for(int k = 0 ; k < sr->SIDs.size() ; k++)
+            {
+                if(sr->SIDs[k] == scope)
+                {
+                    sr->sources.erase(IDs[j].substring(IDs[j].length() - PURSUIT_ID_LEN, PURSUIT_ID_LEN)) ;
+                    break ;
                 }
-                else
-                    tempibf.add2bf(iid_iter->_strData) ;//if choosen before, just add the iid to it
-                strfid_ibf.set(tempfidstr, tempibf) ;
+            }
+        }
+        if(sr->sources.empty())
+        {
+            delete sr ;
+            pending_retrievals[i] = pending_retrievals.back() ;
+            pending_retrievals.pop_back() ;
+        }
+        else
+            i++ ;
+    }
+}
 
+void LocalProxy::retrySources()
+{
+    Timestamp now = Timestamp::now() ;
+    Timestamp next ;
+    for(int i = 0 ; i < pending_retrievals.size() ;)
+    {
+        SourceRetrieval *sr = pending_retrievals[i] ;
+        if(sr->deadline <= now)
+        {//the source of every missing item is too slow: the next one is asked, the items without one are given up
+            HashTable<String, BABitvector> iid_FIDs ;
+            Vector<String> exhausted ;
+            for(HashTable<String, Vector<BABitvector> >::iterator it = sr->sources.begin() ; it != sr->sources.end() ; it++)
+            {
+                Vector<BABitvector> &order = it.value() ;
+                order.erase(order.begin()) ;
+                if(order.empty())
+                    exhausted.push_back(it.key()) ;
+                else
+                    iid_FIDs.set(it.key(), order[0]) ;
             }
-            BloomFilter ebf(EBFSIZE*8) ;
-            for(HashTable<String,BloomFilter>::iterator strfid_ibf_iter = strfid_ibf.begin() ;\
-                strfid_ibf_iter != strfid_ibf.end() ; strfid_ibf_iter++)
+            for(int j = 0 ; j < exhausted.size() ; j++)
+                sr->sources.erase(exhausted[j]) ;
+            BA_TRACE(TRACE_PROXY, TRACE_DEBUG, "localproxy: %d items asked from their next source", iid_FIDs.size()) ;
+            if(!iid_FIDs.empty())
+                sendScopeRequests(sr->ids_header, sr->numberOfIDs, sr->to_sub_FID, iid_FIDs) ;
+            if(sr->sources.empty())
             {
-                WritablePacket* packet ;
-                int packet_size = FID_LEN+sizeof(type)+index+sizeof(numberOfIDs)+EBFSIZE+IBFSIZE+FID_LEN ;
-                packet = Packet::make(packet_size) ;
+                delete sr ;
+                pending_retrievals[i] = pending_retrievals.back() ;
+                pending_retrievals.pop_back() ;
+                continue ;
+            }
+            sr->deadline = now + Timestamp::make_msec(source_timeout) ;
+        }
+        if(!next || sr->deadline < next)
+            next = sr->deadline ;
+        i++ ;
+    }
+    if(next)
+        retrieval_timer.schedule_at(next) ;
+}
 
-                memcpy(packet->data(), str_fid[strfid_ibf_iter->first]._data, FID_LEN) ;
-                memcpy(packet->data()+FID_LEN, &type, sizeof(type)) ;
-                memcpy(packet->data()+FID_LEN+sizeof(type), &numberOfIDs, sizeof(numberOfIDs)) ;
-                memcpy(packet->data()+FID_LEN+sizeof(type)+sizeof(numberOfIDs), p->data()+FID_LEN+sizeof(type)+sizeof(numberOfIDs), index) ;
-                memcpy(packet->data()+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index, ebf.data._data, EBFSIZE) ;
-                memcpy(packet->data()+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+EBFSIZE, strfid_ibf_iter->second.data._data, IBFSIZE) ;
-                memcpy(packet->data()+FID_LEN+sizeof(type)+sizeof(numberOfIDs)+index+EBFSIZE+IBFSIZE, to_sub_FID._data, FID_LEN) ;
-                output(6).push(packet) ;
+void LocalProxy::pullItem(const String &ID, const BABitvector &FID, Packet *p, int port)
+{
+    if(pull_requests.get(ID) != pull_requests.default_value())
+    {//a later probing response for an item that is already requested
+        p->kill() ;
+        return ;
+    }
+    String key((const char *) FID._data, FID_LEN) ;
+    PullWindow *w = pull_windows.get(key) ;
+    if(w == pull_windows.default_value())
+    {
+        w = new PullWindow() ;
+        w->cwnd = (PULL_WINDOW_INITIAL < pull_window) ? PULL_WINDOW_INITIAL : pull_window ;
+        w->ssthresh = pull_window ;
+        pull_windows.set(key, w) ;
+    }
+    PullRequest *r = new PullRequest() ;
+    r->ID = ID ;
+    r->window = key ;
+    r->packet = p ;
+    r->port = port ;
+    pull_requests.set(ID, r) ;
+    w->queued.push_back(r) ;
+    fillWindow(w) ;
+}
+
+void LocalProxy::fillWindow(PullWindow *w)
+{
+    while(!w->queued.empty() && w->in_flight < (int) w->cwnd)
+    {
+        PullRequest *r = w->queued[0] ;
+        Timestamp now = Timestamp::now() ;
+        /*the timeout doubles with every retry*/
+        uint32_t rto = (uint32_t) w->rto() << (r->retries < 6 ? r->retries : 6) ;
+        w->queued.erase(w->queued.begin()) ;
+        w->in_flight++ ;
+        r->sent = now ;
+        r->deadline = now + Timestamp::make_msec(rto) ;
+        if(!pull_timer.scheduled() || r->deadline < pull_timer.expiry())
+            pull_timer.schedule_at(r->deadline) ;
+        /*the data may come back before push returns (a local cache): r must not be used after it*/
+        output(r->port).push(r->packet->clone()) ;
+    }
+}
+
+void LocalProxy::pullAnswered(Vector<String> &IDs)
+{
+    for(int i = 0 ; i < IDs.size() ; i++)
+    {
+        PullRequest *r = pull_requests.get(IDs[i]) ;
+        if(r == pull_requests.default_value())
+            continue ;
+        PullWindow *w = pull_windows.get(r->window) ;
+        pull_requests.erase(IDs[i]) ;
+        if(!r->sent)
+        {//the data came before the request was sent (again)
+            for(int j = 0 ; j < w->queued.size() ; j++)
+            {
+                if(w->queued[j] == r)
+                {
+                    w->queued.erase(w->queued.begin() + j) ;
+                    break ;
+                }
             }
         }
+        else
+        {
+            w->in_flight-- ;
+            if(r->retries == 0)
+            {//only the requests sent once measure the round trip time
+                double rtt = (double) (Timestamp::now() - r->sent).usecval() / 1000 ;
+                if(rtt <= 0)
+                    rtt = 0.001 ;
+                if(w->srtt == 0)
+                {
+                    w->srtt = rtt ;
+                    w->rttvar = rtt / 2 ;
+                    w->min_rtt = rtt ;
+                }
+                else
+                {
+                    double error = (w->srtt > rtt) ? w->srtt - rtt : rtt - w->srtt ;
+                    w->rttvar = 0.75 * w->rttvar + 0.25 * error ;
+                    w->srtt = 0.875 * w->srtt + 0.125 * rtt ;
+                    if(rtt < w->min_rtt)
+                        w->min_rtt = rtt ;
+                }
+            }
+            if(w->srtt <= 2 * w->min_rtt)
+            {//the path is not queueing the requests up yet
+                w->cwnd += (w->cwnd < w->ssthresh) ? 1 : 1 / w->cwnd ;
+                if(w->cwnd > pull_window)
+                    w->cwnd = pull_window ;
+            }
+        }
+        delete r ;
+        fillWindow(w) ;
+        break ;
+    }
+}
+
+void LocalProxy::pullTimeouts()
+{
+    Timestamp now = Timestamp::now() ;
+    Timestamp next ;
+    Vector<PullRequest *> expired ;
+    Vector<PullWindow *> shrunk ;
+    for(HashTable<String, PullRequest *>::iterator it = pull_requests.begin() ; it != pull_requests.end() ; it++)
+    {
+        PullRequest *r = it.value() ;
+        if(!r->sent)
+            continue ;
+        if(r->deadline <= now)
+            expired.push_back(r) ;
+        else if(!next || r->deadline < next)
+            next = r->deadline ;
+    }
+    for(int i = 0 ; i < expired.size() ; i++)
+    {
+        PullRequest *r = expired[i] ;
+        PullWindow *w = pull_windows.get(r->window) ;
+        bool seen = false ;
+        for(int j = 0 ; j < shrunk.size() ; j++)
+            seen = seen || (shrunk[j] == w) ;
+        if(!seen)
+        {//a loss: the window halves once, however many of its requests timed out together
+            w->ssthresh = (w->cwnd / 2 > 1) ? w->cwnd / 2 : 1 ;
+            w->cwnd = w->ssthresh ;
+            shrunk.push_back(w) ;
+        }
+        w->in_flight-- ;
+        if(r->retries >= pull_retries)
+        {
+            BA_TRACE(TRACE_PROXY, TRACE_DEBUG, "localproxy: giving up the pull of %s", r->ID.quoted_hex().c_str()) ;
+            pull_requests.erase(r->ID) ;
+            delete r ;
+            continue ;
+        }
+        /*sent again before the requests that never were*/
+        r->retries++ ;
+        r->sent = Timestamp() ;
+        w->queued.insert(w->queued.begin(), r) ;
+    }
+    if(next && (!pull_timer.scheduled() || next < pull_timer.expiry()))
+        pull_timer.schedule_at(next) ;
+    for(int i = 0 ; i < shrunk.size() ; i++)
+        fillWindow(shrunk[i]) ;
+}
+
+void LocalProxy::startFlooding(Vector<String> &SIDs, StringSet &IIDs, BABitvector iLIDs)
+{
+    if (flood_ttl == 0) {
+        floodingReq(SIDs, IIDs, iLIDs, FLOOD_TTL_UNLIMITED) ;
+        return ;
+    }
+    FloodRequest *fr = new FloodRequest() ;
+    fr->SIDs = SIDs ;
+    fr->IIDs = IIDs ;
+    fr->iLIDs = iLIDs ;
+    fr->ttl = flood_ttl ;
+    fr->deadline = Timestamp::now() + Timestamp::make_msec(flood_retry) ;
+    pending_floods.push_back(fr) ;
+    floodingReq(SIDs, IIDs, iLIDs, fr->ttl) ;
+    if (!flood_timer.scheduled()) {
+        flood_timer.schedule_at(fr->deadline) ;
+    }
+}
+
+void LocalProxy::floodAnswered(Vector<String> &IDs)
+{
+    for (int i = 0; i < pending_floods.size();) {
+        FloodRequest *fr = pending_floods[i] ;
+        bool answered = false ;
+        for (int j = 0; j < IDs.size() && !answered; j++) {
+            String scope = IDs[j].substring(0, IDs[j].length() - PURSUIT_ID_LEN) ;
+            for (int k = 0; k < fr->SIDs.size(); k++) {
+                if (fr->SIDs[k] == scope) {
+                    answered = true ;
+                    break ;
+                }
+            }
+        }
+        if (answered) {
+            delete fr ;
+            pending_floods[i] = pending_floods.back() ;
+            pending_floods.pop_back() ;
+        } else {
+            i++ ;
+        }
+    }
+}
+
+void LocalProxy::run_timer(Timer *timer)
+{
+    if (timer == &lease_timer) {
+        refreshLeases() ;
+        lease_timer.reschedule_after_msec(lease_refresh * 1000) ;
+        return ;
+    }
+    if (timer == &retrieval_timer) {
+        retrySources() ;
+        return ;
+    }
+    if (timer == &pull_timer) {
+        pullTimeouts() ;
+        return ;
+    }
+    Timestamp now = Timestamp::now() ;
+    Timestamp next ;
+    for (int i = 0; i < pending_floods.size();) {
+        FloodRequest *fr = pending_floods[i] ;
+        if (fr->deadline <= now) {
+            if (fr->ttl >= flood_ttl_max) {
+                /*last try: the whole network*/
+                floodingReq(fr->SIDs, fr->IIDs, fr->iLIDs, FLOOD_TTL_UNLIMITED) ;
+                delete fr ;
+                pending_floods[i] = pending_floods.back() ;
+                pending_floods.pop_back() ;
+                continue ;
+            }
+            fr->ttl = (2 * fr->ttl < flood_ttl_max) ? 2 * fr->ttl : flood_ttl_max ;
+            fr->deadline = now + Timestamp::make_msec(flood_retry) ;
+            floodingReq(fr->SIDs, fr->IIDs, fr->iLIDs, fr->ttl) ;
+        }
+        if (!next || fr->deadline < next) {
+            next = fr->deadline ;
+        }
+        i++ ;
     }
+    if (next) {
+        flood_timer.schedule_at(next) ;
+    }
+}
+
+void LocalProxy::refreshLeases()
+{
+    /*one refresh per rendezvous node, whatever the number of items it knows this node for*/
+    HashTable<String, unsigned char> RVs ;
+    String noID ;
+    for (ActivePubIter it = activePublicationIndex.begin(); it != activePublicationIndex.end(); it++) {
+        ActivePublication *ap = (*it).second ;
+        /*the local RV never expires this node*/
+        if (!ap->RVFID.zero() && !(ap->RVFID == gc->iLID)) {
+            RVs.set(String((const char *) ap->RVFID._data, FID_LEN), ap->strategy) ;
+        }
+    }
+    for (ActiveSubIter it = activeSubscriptionIndex.begin(); it != activeSubscriptionIndex.end(); it++) {
+        ActiveSubscription *as = (*it).second ;
+        if (!as->RVFID.zero() && !(as->RVFID == gc->iLID)) {
+            RVs.set(String((const char *) as->RVFID._data, FID_LEN), as->strategy) ;
+        }
+    }
+    for (HashTable<String, unsigned char>::iterator it = RVs.begin(); it != RVs.end(); it++) {
+        BABitvector RVFID(FID_LEN * 8) ;
+        memcpy(RVFID._data, it.key().data(), FID_LEN) ;
+        createAndSendPacketToRV(LEASE_REFRESH, 0, noID, 0, noID, RVFID, it.value()) ;
+    }
+#if CLICK_USERLEVEL
+    /*applications that crashed never sent a DISCONNECT*/
+    if (sweep_cursor >= sweep_hosts.size()) {
+        sweep_hosts.clear() ;
+        for (PubSubIdxIter it = local_pub_sub_Index.begin(); it != local_pub_sub_Index.end(); it++) {
+            sweep_hosts.push_back((*it).first) ;
+        }
+        sweep_cursor = 0 ;
+    }
+    for (int i = 0; (i < LEASE_SWEEP_BATCH) && (sweep_cursor < sweep_hosts.size()); i++, sweep_cursor++) {
+        LocalHost *_localhost = local_pub_sub_Index.get(sweep_hosts[sweep_cursor]) ;
+        if ((_localhost != local_pub_sub_Index.default_value()) && (_localhost->type == LOCAL_PROCESS) && (kill(_localhost->id, 0) == -1) && (errno == ESRCH)) {
+            click_chatter("LocalProxy: application %d is gone", _localhost->id) ;
+            disconnect(_localhost) ;
+        }
+    }
+#endif
 }
 
-void LocalProxy::floodingReq(Vector<String> &SIDs, StringSet &IIDs, BABitvector iLIDs)
+void LocalProxy::floodingReq(Vector<String> &SIDs, StringSet &IIDs, BABitvector iLIDs, unsigned char ttl)
 {
     unsigned char type = SUB_SCOPE_MESSAGE ;
     unsigned char no_sid = SIDs.size() ;
     unsigned char no_iid = IIDs.size() ;
+    if (!node_bucket.take(flood_rate, flood_burst, Timestamp::now())) {
+        /*over FLOOD_RATE - a pending request is flooded again by the expanding ring search anyway*/
+        BA_TRACE(TRACE_PROXY, TRACE_DEBUG, "flood dropped by FLOOD_RATE") ;
+        floods_limited++ ;
+        return ;
+    }
+    floods_sent++ ;
     unsigned char each_sid_len ;
     unsigned int sid_len = 0 ;
     int sid_index = 0 ;
-    
-    unsigned char noofnode = 1 ;
-    
+    uint32_t seq = ++flood_seq ;
     for( int i = 0 ; i < (int)no_sid ; i++)
     {
         sid_len += SIDs[i].length() ;
     }
     int packet_len = FID_LEN+sizeof(type)+sizeof(no_sid)+no_sid*sizeof(each_sid_len)+sid_len+\
-                     EBFSIZE+IBFSIZE+FID_LEN+sizeof(noofnode)+NODEID_LEN ;
+                     EBFSIZE+IBFSIZE+FID_LEN+FLOOD_STAMP_LEN+FLOOD_TTL_LEN ;
     WritablePacket* packet ;
     packet = Packet::make(packet_len) ;
     BloomFilter ebf(EBFSIZE*8) ;
@@ -1663,11 +2667,13 @@ void LocalProxy::floodingReq(Vector<String> &SIDs, StringSet &IIDs, BABitvector
     memcpy(packet->data()+FID_LEN+sizeof(type)+sizeof(no_sid)+sid_index+EBFSIZE, ibf.data._data, IBFSIZE) ;
     memcpy(packet->data()+FID_LEN+sizeof(type)+sizeof(no_sid)+sid_index+EBFSIZE+IBFSIZE,\
            gc->iLID._data, FID_LEN) ;
-    
-    memcpy(packet->data()+FID_LEN+sizeof(type)+sizeof(no_sid)+sid_index+EBFSIZE+IBFSIZE+FID_LEN, &noofnode, sizeof(noofnode)) ;
-    memcpy(packet->data()+FID_LEN+sizeof(type)+sizeof(no_sid)+sid_index+EBFSIZE+IBFSIZE+FID_LEN+sizeof(noofnode),\
+    /*the stamp: origin node ID and sequence number*/
+    memcpy(packet->data()+FID_LEN+sizeof(type)+sizeof(no_sid)+sid_index+EBFSIZE+IBFSIZE+FID_LEN,\
            gc->nodeID.c_str(), NODEID_LEN) ;
-           
+    memcpy(packet->data()+FID_LEN+sizeof(type)+sizeof(no_sid)+sid_index+EBFSIZE+IBFSIZE+FID_LEN+NODEID_LEN,\
+           &seq, sizeof(seq)) ;
+    memcpy(packet->data()+FID_LEN+sizeof(type)+sizeof(no_sid)+sid_index+EBFSIZE+IBFSIZE+FID_LEN+FLOOD_STAMP_LEN,\
+           &ttl, sizeof(ttl)) ;
     output(6).push(packet) ;
 
 
@@ -1679,7 +2685,7 @@ void LocalProxy::notifyPubScopeInfoSub(Vector<String>& SIDs, Packet* p)
     int numberOfIDs = SIDs.size() ;
     BloomFilter ebf(EBFSIZE*8) ;
     BloomFilter ibf(IBFSIZE*8) ;
-    BABitvector to_sub_FID(FID_LEN*8) ;
+    FIDBitvector to_sub_FID ;
     memcpy(ebf.data._data, p->data(), EBFSIZE) ;
     memcpy(ibf.data._data, p->data()+EBFSIZE, IBFSIZE) ;
     memcpy(to_sub_FID._data, p->data()+EBFSIZE+IBFSIZE, FID_LEN) ;
@@ -1736,6 +2742,113 @@ void LocalProxy::notifyPubScopeInfoSub(Vector<String>& SIDs, Packet* p)
     }
 }
 
+enum {H_FLOODS_SENT, H_FLOODS_LIMITED, H_SUBSCRIPTIONS_LIMITED, H_HOSTS_LIMITED, H_DUPLICATES_SUPPRESSED, H_DUPLICATE_BYTES_SUPPRESSED, H_MEMORY, H_MEMORY_SCOPES};
+
+String LocalProxy::read_handler(Element *e, void *thunk) {
+    LocalProxy *lp = (LocalProxy *) e;
+    StringAccum sa;
+    switch ((intptr_t) thunk) {
+        case H_FLOODS_SENT:
+            return String(lp->floods_sent);
+        case H_FLOODS_LIMITED:
+            return String(lp->floods_limited);
+        case H_SUBSCRIPTIONS_LIMITED:
+            return String(lp->subscriptions_limited);
+        case H_HOSTS_LIMITED:
+            for (PubSubIdxIter it = lp->local_pub_sub_Index.begin(); it != lp->local_pub_sub_Index.end(); it++) {
+                if ((*it).second->floods_limited > 0) {
+                    sa << (*it).second->localHostID << ' ' << (*it).second->floods_limited << '\n';
+                }
+            }
+            return sa.take_string();
+        case H_DUPLICATES_SUPPRESSED:
+            return String(lp->duplicates_suppressed);
+        case H_DUPLICATE_BYTES_SUPPRESSED:
+            return String(lp->duplicate_bytes_suppressed);
+        case H_MEMORY:
+        case H_MEMORY_SCOPES:
+        {
+            MemReport report;
+            lp->memoryReport(report);
+            return ((intptr_t) thunk == H_MEMORY) ? report.totals() : report.scopes();
+        }
+        default:
+            return String();
+    }
+}
+
+/*a FID is FID_LEN bytes beyond the BABitvector itself*/
+static inline size_t mem_fid() {
+    return sizeof(BABitvector) + FID_LEN;
+}
+
+void LocalProxy::memoryReport(MemReport &report) {
+    /*an ActivePublication (or ActiveSubscription) is indexed by all its known IDs, so each of them accounts for its share of it*/
+    report.begin("publications", activePublicationIndex.size());
+    for (ActivePubIter it = activePublicationIndex.begin(); it != activePublicationIndex.end(); it++) {
+        ActivePublication *ap = it.value();
+        size_t bytes = sizeof(ActivePublication) + mem_string(ap->fullID) + ap->publishers.size() * mem_entry<LocalHost *, unsigned char>() + mem_strings(ap->allKnownIDs)\
+                + ap->FID_to_eachsub.size() * (mem_entry<String, BABitvector>() + FID_LEN + PURSUIT_ID_LEN) + ap->FID_groups.size() * mem_fid()\
+                + ap->IIDs.size() * (mem_set_entry<StringSetItem>() + PURSUIT_ID_LEN);
+        bytes = bytes / (ap->allKnownIDs.size() > 0 ? ap->allKnownIDs.size() : 1) + mem_entry<IDHandle, ActivePublication *>();
+        if (!report.sample(it.key(), bytes)) {
+            break;
+        }
+    }
+    report.end();
+    report.begin("subscriptions", activeSubscriptionIndex.size());
+    for (ActiveSubIter it = activeSubscriptionIndex.begin(); it != activeSubscriptionIndex.end(); it++) {
+        ActiveSubscription *as = it.value();
+        size_t bytes = sizeof(ActiveSubscription) + mem_string(as->fullID) + as->subscribers.size() * mem_set_entry<LocalHostSetItem>() + mem_strings(as->allKnownIDs)\
+                + mem_strings(as->temp_probing_message) + mem_string(as->notificationIID) + as->IIDs.size() * (mem_set_entry<StringSetItem>() + PURSUIT_ID_LEN)\
+                + as->iid_FID_map.size() * (mem_entry<String, BABitvector>() + FID_LEN + PURSUIT_ID_LEN) + as->iid_distance_map.size() * (mem_entry<String, double>() + PURSUIT_ID_LEN);
+        for (HashTable<String, Vector<SourceCandidate> >::iterator source_it = as->iid_sources.begin(); source_it != as->iid_sources.end(); source_it++) {
+            bytes += mem_entry<String, Vector<SourceCandidate> >() + source_it.key().length() + source_it.value().size() * (sizeof(SourceCandidate) + FID_LEN);
+        }
+        bytes = bytes / (as->allKnownIDs.size() > 0 ? as->allKnownIDs.size() : 1) + mem_entry<IDHandle, ActiveSubscription *>();
+        if (!report.sample(it.key(), bytes)) {
+            break;
+        }
+    }
+    report.end();
+    /*the local publishers and subscribers are spread over many scopes, so they are not counted under any of them*/
+    report.begin("hosts", local_pub_sub_Index.size());
+    for (PubSubIdxIter it = local_pub_sub_Index.begin(); it != local_pub_sub_Index.end(); it++) {
+        LocalHost *host = it.value();
+        size_t bytes = sizeof(LocalHost) + mem_entry<int, LocalHost *>() + mem_string(host->localHostID)\
+                + (host->activePublications.size() + host->activeSubscriptions.size()) * (mem_set_entry<StringSetItem>() + PURSUIT_ID_LEN);
+        if (!report.sample(String(), bytes)) {
+            break;
+        }
+    }
+    report.end();
+    report.begin("local_fanout", local_fanout.size());
+    for (HashTable<String, Vector<LocalHost *> >::iterator it = local_fanout.begin(); it != local_fanout.end(); it++) {
+        if (!report.sample(it.key(), mem_entry<String, Vector<LocalHost *> >() + it.key().length() + it.value().size() * sizeof(LocalHost *))) {
+            break;
+        }
+    }
+    report.end();
+    report.begin("dedup", dedup.size());
+    for (HashTable<String, DedupWindow *>::iterator it = dedup.begin(); it != dedup.end(); it++) {
+        if (!report.sample(it.key(), mem_entry<String, DedupWindow *>() + it.key().length() + sizeof(DedupWindow) + sizeof(String))) {
+            break;
+        }
+    }
+    report.end();
+}
+
+void LocalProxy::add_handlers() {
+    add_read_handler("floods_sent", read_handler, (void *) H_FLOODS_SENT);
+    add_read_handler("floods_limited", read_handler, (void *) H_FLOODS_LIMITED);
+    add_read_handler("subscriptions_limited", read_handler, (void *) H_SUBSCRIPTIONS_LIMITED);
+    add_read_handler("hosts_limited", read_handler, (void *) H_HOSTS_LIMITED);
+    add_read_handler("duplicates_suppressed", read_handler, (void *) H_DUPLICATES_SUPPRESSED);
+    add_read_handler("duplicate_bytes_suppressed", read_handler, (void *) H_DUPLICATE_BYTES_SUPPRESSED);
+    add_read_handler("memory", read_handler, (void *) H_MEMORY);
+    add_read_handler("memory_scopes", read_handler, (void *) H_MEMORY_SCOPES);
+}
 
 CLICK_ENDDECLS
 EXPORT_ELEMENT(LocalProxy)
+ELEMENT_REQUIRES(Trace Telemetry MemStats)
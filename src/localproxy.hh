@@ -18,13 +18,135 @@
 #include "localhost.hh"
 #include "activepub.hh"
 #include "bloomfilter.hh"
+#include "memstats.hh"
 
 #include <click/router.hh>
+#include <click/timer.hh>
+#include <click/bitvector.hh>
 
 CLICK_DECLS
 
 class LocalHost;
 
+/**@brief kanycast a flooded subscription that waits for an answer (a publisher or a cache) - used by the expanding ring search.
+ */
+class FloodRequest {
+public:
+    Vector<String> SIDs;
+    StringSet IIDs;
+    BABitvector iLIDs;
+    /**@brief the hop limit of the last flood*/
+    unsigned char ttl;
+    /**@brief when the request is flooded again with a larger radius*/
+    Timestamp deadline;
+};
+
+/**@brief Our proposal the items of a scope subscription requested from several sources in parallel (MULTI_SOURCE), waiting for their data.
+ * The items whose data does not arrive before the deadline are requested again from their next source.
+ */
+class SourceRetrieval {
+public:
+    /**@brief the scope identifiers and the identifier header (number of fragments and fragments) of the SUB_SCOPE_MESSAGE*/
+    Vector<String> SIDs;
+    String ids_header;
+    unsigned char numberOfIDs;
+    FIDBitvector to_sub_FID;
+    /**@brief the sources of the items still missing, the one asked first*/
+    HashTable<String, Vector<BABitvector> > sources;
+    Timestamp deadline;
+};
+
+/**@brief Our proposal the window a PullWindow starts with, and the retransmission timeout (msec) of its requests until a round trip time is measured and at least.
+ */
+#define PULL_WINDOW_INITIAL 2
+#define PULL_RTO_INITIAL 1000
+#define PULL_RTO_MIN 50
+
+/**@brief Our proposal an item request (a subinfo to a cache or a PLEASE_PUSH_DATA to a publisher) of a PullWindow, kept until its data arrives so that it can be sent again.
+ */
+class PullRequest {
+public:
+    PullRequest() : packet(NULL), retries(0) {}
+    ~PullRequest() {if (packet) packet->kill();}
+    /**@brief the first identifier of the item and the key (reverse FID) of its PullWindow*/
+    String ID;
+    String window;
+    /**@brief the request and the output port it is sent to (4 for a subinfo, 2 for a PLEASE_PUSH_DATA)*/
+    Packet *packet;
+    int port;
+    /**@brief when it was (last) sent and when it is sent again - a null sent time means it is waiting for room in the window*/
+    Timestamp sent;
+    Timestamp deadline;
+    unsigned int retries;
+};
+
+/**@brief Our proposal the item requests of this node to one source (by reverse FID), PULL_WINDOW: at most cwnd of them are in flight.
+ *
+ * The window grows by one request per answer up to ssthresh (slow start) and by one per window after, up to PULL_WINDOW, as long as the round trip time
+ * stays below twice the smallest one seen (beyond, the requests only queue up on the path). A request that times out (after srtt + 4 * rttvar) halves the window and is sent again.
+ */
+class PullWindow {
+public:
+    PullWindow() : in_flight(0), srtt(0), rttvar(0), min_rtt(0) {}
+    double cwnd;
+    double ssthresh;
+    int in_flight;
+    /**@brief the smoothed round trip time, its variation and the smallest one seen, in msec (0 until the first answer)*/
+    double srtt;
+    double rttvar;
+    double min_rtt;
+    /**@brief the requests waiting for room in the window, oldest first*/
+    Vector<PullRequest *> queued;
+    /**@brief the retransmission timeout in msec*/
+    inline double rto() const {
+        double rto = (srtt == 0) ? PULL_RTO_INITIAL : srtt + 4 * rttvar;
+        return (rto < PULL_RTO_MIN) ? PULL_RTO_MIN : rto;
+    }
+};
+
+/**@brief Our proposal the reassembly window of a fragmented publication (see FragmentHeader).
+ * The packet of the whole publication is allocated when the first fragment arrives and every fragment is copied to its offset.
+ */
+class Reassembly {
+public:
+    Reassembly() : packet(NULL) {}
+    ~Reassembly() {if (packet) packet->kill();}
+    uint32_t msg_id;
+    uint32_t total_len;
+    uint32_t received;
+    /**@brief the fragments already copied (duplicates are ignored)*/
+    Bitvector got;
+    WritablePacket *packet;
+};
+
+/**@brief Our proposal the fragments a CacheUnit asked for with PLEASE_PUSH_DATA: the next publication of the ID to that FID only sends these.
+ */
+class FragmentRequest {
+public:
+    uint32_t msg_id;
+    uint16_t count;
+    Bitvector wanted;
+};
+
+/**@brief Our proposal the digests of the last publications of an ID kept to drop their duplicates (DEDUP_WINDOW), per ID at most this many and for at most this many IDs.
+ */
+#define DEDUP_DEPTH 8
+#define DEDUP_MAX_IDS 4096
+
+/**@brief Our proposal the recent publications of an ID that arrived from the network: the digests (FNV-1a of the data and its length) of the last DEDUP_DEPTH of them and when they arrived.
+ * With flooding, kanycast, caches and multiple sources the same item can arrive over several paths; its copies within DEDUP_WINDOW are dropped before the local fan-out.
+ */
+class DedupWindow {
+public:
+    DedupWindow() : next(0) {}
+    uint64_t digest[DEDUP_DEPTH];
+    Timestamp when[DEDUP_DEPTH];
+    /**@brief the slot of the next digest (the oldest one once the window is full)*/
+    unsigned int next;
+    /**@brief when the last publication arrived*/
+    Timestamp last;
+};
+
 /**@brief (blackadder Core) The LocalProxy Element is the core element in a Blackadder Node.
  *
  * All Click packets received by the Core component are annotated with an application identifier by the FromNetlink Element.
@@ -61,7 +183,21 @@ public:
      */
     const char *processing() const {return PUSH;}
     /**
-     * @brief Element configuration. LocalProxy needs only a pointer to the GlovalConf Element so that it can read the Global Configuration.
+     * @brief Element configuration. LocalProxy needs a pointer to the GlovalConf Element so that it can read the Global Configuration.
+     * The optional FLOOD_TTL, FLOOD_TTL_MAX and FLOOD_RETRY (msec) keywords configure the expanding ring search of flooded subscriptions.
+     * The optional PROBE_AGGREGATE keyword (default false) sends a single SCOPE_PROBING_AGGREGATE to all subscribers of a scope instead of a SCOPE_PROBING_MESSAGE per subscriber (all nodes must support it).
+     * The optional MULTI_SOURCE keyword (default 1) retrieves the items of a subscribed scope from up to that many of the nearest sources (publishers and caches) that probed them, in parallel, each item from one of them.
+     * An item whose data has not arrived after SOURCE_TIMEOUT (msec, default 1000, 0 never falls back) is requested from its next source.
+     * The optional PULL_WINDOW keyword (default 0: every request is sent at once and never again) keeps at most that many item requests in flight to each source (see PullWindow),
+     * so that many items (e.g. the segments of a video) are pulled back to back at the rate of the path; a request is sent again up to PULL_RETRIES (default 3) times.
+     * The optional FLOOD_RATE and FLOOD_BURST keywords limit the floods this node originates (per second, 0 - the default - does not limit; burst 16) and HOST_FLOOD_RATE and HOST_FLOOD_BURST the scope subscriptions of every LocalHost, which are refused over the limit, so that a single application cannot flood the network.
+     * The optional MULTICAST_FILL keyword (percent, default 50) bounds the fill factor of the multicast FIDs messages to many remote subscribers are aggregated into (0 sends a copy per subscriber).
+     * The optional LOAD_WEIGHT keyword (default 1) weighs the load a cache reports in its probing response against the hops to it (0 selects the nearest source only).
+     * The optional LEASE_REFRESH keyword (in seconds, 0 - the default - disables it) sends a LEASE_REFRESH to every rendezvous node this node has state in, that often; it must be shorter than the LEASE of those LocalRVs.
+     * At the same period, applications that died without a DISCONNECT are found (at most LEASE_SWEEP_BATCH per period) and disconnected.
+     * The optional DEDUP_WINDOW keyword (msec, 0 - the default - disables it) drops a network publication whose data is the same as that of one of the last DEDUP_DEPTH publications of its ID that arrived at most that long ago (see DedupWindow),
+     * so that an item delivered over several paths reaches the local subscribers once. Publishers that publish the same data again on purpose need it off (or shorter than their period).
+     * The optional FRAGMENT keyword is the largest data (in bytes, including a FragmentHeader) a publication sent to the network may carry; larger publications are fragmented (0, the default, disables fragmentation).
      */
     int configure(Vector<String>&, ErrorHandler*);
     /**@brief This Element must be configured AFTER the GlobalConf Element
@@ -79,6 +215,15 @@ public:
      * If stage >= CLEANUP_ROUTER_INITIALIZED (i.e. the Element was initialized) LocalProxy will delete all stored ActivePublication, ActiveSubscription and LocalHost.
      */
     void cleanup(CleanupStage stage);
+    /**@brief Our proposal read handlers: floods_sent, floods_limited (by FLOOD_RATE), subscriptions_limited (by HOST_FLOOD_RATE), hosts_limited (a line per LocalHost with refused subscriptions),
+     * duplicates_suppressed and duplicate_bytes_suppressed (the publications and data bytes dropped by DEDUP_WINDOW),
+     * memory (the entries and approximate bytes of the indexes) and memory_scopes (the largest root scopes, see memoryReport).
+     */
+    void add_handlers();
+    static String read_handler(Element *e, void *thunk);
+    /**@brief Our proposal fills report with the state of the LocalProxy indexes (see MemReport): up to MEM_SAMPLE entries of each index are measured.
+     */
+    void memoryReport(MemReport &report);
     /**@brief This method is called by Click whenever a packet is pushed to the LocalProxy by some other Element.
      *
      * We distinct the following cases:
@@ -127,6 +272,7 @@ public:
      * @param type The type of the request. Can be one of the PUBLISH_SCOPE, PUBLISH_INFO, UNPUBLISH_SCOPE, UNPUBLISH_INFO, SUBSCRIBE_SCOPE, SUBSCRIBE_INFO, UNSUBSCRIBE_SCOPE and UNSUBSCRIBE_INFO.
      * @param _localhost A pointer to the LocalHost object
      * @param ID This identifier can either be a single fragment, identifying a scope or an information item in the context of the scope identified by prefixID, or a full identifier (e.g. when republishing scopes and information items).
+     * Our proposal ID and prefixID may point into the request packet, so only the fullID built from them may be stored.
      * @param prefixID The Identifier of the parent scope
      * @param strategy The assigned dissemination strategy.
      * @param RVFID The LIPSIN identifier to the rendezvous node. Note that it may be the internal link identifier (e.g. in a NODE_LOCAL strategy).
@@ -192,7 +338,8 @@ public:
      * Then it looks for any local subscribers by calling the findLocalSubscribers() method. Note that an ActivePublication may be known with multiple identifiers. That method looks for all of them.
      *
      * Finally, if necessary, it copies the packet and pushes it to all local subscribers and to the network using the stored FID.
-     * @param ID A reference to the full identifier of the published information item.
+     * Our proposal the ActivePublication and the local subscribers are kept in the PublicationCache of the publisher, so the next publish_data for the same ID skips both lookups until pubsub_epoch changes.
+     * @param ID A reference to the full identifier of the published information item. Our proposal it may point into the request packet (see push()), so it is used only to find the ActivePublication.
      * @param p A Click packet containing ONLY some headroom and the DATA to be published.
      * @param _localhost The LocalHost sent the request.
      */
@@ -296,6 +443,7 @@ public:
     /**@brief This method looks for ActiveSubscriptions for the provided bector of identifier.
      *
      * It looks in the ActiveSubscription index. For each identifier in the vector it looks in the index for this identifier as well as for the father identifier (i.e. without the last fragment).
+     * Our proposal both lookups are answered with one lookup of localFanOut.
      * For each ActiveSubscription, it stores all LocalHost subscribers in the provided LocalHostStringHashMap.
      *
      * @param IDs a reference to a vector of identifiers for which the LocalProxy will seek for an ActiveSubscription.
@@ -303,6 +451,16 @@ public:
      * @return true if at least a subscriber was found.
      */
     bool findLocalSubscribers(Vector<String> &IDs, LocalHostStringHashMap & _localSubscribers);
+    /**@brief Our proposal the LocalHosts subscribed to the information item ID or to its father scope, without duplicates.
+     *
+     * The list is resolved from the ActiveSubscription index the first time ID is looked up and then kept in local_fanout, so a publication costs one lookup.
+     * @param ID the full identifier of an information item. It may point into a packet; the table keeps its own copy.
+     */
+    const Vector<LocalHost *> &localFanOut(const String &ID);
+    /**@brief Our proposal forgets the resolved lists that depend on the ActiveSubscription fullID: the one of fullID itself and those of the items in it.
+     * It is called whenever the subscribers of an ActiveSubscription change.
+     */
+    void invalidateFanOut(const String &fullID);
     /**@brief It looks for local subscribers to father item of the one identified by the ID.
      *
      * @todo It should be renamed or something
@@ -321,22 +479,136 @@ public:
     /**@brief Our proposal
      * publishers sending the probing message
      */
-    void sendProbingMessage(Vector<String> IDs, HashTable<String, BABitvector> FID_to_each_sub, int noofpub) ;
+    void sendProbingMessage(Vector<String> IDs, const Vector<BABitvector> &FID_groups, int noofpub) ;
+    /**@brief Our proposal ORs the per subscriber FIDs into as few FIDs as possible, keeping each of them at most multicast_fill percent full
+     * (the false positive rate of a LIPSIN FID grows with its fill factor). If multicast_fill is 0 there is one FID per subscriber
+     */
+    void aggregateFIDs(HashTable<String, BABitvector> &FID_to_each_sub, Vector<BABitvector> &FID_groups) ;
     /**@brief Our proposal
      * process probing message
+     * The source is the response with the lowest probingCost
      */
     void handleProbingMessage(Vector<String>, Packet*, BABitvector) ;
+    /**@brief Our proposal the cost of a probing response: the hops plus load_weight times the reported load (in PROBING_LOAD_UNIT) and miss rate*/
+    double probingCost(unsigned char hop_count, const ProbingLoad &load) ;
+    /**@brief Our proposal the LOAD_WEIGHT*/
+    double load_weight ;
+    /**@brief Our proposal the MULTICAST_FILL*/
+    unsigned int multicast_fill ;
     /**@brief kanycast
      * notify publisher about a subscription of information under a scope*/
     void notifyPubScopeInfoSub(Vector<String>&, Packet*) ;
     /**@brief kanycast
      * publishers send scope probing messages to each sub
+     * Our proposal the message is built once: with PROBE_AGGREGATE a single one goes to the OR of the FIDs of the subscribers, otherwise it is copied for each
       */
     void sendScopeProbingMessage(Vector<String> IDs, HashTable<String, BABitvector> FID_to_each_sub,\
                                  HashTable<String, unsigned int> each_sub_hopcount) ;
     void handleScopeProbingMessage(Vector<String> IDs, Packet* p) ;
+    /**@brief Our proposal sends one SUB_SCOPE_MESSAGE per distinct FID of iid_FIDs, with a Bloom filter of the items to request over it*/
+    void sendScopeRequests(const String &ids_header, unsigned char numberOfIDs, const FIDBitvector &to_sub_FID, HashTable<String, BABitvector> &iid_FIDs) ;
+    /**@brief Our proposal MULTI_SOURCE: spreads the items of as over their nearest sources (each item goes to the one of its sources that was given the fewest items so far)
+     * and remembers the other sources in a SourceRetrieval, for the fallback*/
+    void assignSources(ActiveSubscription *as, Vector<String> &IDs, const String &ids_header, unsigned char numberOfIDs, const FIDBitvector &to_sub_FID,\
+                       HashTable<String, BABitvector> &iid_FIDs) ;
+    /**@brief Our proposal a publication for IDs arrived - its items are no longer missing from the parallel retrievals*/
+    void retrievalAnswered(Vector<String> &IDs) ;
+    /**@brief Our proposal asks the next sources for the items whose source missed the SOURCE_TIMEOUT*/
+    void retrySources() ;
+    /**@brief Our proposal PULL_WINDOW: queues the request p for the item ID to the source at the (reverse) FID and sends it if its window has room.
+     * A request for an item that is already requested is dropped (p is consumed in all cases)*/
+    void pullItem(const String &ID, const BABitvector &FID, Packet *p, int port) ;
+    /**@brief Our proposal sends the queued requests of the window w that fit in it*/
+    void fillWindow(PullWindow *w) ;
+    /**@brief Our proposal a publication for IDs arrived - its request leaves its window, which grows*/
+    void pullAnswered(Vector<String> &IDs) ;
+    /**@brief Our proposal sends again the requests that timed out (or gives them up after PULL_RETRIES) and shrinks their windows*/
+    void pullTimeouts() ;
 
-    void floodingReq(Vector<String> &SIDs, StringSet &IIDs, BABitvector iLIDs) ;
+    /**@brief kanycast floods a SUB_SCOPE_MESSAGE for the SIDs to all links.
+     * The request is stamped with this node's ID and the next flood_seq so that every Forwarder can drop duplicates.
+     * It travels at most ttl hops (FLOOD_TTL_UNLIMITED floods the whole network)*/
+    void floodingReq(Vector<String> &SIDs, StringSet &IIDs, BABitvector iLIDs, unsigned char ttl) ;
+    /**@brief kanycast starts the flooding of a subscription.
+     * If FLOOD_TTL is set the request is first flooded FLOOD_TTL hops away and, as long as nothing answers, again every FLOOD_RETRY with twice the radius.
+     * After FLOOD_TTL_MAX it is flooded to the whole network one last time*/
+    void startFlooding(Vector<String> &SIDs, StringSet &IIDs, BABitvector iLIDs) ;
+    /**@brief kanycast a publication for IDs arrived - stop the expanding ring search of the scopes it belongs to*/
+    void floodAnswered(Vector<String> &IDs) ;
+    /**@brief kanycast floods again the pending requests nobody answered, or renews the leases (see refreshLeases), or retries the parallel retrievals and the pulled items (see retrySources and pullTimeouts)*/
+    void run_timer(Timer *timer) ;
+    /**@brief Our proposal sends one LEASE_REFRESH to each distinct remote rendezvous node of the active publications and subscriptions,
+     * and disconnects up to LEASE_SWEEP_BATCH local applications that no longer exist (user-level only)*/
+    void refreshLeases() ;
+    /**@brief Our proposal splits p into fragments of at most fragment_size bytes of data (each starting with a FragmentHeader).
+     * If a FragmentRequest for key (ID and FID) matches the publication, only the requested fragments are made and the request is forgotten.
+     * @return false if p is small enough (it is then left untouched), otherwise p is killed and the fragments are appended to fragments*/
+    bool fragmentPublication(Packet *p, Vector<Packet *> &fragments, const String &key = String()) ;
+    /**@brief Our proposal records the fragment ranges appended to a PLEASE_PUSH_DATA (see FRAGMENT_RANGES_MAX) for key (ID and FID)*/
+    void storeFragmentRequest(const String &key, const unsigned char *ranges, unsigned int len) ;
+    /**@brief Our proposal reassembles fragmented network publications, in the window of the first of IDs.
+     * @return p if it is not a fragment, the whole publication once its last fragment has arrived, NULL otherwise (p is then consumed)*/
+    Packet *reassemblePublication(Vector<String> &IDs, Packet *p) ;
+    /**@brief Our proposal DEDUP_WINDOW: true if the data of p (a network publication of ID) arrived within the window already, otherwise its digest is remembered*/
+    bool duplicatePublication(const String &ID, Packet *p) ;
+    /**@brief Our proposal DEDUP_WINDOW in msec (0 disables it)*/
+    unsigned int dedup_window ;
+    /**@brief Our proposal the DedupWindow of every ID and the IDs in the order they got one (for the expiry, see duplicatePublication)*/
+    HashTable<String, DedupWindow *> dedup ;
+    Vector<String> dedup_order ;
+    int dedup_head ;
+    uint64_t duplicates_suppressed ;
+    uint64_t duplicate_bytes_suppressed ;
+    /**@brief Our proposal the FRAGMENT size (0 disables fragmentation)*/
+    unsigned int fragment_size ;
+    /**@brief Our proposal the pending FragmentRequests by ID and FID*/
+    HashTable<String, FragmentRequest *> fragment_requests ;
+    /**@brief Our proposal the reassembly windows (one per ID)*/
+    HashTable<String, Reassembly *> reassemblies ;
+    /**@brief the sequence number of the last flooded request*/
+    uint32_t flood_seq ;
+    /**@brief the initial hop limit of the expanding ring search (0 disables it)*/
+    unsigned int flood_ttl ;
+    /**@brief the largest hop limit of the expanding ring search*/
+    unsigned int flood_ttl_max ;
+    /**@brief the milliseconds to wait for an answer before flooding further*/
+    unsigned int flood_retry ;
+    /**@brief Our proposal PROBE_AGGREGATE*/
+    bool probe_aggregate ;
+    /**@brief Our proposal MULTI_SOURCE: the number of sources an item of a scope is retrieved from (1 keeps to the nearest one)*/
+    unsigned int multi_source ;
+    /**@brief Our proposal SOURCE_TIMEOUT: the milliseconds a source has to send an item before the next one is asked*/
+    unsigned int source_timeout ;
+    /**@brief Our proposal the parallel retrievals waiting for data*/
+    Vector<SourceRetrieval *> pending_retrievals ;
+    Timer retrieval_timer ;
+    /**@brief Our proposal PULL_WINDOW (0 disables the windows) and PULL_RETRIES*/
+    unsigned int pull_window ;
+    unsigned int pull_retries ;
+    /**@brief Our proposal the windows by reverse FID and their requests by item*/
+    HashTable<String, PullWindow *> pull_windows ;
+    HashTable<String, PullRequest *> pull_requests ;
+    Timer pull_timer ;
+    /**@brief the flooded requests waiting for an answer*/
+    Vector<FloodRequest *> pending_floods ;
+    /**@brief fires when the earliest pending request must be flooded again*/
+    Timer flood_timer ;
+    /**@brief Our proposal the storm protection: the limits of the floods of this node (node_bucket) and of the scope subscriptions of each LocalHost (LocalHost::flood_bucket)*/
+    uint32_t flood_rate ;
+    uint32_t flood_burst ;
+    uint32_t host_flood_rate ;
+    uint32_t host_flood_burst ;
+    FloodBucket node_bucket ;
+    /**@brief Our proposal the floods sent, dropped by node_bucket and the subscriptions refused by the bucket of their LocalHost*/
+    uint64_t floods_sent ;
+    uint64_t floods_limited ;
+    uint64_t subscriptions_limited ;
+    /**@brief Our proposal the LEASE_REFRESH period in seconds (0 disables it)*/
+    unsigned int lease_refresh ;
+    /**@brief Our proposal the local hosts the liveness check walks through and its position in them*/
+    Vector<int> sweep_hosts ;
+    int sweep_cursor ;
+    Timer lease_timer ;
     /**@brief A pointer to the GlobalConf Element so that LocalProxy can access the node's Global Configuration.
      */
     GlobalConf *gc;
@@ -351,6 +623,12 @@ public:
     /**@brief A HashTable that maps an ActiveSubscription identifier (full ID from a root of a graph) to a pointer of ActiveSubscription.
      */
     ActiveSub activeSubscriptionIndex;
+    /**@brief Our proposal changes whenever the pub/sub state changes, which invalidates the PublicationCache of every LocalHost*/
+    uint64_t pubsub_epoch;
+    /**@brief Our proposal the resolved local subscribers of information item IDs (see localFanOut) and, for every father scope, the IDs in local_fanout that it contributed to*/
+    HashTable<String, Vector<LocalHost *> > local_fanout;
+    HashTable<String, Vector<String> > fanout_children;
+    int fanout_links;
 };
 
 CLICK_ENDDECLS
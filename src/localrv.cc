@@ -12,10 +12,18 @@
  * See LICENSE and COPYING for more details.
  */
 #include "localrv.hh"
+#if CLICK_USERLEVEL
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 CLICK_DECLS
 
-LocalRV::LocalRV() {
+enum {H_HOSTS, H_EXPIRED, H_SNAPSHOT, H_MEMORY, H_MEMORY_SCOPES, H_TM_REPLICAS};
+
+LocalRV::LocalRV() : tm_batch_timer(this), lease_timer(this), snapshot_timer(this) {
 
 }
 
@@ -24,7 +32,30 @@ LocalRV::~LocalRV() {
 }
 
 int LocalRV::configure(Vector<String> &conf, ErrorHandler *errh) {
+    Vector<String> keywords;
     gc = (GlobalConf *) cp_element(conf[0], this);
+    /*the neighbours that follow the GlobalConf are not used here, keywords may be given anywhere after it*/
+    for (int i = 1; i < conf.size(); i++) {
+        if (conf[i].starts_with("TM_BATCH") || conf[i].starts_with("LEASE") || conf[i].starts_with("SWEEP_BATCH") || conf[i].starts_with("SNAPSHOT")) {
+            keywords.push_back(conf[i]);
+        }
+    }
+    tm_batch_window = 0;
+    lease = 0;
+    sweep_batch = LEASE_SWEEP_BATCH;
+    snapshot_interval = 60;
+    if (cp_va_kparse(keywords, this, errh,
+            "TM_BATCH", 0, cpSecondsAsMilli, &tm_batch_window,
+            "LEASE", 0, cpUnsigned, &lease,
+            "SWEEP_BATCH", 0, cpUnsigned, &sweep_batch,
+            "SNAPSHOT", 0, cpFilename, &snapshot_file,
+            "SNAPSHOT_INTERVAL", 0, cpUnsigned, &snapshot_interval,
+            cpEnd) < 0) {
+        return -1;
+    }
+    if (lease > 0 && sweep_batch == 0) {
+        return errh->error("SWEEP_BATCH must be positive");
+    }
     //click_chatter("LocalRV: configured!");
     return 0;
 }
@@ -35,7 +66,27 @@ int LocalRV::initialize(ErrorHandler *errh) {
     unsigned char id_len = PURSUIT_ID_LEN / PURSUIT_ID_LEN;
     unsigned char prefix_id_len = 0;
     WritablePacket *p = Packet::make(100);
+    /*restore the graph before any request is accepted*/
+    if (snapshot_file) {
+        loadSnapshot(errh);
+    }
     localProxy = getRemoteHost(gc->nodeID);
+    /*one batch per TM replica, a single one without TMREPLICAS*/
+    tm_batch.resize((gc->tmReplicaFIDs.size() > 0) ? gc->tmReplicaFIDs.size() : 1);
+    tm_batch_count.resize(tm_batch.size(), 0);
+    tm_replica_down.resize(tm_batch.size(), false);
+    tm_replica_requests.resize(tm_batch.size(), 0);
+    tm_batch_timer.initialize(this);
+    sweep_cursor = 0;
+    expired_hosts = 0;
+    lease_timer.initialize(this);
+    if (lease > 0) {
+        lease_timer.schedule_after_msec(lease * 250);
+    }
+    snapshot_timer.initialize(this);
+    if (snapshot_file && (snapshot_interval > 0)) {
+        snapshot_timer.schedule_after_msec(snapshot_interval * 1000);
+    }
     /*I will send a subscription (IMPLICIT_RENDEZVOUS) to the localproxy during my initialization*/
     memcpy(p->data(), &type, sizeof (type));
     memcpy(p->data() + sizeof (type), &id_len, sizeof (id_len));
@@ -49,6 +100,9 @@ int LocalRV::initialize(ErrorHandler *errh) {
 
 void LocalRV::cleanup(CleanupStage stage) {
     int size;
+    if (snapshot_file && (stage >= CLEANUP_ROUTER_INITIALIZED)) {
+        writeSnapshot();
+    }
     size = pub_sub_Index.size();
     RemoteHostHashMapIter it1 = pub_sub_Index.begin();
     for (int i = 0; i < size; i++) {
@@ -70,6 +124,127 @@ void LocalRV::cleanup(CleanupStage stage) {
     click_chatter("LocalRV: Cleaned Up!");
 }
 
+String LocalRV::read_handler(Element *e, void *thunk) {
+    LocalRV *rv = (LocalRV *) e;
+    switch ((intptr_t) thunk) {
+        case H_HOSTS:
+            return String(rv->pub_sub_Index.size());
+        case H_EXPIRED:
+            return String(rv->expired_hosts);
+        case H_MEMORY:
+        case H_MEMORY_SCOPES:
+        {
+            MemReport report;
+            rv->memoryReport(report);
+            return ((intptr_t) thunk == H_MEMORY) ? report.totals() : report.scopes();
+        }
+        case H_TM_REPLICAS:
+        {
+            StringAccum sa;
+            for (int i = 0; i < rv->gc->tmReplicaIDs.size(); i++) {
+                sa << rv->gc->tmReplicaIDs[i] << ' ' << (rv->tm_replica_down[i] ? "down" : "up") << ' ' << rv->tm_replica_requests[i] << '\n';
+            }
+            return sa.take_string();
+        }
+        default:
+            return String();
+    }
+}
+
+void LocalRV::memoryReport(MemReport &report) {
+    /*a Scope (or InformationItem) is shared by all its identifiers, so each identifier accounts for its share of it*/
+    report.begin("scopes", scopeIndex.size());
+    for (ScopeHashMapIter it = scopeIndex.begin(); it != scopeIndex.end(); it++) {
+        Scope *sc = it.value();
+        size_t bytes = sizeof(Scope) + sc->ids.size() * mem_entry<IDHandle, RemoteHostPair *>() + sc->fatherScopes.size() * mem_set_entry<ScopeSetItem>()\
+                + sc->childrenScopes.size() * mem_set_entry<ScopeSetItem>() + sc->informationitems.size() * mem_set_entry<InformationItemSetItem>();
+        bytes = bytes / (sc->ids.size() > 0 ? sc->ids.size() : 1) + mem_entry<IDHandle, Scope *>();
+        RemoteHostPair *pair = sc->ids.get(it.handle());
+        if (pair != NULL) {
+            bytes += sizeof(RemoteHostPair) + pair->first.bytes() + pair->second.bytes();
+        }
+        if (!report.sample(it.key(), bytes)) {
+            break;
+        }
+    }
+    report.end();
+    report.begin("items", pubIndex.size());
+    for (IIHashMapIter it = pubIndex.begin(); it != pubIndex.end(); it++) {
+        InformationItem *ii = it.value();
+        size_t bytes = sizeof(InformationItem) + ii->ids.size() * mem_entry<IDHandle, RemoteHostPair *>() + ii->fatherScopes.size() * mem_set_entry<ScopeSetItem>()\
+                + ii->effectiveSubscribers.size() * mem_entry<RemoteHost *, unsigned int>();
+        bytes = bytes / (ii->ids.size() > 0 ? ii->ids.size() : 1) + mem_entry<IDHandle, InformationItem *>();
+        RemoteHostPair *pair = ii->ids.get(it.handle());
+        if (pair != NULL) {
+            bytes += sizeof(RemoteHostPair) + pair->first.bytes() + pair->second.bytes();
+        }
+        if (!report.sample(it.key(), bytes)) {
+            break;
+        }
+    }
+    report.end();
+    /*the identifiers a node published or subscribed to are spread over many scopes, so the nodes are not counted under any of them*/
+    report.begin("hosts", pub_sub_Index.size());
+    for (RemoteHostHashMapIter it = pub_sub_Index.begin(); it != pub_sub_Index.end(); it++) {
+        RemoteHost *host = it.value();
+        size_t bytes = sizeof(RemoteHost) + mem_entry<String, RemoteHost *>() + mem_string(it.key()) + mem_string(host->remoteHostID);
+        StringSet *sets[4] = {&host->publishedScopes, &host->publishedInformationItems, &host->subscribedScopes, &host->subscribedInformationItems};
+        for (int i = 0; i < 4; i++) {
+            /*the lengths of the first identifiers of a set stand for all of them*/
+            size_t length = 0;
+            int measured = 0;
+            for (StringSetIter set_it = sets[i]->begin(); set_it != sets[i]->end() && measured < 16; set_it++, measured++) {
+                length += (*set_it)._strData.length();
+            }
+            bytes += sets[i]->size() * mem_set_entry<StringSetItem>() + (measured > 0 ? length * sets[i]->size() / measured : 0);
+        }
+        if (!report.sample(String(), bytes)) {
+            break;
+        }
+    }
+    report.end();
+    report.exact("identifiers", IDTable::node().size(), IDTable::node().bytes());
+}
+
+int LocalRV::write_handler(const String &str, Element *e, void *thunk, ErrorHandler *errh) {
+    LocalRV *rv = (LocalRV *) e;
+    switch ((intptr_t) thunk) {
+        case H_SNAPSHOT:
+            if (!rv->snapshot_file) {
+                return errh->error("no SNAPSHOT file configured");
+            }
+            return rv->writeSnapshot() ? 0 : errh->error("could not write %s", rv->snapshot_file.c_str());
+        case H_TM_REPLICAS:
+        {
+            Vector<String> words;
+            cp_spacevec(str, words);
+            if ((words.size() != 2) || ((words[1] != "up") && (words[1] != "down"))) {
+                return errh->error("expected NODEID up|down");
+            }
+            for (int i = 0; i < rv->gc->tmReplicaIDs.size(); i++) {
+                if (rv->gc->tmReplicaIDs[i] == words[0]) {
+                    rv->tm_replica_down[i] = (words[1] == "down");
+                    click_chatter("LocalRV: TM replica %s is %s", words[0].c_str(), words[1].c_str());
+                    return 0;
+                }
+            }
+            return errh->error("%s is not a TM replica (TMREPLICAS)", words[0].c_str());
+        }
+        default:
+            return -1;
+    }
+}
+
+void LocalRV::add_handlers() {
+    add_read_handler("hosts", read_handler, (void *) H_HOSTS);
+    add_read_handler("expired", read_handler, (void *) H_EXPIRED);
+    add_write_handler("snapshot", write_handler, (void *) H_SNAPSHOT);
+    add_read_handler("memory", read_handler, (void *) H_MEMORY);
+    add_read_handler("memory_scopes", read_handler, (void *) H_MEMORY_SCOPES);
+    add_read_handler("tm_replicas", read_handler, (void *) H_TM_REPLICAS);
+    add_write_handler("tm_replicas", write_handler, (void *) H_TM_REPLICAS);
+}
+
 void LocalRV::push(int in_port, Packet * p) {
     RemoteHost *_remotehost;
     unsigned int result;
@@ -91,7 +266,18 @@ void LocalRV::push(int in_port, Packet * p) {
             prefixIDLength = *(p->data() + sizeof (typeOfAPIEvent) + sizeof (IDLengthOfAPIEvent) + IDLengthOfAPIEvent * PURSUIT_ID_LEN + sizeof (type) + sizeof (IDLength) + ID.length());
             prefixID = String((const char *) (p->data() + sizeof (typeOfAPIEvent) + sizeof (IDLengthOfAPIEvent) + IDLengthOfAPIEvent * PURSUIT_ID_LEN + sizeof (type) + sizeof (IDLength) + ID.length() + sizeof (prefixIDLength)), prefixIDLength * PURSUIT_ID_LEN);
             strategy = *(p->data() + sizeof (typeOfAPIEvent) + sizeof (IDLengthOfAPIEvent) + IDLengthOfAPIEvent * PURSUIT_ID_LEN + sizeof (type) + sizeof (IDLength) + ID.length() + sizeof (prefixIDLength) + prefixID.length());
+            if (type == LEASE_REFRESH) {
+                /*renew the lease, but do not create state for a node that has none*/
+                _remotehost = pub_sub_Index.get(nodeID);
+                if (_remotehost != pub_sub_Index.default_value()) {
+                    _remotehost->last_refresh = Timestamp::now();
+                }
+                p->kill();
+                return;
+            }
             _remotehost = getRemoteHost(nodeID);
+            /*any request renews the lease of the node*/
+            _remotehost->last_refresh = Timestamp::now();
             switch (type) {
                 case PUBLISH_SCOPE:
                     click_chatter("LocalRV: received publish_scope request: %s, %s, %s, %d", _remotehost->remoteHostID.c_str(), ID.quoted_hex().c_str(), prefixID.quoted_hex().c_str(), (int) strategy);
@@ -276,7 +462,7 @@ unsigned int LocalRV::republish_inner_scope(RemoteHost *_publisher, String &ID,
                     if (fatherScope->strategy == strategy) {
                         existingScope->fatherScopes.find_insert(ScopeSetItem(fatherScope));
                         fatherScope->childrenScopes.find_insert(ScopeSetItem(existingScope));
-                        existingScope->recursivelyUpdateIDs(scopeIndex, pubIndex, suffixID);
+                        graftScope(existingScope, ID, fatherScope, suffixID);
                         if (existingScope->updatePublishers(fullID, _publisher)) {
                             /*add the scope to the publisher's set*/
                             _publisher->publishedScopes.find_insert(StringSetItem(fullID));
@@ -327,6 +513,33 @@ unsigned int LocalRV::republish_inner_scope(RemoteHost *_publisher, String &ID,
     return ret;
 }
 
+void LocalRV::graftScope(Scope *sc, const String &existingID, Scope *fatherScope, const String &suffixID) {
+    Vector<Pair<String, Scope *> > subscopes;
+    Vector<Pair<String, InformationItem *> > subitems;
+    /*everything under existingID, with identifiers relative to it (sc itself has an empty suffix)*/
+    scopeIndex.subtree(existingID, subscopes);
+    pubIndex.subtree(existingID, subitems);
+    for (IdsHashMapIter it = fatherScope->ids.begin(); it != fatherScope->ids.end(); it++) {
+        String newID = (*it).first + suffixID;
+        for (int i = 0; i < subscopes.size(); i++) {
+            String fullID = newID + subscopes[i].first;
+            Scope *subscope = subscopes[i].second;
+            if (subscope->ids.get(fullID) == subscope->ids.default_value()) {
+                scopeIndex.set(fullID, subscope);
+                subscope->ids.set(fullID, new RemoteHostPair());
+            }
+        }
+        for (int i = 0; i < subitems.size(); i++) {
+            String fullID = newID + subitems[i].first;
+            InformationItem *subitem = subitems[i].second;
+            if (subitem->ids.get(fullID) == subitem->ids.default_value()) {
+                pubIndex.set(fullID, subitem);
+                subitem->ids.set(fullID, new RemoteHostPair());
+            }
+        }
+    }
+}
+
 unsigned int LocalRV::publish_info(RemoteHost *_publisher, String &ID, String &prefixID, unsigned char &strategy) {
     unsigned int ret;
     if ((prefixID.length() > 0) && (ID.length() == PURSUIT_ID_LEN)) {
@@ -361,8 +574,7 @@ unsigned int LocalRV::advertise_info(RemoteHost *_publisher, String &ID, String
                         _publisher->publishedInformationItems.find_insert(StringSetItem(fullID));
                         click_chatter("LocalRV: added publisher %s to (new) InformationItem: %s(%d)", _publisher->remoteHostID.c_str(), pub->printID().c_str(), (int) strategy);
                         RemoteHostSet subscribers;
-                        pub->getSubscribers(subscribers);
-                        fatherScope->getSubscribers(subscribers);
+                        pub->getEffectiveSubscribers(subscribers);
                         rendezvous(pub, subscribers);
                         ret = SUCCESS;
                     } else {
@@ -383,11 +595,7 @@ unsigned int LocalRV::advertise_info(RemoteHost *_publisher, String &ID, String
                     _publisher->publishedInformationItems.find_insert(StringSetItem(fullID));
                     click_chatter("LocalRV: added publisher %s to InformationItem: %s(%d)", _publisher->remoteHostID.c_str(), pub->printID().c_str(), (int) strategy);
                     RemoteHostSet subscribers;
-                    pub->getSubscribers(subscribers);
-                    /*careful here...this pub MAY have multiple fathers*/
-                    for (ScopeSetIter fathersc_it = pub->fatherScopes.begin(); fathersc_it != pub->fatherScopes.end(); fathersc_it++) {
-                        (*fathersc_it)._scpointer->getSubscribers(subscribers);
-                    }
+                    pub->getEffectiveSubscribers(subscribers);
                     rendezvous(pub, subscribers);
                     ret = SUCCESS;
                 } else {
@@ -427,6 +635,7 @@ unsigned int LocalRV::readvertise_info(RemoteHost *_publisher, String &ID, Strin
                 if (equivalentPub == pubIndex.default_value()) {
                     if (fatherScope->strategy == strategy) {
                         existingPub->fatherScopes.find_insert(ScopeSetItem(fatherScope));
+                        existingPub->addFatherSubscribers(fatherScope);
                         fatherScope->informationitems.find_insert(InformationItemSetItem(existingPub));
                         existingPub->updateIDs(pubIndex, suffixID);
                         if (existingPub->updatePublishers(fullID, _publisher)) {
@@ -434,11 +643,7 @@ unsigned int LocalRV::readvertise_info(RemoteHost *_publisher, String &ID, Strin
                             _publisher->publishedInformationItems.find_insert(StringSetItem(fullID));
                             click_chatter("LocalRV: added publisher %s to readvertised InformationItem %s under path %s (%d)", _publisher->remoteHostID.c_str(), existingPub->printID().c_str(), fatherScope->printID().c_str(), (int) strategy);
                             RemoteHostSet subscribers;
-                            existingPub->getSubscribers(subscribers);
-                            /*careful here...I have multiple fathers*/
-                            for (ScopeSetIter fathersc_it = existingPub->fatherScopes.begin(); fathersc_it != existingPub->fatherScopes.end(); fathersc_it++) {
-                                (*fathersc_it)._scpointer->getSubscribers(subscribers);
-                            }
+                            existingPub->getEffectiveSubscribers(subscribers);
                             rendezvous(existingPub, subscribers);
                             ret = SUCCESS;
                         } else {
@@ -455,11 +660,7 @@ unsigned int LocalRV::readvertise_info(RemoteHost *_publisher, String &ID, Strin
                             _publisher->publishedInformationItems.find_insert(StringSetItem(fullID));
                             click_chatter("LocalRV: added publisher %s to InformationItem: %s(%d)", _publisher->remoteHostID.c_str(), equivalentPub->printID().c_str(), (int) strategy);
                             RemoteHostSet subscribers;
-                            equivalentPub->getSubscribers(subscribers);
-                            /*careful here...I have multiple fathers*/
-                            for (ScopeSetIter fathersc_it = equivalentPub->fatherScopes.begin(); fathersc_it != equivalentPub->fatherScopes.end(); fathersc_it++) {
-                                (*fathersc_it)._scpointer->getSubscribers(subscribers);
-                            }
+                            equivalentPub->getEffectiveSubscribers(subscribers);
                             rendezvous(equivalentPub, subscribers);
                             ret = SUCCESS;
                         } else {
@@ -652,11 +853,7 @@ unsigned int LocalRV::unpublish_info(RemoteHost *_publisher, String &ID, String
                         click_chatter("LocalRV: deleted publisher %s from InformationItem %s(%d)", _publisher->remoteHostID.c_str(), pub->printID().c_str(), (int) strategy);
                         /*do the rendezvous again*/
                         RemoteHostSet subscribers;
-                        pub->getSubscribers(subscribers);
-                        /*careful here...I have multiple fathers*/
-                        for (ScopeSetIter fathersc_it = pub->fatherScopes.begin(); fathersc_it != pub->fatherScopes.end(); fathersc_it++) {
-                            (*fathersc_it)._scpointer->getSubscribers(subscribers);
-                        }
+                        pub->getEffectiveSubscribers(subscribers);
                         rendezvous(pub, subscribers);
                     }
                 } else {
@@ -664,6 +861,7 @@ unsigned int LocalRV::unpublish_info(RemoteHost *_publisher, String &ID, String
                         /*safe to delete InformationItem*/
                         fatherScope->informationitems.erase(pub);
                         pub->fatherScopes.erase(fatherScope);
+                        pub->removeFatherSubscribers(fatherScope);
                         click_chatter("LocalRV: deleted publisher %s from (deleted) InformationItem branch %s(%d)", _publisher->remoteHostID.c_str(), fullID.quoted_hex().c_str(), (int) strategy);
                         /*delete all IDs from pubIndex*/
                         String suffixID = (*pub->ids.begin()).first.substring((*pub->ids.begin()).first.length() - PURSUIT_ID_LEN, PURSUIT_ID_LEN);
@@ -678,11 +876,7 @@ unsigned int LocalRV::unpublish_info(RemoteHost *_publisher, String &ID, String
                     }
                     /*do the rendezvous again*/
                     RemoteHostSet subscribers;
-                    pub->getSubscribers(subscribers);
-                    /*careful here...I have multiple fathers*/
-                    for (ScopeSetIter fathersc_it = pub->fatherScopes.begin(); fathersc_it != pub->fatherScopes.end(); fathersc_it++) {
-                        (*fathersc_it)._scpointer->getSubscribers(subscribers);
-                    }
+                    pub->getEffectiveSubscribers(subscribers);
                     rendezvous(pub, subscribers);
                     /********************************************/
                 }
@@ -761,10 +955,7 @@ unsigned int LocalRV::subscribe_root_scope(RemoteHost *_subscriber, String &ID,
                     IIDs.find_insert((*pub_it)._iipointer->ids.begin()->first.substring((*pub_it)._iipointer->ids.begin()->first.length()-\
                                                                        PURSUIT_ID_LEN, PURSUIT_ID_LEN)) ;
                     (*pub_it)._iipointer->getPublishers(temppub) ;
-                    for(RemoteHostSetIter pubiter = temppub.begin() ; pubiter != temppub.end() ; pubiter++)
-                    {
-                        publishers.find_insert(*pubiter) ;
-                    }
+                    publishers.unite(temppub) ;
                 }
                 StringSet SIDs ;
                 //Since it's root scope, there aren't any father scopes
@@ -882,10 +1073,7 @@ unsigned int LocalRV::subscribe_inner_scope(RemoteHost *_subscriber, String &ID,
                             IIDs.find_insert((*pub_it)._iipointer->ids.begin()->first.substring((*pub_it)._iipointer->ids.begin()->first.length()-\
                                                                                PURSUIT_ID_LEN, PURSUIT_ID_LEN)) ;
                             (*pub_it)._iipointer->getPublishers(temppub) ;
-                            for(RemoteHostSetIter pubiter = temppub.begin() ; pubiter != temppub.end() ; pubiter++)
-                            {
-                                publishers.find_insert(*pubiter) ;
-                            }
+                            publishers.unite(temppub) ;
                         }
                         StringSet SIDs ;
                         //get all the SIDs that represent this scope
@@ -981,15 +1169,12 @@ unsigned int LocalRV::subscribe_info(RemoteHost *_subscriber, String &ID, String
                     if (pub->updateSubscribers(fullID, _subscriber)) {
                         /*add the scope to the publisher's set*/
                         _subscriber->subscribedInformationItems.find_insert(StringSetItem(fullID));
-                        /*do the rendez-vous process*/
-                        RemoteHostSet subscribers;
-                        pub->getSubscribers(subscribers);
-                        /*careful here...I have multiple fathers*/
-                        ScopeSetIter fathersc_it;
-                        for (fathersc_it = pub->fatherScopes.begin(); fathersc_it != pub->fatherScopes.end(); fathersc_it++) {
-                            (*fathersc_it)._scpointer->getSubscribers(subscribers);
+                        /*do the rendez-vous process (not if the subscriber was already an effective subscriber through a father scope and nothing changed since the last one)*/
+                        if (pub->effectiveSubscribersChanged) {
+                            RemoteHostSet subscribers;
+                            pub->getEffectiveSubscribers(subscribers);
+                            rendezvous(pub, subscribers);
                         }
-                        rendezvous(pub, subscribers);
                         click_chatter("LocalRV: added subscriber %s to information item %s(%d)", _subscriber->remoteHostID.c_str(), pub->printID().c_str(), (int) strategy);
                         ret = SUCCESS;
                     } else {
@@ -1024,7 +1209,7 @@ unsigned int LocalRV::unsubscribe_scope(RemoteHost *_subscriber, String &ID, Str
                 RemoteHostPair * pair = sc->ids.get(fullID);
                 /*erase _subscriber (if it exists) (second in the pair) from the appropriate ID pair*/
                 if (pair->second.find(_subscriber) != pair->second.end()) {
-                    pair->second.erase(_subscriber);
+                    sc->removeSubscriber(fullID, _subscriber);
                     _subscriber->subscribedScopes.erase(fullID);
                     /*find all pieces of info that are affected by this and do the rendez-vous*/
                     InformationItemSet _informationitems;
@@ -1032,11 +1217,7 @@ unsigned int LocalRV::unsubscribe_scope(RemoteHost *_subscriber, String &ID, Str
                     /*then, for each one do the rendez-vous process*/
                     for (InformationItemSetIter pub_it = _informationitems.begin(); pub_it != _informationitems.end(); pub_it++) {
                         RemoteHostSet subscribers;
-                        (*pub_it)._iipointer->getSubscribers(subscribers);
-                        /*careful here...I have multiple fathers*/
-                        for (ScopeSetIter fathersc_it = (*pub_it)._iipointer->fatherScopes.begin(); fathersc_it != (*pub_it)._iipointer->fatherScopes.end(); fathersc_it++) {
-                            (*fathersc_it)._scpointer->getSubscribers(subscribers);
-                        }
+                        (*pub_it)._iipointer->getEffectiveSubscribers(subscribers);
                         //rendezvous((*pub_it)._iipointer, subscribers);
                     }
                     /*do not try to delete if there are subscopes or InformationItems under the scope*/
@@ -1104,7 +1285,7 @@ unsigned int LocalRV::unsubscribe_scope(RemoteHost *_subscriber, String &ID, Str
                 RemoteHostPair * pair = sc->ids.get(fullID);
                 /*erase _subscriber (if it exists) (second in the pair) from the appropriate ID pair*/
                 if (pair->second.find(_subscriber) != pair->second.end()) {
-                    pair->second.erase(_subscriber);
+                    sc->removeSubscriber(fullID, _subscriber);
                     _subscriber->subscribedScopes.erase(fullID);
                     /*find all pieces of info that are affected by this and do the rendez-vous process*/
                     InformationItemSet _informationitems;
@@ -1112,12 +1293,7 @@ unsigned int LocalRV::unsubscribe_scope(RemoteHost *_subscriber, String &ID, Str
                     /*then, for each one do the rendez-vous process*/
                     for (InformationItemSetIter pub_it = _informationitems.begin(); pub_it != _informationitems.end(); pub_it++) {
                         RemoteHostSet subscribers;
-                        (*pub_it)._iipointer->getSubscribers(subscribers);
-                        /*careful here...I have multiple fathers*/
-                        ScopeSetIter fathersc_it;
-                        for (fathersc_it = (*pub_it)._iipointer->fatherScopes.begin(); fathersc_it != (*pub_it)._iipointer->fatherScopes.end(); fathersc_it++) {
-                            (*fathersc_it)._scpointer->getSubscribers(subscribers);
-                        }
+                        (*pub_it)._iipointer->getEffectiveSubscribers(subscribers);
                         //rendezvous(pub_it.get()->_iipointer, subscribers);
                     }
                     /*do not try to delete after unsubscribing if there are subscopes or informationitems under the scope*/
@@ -1164,17 +1340,14 @@ unsigned int LocalRV::unsubscribe_info(RemoteHost *_subscriber, String &ID, Stri
             RemoteHostPair * pair = pub->ids.get(fullID);
             /*erase _subscriber (if it exists) (second in the pair) from the appropriate ID pair*/
             if (pair->second.find(_subscriber) != pair->second.end()) {
-                pair->second.erase(_subscriber);
+                pub->removeSubscriber(fullID, _subscriber);
                 _subscriber->subscribedInformationItems.erase(fullID);
-                /*do the rendez-vous if there are any left publishers and subscribers*/
-                RemoteHostSet subscribers;
-                pub->getSubscribers(subscribers);
-                /*careful here...I have multiple fathers*/
-                ScopeSetIter fathersc_it;
-                for (fathersc_it = pub->fatherScopes.begin(); fathersc_it != pub->fatherScopes.end(); fathersc_it++) {
-                    (*fathersc_it)._scpointer->getSubscribers(subscribers);
+                /*do the rendez-vous if there are any left publishers and subscribers (not if the subscriber is still subscribed through a father scope and nothing changed since the last one)*/
+                if (pub->effectiveSubscribersChanged) {
+                    RemoteHostSet subscribers;
+                    pub->getEffectiveSubscribers(subscribers);
+                    rendezvous(pub, subscribers);
                 }
-                rendezvous(pub, subscribers);
                 /*different approach is followed depending on the number of father scopes (NOT on the number of IDS)*/
                 if (pub->fatherScopes.size() == 1) {
                     if (!pub->checkForOtherPubSub(fatherScope)) {
@@ -1194,6 +1367,7 @@ unsigned int LocalRV::unsubscribe_info(RemoteHost *_subscriber, String &ID, Stri
                         /*safe to delete InformationItem*/
                         fatherScope->informationitems.erase(pub);
                         pub->fatherScopes.erase(fatherScope);
+                        pub->removeFatherSubscribers(fatherScope);
                         click_chatter("LocalRV: deleted subscriber %s from (deleted) information item branch %s(%d)", _subscriber->remoteHostID.c_str(), fullID.quoted_hex().c_str(), (int) strategy);
                         /*delete all IDs from pubIndex*/
                         String suffixID = (*pub->ids.begin()).first.substring((*pub->ids.begin()).first.length() - PURSUIT_ID_LEN, PURSUIT_ID_LEN);
@@ -1284,8 +1458,7 @@ void LocalRV::requestTMAssistanceForRendezvous(InformationItem *pub, RemoteHostS
         memcpy(p->data() + sizeof (typeForAPI) + sizeof (IDLenForAPI) + gc->nodeTMScope.length() + sizeof (strategy) + FID_LEN + sizeof (request_type) + sizeof (pub->strategy) + sizeof (no_publishers) + publisher_index + sizeof (no_subscribers) + subscriber_index + sizeof (no_ids) + ids_index + sizeof (IDLength), (*iter).first.c_str(), (*iter).first.length());
         ids_index += sizeof (IDLength) + (*iter).first.length();
     }
-    p->set_anno_u32(0, RV_ELEMENT);
-    output(0).push(p);
+    sendTMRequest(p, tmKey(IDs));
 }
 
 void LocalRV::kanycast_askTMforRendezvous(RemoteHostSet& _publishers, RemoteHostSet& _subscribers, StringSet& SIDs, unsigned char _strategy)
@@ -1364,8 +1537,7 @@ void LocalRV::kanycast_askTMforRendezvous(RemoteHostSet& _publishers, RemoteHost
                sizeof (no_ids) + ids_index + sizeof (IDLength), (*iter)._strData.c_str(), (*iter)._strData.length());
         ids_index += sizeof (IDLength) + (*iter)._strData.length();
     }
-    p->set_anno_u32(0, RV_ELEMENT);
-    output(0).push(p);
+    sendTMRequest(p, tmKey(SIDs));
 }
 
 void LocalRV::requestTMAssistanceForNotifyingSubscribers(unsigned char request_type, StringSet &IDs, RemoteHostSet &_subscribers, unsigned char strategy) {
@@ -1413,8 +1585,7 @@ void LocalRV::requestTMAssistanceForNotifyingSubscribers(unsigned char request_t
         memcpy(p->data() + sizeof (typeForAPI) + sizeof (IDLenForAPI) + gc->nodeTMScope.length() + sizeof (strategyAPI) + FID_LEN + sizeof (request_type) + sizeof (strategy) + sizeof (no_subscribers) + subscriber_index + sizeof (no_ids) + ids_index + sizeof (IDLength), (*iter)._strData.c_str(), (*iter)._strData.length());
         ids_index += sizeof (IDLength) + (*iter)._strData.length();
     }
-    p->set_anno_u32(0, RV_ELEMENT);
-    output(0).push(p);
+    sendTMRequest(p, tmKey(IDs));
 }
 
 void LocalRV::kanycast_askTMforNotifySub(unsigned char request_type, StringSet& IIDs, unsigned char strategy,\
@@ -1527,14 +1698,14 @@ void LocalRV::kanycast_askTMforNotifySub(unsigned char request_type, StringSet&
             sizeof(no_publishers)+ publisher_index+sizeof (no_subscribers) + subscriber_index +\
             sizeof (no_sids) + sids_index+\
             sizeof(no_iids)+iids_index, &noofpub, sizeof(noofpub)) ;
-    p->set_anno_u32(0, RV_ELEMENT);
-    output(0).push(p);
+    sendTMRequest(p, tmKey(SIDs));
 }
 
 
 void LocalRV::rendezvous(InformationItem *pub, RemoteHostSet &_subscribers) {
     //click_chatter("rendezvous");
     RemoteHostSet _publishers;
+    pub->effectiveSubscribersChanged = false;
     pub->getPublishers(_publishers);
     /*I have a publication..it can have zero, one or many publishers..(check all ids)*/
     if (_publishers.size() > 0) {
@@ -1563,6 +1734,208 @@ void LocalRV::kanycast_rendezvous(RemoteHostSet& pub, RemoteHostSet& sub, String
     }
 }
 
+/*our proposal the identifier a TM replica is chosen by: the smallest one, so that the requests of an item go to the same replica whatever the order of its identifiers*/
+String LocalRV::tmKey(IdsHashMap &IDs) {
+    String key;
+    for (IdsHashMapIter iter = IDs.begin(); iter != IDs.end(); iter++) {
+        String ID = iter.key();
+        if (!key || (ID < key)) {
+            key = ID;
+        }
+    }
+    return key;
+}
+
+String LocalRV::tmKey(StringSet &IDs) {
+    String key;
+    for (StringSetIter iter = IDs.begin(); iter != IDs.end(); iter++) {
+        if (!key || ((*iter)._strData < key)) {
+            key = (*iter)._strData;
+        }
+    }
+    return key;
+}
+
+int LocalRV::tmReplica(const String &key) {
+    if (gc->tmReplicaFIDs.size() == 0) {
+        return 0;
+    }
+    int replica = gc->tmReplica(key, tm_replica_down);
+    if (replica < 0) {
+        /*all replicas are down: better ask one of them than none*/
+        Vector<bool> none(tm_replica_down.size(), false);
+        replica = gc->tmReplica(key, none);
+    }
+    return replica;
+}
+
+void LocalRV::sendTMRequest(WritablePacket *p, const String &key) {
+    int header_len = sizeof (unsigned char) /*typeForAPI*/ + sizeof (unsigned char) /*IDLenForAPI*/ + gc->nodeTMScope.length() + sizeof (unsigned char) /*strategy*/ + FID_LEN;
+    uint16_t request_len = p->length() - header_len;
+    int replica = tmReplica(key);
+    tm_replica_requests[replica]++;
+    if (tm_batch_window == 0) {
+        /*the request was built with TMFID*/
+        memcpy(p->data() + header_len - FID_LEN, tmFID(replica)._data, FID_LEN);
+        p->set_anno_u32(0, RV_ELEMENT);
+        output(0).push(p);
+        return;
+    }
+    if ((tm_batch_count[replica] > 0) && ((tm_batch[replica].length() + sizeof (request_len) + request_len > TM_BATCH_MAX_BYTES) || (tm_batch_count[replica] == 0xFFFF))) {
+        flushTMRequests(replica);
+    }
+    tm_batch[replica].append((const char *) &request_len, sizeof (request_len));
+    tm_batch[replica].append((const char *) p->data() + header_len, request_len);
+    tm_batch_count[replica]++;
+    p->kill();
+    if (!tm_batch_timer.scheduled()) {
+        tm_batch_timer.schedule_after_msec(tm_batch_window);
+    }
+}
+
+void LocalRV::flushTMRequests(int replica) {
+    WritablePacket *p;
+    int packet_len;
+    /********FOR THE API*********/
+    unsigned char typeForAPI = PUBLISH_DATA;
+    unsigned char IDLenForAPI = 2 * PURSUIT_ID_LEN / PURSUIT_ID_LEN;
+    unsigned char strategy = IMPLICIT_RENDEZVOUS;
+    /****************************/
+    unsigned char request_type = BATCHED_REQUESTS;
+    int header_len = sizeof (typeForAPI) + sizeof (IDLenForAPI) + gc->nodeTMScope.length() + sizeof (strategy) + FID_LEN;
+    StringAccum &batch = tm_batch[replica];
+    uint16_t count = tm_batch_count[replica];
+    if (count == 0) {
+        return;
+    }
+    if (count == 1) {
+        /*a single request is sent as it is*/
+        packet_len = header_len + batch.length() - sizeof (uint16_t);
+    } else {
+        packet_len = header_len + sizeof (request_type) + sizeof (strategy) + sizeof (count) + batch.length();
+    }
+    p = Packet::make(50, NULL, packet_len, 0);
+    /*For the API*/
+    memcpy(p->data(), &typeForAPI, sizeof (typeForAPI));
+    memcpy(p->data() + sizeof (typeForAPI), &IDLenForAPI, sizeof (IDLenForAPI));
+    memcpy(p->data() + sizeof (typeForAPI) + sizeof (IDLenForAPI), gc->nodeTMScope.c_str(), gc->nodeTMScope.length());
+    memcpy(p->data() + sizeof (typeForAPI) + sizeof (IDLenForAPI) + gc->nodeTMScope.length(), &strategy, sizeof (strategy));
+    memcpy(p->data() + sizeof (typeForAPI) + sizeof (IDLenForAPI) + gc->nodeTMScope.length() + sizeof (strategy), tmFID(replica)._data, FID_LEN);
+    /*Put the payload*/
+    if (count == 1) {
+        memcpy(p->data() + header_len, batch.data() + sizeof (uint16_t), batch.length() - sizeof (uint16_t));
+    } else {
+        memcpy(p->data() + header_len, &request_type, sizeof (request_type));
+        memcpy(p->data() + header_len + sizeof (request_type), &strategy, sizeof (strategy));
+        memcpy(p->data() + header_len + sizeof (request_type) + sizeof (strategy), &count, sizeof (count));
+        memcpy(p->data() + header_len + sizeof (request_type) + sizeof (strategy) + sizeof (count), batch.data(), batch.length());
+    }
+    batch.clear();
+    tm_batch_count[replica] = 0;
+    p->set_anno_u32(0, RV_ELEMENT);
+    output(0).push(p);
+}
+
+void LocalRV::run_timer(Timer *timer) {
+    if (timer == &lease_timer) {
+        sweepLeases();
+    } else if (timer == &snapshot_timer) {
+        writeSnapshot();
+        snapshot_timer.reschedule_after_msec(snapshot_interval * 1000);
+    } else {
+        for (int i = 0; i < tm_batch.size(); i++) {
+            flushTMRequests(i);
+        }
+    }
+}
+
+void LocalRV::sweepLeases() {
+    Timestamp deadline = Timestamp::now() - Timestamp::make_msec(lease * 1000);
+    RemoteHost *_remotehost;
+    if (sweep_cursor >= sweep_hosts.size()) {
+        /*start a new round over the nodes that exist now*/
+        sweep_hosts.clear();
+        for (RemoteHostHashMapIter it = pub_sub_Index.begin(); it != pub_sub_Index.end(); it++) {
+            sweep_hosts.push_back((*it).first);
+        }
+        sweep_cursor = 0;
+    }
+    for (unsigned int i = 0; (i < sweep_batch) && (sweep_cursor < sweep_hosts.size()); i++, sweep_cursor++) {
+        _remotehost = pub_sub_Index.get(sweep_hosts[sweep_cursor]);
+        /*the node may be gone since the snapshot was taken and this node never expires*/
+        if ((_remotehost == pub_sub_Index.default_value()) || (_remotehost == localProxy)) {
+            continue;
+        }
+        if (_remotehost->last_refresh < deadline) {
+            click_chatter("LocalRV: the lease of %s expired - removing its state", _remotehost->remoteHostID.c_str());
+            if (expireRemoteHost(_remotehost)) {
+                expired_hosts++;
+            }
+        }
+    }
+    lease_timer.reschedule_after_msec(lease * 250);
+}
+
+bool LocalRV::expireRemoteHost(RemoteHost *_remotehost) {
+    /*subscriptions first so that unpublishing does not trigger rendezvous for a node that is gone*/
+    StringSet *sets[4] = {&_remotehost->subscribedInformationItems, &_remotehost->subscribedScopes, &_remotehost->publishedInformationItems, &_remotehost->publishedScopes};
+    bool isScope[4] = {false, true, false, true};
+    Vector<String> fullIDs;
+    unsigned char strategy;
+    int max_length;
+    for (int s = 0; s < 4; s++) {
+        fullIDs.clear();
+        max_length = 0;
+        for (StringSetIter it = sets[s]->begin(); it != sets[s]->end(); it++) {
+            fullIDs.push_back((*it)._strData);
+            if ((*it)._strData.length() > max_length) {
+                max_length = (*it)._strData.length();
+            }
+        }
+        /*the deepest identifiers first, so that a scope is empty by the time it is unpublished*/
+        for (int length = max_length; length >= PURSUIT_ID_LEN; length -= PURSUIT_ID_LEN) {
+            for (int i = 0; i < fullIDs.size(); i++) {
+                String &fullID = fullIDs[i];
+                if ((fullID.length() != length) || (sets[s]->find(fullID) == sets[s]->end())) {
+                    /*not at this depth, or already removed along with a scope*/
+                    continue;
+                }
+                String prefixID = fullID.substring(0, length - PURSUIT_ID_LEN);
+                String ID = fullID.substring(length - PURSUIT_ID_LEN, PURSUIT_ID_LEN);
+                Scope *sc = scopeIndex.get(isScope[s] ? fullID : prefixID);
+                if (sc == scopeIndex.default_value()) {
+                    /*stale entry*/
+                    sets[s]->erase(fullID);
+                    continue;
+                }
+                strategy = sc->strategy;
+                switch (s) {
+                    case 0:
+                        unsubscribe_info(_remotehost, ID, prefixID, strategy);
+                        break;
+                    case 1:
+                        unsubscribe_scope(_remotehost, ID, prefixID, strategy);
+                        break;
+                    case 2:
+                        unpublish_info(_remotehost, ID, prefixID, strategy);
+                        break;
+                    case 3:
+                        unpublish_scope(_remotehost, ID, prefixID, strategy);
+                        break;
+                }
+            }
+        }
+    }
+    if ((_remotehost->publishedScopes.size() > 0) || (_remotehost->publishedInformationItems.size() > 0) || (_remotehost->subscribedScopes.size() > 0) || (_remotehost->subscribedInformationItems.size() > 0)) {
+        /*the graph still points to it - try again in the next round*/
+        click_chatter("LocalRV: could not remove all state of %s", _remotehost->remoteHostID.c_str());
+        return false;
+    }
+    pub_sub_Index.erase(_remotehost->remoteHostID);
+    delete _remotehost;
+    return true;
+}
+
 void LocalRV::notifyLocalPublisher(InformationItem *pub, BABitvector *FID) {
     WritablePacket *p;
     /********FOR THE API*********/
@@ -1678,6 +2051,364 @@ void LocalRV::notifyLocalSubscriber(unsigned char type, StringSet &IDs) {
     output(0).push(p);
 }
 
+static void put(StringAccum &sa, const void *data, int len) {
+    sa.append((const char *) data, len);
+}
+
+/*the node indices (see writeSnapshot) of the members of hosts that were saved*/
+static void putHosts(StringAccum &sa, RemoteHostSet &hosts, HashTable<RemoteHost *, uint32_t> &hostIndex) {
+    uint32_t count = 0;
+    for (RemoteHostSetIter it = hosts.begin(); it != hosts.end(); it++) {
+        if (hostIndex.find((*it)._rhpointer) != hostIndex.end()) {
+            count++;
+        }
+    }
+    put(sa, &count, sizeof (count));
+    for (RemoteHostSetIter it = hosts.begin(); it != hosts.end(); it++) {
+        HashTable<RemoteHost *, uint32_t>::iterator index_it = hostIndex.find((*it)._rhpointer);
+        if (index_it != hostIndex.end()) {
+            put(sa, &index_it.value(), sizeof (uint32_t));
+        }
+    }
+}
+
+static void putIDs(StringAccum &sa, IdsHashMap &ids, HashTable<RemoteHost *, uint32_t> &hostIndex) {
+    uint16_t no_ids = ids.size();
+    put(sa, &no_ids, sizeof (no_ids));
+    for (IdsHashMapIter it = ids.begin(); it != ids.end(); it++) {
+        String fullID = it.key();
+        unsigned char fragments = fullID.length() / PURSUIT_ID_LEN;
+        put(sa, &fragments, sizeof (fragments));
+        put(sa, fullID.data(), fullID.length());
+        putHosts(sa, it.value()->first, hostIndex);
+        putHosts(sa, it.value()->second, hostIndex);
+    }
+}
+
+bool LocalRV::writeSnapshot() {
+#if CLICK_USERLEVEL
+    StringAccum sa;
+    HashTable<RemoteHost *, uint32_t> hostIndex;
+    HashTable<Scope *, uint32_t> scopeOrder;
+    HashTable<Scope *, int> remainingFathers;
+    HashTable<InformationItem *, bool> savedItems;
+    Vector<Scope *> scopes;
+    Vector<InformationItem *> items;
+    uint32_t magic = RV_SNAPSHOT_MAGIC;
+    uint16_t version = RV_SNAPSHOT_VERSION, reserved = 0;
+    uint32_t no_hosts = 0, no_scopes, no_items;
+    for (RemoteHostHashMapIter it = pub_sub_Index.begin(); it != pub_sub_Index.end(); it++) {
+        if ((*it).second != localProxy) {
+            hostIndex.set((*it).second, no_hosts++);
+        }
+    }
+    /*every scope after all its fathers, so that loadSnapshot can link it right away*/
+    for (ScopeHashMapIter it = scopeIndex.begin(); it != scopeIndex.end(); it++) {
+        Scope *sc = (*it).second;
+        if (remainingFathers.find(sc) == remainingFathers.end()) {
+            remainingFathers.set(sc, sc->fatherScopes.size());
+            if (sc->fatherScopes.size() == 0) {
+                scopes.push_back(sc);
+            }
+        }
+    }
+    for (int i = 0; i < scopes.size(); i++) {
+        scopeOrder.set(scopes[i], i);
+        for (ScopeSetIter child_it = scopes[i]->childrenScopes.begin(); child_it != scopes[i]->childrenScopes.end(); child_it++) {
+            HashTable<Scope *, int>::iterator remaining_it = remainingFathers.find((*child_it)._scpointer);
+            if ((remaining_it != remainingFathers.end()) && (--remaining_it.value() == 0)) {
+                scopes.push_back((*child_it)._scpointer);
+            }
+        }
+    }
+    for (IIHashMapIter it = pubIndex.begin(); it != pubIndex.end(); it++) {
+        if (savedItems.find((*it).second) == savedItems.end()) {
+            savedItems.set((*it).second, true);
+            items.push_back((*it).second);
+        }
+    }
+    no_scopes = scopes.size();
+    no_items = items.size();
+    put(sa, &magic, sizeof (magic));
+    put(sa, &version, sizeof (version));
+    put(sa, &reserved, sizeof (reserved));
+    put(sa, &no_hosts, sizeof (no_hosts));
+    put(sa, &no_scopes, sizeof (no_scopes));
+    put(sa, &no_items, sizeof (no_items));
+    Vector<RemoteHost *> hosts(no_hosts, NULL);
+    for (HashTable<RemoteHost *, uint32_t>::iterator it = hostIndex.begin(); it != hostIndex.end(); it++) {
+        hosts[it.value()] = it.key();
+    }
+    for (int i = 0; i < hosts.size(); i++) {
+        unsigned char len = hosts[i]->remoteHostID.length();
+        put(sa, &len, sizeof (len));
+        put(sa, hosts[i]->remoteHostID.data(), len);
+    }
+    for (int i = 0; i < scopes.size(); i++) {
+        Scope *sc = scopes[i];
+        unsigned char isRoot = sc->isRoot;
+        uint16_t no_fathers = sc->fatherScopes.size();
+        put(sa, &sc->strategy, sizeof (sc->strategy));
+        put(sa, &isRoot, sizeof (isRoot));
+        put(sa, &no_fathers, sizeof (no_fathers));
+        for (ScopeSetIter father_it = sc->fatherScopes.begin(); father_it != sc->fatherScopes.end(); father_it++) {
+            put(sa, &scopeOrder.get((*father_it)._scpointer), sizeof (uint32_t));
+        }
+        putIDs(sa, sc->ids, hostIndex);
+    }
+    for (int i = 0; i < items.size(); i++) {
+        InformationItem *pub = items[i];
+        uint16_t no_fathers = pub->fatherScopes.size();
+        put(sa, &pub->strategy, sizeof (pub->strategy));
+        put(sa, &no_fathers, sizeof (no_fathers));
+        for (ScopeSetIter father_it = pub->fatherScopes.begin(); father_it != pub->fatherScopes.end(); father_it++) {
+            put(sa, &scopeOrder.get((*father_it)._scpointer), sizeof (uint32_t));
+        }
+        putIDs(sa, pub->ids, hostIndex);
+    }
+    String tmp_file = snapshot_file + ".tmp";
+    FILE *f = fopen(tmp_file.c_str(), "w");
+    if (f == NULL) {
+        click_chatter("LocalRV: could not write snapshot %s", tmp_file.c_str());
+        return false;
+    }
+    bool written = (fwrite(sa.data(), 1, sa.length(), f) == (size_t) sa.length());
+    written = (fclose(f) == 0) && written;
+    if (!written || (rename(tmp_file.c_str(), snapshot_file.c_str()) < 0)) {
+        click_chatter("LocalRV: could not write snapshot %s", snapshot_file.c_str());
+        unlink(tmp_file.c_str());
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+/*a bounds-checked cursor over the mapped snapshot*/
+struct SnapshotReader {
+    SnapshotReader(const unsigned char *_data, size_t _len) : data(_data), end(_data + _len), ok(true) {
+    }
+    bool get(void *out, size_t len) {
+        if (!ok || ((size_t) (end - data) < len)) {
+            ok = false;
+            return false;
+        }
+        memcpy(out, data, len);
+        data += len;
+        return true;
+    }
+    String getString(size_t len) {
+        if (!ok || ((size_t) (end - data) < len)) {
+            ok = false;
+            return String();
+        }
+        String str((const char *) data, len);
+        data += len;
+        return str;
+    }
+    const unsigned char *data;
+    const unsigned char *end;
+    bool ok;
+};
+
+/*reads a set written by putHosts*/
+static bool getHosts(SnapshotReader &reader, Vector<RemoteHost *> &hosts, Vector<RemoteHost *> &members) {
+    uint32_t count, index;
+    members.clear();
+    if (!reader.get(&count, sizeof (count)) || (count > (uint32_t) hosts.size())) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (!reader.get(&index, sizeof (index)) || (index >= (uint32_t) hosts.size())) {
+            return false;
+        }
+        members.push_back(hosts[index]);
+    }
+    return true;
+}
+
+/*reads the father scopes written by writeSnapshot*/
+static bool getFathers(SnapshotReader &reader, Vector<Scope *> &scopes, Vector<Scope *> &fathers) {
+    uint16_t no_fathers;
+    uint32_t index;
+    fathers.clear();
+    if (!reader.get(&no_fathers, sizeof (no_fathers))) {
+        return false;
+    }
+    for (int i = 0; i < no_fathers; i++) {
+        /*a father is always saved before its children*/
+        if (!reader.get(&index, sizeof (index)) || (index >= (uint32_t) scopes.size())) {
+            return false;
+        }
+        fathers.push_back(scopes[index]);
+    }
+    return true;
+}
+
+void LocalRV::loadSnapshot(ErrorHandler *errh) {
+#if CLICK_USERLEVEL
+    struct stat st;
+    int fd = open(snapshot_file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            errh->warning("could not open snapshot %s, starting empty", snapshot_file.c_str());
+        }
+        return;
+    }
+    if ((fstat(fd, &st) < 0) || (st.st_size == 0)) {
+        close(fd);
+        errh->warning("snapshot %s is empty, starting empty", snapshot_file.c_str());
+        return;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        errh->warning("could not map snapshot %s, starting empty", snapshot_file.c_str());
+        return;
+    }
+    SnapshotReader reader((const unsigned char *) map, st.st_size);
+    Vector<RemoteHost *> hosts, members;
+    Vector<Scope *> scopes, fathers;
+    Vector<InformationItem *> items;
+    uint32_t magic = 0, no_hosts = 0, no_scopes = 0, no_items = 0;
+    uint16_t version = 0, no_ids, reserved;
+    unsigned char len, fragments, strategy, isRoot;
+    reader.get(&magic, sizeof (magic));
+    reader.get(&version, sizeof (version));
+    reader.get(&reserved, sizeof (reserved));
+    reader.get(&no_hosts, sizeof (no_hosts));
+    reader.get(&no_scopes, sizeof (no_scopes));
+    reader.get(&no_items, sizeof (no_items));
+    if ((magic != RV_SNAPSHOT_MAGIC) || (version != RV_SNAPSHOT_VERSION)) {
+        reader.ok = false;
+    }
+    for (uint32_t i = 0; reader.ok && (i < no_hosts); i++) {
+        String nodeID;
+        if (reader.get(&len, sizeof (len))) {
+            nodeID = reader.getString(len);
+        }
+        if (reader.ok && (pub_sub_Index.find(nodeID) == pub_sub_Index.end())) {
+            RemoteHost *_remotehost = getRemoteHost(nodeID);
+            hosts.push_back(_remotehost);
+        } else {
+            reader.ok = false;
+        }
+    }
+    for (uint32_t i = 0; reader.ok && (i < no_scopes); i++) {
+        if (!reader.get(&strategy, sizeof (strategy)) || !reader.get(&isRoot, sizeof (isRoot)) || !getFathers(reader, scopes, fathers) || !reader.get(&no_ids, sizeof (no_ids))) {
+            reader.ok = false;
+            break;
+        }
+        Scope *sc = new Scope(strategy, fathers.empty() ? NULL : fathers[0]);
+        for (int f = 1; f < fathers.size(); f++) {
+            sc->fatherScopes.find_insert(ScopeSetItem(fathers[f]));
+            fathers[f]->childrenScopes.find_insert(ScopeSetItem(sc));
+        }
+        sc->isRoot = isRoot;
+        scopes.push_back(sc);
+        if (no_ids == 0) {
+            reader.ok = false;
+        }
+        for (int j = 0; reader.ok && (j < no_ids); j++) {
+            String fullID;
+            if (reader.get(&fragments, sizeof (fragments))) {
+                fullID = reader.getString(fragments * PURSUIT_ID_LEN);
+            }
+            if (!reader.ok || (fragments == 0) || (scopeIndex.get(fullID) != scopeIndex.default_value())) {
+                reader.ok = false;
+                break;
+            }
+            RemoteHostPair *pair = new RemoteHostPair();
+            sc->ids.set(fullID, pair);
+            scopeIndex.set(fullID, sc);
+            if (!getHosts(reader, hosts, members)) {
+                reader.ok = false;
+                break;
+            }
+            for (int m = 0; m < members.size(); m++) {
+                pair->first.find_insert(members[m]);
+                members[m]->publishedScopes.find_insert(StringSetItem(fullID));
+            }
+            if (!getHosts(reader, hosts, members)) {
+                reader.ok = false;
+                break;
+            }
+            for (int m = 0; m < members.size(); m++) {
+                pair->second.find_insert(members[m]);
+                members[m]->subscribedScopes.find_insert(StringSetItem(fullID));
+            }
+        }
+    }
+    for (uint32_t i = 0; reader.ok && (i < no_items); i++) {
+        if (!reader.get(&strategy, sizeof (strategy)) || !getFathers(reader, scopes, fathers) || fathers.empty() || !reader.get(&no_ids, sizeof (no_ids))) {
+            reader.ok = false;
+            break;
+        }
+        /*the subscribers of the father scopes become effective subscribers here*/
+        InformationItem *pub = new InformationItem(strategy, fathers[0]);
+        for (int f = 1; f < fathers.size(); f++) {
+            pub->fatherScopes.find_insert(ScopeSetItem(fathers[f]));
+            fathers[f]->informationitems.find_insert(InformationItemSetItem(pub));
+            pub->addFatherSubscribers(fathers[f]);
+        }
+        items.push_back(pub);
+        if (no_ids == 0) {
+            reader.ok = false;
+        }
+        for (int j = 0; reader.ok && (j < no_ids); j++) {
+            String fullID;
+            if (reader.get(&fragments, sizeof (fragments))) {
+                fullID = reader.getString(fragments * PURSUIT_ID_LEN);
+            }
+            if (!reader.ok || (fragments < 2) || (pubIndex.get(fullID) != pubIndex.default_value())) {
+                reader.ok = false;
+                break;
+            }
+            RemoteHostPair *pair = new RemoteHostPair();
+            pub->ids.set(fullID, pair);
+            pubIndex.set(fullID, pub);
+            if (!getHosts(reader, hosts, members)) {
+                reader.ok = false;
+                break;
+            }
+            for (int m = 0; m < members.size(); m++) {
+                pair->first.find_insert(members[m]);
+                members[m]->publishedInformationItems.find_insert(StringSetItem(fullID));
+            }
+            if (!getHosts(reader, hosts, members)) {
+                reader.ok = false;
+                break;
+            }
+            for (int m = 0; m < members.size(); m++) {
+                pub->updateSubscribers(fullID, members[m]);
+                members[m]->subscribedInformationItems.find_insert(StringSetItem(fullID));
+            }
+        }
+        pub->effectiveSubscribersChanged = false;
+    }
+    munmap(map, st.st_size);
+    if (!reader.ok || (reader.data != reader.end)) {
+        /*nothing else exists yet, so everything that was restored goes*/
+        for (int i = 0; i < items.size(); i++) {
+            delete items[i];
+        }
+        for (int i = 0; i < scopes.size(); i++) {
+            delete scopes[i];
+        }
+        for (int i = 0; i < hosts.size(); i++) {
+            delete hosts[i];
+        }
+        pubIndex.clear();
+        scopeIndex.clear();
+        pub_sub_Index.clear();
+        errh->warning("snapshot %s is corrupted or of another version, starting empty", snapshot_file.c_str());
+        return;
+    }
+    click_chatter("LocalRV: restored %d nodes, %d scopes and %d information items from %s", hosts.size(), scopes.size(), items.size(), snapshot_file.c_str());
+#endif
+}
+
 RemoteHost * LocalRV::getRemoteHost(String & nodeID) {
     RemoteHost *_remotehost = NULL;
     _remotehost = pub_sub_Index.get(nodeID);
@@ -1691,3 +2422,4 @@ RemoteHost * LocalRV::getRemoteHost(String & nodeID) {
 
 CLICK_ENDDECLS
 EXPORT_ELEMENT(LocalRV)
+ELEMENT_REQUIRES(MemStats)
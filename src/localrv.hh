@@ -19,6 +19,10 @@
 #include "informationitem.hh"
 #include "scope.hh"
 #include "remotehost.hh"
+#include "memstats.hh"
+
+#include <click/timer.hh>
+#include <click/straccum.hh>
 
 CLICK_DECLS
 
@@ -60,7 +64,14 @@ public:
      */
     const char *processing() const {return PUSH;}
     /**
-     * @brief Element configuration. LocalRV needs only a pointer to the GlovalConf Element so that it can read the Global Configuration.
+     * @brief Element configuration. LocalRV needs a pointer to the GlovalConf Element so that it can read the Global Configuration.
+     *
+     * The optional TM_BATCH keyword is the coalescing window (in milliseconds, e.g. 2ms) of requests to the Topology Manager (see sendTMRequest). The default, 0, sends every request right away, so batching is only enabled by configurations that set a window.
+     *
+     * The optional LEASE keyword (in seconds, 0 - the default - disables it) turns the state of remote nodes into soft state: a node that sends no request (or LEASE_REFRESH, see the LEASE_REFRESH keyword of LocalProxy) for that long is expired (see sweepLeases).
+     * SWEEP_BATCH (default 64) bounds the number of nodes checked every time the sweeper runs.
+     *
+     * The optional SNAPSHOT keyword is a file the information graph is saved to (see writeSnapshot) every SNAPSHOT_INTERVAL seconds (default 60, 0 saves it only at cleanup) and restored from at initialization (user-level only).
      */
     int configure(Vector<String>&, ErrorHandler*);
     /**@brief This Element must be configured AFTER the GlobalConf Element
@@ -78,6 +89,16 @@ public:
     /**@brief Cleanups everything. Upon the cleanup() method invocation, the LocalRV will delete all Scope, InformationItem, and RemoteHost stored in its local indexes.
      */
     void cleanup(CleanupStage stage);
+    /**@brief Our proposal read handlers: hosts is the number of known remote nodes, expired the number of nodes whose lease expired (see sweepLeases).
+     * Writing the snapshot handler saves the graph right away.
+     * memory reports the entries and approximate bytes of scopeIndex, pubIndex, pub_sub_Index and the IDTable, memory_scopes the largest root scopes (see memoryReport).
+     * tm_replicas (with TMREPLICAS in the GlobalConf) lists every TM replica, whether it is up or down and the requests sent to it; writing "NODEID down" stops sending requests to a replica
+     * (its identifiers move to the other replicas, see GlobalConf::tmReplica) and "NODEID up" takes it back.
+     */
+    void add_handlers();
+    /**@brief Our proposal flushes the pending batch of TM requests when the coalescing window expires, or runs the lease sweeper (see sweepLeases).
+     */
+    void run_timer(Timer *timer);
     /**@brief The push() method is called whenever the LocalProxy pushes a packet to the LocalRV.
      *
      * LocalRV is subscribed to Scope /FFFFFFFFFFFFFFFF when initialized. Therefore, it only expects publications pushed by the LocalProxy.
@@ -430,6 +451,63 @@ public:
     /**@brief kanycast notify subsribers all the info item under the subscribed scope
      */
     void kanycast_notifySubscribers(unsigned char type, StringSet& IIDs, unsigned char strategy, RemoteHostSet& pub, RemoteHostSet& sub, StringSet& SIDs, unsigned int noofpub) ;
+    /**@brief Our proposal adds the identifiers a republished scope (and its whole subgraph) gets under fatherScope.
+     *
+     * Every Scope and InformationItem under existingID is found with one prefix query on the trie of scopeIndex and pubIndex and gets newID + (its identifier relative to existingID)
+     * for every new identifier of the scope, instead of Scope::recursivelyUpdateIDs walking the fathers of every descendant.
+     * @param sc the republished scope (already linked under fatherScope).
+     * @param existingID an identifier sc already had.
+     * @param fatherScope the new father scope.
+     * @param suffixID the last fragment of the identifier of sc.
+     */
+    void graftScope(Scope *sc, const String &existingID, Scope *fatherScope, const String &suffixID);
+    /**@brief Our proposal sends a request built for the Topology Manager (a PUBLISH_DATA to gc->nodeTMScope) to the TM replica of key (see tmReplica).
+     *
+     * With a coalescing window, the payload is appended to the pending batch of that replica instead and the packet is killed.
+     * The batch is published as a single BATCHED_REQUESTS request when the window expires or when it would grow beyond TM_BATCH_MAX_BYTES, so that a burst of publications costs one TM round trip.
+     * @param p the complete request, including the Blackadder API header (with TMFID, it is replaced by the FID to the replica).
+     * @param key the identifier the replica is chosen by (see tmKey).
+     */
+    void sendTMRequest(WritablePacket *p, const String &key);
+    /**@brief Our proposal publishes the pending batch of TM requests to a replica (if any).
+     */
+    void flushTMRequests(int replica);
+    /**@brief Our proposal the smallest of the identifiers of a request.
+     */
+    String tmKey(IdsHashMap &IDs);
+    String tmKey(StringSet &IDs);
+    /**@brief Our proposal the TM replica that gets the requests of key: the one GlobalConf::tmReplica picks among those that are not down (among all of them if they are all down), 0 without TMREPLICAS.
+     */
+    int tmReplica(const String &key);
+    inline const BABitvector &tmFID(int replica) const {
+        return (gc->tmReplicaFIDs.size() > 0) ? gc->tmReplicaFIDs[replica] : gc->TMFID;
+    }
+    /**@brief Our proposal checks the leases of at most sweep_batch remote nodes, continuing from where the previous run stopped.
+     *
+     * The sweeper runs every LEASE / 4 seconds. The nodes are visited in a snapshot of pub_sub_Index that is taken again once it has been walked, so one run never costs more than sweep_batch checks.
+     */
+    void sweepLeases();
+    static String read_handler(Element *e, void *thunk);
+    /**@brief Our proposal fills report with the state of the rendezvous indexes (see MemReport): up to MEM_SAMPLE entries of each index are measured.
+     */
+    void memoryReport(MemReport &report);
+    static int write_handler(const String &str, Element *e, void *thunk, ErrorHandler *errh);
+    /**@brief Our proposal saves scopeIndex, pubIndex and the publishers and subscribers of every identifier to the SNAPSHOT file.
+     *
+     * The file (RV_SNAPSHOT_MAGIC, RV_SNAPSHOT_VERSION) lists the remote nodes, then every Scope once (each after all its father scopes) and every InformationItem once, with their identifiers and, per identifier, the indices of the publishers and subscribers.
+     * The state of this node is not saved: local applications register again when they reconnect. The file is written next to the old one and renamed over it, so a crash never leaves half a snapshot.
+     * @return false if the file could not be written.
+     */
+    bool writeSnapshot();
+    /**@brief Our proposal rebuilds the graph saved by writeSnapshot: the file is mapped and the Scopes, InformationItems and RemoteHosts are created directly, without any rendezvous or notification.
+     *
+     * Restored nodes get a fresh lease. A file that is missing is not an error; a file that is corrupted or of another version is ignored (with a warning) and the LocalRV starts empty.
+     */
+    void loadSnapshot(ErrorHandler *errh);
+    /**@brief Our proposal removes all state of a remote node, as if it had unsubscribed and unpublished everything (information items first, then the deepest scopes first).
+     * @return true if the RemoteHost was left without state and has been deleted.
+     */
+    bool expireRemoteHost(RemoteHost *_remotehost);
     /**@brief A pointer to the GlobalConf Element so that LocalProxy can access the node's Global Configuration.
      */
      GlobalConf *gc;
@@ -441,6 +519,7 @@ public:
     /**@brief A HashTable that maps information identifiers to pointers to Scope.
      *
      * Multiple identifiers may be mapped to the same Scope since multiple paths from the information graph may lead to the same scope.
+     * It is also a fragment-level trie (see GraphIndex), so all scopes under an identifier are found with one prefix query.
      */
     ScopeHashMap scopeIndex;
     /**@brief A HashTable that maps information identifiers to pointers to InformationItem.
@@ -453,6 +532,39 @@ public:
      * These labels correspond to Blackadder nodes, one of them being the localProxy.
      */
     RemoteHostHashMap pub_sub_Index;
+    /**@brief the coalescing window of TM requests in milliseconds (0 disables batching).
+     */
+    uint32_t tm_batch_window;
+    /**@brief the pending TM requests of every TM replica, each prefixed by its length.
+     */
+    Vector<StringAccum> tm_batch;
+    /**@brief the number of requests in every tm_batch.
+     */
+    Vector<uint16_t> tm_batch_count;
+    Timer tm_batch_timer;
+    /**@brief Our proposal the TM replicas that were marked down (tm_replicas handler) and the requests sent to every replica.
+     */
+    Vector<bool> tm_replica_down;
+    Vector<uint64_t> tm_replica_requests;
+    /**@brief the lease of remote nodes in seconds (0 disables expiry).
+     */
+    uint32_t lease;
+    /**@brief the remote nodes checked per run of the sweeper.
+     */
+    uint32_t sweep_batch;
+    /**@brief the node labels the sweeper walks through and its position in them.
+     */
+    Vector<String> sweep_hosts;
+    int sweep_cursor;
+    /**@brief the number of remote nodes expired so far.
+     */
+    uint32_t expired_hosts;
+    Timer lease_timer;
+    /**@brief the snapshot file (empty disables snapshots) and the seconds between two snapshots.
+     */
+    String snapshot_file;
+    uint32_t snapshot_interval;
+    Timer snapshot_timer;
 };
 
 CLICK_ENDDECLS
@@ -0,0 +1,91 @@
+/*Our Proposal
+ *the memory reports of the elements
+*/
+#include "memstats.hh"
+
+CLICK_DECLS
+
+void MemReport::begin(const char* _name, int _entries)
+{
+    name = _name ;
+    entries = _entries ;
+    sampled = 0 ;
+    sampled_bytes = 0 ;
+    table_roots.clear() ;
+}
+
+bool MemReport::sample(const String& ID, size_t bytes)
+{
+    String root = ID.substring(0, PURSUIT_ID_LEN) ;
+    Pair<uint64_t, uint64_t>& share = table_roots[root] ;
+    share.first++ ;
+    share.second += bytes ;
+    sampled_bytes += bytes ;
+    return ++sampled < MEM_SAMPLE ;
+}
+
+void MemReport::end()
+{
+    /*scale the sample to the whole table*/
+    double scale = (sampled > 0) ? (double) entries / sampled : 0 ;
+    uint64_t bytes = (uint64_t) (sampled_bytes * scale) ;
+    for(HashTable<String, Pair<uint64_t, uint64_t> >::iterator it = table_roots.begin() ; it != table_roots.end() ; it++)
+    {
+        if(it.key().length() == 0)
+            continue ;
+        Pair<uint64_t, uint64_t>& share = roots[it.key()] ;
+        share.first += (uint64_t) (it.value().first * scale) ;
+        share.second += (uint64_t) (it.value().second * scale) ;
+    }
+    table_roots.clear() ;
+    exact(name.c_str(), entries, bytes) ;
+}
+
+void MemReport::exact(const char* _name, int _entries, uint64_t bytes)
+{
+    lines << _name << ' ' << _entries << ' ' << bytes << '\n' ;
+    total += bytes ;
+}
+
+String MemReport::totals() const
+{
+    StringAccum sa ;
+    sa << lines ;
+    sa << "total " << total << '\n' ;
+    return sa.take_string() ;
+}
+
+String MemReport::scopes() const
+{
+    StringAccum sa ;
+    Vector<String> top ;
+    Vector<Pair<uint64_t, uint64_t> > top_values ;
+    for(HashTable<String, Pair<uint64_t, uint64_t> >::const_iterator it = roots.begin() ; it != roots.end() ; it++)
+    {
+        /*insertion into the (short) list of the largest*/
+        int i = top.size() ;
+        if(i == MEM_TOP_SCOPES && top_values[i - 1].second >= it.value().second)
+            continue ;
+        if(i < MEM_TOP_SCOPES)
+        {
+            top.push_back(String()) ;
+            top_values.push_back(Pair<uint64_t, uint64_t>()) ;
+        }
+        else
+            i-- ;
+        for( ; i > 0 && top_values[i - 1].second < it.value().second ; i--)
+        {
+            top[i] = top[i - 1] ;
+            top_values[i] = top_values[i - 1] ;
+        }
+        top[i] = it.key() ;
+        top_values[i] = it.value() ;
+    }
+    for(int i = 0 ; i < top.size() ; i++)
+        sa << top[i].quoted_hex() << ' ' << top_values[i].first << ' ' << top_values[i].second << '\n' ;
+    return sa.take_string() ;
+}
+
+CLICK_ENDDECLS
+
+ELEMENT_PROVIDES(MemStats)
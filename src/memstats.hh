@@ -0,0 +1,84 @@
+#ifndef MEMSTATS_HH_INCLUDED
+#define MEMSTATS_HH_INCLUDED
+
+#include <click/config.h>
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <click/hashtable.hh>
+#include <click/pair.hh>
+#include <click/straccum.hh>
+
+#include "helper.hh"
+
+CLICK_DECLS
+
+/*the entries of a table whose state is measured (the first ones in hash order, which is as good as a random sample of them)*/
+#define MEM_SAMPLE 1024
+/*the largest root scopes the memory_scopes handlers list*/
+#define MEM_TOP_SCOPES 32
+
+/**@brief the approximate bytes of an entry of a Click HashTable<K, V>: the entry, its next pointer and its bucket*/
+template <typename K, typename V>
+inline size_t mem_entry()
+{
+    return sizeof(K) + sizeof(V) + 2 * sizeof(void*) ;
+}
+
+/**@brief the approximate bytes of an entry of a Click HashTable set of T*/
+template <typename T>
+inline size_t mem_set_entry()
+{
+    return sizeof(T) + 2 * sizeof(void*) ;
+}
+
+inline size_t mem_string(const String& s)
+{
+    return sizeof(String) + s.length() ;
+}
+
+inline size_t mem_strings(const Vector<String>& v)
+{
+    size_t bytes = 0 ;
+    for(int i = 0 ; i < v.size() ; i++)
+        bytes += mem_string(v[i]) ;
+    return bytes ;
+}
+
+/**@brief Our proposal the memory report of an element (its memory and memory_scopes handlers).
+ *
+ * The number of entries of every table is known (the size of its index). Their bytes are measured on up to MEM_SAMPLE of them
+ * (the records, their sets and identifiers and the index entries) and scaled to all of them, so a report costs the same however large the state is.
+ * The sampled entries are also summed up by root scope (the first PURSUIT_ID_LEN bytes of their identifier).
+ * The bytes are an estimate: allocator overheads and the node-wide IDTable shared by the indexes are left out (LocalRV reports the IDTable)
+ */
+class MemReport
+{
+public:
+    MemReport() : total(0), entries(0), sampled(0), sampled_bytes(0) {}
+    /**@brief starts a table of _entries entries*/
+    void begin(const char* _name, int _entries) ;
+    /**@brief adds a sampled entry of the current table that takes bytes, under the root scope of ID (an empty ID for state outside any scope).
+     * @return false once MEM_SAMPLE entries were sampled*/
+    bool sample(const String& ID, size_t bytes) ;
+    /**@brief ends the current table: the sampled bytes are scaled to all its entries*/
+    void end() ;
+    /**@brief adds a table whose bytes are known*/
+    void exact(const char* _name, int _entries, uint64_t bytes) ;
+    /**@brief a line per table: its name, entries and bytes, and the total bytes*/
+    String totals() const ;
+    /**@brief a line per root scope (the MEM_TOP_SCOPES largest): the scope, its entries and bytes (scaled from the samples)*/
+    String scopes() const ;
+private:
+    StringAccum lines ;
+    uint64_t total ;
+    String name ;
+    int entries ;
+    int sampled ;
+    uint64_t sampled_bytes ;
+    /**@brief the sampled entries and bytes of the current table and the scaled ones of all tables by root scope*/
+    HashTable<String, Pair<uint64_t, uint64_t> > table_roots ;
+    HashTable<String, Pair<uint64_t, uint64_t> > roots ;
+};
+
+CLICK_ENDDECLS
+#endif // MEMSTATS_HH_INCLUDED
@@ -12,9 +12,12 @@
  * See LICENSE and COPYING for more details.
  */
 #include "netlink.hh"
+#include "helper.hh"
 #include <unistd.h>
 #if !CLICK_LINUXMODULE
 #include "fcntl.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
 #endif
 
 CLICK_DECLS
@@ -78,10 +81,119 @@ void Netlink::cleanup(CleanupStage stage) {
 #if !HAVE_USE_NETLINK
         unlink(s_nladdr.sun_path);
 #endif
+        while (shm_rings.size() > 0) {
+            detach_rings(shm_rings.begin().key());
+        }
 #endif
     }
     click_chatter("Netlink: Cleaned up!");
 }
 
+#if !CLICK_LINUXMODULE
+
+/*map one ring created by the application and unlink its name, so nothing is left behind if either side crashes*/
+static struct ba_shm_ring *map_ring(uint32_t pid, int dir, size_t &bytes) {
+    char name[64];
+    struct stat st;
+    void *addr;
+    ba_shm_name(name, pid, dir);
+    int shm_fd = shm_open(name, O_RDWR, 0);
+    if (shm_fd < 0) {
+        click_chatter("Netlink: cannot open ring %s: %s", name, strerror(errno));
+        return NULL;
+    }
+    shm_unlink(name);
+    if (fstat(shm_fd, &st) < 0 || (size_t) st.st_size <= sizeof (struct ba_shm_ring)) {
+        close(shm_fd);
+        return NULL;
+    }
+    bytes = st.st_size;
+    addr = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    close(shm_fd);
+    if (addr == MAP_FAILED) {
+        click_chatter("Netlink: cannot map ring %s: %s", name, strerror(errno));
+        return NULL;
+    }
+    struct ba_shm_ring *ring = (struct ba_shm_ring *) addr;
+    /*never trust the size written by the application*/
+    if (ring->size != ((bytes - sizeof (struct ba_shm_ring)) & ~3U)) {
+        click_chatter("Netlink: ring %s has a wrong size", name);
+        munmap(addr, bytes);
+        return NULL;
+    }
+    return ring;
+}
+
+ShmRings *Netlink::attach_rings(uint32_t pid) {
+    ShmRings *rings = shm_rings.get(pid);
+    if (rings != NULL) {
+        return rings;
+    }
+    rings = new ShmRings();
+    rings->up = map_ring(pid, BA_SHM_UP, rings->up_bytes);
+    rings->down = map_ring(pid, BA_SHM_DOWN, rings->down_bytes);
+    if (rings->up == NULL || rings->down == NULL) {
+        if (rings->up != NULL) munmap(rings->up, rings->up_bytes);
+        if (rings->down != NULL) munmap(rings->down, rings->down_bytes);
+        delete rings;
+        return NULL;
+    }
+    rings->up_size = rings->up->size;
+    rings->down_size = rings->down->size;
+    shm_rings.set(pid, rings);
+    click_chatter("Netlink: application %u uses shared-memory rings", pid);
+    return rings;
+}
+
+void Netlink::detach_rings(uint32_t pid) {
+    ShmRings *rings = shm_rings.get(pid);
+    if (rings == NULL) {
+        return;
+    }
+    while (!rings->backlog.empty()) {
+        rings->backlog.front()->kill();
+        rings->backlog.pop();
+    }
+    munmap(rings->up, rings->up_bytes);
+    munmap(rings->down, rings->down_bytes);
+    shm_rings.erase(pid);
+    delete rings;
+}
+
+int Netlink::send_doorbell(uint32_t pid) {
+#if HAVE_USE_NETLINK
+    struct sockaddr_nl d_nladdr;
+#else
+    struct sockaddr_un d_nladdr;
+#endif
+    struct msghdr msg;
+    struct iovec iov[1];
+    unsigned char buf[sizeof (struct nlmsghdr) + sizeof (unsigned char)];
+    struct nlmsghdr *nlh = (struct nlmsghdr *) buf;
+    memset(buf, 0, sizeof (buf));
+    nlh->nlmsg_len = sizeof (buf);
+    nlh->nlmsg_flags = 1;
+    nlh->nlmsg_pid = 9999;
+    buf[sizeof (struct nlmsghdr)] = SHM_DOORBELL;
+    memset(&d_nladdr, 0, sizeof (d_nladdr));
+#if HAVE_USE_NETLINK
+    d_nladdr.nl_family = AF_NETLINK;
+    d_nladdr.nl_pid = pid;
+#else
+    d_nladdr.sun_len = sizeof (d_nladdr);
+    d_nladdr.sun_family = PF_LOCAL;
+    ba_id2path(d_nladdr.sun_path, pid);
+#endif
+    iov[0].iov_base = buf;
+    iov[0].iov_len = sizeof (buf);
+    memset(&msg, 0, sizeof (msg));
+    msg.msg_name = (void *) &d_nladdr;
+    msg.msg_namelen = sizeof (d_nladdr);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 1;
+    return sendmsg(fd, &msg, MSG_DONTWAIT);
+}
+#endif
+
 CLICK_ENDDECLS
 EXPORT_ELEMENT(Netlink)
@@ -37,6 +37,8 @@ CLICK_CXX_UNPROTECT
 #define TASK_IS_SCHEDULED 0
 #else
 #include <queue>
+#include <click/hashtable.hh>
+#include "shmring.hh"
 #include <click/cxxprotect.h>
 
 CLICK_CXX_PROTECT
@@ -78,6 +80,25 @@ typedef HashTable<PIDSetItem> PIDSet;
 /** @brief An iterator to a set (implemented as a Click's HashTable) of pointers to struct pid
  */
 typedef PIDSet::iterator PIDSetIter;
+#else
+/**@brief Our proposal the shared-memory rings of one application that asked for them at CONNECT (User-Space only).
+ *
+ * The application creates and owns both rings, Blackadder maps them (and unlinks their names) when the CONNECT arrives.
+ */
+struct ShmRings {
+    /**@brief requests from the application (consumed by FromNetlink)*/
+    struct ba_shm_ring *up;
+    /**@brief events to the application (produced by ToNetlink)*/
+    struct ba_shm_ring *down;
+    size_t up_bytes;
+    size_t down_bytes;
+    /**@brief the ring sizes checked when they were mapped. The rings live in memory the application can write, so they are compared before every use*/
+    uint32_t up_size;
+    uint32_t down_size;
+    inline bool sane() const {return up->size == up_size && down->size == down_size;}
+    /**@brief packets that did not fit in the down ring. Until it is empty every new packet is queued as well, so that the application sees them in order*/
+    std::queue<WritablePacket *> backlog;
+};
 #endif
 
 /**@brief (blackadder Core) The Netlink Element is the base element that creates, opens and binds to the netlink socket of Blackadder.
@@ -149,6 +170,16 @@ public:
     /** a queue (from STL to use only in user space) that holds the packets to be sent to an application via the netlink socket.
      */
     std::queue <WritablePacket *> out_buf_queue;
+    /**@brief Our proposal maps the rings of the application with this pid (see ba_shm_name).
+     * @return the rings or NULL if they cannot be mapped (the application then keeps using the socket)
+     */
+    ShmRings *attach_rings(uint32_t pid);
+    /**@brief unmaps the rings of the application (if any) and kills the packets still waiting for the down ring*/
+    void detach_rings(uint32_t pid);
+    /**@brief Our proposal sends a SHM_DOORBELL directly to an application (used to acknowledge its rings)*/
+    int send_doorbell(uint32_t pid);
+    /**@brief the rings of the applications, by pid*/
+    HashTable<uint32_t, ShmRings *> shm_rings;
 #endif
 };
 
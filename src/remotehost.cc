@@ -17,6 +17,12 @@ CLICK_DECLS
 
 RemoteHost::RemoteHost(String _remoteHostID) {
     remoteHostID = _remoteHostID;
+    last_refresh = Timestamp::now();
+    handle = HostTable::node().intern(this);
+}
+
+RemoteHost::~RemoteHost() {
+    HostTable::node().release(handle);
 }
 
 CLICK_ENDDECLS
@@ -17,6 +17,7 @@
 
 #include "helper.hh"
 #include "common.hh"
+#include <click/timestamp.hh>
 
 /**
  * @brief (blackadder Core) The RemoteHost class represents a Blackadder network node.
@@ -30,9 +31,15 @@ public:
      * @param _remoteHostID the statistically unique identifier of a Blackadder node.
      */
     RemoteHost(String _remoteHostID);
+    /**@brief gives the handle back to the HostTable.
+     */
+    ~RemoteHost();
     /**@brief the statistically unique identifier of a Blackadder node.
      */
     String remoteHostID;
+    /**@brief Our proposal the handle with which HostSets (see hostset.hh) store this node.
+     */
+    HostHandle handle;
     /** @brief A set of String Items identifying published Scopes. The LocalRV uses this set.
      */
     StringSet publishedScopes;
@@ -45,6 +52,9 @@ public:
     /** @brief A set of String Items identifying InformationItem Subscriptions. The LocalRV uses this set.
      */
     StringSet subscribedInformationItems;
+    /** @brief Our proposal when the node last sent a request (or a LEASE_REFRESH). The LocalRV expires the state of nodes that stay silent for longer than its LEASE.
+     */
+    Timestamp last_refresh;
 };
 
 #endif
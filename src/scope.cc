@@ -72,6 +72,22 @@ bool Scope::updateSubscribers(String fullID, RemoteHost *_subscriber) {
         pair->second.find_insert(_subscriber);
         ids.set(fullID, pair);
     }
+    /*the subscriber is now an effective subscriber of all items of this scope*/
+    for (InformationItemSetIter pub_it = informationitems.begin(); pub_it != informationitems.end(); pub_it++) {
+        (*pub_it)._iipointer->addEffectiveSubscriber(_subscriber);
+    }
+    return true;
+}
+
+bool Scope::removeSubscriber(String fullID, RemoteHost *_subscriber) {
+    RemoteHostPair * pair = ids.get(fullID);
+    if ((pair == ids.default_value()) || (pair->second.find(_subscriber) == pair->second.end())) {
+        return false;
+    }
+    pair->second.erase(_subscriber);
+    for (InformationItemSetIter pub_it = informationitems.begin(); pub_it != informationitems.end(); pub_it++) {
+        (*pub_it)._iipointer->removeEffectiveSubscriber(_subscriber);
+    }
     return true;
 }
 
@@ -129,9 +145,7 @@ bool Scope::checkForOtherPubSub(Scope * fatherScope) {
 void Scope::getSubscribers(RemoteHostSet & subscribers) {
     /*add the subscribers of this scope for all ids*/
     for (IdsHashMapIter id_it = ids.begin(); id_it != ids.end(); id_it++) {
-        for (RemoteHostSetIter subscriber_it = (*id_it).second->second.begin(); subscriber_it != (*id_it).second->second.end(); subscriber_it++) {
-            subscribers.find_insert((*subscriber_it));
-        }
+        subscribers.unite((*id_it).second->second);
     }
 }
 
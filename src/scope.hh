@@ -63,6 +63,14 @@ public:
      * @return False if the subscriber was already in the set for the provided ID. True if it wasn't or if the identifier wasn't there. 
      */
     bool updateSubscribers(String ID, RemoteHost *_subscriber);
+    /**
+     * @brief Removes the subscriber from the set of subscribers of the provided identifier. The effective subscribers of all information items of this scope are updated.
+     * 
+     * @param ID the information identifier for which the set of subscribers will be updated.
+     * @param _subscriber A pointer to a RemoteHost representing a subscriber.
+     * @return False if the subscriber was not in the set for the provided ID.
+     */
+    bool removeSubscriber(String ID, RemoteHost *_subscriber);
     /**
      * @brief All ids must be updated because of the publication or the republication. For instance the scope may have two father scopes, each one being identified by multiple identifiers. 
      * 
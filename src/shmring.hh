@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/*Our proposal
+ *a single-producer/single-consumer ring of length-prefixed messages in POSIX shared memory.
+ *An application that asks for it gets two of them at CONNECT: the up ring carries its requests to Blackadder and the down ring carries the events back.
+ *The netlink socket is kept as the doorbell: a producer sends a SHM_DOORBELL message only when the consumer has said (through the waiting flag) that it is about to sleep,
+ *so under load many messages cross the ring for one system call.
+ *The layout must be the same in lib/ba_shmring.h*/
+
+#ifndef CLICK_SHMRING_HH
+#define CLICK_SHMRING_HH
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/uio.h>
+
+#define BA_SHM_RING_SIZE (1 << 20) //in bytes, the default data area of each ring
+#define BA_SHM_RING_WRAP 0xFFFFFFFF //record length that sends the consumer back to the start of the data area
+#define BA_SHM_UP 0
+#define BA_SHM_DOWN 1
+
+#define ba_shm_name(name, id, dir)  snprintf((name), 64, "/blackadder.%05u.%s", (id), ((dir) == BA_SHM_UP) ? "up" : "down")
+
+struct ba_shm_ring {
+    /*written only by the consumer*/
+    volatile uint32_t head;
+    /*set by the consumer before it sleeps on the socket, cleared by the producer that rings the doorbell*/
+    volatile uint32_t waiting;
+    char pad0[56];
+    /*written only by the producer*/
+    volatile uint32_t tail;
+    char pad1[60];
+    /*the size of data (a multiple of 4)*/
+    uint32_t size;
+    char pad2[60];
+    char data[];
+};
+
+#define ba_shm_ring_bytes(size) (sizeof (struct ba_shm_ring) + (size))
+
+static inline void ba_shm_ring_init(struct ba_shm_ring *ring, uint32_t size, uint32_t waiting) {
+    ring->head = 0;
+    ring->tail = 0;
+    ring->waiting = waiting;
+    ring->size = size & ~3U;
+}
+
+static inline int ba_shm_ring_empty(struct ba_shm_ring *ring) {
+    return __atomic_load_n(&ring->head, __ATOMIC_RELAXED) == __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+}
+
+/**@brief reserves room for a record of at most len bytes and returns where its payload goes, so that the producer can build the record in place.
+ * The consumer sees nothing until ba_shm_ring_commit. Only one record may be reserved at a time.
+ * @return NULL if the record does not fit (nothing is written)
+ */
+static inline char *ba_shm_ring_reserve(struct ba_shm_ring *ring, uint32_t len) {
+    uint32_t need, head, tail, pos;
+    need = (sizeof (uint32_t) + len + 3) & ~3U;
+    head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    tail = ring->tail;
+    if (head >= ring->size || tail >= ring->size || (head & 3) != 0 || (tail & 3) != 0 || need < len) {
+        return NULL;
+    }
+    pos = tail;
+    if (tail >= head) {
+        if (ring->size - tail < need || (ring->size - tail == need && head == 0)) {
+            /*wrap: the record must fit in front of head without making the ring look empty*/
+            if (need >= head) {
+                return NULL;
+            }
+            *((uint32_t *) (ring->data + tail)) = BA_SHM_RING_WRAP;
+            pos = 0;
+        }
+    } else if (tail + need >= head) {
+        return NULL;
+    }
+    return ring->data + pos + sizeof (uint32_t);
+}
+
+/**@brief makes the record reserved at payload visible to the consumer. len may be smaller than the reserved length.
+ */
+static inline void ba_shm_ring_commit(struct ba_shm_ring *ring, char *payload, uint32_t len) {
+    uint32_t pos = payload - sizeof (uint32_t) - ring->data;
+    *((uint32_t *) (ring->data + pos)) = len;
+    pos += (sizeof (uint32_t) + len + 3) & ~3U;
+    if (pos == ring->size) {
+        pos = 0;
+    }
+    __atomic_store_n(&ring->tail, pos, __ATOMIC_RELEASE);
+}
+
+/**@brief copies the iovecs to the ring as one record.
+ * @return 0 if the record does not fit (nothing is written), otherwise the number of bytes written
+ */
+static inline int ba_shm_ring_write(struct ba_shm_ring *ring, const struct iovec *iov, int iovcnt) {
+    uint32_t len = 0;
+    char *payload, *p;
+    int i;
+    for (i = 0; i < iovcnt; i++) {
+        len += iov[i].iov_len;
+    }
+    if ((payload = ba_shm_ring_reserve(ring, len)) == NULL) {
+        return 0;
+    }
+    p = payload;
+    for (i = 0; i < iovcnt; i++) {
+        memcpy(p, iov[i].iov_base, iov[i].iov_len);
+        p += iov[i].iov_len;
+    }
+    ba_shm_ring_commit(ring, payload, len);
+    return len;
+}
+
+/**@brief returns the oldest record (len is set to its length) without consuming it, or NULL if the ring is empty.
+ */
+static inline const char *ba_shm_ring_peek(struct ba_shm_ring *ring, uint32_t *len) {
+    uint32_t head = ring->head;
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if (head == tail || head >= ring->size || (head & 3) != 0) {
+        return NULL;
+    }
+    if (*((uint32_t *) (ring->data + head)) == BA_SHM_RING_WRAP) {
+        head = 0;
+        __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+    }
+    *len = *((uint32_t *) (ring->data + head));
+    /*a corrupted record must not take the consumer out of the data area*/
+    if (*len > ring->size - head - sizeof (uint32_t)) {
+        return NULL;
+    }
+    return ring->data + head + sizeof (uint32_t);
+}
+
+/**@brief consumes the record returned by the last ba_shm_ring_peek.
+ */
+static inline void ba_shm_ring_pop(struct ba_shm_ring *ring) {
+    uint32_t head = ring->head;
+    uint32_t len = *((uint32_t *) (ring->data + head));
+    head += (sizeof (uint32_t) + len + 3) & ~3U;
+    if (head == ring->size) {
+        head = 0;
+    }
+    __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+}
+
+/**@brief called by the consumer right before it sleeps on the socket. Returns 1 if it may sleep, 0 if a record arrived meanwhile.
+ */
+static inline int ba_shm_ring_sleep(struct ba_shm_ring *ring) {
+    __atomic_store_n(&ring->waiting, 1, __ATOMIC_SEQ_CST);
+    if (!ba_shm_ring_empty(ring)) {
+        __atomic_store_n(&ring->waiting, 0, __ATOMIC_RELAXED);
+        return 0;
+    }
+    return 1;
+}
+
+/**@brief called by the producer after a write. Returns 1 if the consumer sleeps and a doorbell must be sent.
+ */
+static inline int ba_shm_ring_wakeup(struct ba_shm_ring *ring) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return __atomic_exchange_n(&ring->waiting, 0, __ATOMIC_SEQ_CST) == 1;
+}
+
+#endif /* CLICK_SHMRING_HH */
@@ -0,0 +1,160 @@
+/*Our Proposal
+ *the latency telemetry of the data path
+*/
+#include "telemetry.hh"
+#include <click/straccum.hh>
+#if CLICK_LINUXMODULE
+#include <linux/string.h>
+#else
+#include <string.h>
+#include <arpa/inet.h>
+#endif
+
+CLICK_DECLS
+
+bool Telemetry::enabled = false ;
+uint32_t Telemetry::sample = 100 ;
+uint16_t Telemetry::node = 0 ;
+atomic_uint32_t Telemetry::histogram[TELEMETRY_STAGES][TELEMETRY_BUCKETS] ;
+atomic_uint32_t Telemetry::skewed ;
+atomic_uint32_t Telemetry::sampled_count ;
+TelemetryTrace Telemetry::traces[TELEMETRY_TRACES] ;
+atomic_uint32_t Telemetry::write_pos ;
+uint32_t Telemetry::read_pos = 0 ;
+
+static const char* stage_names[TELEMETRY_STAGES] = {"netlink", "proxy", "forwarder", "wire", "ingress", "delivery", "end_to_end"} ;
+
+const char* Telemetry::stage_name(int stage)
+{
+    return (stage >= 0 && stage < TELEMETRY_STAGES) ? stage_names[stage] : "unknown" ;
+}
+
+uint16_t Telemetry::node_label(const String& nodeID)
+{
+    uint32_t hash = 2166136261U ;
+    for(int i = 0 ; i < nodeID.length() ; i++)
+    {
+        hash ^= (unsigned char) nodeID[i] ;
+        hash *= 16777619U ;
+    }
+    return (uint16_t) ((hash >> 16) ^ (hash & 0xFFFF)) ;
+}
+
+uint16_t Telemetry::checksum(const TelemetryHop* hops, int n)
+{
+    uint32_t hash = 2166136261U ^ n ;
+    for(int i = 0 ; i < n ; i++)
+    {
+        hash = (hash ^ hops[i].usec) * 16777619U ;
+        hash = (hash ^ hops[i].node) * 16777619U ;
+    }
+    return (uint16_t) ((hash >> 16) ^ (hash & 0xFFFF)) ;
+}
+
+WritablePacket* Telemetry::append(WritablePacket* p, const TelemetryHop* hops, int n)
+{
+    unsigned int offset = p->length() ;
+    p = p->put(trace_length(n)) ;
+    if(p == NULL)
+        return NULL ;
+    TelemetryHop* hop = (TelemetryHop*) (p->data() + offset) ;
+    for(int i = 0 ; i < n ; i++)
+    {
+        hop[i].usec = htonl(hops[i].usec) ;
+        hop[i].node = htons(hops[i].node) ;
+        hop[i].reserved = 0 ;
+    }
+    TelemetryFooter* footer = (TelemetryFooter*) (p->data() + offset + n * sizeof(TelemetryHop)) ;
+    footer->hops = n ;
+    footer->version = TELEMETRY_VERSION ;
+    footer->check = htons(checksum(hops, n)) ;
+    footer->magic = htonl(TELEMETRY_MAGIC) ;
+    return p ;
+}
+
+int Telemetry::strip(Packet* p, unsigned int min_len, TelemetryHop* hops)
+{
+    if(p->length() < min_len + trace_length(1))
+        return 0 ;
+    TelemetryFooter footer ;
+    /*the trailer is not aligned*/
+    memcpy(&footer, p->data() + p->length() - sizeof(footer), sizeof(footer)) ;
+    if(ntohl(footer.magic) != TELEMETRY_MAGIC || footer.version != TELEMETRY_VERSION || footer.hops == 0 || footer.hops > TELEMETRY_MAX_HOPS)
+        return 0 ;
+    if(p->length() < min_len + trace_length(footer.hops))
+        return 0 ;
+    const unsigned char* start = p->data() + p->length() - trace_length(footer.hops) ;
+    for(int i = 0 ; i < footer.hops ; i++)
+    {
+        TelemetryHop hop ;
+        memcpy(&hop, start + i * sizeof(TelemetryHop), sizeof(hop)) ;
+        hops[i].usec = ntohl(hop.usec) ;
+        hops[i].node = ntohs(hop.node) ;
+        hops[i].reserved = 0 ;
+    }
+    if(ntohs(footer.check) != checksum(hops, footer.hops))
+        return 0 ;
+    p->take(trace_length(footer.hops)) ;
+    return footer.hops ;
+}
+
+void Telemetry::keep(const TelemetryHop* hops, int n)
+{
+    /*claim a slot - concurrent writers never share one (see Trace::record)*/
+    uint32_t pos = write_pos.fetch_and_add(1) ;
+    TelemetryTrace& t = traces[pos & (TELEMETRY_TRACES - 1)] ;
+    t.seq = 0 ;
+    t.hops = n ;
+    memcpy(t.hop, hops, n * sizeof(TelemetryHop)) ;
+    click_compiler_fence() ;
+    t.seq = pos + 1 ;
+}
+
+String Telemetry::histograms()
+{
+    StringAccum sa ;
+    for(int i = 0 ; i < TELEMETRY_STAGES ; i++)
+    {
+        uint32_t total = 0 ;
+        for(int j = 0 ; j < TELEMETRY_BUCKETS ; j++)
+            total += histogram[i][j].value() ;
+        sa << stage_names[i] << ' ' << total ;
+        for(int j = 0 ; j < TELEMETRY_BUCKETS ; j++)
+            sa << ' ' << histogram[i][j].value() ;
+        sa << '\n' ;
+    }
+    sa << "skewed " << skewed.value() << '\n' ;
+    return sa.take_string() ;
+}
+
+String Telemetry::drain()
+{
+    StringAccum sa ;
+    uint32_t end = write_pos.value() ;
+    if(end - read_pos > TELEMETRY_TRACES)
+        read_pos = end - TELEMETRY_TRACES ;
+    for( ; read_pos != end ; read_pos++)
+    {
+        TelemetryTrace& t = traces[read_pos & (TELEMETRY_TRACES - 1)] ;
+        if(t.seq != read_pos + 1)
+            continue ;
+        for(int i = 0 ; i < t.hops ; i++)
+            sa << (i > 0 ? " " : "") << t.hop[i].node << ':' << t.hop[i].usec ;
+        sa << '\n' ;
+    }
+    return sa.take_string() ;
+}
+
+void Telemetry::reset()
+{
+    for(int i = 0 ; i < TELEMETRY_STAGES ; i++)
+    {
+        for(int j = 0 ; j < TELEMETRY_BUCKETS ; j++)
+            histogram[i][j] = 0 ;
+    }
+    skewed = 0 ;
+}
+
+CLICK_ENDDECLS
+
+ELEMENT_PROVIDES(Telemetry)
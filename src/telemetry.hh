@@ -0,0 +1,170 @@
+#ifndef TELEMETRY_HH_INCLUDED
+#define TELEMETRY_HH_INCLUDED
+
+#include <click/config.h>
+#include <click/string.hh>
+#include <click/atomic.hh>
+#include <click/timestamp.hh>
+#include <click/packet.hh>
+
+CLICK_DECLS
+
+/*the stages of the telemetry: each one is the time from the previous stamp of a packet to the one named*/
+#define TELEMETRY_NETLINK 0 /*FromNetlink to the LocalProxy (a request of an application)*/
+#define TELEMETRY_PROXY 1 /*the LocalProxy (or the CacheUnit) to the Forwarder*/
+#define TELEMETRY_FORWARDER 2 /*in the Forwarder, until the copies for all links are pushed to their devices*/
+#define TELEMETRY_WIRE 3 /*the Forwarder of the previous node to the Forwarder of this one (in-band, the clocks must be synchronised)*/
+#define TELEMETRY_INGRESS 4 /*the device (or the CacheUnit) to the Forwarder*/
+#define TELEMETRY_DELIVERY 5 /*the Forwarder (or FromNetlink) to the LocalProxy pushing the data to a local subscriber*/
+#define TELEMETRY_END_TO_END 6 /*the Forwarder of the publisher to the Forwarder of this node (in-band)*/
+#define TELEMETRY_STAGES 7
+
+/*bucket 0 counts the latencies below 1 usec, bucket i those in [2^(i-1), 2^i) usec - the last one everything above*/
+#define TELEMETRY_BUCKETS 32
+
+/*the in-band hop trace of the sampled publications*/
+#define TELEMETRY_MAGIC 0xBA7E1E00
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_MAX_HOPS 16
+/*the shortest ethernet frame (without the FCS): shorter ones are padded, which would hide the trace, so they are never sampled*/
+#define TELEMETRY_MIN_FRAME 60
+/*the number of hop traces the node keeps for the hop_traces handler (a power of 2)*/
+#define TELEMETRY_TRACES 64
+
+/**@brief one hop of an in-band trace: the node (see Telemetry::node_label) and the time its Forwarder sent the publication (in usec, modulo 2^32) - network byte order on the wire*/
+struct TelemetryHop
+{
+    uint32_t usec ;
+    uint16_t node ;
+    uint16_t reserved ;
+};
+
+/**@brief the end of a traced publication, after its hops*/
+struct TelemetryFooter
+{
+    unsigned char hops ;
+    unsigned char version ;
+    uint16_t check ;
+    uint32_t magic ;
+};
+
+/**@brief a hop trace received by this node*/
+struct TelemetryTrace
+{
+    volatile uint32_t seq ;
+    unsigned char hops ;
+    TelemetryHop hop[TELEMETRY_MAX_HOPS + 1] ;
+};
+
+/**@brief Our proposal the latency telemetry of a node (TELEMETRY of the GlobalConf).
+ *
+ * Every stage of the data path stamps the packets it handles with the Click timestamp annotation (stamp): the time since the previous stamp is counted
+ * in a log2 histogram of the stage. Nothing is stamped or counted while the telemetry is off.
+ * Besides, the Forwarder of a publisher appends an in-band hop trace (TelemetryHop records and a TelemetryFooter) to one in TELEMETRY_SAMPLE of the publications it sends.
+ * Every Forwarder on the way takes it off on ingress, adds itself when it forwards the publication and keeps the whole trace when it delivers it locally,
+ * so no other element ever sees it. All nodes of a domain must have the telemetry on or off: a node without it would deliver the trace as data.
+ * The histograms are read with the telemetry handler of the GlobalConf, the traces with hop_traces (see deployment, -l)
+ */
+class Telemetry
+{
+public:
+    static bool enabled ;
+    /**@brief 1 in sample publications gets a hop trace (0 for none)*/
+    static uint32_t sample ;
+    /**@brief the label of this node in the hop traces*/
+    static uint16_t node ;
+    /**@brief the 16 bit label of a node in the hop traces: the FNV-1a hash of its NODEID folded (deployment computes the same)*/
+    static uint16_t node_label(const String& nodeID) ;
+    static inline uint32_t usec(const Timestamp& t)
+    {
+        return (uint32_t) t.sec() * 1000000U + (uint32_t) t.usec() ;
+    }
+    /**@brief counts a latency of stage*/
+    static inline void record(int stage, const Timestamp& from, const Timestamp& to)
+    {
+        if(to < from)
+        {
+            skewed++ ;
+            return ;
+        }
+        Timestamp elapsed = to - from ;
+        count(stage, (uint64_t) elapsed.sec() * 1000000 + elapsed.usec()) ;
+    }
+    static inline void count(int stage, uint64_t latency)
+    {
+        int bucket = 0 ;
+        while(latency > 0 && bucket < TELEMETRY_BUCKETS - 1)
+        {
+            latency >>= 1 ;
+            bucket++ ;
+        }
+        histogram[stage][bucket]++ ;
+    }
+    /**@brief counts the time since the previous stamp of p (if it has one) for stage and stamps it again.
+     * @return the time of the stamp (a zero Timestamp if the telemetry is off)*/
+    static inline Timestamp stamp(Packet* p, int stage)
+    {
+        if(!enabled)
+            return Timestamp() ;
+        Timestamp now = Timestamp::now() ;
+        if(p->timestamp_anno())
+            record(stage, p->timestamp_anno(), now) ;
+        p->timestamp_anno() = now ;
+        return now ;
+    }
+    /**@brief counts the latency between two hop times of a trace (a negative one is skewed)*/
+    static inline void elapsed(int stage, uint32_t from, uint32_t to)
+    {
+        if((int32_t) (to - from) < 0)
+        {
+            skewed++ ;
+            return ;
+        }
+        count(stage, to - from) ;
+    }
+    /**@brief stamps p without counting anything (the first stage)*/
+    static inline void start(Packet* p)
+    {
+        if(enabled)
+            p->timestamp_anno() = Timestamp::now() ;
+    }
+    /**@brief counts the time since since (the return value of stamp) for stage*/
+    static inline void done(int stage, const Timestamp& since)
+    {
+        if(since)
+            record(stage, since, Timestamp::now()) ;
+    }
+    /**@brief true for the publications that get a hop trace*/
+    static inline bool sampled()
+    {
+        return enabled && sample > 0 && sampled_count.fetch_and_add(1) % sample == 0 ;
+    }
+    static inline unsigned int trace_length(int hops)
+    {
+        return hops * sizeof(TelemetryHop) + sizeof(TelemetryFooter) ;
+    }
+    /**@brief appends the trace of hops (host byte order) to p. Returns the packet or NULL if it could not grow (p is killed)*/
+    static WritablePacket* append(WritablePacket* p, const TelemetryHop* hops, int n) ;
+    /**@brief if p ends with a trace after at least min_len bytes, takes it off, copies its hops to hops (host byte order) and returns their number, otherwise 0*/
+    static int strip(Packet* p, unsigned int min_len, TelemetryHop* hops) ;
+    /**@brief keeps a trace that ended at this node for the hop_traces handler*/
+    static void keep(const TelemetryHop* hops, int n) ;
+    /**@brief the histograms, a line per stage: its name, the number of latencies and the TELEMETRY_BUCKETS counts*/
+    static String histograms() ;
+    /**@brief returns the traces kept since the last drain, a line each (node:usec per hop, oldest first)*/
+    static String drain() ;
+    static void reset() ;
+    static const char* stage_name(int stage) ;
+private:
+    static uint16_t checksum(const TelemetryHop* hops, int n) ;
+    static atomic_uint32_t histogram[TELEMETRY_STAGES][TELEMETRY_BUCKETS] ;
+    /**@brief latencies that were negative (the clocks of two nodes are not synchronised)*/
+    static atomic_uint32_t skewed ;
+    static atomic_uint32_t sampled_count ;
+    static TelemetryTrace traces[TELEMETRY_TRACES] ;
+    static atomic_uint32_t write_pos ;
+    static uint32_t read_pos ;
+};
+
+CLICK_ENDDECLS
+#endif // TELEMETRY_HH_INCLUDED
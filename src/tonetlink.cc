@@ -12,18 +12,41 @@
  * See LICENSE and COPYING for more details.
  */
 #include "tonetlink.hh"
+#include <click/straccum.hh>
+#if !CLICK_LINUXMODULE
+#include <errno.h>
+#endif
 
 CLICK_DECLS
 
-ToNetlink::ToNetlink() {
+#if CLICK_LINUXMODULE
+ToNetlink::ToNetlink() : _inbox(0), _app_queue_limit(NETLINK_APP_QUEUE_LIMIT), _sent(0), _batches(0), _drops(0) {
 }
+#else
+ToNetlink::ToNetlink() : _ring_timer(this), _sent(0), _batches(0), _drops(0) {
+}
+#endif
 
 ToNetlink::~ToNetlink() {
     click_chatter("ToNetlink: destroyed!");
 }
 
 int ToNetlink::configure(Vector<String> &conf, ErrorHandler *errh) {
-    netlink_element = (Netlink *) cp_element(conf[0], this);
+    Element *netlink;
+    unsigned app_queue_limit = NETLINK_APP_QUEUE_LIMIT;
+    if (cp_va_kparse(conf, this, errh,
+            "NETLINK", cpkP + cpkM, cpElement, &netlink,
+            "APP_QUEUE_LIMIT", 0, cpUnsigned, &app_queue_limit,
+            cpEnd) < 0) {
+        return -1;
+    }
+    if (app_queue_limit == 0) {
+        return errh->error("APP_QUEUE_LIMIT must be positive");
+    }
+    netlink_element = (Netlink *) netlink;
+#if CLICK_LINUXMODULE
+    _app_queue_limit = app_queue_limit;
+#endif
     //click_chatter("ToNetlink: configured!");
     return 0;
 }
@@ -31,9 +54,11 @@ int ToNetlink::configure(Vector<String> &conf, ErrorHandler *errh) {
 int ToNetlink::initialize(ErrorHandler *errh) {
 #if CLICK_LINUXMODULE
     _task = new Task(this);
-    _to_netlink_element_state = 0;
-    mutex_init(&up_mutex);
     ScheduleInfo::initialize_task(this, _task, errh);
+    _retry_timer.assign(_task);
+    _retry_timer.initialize(this);
+#else
+    _ring_timer.initialize(this);
 #endif
     //click_chatter("ToNetlink: initialized!");
     return 0;
@@ -42,19 +67,27 @@ int ToNetlink::initialize(ErrorHandler *errh) {
 void ToNetlink::cleanup(CleanupStage stage) {
     if (stage >= CLEANUP_INITIALIZED) {
 #if CLICK_LINUXMODULE
-        /*empty the queues first*/
-        int up_queue_size;
-        /*empty the up_queue*/
-        mutex_lock(&up_mutex);
+        Packet *p, *next;
         /*unschedule and delete the task*/
+        _retry_timer.clear();
         _task->unschedule();
-        up_queue_size = up_queue.size();
-        for (int i = 0; i < up_queue_size; i++) {
-            up_queue.at(up_queue.size() - 1)->kill();
-            up_queue.pop_back();
-        }
         delete _task;
-        mutex_unlock(&up_mutex);
+        /*empty the inbox and the application queues*/
+        for (p = xchg(&_inbox, (Packet *) 0); p != NULL; p = next) {
+            next = p->next();
+            p->kill();
+        }
+        for (int i = 0; i < _active.size(); i++) {
+            for (p = _active[i]->head; p != NULL; p = next) {
+                next = p->next();
+                p->kill();
+            }
+            delete _active[i];
+        }
+        _active.clear();
+        _app_queues.clear();
+#else
+        _ring_timer.clear();
 #endif
     }
     click_chatter("ToNetlink: Cleaned Up!");
@@ -65,82 +98,339 @@ void ToNetlink::push(int, Packet *p) {
     struct nlmsghdr *nlh;
     /*LocalProxy pushed a packet to be sent to an application*/
     final_p = p->push(sizeof (struct nlmsghdr));
-    /*Now it is ready - I have to create a netlink header and put it in the up_queue*/
+    /*Now it is ready - I have to create a netlink header and queue it for the application*/
     nlh = (struct nlmsghdr *) final_p->data();
     nlh->nlmsg_len = sizeof (final_p->length());
     nlh->nlmsg_type = 0;
     nlh->nlmsg_flags = 1;
     nlh->nlmsg_seq = 0;
 #if CLICK_LINUXMODULE
+    Packet *head;
     nlh->nlmsg_pid = 0;
-    mutex_lock(&up_mutex);
-    up_queue.push_front(final_p);
-    mutex_unlock(&up_mutex);
+    /*our proposal the LocalProxy may push from any thread: the packet goes on top of the inbox with a compare and swap, and the Task takes the whole inbox at once (so there is no ABA)*/
+    do {
+        head = ACCESS_ONCE(_inbox);
+        final_p->set_next(head);
+    } while (cmpxchg(&_inbox, head, (Packet *) final_p) != head);
     _task->reschedule();
-    set_bit(TASK_IS_SCHEDULED, &_to_netlink_element_state);
 #else
     nlh->nlmsg_pid = 9999;
+    /*our proposal applications that connected with CONNECT_SHM_RING get their events through the down ring*/
+    ShmRings *rings = netlink_element->shm_rings.get(final_p->anno_u32(0));
+    /*a packet that could never fit in the ring still goes through the socket*/
+    if (rings != NULL && rings->sane() && final_p->length() + 2 * sizeof (uint32_t) < rings->down_size) {
+        struct iovec iov;
+        iov.iov_base = final_p->data();
+        iov.iov_len = final_p->length();
+        if (rings->backlog.empty() && ba_shm_ring_write(rings->down, &iov, 1) > 0) {
+            if (ba_shm_ring_wakeup(rings->down)) {
+                ring_doorbell(final_p->anno_u32(0));
+            }
+            final_p->kill();
+        } else {
+            rings->backlog.push(final_p);
+            if (!_ring_timer.scheduled()) {
+                _ring_timer.schedule_after_msec(SHM_RING_RETRY_MSEC);
+            }
+        }
+        return;
+    }
     netlink_element->out_buf_queue.push(final_p);
     add_select(netlink_element->fd, SELECT_WRITE);
 #endif
 }
 
+enum {
+    H_SENT, H_BATCHES, H_DROPS
+};
+
+void ToNetlink::count_drop(uint32_t pid, int error) {
+    uint64_t &drops = _pid_drops.find_insert(pid, 0).value();
+    drops++;
+    _drops++;
+    if (drops == 1 || drops % 1024 == 0) {
+#if CLICK_LINUXMODULE
+        click_chatter("ToNetlink: dropped %llu packets for application %u (error %d)", (unsigned long long) drops, pid, error);
+#else
+        click_chatter("ToNetlink: dropped %llu packets for application %u (%s)", (unsigned long long) drops, pid, strerror(error));
+#endif
+    }
+}
+
+String ToNetlink::read_handler(Element *e, void *thunk) {
+    ToNetlink *tn = (ToNetlink *) e;
+    StringAccum sa;
+    switch ((intptr_t) thunk) {
+        case H_SENT:
+            sa << tn->_sent;
+            break;
+        case H_BATCHES:
+            sa << tn->_batches;
+            break;
+        case H_DROPS:
+            sa << tn->_drops << "\n";
+            for (HashTable<uint32_t, uint64_t>::iterator it = tn->_pid_drops.begin(); it != tn->_pid_drops.end(); it++) {
+                sa << it.key() << " " << it.value() << "\n";
+            }
+            break;
+    }
+    return sa.take_string();
+}
+
+void ToNetlink::add_handlers() {
+    add_read_handler("sent", read_handler, (void *) H_SENT);
+    add_read_handler("batches", read_handler, (void *) H_BATCHES);
+    add_read_handler("drops", read_handler, (void *) H_DROPS);
+}
+
+#if !CLICK_LINUXMODULE
+
+void ToNetlink::ring_doorbell(uint32_t pid) {
+    WritablePacket *doorbell = Packet::make(0, NULL, sizeof (struct nlmsghdr) + sizeof (unsigned char), 0);
+    struct nlmsghdr *nlh = (struct nlmsghdr *) doorbell->data();
+    memset(nlh, 0, sizeof (struct nlmsghdr));
+    nlh->nlmsg_len = doorbell->length();
+    nlh->nlmsg_flags = 1;
+    nlh->nlmsg_pid = 9999;
+    *(doorbell->data() + sizeof (struct nlmsghdr)) = SHM_DOORBELL;
+    doorbell->set_anno_u32(0, pid);
+    netlink_element->out_buf_queue.push(doorbell);
+    add_select(netlink_element->fd, SELECT_WRITE);
+}
+
+void ToNetlink::run_timer(Timer *timer) {
+    bool pending = false;
+    struct iovec iov;
+    for (HashTable<uint32_t, ShmRings *>::iterator it = netlink_element->shm_rings.begin(); it != netlink_element->shm_rings.end(); it++) {
+        ShmRings *rings = it.value();
+        bool written = false;
+        if (!rings->sane()) {
+            continue;
+        }
+        while (!rings->backlog.empty()) {
+            WritablePacket *p = rings->backlog.front();
+            iov.iov_base = p->data();
+            iov.iov_len = p->length();
+            if (ba_shm_ring_write(rings->down, &iov, 1) == 0) {
+                break;
+            }
+            p->kill();
+            rings->backlog.pop();
+            written = true;
+        }
+        if (written && ba_shm_ring_wakeup(rings->down)) {
+            ring_doorbell(it.key());
+        }
+        if (!rings->backlog.empty()) {
+            pending = true;
+        }
+    }
+    if (pending) {
+        timer->reschedule_after_msec(SHM_RING_RETRY_MSEC);
+    }
+}
+#endif
+
 #if CLICK_LINUXMODULE
 
+void ToNetlink::enqueue(Packet *p) {
+    uint32_t pid = p->anno_u32(0);
+    AppQueue *queue = _app_queues.get(pid);
+    if (queue == NULL) {
+        queue = new AppQueue;
+        queue->pid = pid;
+        queue->deficit = 0;
+        queue->count = 0;
+        queue->head = queue->tail = NULL;
+        _app_queues.set(pid, queue);
+        _active.push_back(queue);
+    }
+    if (queue->count >= _app_queue_limit) {
+        count_drop(pid, -ENOBUFS);
+        p->kill();
+        return;
+    }
+    p->set_next(NULL);
+    if (queue->tail == NULL) {
+        queue->head = p;
+    } else {
+        queue->tail->set_next(p);
+    }
+    queue->tail = p;
+    queue->count++;
+}
+
 bool ToNetlink::run_task(Task *t) {
-    int ret;
-    Packet *up_packet = NULL;
-    int pid;
-    clear_bit(TASK_IS_SCHEDULED, &_to_netlink_element_state);
-    mutex_lock(&up_mutex);
-    while (up_queue.size() > 0) {
-        up_packet = up_queue.at(up_queue.size() - 1);
-        up_queue.pop_back();
-        pid = up_packet->anno_u32(0);
-        ret = netlink_unicast(netlink_element->nl_sk, up_packet->skb(), pid, MSG_DONTWAIT);
-    }
-    mutex_unlock(&up_mutex);
-    if (test_bit(TASK_IS_SCHEDULED, &_to_netlink_element_state) == 1) {
-        t->fast_reschedule();
-    }
-    return true;
+    Packet *p, *next, *fifo = NULL;
+    bool progress = false;
+    int ret, i, w;
+    /*take the inbox and reverse it so that every application gets its packets in the order they were pushed*/
+    for (p = xchg(&_inbox, (Packet *) 0); p != NULL; p = next) {
+        next = p->next();
+        p->set_next(fifo);
+        fifo = p;
+    }
+    for (p = fifo; p != NULL; p = next) {
+        next = p->next();
+        enqueue(p);
+    }
+    if (_active.size() == 0) {
+        return false;
+    }
+    /*one deficit round robin round*/
+    _batches++;
+    for (i = 0; i < _active.size(); i++) {
+        AppQueue *queue = _active[i];
+        queue->deficit += NETLINK_DRR_QUANTUM;
+        while (queue->head != NULL && (int) queue->head->length() <= queue->deficit) {
+            p = queue->head;
+            /*netlink_unicast consumes the skb even when it fails, so it gets a reference of its own and p survives an -EAGAIN*/
+            ret = netlink_unicast(netlink_element->nl_sk, skb_get(p->skb()), queue->pid, MSG_DONTWAIT);
+            if (ret == -EAGAIN) {
+                /*the socket of the application is full: it waits for the next round without collecting credit*/
+                queue->deficit = 0;
+                break;
+            }
+            queue->head = p->next();
+            if (queue->head == NULL) {
+                queue->tail = NULL;
+            }
+            queue->count--;
+            queue->deficit -= p->length();
+            p->set_next(NULL);
+            p->kill();
+            if (ret < 0) {
+                /*the application is gone: drop the rest of its packets as well*/
+                count_drop(queue->pid, ret);
+                for (p = queue->head; p != NULL; p = next) {
+                    next = p->next();
+                    count_drop(queue->pid, ret);
+                    p->kill();
+                }
+                queue->head = queue->tail = NULL;
+                queue->count = 0;
+                break;
+            }
+            _sent++;
+            progress = true;
+        }
+    }
+    /*applications with nothing left give back their queue*/
+    for (i = 0, w = 0; i < _active.size(); i++) {
+        if (_active[i]->head == NULL) {
+            _app_queues.erase(_active[i]->pid);
+            delete _active[i];
+        } else {
+            _active[w++] = _active[i];
+        }
+    }
+    _active.resize(w);
+    if (_active.size() > 0 || ACCESS_ONCE(_inbox) != NULL) {
+        if (progress || ACCESS_ONCE(_inbox) != NULL) {
+            t->fast_reschedule();
+        } else if (!_retry_timer.scheduled()) {
+            _retry_timer.schedule_after_msec(NETLINK_RETRY_MSEC);
+        }
+    }
+    return progress;
 }
 #else
 
-void ToNetlink::selected(int fd, int mask) {
-    WritablePacket *newPacket;
-    int bytes_written;
 #if HAVE_USE_NETLINK
-    struct sockaddr_nl d_nladdr;
+typedef struct mmsghdr batch_msg;
+typedef struct sockaddr_nl batch_addr;
+#else
+struct batch_msg {
+    struct msghdr msg_hdr;
+    unsigned int msg_len;
+};
+typedef struct sockaddr_un batch_addr;
+#endif
+
+/*sends msgs in order and returns how many were sent before the first failure (-1 if msgs[0] failed, errno is set)*/
+static int send_batch(int fd, batch_msg *msgs, int n) {
+#if HAVE_USE_NETLINK
+    return sendmmsg(fd, msgs, n, MSG_DONTWAIT);
 #else
-    struct sockaddr_un d_nladdr;
+    int i;
+    for (i = 0; i < n; i++) {
+        if (sendmsg(fd, &msgs[i].msg_hdr, MSG_DONTWAIT) < 0) {
+            break;
+        }
+    }
+    return (i > 0) ? i : -1;
 #endif
-    struct msghdr msg;
-    struct iovec iov[1];
+}
+
+void ToNetlink::selected(int fd, int mask) {
+    WritablePacket *batch[NETLINK_SEND_BATCH];
+    batch_addr addrs[NETLINK_SEND_BATCH];
+    struct iovec iovs[NETLINK_SEND_BATCH];
+    batch_msg msgs[NETLINK_SEND_BATCH];
+    int n = 0, done = 0, ret, i, w;
+    uint32_t pid;
     if ((mask & SELECT_WRITE) == SELECT_WRITE) {
         if (!netlink_element->out_buf_queue.empty()) {
-            newPacket = netlink_element->out_buf_queue.front();
-            memset(&d_nladdr, 0, sizeof (d_nladdr));
+            while (n < NETLINK_SEND_BATCH && !netlink_element->out_buf_queue.empty()) {
+                batch[n++] = netlink_element->out_buf_queue.front();
+                netlink_element->out_buf_queue.pop();
+            }
+            for (i = 0; i < n; i++) {
+                memset(&addrs[i], 0, sizeof (batch_addr));
 #if HAVE_USE_NETLINK
-            d_nladdr.nl_family = AF_NETLINK;
-            d_nladdr.nl_pad = 0;
-            d_nladdr.nl_pid = newPacket->anno_u32(0);
+                addrs[i].nl_family = AF_NETLINK;
+                addrs[i].nl_pad = 0;
+                addrs[i].nl_pid = batch[i]->anno_u32(0);
 #else
-            d_nladdr.sun_len = sizeof (d_nladdr);
-            d_nladdr.sun_family = PF_LOCAL;
-            ba_id2path(d_nladdr.sun_path, newPacket->anno_u32(0));
+                addrs[i].sun_len = sizeof (batch_addr);
+                addrs[i].sun_family = PF_LOCAL;
+                ba_id2path(addrs[i].sun_path, batch[i]->anno_u32(0));
 #endif
-            iov[0].iov_base = newPacket->data();
-            iov[0].iov_len = newPacket->length();
-            memset(&msg, 0, sizeof (msg));
-            msg.msg_name = (void *) &d_nladdr;
-            msg.msg_namelen = sizeof (d_nladdr);
-            msg.msg_iov = iov;
-            msg.msg_iovlen = 1;
-            bytes_written = sendmsg(fd, &msg, MSG_DONTWAIT);/*note that the netlink destination address is in the msg.msg_name*/
-            /*remove buffer from queue and free it*/
-            newPacket->kill();
-            netlink_element->out_buf_queue.pop();
+                iovs[i].iov_base = batch[i]->data();
+                iovs[i].iov_len = batch[i]->length();
+                memset(&msgs[i], 0, sizeof (batch_msg));
+                msgs[i].msg_hdr.msg_name = (void *) &addrs[i];/*note that the netlink destination address is in the msg_name*/
+                msgs[i].msg_hdr.msg_namelen = sizeof (batch_addr);
+                msgs[i].msg_hdr.msg_iov = &iovs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+            while (done < n) {
+                ret = send_batch(fd, msgs + done, n - done);
+                if (ret > 0) {
+                    for (i = done; i < done + ret; i++) {
+                        batch[i]->kill();
+                    }
+                    done += ret;
+                    _sent += ret;
+                    _batches++;
+                    continue;
+                }
+                if (errno == EINTR) {
+                    continue;
+                }
+                /*the destination of msgs[done] does not take packets now: drop it together with the rest of its packets in this batch and keep the order of the others*/
+                pid = batch[done]->anno_u32(0);
+                count_drop(pid, errno);
+                batch[done]->kill();
+                w = done;
+                for (i = done + 1; i < n; i++) {
+                    if (batch[i]->anno_u32(0) == pid) {
+                        count_drop(pid, errno);
+                        batch[i]->kill();
+                        continue;
+                    }
+                    if (w != i) {
+                        batch[w] = batch[i];
+                        addrs[w] = addrs[i];
+                        iovs[w] = iovs[i];
+                        msgs[w] = msgs[i];
+                        msgs[w].msg_hdr.msg_name = (void *) &addrs[w];
+                        msgs[w].msg_hdr.msg_iov = &iovs[w];
+                    }
+                    w++;
+                }
+                n = w;
+            }
             if (netlink_element->out_buf_queue.empty()) {
                 remove_select(fd, SELECT_WRITE);
             }
@@ -15,9 +15,32 @@
 #define CLICK_TONETLINK_HH
 
 #include "netlink.hh"
+#include "helper.hh"
+#include <click/timer.hh>
 
 CLICK_DECLS
 
+/*our proposal*/
+#define SHM_RING_RETRY_MSEC 1
+/*our proposal the largest number of packets that selected() sends with one system call*/
+#define NETLINK_SEND_BATCH 64
+/*our proposal (kernel space) the default APP_QUEUE_LIMIT in packets, the bytes every application may send in a deficit round robin round
+ *and how long the Task waits when every application with pending packets has a full socket*/
+#define NETLINK_APP_QUEUE_LIMIT 1024
+#define NETLINK_DRR_QUANTUM 4096
+#define NETLINK_RETRY_MSEC 1
+
+#if CLICK_LINUXMODULE
+/**@brief Our proposal (kernel space) the packets waiting for one application: a list chained through Packet::next()*/
+struct AppQueue {
+    uint32_t pid;
+    int deficit;
+    int count;
+    Packet *head;
+    Packet *tail;
+};
+#endif
+
 /**@brief (blackadder Core) The ToNetlink Element is the Element that sends packets to applications.
  * 
  * The LocalProxy pushes annotated packets to the ToNetlink element, which then sends them to the right applications using the provided packet annotation.
@@ -50,7 +73,9 @@ public:
      */
     const char *processing() const {return PUSH;}
     /**
-     * @brief Element configuration - the base Netlink socket is passed as the only parameter (in the Click configuration file)
+     * @brief Element configuration - the base Netlink socket is passed as the only positional parameter (in the Click configuration file).
+     * 
+     * Our proposal in kernel space APP_QUEUE_LIMIT (default NETLINK_APP_QUEUE_LIMIT) bounds the packets queued for a single application; the packets above it are dropped.
      */
     int configure(Vector<String>&, ErrorHandler*);
     /**@brief This Element must be configured AFTER the base Netlink Element
@@ -60,8 +85,8 @@ public:
     /**
      * @brief This method is called by Click when the Element is about to be initialized.
      * 
-     * In kernel space it allocates and initializes the task that is later scheduled when packets are pushed from the LocalProxy.
-     * It also allocates the mutex that protects the up_queue.
+     * In kernel space it allocates and initializes the task that is later scheduled when packets are pushed from the LocalProxy,
+     * and the Timer that schedules it again when every application with pending packets had a full socket.
      * @param errh
      * @return 
      */
@@ -69,7 +94,7 @@ public:
     /**@brief Cleanups everything.
      * 
      * If the stage is before CLEANUP_INITIALIZED (i.e. the element was never initialized), then it does nothing.
-     * In the opposite case it unschedules the Task, empties the up_queue and deletes all packets in it.
+     * In the opposite case it unschedules the Task, empties the inbox and the application queues and deletes all packets in them.
      * @param stage passed by Click
      */
     void cleanup(CleanupStage stage);
@@ -78,27 +103,46 @@ public:
      * This method pushes some space in the packet so that netlink header can fit. It then adds the header.
      * In user space the nlh->nlmsg_pid is assigned to 9999 whereas in kernel space is assigned to 0.
      * In user space the packet is pushed in the out_buf_queue and socket is registered for writing using the add_select.
-     * In kernel space it is pushed in the up_queue and the Task is rescheduled.
+     * In kernel space it is pushed (lock-free) in the inbox and the Task is rescheduled.
      * @param port the port from which the packet was pushed
      * @param p a pointer to the packet
      */
     void push(int port, Packet *p);
 #if CLICK_LINUXMODULE
-    /**@brief This Click Task is executed whenever a packet is pushed in the up_queue (in kernel space only).
+    /**@brief This Click Task is executed whenever a packet is pushed in the inbox (in kernel space only).
      * 
-     * It tries to send all packets in the queue and if, in the meanwhile, another packet was pushed in the queue, it is fastly rescheduled.
+     * Our proposal it takes the whole inbox at once and moves every packet to the AppQueue of its destination pid.
+     * It then runs one deficit round robin round: every application may send NETLINK_DRR_QUANTUM bytes (plus what it did not use in the last round).
+     * A packet refused with -EAGAIN stays at the head of its queue and its application waits for the next round, so a slow subscriber delays only itself.
+     * If packets are left it is fastly rescheduled, or rescheduled by the Timer after NETLINK_RETRY_MSEC when no application could take a packet.
      */
     bool run_task(Task *t);
+    /**@brief Our proposal appends p to the AppQueue of its destination (in kernel space only); only the Task calls it*/
+    void enqueue(Packet *p);
 #else
     /**@brief The selected method is called by Click whenever the socket is writable and one or more packets have been previously put in the out_buf_queue (in iser space only).
      * 
-     * It tries to send a packet to an application and if it succeeds it removes the packet and deletes it (kill).
-     * If more packets exist the socket is registered for writing using the add_select method.
+     * Our proposal it takes up to NETLINK_SEND_BATCH packets from the front of the queue and sends them with as few sendmmsg calls as possible (a sendmsg loop where there is no sendmmsg).
+     * A packet that cannot be sent (e.g. EAGAIN because the application does not read its socket) is counted as a drop of its destination,
+     * and the rest of the batch for the same destination is dropped with it instead of being retried one system call at a time.
+     * The socket stays registered for writing as long as the out_buf_queue is not empty.
      * @param fd
      * @param mask
      */
     void selected(int fd, int mask);
+    /**@brief Our proposal retries the packets that did not fit in the down ring of an application (User-Space only).
+     *
+     * It reschedules itself every SHM_RING_RETRY_MSEC milliseconds as long as some backlog is left.
+     */
+    void run_timer(Timer *timer);
+    /**@brief Our proposal queues a SHM_DOORBELL message for an application whose down ring was written while it was sleeping*/
+    void ring_doorbell(uint32_t pid);
 #endif
+    /**@brief Our proposal counts a packet for pid that could not be sent (or queued) and reports the first one (and every 1024th) with click_chatter*/
+    void count_drop(uint32_t pid, int error);
+    /**@brief Our proposal adds the read handlers sent, batches (system calls in user space, DRR rounds in kernel space) and drops*/
+    void add_handlers();
+    static String read_handler(Element *e, void *thunk);
     /** @brief a pointer to the Base Netlink Element.
      */
     Netlink *netlink_element;
@@ -106,11 +150,25 @@ public:
     /**@brief the Click Task.
      */
     Task *_task;
-    Vector<Packet *> up_queue;
-    struct mutex up_mutex;
-    unsigned long _to_netlink_element_state;
+    /**@brief Our proposal packets pushed by the LocalProxy and not yet seen by the Task, newest first (a lock-free stack chained through Packet::next())*/
+    Packet *_inbox;
+    /**@brief Our proposal the queues of the applications with pending packets, by pid and in round robin order; only the Task touches them*/
+    HashTable<uint32_t, AppQueue *> _app_queues;
+    Vector<AppQueue *> _active;
+    /**@brief Our proposal reschedules the Task when every application with pending packets had a full socket*/
+    Timer _retry_timer;
+    int _app_queue_limit;
+#else
+    /**@brief Our proposal the Timer that flushes the backlog of the down rings*/
+    Timer _ring_timer;
 #endif
-    
+    /**@brief Our proposal packets sent to applications and the system calls (DRR rounds in kernel space) that sent them*/
+    uint64_t _sent;
+    uint64_t _batches;
+    /**@brief Our proposal the packets that could not be sent, in total and per destination pid*/
+    uint64_t _drops;
+    HashTable<uint32_t, uint64_t> _pid_drops;
+
 };
 
 CLICK_ENDDECLS
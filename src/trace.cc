@@ -0,0 +1,115 @@
+/*Our Proposal
+ *the trace points of the hot paths
+*/
+#include "trace.hh"
+#include <click/straccum.hh>
+#include <click/confparse.hh>
+#if CLICK_USERLEVEL
+#include <stdarg.h>
+#endif
+
+CLICK_DECLS
+
+unsigned char Trace::levels[TRACE_CATEGORIES] = {TRACE_ERROR, TRACE_ERROR, TRACE_ERROR} ;
+TraceRecord Trace::ring[TRACE_RING_SIZE] ;
+atomic_uint32_t Trace::write_pos ;
+uint32_t Trace::read_pos = 0 ;
+uint32_t Trace::dropped = 0 ;
+
+static const char* category_names[TRACE_CATEGORIES] = {"forwarder", "cache", "proxy"} ;
+static const char* level_names[] = {"off", "error", "info", "debug"} ;
+
+const char* Trace::category_name(int category)
+{
+    return (category >= 0 && category < TRACE_CATEGORIES) ? category_names[category] : "unknown" ;
+}
+
+void Trace::record(int category, int level, const char* fmt, ...)
+{
+    /*claim a slot - concurrent writers never share one*/
+    uint32_t pos = write_pos.fetch_and_add(1) ;
+    TraceRecord& r = ring[pos & (TRACE_RING_SIZE - 1)] ;
+    r.seq = 0 ;
+    r.category = category ;
+    r.level = level ;
+    r.when = Timestamp::now() ;
+    va_list val ;
+    va_start(val, fmt) ;
+    vsnprintf(r.msg, TRACE_MSG_LEN, fmt, val) ;
+    va_end(val) ;
+    click_compiler_fence() ;
+    r.seq = pos + 1 ;
+    if(level <= TRACE_ERROR)
+        click_chatter("%s: %s", category_name(category), r.msg) ;
+}
+
+String Trace::drain()
+{
+    StringAccum sa ;
+    uint32_t end = write_pos.value() ;
+    if(end - read_pos > TRACE_RING_SIZE)
+    {
+        /*the writers lapped the reader*/
+        dropped += end - read_pos - TRACE_RING_SIZE ;
+        read_pos = end - TRACE_RING_SIZE ;
+    }
+    for( ; read_pos != end ; read_pos++)
+    {
+        TraceRecord& r = ring[read_pos & (TRACE_RING_SIZE - 1)] ;
+        if(r.seq != read_pos + 1)
+        {
+            /*still being written or already overwritten*/
+            dropped++ ;
+            continue ;
+        }
+        sa << r.when << ' ' << category_names[r.category] << ' ' << level_names[r.level] << ": " << r.msg << '\n' ;
+    }
+    if(dropped > 0)
+    {
+        sa << "(" << dropped << " records dropped)\n" ;
+        dropped = 0 ;
+    }
+    return sa.take_string() ;
+}
+
+bool Trace::configure(const String& str)
+{
+    Vector<String> words ;
+    int level = -1 ;
+    cp_spacevec(cp_uncomment(str), words) ;
+    if(words.size() != 2)
+        return false ;
+    String category = words[0] ;
+    String level_str = words[1] ;
+    for(int i = 0 ; i <= TRACE_DEBUG ; i++)
+    {
+        if(level_str == level_names[i])
+            level = i ;
+    }
+    /*a numeric level must be one of the defined ones: a negative one would wrap around in levels*/
+    if(level < 0 && (!cp_integer(level_str, &level) || level < TRACE_OFF || level > TRACE_DEBUG))
+        return false ;
+    for(int i = 0 ; i < TRACE_CATEGORIES ; i++)
+    {
+        if(category == "all" || category == category_names[i])
+        {
+            levels[i] = level ;
+            if(category != "all")
+                return true ;
+        }
+    }
+    return category == "all" ;
+}
+
+String Trace::unparse_levels()
+{
+    StringAccum sa ;
+    for(int i = 0 ; i < TRACE_CATEGORIES ; i++)
+        sa << category_names[i] << ' ' << level_names[levels[i]] << '\n' ;
+    sa << "(compiled in up to " << level_names[BA_TRACE_LEVEL] << ")\n" ;
+    return sa.take_string() ;
+}
+
+CLICK_ENDDECLS
+
+ELEMENT_PROVIDES(Trace)
@@ -0,0 +1,78 @@
+#ifndef TRACE_HH_INCLUDED
+#define TRACE_HH_INCLUDED
+
+#include <click/config.h>
+#include <click/string.hh>
+#include <click/atomic.hh>
+#include <click/timestamp.hh>
+
+CLICK_DECLS
+
+/*trace levels*/
+#define TRACE_OFF 0
+#define TRACE_ERROR 1
+#define TRACE_INFO 2
+#define TRACE_DEBUG 3
+
+/*the most verbose level compiled in (e.g. ./configure --enable-trace=3) - everything above it costs nothing.
+ *release builds only keep the errors*/
+#ifndef BA_TRACE_LEVEL
+#define BA_TRACE_LEVEL TRACE_ERROR
+#endif
+
+/*trace categories*/
+#define TRACE_FORWARDER 0
+#define TRACE_CACHE 1
+#define TRACE_PROXY 2
+#define TRACE_CATEGORIES 3
+
+/*the number of records the ring holds (a power of 2) and the length of each message*/
+#define TRACE_RING_SIZE 1024
+#define TRACE_MSG_LEN 120
+
+/**@brief one record in the Trace ring*/
+struct TraceRecord
+{
+    /**@brief the ring position + 1 of the record once it is complete (0 while it is written)*/
+    volatile uint32_t seq ;
+    unsigned char category ;
+    unsigned char level ;
+    Timestamp when ;
+    char msg[TRACE_MSG_LEN] ;
+};
+
+/**@brief Our proposal the trace points of the hot paths (Forwarder, CacheUnit, LocalProxy).
+ * Instead of a click_chatter per packet, BA_TRACE formats the message into a fixed size lock-free ring only if its level is compiled in and enabled at runtime for its category.
+ * The ring is drained by reading the trace handler of the GlobalConf element, the runtime levels are set by writing its trace_level handler.
+ * Errors are also printed with click_chatter*/
+class Trace
+{
+public:
+    /**@brief the runtime level of each category*/
+    static unsigned char levels[TRACE_CATEGORIES] ;
+    static inline bool enabled(int category, int level) {return level <= levels[category] ;}
+    /**@brief formats a record to the ring (older records are overwritten when it is full)*/
+    static void record(int category, int level, const char* fmt, ...) ;
+    /**@brief returns all records written since the last drain, one per line, oldest first*/
+    static String drain() ;
+    /**@brief parses "CATEGORY LEVEL" (CATEGORY may be all, LEVEL a number or off/error/info/debug); returns false if it is malformed*/
+    static bool configure(const String& str) ;
+    /**@brief returns the runtime level of every category*/
+    static String unparse_levels() ;
+    static const char* category_name(int category) ;
+private:
+    static TraceRecord ring[TRACE_RING_SIZE] ;
+    static atomic_uint32_t write_pos ;
+    static uint32_t read_pos ;
+    /**@brief records overwritten before they were drained*/
+    static uint32_t dropped ;
+};
+
+#define BA_TRACE(category, level, ...) \
+    do { \
+        if ((level) <= BA_TRACE_LEVEL && unlikely(Trace::enabled((category), (level)))) \
+            Trace::record((category), (level), __VA_ARGS__) ; \
+    } while (0)
+
+CLICK_ENDDECLS
+#endif // TRACE_HH_INCLUDED